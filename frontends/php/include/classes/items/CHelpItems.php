@@ -1034,6 +1034,10 @@ class CHelpItems {
 					'key' => 'zabbix[stats,<ip>,<port>,queue,<from>,<to>]',
 					'description' => _('Number of items in the queue which are delayed in Zabbix server or proxy by "from" till "to" seconds, inclusive.')
 				],
+				[
+					'key' => 'zabbix[tls,handshakes,<type>]',
+					'description' => _('Number of certificate-based TLS handshakes of all processes since Zabbix server or proxy start. Types: full, resumed. Use "Change per second" preprocessing to get handshake rates.')
+				],
 				[
 					'key' => 'zabbix[trends]',
 					'description' => _('Number of values stored in table TRENDS.')
@@ -432,6 +432,7 @@ zbx_graph_yaxis_types_t;
 #define ZBX_LOG_LEVEL_INCREASE	"log_level_increase"
 #define ZBX_LOG_LEVEL_DECREASE	"log_level_decrease"
 #define ZBX_SNMP_CACHE_RELOAD	"snmp_cache_reload"
+#define ZBX_DIAGINFO		"diaginfo"
 
 /* value for not supported items */
 #define ZBX_NOTSUPPORTED	"ZBX_NOTSUPPORTED"
@@ -901,6 +902,23 @@ zbx_task_t;
 #define ZBX_RTC_HOUSEKEEPER_EXECUTE	3
 #define ZBX_RTC_CONFIG_CACHE_RELOAD	8
 #define ZBX_RTC_SNMP_CACHE_RELOAD	9
+#define ZBX_RTC_DIAGINFO		10
+
+/* diagnostic information sections, passed in runtime control message scope */
+#define ZBX_DIAGINFO_HISTORYCACHE	0x01
+#define ZBX_DIAGINFO_VALUECACHE		0x02
+#define ZBX_DIAGINFO_PREPROCESSING	0x04
+#define ZBX_DIAGINFO_LLD		0x08
+#define ZBX_DIAGINFO_VMWARE		0x10
+
+#define ZBX_DIAGINFO_HISTORYCACHE_STR	"historycache"
+#define ZBX_DIAGINFO_VALUECACHE_STR	"valuecache"
+#define ZBX_DIAGINFO_PREPROCESSING_STR	"preprocessing"
+#define ZBX_DIAGINFO_LLD_STR		"lld"
+#define ZBX_DIAGINFO_VMWARE_STR		"vmware"
+
+/* the default number of top items reported per diagnostic information section */
+#define ZBX_DIAGINFO_TOP_DEFAULT	25
 
 typedef enum
 {
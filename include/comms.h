@@ -31,6 +31,7 @@
 #	define zbx_sendto(fd, b, n, f, a, l)	(sendto((fd), (b), (int)(n), (f), (a), (l)))
 
 #	define ZBX_PROTO_AGAIN			WSAEINTR
+#	define ZBX_PROTO_WOULDBLOCK(err)		(WSAEWOULDBLOCK == (err))
 #	define ZBX_PROTO_ERROR			SOCKET_ERROR
 #	define ZBX_SOCKET_ERROR			INVALID_SOCKET
 #	define ZBX_SOCKET_TO_INT(s)		((int)(s))
@@ -43,6 +44,7 @@
 #	define zbx_sendto(fd, b, n, f, a, l)	(sendto((fd), (b), (n), (f), (a), (l)))
 
 #	define ZBX_PROTO_AGAIN		EINTR
+#	define ZBX_PROTO_WOULDBLOCK(err)	(EAGAIN == (err) || EWOULDBLOCK == (err))
 #	define ZBX_PROTO_ERROR		-1
 #	define ZBX_SOCKET_ERROR		-1
 #	define ZBX_SOCKET_TO_INT(s)	(s)
@@ -111,6 +113,15 @@ void	zbx_getip_by_host(const char *host, char *ip, size_t iplen);
 int	zbx_tcp_connect(zbx_socket_t *s, const char *source_ip, const char *ip, unsigned short port, int timeout,
 		unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2);
 
+/* socket events non-blocking operations wait for */
+#define ZBX_TCP_WAIT_READ		0x01
+#define ZBX_TCP_WAIT_WRITE		0x02
+
+int	zbx_tcp_connect_nowait(zbx_socket_t *s, const char *source_ip, const char *ip, unsigned short port,
+		unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2, int *wait);
+int	zbx_tcp_connect_continue(zbx_socket_t *s, unsigned int tls_connect, const char *tls_arg1,
+		const char *tls_arg2, int *wait);
+
 #define ZBX_TCP_PROTOCOL		0x01
 #define ZBX_TCP_COMPRESS		0x02
 
@@ -130,6 +141,19 @@ const char	*zbx_tcp_connection_type_name(unsigned int type);
 
 int	zbx_tcp_send_ext(zbx_socket_t *s, const char *data, size_t len, unsigned char flags, int timeout);
 
+/* message being sent over non-blocking socket */
+typedef struct
+{
+	char	*data;		/* the message with protocol header */
+	size_t	size;		/* the message size */
+	size_t	offset;		/* the number of bytes already sent */
+}
+zbx_tcp_send_context_t;
+
+int	zbx_tcp_send_context_init(zbx_tcp_send_context_t *context, const char *data, size_t len, unsigned char flags);
+int	zbx_tcp_send_context(zbx_socket_t *s, zbx_tcp_send_context_t *context, int *wait);
+void	zbx_tcp_send_context_clear(zbx_tcp_send_context_t *context);
+
 void	zbx_tcp_close(zbx_socket_t *s);
 
 #ifdef HAVE_IPV6
@@ -140,6 +164,7 @@ int	zbx_tcp_listen(zbx_socket_t *s, const char *listen_ip, unsigned short listen
 
 int	zbx_tcp_accept(zbx_socket_t *s, unsigned int tls_accept);
 void	zbx_tcp_unaccept(zbx_socket_t *s);
+int	zbx_tcp_accept_nowait(ZBX_SOCKET listen_socket, zbx_socket_t *s);
 
 #define ZBX_TCP_READ_UNTIL_CLOSE 0x01
 
@@ -148,6 +173,22 @@ void	zbx_tcp_unaccept(zbx_socket_t *s);
 #define	zbx_tcp_recv_raw(s)		SUCCEED_OR_FAIL(zbx_tcp_recv_raw_ext(s, 0))
 
 ssize_t		zbx_tcp_recv_ext(zbx_socket_t *s, int timeout);
+
+/* state of message being received, allows to resume receiving over non-blocking socket */
+typedef struct
+{
+	size_t		buf_dyn_bytes;
+	size_t		buf_stat_bytes;
+	size_t		offset;
+	zbx_uint32_t	expected_len;
+	zbx_uint32_t	reserved;
+	int		protocol_version;
+	unsigned char	expect;
+}
+zbx_tcp_recv_context_t;
+
+void		zbx_tcp_recv_context_init(zbx_socket_t *s, zbx_tcp_recv_context_t *context);
+ssize_t		zbx_tcp_recv_context(zbx_socket_t *s, zbx_tcp_recv_context_t *context, int *wait);
 ssize_t		zbx_tcp_recv_raw_ext(zbx_socket_t *s, int timeout);
 const char	*zbx_tcp_recv_line(zbx_socket_t *s);
 
@@ -190,6 +231,7 @@ int	zbx_send_response_ext(zbx_socket_t *sock, int result, const char *info, cons
 #define zbx_send_proxy_response(sock, result, info, timeout) \
 		zbx_send_response_ext(sock, result, info, ZABBIX_VERSION, ZBX_TCP_PROTOCOL | ZBX_TCP_COMPRESS, timeout)
 
+int	zbx_check_response(const char *response, char **error);
 int	zbx_recv_response(zbx_socket_t *sock, int timeout, char **error);
 
 #ifdef HAVE_IPV6
@@ -25,6 +25,7 @@
 #include "sysinfo.h"
 #include "zbxalgo.h"
 #include "zbxjson.h"
+#include "memalloc.h"
 
 #define ZBX_SYNC_DONE		0
 #define	ZBX_SYNC_MORE		1
@@ -39,6 +40,7 @@
 
 #define MAX_JAVA_ITEMS		32
 #define MAX_SNMP_ITEMS		128
+#define MAX_AGENT_ITEMS		32
 #define MAX_POLLER_ITEMS	128	/* MAX(MAX_JAVA_ITEMS, MAX_SNMP_ITEMS) */
 #define MAX_PINGER_ITEMS	128
 
@@ -60,6 +62,7 @@ extern int	CONFIG_POLLER_FORKS;
 extern int	CONFIG_UNREACHABLE_POLLER_FORKS;
 extern int	CONFIG_IPMIPOLLER_FORKS;
 extern int	CONFIG_JAVAPOLLER_FORKS;
+extern int	CONFIG_JAVA_GATEWAY_MULTI_ENDPOINT;
 extern int	CONFIG_PINGER_FORKS;
 extern int	CONFIG_UNAVAILABLE_DELAY;
 extern int	CONFIG_UNREACHABLE_PERIOD;
@@ -502,6 +505,7 @@ typedef struct
 	unsigned char	flags;		/* see ZBX_DC_FLAG_* */
 	unsigned char	state;
 	int		ttl;		/* time-to-live of the history value */
+	double		sample_origin;	/* collection time of value sampled for latency statistics */
 }
 ZBX_DC_HISTORY;
 
@@ -600,7 +604,8 @@ int	zbx_is_counted_in_item_queue(unsigned char type, const char *key);
 int	in_maintenance_without_data_collection(unsigned char maintenance_status, unsigned char maintenance_type,
 		unsigned char type);
 void	dc_add_history(zbx_uint64_t itemid, unsigned char item_value_type, unsigned char item_flags,
-		AGENT_RESULT *result, const zbx_timespec_t *ts, unsigned char state, const char *error);
+		AGENT_RESULT *result, const zbx_timespec_t *ts, unsigned char state, const char *error,
+		double sample_origin);
 void	dc_flush_history(void);
 void	zbx_sync_history_cache(int *values_num, int *triggers_num, int *more);
 void	zbx_log_sync_history_cache_progress(void);
@@ -632,6 +637,10 @@ void	free_database_cache(void);
 void	*DCget_stats(int request);
 void	DCget_stats_all(zbx_wcache_info_t *wcache_info);
 
+void	zbx_hc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num);
+void	zbx_hc_get_mem_stats(zbx_mem_stats_t *data, zbx_mem_stats_t *index);
+void	zbx_hc_get_items(zbx_vector_uint64_pair_t *items);
+
 zbx_uint64_t	DCget_nextid(const char *table_name, int num);
 
 /* initial sync, get all data */
@@ -781,6 +790,9 @@ void	zbx_conditions_eval_clean(zbx_hashset_t *uniq_conditions);
 int	DCget_hosts_availability(zbx_vector_ptr_t *hosts, int *ts);
 void	DCtouch_hosts_availability(const zbx_vector_uint64_t *hostids);
 
+void	DCset_proxyconfig_revisions(const char *revisions);
+char	*DCget_proxyconfig_revisions(void);
+
 void	zbx_host_availability_init(zbx_host_availability_t *availability, zbx_uint64_t hostid);
 void	zbx_host_availability_clean(zbx_host_availability_t *availability);
 void	zbx_host_availability_free(zbx_host_availability_t *availability);
@@ -806,6 +818,7 @@ void	zbx_dc_get_nested_hostgroupids_by_names(char **names, int names_num,
 #define ZBX_DC_FLAG_UNDEF	0x08	/* unsupported or undefined (delta calculation failed) value */
 #define ZBX_DC_FLAG_NOHISTORY	0x10	/* values should not be kept in history */
 #define ZBX_DC_FLAG_NOTRENDS	0x20	/* values should not be kept in trends */
+#define ZBX_DC_FLAG_SAMPLED	0x40	/* value is sampled for latency statistics */
 
 typedef struct zbx_hc_data
 {
@@ -828,6 +841,11 @@ typedef struct
 
 	zbx_hc_data_t	*tail;
 	zbx_hc_data_t	*head;
+
+	/* the collection time and the time it was added to history cache of the item value */
+	/* sampled for latency statistics, there can be only one sampled value per item      */
+	double		sample_origin;
+	double		sample_time;
 }
 zbx_hc_item_t;
 
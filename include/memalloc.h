@@ -44,6 +44,17 @@ typedef struct
 }
 zbx_mem_info_t;
 
+typedef struct
+{
+	zbx_uint64_t	total_size;
+	zbx_uint64_t	free_size;
+	zbx_uint64_t	used_size;
+	zbx_uint64_t	free_chunks;
+	zbx_uint64_t	used_chunks;
+	zbx_uint64_t	max_free_chunk;
+}
+zbx_mem_stats_t;
+
 int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr, const char *param, int allow_oom,
 		char **error);
 
@@ -65,6 +76,7 @@ void	__zbx_mem_free(const char *file, int line, zbx_mem_info_t *info, void *ptr)
 void	zbx_mem_clear(zbx_mem_info_t *info);
 
 void	zbx_mem_dump_stats(int level, zbx_mem_info_t *info);
+void	zbx_mem_get_stats(const zbx_mem_info_t *info, zbx_mem_stats_t *stats);
 
 size_t	zbx_mem_required_size(int chunks_num, const char *descr, const char *param);
 
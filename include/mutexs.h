@@ -43,6 +43,7 @@ typedef enum
 	ZBX_MUTEX_VMWARE,
 	ZBX_MUTEX_SQLITE3,
 	ZBX_MUTEX_PROCSTAT,
+	ZBX_MUTEX_PROC_SNAPSHOT,
 	ZBX_MUTEX_PROXY_HISTORY,
 	ZBX_MUTEX_COUNT
 }
@@ -85,6 +86,39 @@ typedef int zbx_rwlock_t;
 #endif
 int	zbx_locks_create(char **error);
 int	zbx_rwlock_create(zbx_rwlock_t *rwlock, zbx_rwlock_name_t name, char **error);
+
+/* the number of call sites with the longest total hold time kept per lock */
+#define ZBX_LOCK_SITES_NUM	10
+
+/* The filename is the __FILE__ pointer of the call site. It is kept in shared memory and is valid in all */
+/* processes only because they are forked from the same executable image and share its string literals.   */
+typedef struct
+{
+	const char	*filename;
+	int		line;
+	zbx_uint64_t	acquisitions;
+	zbx_uint64_t	contended;
+	double		wait_time;
+	double		hold_time;
+	double		hold_time_max;
+}
+zbx_lock_site_stats_t;
+
+typedef struct
+{
+	zbx_uint64_t		acquisitions;
+	zbx_uint64_t		contended;
+	double			wait_time;
+	double			hold_time;
+	double			hold_time_max;
+	zbx_lock_site_stats_t	sites[ZBX_LOCK_SITES_NUM];
+	int			sites_num;
+}
+zbx_lock_stats_t;
+
+void		zbx_locks_enable_stats(void);
+const char	*zbx_lock_name(int index);
+int		zbx_lock_get_stats(const char *name, zbx_lock_stats_t *stats);
 #endif	/* _WINDOWS */
 #	define zbx_mutex_lock(mutex)		__zbx_mutex_lock(__FILE__, __LINE__, mutex)
 #	define zbx_mutex_unlock(mutex)		__zbx_mutex_unlock(__FILE__, __LINE__, mutex)
@@ -98,4 +132,17 @@ void	zbx_mutex_destroy(zbx_mutex_t *mutex);
 zbx_mutex_name_t	zbx_mutex_create_per_process_name(const zbx_mutex_name_t prefix);
 #endif
 
+/* sequence lock for data with a single writer - the writer never waits for readers, readers do not block */
+/* each other and retry reading while the sequence number is odd or has changed during the read           */
+typedef volatile unsigned int	zbx_seqlock_t;
+
+#if defined(HAVE_SYNC_SYNCHRONIZE) && !defined(_WINDOWS)
+#	define ZBX_SEQLOCK
+
+void		zbx_seqlock_write_begin(zbx_seqlock_t *seqlock);
+void		zbx_seqlock_write_end(zbx_seqlock_t *seqlock);
+unsigned int	zbx_seqlock_read_begin(const zbx_seqlock_t *seqlock);
+int		zbx_seqlock_read_retry(const zbx_seqlock_t *seqlock, unsigned int seq);
+#endif
+
 #endif	/* ZABBIX_MUTEXS_H */
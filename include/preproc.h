@@ -39,6 +39,8 @@ void	zbx_preprocess_item_value(zbx_uint64_t itemid, unsigned char item_value_typ
 		AGENT_RESULT *result, zbx_timespec_t *ts, unsigned char state, char *error);
 void	zbx_preprocessor_flush(void);
 zbx_uint64_t	zbx_preprocessor_get_queue_size(void);
+int	zbx_preprocessor_get_diag_stats(zbx_uint64_t *values_num, zbx_uint64_t *values_preproc_num, char **error);
+int	zbx_preprocessor_get_top_items(int limit, zbx_vector_uint64_pair_t *items, char **error);
 
 void	zbx_preproc_op_free(zbx_preproc_op_t *op);
 void	zbx_preproc_result_free(zbx_preproc_result_t *result);
@@ -33,24 +33,48 @@
 #define ZBX_PROXY_DATA_DONE	0
 #define ZBX_PROXY_DATA_MORE	1
 
+#define ZBX_PROXY_HIST_BACKLOGS_MAX	8
+
+/* history sending positions of fresh data and backfill lanes */
+typedef struct
+{
+	/* history backlog ranges (first, second] left to backfill lane, the oldest first */
+	zbx_vector_uint64_pair_t	backlogs;
+	/* the id of last history record sent by fresh data lane */
+	zbx_uint64_t			fresh_lastid;
+}
+zbx_proxy_hist_lanes_t;
+
 int	get_active_proxy_from_request(struct zbx_json_parse *jp, DC_PROXY *proxy, char **error);
 int	zbx_proxy_check_permissions(const DC_PROXY *proxy, const zbx_socket_t *sock, char **error);
 int	check_access_passive_proxy(zbx_socket_t *sock, int send_response, const char *req);
 
 void	update_proxy_lastaccess(const zbx_uint64_t hostid, time_t last_access);
 
-int	get_proxyconfig_data(zbx_uint64_t proxy_hostid, struct zbx_json *j, char **error);
+int	get_proxyconfig_data(zbx_uint64_t proxy_hostid, struct zbx_json *j, const struct zbx_json_parse *jp_revisions,
+		char **error);
 void	process_proxyconfig(struct zbx_json_parse *jp_data);
 
 int	get_host_availability_data(struct zbx_json *j, int *ts);
 int	process_host_availability(struct zbx_json_parse *jp_data, char **error);
 
 int	proxy_get_hist_data(struct zbx_json *j, zbx_uint64_t *lastid, int *more);
+int	proxy_get_hist_data_range(struct zbx_json **jsons, int jsons_num, const zbx_uint64_t *jsons_lastids,
+		zbx_uint64_t id, zbx_uint64_t maxid, int records_max, zbx_uint64_t *lastid, int *more);
 int	proxy_get_dhis_data(struct zbx_json *j, zbx_uint64_t *lastid, int *more);
 int	proxy_get_areg_data(struct zbx_json *j, zbx_uint64_t *lastid, int *more);
 void	proxy_set_hist_lastid(const zbx_uint64_t lastid);
 void	proxy_set_dhis_lastid(const zbx_uint64_t lastid);
 void	proxy_set_areg_lastid(const zbx_uint64_t lastid);
+void	proxy_hist_lanes_init(zbx_proxy_hist_lanes_t *lanes);
+void	proxy_hist_lanes_destroy(zbx_proxy_hist_lanes_t *lanes);
+zbx_uint64_t	proxy_hist_lanes_lastid(const zbx_proxy_hist_lanes_t *lanes);
+void	proxy_get_hist_lanes(zbx_proxy_hist_lanes_t *lanes);
+void	proxy_set_hist_lanes(const zbx_proxy_hist_lanes_t *lanes);
+zbx_uint64_t	proxy_get_hist_maxid(void);
+int	proxy_hist_lanes_skip(zbx_proxy_hist_lanes_t *lanes, zbx_uint64_t maxid);
+void	proxy_hist_lanes_fresh_sent(zbx_proxy_hist_lanes_t *lanes, zbx_uint64_t sent_lastid);
+void	proxy_hist_lanes_backfill_sent(zbx_proxy_hist_lanes_t *lanes, zbx_uint64_t sent_lastid, int more);
 
 void	calc_timestamp(const char *line, int *timestamp, const char *format);
 
@@ -37,6 +37,7 @@ void	zbx_tls_init_parent(void);
 void	zbx_tls_init_child(void);
 void	zbx_tls_free(void);
 void	zbx_tls_free_on_signal(void);
+void	zbx_tls_get_session_stats(zbx_uint64_t *full, zbx_uint64_t *resumed);
 void	zbx_tls_version(void);
 
 #endif	/* #if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL) */
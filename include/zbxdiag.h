@@ -0,0 +1,34 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_ZBXDIAG_H
+#define ZABBIX_ZBXDIAG_H
+
+#define ZBX_IPC_SERVICE_DIAG	"diag"
+
+/* runtime control -> main process */
+#define ZBX_IPC_DIAG_REQUEST	1
+
+/* main process -> runtime control */
+#define ZBX_IPC_DIAG_RESPONSE	2
+
+int	zbx_diaginfo_send(const char *socket_path, int rtc_data);
+void	zbx_diag_serve(void);
+
+#endif
@@ -34,6 +34,7 @@
 #define ZBX_PROTO_TAG_IP			"ip"
 #define ZBX_PROTO_TAG_DNS			"dns"
 #define ZBX_PROTO_TAG_CONN			"conn"
+#define ZBX_PROTO_TAG_KEEPALIVE			"keepalive"
 #define ZBX_PROTO_TAG_KEY			"key"
 #define ZBX_PROTO_TAG_KEY_ORIG			"key_orig"
 #define ZBX_PROTO_TAG_KEYS			"keys"
@@ -84,6 +85,7 @@
 #define ZBX_PROTO_TAG_TASKS			"tasks"
 #define ZBX_PROTO_TAG_ALERTID			"alertid"
 #define ZBX_PROTO_TAG_JMX_ENDPOINT		"jmx_endpoint"
+#define ZBX_PROTO_TAG_JMX_ENDPOINTS		"jmx_endpoints"
 #define ZBX_PROTO_TAG_EVENTID			"eventid"
 #define ZBX_PROTO_TAG_NAME			"name"
 #define ZBX_PROTO_TAG_HOSTS			"hosts"
@@ -169,11 +171,15 @@
 #define ZBX_PROTO_TAG_IPMI_PASSWORD		"ipmi_password"
 #define ZBX_PROTO_TAG_JMX_AVAILABLE		"jmx_available"
 #define ZBX_PROTO_TAG_DATA_TYPE			"datatype"
+#define ZBX_PROTO_TAG_REVISIONS			"revisions"
+#define ZBX_PROTO_TAG_BUCKET_SIZE		"bucket_size"
+#define ZBX_PROTO_TAG_BUCKETS			"buckets"
 
 #define ZBX_PROTO_VALUE_FAILED		"failed"
 #define ZBX_PROTO_VALUE_SUCCESS		"success"
 
 #define ZBX_PROTO_VALUE_GET_ACTIVE_CHECKS	"active checks"
+#define ZBX_PROTO_VALUE_GET_PASSIVE_CHECKS	"passive checks"
 #define ZBX_PROTO_VALUE_PROXY_CONFIG		"proxy config"
 #define ZBX_PROTO_VALUE_PROXY_HEARTBEAT		"proxy heartbeat"
 #define ZBX_PROTO_VALUE_SENDER_DATA		"sender data"
@@ -21,6 +21,7 @@
 #define ZABBIX_LLD_H
 
 #include "common.h"
+#include "zbxalgo.h"
 
 void	zbx_lld_process_value(zbx_uint64_t itemid, const char *value, const zbx_timespec_t *ts, unsigned char meta,
 		zbx_uint64_t lastlogsize, int mtime, const char *error);
@@ -29,4 +30,8 @@ void	zbx_lld_process_agent_result(zbx_uint64_t itemid, AGENT_RESULT *result, zbx
 
 int	zbx_lld_get_queue_size(zbx_uint64_t *size, char **error);
 
+int	zbx_lld_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, char **error);
+
+int	zbx_lld_get_top_items(int limit, zbx_vector_uint64_pair_t *items, char **error);
+
 #endif	/* ZABBIX_LLD_H */
@@ -40,6 +40,9 @@ zbx_expression_t;
 int	zbx_regexp_compile(const char *pattern, zbx_regexp_t **regexp, const char **err_msg_static);
 int	zbx_regexp_compile_ext(const char *pattern, zbx_regexp_t **regexp, int flags, const char **error);
 void	zbx_regexp_free(zbx_regexp_t *regexp);
+int	zbx_regexp_prepare_lines(const char *pattern, const zbx_regexp_t **regexp, const char **err_msg_static);
+int	zbx_regexp_search_lines(const char *buf, size_t len, const zbx_regexp_t *regexp, size_t *offset);
+const char	*zbx_find_cr_lf_byte(const char *p, const char *p_end);
 int	zbx_regexp_match_precompiled(const char *string, const zbx_regexp_t *regexp);
 char	*zbx_regexp_match(const char *string, const char *pattern, int *len);
 int	zbx_regexp_sub(const char *string, const char *pattern, const char *output_template, char **out);
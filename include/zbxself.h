@@ -20,6 +20,8 @@
 #ifndef ZABBIX_ZBXSELF_H
 #define ZABBIX_ZBXSELF_H
 
+#include "common.h"
+
 #define ZBX_PROCESS_STATE_IDLE		0
 #define ZBX_PROCESS_STATE_BUSY		1
 #define ZBX_PROCESS_STATE_COUNT		2	/* number of process states */
@@ -31,29 +33,70 @@
 
 #define ZBX_SELFMON_DELAY		1
 
+#define ZBX_LATENCY_STAT_PERCENTILE	0
+#define ZBX_LATENCY_STAT_AVG		1
+#define ZBX_LATENCY_STAT_MAX		2
+#define ZBX_LATENCY_STAT_COUNT		3
+
+/* the stages of sampled item value processing */
+#define ZBX_VALUE_LATENCY_COLLECTION	0	/* from collection until received by preprocessing manager */
+#define ZBX_VALUE_LATENCY_PREPROCESSING	1	/* preprocessing queue and workers */
+#define ZBX_VALUE_LATENCY_CACHE		2	/* history cache until picked up by history syncer */
+#define ZBX_VALUE_LATENCY_SYNC		3	/* history sync and trigger recalculation */
+#define ZBX_VALUE_LATENCY_TOTAL		4	/* from collection until history sync is finished */
+#define ZBX_VALUE_LATENCY_COUNT		5
+
 /* the process statistics */
 typedef struct
 {
-	double	busy_max;
-	double	busy_min;
-	double	busy_avg;
-	double	idle_max;
-	double	idle_min;
-	double	idle_avg;
-	int	count;
+	double		busy_max;
+	double		busy_min;
+	double		busy_avg;
+	double		idle_max;
+	double		idle_min;
+	double		idle_avg;
+	int		count;
+
+	/* operation latency of all processes of this type, in seconds */
+	zbx_uint64_t	latency_count;
+	double		latency_avg;
+	double		latency_p50;
+	double		latency_p90;
+	double		latency_p99;
+	double		latency_max;
 }
 zbx_process_info_t;
 
+/* the value latency statistics of a processing stage, in seconds */
+typedef struct
+{
+	zbx_uint64_t	count;
+	double		avg;
+	double		p50;
+	double		p90;
+	double		p99;
+	double		max;
+}
+zbx_value_latency_info_t;
+
 int	get_process_type_forks(unsigned char process_type);
 
 #ifndef _WINDOWS
 int	init_selfmon_collector(char **error);
 void	free_selfmon_collector(void);
 void	update_selfmon_counter(unsigned char state);
+void	update_selfmon_latency(double latency);
+void	update_selfmon_value_latency(unsigned char stage, double latency);
 void	collect_selfmon_stats(void);
 void	get_selfmon_stats(unsigned char process_type, unsigned char aggr_func, int process_num,
 		unsigned char state, double *value);
+void	get_selfmon_latency(unsigned char process_type, unsigned char aggr_func, int process_num,
+		unsigned char stat, double percentile, double *value);
+void	get_selfmon_value_latency(unsigned char stage, unsigned char stat, double percentile, double *value);
+void	zbx_get_value_latency_stats(zbx_value_latency_info_t *stats);
+const char	*get_value_latency_stage_string(unsigned char stage);
 int	zbx_get_all_process_stats(zbx_process_info_t *stats);
+void	zbx_get_tls_session_stats(zbx_uint64_t *full, zbx_uint64_t *resumed);
 void	zbx_sleep_loop(int sleeptime);
 void	zbx_sleep_forever(void);
 void	zbx_wakeup(void);
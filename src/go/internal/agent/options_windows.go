@@ -36,6 +36,8 @@ type AgentOptions struct {
 	HostInterfaceItem    string   `conf:"optional"`
 	BufferSend           int      `conf:"optional,range=1:3600,default=5"`
 	BufferSize           int      `conf:"optional,range=2:65535,default=100"`
+	PersistentBufferDir  string   `conf:"optional"`
+	PersistentBufferSize int      `conf:"optional,range=16:1048576,default=256"`
 	ListenIP             string   `conf:"optional"`
 	ListenPort           int      `conf:"optional,range=1024:32767,default=10050"`
 	StatusPort           int      `conf:"optional,range=1024:32767"`
@@ -0,0 +1,474 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+package resultcache
+
+import (
+	"bytes"
+	"compress/zlib"
+	"encoding/binary"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"hash/crc32"
+	"io"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+)
+
+// The disk buffer keeps results, which could not be uploaded, in append-only segment files:
+//
+//   <PersistentBufferDir>/zabbix_agent2.<host>_<port>.<seq>.buf
+//
+// Each record holds zlib compressed json array of results written by one cache flush. Records are
+// appended to the last segment and uploaded from the first one. The upload position is stored in
+// <PersistentBufferDir>/zabbix_agent2.<host>_<port>.pos file, fully uploaded segments are removed.
+
+const (
+	diskSegmentSize   = 4 * 1024 * 1024
+	diskRecordHdrSize = 20
+	diskSegmentSuffix = ".buf"
+	diskPositionFile  = "pos"
+)
+
+type diskRecordHeader struct {
+	Size     uint32
+	ValueNum uint32
+	LastID   uint64
+	Checksum uint32
+}
+
+// diskPosition is the upload position in the disk buffer
+type diskPosition struct {
+	seq    uint64
+	offset int64
+}
+
+type diskBuffer struct {
+	mutex    sync.Mutex
+	prefix   string
+	maxSize  int64
+	usedSize int64
+	// segment sequence numbers on disk, the first segment is read and the last one is written
+	seqs    []uint64
+	wfile   *os.File
+	wsize   int64
+	rfile   *os.File
+	roffset int64
+	lastID  uint64
+}
+
+func (b *diskBuffer) segmentPath(seq uint64) string {
+	return b.prefix + strconv.FormatUint(seq, 10) + diskSegmentSuffix
+}
+
+// scanSegment validates segment records and returns size of the valid data
+func (b *diskBuffer) scanSegment(f *os.File, offset int64) (size int64, err error) {
+	var hdr diskRecordHeader
+	size = offset
+	for {
+		if _, err = f.Seek(size, io.SeekStart); err != nil {
+			return
+		}
+		if err = binary.Read(f, binary.LittleEndian, &hdr); err != nil {
+			if err == io.EOF || err == io.ErrUnexpectedEOF {
+				err = nil
+			}
+			return
+		}
+		data := make([]byte, hdr.Size)
+		if _, err = io.ReadFull(f, data); err != nil || crc32.ChecksumIEEE(data) != hdr.Checksum {
+			// incomplete record written before crash, discard it
+			return size, nil
+		}
+		size += diskRecordHdrSize + int64(hdr.Size)
+		if hdr.LastID > b.lastID {
+			b.lastID = hdr.LastID
+		}
+	}
+}
+
+func (b *diskBuffer) readPosition() (pos diskPosition) {
+	data, err := ioutil.ReadFile(b.prefix + diskPositionFile)
+	if err != nil || len(data) != 16 {
+		return
+	}
+	pos.seq = binary.LittleEndian.Uint64(data)
+	pos.offset = int64(binary.LittleEndian.Uint64(data[8:]))
+	return
+}
+
+func (b *diskBuffer) writePosition() (err error) {
+	data := make([]byte, 16)
+	if len(b.seqs) != 0 {
+		binary.LittleEndian.PutUint64(data, b.seqs[0])
+		binary.LittleEndian.PutUint64(data[8:], uint64(b.roffset))
+	}
+	tmp := b.prefix + diskPositionFile + ".tmp"
+	if err = ioutil.WriteFile(tmp, data, 0600); err != nil {
+		return
+	}
+	return os.Rename(tmp, b.prefix+diskPositionFile)
+}
+
+// removeSegment removes segment file, if it fails the segment is removed when the disk buffer is opened
+// next time because it's before the stored upload position
+func (b *diskBuffer) removeSegment(seq uint64) {
+	_ = os.Remove(b.segmentPath(seq))
+}
+
+// newDiskBuffer opens disk buffer of the specified ServerActive address, restoring results left by
+// the previous agent run
+func newDiskBuffer(dir string, addr string, maxSize int64) (b *diskBuffer, err error) {
+	var fi os.FileInfo
+	if fi, err = os.Stat(dir); err != nil {
+		return nil, err
+	}
+	if !fi.IsDir() {
+		return nil, fmt.Errorf("\"%s\" is not a directory", dir)
+	}
+
+	name := strings.NewReplacer(":", "_", "[", "", "]", "", "/", "_").Replace(addr)
+	b = &diskBuffer{prefix: filepath.Join(dir, "zabbix_agent2."+name+"."), maxSize: maxSize}
+
+	var files []string
+	if files, err = filepath.Glob(b.prefix + "*" + diskSegmentSuffix); err != nil {
+		return nil, err
+	}
+	for _, file := range files {
+		s := strings.TrimSuffix(strings.TrimPrefix(file, b.prefix), diskSegmentSuffix)
+		if seq, err := strconv.ParseUint(s, 10, 64); err == nil {
+			b.seqs = append(b.seqs, seq)
+		}
+	}
+	sort.Slice(b.seqs, func(i, j int) bool { return b.seqs[i] < b.seqs[j] })
+
+	pos := b.readPosition()
+	for len(b.seqs) != 0 && b.seqs[0] < pos.seq {
+		b.removeSegment(b.seqs[0])
+		b.seqs = b.seqs[1:]
+	}
+
+	for i := 0; i < len(b.seqs); i++ {
+		var f *os.File
+		if f, err = os.OpenFile(b.segmentPath(b.seqs[i]), os.O_RDWR, 0600); err != nil {
+			b.close()
+			return nil, err
+		}
+		var offset, size int64
+		if b.seqs[i] == pos.seq {
+			offset = pos.offset
+			if fi, err := f.Stat(); err == nil && fi.Size() < offset {
+				offset = fi.Size()
+			}
+		}
+		if size, err = b.scanSegment(f, offset); err == nil {
+			err = f.Truncate(size)
+		}
+		if err != nil {
+			f.Close()
+			b.close()
+			return nil, fmt.Errorf("cannot read \"%s\": %s", f.Name(), err)
+		}
+		b.usedSize += size - offset
+
+		if i == 0 {
+			b.roffset = offset
+		}
+		if i == len(b.seqs)-1 {
+			b.wfile = f
+			b.wsize = size
+			if _, err = f.Seek(size, io.SeekStart); err != nil {
+				b.close()
+				return nil, err
+			}
+		} else {
+			f.Close()
+		}
+	}
+
+	if b.empty() {
+		b.reset()
+	}
+
+	return b, nil
+}
+
+// reset removes all segments after the buffer was uploaded
+func (b *diskBuffer) reset() {
+	if b.rfile != nil {
+		b.rfile.Close()
+		b.rfile = nil
+	}
+	if b.wfile != nil {
+		b.wfile.Close()
+		b.wfile = nil
+	}
+	for _, seq := range b.seqs {
+		b.removeSegment(seq)
+	}
+	b.seqs = b.seqs[:0]
+	b.roffset = 0
+	b.wsize = 0
+	b.usedSize = 0
+	_ = os.Remove(b.prefix + diskPositionFile)
+}
+
+func (b *diskBuffer) empty() bool {
+	return len(b.seqs) == 0 || (len(b.seqs) == 1 && b.roffset >= b.wsize)
+}
+
+// Empty returns true if there are no results to upload in the disk buffer
+func (b *diskBuffer) Empty() bool {
+	b.mutex.Lock()
+	defer b.mutex.Unlock()
+	return b.empty()
+}
+
+// Write appends results to the disk buffer. An error is returned if the buffer is full or cannot be
+// written, in which case the results must be kept in memory.
+func (b *diskBuffer) Write(results []*AgentData) (err error) {
+	if len(results) == 0 {
+		return
+	}
+
+	var data []byte
+	if data, err = json.Marshal(results); err != nil {
+		return
+	}
+
+	var buf bytes.Buffer
+	buf.Write(make([]byte, diskRecordHdrSize))
+	z := zlib.NewWriter(&buf)
+	if _, err = z.Write(data); err != nil {
+		return
+	}
+	if err = z.Close(); err != nil {
+		return
+	}
+	record := buf.Bytes()
+	payload := record[diskRecordHdrSize:]
+
+	hdr := diskRecordHeader{
+		Size:     uint32(len(payload)),
+		ValueNum: uint32(len(results)),
+		LastID:   results[len(results)-1].Id,
+		Checksum: crc32.ChecksumIEEE(payload),
+	}
+	var hdrBuf bytes.Buffer
+	_ = binary.Write(&hdrBuf, binary.LittleEndian, &hdr)
+	copy(record, hdrBuf.Bytes())
+
+	b.mutex.Lock()
+	defer b.mutex.Unlock()
+
+	if b.usedSize+int64(len(record)) > b.maxSize {
+		return errors.New("persistent buffer is full")
+	}
+
+	if b.wfile == nil || b.wsize >= diskSegmentSize {
+		var seq uint64
+		if len(b.seqs) != 0 {
+			seq = b.seqs[len(b.seqs)-1] + 1
+		}
+		var f *os.File
+		if f, err = os.OpenFile(b.segmentPath(seq), os.O_CREATE|os.O_TRUNC|os.O_WRONLY, 0600); err != nil {
+			return
+		}
+		if b.wfile != nil {
+			b.wfile.Close()
+		}
+		if len(b.seqs) == 0 {
+			b.roffset = 0
+		}
+		b.wfile = f
+		b.wsize = 0
+		b.seqs = append(b.seqs, seq)
+	}
+
+	if _, err = b.wfile.Write(record); err == nil {
+		err = b.wfile.Sync()
+	}
+	if err != nil {
+		// drop partially written record
+		_ = b.wfile.Truncate(b.wsize)
+		_, _ = b.wfile.Seek(b.wsize, io.SeekStart)
+		return
+	}
+
+	b.wsize += int64(len(record))
+	b.usedSize += int64(len(record))
+	b.lastID = hdr.LastID
+
+	return
+}
+
+// Read returns the oldest results as json array, joining records until maxNum values are read, and
+// the position to commit after the results are uploaded
+func (b *diskBuffer) Read(maxNum int) (data []byte, num int, pos diskPosition, err error) {
+	b.mutex.Lock()
+	defer b.mutex.Unlock()
+
+	if b.empty() {
+		return
+	}
+
+	pos = diskPosition{seq: b.seqs[0], offset: b.roffset}
+	if b.rfile == nil {
+		if b.rfile, err = os.Open(b.segmentPath(pos.seq)); err != nil {
+			return
+		}
+	}
+
+	var buf bytes.Buffer
+	buf.WriteByte('[')
+
+	for num < maxNum {
+		var size int64
+		if len(b.seqs) == 1 {
+			size = b.wsize
+		} else if fi, err := b.rfile.Stat(); err == nil {
+			size = fi.Size()
+		}
+		// other segments are not read to keep the upload position simple
+		if pos.offset >= size {
+			break
+		}
+
+		var hdr diskRecordHeader
+		if _, err = b.rfile.Seek(pos.offset, io.SeekStart); err != nil {
+			return
+		}
+		if err = binary.Read(b.rfile, binary.LittleEndian, &hdr); err != nil {
+			return
+		}
+		if num != 0 && num+int(hdr.ValueNum) > maxNum {
+			break
+		}
+
+		var z io.ReadCloser
+		if z, err = zlib.NewReader(io.LimitReader(b.rfile, int64(hdr.Size))); err != nil {
+			return
+		}
+		var record []byte
+		record, err = ioutil.ReadAll(z)
+		z.Close()
+		if err != nil {
+			return
+		}
+		if len(record) < 2 || record[0] != '[' || record[len(record)-1] != ']' {
+			return nil, 0, pos, fmt.Errorf("invalid record at offset %d in \"%s\"", pos.offset,
+				b.rfile.Name())
+		}
+
+		if num != 0 {
+			buf.WriteByte(',')
+		}
+		buf.Write(record[1 : len(record)-1])
+		num += int(hdr.ValueNum)
+		pos.offset += diskRecordHdrSize + int64(hdr.Size)
+	}
+
+	buf.WriteByte(']')
+	return buf.Bytes(), num, pos, nil
+}
+
+// Commit marks results up to the specified position as uploaded
+func (b *diskBuffer) Commit(pos diskPosition) (err error) {
+	b.mutex.Lock()
+	defer b.mutex.Unlock()
+
+	if len(b.seqs) == 0 || b.seqs[0] != pos.seq {
+		return
+	}
+
+	b.usedSize -= pos.offset - b.roffset
+	b.roffset = pos.offset
+
+	if len(b.seqs) > 1 {
+		if fi, err := os.Stat(b.segmentPath(b.seqs[0])); err == nil && b.roffset >= fi.Size() {
+			if b.rfile != nil {
+				b.rfile.Close()
+				b.rfile = nil
+			}
+			b.removeSegment(b.seqs[0])
+			b.seqs = b.seqs[1:]
+			b.roffset = 0
+		}
+	} else if b.roffset >= b.wsize {
+		b.reset()
+		return
+	}
+
+	return b.writePosition()
+}
+
+// Drop discards the oldest segment after it could not be read
+func (b *diskBuffer) Drop() {
+	b.mutex.Lock()
+	defer b.mutex.Unlock()
+
+	if len(b.seqs) <= 1 {
+		b.reset()
+		return
+	}
+
+	if b.rfile != nil {
+		b.rfile.Close()
+		b.rfile = nil
+	}
+
+	if fi, err := os.Stat(b.segmentPath(b.seqs[0])); err == nil {
+		b.usedSize -= fi.Size() - b.roffset
+	}
+	b.removeSegment(b.seqs[0])
+	b.seqs = b.seqs[1:]
+	b.roffset = 0
+	_ = b.writePosition()
+}
+
+// Close closes the disk buffer files, keeping the results for the next agent run
+func (b *diskBuffer) Close() {
+	b.mutex.Lock()
+	defer b.mutex.Unlock()
+	b.close()
+}
+
+func (b *diskBuffer) close() {
+	if b.rfile != nil {
+		b.rfile.Close()
+		b.rfile = nil
+	}
+	if b.wfile != nil {
+		b.wfile.Close()
+		b.wfile = nil
+	}
+}
+
+// LastID returns the last result id stored in the disk buffer
+func (b *diskBuffer) LastID() uint64 {
+	b.mutex.Lock()
+	defer b.mutex.Unlock()
+	return b.lastID
+}
@@ -0,0 +1,273 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+package resultcache
+
+import (
+	"encoding/json"
+	"errors"
+	"io/ioutil"
+	"os"
+	"sync"
+	"testing"
+	"time"
+
+	"zabbix.com/internal/agent"
+	"zabbix.com/pkg/log"
+	"zabbix.com/pkg/plugin"
+)
+
+func newDiskTestResults(firstID uint64, num int) []*AgentData {
+	results := make([]*AgentData, num)
+	for i := range results {
+		value := "value"
+		results[i] = &AgentData{Id: firstID + uint64(i), Itemid: 1, Value: &value, Clock: 1, Ns: 1}
+	}
+	return results
+}
+
+func checkDiskRead(t *testing.T, b *diskBuffer, maxNum int, firstID uint64, num int) diskPosition {
+	data, n, pos, err := b.Read(maxNum)
+	if err != nil {
+		t.Fatalf("Cannot read disk buffer: %s", err)
+	}
+	if n != num {
+		t.Fatalf("Expected %d values while got %d", num, n)
+	}
+	var results []*AgentData
+	if err = json.Unmarshal(data, &results); err != nil {
+		t.Fatalf("Cannot parse disk buffer data: %s", err)
+	}
+	if len(results) != num {
+		t.Fatalf("Expected %d results while got %d", num, len(results))
+	}
+	for i, r := range results {
+		if r.Id != firstID+uint64(i) {
+			t.Fatalf("Expected %d data id while got %d", firstID+uint64(i), r.Id)
+		}
+	}
+	return pos
+}
+
+func TestDiskBuffer(t *testing.T) {
+	dir, err := ioutil.TempDir("", "resultcache")
+	if err != nil {
+		t.Fatalf("Cannot create temporary directory: %s", err)
+	}
+	defer os.RemoveAll(dir)
+
+	b, err := newDiskBuffer(dir, "127.0.0.1:10051", 1024*1024)
+	if err != nil {
+		t.Fatalf("Cannot open disk buffer: %s", err)
+	}
+	if !b.Empty() {
+		t.Fatalf("Expected empty disk buffer")
+	}
+
+	for i := 0; i < 3; i++ {
+		if err = b.Write(newDiskTestResults(uint64(1+i*10), 10)); err != nil {
+			t.Fatalf("Cannot write disk buffer: %s", err)
+		}
+	}
+
+	// records are joined up to the requested number of values
+	pos := checkDiskRead(t, b, 20, 1, 20)
+	if err = b.Commit(pos); err != nil {
+		t.Fatalf("Cannot commit disk buffer: %s", err)
+	}
+	b.Close()
+
+	// only the values not committed are restored after reopening
+	if b, err = newDiskBuffer(dir, "127.0.0.1:10051", 1024*1024); err != nil {
+		t.Fatalf("Cannot reopen disk buffer: %s", err)
+	}
+	if b.LastID() != 30 {
+		t.Fatalf("Expected last id 30 while got %d", b.LastID())
+	}
+	pos = checkDiskRead(t, b, 20, 21, 10)
+	if err = b.Commit(pos); err != nil {
+		t.Fatalf("Cannot commit disk buffer: %s", err)
+	}
+	if !b.Empty() {
+		t.Fatalf("Expected empty disk buffer")
+	}
+	b.Close()
+
+	if files, _ := ioutil.ReadDir(dir); len(files) != 0 {
+		t.Fatalf("Expected no files left in disk buffer directory while got %d", len(files))
+	}
+}
+
+func TestDiskBufferFull(t *testing.T) {
+	dir, err := ioutil.TempDir("", "resultcache")
+	if err != nil {
+		t.Fatalf("Cannot create temporary directory: %s", err)
+	}
+	defer os.RemoveAll(dir)
+
+	b, err := newDiskBuffer(dir, "127.0.0.1:10051", 256)
+	if err != nil {
+		t.Fatalf("Cannot open disk buffer: %s", err)
+	}
+	defer b.Close()
+
+	if err = b.Write(newDiskTestResults(1, 1)); err != nil {
+		t.Fatalf("Cannot write disk buffer: %s", err)
+	}
+	if err = b.Write(newDiskTestResults(2, 1000)); err == nil {
+		t.Fatalf("Expected disk buffer full error")
+	}
+	checkDiskRead(t, b, 100, 1, 1)
+}
+
+type failingWriter struct {
+	fail   bool
+	retry  bool
+	lastid uint64
+	t      *testing.T
+	mutex  sync.Mutex
+}
+
+func (w *failingWriter) Write(data []byte, timeout time.Duration) (err error) {
+	w.mutex.Lock()
+	defer w.mutex.Unlock()
+
+	if w.fail {
+		return errors.New("mock error")
+	}
+
+	var request AgentDataRequest
+	_ = json.Unmarshal(data, &request)
+	for _, d := range request.Data {
+		if d.Id != w.lastid+1 {
+			w.t.Errorf("Expected %d data id while got %d", w.lastid+1, d.Id)
+		}
+		w.lastid = d.Id
+	}
+	return
+}
+
+func (w *failingWriter) Addr() string {
+	return "127.0.0.1:10051"
+}
+
+func (w *failingWriter) CanRetry() bool {
+	return w.retry
+}
+
+func TestResultCacheDisk(t *testing.T) {
+	dir, err := ioutil.TempDir("", "resultcache")
+	if err != nil {
+		t.Fatalf("Cannot create temporary directory: %s", err)
+	}
+	defer os.RemoveAll(dir)
+
+	agent.Options.BufferSize = 10
+	agent.Options.PersistentBufferDir = dir
+	agent.Options.PersistentBufferSize = 16
+	defer func() { agent.Options.PersistentBufferDir = "" }()
+	_ = log.Open(log.Console, log.Debug, "", 0)
+
+	writer := failingWriter{fail: true, t: t}
+	cache := NewActive(0, &writer)
+	if cache.disk == nil {
+		t.Fatalf("Expected disk buffer to be opened")
+	}
+
+	value := "xyz"
+	result := plugin.Result{Itemid: 1, Value: &value, Ts: time.Now()}
+
+	// results are moved to disk instead of being replaced when the upload fails
+	for i := 0; i < 35; i++ {
+		cache.write(&result)
+	}
+	cache.flushOutput(&writer)
+	if len(cache.results) != 0 || cache.disk.Empty() {
+		t.Fatalf("Expected results to be moved to disk buffer")
+	}
+
+	// new results are queued behind the backlog
+	writer.fail = false
+	cache.write(&result)
+	cache.flushOutput(&writer)
+	if len(cache.results) != 0 {
+		t.Fatalf("Expected results to be moved to disk buffer")
+	}
+
+	if err = cache.uploadDisk(<-cache.diskUpload, nil); err != nil {
+		t.Fatalf("Cannot upload disk buffer: %s", err)
+	}
+	if writer.lastid != 36 {
+		t.Fatalf("Expected 36 values to be uploaded while got %d", writer.lastid)
+	}
+
+	// results are uploaded directly after the backlog is sent
+	cache.write(&result)
+	cache.flushOutput(&writer)
+	if writer.lastid != 37 || !cache.disk.Empty() {
+		t.Fatalf("Expected result to be uploaded directly")
+	}
+	cache.disk.Close()
+}
+
+func TestResultCacheDiskRetry(t *testing.T) {
+	dir, err := ioutil.TempDir("", "resultcache")
+	if err != nil {
+		t.Fatalf("Cannot create temporary directory: %s", err)
+	}
+	defer os.RemoveAll(dir)
+
+	agent.Options.BufferSize = 10
+	agent.Options.PersistentBufferDir = dir
+	agent.Options.PersistentBufferSize = 16
+	defer func() { agent.Options.PersistentBufferDir = "" }()
+	_ = log.Open(log.Console, log.Debug, "", 0)
+
+	writer := failingWriter{fail: true, retry: true, t: t}
+	cache := NewActive(0, &writer)
+	if cache.disk == nil {
+		t.Fatalf("Expected disk buffer to be opened")
+	}
+	cache.Start()
+
+	value := "xyz"
+	for i := 0; i < 5; i++ {
+		cache.Write(&plugin.Result{Itemid: 1, Value: &value, Ts: time.Now()})
+	}
+
+	// results moved to disk must be uploaded by retries without new results or flush requests
+	cache.Flush()
+	time.Sleep(UploadRetryInterval / 2)
+	writer.mutex.Lock()
+	writer.fail = false
+	writer.mutex.Unlock()
+
+	var lastid uint64
+	for i := 0; i < 50 && lastid != 5; i++ {
+		time.Sleep(UploadRetryInterval / 10)
+		writer.mutex.Lock()
+		lastid = writer.lastid
+		writer.mutex.Unlock()
+	}
+	cache.Stop()
+
+	if lastid != 5 {
+		t.Fatalf("Expected 5 values to be uploaded by retries while got %d", lastid)
+	}
+}
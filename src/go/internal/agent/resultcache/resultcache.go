@@ -37,6 +37,13 @@
 // big problem because cache buffer is not static and will be extended as required.
 // The cache limit (BufferSize) is treated more like recommendation than hard limit.
 //
+// When PersistentBufferDir is set, results of active connections that could not be
+// uploaded are moved to the disk buffer. While the disk buffer is not empty all new
+// results are appended to it to keep the upload order and the disk buffer is uploaded
+// in large batches by a separate goroutine, so results are still accepted while the
+// backlog is being sent. Each ServerActive address has its own cache and disk buffer,
+// so the backlogs of different servers are uploaded independently.
+//
 package resultcache
 
 import (
@@ -57,6 +64,8 @@ import (
 
 const (
 	UploadRetryInterval = time.Second
+	// maximum number of values uploaded from disk buffer in one request
+	DiskUploadBatchSize = 10000
 )
 
 type ResultCache struct {
@@ -72,6 +81,14 @@ type ResultCache struct {
 	persistValueNum int32
 	retry           *time.Timer
 	timeout         int
+	disk            *diskBuffer
+	diskError       error
+	diskUpload      chan *diskUploadRequest
+}
+
+type diskUploadRequest struct {
+	output  Uploader
+	timeout int
 }
 
 type AgentData struct {
@@ -98,6 +115,14 @@ type AgentDataRequest struct {
 	Version string       `json:"version"`
 }
 
+type agentDataRawRequest struct {
+	Request string          `json:"request"`
+	Data    json.RawMessage `json:"data"`
+	Session string          `json:"session"`
+	Host    string          `json:"host"`
+	Version string          `json:"version"`
+}
+
 type Uploader interface {
 	Write(data []byte, timeout time.Duration) (err error)
 	Addr() (s string)
@@ -143,7 +168,16 @@ func (c *ResultCache) upload(u Uploader) (err error) {
 		c.lastError = nil
 	}
 
-	// clear results slice to ensure that the data is garbage collected
+	c.clearResults()
+	return
+}
+
+// clearResults clears results slice to ensure that the data is garbage collected
+func (c *ResultCache) clearResults() {
+	if len(c.results) == 0 {
+		return
+	}
+
 	c.results[0] = nil
 	for i := 1; i < len(c.results); i *= 2 {
 		copy(c.results[i:], c.results[:i])
@@ -152,16 +186,134 @@ func (c *ResultCache) upload(u Uploader) (err error) {
 
 	c.totalValueNum = 0
 	c.persistValueNum = 0
+}
+
+// moveToDisk moves cached results to the disk buffer, the results are kept in memory if
+// the disk buffer cannot accept them
+func (c *ResultCache) moveToDisk() (err error) {
+	if len(c.results) == 0 {
+		return
+	}
+
+	if err = c.disk.Write(c.results); err != nil {
+		if c.diskError == nil || err.Error() != c.diskError.Error() {
+			log.Warningf("[%d] cannot write %d value(s) to persistent buffer: %s", c.clientID,
+				len(c.results), err)
+			c.diskError = err
+		}
+		return
+	}
+	c.diskError = nil
+
+	log.Debugf("[%d] moved %d value(s) to persistent buffer", c.clientID, len(c.results))
+	c.clearResults()
 	return
 }
 
+// uploadDisk uploads disk buffer contents in batches until the buffer is empty or upload fails
+func (c *ResultCache) uploadDisk(r *diskUploadRequest, lastError error) error {
+	for !c.disk.Empty() {
+		data, num, pos, err := c.disk.Read(DiskUploadBatchSize)
+		if err != nil {
+			log.Errf("[%d] cannot read persistent buffer, discarding oldest segment: %s", c.clientID, err)
+			c.disk.Drop()
+			continue
+		}
+
+		if num == 0 {
+			_ = c.disk.Commit(pos)
+			continue
+		}
+
+		log.Debugf("[%d] upload %d value(s) from persistent buffer", c.clientID, num)
+
+		request := agentDataRawRequest{
+			Request: "agent data",
+			Data:    data,
+			Session: c.token,
+			Host:    agent.Options.Hostname,
+			Version: version.Short(),
+		}
+
+		var b []byte
+		if b, err = json.Marshal(&request); err != nil {
+			log.Errf("[%d] cannot convert persistent buffer data to json: %s", c.clientID, err.Error())
+			c.disk.Drop()
+			continue
+		}
+
+		timeout := num * r.timeout
+		if timeout > 60 {
+			timeout = 60
+		}
+		if err = r.output.Write(b, time.Duration(timeout)*time.Second); err != nil {
+			if lastError == nil || err.Error() != lastError.Error() {
+				log.Warningf("[%d] persistent buffer upload to [%s] started to fail: %s", c.clientID,
+					r.output.Addr(), err)
+			}
+			return err
+		}
+
+		if lastError != nil {
+			log.Warningf("[%d] persistent buffer upload to [%s] is working again", c.clientID,
+				r.output.Addr())
+			lastError = nil
+		}
+
+		if err = c.disk.Commit(pos); err != nil {
+			log.Warningf("[%d] cannot store persistent buffer upload position: %s", c.clientID, err)
+		}
+	}
+
+	return nil
+}
+
+// runDiskUpload uploads disk buffer when requested until the request channel is closed
+func (c *ResultCache) runDiskUpload() {
+	defer log.PanicHook()
+
+	var lastError error
+	for r := range c.diskUpload {
+		lastError = c.uploadDisk(r, lastError)
+	}
+
+	c.disk.Close()
+}
+
+func (c *ResultCache) requestDiskUpload(u Uploader) {
+	select {
+	case c.diskUpload <- &diskUploadRequest{output: u, timeout: c.timeout}:
+	default:
+		// upload is already in progress or requested
+	}
+}
+
 func (c *ResultCache) flushOutput(u Uploader) {
 	if c.retry != nil {
 		c.retry.Stop()
 		c.retry = nil
 	}
 
-	if c.upload(u) != nil && u.CanRetry() {
+	if c.disk != nil && !c.disk.Empty() {
+		// new results are queued behind the disk buffer backlog to keep the upload order,
+		// the backlog is flushed again until it is uploaded even if no new results arrive
+		_ = c.moveToDisk()
+		c.requestDiskUpload(u)
+		c.retryFlush(u)
+		return
+	}
+
+	if c.upload(u) != nil {
+		if c.disk != nil {
+			_ = c.moveToDisk()
+		}
+		c.retryFlush(u)
+	}
+}
+
+// retryFlush schedules the next flush of results or disk buffer that were not uploaded
+func (c *ResultCache) retryFlush(u Uploader) {
+	if u.CanRetry() {
 		c.retry = time.AfterFunc(UploadRetryInterval, func() { c.FlushOutput(u) })
 	}
 }
@@ -277,6 +429,11 @@ func (c *ResultCache) run() {
 			c.updateOptions(v)
 		}
 	}
+	if c.disk != nil {
+		// keep results not uploaded yet for the next agent run
+		_ = c.moveToDisk()
+		close(c.diskUpload)
+	}
 	log.Debugf("[%d] result cache has been stopped", c.clientID)
 	monitor.Unregister(monitor.Output)
 }
@@ -298,9 +455,27 @@ func (c *ResultCache) init() {
 	c.results = make([]*AgentData, 0, c.maxBufferSize)
 }
 
+func (c *ResultCache) initDisk(addr string) {
+	var err error
+	if c.disk, err = newDiskBuffer(agent.Options.PersistentBufferDir, addr,
+		int64(agent.Options.PersistentBufferSize)*1024*1024); err != nil {
+		log.Warningf("[%d] cannot open persistent buffer, results will be buffered in memory only: %s",
+			c.clientID, err)
+		c.disk = nil
+		return
+	}
+
+	// continue result ids after the ones left in disk buffer so they are not discarded by server
+	c.lastDataID = c.disk.LastID()
+	c.diskUpload = make(chan *diskUploadRequest, 1)
+}
+
 func (c *ResultCache) Start() {
 	// register with secondary group to stop result cache after other components are stopped
 	monitor.Register(monitor.Output)
+	if c.disk != nil {
+		go c.runDiskUpload()
+	}
 	go c.run()
 }
 
@@ -311,6 +486,9 @@ func (c *ResultCache) Stop() {
 func NewActive(clientid uint64, output Uploader) *ResultCache {
 	cache := &ResultCache{clientID: clientid, output: output, token: newToken()}
 	cache.init()
+	if output != nil && agent.Options.PersistentBufferDir != "" {
+		cache.initDisk(output.Addr())
+	}
 	return cache
 }
 
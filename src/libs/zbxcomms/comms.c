@@ -507,6 +507,65 @@ static int	zbx_socket_connect(zbx_socket_t *s, const struct sockaddr *addr, sock
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_socket_connect_nowait                                        *
+ *                                                                            *
+ * Purpose: switch socket to non-blocking mode and start connecting to the    *
+ *          specified address                                                 *
+ *                                                                            *
+ * Parameters: s       - [IN] socket descriptor                               *
+ *             addr    - [IN] the address                                     *
+ *             addrlen - [IN] the length of addr structure                    *
+ *             wait    - [OUT] ZBX_TCP_WAIT_WRITE if connection is in         *
+ *                             progress, 0 if connected                       *
+ *             error   - [OUT] the error message                              *
+ *                                                                            *
+ * Return value: SUCCEED - connected or connection is in progress             *
+ *               FAIL - an error occurred                                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_socket_connect_nowait(zbx_socket_t *s, const struct sockaddr *addr, socklen_t addrlen, int *wait,
+		char **error)
+{
+	int	err;
+#ifdef _WINDOWS
+	u_long	mode = 1;
+
+	if (0 != ioctlsocket(s->socket, FIONBIO, &mode))
+#else
+	int	flags;
+
+	if (-1 == (flags = fcntl(s->socket, F_GETFL, 0)) || -1 == fcntl(s->socket, F_SETFL, flags | O_NONBLOCK))
+#endif
+	{
+		*error = zbx_strdup(*error, strerror_from_system(zbx_socket_last_error()));
+		return FAIL;
+	}
+
+	*wait = 0;
+
+	if (ZBX_PROTO_ERROR == connect(s->socket, addr, addrlen))
+	{
+		err = zbx_socket_last_error();
+#ifdef _WINDOWS
+		if (WSAEWOULDBLOCK != err)
+#else
+		if (EINPROGRESS != err)
+#endif
+		{
+			*error = zbx_strdup(*error, strerror_from_system(err));
+			return FAIL;
+		}
+
+		*wait = ZBX_TCP_WAIT_WRITE;
+	}
+
+	s->connection_type = ZBX_TCP_SEC_UNENCRYPTED;
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_socket_create                                                *
@@ -523,7 +582,7 @@ static int	zbx_socket_connect(zbx_socket_t *s, const struct sockaddr *addr, sock
  ******************************************************************************/
 #ifdef HAVE_IPV6
 static int	zbx_socket_create(zbx_socket_t *s, int type, const char *source_ip, const char *ip, unsigned short port,
-		int timeout, unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2)
+		int timeout, unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2, int *wait)
 {
 	int		ret = FAIL;
 	struct addrinfo	*ai = NULL, hints;
@@ -597,7 +656,8 @@ static int	zbx_socket_create(zbx_socket_t *s, int type, const char *source_ip, c
 		}
 	}
 
-	if (SUCCEED != zbx_socket_connect(s, ai->ai_addr, (socklen_t)ai->ai_addrlen, timeout, &error))
+	if (SUCCEED != (NULL == wait ? zbx_socket_connect(s, ai->ai_addr, (socklen_t)ai->ai_addrlen, timeout, &error) :
+			zbx_socket_connect_nowait(s, ai->ai_addr, (socklen_t)ai->ai_addrlen, wait, &error)))
 	{
 		func_socket_close(s);
 		zbx_set_socket_strerror("cannot connect to [[%s]:%hu]: %s", ip, port, error);
@@ -606,7 +666,8 @@ static int	zbx_socket_create(zbx_socket_t *s, int type, const char *source_ip, c
 	}
 
 #if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
-	if ((ZBX_TCP_SEC_TLS_CERT == tls_connect || ZBX_TCP_SEC_TLS_PSK == tls_connect) &&
+	/* non-blocking connection starts TLS handshake in zbx_tcp_connect_continue() */
+	if (NULL == wait && (ZBX_TCP_SEC_TLS_CERT == tls_connect || ZBX_TCP_SEC_TLS_PSK == tls_connect) &&
 			SUCCEED != zbx_tls_connect(s, tls_connect, tls_arg1, tls_arg2, &error))
 	{
 		zbx_tcp_close(s);
@@ -632,7 +693,7 @@ out:
 }
 #else
 static int	zbx_socket_create(zbx_socket_t *s, int type, const char *source_ip, const char *ip, unsigned short port,
-		int timeout, unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2)
+		int timeout, unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2, int *wait)
 {
 	ZBX_SOCKADDR	servaddr_in;
 	struct hostent	*hp;
@@ -710,7 +771,9 @@ static int	zbx_socket_create(zbx_socket_t *s, int type, const char *source_ip, c
 		}
 	}
 
-	if (SUCCEED != zbx_socket_connect(s, (struct sockaddr *)&servaddr_in, sizeof(servaddr_in), timeout, &error))
+	if (SUCCEED != (NULL == wait ? zbx_socket_connect(s, (struct sockaddr *)&servaddr_in, sizeof(servaddr_in),
+			timeout, &error) : zbx_socket_connect_nowait(s, (struct sockaddr *)&servaddr_in,
+			sizeof(servaddr_in), wait, &error)))
 	{
 		func_socket_close(s);
 		zbx_set_socket_strerror("cannot connect to [[%s]:%hu]: %s", ip, port, error);
@@ -719,7 +782,8 @@ static int	zbx_socket_create(zbx_socket_t *s, int type, const char *source_ip, c
 	}
 
 #if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
-	if ((ZBX_TCP_SEC_TLS_CERT == tls_connect || ZBX_TCP_SEC_TLS_PSK == tls_connect) &&
+	/* non-blocking connection starts TLS handshake in zbx_tcp_connect_continue() */
+	if (NULL == wait && (ZBX_TCP_SEC_TLS_CERT == tls_connect || ZBX_TCP_SEC_TLS_PSK == tls_connect) &&
 			SUCCEED != zbx_tls_connect(s, tls_connect, tls_arg1, tls_arg2, &error))
 	{
 		zbx_tcp_close(s);
@@ -747,10 +811,143 @@ int	zbx_tcp_connect(zbx_socket_t *s, const char *source_ip, const char *ip, unsi
 		return FAIL;
 	}
 
-	return zbx_socket_create(s, SOCK_STREAM, source_ip, ip, port, timeout, tls_connect, tls_arg1, tls_arg2);
+	return zbx_socket_create(s, SOCK_STREAM, source_ip, ip, port, timeout, tls_connect, tls_arg1, tls_arg2, NULL);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tcp_connect_nowait                                           *
+ *                                                                            *
+ * Purpose: start connecting to the specified address without waiting for     *
+ *          the connection to be established                                  *
+ *                                                                            *
+ * Parameters: s           - [OUT] the non-blocking socket                    *
+ *             source_ip   - [IN] the source address (optional)               *
+ *             ip          - [IN] the address to connect to                   *
+ *             port        - [IN] the port to connect to                      *
+ *             tls_connect - [IN] how to connect, see zbx_tcp_connect()       *
+ *             tls_arg1    - [IN] see zbx_tcp_connect()                       *
+ *             tls_arg2    - [IN] see zbx_tcp_connect()                       *
+ *             wait        - [OUT] socket events to wait for before calling   *
+ *                                 zbx_tcp_connect_continue() or 0 if the     *
+ *                                 connection is established                  *
+ *                                                                            *
+ * Return value: SUCCEED - the connection is established or in progress       *
+ *               FAIL - an error occurred, the socket is closed               *
+ *                                                                            *
+ * Comments: Host name resolution is still blocking.                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_tcp_connect_nowait(zbx_socket_t *s, const char *source_ip, const char *ip, unsigned short port,
+		unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2, int *wait)
+{
+	if (ZBX_TCP_SEC_UNENCRYPTED != tls_connect && ZBX_TCP_SEC_TLS_CERT != tls_connect &&
+			ZBX_TCP_SEC_TLS_PSK != tls_connect)
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		return FAIL;
+	}
+
+	if (SUCCEED != zbx_socket_create(s, SOCK_STREAM, source_ip, ip, port, 0, tls_connect, tls_arg1, tls_arg2,
+			wait))
+	{
+		return FAIL;
+	}
+
+	if (0 != *wait || ZBX_TCP_SEC_UNENCRYPTED == tls_connect)
+		return SUCCEED;
+
+	return zbx_tcp_connect_continue(s, tls_connect, tls_arg1, tls_arg2, wait);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tcp_connect_continue                                         *
+ *                                                                            *
+ * Purpose: continue establishing connection started by                       *
+ *          zbx_tcp_connect_nowait() when socket is ready                     *
+ *                                                                            *
+ * Parameters: s           - [IN] the non-blocking socket                     *
+ *             tls_connect - [IN] the same as for zbx_tcp_connect_nowait()    *
+ *             tls_arg1    - [IN] the same as for zbx_tcp_connect_nowait()    *
+ *             tls_arg2    - [IN] the same as for zbx_tcp_connect_nowait()    *
+ *             wait        - [OUT] socket events to wait for before calling   *
+ *                                 this function again or 0 if the            *
+ *                                 connection is established                  *
+ *                                                                            *
+ * Return value: SUCCEED - the connection is established or in progress       *
+ *               FAIL - an error occurred, the socket is closed               *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_tcp_connect_continue(zbx_socket_t *s, unsigned int tls_connect, const char *tls_arg1,
+		const char *tls_arg2, int *wait)
+{
+#if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+	char	*error = NULL;
+#endif
+	*wait = 0;
+
+#if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+	/* TLS context exists only after TCP connection is established */
+	if (NULL == s->tls_ctx)
+#endif
+	{
+		int		socket_error = 0;
+		ZBX_SOCKLEN_T	socket_error_len = sizeof(socket_error);
+
+		if (ZBX_PROTO_ERROR == getsockopt(s->socket, SOL_SOCKET, SO_ERROR, (char *)&socket_error,
+				&socket_error_len))
+		{
+			socket_error = zbx_socket_last_error();
+		}
+
+		if (0 != socket_error)
+		{
+#ifdef _WINDOWS
+			zbx_set_socket_strerror("cannot connect to [%s]: %s", s->peer,
+					strerror_from_system(socket_error));
+#else
+			zbx_set_socket_strerror("cannot connect to [%s]: %s", s->peer, zbx_strerror(socket_error));
+#endif
+			zbx_tcp_close(s);
+			return FAIL;
+		}
+	}
+
+#if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+	if ((ZBX_TCP_SEC_TLS_CERT == tls_connect || ZBX_TCP_SEC_TLS_PSK == tls_connect) &&
+			SUCCEED != zbx_tls_connect_nowait(s, tls_connect, tls_arg1, tls_arg2, wait, &error))
+	{
+		zbx_tcp_close(s);
+		zbx_set_socket_strerror("TCP successful, cannot establish TLS to [%s]: %s", s->peer, error);
+		zbx_free(error);
+		return FAIL;
+	}
+#else
+	ZBX_UNUSED(tls_connect);
+	ZBX_UNUSED(tls_arg1);
+	ZBX_UNUSED(tls_arg2);
+#endif
+	return SUCCEED;
 }
 
-static ssize_t	zbx_tcp_write(zbx_socket_t *s, const char *buf, size_t len)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tcp_write                                                    *
+ *                                                                            *
+ * Purpose: write data to socket                                              *
+ *                                                                            *
+ * Parameters: s    - [IN] the socket                                         *
+ *             buf  - [IN] the data to write                                  *
+ *             len  - [IN] the data length                                    *
+ *             wait - [OUT] socket events to wait for if non-blocking socket  *
+ *                          is not ready, NULL for blocking socket            *
+ *                                                                            *
+ * Return value: number of bytes written or ZBX_PROTO_ERROR if an error       *
+ *               occurred or the socket is not ready ('wait' is set)          *
+ *                                                                            *
+ ******************************************************************************/
+static ssize_t	zbx_tcp_write(zbx_socket_t *s, const char *buf, size_t len, int *wait)
 {
 	ssize_t	res;
 	int	err;
@@ -763,7 +960,7 @@ static ssize_t	zbx_tcp_write(zbx_socket_t *s, const char *buf, size_t len)
 #if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
 	if (NULL != s->tls_ctx)	/* TLS connection */
 	{
-		if (ZBX_PROTO_ERROR == (res = zbx_tls_write(s, buf, len, &error)))
+		if (ZBX_PROTO_ERROR == (res = zbx_tls_write(s, buf, len, wait, &error)) && NULL != error)
 		{
 			zbx_set_socket_strerror("%s", error);
 			zbx_free(error);
@@ -792,11 +989,60 @@ static ssize_t	zbx_tcp_write(zbx_socket_t *s, const char *buf, size_t len)
 	while (ZBX_PROTO_ERROR == res && ZBX_PROTO_AGAIN == (err = zbx_socket_last_error()));
 
 	if (ZBX_PROTO_ERROR == res)
-		zbx_set_socket_strerror("ZBX_TCP_WRITE() failed: %s", strerror_from_system(err));
+	{
+		if (NULL != wait && ZBX_PROTO_WOULDBLOCK(err))
+			*wait = ZBX_TCP_WAIT_WRITE;
+		else
+			zbx_set_socket_strerror("ZBX_TCP_WRITE() failed: %s", strerror_from_system(err));
+	}
 
 	return res;
 }
 
+#define ZBX_TCP_HEADER_DATA	"ZBXD"
+#define ZBX_TCP_HEADER_LEN	ZBX_CONST_STRLEN(ZBX_TCP_HEADER_DATA)
+/* header, protocol flags, data length and reserved field */
+#define ZBX_TCP_HEADER_SIZE	(ZBX_TCP_HEADER_LEN + 1 + 2 * sizeof(zbx_uint32_t))
+
+#define ZBX_TLS_MAX_REC_LEN	16384
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tcp_header_write                                             *
+ *                                                                            *
+ * Purpose: write Zabbix protocol header into buffer                          *
+ *                                                                            *
+ * Parameters: buf      - [OUT] the buffer of at least ZBX_TCP_HEADER_SIZE    *
+ *                              bytes                                         *
+ *             flags    - [IN] the protocol flags                             *
+ *             send_len - [IN] the length of data to be sent                  *
+ *             reserved - [IN] the uncompressed data length for compressed    *
+ *                             data, 0 otherwise                              *
+ *                                                                            *
+ * Return value: the header length                                            *
+ *                                                                            *
+ ******************************************************************************/
+static size_t	zbx_tcp_header_write(char *buf, unsigned char flags, size_t send_len, size_t reserved)
+{
+	size_t		offset;
+	zbx_uint32_t	len32_le;
+
+	memcpy(buf, ZBX_TCP_HEADER_DATA, ZBX_CONST_STRLEN(ZBX_TCP_HEADER_DATA));
+	offset = ZBX_CONST_STRLEN(ZBX_TCP_HEADER_DATA);
+
+	buf[offset++] = flags;
+
+	len32_le = zbx_htole_uint32((zbx_uint32_t)send_len);
+	memcpy(buf + offset, &len32_le, sizeof(len32_le));
+	offset += sizeof(len32_le);
+
+	len32_le = zbx_htole_uint32((zbx_uint32_t)reserved);
+	memcpy(buf + offset, &len32_le, sizeof(len32_le));
+	offset += sizeof(len32_le);
+
+	return offset;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_tcp_send_ext                                                 *
@@ -819,19 +1065,12 @@ static ssize_t	zbx_tcp_write(zbx_socket_t *s, const char *buf, size_t len)
  *     unencrypted messages.                                                  *
  *                                                                            *
  ******************************************************************************/
-
-#define ZBX_TCP_HEADER_DATA	"ZBXD"
-#define ZBX_TCP_HEADER_LEN	ZBX_CONST_STRLEN(ZBX_TCP_HEADER_DATA)
-
 int	zbx_tcp_send_ext(zbx_socket_t *s, const char *data, size_t len, unsigned char flags, int timeout)
 {
-#define ZBX_TLS_MAX_REC_LEN	16384
-
 	ssize_t		bytes_sent, written = 0;
 	size_t		send_bytes, offset, send_len = len, reserved = 0;
 	int		ret = SUCCEED;
 	char		*compressed_data = NULL;
-	zbx_uint32_t	len32_le;
 
 	if (0 != timeout)
 		zbx_socket_timeout_set(s, timeout);
@@ -856,18 +1095,7 @@ int	zbx_tcp_send_ext(zbx_socket_t *s, const char *data, size_t len, unsigned cha
 			reserved = len;
 		}
 
-		memcpy(header_buf, ZBX_TCP_HEADER_DATA, ZBX_CONST_STRLEN(ZBX_TCP_HEADER_DATA));
-		offset = ZBX_CONST_STRLEN(ZBX_TCP_HEADER_DATA);
-
-		header_buf[offset++] = flags;
-
-		len32_le = zbx_htole_uint32((zbx_uint32_t)send_len);
-		memcpy(header_buf + offset, &len32_le, sizeof(len32_le));
-		offset += sizeof(len32_le);
-
-		len32_le = zbx_htole_uint32((zbx_uint32_t)reserved);
-		memcpy(header_buf + offset, &len32_le, sizeof(len32_le));
-		offset += sizeof(len32_le);
+		offset = zbx_tcp_header_write(header_buf, flags, send_len, reserved);
 
 		take_bytes = MIN(send_len, ZBX_TLS_MAX_REC_LEN - offset);
 		memcpy(header_buf + offset, data, take_bytes);
@@ -877,7 +1105,7 @@ int	zbx_tcp_send_ext(zbx_socket_t *s, const char *data, size_t len, unsigned cha
 		while (written < (ssize_t)send_bytes)
 		{
 			if (ZBX_PROTO_ERROR == (bytes_sent = zbx_tcp_write(s, header_buf + written,
-					send_bytes - (size_t)written)))
+					send_bytes - (size_t)written, NULL)))
 			{
 				ret = FAIL;
 				goto cleanup;
@@ -895,7 +1123,7 @@ int	zbx_tcp_send_ext(zbx_socket_t *s, const char *data, size_t len, unsigned cha
 		else
 			send_bytes = MIN(ZBX_TLS_MAX_REC_LEN, send_len - (size_t)written);
 
-		if (ZBX_PROTO_ERROR == (bytes_sent = zbx_tcp_write(s, data + written, send_bytes)))
+		if (ZBX_PROTO_ERROR == (bytes_sent = zbx_tcp_write(s, data + written, send_bytes, NULL)))
 		{
 			ret = FAIL;
 			goto cleanup;
@@ -909,8 +1137,108 @@ cleanup:
 		zbx_socket_timeout_cleanup(s);
 
 	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tcp_send_context_init                                        *
+ *                                                                            *
+ * Purpose: prepare message to be sent over non-blocking socket               *
+ *                                                                            *
+ * Parameters: context - [OUT] the send context                               *
+ *             data    - [IN] the data to send                                *
+ *             len     - [IN] the data length                                 *
+ *             flags   - [IN] the protocol flags, see zbx_tcp_send_ext()      *
+ *                                                                            *
+ * Return value: SUCCEED - the message is prepared                            *
+ *               FAIL - an error occurred                                     *
+ *                                                                            *
+ * Comments: The whole message with protocol header is copied into the        *
+ *           context, it must be released with zbx_tcp_send_context_clear().  *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_tcp_send_context_init(zbx_tcp_send_context_t *context, const char *data, size_t len, unsigned char flags)
+{
+	size_t	send_len = len, offset = 0;
+	char	*compressed_data = NULL;
+
+	if (0 != (flags & ZBX_TCP_PROTOCOL) && 0 != (flags & ZBX_TCP_COMPRESS))
+	{
+		if (SUCCEED != zbx_compress(data, len, &compressed_data, &send_len))
+		{
+			zbx_set_socket_strerror("cannot compress data: %s", zbx_compress_strerror());
+			return FAIL;
+		}
+
+		data = compressed_data;
+	}
+
+	context->data = (char *)zbx_malloc(NULL, ZBX_TCP_HEADER_SIZE + send_len);
+
+	if (0 != (flags & ZBX_TCP_PROTOCOL))
+		offset = zbx_tcp_header_write(context->data, flags, send_len, NULL != compressed_data ? len : 0);
+
+	memcpy(context->data + offset, data, send_len);
+	context->size = offset + send_len;
+	context->offset = 0;
+
+	zbx_free(compressed_data);
+
+	return SUCCEED;
+}
 
-#undef ZBX_TLS_MAX_REC_LEN
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tcp_send_context                                             *
+ *                                                                            *
+ * Purpose: send prepared message over non-blocking socket                    *
+ *                                                                            *
+ * Parameters: s       - [IN] the non-blocking socket                         *
+ *             context - [IN/OUT] the send context                            *
+ *             wait    - [OUT] socket events to wait for before calling this  *
+ *                             function again or 0 if the message is sent     *
+ *                                                                            *
+ * Return value: SUCCEED - the message is sent or sending is in progress      *
+ *               FAIL - an error occurred                                     *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_tcp_send_context(zbx_socket_t *s, zbx_tcp_send_context_t *context, int *wait)
+{
+	ssize_t	bytes_sent;
+	size_t	send_bytes;
+
+	*wait = 0;
+
+	while (context->offset < context->size)
+	{
+		/* the same data must be passed again after TLS write was interrupted, keep chunks aligned */
+		send_bytes = context->size - context->offset;
+
+		if (ZBX_TCP_SEC_UNENCRYPTED != s->connection_type)
+			send_bytes = MIN(ZBX_TLS_MAX_REC_LEN, send_bytes);
+
+		if (ZBX_PROTO_ERROR == (bytes_sent = zbx_tcp_write(s, context->data + context->offset, send_bytes,
+				wait)))
+		{
+			return 0 != *wait ? SUCCEED : FAIL;
+		}
+
+		context->offset += (size_t)bytes_sent;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tcp_send_context_clear                                       *
+ *                                                                            *
+ * Purpose: release message prepared by zbx_tcp_send_context_init()           *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_tcp_send_context_clear(zbx_tcp_send_context_t *context)
+{
+	zbx_free(context->data);
 }
 
 /******************************************************************************
@@ -1493,6 +1821,50 @@ void	zbx_tcp_unaccept(zbx_socket_t *s)
 	s->accepted = 0;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tcp_accept_nowait                                            *
+ *                                                                            *
+ * Purpose: accept pending connection without reading from it                 *
+ *                                                                            *
+ * Parameters: listen_socket - [IN] the listening socket with pending         *
+ *                                  connection                                *
+ *             s             - [OUT] the accepted connection                  *
+ *                                                                            *
+ * Return value: SUCCEED - the connection was accepted                        *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: Unlike zbx_tcp_accept() the function does not wait for data, so  *
+ *           event driven listeners can check the peer before reading. Only   *
+ *           unencrypted connections are supported. The accepted connection   *
+ *           must be closed with zbx_tcp_close().                             *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_tcp_accept_nowait(ZBX_SOCKET listen_socket, zbx_socket_t *s)
+{
+	ZBX_SOCKADDR	serv_addr;
+	ZBX_SOCKLEN_T	nlen = sizeof(serv_addr);
+
+	zbx_socket_clean(s);
+
+	if (ZBX_SOCKET_ERROR == (s->socket = (ZBX_SOCKET)accept(listen_socket, (struct sockaddr *)&serv_addr,
+			&nlen)))
+	{
+		zbx_set_socket_strerror("accept() failed: %s", strerror_from_system(zbx_socket_last_error()));
+		return FAIL;
+	}
+
+	if (SUCCEED != zbx_socket_peer_ip_save(s))
+	{
+		zbx_tcp_close(s);
+		return FAIL;
+	}
+
+	s->connection_type = ZBX_TCP_SEC_UNENCRYPTED;
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_socket_find_line                                             *
@@ -1654,7 +2026,23 @@ out:
 	return line;
 }
 
-static ssize_t	zbx_tcp_read(zbx_socket_t *s, char *buf, size_t len)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tcp_read                                                     *
+ *                                                                            *
+ * Purpose: read data from socket                                             *
+ *                                                                            *
+ * Parameters: s    - [IN] the socket                                         *
+ *             buf  - [OUT] the buffer to read into                           *
+ *             len  - [IN] the buffer size                                    *
+ *             wait - [OUT] socket events to wait for if non-blocking socket  *
+ *                          is not ready, NULL for blocking socket            *
+ *                                                                            *
+ * Return value: number of bytes read or ZBX_PROTO_ERROR if an error occurred *
+ *               or the socket is not ready ('wait' is set)                   *
+ *                                                                            *
+ ******************************************************************************/
+static ssize_t	zbx_tcp_read(zbx_socket_t *s, char *buf, size_t len, int *wait)
 {
 	ssize_t	res;
 	int	err;
@@ -1666,7 +2054,7 @@ static ssize_t	zbx_tcp_read(zbx_socket_t *s, char *buf, size_t len)
 	{
 		char	*error = NULL;
 
-		if (ZBX_PROTO_ERROR == (res = zbx_tls_read(s, buf, len, &error)))
+		if (ZBX_PROTO_ERROR == (res = zbx_tls_read(s, buf, len, wait, &error)) && NULL != error)
 		{
 			zbx_set_socket_strerror("%s", error);
 			zbx_free(error);
@@ -1695,67 +2083,102 @@ static ssize_t	zbx_tcp_read(zbx_socket_t *s, char *buf, size_t len)
 	while (ZBX_PROTO_ERROR == res && ZBX_PROTO_AGAIN == (err = zbx_socket_last_error()));
 
 	if (ZBX_PROTO_ERROR == res)
-		zbx_set_socket_strerror("ZBX_TCP_READ() failed: %s", strerror_from_system(err));
+	{
+		if (NULL != wait && ZBX_PROTO_WOULDBLOCK(err))
+			*wait = ZBX_TCP_WAIT_READ;
+		else
+			zbx_set_socket_strerror("ZBX_TCP_READ() failed: %s", strerror_from_system(err));
+	}
 
 	return res;
 }
 
+#define ZBX_TCP_EXPECT_HEADER		1
+#define ZBX_TCP_EXPECT_VERSION		2
+#define ZBX_TCP_EXPECT_VERSION_VALIDATE	3
+#define ZBX_TCP_EXPECT_LENGTH		4
+#define ZBX_TCP_EXPECT_SIZE		5
+
 /******************************************************************************
  *                                                                            *
- * Function: zbx_tcp_recv_ext                                                 *
- *                                                                            *
- * Purpose: receive data                                                      *
+ * Function: zbx_tcp_recv_context_init                                        *
  *                                                                            *
- * Return value: number of bytes received - success,                          *
- *               FAIL - an error occurred                                     *
+ * Purpose: prepare socket to receive a message                               *
  *                                                                            *
- * Author: Eugene Grigorjev                                                   *
+ * Parameters: s       - [IN] the socket                                      *
+ *             context - [OUT] the receive context                            *
  *                                                                            *
  ******************************************************************************/
-ssize_t	zbx_tcp_recv_ext(zbx_socket_t *s, int timeout)
+void	zbx_tcp_recv_context_init(zbx_socket_t *s, zbx_tcp_recv_context_t *context)
 {
-#define ZBX_TCP_EXPECT_HEADER		1
-#define ZBX_TCP_EXPECT_VERSION		2
-#define ZBX_TCP_EXPECT_VERSION_VALIDATE	3
-#define ZBX_TCP_EXPECT_LENGTH		4
-#define ZBX_TCP_EXPECT_SIZE		5
-
-	ssize_t		nbytes;
-	size_t		buf_dyn_bytes = 0, buf_stat_bytes = 0, offset = 0;
-	zbx_uint32_t	expected_len = 16 * ZBX_MEBIBYTE, reserved = 0;
-	unsigned char	expect = ZBX_TCP_EXPECT_HEADER;
-	int		protocol_version;
-
-	if (0 != timeout)
-		zbx_socket_timeout_set(s, timeout);
+	context->buf_dyn_bytes = 0;
+	context->buf_stat_bytes = 0;
+	context->offset = 0;
+	context->expected_len = 16 * ZBX_MEBIBYTE;
+	context->reserved = 0;
+	context->protocol_version = 0;
+	context->expect = ZBX_TCP_EXPECT_HEADER;
 
 	zbx_socket_free(s);
 
 	s->buf_type = ZBX_BUF_TYPE_STAT;
 	s->buffer = s->buf_stat;
+}
 
-	while (0 != (nbytes = zbx_tcp_read(s, s->buf_stat + buf_stat_bytes, sizeof(s->buf_stat) - buf_stat_bytes)))
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tcp_recv_context                                             *
+ *                                                                            *
+ * Purpose: receive message                                                   *
+ *                                                                            *
+ * Parameters: s       - [IN] the socket                                      *
+ *             context - [IN/OUT] the receive context                         *
+ *             wait    - [OUT] for non-blocking socket - socket events to     *
+ *                             wait for before calling this function again    *
+ *                             or 0 if the message is received, NULL for      *
+ *                             blocking socket                                *
+ *                                                                            *
+ * Return value: number of bytes received - success,                          *
+ *               FAIL - an error occurred                                     *
+ *                                                                            *
+ * Comments: The return value must be ignored when 'wait' is set.             *
+ *                                                                            *
+ ******************************************************************************/
+ssize_t	zbx_tcp_recv_context(zbx_socket_t *s, zbx_tcp_recv_context_t *context, int *wait)
+{
+	ssize_t	nbytes;
+
+	if (NULL != wait)
+		*wait = 0;
+
+	while (0 != (nbytes = zbx_tcp_read(s, s->buf_stat + context->buf_stat_bytes,
+			sizeof(s->buf_stat) - context->buf_stat_bytes, wait)))
 	{
 		if (ZBX_PROTO_ERROR == nbytes)
+		{
+			if (NULL != wait && 0 != *wait)
+				return 0;
+
 			goto out;
+		}
 
 		if (ZBX_BUF_TYPE_STAT == s->buf_type)
-			buf_stat_bytes += nbytes;
+			context->buf_stat_bytes += nbytes;
 		else
 		{
-			if (buf_dyn_bytes + nbytes <= expected_len)
-				memcpy(s->buffer + buf_dyn_bytes, s->buf_stat, nbytes);
-			buf_dyn_bytes += nbytes;
+			if (context->buf_dyn_bytes + nbytes <= context->expected_len)
+				memcpy(s->buffer + context->buf_dyn_bytes, s->buf_stat, nbytes);
+			context->buf_dyn_bytes += nbytes;
 		}
 
-		if (buf_stat_bytes + buf_dyn_bytes >= expected_len)
+		if (context->buf_stat_bytes + context->buf_dyn_bytes >= context->expected_len)
 			break;
 
-		if (ZBX_TCP_EXPECT_HEADER == expect)
+		if (ZBX_TCP_EXPECT_HEADER == context->expect)
 		{
-			if (ZBX_TCP_HEADER_LEN > buf_stat_bytes)
+			if (ZBX_TCP_HEADER_LEN > context->buf_stat_bytes)
 			{
-				if (0 == strncmp(s->buf_stat, ZBX_TCP_HEADER_DATA, buf_stat_bytes))
+				if (0 == strncmp(s->buf_stat, ZBX_TCP_HEADER_DATA, context->buf_stat_bytes))
 					continue;
 
 				break;
@@ -1768,96 +2191,98 @@ ssize_t	zbx_tcp_recv_ext(zbx_socket_t *s, int timeout)
 					break;
 				}
 
-				expect = ZBX_TCP_EXPECT_VERSION;
-				offset += ZBX_TCP_HEADER_LEN;
+				context->expect = ZBX_TCP_EXPECT_VERSION;
+				context->offset += ZBX_TCP_HEADER_LEN;
 			}
 		}
 
-		if (ZBX_TCP_EXPECT_VERSION == expect)
+		if (ZBX_TCP_EXPECT_VERSION == context->expect)
 		{
-			if (offset + 1 > buf_stat_bytes)
+			if (context->offset + 1 > context->buf_stat_bytes)
 				continue;
 
-			expect = ZBX_TCP_EXPECT_VERSION_VALIDATE;
-			protocol_version = s->buf_stat[ZBX_TCP_HEADER_LEN];
+			context->expect = ZBX_TCP_EXPECT_VERSION_VALIDATE;
+			context->protocol_version = s->buf_stat[ZBX_TCP_HEADER_LEN];
 
-			if (0 == (protocol_version & ZBX_TCP_PROTOCOL) ||
-					protocol_version > (ZBX_TCP_PROTOCOL | ZBX_TCP_COMPRESS))
+			if (0 == (context->protocol_version & ZBX_TCP_PROTOCOL) ||
+					context->protocol_version > (ZBX_TCP_PROTOCOL | ZBX_TCP_COMPRESS))
 			{
 				/* invalid protocol version, abort receiving */
 				break;
 			}
-			s->protocol = protocol_version;
-			expect = ZBX_TCP_EXPECT_LENGTH;
-			offset++;
+			s->protocol = context->protocol_version;
+			context->expect = ZBX_TCP_EXPECT_LENGTH;
+			context->offset++;
 		}
 
-		if (ZBX_TCP_EXPECT_LENGTH == expect)
+		if (ZBX_TCP_EXPECT_LENGTH == context->expect)
 		{
-			if (offset + 2 * sizeof(zbx_uint32_t) > buf_stat_bytes)
+			if (context->offset + 2 * sizeof(zbx_uint32_t) > context->buf_stat_bytes)
 				continue;
 
-			memcpy(&expected_len, s->buf_stat + offset, sizeof(zbx_uint32_t));
-			offset += sizeof(zbx_uint32_t);
-			expected_len = zbx_letoh_uint32(expected_len);
+			memcpy(&context->expected_len, s->buf_stat + context->offset, sizeof(zbx_uint32_t));
+			context->offset += sizeof(zbx_uint32_t);
+			context->expected_len = zbx_letoh_uint32(context->expected_len);
 
-			memcpy(&reserved, s->buf_stat + offset, sizeof(zbx_uint32_t));
-			offset += sizeof(zbx_uint32_t);
-			reserved = zbx_letoh_uint32(reserved);
+			memcpy(&context->reserved, s->buf_stat + context->offset, sizeof(zbx_uint32_t));
+			context->offset += sizeof(zbx_uint32_t);
+			context->reserved = zbx_letoh_uint32(context->reserved);
 
-			if (ZBX_MAX_RECV_DATA_SIZE < expected_len)
+			if (ZBX_MAX_RECV_DATA_SIZE < context->expected_len)
 			{
 				zabbix_log(LOG_LEVEL_WARNING, "Message size " ZBX_FS_UI64 " from %s exceeds the "
 						"maximum size " ZBX_FS_UI64 " bytes. Message ignored.",
-						(zbx_uint64_t)expected_len, s->peer,
+						(zbx_uint64_t)context->expected_len, s->peer,
 						(zbx_uint64_t)ZBX_MAX_RECV_DATA_SIZE);
 				nbytes = ZBX_PROTO_ERROR;
 				goto out;
 			}
 
 			/* compressed protocol stores uncompressed packet size in the reserved data */
-			if (0 != (protocol_version & ZBX_TCP_COMPRESS) && ZBX_MAX_RECV_DATA_SIZE < reserved)
+			if (0 != (context->protocol_version & ZBX_TCP_COMPRESS) &&
+					ZBX_MAX_RECV_DATA_SIZE < context->reserved)
 			{
 				zabbix_log(LOG_LEVEL_WARNING, "Uncompressed message size " ZBX_FS_UI64
 						" from %s exceeds the maximum size " ZBX_FS_UI64
-						" bytes. Message ignored.", (zbx_uint64_t)reserved, s->peer,
+						" bytes. Message ignored.", (zbx_uint64_t)context->reserved, s->peer,
 						(zbx_uint64_t)ZBX_MAX_RECV_DATA_SIZE);
 				nbytes = ZBX_PROTO_ERROR;
 				goto out;
 			}
 
-			if (sizeof(s->buf_stat) > expected_len)
+			if (sizeof(s->buf_stat) > context->expected_len)
 			{
-				buf_stat_bytes -= offset;
-				memmove(s->buf_stat, s->buf_stat + offset, buf_stat_bytes);
+				context->buf_stat_bytes -= context->offset;
+				memmove(s->buf_stat, s->buf_stat + context->offset, context->buf_stat_bytes);
 			}
 			else
 			{
 				s->buf_type = ZBX_BUF_TYPE_DYN;
-				s->buffer = (char *)zbx_malloc(NULL, expected_len + 1);
-				buf_dyn_bytes = buf_stat_bytes - offset;
-				buf_stat_bytes = 0;
-				memcpy(s->buffer, s->buf_stat + offset, buf_dyn_bytes);
+				s->buffer = (char *)zbx_malloc(NULL, context->expected_len + 1);
+				context->buf_dyn_bytes = context->buf_stat_bytes - context->offset;
+				context->buf_stat_bytes = 0;
+				memcpy(s->buffer, s->buf_stat + context->offset, context->buf_dyn_bytes);
 			}
 
-			expect = ZBX_TCP_EXPECT_SIZE;
+			context->expect = ZBX_TCP_EXPECT_SIZE;
 
-			if (buf_stat_bytes + buf_dyn_bytes >= expected_len)
+			if (context->buf_stat_bytes + context->buf_dyn_bytes >= context->expected_len)
 				break;
 		}
 	}
 
-	if (ZBX_TCP_EXPECT_SIZE == expect)
+	if (ZBX_TCP_EXPECT_SIZE == context->expect)
 	{
-		if (buf_stat_bytes + buf_dyn_bytes == expected_len)
+		if (context->buf_stat_bytes + context->buf_dyn_bytes == context->expected_len)
 		{
-			if (0 != (protocol_version & ZBX_TCP_COMPRESS))
+			if (0 != (context->protocol_version & ZBX_TCP_COMPRESS))
 			{
 				char	*out;
-				size_t	out_size = reserved;
+				size_t	out_size = context->reserved;
 
-				out = (char *)zbx_malloc(NULL, reserved + 1);
-				if (FAIL == zbx_uncompress(s->buffer, buf_stat_bytes + buf_dyn_bytes, out, &out_size))
+				out = (char *)zbx_malloc(NULL, context->reserved + 1);
+				if (FAIL == zbx_uncompress(s->buffer, context->buf_stat_bytes + context->buf_dyn_bytes,
+						out, &out_size))
 				{
 					zbx_free(out);
 					zbx_set_socket_strerror("cannot uncompress data: %s", zbx_compress_strerror());
@@ -1865,7 +2290,7 @@ ssize_t	zbx_tcp_recv_ext(zbx_socket_t *s, int timeout)
 					goto out;
 				}
 
-				if (out_size != reserved)
+				if (out_size != context->reserved)
 				{
 					zbx_free(out);
 					zbx_set_socket_strerror("size of uncompressed data is less than expected");
@@ -1878,52 +2303,55 @@ ssize_t	zbx_tcp_recv_ext(zbx_socket_t *s, int timeout)
 
 				s->buf_type = ZBX_BUF_TYPE_DYN;
 				s->buffer = out;
-				s->read_bytes = reserved;
+				s->read_bytes = context->reserved;
 
 				zabbix_log(LOG_LEVEL_TRACE, "%s(): received " ZBX_FS_SIZE_T " bytes with"
 						" compression ratio %.1f", __func__,
-						(zbx_fs_size_t)(buf_stat_bytes + buf_dyn_bytes),
-						(double)reserved / (buf_stat_bytes + buf_dyn_bytes));
+						(zbx_fs_size_t)(context->buf_stat_bytes + context->buf_dyn_bytes),
+						(double)context->reserved /
+						(context->buf_stat_bytes + context->buf_dyn_bytes));
 			}
 			else
-				s->read_bytes = buf_stat_bytes + buf_dyn_bytes;
+				s->read_bytes = context->buf_stat_bytes + context->buf_dyn_bytes;
 
 			s->buffer[s->read_bytes] = '\0';
 		}
 		else
 		{
-			if (buf_stat_bytes + buf_dyn_bytes < expected_len)
+			if (context->buf_stat_bytes + context->buf_dyn_bytes < context->expected_len)
 			{
 				zabbix_log(LOG_LEVEL_WARNING, "Message from %s is shorter than expected " ZBX_FS_UI64
-						" bytes. Message ignored.", s->peer, (zbx_uint64_t)expected_len);
+						" bytes. Message ignored.", s->peer,
+						(zbx_uint64_t)context->expected_len);
 			}
 			else
 			{
 				zabbix_log(LOG_LEVEL_WARNING, "Message from %s is longer than expected " ZBX_FS_UI64
-						" bytes. Message ignored.", s->peer, (zbx_uint64_t)expected_len);
+						" bytes. Message ignored.", s->peer,
+						(zbx_uint64_t)context->expected_len);
 			}
 
 			nbytes = ZBX_PROTO_ERROR;
 		}
 	}
-	else if (ZBX_TCP_EXPECT_LENGTH == expect)
+	else if (ZBX_TCP_EXPECT_LENGTH == context->expect)
 	{
 		zabbix_log(LOG_LEVEL_WARNING, "Message from %s is missing data length. Message ignored.", s->peer);
 		nbytes = ZBX_PROTO_ERROR;
 	}
-	else if (ZBX_TCP_EXPECT_VERSION == expect)
+	else if (ZBX_TCP_EXPECT_VERSION == context->expect)
 	{
 		zabbix_log(LOG_LEVEL_WARNING, "Message from %s is missing protocol version. Message ignored.",
 				s->peer);
 		nbytes = ZBX_PROTO_ERROR;
 	}
-	else if (ZBX_TCP_EXPECT_VERSION_VALIDATE == expect)
+	else if (ZBX_TCP_EXPECT_VERSION_VALIDATE == context->expect)
 	{
 		zabbix_log(LOG_LEVEL_WARNING, "Message from %s is using unsupported protocol version \"%d\"."
-				" Message ignored.", s->peer, protocol_version);
+				" Message ignored.", s->peer, context->protocol_version);
 		nbytes = ZBX_PROTO_ERROR;
 	}
-	else if (0 != buf_stat_bytes)
+	else if (0 != context->buf_stat_bytes)
 	{
 		zabbix_log(LOG_LEVEL_WARNING, "Message from %s is missing header. Message ignored.", s->peer);
 		nbytes = ZBX_PROTO_ERROR;
@@ -1934,14 +2362,42 @@ ssize_t	zbx_tcp_recv_ext(zbx_socket_t *s, int timeout)
 		s->buffer[s->read_bytes] = '\0';
 	}
 out:
-	if (0 != timeout)
-		zbx_socket_timeout_cleanup(s);
-
-	return (ZBX_PROTO_ERROR == nbytes ? FAIL : (ssize_t)(s->read_bytes + offset));
+	return (ZBX_PROTO_ERROR == nbytes ? FAIL : (ssize_t)(s->read_bytes + context->offset));
+}
 
 #undef ZBX_TCP_EXPECT_HEADER
+#undef ZBX_TCP_EXPECT_VERSION
+#undef ZBX_TCP_EXPECT_VERSION_VALIDATE
 #undef ZBX_TCP_EXPECT_LENGTH
 #undef ZBX_TCP_EXPECT_SIZE
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tcp_recv_ext                                                 *
+ *                                                                            *
+ * Purpose: receive data                                                      *
+ *                                                                            *
+ * Return value: number of bytes received - success,                          *
+ *               FAIL - an error occurred                                     *
+ *                                                                            *
+ * Author: Eugene Grigorjev                                                   *
+ *                                                                            *
+ ******************************************************************************/
+ssize_t	zbx_tcp_recv_ext(zbx_socket_t *s, int timeout)
+{
+	zbx_tcp_recv_context_t	context;
+	ssize_t			nbytes;
+
+	if (0 != timeout)
+		zbx_socket_timeout_set(s, timeout);
+
+	zbx_tcp_recv_context_init(s, &context);
+	nbytes = zbx_tcp_recv_context(s, &context, NULL);
+
+	if (0 != timeout)
+		zbx_socket_timeout_cleanup(s);
+
+	return nbytes;
 }
 
 /******************************************************************************
@@ -1968,7 +2424,8 @@ ssize_t	zbx_tcp_recv_raw_ext(zbx_socket_t *s, int timeout)
 	s->buf_type = ZBX_BUF_TYPE_STAT;
 	s->buffer = s->buf_stat;
 
-	while (0 != (nbytes = zbx_tcp_read(s, s->buf_stat + buf_stat_bytes, sizeof(s->buf_stat) - buf_stat_bytes)))
+	while (0 != (nbytes = zbx_tcp_read(s, s->buf_stat + buf_stat_bytes, sizeof(s->buf_stat) - buf_stat_bytes,
+			NULL)))
 	{
 		if (ZBX_PROTO_ERROR == nbytes)
 			goto out;
@@ -2315,7 +2772,8 @@ const char	*zbx_tcp_connection_type_name(unsigned int type)
 
 int	zbx_udp_connect(zbx_socket_t *s, const char *source_ip, const char *ip, unsigned short port, int timeout)
 {
-	return zbx_socket_create(s, SOCK_DGRAM, source_ip, ip, port, timeout, ZBX_TCP_SEC_UNENCRYPTED, NULL, NULL);
+	return zbx_socket_create(s, SOCK_DGRAM, source_ip, ip, port, timeout, ZBX_TCP_SEC_UNENCRYPTED, NULL, NULL,
+			NULL);
 }
 
 int	zbx_udp_send(zbx_socket_t *s, const char *data, size_t data_len, int timeout)
@@ -81,24 +81,17 @@ int	zbx_send_response_ext(zbx_socket_t *sock, int result, const char *info, cons
 
 /******************************************************************************
  *                                                                            *
- * Function: zbx_recv_response                                                *
+ * Function: zbx_check_response                                               *
  *                                                                            *
- * Purpose: read a response message (in JSON format) from socket, optionally  *
- *          extract "info" value.                                             *
+ * Purpose: check a response message (in JSON format), optionally extract     *
+ *          "info" value.                                                     *
  *                                                                            *
- * Parameters: sock    - [IN] socket descriptor                               *
- *             timeout - [IN] timeout for this operation                      *
- *             error   - [OUT] pointer to error message                       *
+ * Parameters: response - [IN] the response message                           *
+ *             error    - [OUT] pointer to error message                      *
  *                                                                            *
  * Return value: SUCCEED - "response":"success" successfully retrieved        *
  *               FAIL    - otherwise                                          *
  * Comments:                                                                  *
- *     Allocates memory.                                                      *
- *                                                                            *
- *     If an error occurs, the function allocates dynamic memory for an error *
- *     message and writes its address into location pointed to by "error"     *
- *     parameter.                                                             *
- *                                                                            *
  *     When the "info" value is present in the response message then function *
  *     copies the "info" value into the "error" buffer as additional          *
  *     information                                                            *
@@ -107,41 +100,28 @@ int	zbx_send_response_ext(zbx_socket_t *sock, int result, const char *info, cons
  *                "error" memory !                                            *
  *                                                                            *
  ******************************************************************************/
-int	zbx_recv_response(zbx_socket_t *sock, int timeout, char **error)
+int	zbx_check_response(const char *response, char **error)
 {
 	struct zbx_json_parse	jp;
 	char			value[16];
-	int			ret = FAIL;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
-
-	if (SUCCEED != zbx_tcp_recv_to(sock, timeout))
-	{
-		/* since we have successfully sent data earlier, we assume the other */
-		/* side is just too busy processing our data if there is no response */
-		*error = zbx_strdup(*error, zbx_socket_strerror());
-		goto out;
-	}
-
-	zabbix_log(LOG_LEVEL_DEBUG, "%s() '%s'", __func__, sock->buffer);
 
 	/* deal with empty string here because zbx_json_open() does not produce an error message in this case */
-	if ('\0' == *sock->buffer)
+	if ('\0' == *response)
 	{
 		*error = zbx_strdup(*error, "empty string received");
-		goto out;
+		return FAIL;
 	}
 
-	if (SUCCEED != zbx_json_open(sock->buffer, &jp))
+	if (SUCCEED != zbx_json_open(response, &jp))
 	{
 		*error = zbx_strdup(*error, zbx_json_strerror());
-		goto out;
+		return FAIL;
 	}
 
 	if (SUCCEED != zbx_json_value_by_name(&jp, ZBX_PROTO_TAG_RESPONSE, value, sizeof(value), NULL))
 	{
 		*error = zbx_strdup(*error, "no \"" ZBX_PROTO_TAG_RESPONSE "\" tag");
-		goto out;
+		return FAIL;
 	}
 
 	if (0 != strcmp(value, ZBX_PROTO_VALUE_SUCCESS))
@@ -154,10 +134,57 @@ int	zbx_recv_response(zbx_socket_t *sock, int timeout, char **error)
 		else
 			*error = zbx_dsprintf(*error, "negative response \"%s\"", value);
 		zbx_free(info);
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_recv_response                                                *
+ *                                                                            *
+ * Purpose: read a response message (in JSON format) from socket, optionally  *
+ *          extract "info" value.                                             *
+ *                                                                            *
+ * Parameters: sock    - [IN] socket descriptor                               *
+ *             timeout - [IN] timeout for this operation                      *
+ *             error   - [OUT] pointer to error message                       *
+ *                                                                            *
+ * Return value: SUCCEED - "response":"success" successfully retrieved        *
+ *               FAIL    - otherwise                                          *
+ * Comments:                                                                  *
+ *     Allocates memory.                                                      *
+ *                                                                            *
+ *     If an error occurs, the function allocates dynamic memory for an error *
+ *     message and writes its address into location pointed to by "error"     *
+ *     parameter.                                                             *
+ *                                                                            *
+ *     When the "info" value is present in the response message then function *
+ *     copies the "info" value into the "error" buffer as additional          *
+ *     information                                                            *
+ *                                                                            *
+ *     IMPORTANT: it is a responsibility of the caller to release the         *
+ *                "error" memory !                                            *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_recv_response(zbx_socket_t *sock, int timeout, char **error)
+{
+	int	ret = FAIL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+
+	if (SUCCEED != zbx_tcp_recv_to(sock, timeout))
+	{
+		/* since we have successfully sent data earlier, we assume the other */
+		/* side is just too busy processing our data if there is no response */
+		*error = zbx_strdup(*error, zbx_socket_strerror());
 		goto out;
 	}
 
-	ret = SUCCEED;
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() '%s'", __func__, sock->buffer);
+
+	ret = zbx_check_response(sock->buffer, error);
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
@@ -139,6 +139,12 @@ struct zbx_tls_context
 	gnutls_psk_server_credentials_t	psk_server_creds;
 #elif defined(HAVE_OPENSSL)
 	SSL				*ctx;
+#if defined(HAVE_OPENSSL_WITH_PSK)
+	/* PSK from database for outgoing connection, passed to client callback function */
+	char				psk_identity[HOST_TLS_PSK_IDENTITY_LEN_MAX];
+	char				psk[HOST_TLS_PSK_LEN / 2];
+	size_t				psk_len;
+#endif
 #endif
 };
 
@@ -204,6 +210,34 @@ static ZBX_THREAD_LOCAL char			incoming_connection_psk_id[PSK_MAX_IDENTITY_LEN +
 ZBX_THREAD_LOCAL char				info_buf[256];
 #endif
 
+#if defined(HAVE_OPENSSL) && OPENSSL_VERSION_NUMBER >= 0x1010100fL && !defined(LIBRESSL_VERSION_NUMBER)
+/* Certificate-based sessions are resumed with RFC 5077 session tickets (OpenSSL 1.1.1 or newer). Ticket keys are */
+/* derived from a secret generated in the parent process, so a ticket issued by one process (e.g. trapper or     */
+/* agent listener) is accepted by all other processes of the same daemon without sharing a session cache.        */
+/* Keys are changed every ZBX_TLS_TICKET_KEY_PERIOD seconds. */
+#	define ZBX_TLS_SESSION_TICKETS
+#	define ZBX_TLS_TICKET_KEY_PERIOD	SEC_PER_HOUR
+#	define ZBX_TLS_TICKET_KEYS_LEN		80	/* key name, HMAC secret and AES key expected by OpenSSL */
+#	define ZBX_TLS_SESSION_CACHE_SIZE	4096	/* number of peers clients remember sessions for */
+
+/* client side cache of sessions to resume, indexed by hash of peer address */
+typedef struct
+{
+	ZBX_SOCKADDR	peer;
+	SSL_SESSION	*session;
+}
+zbx_tls_session_t;
+
+static unsigned char				ticket_secret[32];
+static int					ticket_secret_set	= 0;
+static ZBX_THREAD_LOCAL zbx_uint64_t		ticket_key_period	= 0;
+static ZBX_THREAD_LOCAL zbx_tls_session_t	*session_cache		= NULL;
+#endif
+
+/* number of full and resumed certificate-based handshakes performed by this process */
+static ZBX_THREAD_LOCAL zbx_uint64_t		sessions_full		= 0;
+static ZBX_THREAD_LOCAL zbx_uint64_t		sessions_resumed	= 0;
+
 #if defined(HAVE_GNUTLS)
 /******************************************************************************
  *                                                                            *
@@ -998,36 +1032,48 @@ static int	zbx_psk_cb(gnutls_session_t session, const char *psk_identity, gnutls
  *     Used in all programs making outgoing TLS PSK connections.              *
  *                                                                            *
  *     As a client we use different PSKs depending on connection to be made.  *
- *     Apparently there is no simple way to specify which PSK should be set   *
- *     by this callback function. We use global variables to pass this info.  *
+ *     PSK from database is kept in the connection context set as SSL         *
+ *     application data. PSK from configuration file is passed in global      *
+ *     variables.                                                             *
  *                                                                            *
  ******************************************************************************/
 static unsigned int	zbx_psk_client_cb(SSL *ssl, const char *hint, char *identity,
 		unsigned int max_identity_len, unsigned char *psk, unsigned int max_psk_len)
 {
-	ZBX_UNUSED(ssl);
+	const zbx_tls_context_t	*tls_ctx;
+	const char		*psk_identity = psk_identity_for_cb, *psk_data = psk_for_cb;
+	size_t			psk_identity_len = psk_identity_len_for_cb, psk_len = psk_len_for_cb;
+
 	ZBX_UNUSED(hint);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "%s() requested PSK identity \"%s\"", __func__, psk_identity_for_cb);
+	if (NULL != (tls_ctx = (const zbx_tls_context_t *)SSL_get_app_data(ssl)))
+	{
+		psk_identity = tls_ctx->psk_identity;
+		psk_identity_len = strlen(tls_ctx->psk_identity);
+		psk_data = tls_ctx->psk;
+		psk_len = tls_ctx->psk_len;
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() requested PSK identity \"%s\"", __func__, psk_identity);
 
-	if (max_identity_len < psk_identity_len_for_cb + 1)	/* 1 byte for terminating '\0' */
+	if (max_identity_len < psk_identity_len + 1)	/* 1 byte for terminating '\0' */
 	{
 		zabbix_log(LOG_LEVEL_WARNING, "requested PSK identity \"%s\" does not fit into %u-byte buffer",
-				psk_identity_for_cb, max_identity_len);
+				psk_identity, max_identity_len);
 		return 0;
 	}
 
-	if (max_psk_len < psk_len_for_cb)
+	if (max_psk_len < psk_len)
 	{
 		zabbix_log(LOG_LEVEL_WARNING, "PSK associated with PSK identity \"%s\" does not fit into %u-byte"
-				" buffer", psk_identity_for_cb, max_psk_len);
+				" buffer", psk_identity, max_psk_len);
 		return 0;
 	}
 
-	zbx_strlcpy(identity, psk_identity_for_cb, max_identity_len);
-	memcpy(psk, psk_for_cb, psk_len_for_cb);
+	zbx_strlcpy(identity, psk_identity, max_identity_len);
+	memcpy(psk, psk_data, psk_len);
 
-	return (unsigned int)psk_len_for_cb;
+	return (unsigned int)psk_len;
 }
 
 /******************************************************************************
@@ -2090,6 +2136,227 @@ void	zbx_tls_library_deinit(void)
 #endif
 }
 
+#if defined(ZBX_TLS_SESSION_TICKETS)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tls_update_ticket_keys                                       *
+ *                                                                            *
+ * Purpose: set session ticket encryption keys of the current key period for  *
+ *          server side contexts                                              *
+ *                                                                            *
+ * Comments: all processes derive the same keys from the secret generated in  *
+ *           the parent process, so tickets issued by one process can be      *
+ *           decrypted by any other process                                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_tls_update_ticket_keys(void)
+{
+	unsigned char	keys[ZBX_TLS_TICKET_KEYS_LEN], digest[EVP_MAX_MD_SIZE], data[sizeof(zbx_uint64_t) + 1];
+	unsigned int	digest_len;
+	size_t		offset, len;
+	zbx_uint64_t	period;
+
+	if (0 == ticket_secret_set || ticket_key_period == (period = (zbx_uint64_t)time(NULL) /
+			ZBX_TLS_TICKET_KEY_PERIOD))
+	{
+		return;
+	}
+
+	memcpy(data, &period, sizeof(period));
+
+	data[sizeof(period)] = 0;
+
+	/* key material is HMAC(secret, period | counter) concatenated for counter = 0, 1, ... */
+	for (offset = 0; offset < sizeof(keys); offset += len)
+	{
+		if (NULL == HMAC(EVP_sha512(), ticket_secret, sizeof(ticket_secret), data, sizeof(data), digest,
+				&digest_len))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot derive TLS session ticket keys");
+			goto out;
+		}
+
+		len = MIN(digest_len, sizeof(keys) - offset);
+		memcpy(keys + offset, digest, len);
+		data[sizeof(period)]++;
+	}
+
+	if (NULL != ctx_cert)
+		SSL_CTX_set_tlsext_ticket_keys(ctx_cert, keys, sizeof(keys));
+#if defined(HAVE_OPENSSL_WITH_PSK)
+	if (NULL != ctx_all)
+		SSL_CTX_set_tlsext_ticket_keys(ctx_all, keys, sizeof(keys));
+#endif
+	ticket_key_period = period;
+out:
+	zbx_guaranteed_memset(keys, 0, sizeof(keys));
+	zbx_guaranteed_memset(digest, 0, sizeof(digest));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tls_ticket_decrypt_cb                                        *
+ *                                                                            *
+ * Purpose: decide whether a session from decrypted ticket can be resumed     *
+ *                                                                            *
+ * Comments: only certificate-based sessions are resumed. Sessions            *
+ *           established with PSK are not, as PSK identity is captured in PSK *
+ *           server callback which is not called on resumption.               *
+ *                                                                            *
+ ******************************************************************************/
+static SSL_TICKET_RETURN	zbx_tls_ticket_decrypt_cb(SSL *ssl, SSL_SESSION *session,
+		const unsigned char *keyname, size_t keyname_len, SSL_TICKET_STATUS status, void *arg)
+{
+	ZBX_UNUSED(ssl);
+	ZBX_UNUSED(keyname);
+	ZBX_UNUSED(keyname_len);
+	ZBX_UNUSED(arg);
+
+	switch (status)
+	{
+		case SSL_TICKET_SUCCESS:
+			if (NULL != SSL_SESSION_get0_peer(session))
+				return SSL_TICKET_RETURN_USE;
+			return SSL_TICKET_RETURN_IGNORE_RENEW;
+		case SSL_TICKET_SUCCESS_RENEW:
+			if (NULL != SSL_SESSION_get0_peer(session))
+				return SSL_TICKET_RETURN_USE_RENEW;
+			return SSL_TICKET_RETURN_IGNORE_RENEW;
+		case SSL_TICKET_FATAL_ERR_MALLOC:
+		case SSL_TICKET_FATAL_ERR_OTHER:
+			return SSL_TICKET_RETURN_ABORT;
+		default:	/* no ticket, ticket not decrypted (e.g. issued with expired keys) */
+			return SSL_TICKET_RETURN_IGNORE_RENEW;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tls_enable_tickets                                           *
+ *                                                                            *
+ * Purpose: enable session tickets for certificate-based connections          *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_tls_enable_tickets(SSL_CTX *ctx)
+{
+	if (0 == ticket_secret_set)
+		return;
+
+	SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+	SSL_CTX_set_session_ticket_cb(ctx, NULL, zbx_tls_ticket_decrypt_cb, NULL);
+	SSL_CTX_set_num_tickets(ctx, 1);
+
+	/* limit how long a peer certificate verified once is trusted without verifying it again */
+	SSL_CTX_set_timeout(ctx, ZBX_TLS_TICKET_KEY_PERIOD);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tls_session_get                                              *
+ *                                                                            *
+ * Purpose: find client side session cache slot for the peer of a connected   *
+ *          socket                                                            *
+ *                                                                            *
+ * Parameters: s    - [IN] connected socket                                   *
+ *             peer - [OUT] peer address                                      *
+ *                                                                            *
+ * Return value: cache slot, which can hold a session of another peer, or     *
+ *               NULL if peer address cannot be obtained                      *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_tls_session_t	*zbx_tls_session_get(const zbx_socket_t *s, ZBX_SOCKADDR *peer)
+{
+	ZBX_SOCKLEN_T		sz = sizeof(ZBX_SOCKADDR);
+	const unsigned char	*p;
+	zbx_uint32_t		hash = 2166136261u;
+
+	memset(peer, 0, sizeof(ZBX_SOCKADDR));
+
+	if (ZBX_PROTO_ERROR == getpeername(s->socket, (struct sockaddr *)peer, &sz))
+		return NULL;
+
+	/* FNV-1a hash of peer address and port */
+	for (p = (const unsigned char *)peer; p < (const unsigned char *)peer + sz; p++)
+	{
+		hash ^= *p;
+		hash *= 16777619u;
+	}
+
+	if (NULL == session_cache)
+	{
+		session_cache = (zbx_tls_session_t *)zbx_calloc(NULL, ZBX_TLS_SESSION_CACHE_SIZE,
+				sizeof(zbx_tls_session_t));
+	}
+
+	return &session_cache[hash % ZBX_TLS_SESSION_CACHE_SIZE];
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tls_session_save                                             *
+ *                                                                            *
+ * Purpose: remember session of a client connection to resume it on the next  *
+ *          connection to the same peer                                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_tls_session_save(const zbx_socket_t *s)
+{
+	zbx_tls_session_t	*slot;
+	ZBX_SOCKADDR		peer;
+	SSL_SESSION		*session;
+
+	if (NULL == (slot = zbx_tls_session_get(s, &peer)))
+		return;
+
+	if (NULL != (session = SSL_get1_session(s->tls_ctx->ctx)) && 1 != SSL_SESSION_is_resumable(session))
+	{
+		SSL_SESSION_free(session);
+		session = NULL;
+	}
+
+	if (NULL != slot->session)
+		SSL_SESSION_free(slot->session);
+
+	slot->peer = peer;
+	slot->session = session;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tls_session_cache_free                                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_tls_session_cache_free(void)
+{
+	int	i;
+
+	if (NULL == session_cache)
+		return;
+
+	for (i = 0; i < ZBX_TLS_SESSION_CACHE_SIZE; i++)
+	{
+		if (NULL != session_cache[i].session)
+			SSL_SESSION_free(session_cache[i].session);
+	}
+
+	zbx_free(session_cache);
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tls_get_session_stats                                        *
+ *                                                                            *
+ * Purpose: get number of full and resumed certificate-based TLS handshakes   *
+ *          performed by the calling process                                  *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_tls_get_session_stats(zbx_uint64_t *full, zbx_uint64_t *resumed)
+{
+	*full = sessions_full;
+	*resumed = sessions_resumed;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_tls_init_parent                                              *
@@ -2102,6 +2369,11 @@ void	zbx_tls_init_parent(void)
 #if defined(_WINDOWS)
 	zbx_tls_library_init();		/* on MS Windows initialize crypto libraries in parent thread */
 #endif
+#if defined(ZBX_TLS_SESSION_TICKETS)
+	/* secret for deriving session ticket keys, inherited by all child processes */
+	if (1 == RAND_bytes(ticket_secret, sizeof(ticket_secret)))
+		ticket_secret_set = 1;
+#endif
 }
 
 /******************************************************************************
@@ -2660,6 +2932,10 @@ void	zbx_tls_init_child(void)
 
 		/* use server ciphersuite preference, do not use RFC 4507 ticket extension */
 		SSL_CTX_set_options(ctx_cert, SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_NO_TICKET);
+#if defined(ZBX_TLS_SESSION_TICKETS)
+		/* except for resuming certificate-based sessions with tickets protected by shared keys */
+		zbx_tls_enable_tickets(ctx_cert);
+#endif
 
 		/* do not connect to unpatched servers */
 		SSL_CTX_clear_options(ctx_cert, SSL_OP_LEGACY_SERVER_CONNECT);
@@ -2737,6 +3013,9 @@ void	zbx_tls_init_child(void)
 
 		SSL_CTX_set_mode(ctx_all, SSL_MODE_AUTO_RETRY);
 		SSL_CTX_set_options(ctx_all, SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_NO_TICKET);
+#if defined(ZBX_TLS_SESSION_TICKETS)
+		zbx_tls_enable_tickets(ctx_all);
+#endif
 		SSL_CTX_clear_options(ctx_all, SSL_OP_LEGACY_SERVER_CONNECT);
 		SSL_CTX_set_session_cache_mode(ctx_all, SSL_SESS_CACHE_OFF);
 
@@ -2754,6 +3033,9 @@ void	zbx_tls_init_child(void)
 		zbx_log_ciphersuites(__func__, "certificate and PSK", ctx_all);
 	}
 #endif /* defined(HAVE_OPENSSL_WITH_PSK) */
+#if defined(ZBX_TLS_SESSION_TICKETS)
+	zbx_tls_update_ticket_keys();
+#endif
 #ifndef _WINDOWS
 	sigprocmask(SIG_SETMASK, &orig_mask, NULL);
 #endif
@@ -2845,6 +3127,9 @@ void	zbx_tls_free(void)
 	zbx_tls_library_deinit();
 #endif
 #elif defined(HAVE_OPENSSL)
+#if defined(ZBX_TLS_SESSION_TICKETS)
+	zbx_tls_session_cache_free();
+#endif
 	if (NULL != ctx_cert)
 		SSL_CTX_free(ctx_cert);
 
@@ -2870,52 +3155,29 @@ void	zbx_tls_free(void)
 
 /******************************************************************************
  *                                                                            *
- * Function: zbx_tls_connect                                                  *
+ * Function: zbx_tls_connect_init                                             *
  *                                                                            *
- * Purpose: establish a TLS connection over an established TCP connection     *
+ * Purpose: set up TLS context for a connection over an established TCP       *
+ *          connection, before TLS handshake                                  *
  *                                                                            *
- * Parameters:                                                                *
- *     s           - [IN] socket with opened connection                       *
- *     error       - [OUT] dynamically allocated memory with error message    *
- *     tls_connect - [IN] how to connect. Allowed values:                     *
- *                        ZBX_TCP_SEC_TLS_CERT, ZBX_TCP_SEC_TLS_PSK.          *
- *     tls_arg1    - [IN] required issuer of peer certificate (may be NULL    *
- *                        or empty string if not important) or PSK identity   *
- *                        to connect with depending on value of               *
- *                        'tls_connect'.                                      *
- *     tls_arg2    - [IN] required subject of peer certificate (may be NULL   *
- *                        or empty string if not important) or PSK            *
- *                        (in hex-string) to connect with depending on value  *
- *                        of 'tls_connect'.                                   *
+ * Parameters: see zbx_tls_connect()                                          *
  *                                                                            *
  * Return value:                                                              *
- *     SUCCEED - successful TLS handshake with a valid certificate or PSK     *
- *     FAIL - an error occurred                                               *
+ *     SUCCEED - the context was set up, TLS handshake can be started         *
+ *     FAIL - an error occurred, the context is freed                         *
  *                                                                            *
  ******************************************************************************/
 #if defined(HAVE_GNUTLS)
-int	zbx_tls_connect(zbx_socket_t *s, unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2,
-		char **error)
+static int	zbx_tls_connect_init(zbx_socket_t *s, unsigned int tls_connect, const char *tls_arg1,
+		const char *tls_arg2, char **error)
 {
-	int	ret = FAIL, res;
-#if defined(_WINDOWS)
-	double	sec;
-#endif
+	int	res;
 
-	if (ZBX_TCP_SEC_TLS_CERT == tls_connect)
-	{
-		zabbix_log(LOG_LEVEL_DEBUG, "In %s(): issuer:\"%s\" subject:\"%s\"", __func__,
-				ZBX_NULL2EMPTY_STR(tls_arg1), ZBX_NULL2EMPTY_STR(tls_arg2));
-	}
-	else if (ZBX_TCP_SEC_TLS_PSK == tls_connect)
-	{
-		zabbix_log(LOG_LEVEL_DEBUG, "In %s(): psk_identity:\"%s\"", __func__, ZBX_NULL2EMPTY_STR(tls_arg1));
-	}
-	else
+	if (ZBX_TCP_SEC_TLS_CERT != tls_connect && ZBX_TCP_SEC_TLS_PSK != tls_connect)
 	{
 		*error = zbx_strdup(*error, "invalid connection parameters");
 		THIS_SHOULD_NEVER_HAPPEN;
-		goto out1;
+		return FAIL;
 	}
 
 	/* set up TLS context */
@@ -3047,231 +3309,273 @@ int	zbx_tls_connect(zbx_socket_t *s, unsigned int tls_connect, const char *tls_a
 
 	gnutls_transport_set_int(s->tls_ctx->ctx, ZBX_SOCKET_TO_INT(s->socket));
 
-	/* TLS handshake */
+	return SUCCEED;
+out:	/* an error occurred */
+	if (NULL != s->tls_ctx->ctx)
+	{
+		gnutls_credentials_clear(s->tls_ctx->ctx);
+		gnutls_deinit(s->tls_ctx->ctx);
+	}
 
-#if defined(_WINDOWS)
-	zbx_alarm_flag_clear();
-	sec = zbx_time();
+	if (NULL != s->tls_ctx->psk_client_creds)
+		gnutls_psk_free_client_credentials(s->tls_ctx->psk_client_creds);
+
+	zbx_free(s->tls_ctx);
+
+	return FAIL;
+}
+#elif defined(HAVE_OPENSSL)
+static int	zbx_tls_connect_init(zbx_socket_t *s, unsigned int tls_connect, const char *tls_arg1,
+		const char *tls_arg2, char **error)
+{
+	size_t	error_alloc = 0, error_offset = 0;
+#if defined(ZBX_TLS_SESSION_TICKETS)
+	zbx_tls_session_t	*session;
+	ZBX_SOCKADDR		peer;
 #endif
-	while (GNUTLS_E_SUCCESS != (res = gnutls_handshake(s->tls_ctx->ctx)))
+
+	if (ZBX_TCP_SEC_TLS_CERT != tls_connect && ZBX_TCP_SEC_TLS_PSK != tls_connect)
 	{
-#if defined(_WINDOWS)
-		if (s->timeout < zbx_time() - sec)
-			zbx_alarm_flag_set();
+		*error = zbx_strdup(*error, "invalid connection parameters");
+		THIS_SHOULD_NEVER_HAPPEN;
+		return FAIL;
+	}
+
+	s->tls_ctx = zbx_malloc(s->tls_ctx, sizeof(zbx_tls_context_t));
+	s->tls_ctx->ctx = NULL;
+#if defined(HAVE_OPENSSL_WITH_PSK)
+	s->tls_ctx->psk_len = 0;
 #endif
-		if (SUCCEED == zbx_alarm_timed_out())
+
+	if (ZBX_TCP_SEC_TLS_CERT == tls_connect)
+	{
+		if (NULL == ctx_cert)
 		{
-			*error = zbx_strdup(*error, "gnutls_handshake() timed out");
+			*error = zbx_strdup(*error, "cannot connect with TLS and certificate: no valid certificate"
+					" loaded");
 			goto out;
 		}
 
-		if (GNUTLS_E_INTERRUPTED == res || GNUTLS_E_AGAIN == res)
+		if (NULL == (s->tls_ctx->ctx = SSL_new(ctx_cert)))
 		{
-			continue;
+			zbx_snprintf_alloc(error, &error_alloc, &error_offset, "cannot create connection context:");
+			zbx_tls_error_msg(error, &error_alloc, &error_offset);
+			goto out;
 		}
-		else if (GNUTLS_E_WARNING_ALERT_RECEIVED == res || GNUTLS_E_FATAL_ALERT_RECEIVED == res)
+#if defined(ZBX_TLS_SESSION_TICKETS)
+		/* try to resume the last session with this peer */
+		if (NULL != (session = zbx_tls_session_get(s, &peer)) && NULL != session->session &&
+				0 == memcmp(&session->peer, &peer, sizeof(peer)))
 		{
-			const char	*msg;
-			int		alert;
+			SSL_set_session(s->tls_ctx->ctx, session->session);
+		}
+#endif
+	}
+	else	/* use a pre-shared key */
+	{
+#if defined(HAVE_OPENSSL_WITH_PSK)
+		if (NULL == ctx_psk)
+		{
+			*error = zbx_strdup(*error, "cannot connect with TLS and PSK: no valid PSK loaded");
+			goto out;
+		}
 
-			/* server sent an alert to us */
-			alert = gnutls_alert_get(s->tls_ctx->ctx);
+		if (NULL == (s->tls_ctx->ctx = SSL_new(ctx_psk)))
+		{
+			zbx_snprintf_alloc(error, &error_alloc, &error_offset, "cannot create connection context:");
+			zbx_tls_error_msg(error, &error_alloc, &error_offset);
+			goto out;
+		}
 
-			if (NULL == (msg = gnutls_alert_get_name(alert)))
-				msg = "unknown";
+		if (NULL == tls_arg2)	/* PSK is not set from DB */
+		{
+			/* Set up PSK global variables from a configuration file (always in agentd and a case when */
+			/* active proxy connects to server). Here we set it only in case of active proxy */
+			/* because for other programs it has already been set in zbx_tls_init_child(). */
 
-			if (GNUTLS_E_WARNING_ALERT_RECEIVED == res)
-			{
-				zabbix_log(LOG_LEVEL_WARNING, "%s() gnutls_handshake() received a warning alert: %d %s",
-						__func__, alert, msg);
-				continue;
-			}
-			else	/* GNUTLS_E_FATAL_ALERT_RECEIVED */
+			if (0 != (program_type & ZBX_PROGRAM_TYPE_PROXY_ACTIVE))
 			{
-				*error = zbx_dsprintf(*error, "%s(): gnutls_handshake() failed with fatal alert: %d %s",
-						__func__, alert, msg);
-				goto out;
+				psk_identity_for_cb = my_psk_identity;
+				psk_identity_len_for_cb = my_psk_identity_len;
+				psk_for_cb = my_psk;
+				psk_len_for_cb = my_psk_len;
 			}
 		}
 		else
 		{
-			int	level;
+			/* PSK comes from a database (case for a server/proxy when it connects to an agent for */
+			/* passive checks, for a server when it connects to a passive proxy). It is kept in the */
+			/* connection context for the client callback function because handshakes of several */
+			/* connections can be in progress at the same time. */
 
-			/* log "peer has closed connection" case with debug level */
-			level = (GNUTLS_E_PREMATURE_TERMINATION == res ? LOG_LEVEL_DEBUG : LOG_LEVEL_WARNING);
+			int	psk_len;
 
-			if (SUCCEED == ZBX_CHECK_LOG_LEVEL(level))
-			{
-				zabbix_log(level, "%s() gnutls_handshake() returned: %d %s",
-						__func__, res, gnutls_strerror(res));
-			}
-
-			if (0 != gnutls_error_is_fatal(res))
+			if (0 >= (psk_len = zbx_psk_hex2bin((const unsigned char *)tls_arg2,
+					(unsigned char *)s->tls_ctx->psk, sizeof(s->tls_ctx->psk))))
 			{
-				*error = zbx_dsprintf(*error, "%s(): gnutls_handshake() failed: %d %s",
-						__func__, res, gnutls_strerror(res));
+				*error = zbx_strdup(*error, "invalid PSK");
 				goto out;
 			}
-		}
-	}
 
-	if (ZBX_TCP_SEC_TLS_CERT == tls_connect)
-	{
-		/* log peer certificate information for debugging */
-		zbx_log_peer_cert(__func__, s->tls_ctx);
+			/* NULL check to silence analyzer warning */
+			zbx_strlcpy(s->tls_ctx->psk_identity, ZBX_NULL2EMPTY_STR(tls_arg1),
+					sizeof(s->tls_ctx->psk_identity));
+			s->tls_ctx->psk_len = (size_t)psk_len;
 
-		/* perform basic verification of peer certificate */
-		if (SUCCEED != zbx_verify_peer_cert(s->tls_ctx->ctx, error))
-		{
-			zbx_tls_close(s);
-			goto out1;
+			SSL_set_app_data(s->tls_ctx->ctx, s->tls_ctx);
 		}
+#else
+		ZBX_UNUSED(tls_arg1);
+		ZBX_UNUSED(tls_arg2);
 
-		/* if required verify peer certificate Issuer and Subject */
-		if (SUCCEED != zbx_verify_issuer_subject(s->tls_ctx, tls_arg1, tls_arg2, error))
-		{
-			zbx_tls_close(s);
-			goto out1;
-		}
+		*error = zbx_strdup(*error, "cannot connect with TLS and PSK: support for PSK was not compiled in");
+		goto out;
+#endif
 	}
 
-	s->connection_type = tls_connect;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():SUCCEED (established %s %s-%s-%s-" ZBX_FS_SIZE_T ")", __func__,
-			gnutls_protocol_get_name(gnutls_protocol_get_version(s->tls_ctx->ctx)),
-			gnutls_kx_get_name(gnutls_kx_get(s->tls_ctx->ctx)),
-			gnutls_cipher_get_name(gnutls_cipher_get(s->tls_ctx->ctx)),
-			gnutls_mac_get_name(gnutls_mac_get(s->tls_ctx->ctx)),
-			(zbx_fs_size_t)gnutls_mac_get_key_size(gnutls_mac_get(s->tls_ctx->ctx)));
+	/* set our connected TCP socket to TLS context */
+	if (1 != SSL_set_fd(s->tls_ctx->ctx, s->socket))
+	{
+		*error = zbx_strdup(*error, "cannot set socket for TLS context");
+		goto out;
+	}
 
 	return SUCCEED;
-
 out:	/* an error occurred */
 	if (NULL != s->tls_ctx->ctx)
-	{
-		gnutls_credentials_clear(s->tls_ctx->ctx);
-		gnutls_deinit(s->tls_ctx->ctx);
-	}
-
-	if (NULL != s->tls_ctx->psk_client_creds)
-		gnutls_psk_free_client_credentials(s->tls_ctx->psk_client_creds);
+		SSL_free(s->tls_ctx->ctx);
 
 	zbx_free(s->tls_ctx);
-out1:
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s error:'%s'", __func__, zbx_result_string(ret),
-			ZBX_NULL2EMPTY_STR(*error));
-	return ret;
+
+	return FAIL;
 }
-#elif defined(HAVE_OPENSSL)
-int	zbx_tls_connect(zbx_socket_t *s, unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2,
-		char **error)
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tls_handshake                                                *
+ *                                                                            *
+ * Purpose: perform TLS handshake of an outgoing connection                   *
+ *                                                                            *
+ * Parameters:                                                                *
+ *     s           - [IN] socket with TLS context set up                      *
+ *     tls_connect - [IN] how to connect, see zbx_tls_connect()               *
+ *     wait        - [OUT] socket events the handshake waits for, NULL for    *
+ *                         blocking socket                                    *
+ *     error       - [OUT] dynamically allocated memory with error message    *
+ *                                                                            *
+ * Return value:                                                              *
+ *     SUCCEED - the handshake is finished or, if 'wait' is set to non-zero   *
+ *               value, must be continued when socket is ready                *
+ *     FAIL - an error occurred, TLS context is freed                         *
+ *                                                                            *
+ ******************************************************************************/
+#if defined(HAVE_GNUTLS)
+static int	zbx_tls_handshake(zbx_socket_t *s, unsigned int tls_connect, int *wait, char **error)
 {
-	int	ret = FAIL, res;
-	size_t	error_alloc = 0, error_offset = 0;
+	int	res;
 #if defined(_WINDOWS)
 	double	sec;
 #endif
-#if defined(HAVE_OPENSSL_WITH_PSK)
-	char	psk_buf[HOST_TLS_PSK_LEN / 2];
-#endif
+	ZBX_UNUSED(tls_connect);
 
-	s->tls_ctx = zbx_malloc(s->tls_ctx, sizeof(zbx_tls_context_t));
-	s->tls_ctx->ctx = NULL;
-
-	if (ZBX_TCP_SEC_TLS_CERT == tls_connect)
+#if defined(_WINDOWS)
+	zbx_alarm_flag_clear();
+	sec = zbx_time();
+#endif
+	while (GNUTLS_E_SUCCESS != (res = gnutls_handshake(s->tls_ctx->ctx)))
 	{
-		zabbix_log(LOG_LEVEL_DEBUG, "In %s(): issuer:\"%s\" subject:\"%s\"", __func__,
-				ZBX_NULL2EMPTY_STR(tls_arg1), ZBX_NULL2EMPTY_STR(tls_arg2));
-
-		if (NULL == ctx_cert)
+#if defined(_WINDOWS)
+		if (s->timeout < zbx_time() - sec)
+			zbx_alarm_flag_set();
+#endif
+		if (SUCCEED == zbx_alarm_timed_out())
 		{
-			*error = zbx_strdup(*error, "cannot connect with TLS and certificate: no valid certificate"
-					" loaded");
+			*error = zbx_strdup(*error, "gnutls_handshake() timed out");
 			goto out;
 		}
 
-		if (NULL == (s->tls_ctx->ctx = SSL_new(ctx_cert)))
+		if (GNUTLS_E_INTERRUPTED == res || GNUTLS_E_AGAIN == res)
 		{
-			zbx_snprintf_alloc(error, &error_alloc, &error_offset, "cannot create connection context:");
-			zbx_tls_error_msg(error, &error_alloc, &error_offset);
-			goto out;
-		}
-	}
-	else if (ZBX_TCP_SEC_TLS_PSK == tls_connect)
-	{
-		zabbix_log(LOG_LEVEL_DEBUG, "In %s(): psk_identity:\"%s\"", __func__, ZBX_NULL2EMPTY_STR(tls_arg1));
+			if (NULL != wait && GNUTLS_E_AGAIN == res)
+			{
+				*wait = (0 == gnutls_record_get_direction(s->tls_ctx->ctx) ? ZBX_TCP_WAIT_READ :
+						ZBX_TCP_WAIT_WRITE);
+				return SUCCEED;
+			}
 
-#if defined(HAVE_OPENSSL_WITH_PSK)
-		if (NULL == ctx_psk)
-		{
-			*error = zbx_strdup(*error, "cannot connect with TLS and PSK: no valid PSK loaded");
-			goto out;
+			continue;
 		}
-
-		if (NULL == (s->tls_ctx->ctx = SSL_new(ctx_psk)))
+		else if (GNUTLS_E_WARNING_ALERT_RECEIVED == res || GNUTLS_E_FATAL_ALERT_RECEIVED == res)
 		{
-			zbx_snprintf_alloc(error, &error_alloc, &error_offset, "cannot create connection context:");
-			zbx_tls_error_msg(error, &error_alloc, &error_offset);
-			goto out;
-		}
+			const char	*msg;
+			int		alert;
 
-		if (NULL == tls_arg2)	/* PSK is not set from DB */
-		{
-			/* Set up PSK global variables from a configuration file (always in agentd and a case when */
-			/* active proxy connects to server). Here we set it only in case of active proxy */
-			/* because for other programs it has already been set in zbx_tls_init_child(). */
+			/* server sent an alert to us */
+			alert = gnutls_alert_get(s->tls_ctx->ctx);
 
-			if (0 != (program_type & ZBX_PROGRAM_TYPE_PROXY_ACTIVE))
+			if (NULL == (msg = gnutls_alert_get_name(alert)))
+				msg = "unknown";
+
+			if (GNUTLS_E_WARNING_ALERT_RECEIVED == res)
 			{
-				psk_identity_for_cb = my_psk_identity;
-				psk_identity_len_for_cb = my_psk_identity_len;
-				psk_for_cb = my_psk;
-				psk_len_for_cb = my_psk_len;
+				zabbix_log(LOG_LEVEL_WARNING, "%s() gnutls_handshake() received a warning alert: %d %s",
+						__func__, alert, msg);
+				continue;
+			}
+			else	/* GNUTLS_E_FATAL_ALERT_RECEIVED */
+			{
+				*error = zbx_dsprintf(*error, "%s(): gnutls_handshake() failed with fatal alert: %d %s",
+						__func__, alert, msg);
+				goto out;
 			}
 		}
 		else
 		{
-			/* PSK comes from a database (case for a server/proxy when it connects to an agent for */
-			/* passive checks, for a server when it connects to a passive proxy) */
+			int	level;
 
-			int	psk_len;
+			/* log "peer has closed connection" case with debug level */
+			level = (GNUTLS_E_PREMATURE_TERMINATION == res ? LOG_LEVEL_DEBUG : LOG_LEVEL_WARNING);
 
-			if (0 >= (psk_len = zbx_psk_hex2bin((const unsigned char *)tls_arg2, (unsigned char *)psk_buf,
-					sizeof(psk_buf))))
+			if (SUCCEED == ZBX_CHECK_LOG_LEVEL(level))
 			{
-				*error = zbx_strdup(*error, "invalid PSK");
-				goto out;
+				zabbix_log(level, "%s() gnutls_handshake() returned: %d %s",
+						__func__, res, gnutls_strerror(res));
 			}
 
-			/* some data reside in stack but it will be available at the time when a PSK client callback */
-			/* function copies the data into buffers provided by OpenSSL within the callback */
-			psk_identity_for_cb = tls_arg1;			/* string is on stack */
-			/* NULL check to silence analyzer warning */
-			psk_identity_len_for_cb = (NULL == tls_arg1 ? 0 : strlen(tls_arg1));
-			psk_for_cb = psk_buf;				/* buffer is on stack */
-			psk_len_for_cb = (size_t)psk_len;
+			if (0 != gnutls_error_is_fatal(res))
+			{
+				*error = zbx_dsprintf(*error, "%s(): gnutls_handshake() failed: %d %s",
+						__func__, res, gnutls_strerror(res));
+				goto out;
+			}
 		}
-#else
-		*error = zbx_strdup(*error, "cannot connect with TLS and PSK: support for PSK was not compiled in");
-		goto out;
-#endif
-	}
-	else
-	{
-		*error = zbx_strdup(*error, "invalid connection parameters");
-		THIS_SHOULD_NEVER_HAPPEN;
-		goto out1;
 	}
 
-	/* set our connected TCP socket to TLS context */
-	if (1 != SSL_set_fd(s->tls_ctx->ctx, s->socket))
-	{
-		*error = zbx_strdup(*error, "cannot set socket for TLS context");
-		goto out;
-	}
+	return SUCCEED;
+out:	/* an error occurred */
+	gnutls_credentials_clear(s->tls_ctx->ctx);
+	gnutls_deinit(s->tls_ctx->ctx);
 
-	/* TLS handshake */
+	if (NULL != s->tls_ctx->psk_client_creds)
+		gnutls_psk_free_client_credentials(s->tls_ctx->psk_client_creds);
 
+	zbx_free(s->tls_ctx);
+
+	return FAIL;
+}
+#elif defined(HAVE_OPENSSL)
+static int	zbx_tls_handshake(zbx_socket_t *s, unsigned int tls_connect, int *wait, char **error)
+{
+	int	res;
+	size_t	error_alloc = 0, error_offset = 0;
+#if defined(_WINDOWS)
+	double	sec;
+#endif
+#if defined(ZBX_TLS_SESSION_TICKETS)
+	zbx_tls_session_t	*session;
+	ZBX_SOCKADDR		peer;
+#endif
 	info_buf[0] = '\0';	/* empty buffer for zbx_openssl_info_cb() messages */
 #if defined(_WINDOWS)
 	zbx_alarm_flag_clear();
@@ -3291,6 +3595,14 @@ int	zbx_tls_connect(zbx_socket_t *s, unsigned int tls_connect, const char *tls_a
 			goto out;
 		}
 
+		result_code = SSL_get_error(s->tls_ctx->ctx, res);
+
+		if (NULL != wait && (SSL_ERROR_WANT_READ == result_code || SSL_ERROR_WANT_WRITE == result_code))
+		{
+			*wait = (SSL_ERROR_WANT_READ == result_code ? ZBX_TCP_WAIT_READ : ZBX_TCP_WAIT_WRITE);
+			return SUCCEED;
+		}
+
 		if (ZBX_TCP_SEC_TLS_CERT == tls_connect)
 		{
 			long	verify_result;
@@ -3304,8 +3616,6 @@ int	zbx_tls_connect(zbx_socket_t *s, unsigned int tls_connect, const char *tls_a
 			}
 		}
 
-		result_code = SSL_get_error(s->tls_ctx->ctx, res);
-
 		switch (result_code)
 		{
 			case SSL_ERROR_NONE:		/* handshake successful */
@@ -3359,6 +3669,81 @@ int	zbx_tls_connect(zbx_socket_t *s, unsigned int tls_connect, const char *tls_a
 		}
 	}
 
+	return SUCCEED;
+out:	/* an error occurred */
+#if defined(ZBX_TLS_SESSION_TICKETS)
+	/* do not offer the same session again if handshake failed */
+	if (ZBX_TCP_SEC_TLS_CERT == tls_connect && NULL != (session = zbx_tls_session_get(s, &peer)) &&
+			NULL != session->session && 0 == memcmp(&session->peer, &peer, sizeof(peer)))
+	{
+		SSL_SESSION_free(session->session);
+		session->session = NULL;
+	}
+#endif
+	SSL_free(s->tls_ctx->ctx);
+	zbx_free(s->tls_ctx);
+
+	return FAIL;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tls_connect_verify                                           *
+ *                                                                            *
+ * Purpose: verify peer of an outgoing connection after TLS handshake         *
+ *                                                                            *
+ * Parameters: see zbx_tls_connect()                                          *
+ *                                                                            *
+ * Return value:                                                              *
+ *     SUCCEED - the connection is established                                *
+ *     FAIL - peer verification failed, TLS connection is closed              *
+ *                                                                            *
+ ******************************************************************************/
+#if defined(HAVE_GNUTLS)
+static int	zbx_tls_connect_verify(zbx_socket_t *s, unsigned int tls_connect, const char *tls_arg1,
+		const char *tls_arg2, char **error)
+{
+	if (ZBX_TCP_SEC_TLS_CERT == tls_connect)
+	{
+		/* log peer certificate information for debugging */
+		zbx_log_peer_cert(__func__, s->tls_ctx);
+
+		/* perform basic verification of peer certificate */
+		if (SUCCEED != zbx_verify_peer_cert(s->tls_ctx->ctx, error))
+		{
+			zbx_tls_close(s);
+			return FAIL;
+		}
+
+		/* if required verify peer certificate Issuer and Subject */
+		if (SUCCEED != zbx_verify_issuer_subject(s->tls_ctx, tls_arg1, tls_arg2, error))
+		{
+			zbx_tls_close(s);
+			return FAIL;
+		}
+
+		if (0 != gnutls_session_is_resumed(s->tls_ctx->ctx))
+			sessions_resumed++;
+		else
+			sessions_full++;
+	}
+
+	s->connection_type = tls_connect;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() established %s %s-%s-%s-" ZBX_FS_SIZE_T, __func__,
+			gnutls_protocol_get_name(gnutls_protocol_get_version(s->tls_ctx->ctx)),
+			gnutls_kx_get_name(gnutls_kx_get(s->tls_ctx->ctx)),
+			gnutls_cipher_get_name(gnutls_cipher_get(s->tls_ctx->ctx)),
+			gnutls_mac_get_name(gnutls_mac_get(s->tls_ctx->ctx)),
+			(zbx_fs_size_t)gnutls_mac_get_key_size(gnutls_mac_get(s->tls_ctx->ctx)));
+
+	return SUCCEED;
+}
+#elif defined(HAVE_OPENSSL)
+static int	zbx_tls_connect_verify(zbx_socket_t *s, unsigned int tls_connect, const char *tls_arg1,
+		const char *tls_arg2, char **error)
+{
 	if (ZBX_TCP_SEC_TLS_CERT == tls_connect)
 	{
 		long	verify_result;
@@ -3369,38 +3754,125 @@ int	zbx_tls_connect(zbx_socket_t *s, unsigned int tls_connect, const char *tls_a
 		/* perform basic verification of peer certificate */
 		if (X509_V_OK != (verify_result = SSL_get_verify_result(s->tls_ctx->ctx)))
 		{
-			zbx_snprintf_alloc(error, &error_alloc, &error_offset, "%s",
-					X509_verify_cert_error_string(verify_result));
+			*error = zbx_strdup(*error, X509_verify_cert_error_string(verify_result));
 			zbx_tls_close(s);
-			goto out1;
+			return FAIL;
 		}
 
 		/* if required verify peer certificate Issuer and Subject */
 		if (SUCCEED != zbx_verify_issuer_subject(s->tls_ctx, tls_arg1, tls_arg2, error))
 		{
 			zbx_tls_close(s);
-			goto out1;
+			return FAIL;
 		}
+
+		if (1 == SSL_session_reused(s->tls_ctx->ctx))
+			sessions_resumed++;
+		else
+			sessions_full++;
 	}
 
 	s->connection_type = tls_connect;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():SUCCEED (established %s %s)", __func__,
-			SSL_get_version(s->tls_ctx->ctx), SSL_get_cipher(s->tls_ctx->ctx));
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() established %s %s%s", __func__, SSL_get_version(s->tls_ctx->ctx),
+			SSL_get_cipher(s->tls_ctx->ctx), 1 == SSL_session_reused(s->tls_ctx->ctx) ? ", resumed" : "");
 
 	return SUCCEED;
+}
+#endif
 
-out:	/* an error occurred */
-	if (NULL != s->tls_ctx->ctx)
-		SSL_free(s->tls_ctx->ctx);
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tls_connect                                                  *
+ *                                                                            *
+ * Purpose: establish a TLS connection over an established TCP connection     *
+ *                                                                            *
+ * Parameters:                                                                *
+ *     s           - [IN] socket with opened connection                       *
+ *     error       - [OUT] dynamically allocated memory with error message    *
+ *     tls_connect - [IN] how to connect. Allowed values:                     *
+ *                        ZBX_TCP_SEC_TLS_CERT, ZBX_TCP_SEC_TLS_PSK.          *
+ *     tls_arg1    - [IN] required issuer of peer certificate (may be NULL    *
+ *                        or empty string if not important) or PSK identity   *
+ *                        to connect with depending on value of               *
+ *                        'tls_connect'.                                      *
+ *     tls_arg2    - [IN] required subject of peer certificate (may be NULL   *
+ *                        or empty string if not important) or PSK            *
+ *                        (in hex-string) to connect with depending on value  *
+ *                        of 'tls_connect'.                                   *
+ *                                                                            *
+ * Return value:                                                              *
+ *     SUCCEED - successful TLS handshake with a valid certificate or PSK     *
+ *     FAIL - an error occurred                                               *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_tls_connect(zbx_socket_t *s, unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2,
+		char **error)
+{
+	int	ret = FAIL;
+
+	if (ZBX_TCP_SEC_TLS_CERT == tls_connect)
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "In %s(): issuer:\"%s\" subject:\"%s\"", __func__,
+				ZBX_NULL2EMPTY_STR(tls_arg1), ZBX_NULL2EMPTY_STR(tls_arg2));
+	}
+	else
+		zabbix_log(LOG_LEVEL_DEBUG, "In %s(): psk_identity:\"%s\"", __func__, ZBX_NULL2EMPTY_STR(tls_arg1));
+
+	if (SUCCEED == zbx_tls_connect_init(s, tls_connect, tls_arg1, tls_arg2, error) &&
+			SUCCEED == zbx_tls_handshake(s, tls_connect, NULL, error))
+	{
+		ret = zbx_tls_connect_verify(s, tls_connect, tls_arg1, tls_arg2, error);
+	}
 
-	zbx_free(s->tls_ctx);
-out1:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s error:'%s'", __func__, zbx_result_string(ret),
 			ZBX_NULL2EMPTY_STR(*error));
+
 	return ret;
 }
-#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_tls_connect_nowait                                           *
+ *                                                                            *
+ * Purpose: start or continue establishing a TLS connection over an           *
+ *          established non-blocking TCP connection                           *
+ *                                                                            *
+ * Parameters:                                                                *
+ *     s           - [IN] socket with opened connection                       *
+ *     tls_connect - [IN] how to connect, see zbx_tls_connect()               *
+ *     tls_arg1    - [IN] see zbx_tls_connect()                               *
+ *     tls_arg2    - [IN] see zbx_tls_connect()                               *
+ *     wait        - [OUT] socket events the handshake waits for or 0 if the  *
+ *                         connection is established                          *
+ *     error       - [OUT] dynamically allocated memory with error message    *
+ *                                                                            *
+ * Return value:                                                              *
+ *     SUCCEED - the connection is established or, if 'wait' is set, the      *
+ *               function must be called again with the same parameters when  *
+ *               socket is ready                                              *
+ *     FAIL - an error occurred                                               *
+ *                                                                            *
+ * Comments: TLS context is created on the first call, the following calls    *
+ *           only continue the handshake.                                     *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_tls_connect_nowait(zbx_socket_t *s, unsigned int tls_connect, const char *tls_arg1,
+		const char *tls_arg2, int *wait, char **error)
+{
+	*wait = 0;
+
+	if (NULL == s->tls_ctx && SUCCEED != zbx_tls_connect_init(s, tls_connect, tls_arg1, tls_arg2, error))
+		return FAIL;
+
+	if (SUCCEED != zbx_tls_handshake(s, tls_connect, wait, error))
+		return FAIL;
+
+	if (0 != *wait)
+		return SUCCEED;
+
+	return zbx_tls_connect_verify(s, tls_connect, tls_arg1, tls_arg2, error);
+}
 
 /******************************************************************************
  *                                                                            *
@@ -3643,6 +4115,11 @@ int	zbx_tls_accept(zbx_socket_t *s, unsigned int tls_accept, char **error)
 			goto out1;
 		}
 
+		if (0 != gnutls_session_is_resumed(s->tls_ctx->ctx))
+			sessions_resumed++;
+		else
+			sessions_full++;
+
 		/* Issuer and Subject will be verified later, after receiving sender type and host name */
 	}
 	else if (GNUTLS_CRD_PSK == creds)
@@ -3711,6 +4188,9 @@ int	zbx_tls_accept(zbx_socket_t *s, unsigned int tls_accept, char **error)
 
 #if defined(HAVE_OPENSSL_WITH_PSK)
 	incoming_connection_has_psk = 0;	/* assume certificate-based connection by default */
+#endif
+#if defined(ZBX_TLS_SESSION_TICKETS)
+	zbx_tls_update_ticket_keys();
 #endif
 	if ((ZBX_TCP_SEC_TLS_CERT | ZBX_TCP_SEC_TLS_PSK) == (tls_accept & (ZBX_TCP_SEC_TLS_CERT | ZBX_TCP_SEC_TLS_PSK)))
 	{
@@ -3907,6 +4387,11 @@ int	zbx_tls_accept(zbx_socket_t *s, unsigned int tls_accept, char **error)
 			goto out1;
 		}
 
+		if (1 == SSL_session_reused(s->tls_ctx->ctx))
+			sessions_resumed++;
+		else
+			sessions_full++;
+
 		/* Issuer and Subject will be verified later, after receiving sender type and host name */
 	}
 #if defined(HAVE_OPENSSL_WITH_PSK)
@@ -3948,11 +4433,11 @@ out1:
 #	define ZBX_TLS_READ_FUNC_NAME		"SSL_read"
 #	define ZBX_TLS_WANT_WRITE(res)		FAIL
 #	define ZBX_TLS_WANT_READ(res)		FAIL
-/* SSL_ERROR_WANT_READ or SSL_ERROR_WANT_WRITE should not be returned here because we set */
+/* SSL_ERROR_WANT_READ or SSL_ERROR_WANT_WRITE should not be returned here for blocking sockets because we set */
 /* SSL_MODE_AUTO_RETRY flag in zbx_tls_init_child() */
 #endif
 
-ssize_t	zbx_tls_write(zbx_socket_t *s, const char *buf, size_t len, char **error)
+ssize_t	zbx_tls_write(zbx_socket_t *s, const char *buf, size_t len, int *wait, char **error)
 {
 #if defined(_WINDOWS)
 	double	sec;
@@ -3982,6 +4467,14 @@ ssize_t	zbx_tls_write(zbx_socket_t *s, const char *buf, size_t len, char **error
 			*error = zbx_strdup(*error, ZBX_TLS_WRITE_FUNC_NAME "() timed out");
 			return ZBX_PROTO_ERROR;
 		}
+#if defined(HAVE_GNUTLS)
+		if (NULL != wait && GNUTLS_E_AGAIN == res)
+		{
+			*wait = (0 == gnutls_record_get_direction(s->tls_ctx->ctx) ? ZBX_TCP_WAIT_READ :
+					ZBX_TCP_WAIT_WRITE);
+			return ZBX_PROTO_ERROR;
+		}
+#endif
 	}
 	while (SUCCEED == ZBX_TLS_WANT_WRITE(res));
 
@@ -4000,6 +4493,12 @@ ssize_t	zbx_tls_write(zbx_socket_t *s, const char *buf, size_t len, char **error
 
 		result_code = SSL_get_error(s->tls_ctx->ctx, res);
 
+		if (NULL != wait && (SSL_ERROR_WANT_READ == result_code || SSL_ERROR_WANT_WRITE == result_code))
+		{
+			*wait = (SSL_ERROR_WANT_READ == result_code ? ZBX_TCP_WAIT_READ : ZBX_TCP_WAIT_WRITE);
+			return ZBX_PROTO_ERROR;
+		}
+
 		if (0 == res && SSL_ERROR_ZERO_RETURN == result_code)
 		{
 			*error = zbx_strdup(*error, "connection closed during write");
@@ -4023,7 +4522,7 @@ ssize_t	zbx_tls_write(zbx_socket_t *s, const char *buf, size_t len, char **error
 	return (ssize_t)res;
 }
 
-ssize_t	zbx_tls_read(zbx_socket_t *s, char *buf, size_t len, char **error)
+ssize_t	zbx_tls_read(zbx_socket_t *s, char *buf, size_t len, int *wait, char **error)
 {
 #if defined(_WINDOWS)
 	double	sec;
@@ -4053,6 +4552,14 @@ ssize_t	zbx_tls_read(zbx_socket_t *s, char *buf, size_t len, char **error)
 			*error = zbx_strdup(*error, ZBX_TLS_READ_FUNC_NAME "() timed out");
 			return ZBX_PROTO_ERROR;
 		}
+#if defined(HAVE_GNUTLS)
+		if (NULL != wait && GNUTLS_E_AGAIN == res)
+		{
+			*wait = (0 == gnutls_record_get_direction(s->tls_ctx->ctx) ? ZBX_TCP_WAIT_READ :
+					ZBX_TCP_WAIT_WRITE);
+			return ZBX_PROTO_ERROR;
+		}
+#endif
 	}
 	while (SUCCEED == ZBX_TLS_WANT_READ(res));
 
@@ -4072,6 +4579,12 @@ ssize_t	zbx_tls_read(zbx_socket_t *s, char *buf, size_t len, char **error)
 
 		result_code = SSL_get_error(s->tls_ctx->ctx, res);
 
+		if (NULL != wait && (SSL_ERROR_WANT_READ == result_code || SSL_ERROR_WANT_WRITE == result_code))
+		{
+			*wait = (SSL_ERROR_WANT_READ == result_code ? ZBX_TCP_WAIT_READ : ZBX_TCP_WAIT_WRITE);
+			return ZBX_PROTO_ERROR;
+		}
+
 		if (0 == res && SSL_ERROR_ZERO_RETURN == result_code)
 		{
 			*error = zbx_strdup(*error, "connection closed during read");
@@ -4165,6 +4678,11 @@ void	zbx_tls_close(zbx_socket_t *s)
 					s->peer, result_code, ZBX_NULL2EMPTY_STR(error), info_buf);
 			zbx_free(error);
 		}
+#if defined(ZBX_TLS_SESSION_TICKETS)
+		/* connection_type is set only for successfully established and verified connections */
+		if (ZBX_TCP_SEC_TLS_CERT == s->connection_type && 0 == SSL_is_server(s->tls_ctx->ctx))
+			zbx_tls_session_save(s);
+#endif
 
 		SSL_free(s->tls_ctx->ctx);
 	}
@@ -36,6 +36,7 @@
 #include "export.h"
 #include "zbxjson.h"
 #include "zbxhistory.h"
+#include "zbxself.h"
 
 static zbx_mem_info_t	*hc_index_mem = NULL;
 static zbx_mem_info_t	*hc_mem = NULL;
@@ -149,6 +150,8 @@ typedef struct
 	unsigned char	value_type;
 	unsigned char	state;
 	unsigned char	flags;		/* see ZBX_DC_FLAG_* above */
+	double		sample_origin;	/* collection time of value sampled for latency statistics */
+	double		sample_time;	/* time the sampled value was added to local history cache */
 }
 dc_item_value_t;
 
@@ -157,6 +160,9 @@ static size_t		string_values_alloc = 0, string_values_offset = 0;
 static dc_item_value_t	*item_values = NULL;
 static size_t		item_values_alloc = 0, item_values_num = 0;
 
+/* collection time of the value being added to local history cache if it is sampled */
+static double		local_sample_origin = 0;
+
 static void	hc_add_item_values(dc_item_value_t *values, int values_num);
 static void	hc_pop_items(zbx_vector_ptr_t *history_items);
 static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *history_items);
@@ -194,6 +200,79 @@ void	DCget_stats_all(zbx_wcache_info_t *wcache_info)
 	UNLOCK_CACHE;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_hc_get_diag_stats                                            *
+ *                                                                            *
+ * Purpose: get history cache diagnostics statistics                          *
+ *                                                                            *
+ * Parameters: items_num  - [OUT] the number of items in history cache        *
+ *             values_num - [OUT] the number of values in history cache       *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_hc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num)
+{
+	LOCK_CACHE;
+
+	*items_num = cache->history_items.num_data;
+	*values_num = cache->history_num;
+
+	UNLOCK_CACHE;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_hc_get_mem_stats                                             *
+ *                                                                            *
+ * Purpose: get shared memory allocator statistics of history cache           *
+ *                                                                            *
+ * Parameters: data  - [OUT] the history data memory statistics               *
+ *             index - [OUT] the history index memory statistics              *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_hc_get_mem_stats(zbx_mem_stats_t *data, zbx_mem_stats_t *index)
+{
+	LOCK_CACHE;
+
+	zbx_mem_get_stats(hc_mem, data);
+	zbx_mem_get_stats(hc_index_mem, index);
+
+	UNLOCK_CACHE;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_hc_get_items                                                 *
+ *                                                                            *
+ * Purpose: get the number of values cached per item                          *
+ *                                                                            *
+ * Parameters: items - [OUT] the itemid, number of values pairs               *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_hc_get_items(zbx_vector_uint64_pair_t *items)
+{
+	zbx_hashset_iter_t	iter;
+	zbx_hc_item_t		*item;
+	zbx_hc_data_t		*data;
+
+	LOCK_CACHE;
+
+	zbx_vector_uint64_pair_reserve(items, cache->history_items.num_data);
+
+	zbx_hashset_iter_reset(&cache->history_items, &iter);
+	while (NULL != (item = (zbx_hc_item_t *)zbx_hashset_iter_next(&iter)))
+	{
+		zbx_uint64_pair_t	pair = {item->itemid, 0};
+
+		for (data = item->tail; NULL != data; data = data->next)
+			pair.second++;
+
+		zbx_vector_uint64_pair_append_ptr(items, &pair);
+	}
+
+	UNLOCK_CACHE;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: DCget_stats                                                      *
@@ -2675,10 +2754,41 @@ static void	DCmodule_sync_history(int history_float_num, int history_integer_num
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: hc_update_value_latency                                          *
+ *                                                                            *
+ * Purpose: update latency statistics of sampled values after history sync    *
+ *                                                                            *
+ * Parameters: history     - [IN] the synced history values                   *
+ *             history_num - [IN] the number of values                        *
+ *             time_values - [IN] the time values were taken from history     *
+ *                                cache                                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_update_value_latency(const ZBX_DC_HISTORY *history, int history_num, double time_values)
+{
+	int	i;
+	double	now = 0;
+
+	for (i = 0; i < history_num; i++)
+	{
+		if (0 == (history[i].flags & ZBX_DC_FLAG_SAMPLED))
+			continue;
+
+		if (0 == now)
+			now = zbx_time();
+
+		update_selfmon_value_latency(ZBX_VALUE_LATENCY_SYNC, now - time_values);
+		update_selfmon_value_latency(ZBX_VALUE_LATENCY_TOTAL, now - history[i].sample_origin);
+	}
+}
+
 static void	sync_proxy_history(int *total_num, int *more)
 {
 	int			history_num;
 	time_t			sync_start;
+	double			time_values;
 	zbx_vector_ptr_t	history_items;
 	ZBX_DC_HISTORY		history[ZBX_HC_SYNC_MAX];
 
@@ -2701,6 +2811,7 @@ static void	sync_proxy_history(int *total_num, int *more)
 		if (0 == history_num)
 			break;
 
+		time_values = zbx_time();
 		hc_get_item_values(history, &history_items);	/* copy item data from history cache */
 
 		do
@@ -2712,6 +2823,8 @@ static void	sync_proxy_history(int *total_num, int *more)
 		}
 		while (ZBX_DB_DOWN == DBcommit());
 
+		hc_update_value_latency(history, history_num, time_values);
+
 		LOCK_CACHE;
 
 		hc_push_items(&history_items);	/* return items to history cache */
@@ -2770,6 +2883,7 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 	int				i, history_num, history_float_num, history_integer_num, history_string_num,
 					history_text_num, history_log_num, txn_error;
 	time_t				sync_start;
+	double				time_values = 0;
 	zbx_vector_uint64_t		triggerids, timer_triggerids;
 	zbx_vector_ptr_t		history_items, trigger_diff, item_diff, inventory_values;
 	zbx_vector_uint64_pair_t	trends_diff;
@@ -2849,6 +2963,7 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 
 		if (0 != history_num)
 		{
+			time_values = zbx_time();
 			hc_get_item_values(history, &history_items);	/* copy item data from history cache */
 
 			items = (DC_ITEM *)zbx_malloc(NULL, sizeof(DC_ITEM) * (size_t)history_num);
@@ -2937,6 +3052,9 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 			}
 
 			zbx_vector_uint64_clear(&timer_triggerids);
+
+			/* sampled values are done once the triggers depending on them are recalculated */
+			hc_update_value_latency(history, history_num, time_values);
 		}
 
 		if (0 != triggerids.values_num)
@@ -3211,6 +3329,11 @@ static dc_item_value_t	*dc_local_get_history_slot(void)
 		item_values = (dc_item_value_t *)zbx_realloc(item_values, item_values_alloc * sizeof(dc_item_value_t));
 	}
 
+	item_values[item_values_num].sample_origin = local_sample_origin;
+
+	if (0 != local_sample_origin)
+		item_values[item_values_num].sample_time = zbx_time();
+
 	return &item_values[item_values_num++];
 }
 
@@ -3428,13 +3551,18 @@ static void	dc_local_add_history_empty(zbx_uint64_t itemid, unsigned char item_v
  *              state           - [IN] the item state                         *
  *              error           - [IN] the error message in case item state   *
  *                                is ITEM_STATE_NOTSUPPORTED                  *
+ *              sample_origin   - [IN] the collection time if the value is    *
+ *                                sampled for latency statistics, 0 otherwise *
  *                                                                            *
  ******************************************************************************/
 void	dc_add_history(zbx_uint64_t itemid, unsigned char item_value_type, unsigned char item_flags,
-		AGENT_RESULT *result, const zbx_timespec_t *ts, unsigned char state, const char *error)
+		AGENT_RESULT *result, const zbx_timespec_t *ts, unsigned char state, const char *error,
+		double sample_origin)
 {
 	unsigned char	value_flags;
 
+	local_sample_origin = sample_origin;
+
 	if (ITEM_STATE_NOTSUPPORTED == state)
 	{
 		zbx_uint64_t	lastlogsize;
@@ -3923,6 +4051,13 @@ static void	hc_add_item_values(dc_item_value_t *values, int values_num)
 			item->head->next = data;
 			item->head = data;
 		}
+
+		if (0 != item_value->sample_origin && 0 == item->sample_origin)
+		{
+			data->flags |= ZBX_DC_FLAG_SAMPLED;
+			item->sample_origin = item_value->sample_origin;
+			item->sample_time = item_value->sample_time;
+		}
 	}
 }
 
@@ -4041,6 +4176,13 @@ static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *histor
 		if (ZBX_HC_ITEM_STATUS_BUSY == item->status)
 			continue;
 
+		/* the sampled value data cannot be changed by other processes until it's removed from cache */
+		if (0 != (item->tail->flags & ZBX_DC_FLAG_SAMPLED))
+		{
+			history[history_num].sample_origin = item->sample_origin;
+			update_selfmon_value_latency(ZBX_VALUE_LATENCY_CACHE, zbx_time() - item->sample_time);
+		}
+
 		hc_copy_history_data(&history[history_num++], item->itemid, item->tail);
 	}
 }
@@ -4078,6 +4220,13 @@ void	hc_push_items(zbx_vector_ptr_t *history_items)
 				break;
 			case ZBX_HC_ITEM_STATUS_NORMAL:
 				data_free = item->tail;
+
+				if (0 != (data_free->flags & ZBX_DC_FLAG_SAMPLED))
+				{
+					item->sample_origin = 0;
+					item->sample_time = 0;
+				}
+
 				item->tail = item->tail->next;
 				hc_free_data(data_free);
 				if (NULL == item->tail)
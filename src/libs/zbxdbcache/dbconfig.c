@@ -2844,7 +2844,7 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags)
 					if (0 == host->proxy_hostid)
 					{
 						dc_add_history(item->itemid, item->value_type, 0, NULL, &ts,
-								ITEM_STATE_NOTSUPPORTED, error);
+								ITEM_STATE_NOTSUPPORTED, error, 0);
 					}
 					zbx_free(error);
 				}
@@ -5744,6 +5744,18 @@ static int	__config_snmp_item_compare(const ZBX_DC_ITEM *i1, const ZBX_DC_ITEM *
 	return 0;
 }
 
+/* item types are ordered in poller queues so that items, which can be polled together, are next to each other */
+static int	__config_heap_elem_type_rank(const ZBX_DC_ITEM *item)
+{
+	if (ITEM_TYPE_ZABBIX == item->type)
+		return 1;
+
+	if (SUCCEED == is_snmp_type(item->type))
+		return 2;
+
+	return 0;
+}
+
 static int	__config_heap_elem_compare(const void *d1, const void *d2)
 {
 	const zbx_binary_heap_elem_t	*e1 = (const zbx_binary_heap_elem_t *)d1;
@@ -5752,23 +5764,26 @@ static int	__config_heap_elem_compare(const void *d1, const void *d2)
 	const ZBX_DC_ITEM		*i1 = (const ZBX_DC_ITEM *)e1->data;
 	const ZBX_DC_ITEM		*i2 = (const ZBX_DC_ITEM *)e2->data;
 
+	int				r1, r2;
+
 	ZBX_RETURN_IF_NOT_EQUAL(i1->nextcheck, i2->nextcheck);
 	ZBX_RETURN_IF_NOT_EQUAL(i1->queue_priority, i2->queue_priority);
 
-	if (SUCCEED != is_snmp_type(i1->type))
-	{
-		if (SUCCEED != is_snmp_type(i2->type))
-			return 0;
+	r1 = __config_heap_elem_type_rank(i1);
+	r2 = __config_heap_elem_type_rank(i2);
 
-		return -1;
-	}
-	else
+	ZBX_RETURN_IF_NOT_EQUAL(r1, r2);
+
+	if (1 == r1)
 	{
-		if (SUCCEED != is_snmp_type(i2->type))
-			return +1;
+		ZBX_RETURN_IF_NOT_EQUAL(i1->interfaceid, i2->interfaceid);
+		return 0;
+	}
 
+	if (2 == r1)
 		return __config_snmp_item_compare(i1, i2);
-	}
+
+	return 0;
 }
 
 static int	__config_pinger_elem_compare(const void *d1, const void *d2)
@@ -6046,6 +6061,7 @@ int	init_configuration_cache(char **error)
 	CREATE_HASHSET_EXT(config->data_sessions, 0, __config_data_session_hash, __config_data_session_compare);
 
 	config->config = NULL;
+	config->proxyconfig_revisions = NULL;
 
 	config->status = (ZBX_DC_STATUS *)__config_mem_malloc_func(NULL, sizeof(ZBX_DC_STATUS));
 	config->status->last_update = 0;
@@ -7944,9 +7960,12 @@ static void	dc_requeue_item_at(ZBX_DC_ITEM *dc_item, ZBX_DC_HOST *dc_host, int n
  *           always return the items they have taken using DCrequeue_items()  *
  *           or DCpoller_requeue_items().                                     *
  *                                                                            *
- *           Currently batch polling is supported only for JMX, SNMP and      *
- *           icmpping* simple checks. In other cases only single item is      *
- *           retrieved.                                                       *
+ *           Currently batch polling is supported only for JMX, SNMP,         *
+ *           icmpping* simple checks and Zabbix agent checks in normal        *
+ *           pollers. In other cases only single item is retrieved.           *
+ *                                                                            *
+ *           JMX items of different endpoints and hosts are batched together  *
+ *           only if JavaGatewayMultiEndpoint is enabled.                     *
  *                                                                            *
  *           IPMI poller queue are handled by DCconfig_get_ipmi_poller_items()*
  *           function.                                                        *
@@ -8000,8 +8019,21 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM *items)
 			}
 			else if (ITEM_TYPE_JMX == dc_item_prev->type)
 			{
-				if (0 != __config_java_item_compare(dc_item_prev, dc_item))
+				if (0 == CONFIG_JAVA_GATEWAY_MULTI_ENDPOINT &&
+						0 != __config_java_item_compare(dc_item_prev, dc_item))
+				{
 					break;
+				}
+			}
+			else if (ITEM_TYPE_ZABBIX == dc_item_prev->type)
+			{
+				/* agent items keep their own nextchecks, only items due at the same time are batched */
+				if (dc_item_prev->type != dc_item->type ||
+						dc_item_prev->interfaceid != dc_item->interfaceid ||
+						dc_item_prev->nextcheck != dc_item->nextcheck)
+				{
+					break;
+				}
 			}
 		}
 
@@ -8069,6 +8101,9 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM *items)
 				max_items = DCconfig_get_suggested_snmp_vars_nolock(dc_item->interfaceid, NULL);
 			}
 		}
+
+		if (1 == num && ZBX_POLLER_TYPE_NORMAL == poller_type && ITEM_TYPE_ZABBIX == dc_item->type)
+			max_items = MAX_AGENT_ITEMS;
 	}
 
 	UNLOCK_CACHE;
@@ -10827,6 +10862,62 @@ void	DCtouch_hosts_availability(const zbx_vector_uint64_t *hostids)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: DCset_proxyconfig_revisions                                      *
+ *                                                                            *
+ * Purpose: store revisions of the proxy configuration data applied from      *
+ *          server                                                            *
+ *                                                                            *
+ * Parameters: revisions - [IN] the revisions in json format or NULL to reset *
+ *                                                                            *
+ ******************************************************************************/
+void	DCset_proxyconfig_revisions(const char *revisions)
+{
+	size_t	len;
+
+	WRLOCK_CACHE;
+
+	if (NULL != config->proxyconfig_revisions)
+	{
+		__config_mem_free_func(config->proxyconfig_revisions);
+		config->proxyconfig_revisions = NULL;
+	}
+
+	if (NULL != revisions)
+	{
+		len = strlen(revisions) + 1;
+		config->proxyconfig_revisions = (char *)__config_mem_malloc_func(NULL, len);
+		memcpy(config->proxyconfig_revisions, revisions, len);
+	}
+
+	UNLOCK_CACHE;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCget_proxyconfig_revisions                                      *
+ *                                                                            *
+ * Purpose: get revisions of the proxy configuration data applied from server *
+ *                                                                            *
+ * Return value: the revisions in json format (must be freed by the caller)   *
+ *               or NULL if no configuration data was applied yet             *
+ *                                                                            *
+ ******************************************************************************/
+char	*DCget_proxyconfig_revisions(void)
+{
+	char	*revisions = NULL;
+
+	RDLOCK_CACHE;
+
+	if (NULL != config->proxyconfig_revisions)
+		revisions = zbx_strdup(NULL, config->proxyconfig_revisions);
+
+	UNLOCK_CACHE;
+
+	return revisions;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_db_condition_clean                                           *
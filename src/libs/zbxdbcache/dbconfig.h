@@ -811,6 +811,7 @@ typedef struct
 	zbx_hashset_t		strpool;
 	char			autoreg_psk_identity[HOST_TLS_PSK_IDENTITY_LEN_MAX];	/* autoregistration PSK */
 	char			autoreg_psk[HOST_TLS_PSK_LEN_MAX];
+	char			*proxyconfig_revisions;	/* proxy configuration revisions applied from server */
 }
 ZBX_DC_CONFIG;
 
@@ -2757,6 +2757,113 @@ int	zbx_vc_get_statistics(zbx_vc_stats_t *stats)
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_vc_get_diag_stats                                            *
+ *                                                                            *
+ * Purpose: get value cache diagnostics statistics                            *
+ *                                                                            *
+ * Parameters: items_num  - [OUT] the number of cached items                  *
+ *             values_num - [OUT] the number of cached values                 *
+ *             mode       - [OUT] the value cache operating mode              *
+ *                                                                            *
+ * Return value: SUCCEED - the statistics were retrieved successfully         *
+ *               FAIL    - failed to retrieve statistics                      *
+ *                          (cache was not initialized)                       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, int *mode)
+{
+	zbx_vc_item_t		*item;
+	zbx_hashset_iter_t	iter;
+
+	if (ZBX_VC_DISABLED == vc_state)
+		return FAIL;
+
+	vc_try_lock();
+
+	*items_num = vc_cache->items.num_data;
+	*mode = vc_cache->mode;
+
+	*values_num = 0;
+	zbx_hashset_iter_reset(&vc_cache->items, &iter);
+	while (NULL != (item = (zbx_vc_item_t *)zbx_hashset_iter_next(&iter)))
+		*values_num += item->values_total;
+
+	vc_try_unlock();
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_vc_get_mem_stats                                             *
+ *                                                                            *
+ * Purpose: get value cache shared memory allocator statistics                *
+ *                                                                            *
+ * Parameters: mem - [OUT] the memory statistics                              *
+ *                                                                            *
+ * Return value: SUCCEED - the statistics were retrieved successfully         *
+ *               FAIL    - failed to retrieve statistics                      *
+ *                          (cache was not initialized)                       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_get_mem_stats(zbx_mem_stats_t *mem)
+{
+	if (ZBX_VC_DISABLED == vc_state)
+		return FAIL;
+
+	vc_try_lock();
+
+	zbx_mem_get_stats(vc_mem, mem);
+
+	vc_try_unlock();
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_vc_get_item_stats                                            *
+ *                                                                            *
+ * Purpose: get statistics of cached items                                    *
+ *                                                                            *
+ * Parameters: stats - [OUT] the item statistics (zbx_vc_item_stats_t)        *
+ *                                                                            *
+ * Return value: SUCCEED - the statistics were retrieved successfully         *
+ *               FAIL    - failed to retrieve statistics                      *
+ *                          (cache was not initialized)                       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_get_item_stats(zbx_vector_ptr_t *stats)
+{
+	zbx_vc_item_t		*item;
+	zbx_hashset_iter_t	iter;
+	zbx_vc_item_stats_t	*item_stats;
+
+	if (ZBX_VC_DISABLED == vc_state)
+		return FAIL;
+
+	vc_try_lock();
+
+	zbx_vector_ptr_reserve(stats, vc_cache->items.num_data);
+
+	zbx_hashset_iter_reset(&vc_cache->items, &iter);
+	while (NULL != (item = (zbx_vc_item_t *)zbx_hashset_iter_next(&iter)))
+	{
+		item_stats = (zbx_vc_item_stats_t *)zbx_malloc(NULL, sizeof(zbx_vc_item_stats_t));
+		item_stats->itemid = item->itemid;
+		item_stats->values_num = item->values_total;
+		item_stats->active_range = item->active_range;
+		item_stats->hits = item->hits;
+		zbx_vector_ptr_append(stats, item_stats);
+	}
+
+	vc_try_unlock();
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_vc_lock                                                      *
@@ -23,6 +23,7 @@
 #include "zbxtypes.h"
 #include "zbxalgo.h"
 #include "zbxhistory.h"
+#include "memalloc.h"
 
 /*
  * The Value Cache provides read caching of item historical data residing in history
@@ -82,6 +83,15 @@ typedef struct
 }
 zbx_vc_stats_t;
 
+typedef struct
+{
+	zbx_uint64_t	itemid;
+	zbx_uint64_t	values_num;
+	zbx_uint64_t	hits;
+	int		active_range;
+}
+zbx_vc_item_stats_t;
+
 int	zbx_vc_init(char **error);
 
 void	zbx_vc_destroy(void);
@@ -105,6 +115,12 @@ int	zbx_vc_add_values(zbx_vector_ptr_t *history);
 
 int	zbx_vc_get_statistics(zbx_vc_stats_t *stats);
 
+int	zbx_vc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, int *mode);
+
+int	zbx_vc_get_mem_stats(zbx_mem_stats_t *mem);
+
+int	zbx_vc_get_item_stats(zbx_vector_ptr_t *stats);
+
 void	zbx_vc_housekeeping_value_cache(void);
 
 #endif	/* ZABBIX_VALUECACHE_H */
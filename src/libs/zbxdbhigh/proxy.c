@@ -31,6 +31,7 @@
 #include "preproc.h"
 #include "../zbxcrypto/tls_tcp_active.h"
 #include "zbxlld.h"
+#include "md5.h"
 
 extern char	*CONFIG_SERVER;
 
@@ -472,6 +473,242 @@ static void	proxyconfig_add_row(struct zbx_json *j, const DB_ROW row, const ZBX_
 	}
 }
 
+/* proxy configuration records are grouped into buckets by record id, the bucket revision */
+/* is a digest of its records allowing to send only the changed buckets to proxy         */
+#define ZBX_PROXYCONFIG_BUCKET_SIZE	256
+
+/* maximum number of record id ranges to use in proxy configuration record selection */
+#define ZBX_PROXYCONFIG_RANGES_MAX	100
+
+typedef struct
+{
+	zbx_uint64_t	recid;
+	char		*data;
+}
+zbx_proxyconfig_row_t;
+
+static void	proxyconfig_row_free(zbx_proxyconfig_row_t *row)
+{
+	zbx_free(row->data);
+	zbx_free(row);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxyconfig_append_row                                           *
+ *                                                                            *
+ * Purpose: append serialized configuration row to the table rows             *
+ *                                                                            *
+ * Parameters: rows  - [OUT] the table rows                                   *
+ *             recid - [IN] the record id                                     *
+ *             data  - [IN] the row in json format, the ownership is passed   *
+ *                          to the rows vector                                *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxyconfig_append_row(zbx_vector_ptr_t *rows, zbx_uint64_t recid, char *data)
+{
+	zbx_proxyconfig_row_t	*row;
+
+	row = (zbx_proxyconfig_row_t *)zbx_malloc(NULL, sizeof(zbx_proxyconfig_row_t));
+	row->recid = recid;
+	row->data = data;
+	zbx_vector_ptr_append(rows, row);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxyconfig_append_db_row                                        *
+ *                                                                            *
+ * Purpose: append database row to the table rows                             *
+ *                                                                            *
+ * Parameters: rows  - [OUT] the table rows                                   *
+ *             row   - [IN] the database row to add                           *
+ *             table - [IN] the table configuration                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxyconfig_append_db_row(zbx_vector_ptr_t *rows, const DB_ROW row, const ZBX_TABLE *table)
+{
+	struct zbx_json	jrow;
+	zbx_uint64_t	recid;
+
+	zbx_json_initarray(&jrow, 256);
+	proxyconfig_add_row(&jrow, row, table);
+
+	ZBX_STR2UINT64(recid, row[0]);
+	proxyconfig_append_row(rows, recid, zbx_strdup(NULL, jrow.buffer));
+
+	zbx_json_free(&jrow);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxyconfig_parse_revisions                                      *
+ *                                                                            *
+ * Purpose: parse table bucket revisions                                      *
+ *                                                                            *
+ * Parameters: jp_revisions - [IN] the table revisions in format              *
+ *                                 {"bucket_size":256,"buckets":[[<bucket>,   *
+ *                                 <revision>],...]}                          *
+ *             revisions    - [OUT] the bucket revisions as (bucket,          *
+ *                                  revision) pairs                           *
+ *                                                                            *
+ * Return value: SUCCEED - the revisions were parsed successfully             *
+ *               FAIL    - invalid revision format or bucket size             *
+ *                                                                            *
+ ******************************************************************************/
+static int	proxyconfig_parse_revisions(const struct zbx_json_parse *jp_revisions, zbx_hashset_t *revisions)
+{
+	struct zbx_json_parse	jp_buckets, jp_bucket;
+	const char		*p = NULL, *pv;
+	char			buf[MAX_ID_LEN + 1];
+	zbx_uint64_t		bucket_size;
+	zbx_uint64_pair_t	pair;
+
+	if (SUCCEED != zbx_json_value_by_name(jp_revisions, ZBX_PROTO_TAG_BUCKET_SIZE, buf, sizeof(buf), NULL) ||
+			SUCCEED != is_uint64(buf, &bucket_size) || ZBX_PROXYCONFIG_BUCKET_SIZE != bucket_size)
+	{
+		return FAIL;
+	}
+
+	if (SUCCEED != zbx_json_brackets_by_name(jp_revisions, ZBX_PROTO_TAG_BUCKETS, &jp_buckets))
+		return FAIL;
+
+	while (NULL != (p = zbx_json_next(&jp_buckets, p)))
+	{
+		if (SUCCEED != zbx_json_brackets_open(p, &jp_bucket))
+			return FAIL;
+
+		if (NULL == (pv = zbx_json_next_value(&jp_bucket, NULL, buf, sizeof(buf), NULL)) ||
+				SUCCEED != is_uint64(buf, &pair.first))
+		{
+			return FAIL;
+		}
+
+		if (NULL == zbx_json_next_value(&jp_bucket, pv, buf, sizeof(buf), NULL) ||
+				SUCCEED != is_uint64(buf, &pair.second))
+		{
+			return FAIL;
+		}
+
+		zbx_hashset_insert(revisions, &pair, sizeof(pair));
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxyconfig_add_table_data                                       *
+ *                                                                            *
+ * Purpose: add table rows and bucket revisions to the proxy config json data *
+ *                                                                            *
+ * Parameters: j            - [OUT] the output json                           *
+ *             table        - [IN] the table configuration                    *
+ *             rows         - [IN] the table rows                             *
+ *             jp_revisions - [IN] the revisions of configuration data        *
+ *                                 applied by proxy, can be NULL              *
+ *                                                                            *
+ * Comments: Only the rows from buckets with revisions different from the     *
+ *           revisions applied by proxy are added. The rows are added in the  *
+ *           original order.                                                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxyconfig_add_table_data(struct zbx_json *j, const ZBX_TABLE *table, const zbx_vector_ptr_t *rows,
+		const struct zbx_json_parse *jp_revisions)
+{
+	zbx_vector_ptr_t		sorted;
+	zbx_vector_uint64_pair_t	buckets;
+	zbx_hashset_t			proxy_revisions, send_buckets;
+	zbx_uint64_pair_t		bucket, *proxy_bucket;
+	zbx_uint64_t			recid_bucket;
+	const zbx_proxyconfig_row_t	*row;
+	struct zbx_json_parse		jp_table;
+	md5_state_t			state;
+	md5_byte_t			hash[MD5_DIGEST_SIZE];
+	int				i, rows_num = 0;
+
+	zbx_hashset_create(&proxy_revisions, 100, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_hashset_create(&send_buckets, 100, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_vector_uint64_pair_create(&buckets);
+	zbx_vector_ptr_create(&sorted);
+
+	if (NULL != jp_revisions && SUCCEED == zbx_json_brackets_by_name(jp_revisions, table->table, &jp_table) &&
+			SUCCEED != proxyconfig_parse_revisions(&jp_table, &proxy_revisions))
+	{
+		zbx_hashset_clear(&proxy_revisions);
+	}
+
+	/* bucket revisions are calculated from rows sorted by record id to be independent of the output order */
+	zbx_vector_ptr_append_array(&sorted, rows->values, rows->values_num);
+	zbx_vector_ptr_sort(&sorted, ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC);
+
+	for (i = 0; i < sorted.values_num;)
+	{
+		bucket.first = ((const zbx_proxyconfig_row_t *)sorted.values[i])->recid / ZBX_PROXYCONFIG_BUCKET_SIZE;
+		zbx_md5_init(&state);
+
+		for (; i < sorted.values_num; i++)
+		{
+			row = (const zbx_proxyconfig_row_t *)sorted.values[i];
+
+			if (row->recid / ZBX_PROXYCONFIG_BUCKET_SIZE != bucket.first)
+				break;
+
+			zbx_md5_append(&state, (const md5_byte_t *)row->data, (int)strlen(row->data));
+			zbx_md5_append(&state, (const md5_byte_t *)"\n", 1);
+		}
+
+		zbx_md5_finish(&state, hash);
+		memcpy(&bucket.second, hash, sizeof(bucket.second));
+		zbx_vector_uint64_pair_append(&buckets, bucket);
+
+		if (NULL == (proxy_bucket = (zbx_uint64_pair_t *)zbx_hashset_search(&proxy_revisions, &bucket.first)) ||
+				proxy_bucket->second != bucket.second)
+		{
+			zbx_hashset_insert(&send_buckets, &bucket.first, sizeof(bucket.first));
+		}
+	}
+
+	zbx_json_addarray(j, ZBX_PROTO_TAG_DATA);
+
+	for (i = 0; i < rows->values_num; i++)
+	{
+		row = (const zbx_proxyconfig_row_t *)rows->values[i];
+		recid_bucket = row->recid / ZBX_PROXYCONFIG_BUCKET_SIZE;
+
+		if (NULL != zbx_hashset_search(&send_buckets, &recid_bucket))
+		{
+			zbx_json_addraw(j, NULL, row->data);
+			rows_num++;
+		}
+	}
+
+	zbx_json_close(j);	/* data */
+
+	zbx_json_addobject(j, ZBX_PROTO_TAG_REVISIONS);
+	zbx_json_adduint64(j, ZBX_PROTO_TAG_BUCKET_SIZE, ZBX_PROXYCONFIG_BUCKET_SIZE);
+	zbx_json_addarray(j, ZBX_PROTO_TAG_BUCKETS);
+
+	for (i = 0; i < buckets.values_num; i++)
+	{
+		zbx_json_addarray(j, NULL);
+		zbx_json_adduint64(j, NULL, buckets.values[i].first);
+		zbx_json_adduint64(j, NULL, buckets.values[i].second);
+		zbx_json_close(j);
+	}
+
+	zbx_json_close(j);	/* buckets */
+	zbx_json_close(j);	/* revisions */
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() table:'%s' rows:%d/%d buckets:%d/%d", __func__, table->table, rows_num,
+			rows->values_num, send_buckets.num_data, buckets.values_num);
+
+	zbx_vector_ptr_destroy(&sorted);
+	zbx_vector_uint64_pair_destroy(&buckets);
+	zbx_hashset_destroy(&send_buckets);
+	zbx_hashset_destroy(&proxy_revisions);
+}
+
 typedef struct
 {
 	zbx_uint64_t	itemid;
@@ -488,7 +725,7 @@ zbx_proxy_item_config_t;
  *                                                                            *
  ******************************************************************************/
 static int	get_proxyconfig_table_items(zbx_uint64_t proxy_hostid, struct zbx_json *j, const ZBX_TABLE *table,
-		zbx_hashset_t *itemids)
+		zbx_hashset_t *itemids, const struct zbx_json_parse *jp_revisions)
 {
 	char			*sql = NULL;
 	size_t			sql_alloc = 4 * ZBX_KIBIBYTE, sql_offset = 0;
@@ -496,8 +733,7 @@ static int	get_proxyconfig_table_items(zbx_uint64_t proxy_hostid, struct zbx_jso
 	DB_RESULT		result;
 	DB_ROW			row;
 	zbx_hashset_t		proxy_items;
-	struct zbx_json		*jrow;
-	zbx_vector_ptr_t	items;
+	zbx_vector_ptr_t	items, rows;
 	zbx_uint64_t		itemid;
 	zbx_hashset_iter_t	iter;
 
@@ -539,7 +775,7 @@ static int	get_proxyconfig_table_items(zbx_uint64_t proxy_hostid, struct zbx_jso
 
 	zbx_json_close(j);	/* fields */
 
-	zbx_json_addarray(j, "data");
+	zbx_vector_ptr_create(&rows);
 
 	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
 			" from items t,hosts r where t.hostid=r.hostid"
@@ -579,18 +815,15 @@ static int	get_proxyconfig_table_items(zbx_uint64_t proxy_hostid, struct zbx_jso
 			ZBX_STR2UINT64(proxy_item_local.master_itemid, row[fld_master]);
 			proxy_item = zbx_hashset_insert(&proxy_items, &proxy_item_local, sizeof(proxy_item_local));
 			zbx_json_initarray(&proxy_item->data, 256);
-			jrow = &proxy_item->data;
+			proxyconfig_add_row(&proxy_item->data, row, table);
+			zbx_json_close(&proxy_item->data);
 		}
 		else
 		{
 			ZBX_STR2UINT64(itemid, row[0]);
 			zbx_hashset_insert(itemids, &itemid, sizeof(itemid));
-			zbx_json_addarray(j, NULL);
-			jrow = j;
+			proxyconfig_append_db_row(&rows, row, table);
 		}
-
-		proxyconfig_add_row(jrow, row, table);
-		zbx_json_close(jrow);
 	}
 
 	/* flush cached dependent items */
@@ -621,8 +854,11 @@ static int	get_proxyconfig_table_items(zbx_uint64_t proxy_hostid, struct zbx_jso
 			if (NULL != zbx_hashset_search(itemids, &proxy_item->master_itemid))
 			{
 				zbx_hashset_insert(itemids, &proxy_item->itemid, sizeof(itemid));
-				zbx_json_addraw(j, NULL, proxy_item->data.buffer);
+				proxyconfig_append_row(&rows, proxy_item->itemid,
+						zbx_strdup(NULL, proxy_item->data.buffer));
 			}
+
+			/* small json buffer is stored in the hashset entry itself */
 			zbx_json_free(&proxy_item->data);
 			zbx_hashset_remove_direct(&proxy_items, proxy_item);
 		}
@@ -637,7 +873,10 @@ static int	get_proxyconfig_table_items(zbx_uint64_t proxy_hostid, struct zbx_jso
 skip_data:
 	zbx_free(sql);
 
-	zbx_json_close(j);	/* data */
+	proxyconfig_add_table_data(j, table, &rows, jp_revisions);
+	zbx_vector_ptr_clear_ext(&rows, (zbx_clean_func_t)proxyconfig_row_free);
+	zbx_vector_ptr_destroy(&rows);
+
 	zbx_json_close(j);	/* table->table */
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
@@ -653,13 +892,14 @@ skip_data:
  *                                                                            *
  ******************************************************************************/
 static int	get_proxyconfig_table_items_ext(zbx_uint64_t proxy_hostid, const zbx_hashset_t *itemids,
-		struct zbx_json *j, const ZBX_TABLE *table)
+		struct zbx_json *j, const ZBX_TABLE *table, const struct zbx_json_parse *jp_revisions)
 {
-	char		*sql = NULL;
-	size_t		sql_alloc = 4 * ZBX_KIBIBYTE, sql_offset = 0;
-	int		f, ret = SUCCEED, index = 1, itemid_index = 0;
-	DB_RESULT	result;
-	DB_ROW		row;
+	char			*sql = NULL;
+	size_t			sql_alloc = 4 * ZBX_KIBIBYTE, sql_offset = 0;
+	int			f, ret = SUCCEED, index = 1, itemid_index = 0;
+	DB_RESULT		result;
+	DB_ROW			row;
+	zbx_vector_ptr_t	rows;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() table:%s", __func__, table->table);
 
@@ -691,7 +931,7 @@ static int	get_proxyconfig_table_items_ext(zbx_uint64_t proxy_hostid, const zbx_
 
 	zbx_json_close(j);	/* fields */
 
-	zbx_json_addarray(j, "data");
+	zbx_vector_ptr_create(&rows);
 
 	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
 			" from %s t,items i,hosts h"
@@ -712,17 +952,16 @@ static int	get_proxyconfig_table_items_ext(zbx_uint64_t proxy_hostid, const zbx_
 
 		ZBX_STR2UINT64(itemid, row[itemid_index]);
 		if (NULL != zbx_hashset_search((zbx_hashset_t *)itemids, &itemid))
-		{
-			zbx_json_addarray(j, NULL);
-			proxyconfig_add_row(j, row, table);
-			zbx_json_close(j);
-		}
+			proxyconfig_append_db_row(&rows, row, table);
 	}
 	DBfree_result(result);
 skip_data:
 	zbx_free(sql);
 
-	zbx_json_close(j);	/* data */
+	proxyconfig_add_table_data(j, table, &rows, jp_revisions);
+	zbx_vector_ptr_clear_ext(&rows, (zbx_clean_func_t)proxyconfig_row_free);
+	zbx_vector_ptr_destroy(&rows);
+
 	zbx_json_close(j);	/* table->table */
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
@@ -738,13 +977,14 @@ skip_data:
  *                                                                            *
  ******************************************************************************/
 static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j, const ZBX_TABLE *table,
-		zbx_vector_uint64_t *hosts, zbx_vector_uint64_t *httptests)
+		zbx_vector_uint64_t *hosts, zbx_vector_uint64_t *httptests, const struct zbx_json_parse *jp_revisions)
 {
-	char		*sql = NULL;
-	size_t		sql_alloc = 4 * ZBX_KIBIBYTE, sql_offset = 0;
-	int		f, ret = SUCCEED;
-	DB_RESULT	result;
-	DB_ROW		row;
+	char			*sql = NULL;
+	size_t			sql_alloc = 4 * ZBX_KIBIBYTE, sql_offset = 0;
+	int			f, ret = SUCCEED;
+	DB_RESULT		result;
+	DB_ROW			row;
+	zbx_vector_ptr_t	rows;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() proxy_hostid:" ZBX_FS_UI64 " table:'%s'",
 			__func__, proxy_hostid, table->table);
@@ -771,7 +1011,7 @@ static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j,
 
 	zbx_json_close(j);	/* fields */
 
-	zbx_json_addarray(j, "data");
+	zbx_vector_ptr_create(&rows);
 
 	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, " from %s t", table->table);
 
@@ -833,16 +1073,15 @@ static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j,
 	}
 
 	while (NULL != (row = DBfetch(result)))
-	{
-		zbx_json_addarray(j, NULL);
-		proxyconfig_add_row(j, row, table);
-		zbx_json_close(j);
-	}
+		proxyconfig_append_db_row(&rows, row, table);
 	DBfree_result(result);
 skip_data:
 	zbx_free(sql);
 
-	zbx_json_close(j);	/* data */
+	proxyconfig_add_table_data(j, table, &rows, jp_revisions);
+	zbx_vector_ptr_clear_ext(&rows, (zbx_clean_func_t)proxyconfig_row_free);
+	zbx_vector_ptr_destroy(&rows);
+
 	zbx_json_close(j);	/* table->table */
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
@@ -939,8 +1178,18 @@ static void	get_proxy_monitored_httptests(zbx_uint64_t proxy_hostid, zbx_vector_
  *                                                                            *
  * Purpose: prepare proxy configuration data                                  *
  *                                                                            *
+ * Parameters: proxy_hostid - [IN] the proxy identifier                       *
+ *             j            - [OUT] the proxy configuration data              *
+ *             jp_revisions - [IN] the revisions of configuration data        *
+ *                                 applied by proxy, can be NULL              *
+ *             error        - [OUT] the error message                         *
+ *                                                                            *
+ * Comments: Only the table buckets with revisions different from the ones    *
+ *           applied by proxy are sent.                                       *
+ *                                                                            *
  ******************************************************************************/
-int	get_proxyconfig_data(zbx_uint64_t proxy_hostid, struct zbx_json *j, char **error)
+int	get_proxyconfig_data(zbx_uint64_t proxy_hostid, struct zbx_json *j, const struct zbx_json_parse *jp_revisions,
+		char **error)
 {
 	static const char	*proxytable[] =
 	{
@@ -989,15 +1238,15 @@ int	get_proxyconfig_data(zbx_uint64_t proxy_hostid, struct zbx_json *j, char **e
 
 		if (0 == strcmp(proxytable[i], "items"))
 		{
-			ret = get_proxyconfig_table_items(proxy_hostid, j, table, &itemids);
+			ret = get_proxyconfig_table_items(proxy_hostid, j, table, &itemids, jp_revisions);
 		}
 		else if (0 == strcmp(proxytable[i], "item_preproc") || 0 == strcmp(proxytable[i], "item_rtdata"))
 		{
 			if (0 != itemids.num_data)
-				ret = get_proxyconfig_table_items_ext(proxy_hostid, &itemids, j, table);
+				ret = get_proxyconfig_table_items_ext(proxy_hostid, &itemids, j, table, jp_revisions);
 		}
 		else
-			ret = get_proxyconfig_table(proxy_hostid, j, table, &hosts, &httptests);
+			ret = get_proxyconfig_table(proxy_hostid, j, table, &hosts, &httptests, jp_revisions);
 
 		if (SUCCEED != ret)
 		{
@@ -1179,6 +1428,175 @@ static int	compare_nth_field(const ZBX_FIELD **fields, const char *rec_data, int
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: proxyconfig_get_refresh_buckets                                  *
+ *                                                                            *
+ * Purpose: get buckets of the table records to be refreshed with the         *
+ *          received configuration data                                       *
+ *                                                                            *
+ * Parameters: table        - [IN] the table configuration                    *
+ *             jp_obj       - [IN] the received table configuration data      *
+ *             jp_data      - [IN] the received table rows                    *
+ *             jp_revisions - [IN] the revisions of previously applied        *
+ *                                 configuration data, can be NULL            *
+ *             buckets      - [OUT] the sorted buckets to refresh             *
+ *             full_refresh - [OUT] 1 - the whole table must be refreshed,    *
+ *                                  0 - only the returned buckets must be     *
+ *                                      refreshed                             *
+ *             error        - [OUT] the error message                         *
+ *                                                                            *
+ * Return value: SUCCEED - the buckets were determined successfully           *
+ *               FAIL    - invalid revisions or the received data does not    *
+ *                         match the previously applied configuration         *
+ *                                                                            *
+ ******************************************************************************/
+static int	proxyconfig_get_refresh_buckets(const ZBX_TABLE *table, const struct zbx_json_parse *jp_obj,
+		const struct zbx_json_parse *jp_data, const struct zbx_json_parse *jp_revisions,
+		zbx_vector_uint64_t *buckets, int *full_refresh, char **error)
+{
+	struct zbx_json_parse	jp_table, jp_row;
+	zbx_hashset_t		revisions, revisions_applied, included;
+	zbx_hashset_iter_t	iter;
+	zbx_uint64_pair_t	*revision, *revision_applied;
+	zbx_uint64_t		recid, bucket, *pbucket;
+	const char		*p = NULL;
+	char			buf[MAX_ID_LEN + 1];
+	int			applied = 0, ret = FAIL;
+
+	*full_refresh = 1;
+
+	/* configuration data without revisions is sent by older servers */
+	if (SUCCEED != zbx_json_brackets_by_name(jp_obj, ZBX_PROTO_TAG_REVISIONS, &jp_table))
+		return SUCCEED;
+
+	zbx_hashset_create(&revisions, 100, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_hashset_create(&revisions_applied, 100, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_hashset_create(&included, 100, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	if (SUCCEED != proxyconfig_parse_revisions(&jp_table, &revisions))
+	{
+		*error = zbx_dsprintf(*error, "invalid revisions of table \"%s\"", table->table);
+		goto out;
+	}
+
+	while (NULL != (p = zbx_json_next(jp_data, p)))
+	{
+		if (FAIL == zbx_json_brackets_open(p, &jp_row) ||
+				NULL == zbx_json_next_value(&jp_row, NULL, buf, sizeof(buf), NULL))
+		{
+			*error = zbx_strdup(*error, zbx_json_strerror());
+			goto out;
+		}
+
+		ZBX_STR2UINT64(recid, buf);
+		bucket = recid / ZBX_PROXYCONFIG_BUCKET_SIZE;
+		zbx_hashset_insert(&included, &bucket, sizeof(bucket));
+	}
+
+	if (NULL != jp_revisions && SUCCEED == zbx_json_brackets_by_name(jp_revisions, table->table, &jp_table))
+	{
+		if (SUCCEED == proxyconfig_parse_revisions(&jp_table, &revisions_applied))
+			applied = 1;
+		else
+			zbx_hashset_clear(&revisions_applied);
+	}
+
+	/* the buckets without received rows must be already applied with the same revision */
+	zbx_hashset_iter_reset(&revisions, &iter);
+	while (NULL != (revision = (zbx_uint64_pair_t *)zbx_hashset_iter_next(&iter)))
+	{
+		if (NULL != zbx_hashset_search(&included, &revision->first))
+			continue;
+
+		if (NULL == (revision_applied = (zbx_uint64_pair_t *)zbx_hashset_search(&revisions_applied,
+				&revision->first)) || revision_applied->second != revision->second)
+		{
+			*error = zbx_dsprintf(*error, "incomplete configuration data of table \"%s\"", table->table);
+			goto out;
+		}
+	}
+
+	if (0 != applied)
+	{
+		*full_refresh = 0;
+
+		zbx_hashset_iter_reset(&included, &iter);
+		while (NULL != (pbucket = (zbx_uint64_t *)zbx_hashset_iter_next(&iter)))
+			zbx_vector_uint64_append(buckets, *pbucket);
+
+		/* records of the buckets removed on server must be deleted */
+		zbx_hashset_iter_reset(&revisions_applied, &iter);
+		while (NULL != (revision_applied = (zbx_uint64_pair_t *)zbx_hashset_iter_next(&iter)))
+		{
+			if (NULL == zbx_hashset_search(&revisions, &revision_applied->first))
+				zbx_vector_uint64_append(buckets, revision_applied->first);
+		}
+
+		zbx_vector_uint64_sort(buckets, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+		zbx_vector_uint64_uniq(buckets, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	}
+
+	ret = SUCCEED;
+out:
+	zbx_hashset_destroy(&included);
+	zbx_hashset_destroy(&revisions_applied);
+	zbx_hashset_destroy(&revisions);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxyconfig_add_buckets_condition                                *
+ *                                                                            *
+ * Purpose: add record id condition matching the specified buckets to sql     *
+ *          query                                                             *
+ *                                                                            *
+ * Parameters: sql        - [IN/OUT] the sql query                            *
+ *             sql_alloc  - [IN/OUT] the sql query allocated size             *
+ *             sql_offset - [IN/OUT] the sql query length                     *
+ *             recid      - [IN] the record id field name                     *
+ *             buckets    - [IN] the sorted buckets                           *
+ *                                                                            *
+ * Comments: The condition is not added if the buckets form too many record   *
+ *           id ranges, the caller must filter the selected records then.     *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxyconfig_add_buckets_condition(char **sql, size_t *sql_alloc, size_t *sql_offset, const char *recid,
+		const zbx_vector_uint64_t *buckets)
+{
+	int		i, ranges = 0;
+	zbx_uint64_t	first;
+	const char	*separator = "";
+
+	for (i = 0; i < buckets->values_num; i++)
+	{
+		if (0 == i || buckets->values[i - 1] + 1 != buckets->values[i])
+			ranges++;
+	}
+
+	if (0 == ranges || ZBX_PROXYCONFIG_RANGES_MAX < ranges)
+		return;
+
+	zbx_strcpy_alloc(sql, sql_alloc, sql_offset, " where (");
+
+	for (i = 0; i < buckets->values_num; i++)
+	{
+		first = buckets->values[i];
+
+		while (i + 1 < buckets->values_num && buckets->values[i] + 1 == buckets->values[i + 1])
+			i++;
+
+		zbx_snprintf_alloc(sql, sql_alloc, sql_offset, "%s%s between " ZBX_FS_UI64 " and " ZBX_FS_UI64,
+				separator, recid, first * ZBX_PROXYCONFIG_BUCKET_SIZE,
+				(buckets->values[i] + 1) * ZBX_PROXYCONFIG_BUCKET_SIZE - 1);
+		separator = " or ";
+	}
+
+	zbx_chrcpy_alloc(sql, sql_alloc, sql_offset, ')');
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: process_proxyconfig_table                                        *
@@ -1186,23 +1604,25 @@ static int	compare_nth_field(const ZBX_FIELD **fields, const char *rec_data, int
  * Purpose: update configuration table                                        *
  *                                                                            *
  * Parameters: ...                                                            *
- *             del - [OUT] ids of the removed records that must be deleted    *
- *                         from database                                      *
+ *             jp_revisions - [IN] the revisions of previously applied        *
+ *                                 configuration data, can be NULL            *
+ *             del          - [OUT] ids of the removed records that must be   *
+ *                                  deleted from database                     *
  *                                                                            *
  * Return value: SUCCEED - processed successfully                             *
  *               FAIL - an error occurred                                     *
  *                                                                            *
  ******************************************************************************/
 static int	process_proxyconfig_table(const ZBX_TABLE *table, struct zbx_json_parse *jp_obj,
-		zbx_vector_uint64_t *del, char **error)
+		const struct zbx_json_parse *jp_revisions, zbx_vector_uint64_t *del, char **error)
 {
 	int			f, fields_count, ret = FAIL, id_field_nr = 0, move_out = 0,
-				move_field_nr = 0;
+				move_field_nr = 0, full_refresh;
 	const ZBX_FIELD		*fields[ZBX_MAX_FIELDS];
 	struct zbx_json_parse	jp_data, jp_row;
 	const char		*p, *pf;
 	zbx_uint64_t		recid, *p_recid = NULL;
-	zbx_vector_uint64_t	ins, moves, availability_hostids;
+	zbx_vector_uint64_t	ins, moves, availability_hostids, buckets;
 	char			*buf = NULL, *esc, *sql = NULL, *recs = NULL;
 	size_t			sql_alloc = 4 * ZBX_KIBIBYTE, sql_offset,
 				recs_alloc = 20 * ZBX_KIBIBYTE, recs_offset = 0,
@@ -1219,6 +1639,8 @@ static int	process_proxyconfig_table(const ZBX_TABLE *table, struct zbx_json_par
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() table:'%s'", __func__, table->table);
 
+	zbx_vector_uint64_create(&buckets);
+
 	/************************************************************************************/
 	/* T1. RECEIVED JSON (jp_obj) DATA FORMAT                                           */
 	/************************************************************************************/
@@ -1314,6 +1736,22 @@ static int	process_proxyconfig_table(const ZBX_TABLE *table, struct zbx_json_par
 		goto out;
 	}
 
+	if (SUCCEED != proxyconfig_get_refresh_buckets(table, jp_obj, &jp_data, jp_revisions, &buckets,
+			&full_refresh, error))
+	{
+		goto out;
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() table:'%s' full_refresh:%d buckets:%d", __func__, table->table,
+			full_refresh, buckets.values_num);
+
+	/* none of the table buckets were changed */
+	if (0 == full_refresh && 0 == buckets.values_num)
+	{
+		ret = SUCCEED;
+		goto out;
+	}
+
 	/* all records will be stored in one large string */
 	recs = (char *)zbx_malloc(recs, recs_alloc);
 
@@ -1342,13 +1780,22 @@ static int	process_proxyconfig_table(const ZBX_TABLE *table, struct zbx_json_par
 	/* Find a number of the ID field. Usually the 1st field. */
 	id_field_nr = find_field_by_name(fields, fields_count, table->recid);
 
-	/* select all existing records */
+	/* select all existing records or the records of changed buckets */
+	if (0 == full_refresh)
+		proxyconfig_add_buckets_condition(&sql, &sql_alloc, &sql_offset, table->recid, &buckets);
+
 	result = DBselect("%s", sql);
 
 	while (NULL != (row = DBfetch(result)))
 	{
 		ZBX_STR2UINT64(recid, row[id_field_nr]);
 
+		if (0 == full_refresh && FAIL == zbx_vector_uint64_bsearch(&buckets,
+				recid / ZBX_PROXYCONFIG_BUCKET_SIZE, ZBX_DEFAULT_UINT64_COMPARE_FUNC))
+		{
+			continue;
+		}
+
 		id_offset.id = recid;
 		id_offset.offset = recs_offset;
 
@@ -1814,6 +2261,7 @@ clean2:
 	zbx_free(sql);
 	zbx_free(recs);
 out:
+	zbx_vector_uint64_destroy(&buckets);
 	zbx_free(buf);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
@@ -1821,12 +2269,43 @@ out:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: proxyconfig_add_table_revisions                                  *
+ *                                                                            *
+ * Purpose: add the received table revisions to the applied revisions         *
+ *                                                                            *
+ * Parameters: j         - [OUT] the applied revisions                        *
+ *             table     - [IN] the table name                                *
+ *             jp_table  - [IN] the received table revisions                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxyconfig_add_table_revisions(struct zbx_json *j, const char *table,
+		const struct zbx_json_parse *jp_table)
+{
+	size_t	len;
+	char	*revisions;
+
+	len = (size_t)(jp_table->end - jp_table->start + 1);
+	revisions = (char *)zbx_malloc(NULL, len + 1);
+	memcpy(revisions, jp_table->start, len);
+	revisions[len] = '\0';
+
+	zbx_json_addraw(j, table, revisions);
+
+	zbx_free(revisions);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: process_proxyconfig                                              *
  *                                                                            *
  * Purpose: update configuration                                              *
  *                                                                            *
+ * Comments: The table bucket revisions received with configuration data are  *
+ *           kept in configuration cache after successful update and reported *
+ *           to server when requesting the next configuration.                *
+ *                                                                            *
  ******************************************************************************/
 void	process_proxyconfig(struct zbx_json_parse *jp_data)
 {
@@ -1839,8 +2318,9 @@ void	process_proxyconfig(struct zbx_json_parse *jp_data)
 
 	char			buf[ZBX_TABLENAME_LEN_MAX];
 	const char		*p = NULL;
-	struct zbx_json_parse	jp_obj;
-	char			*error = NULL;
+	struct zbx_json_parse	jp_obj, jp_revisions, jp_table_revisions, *pjp_revisions = NULL;
+	struct zbx_json		j_revisions;
+	char			*error = NULL, *revisions;
 	int			i, ret = SUCCEED;
 
 	table_ids_t		*table_ids;
@@ -1850,6 +2330,10 @@ void	process_proxyconfig(struct zbx_json_parse *jp_data)
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
 	zbx_vector_ptr_create(&tables_proxy);
+	zbx_json_init(&j_revisions, ZBX_JSON_STAT_BUF_LEN);
+
+	if (NULL != (revisions = DCget_proxyconfig_revisions()) && SUCCEED == zbx_json_open(revisions, &jp_revisions))
+		pjp_revisions = &jp_revisions;
 
 	DBbegin();
 
@@ -1875,7 +2359,13 @@ void	process_proxyconfig(struct zbx_json_parse *jp_data)
 		zbx_vector_uint64_create(&table_ids->ids);
 		zbx_vector_ptr_append(&tables_proxy, table_ids);
 
-		ret = process_proxyconfig_table(table, &jp_obj, &table_ids->ids, &error);
+		ret = process_proxyconfig_table(table, &jp_obj, pjp_revisions, &table_ids->ids, &error);
+
+		if (SUCCEED == ret && SUCCEED == zbx_json_brackets_by_name(&jp_obj, ZBX_PROTO_TAG_REVISIONS,
+				&jp_table_revisions))
+		{
+			proxyconfig_add_table_revisions(&j_revisions, table->table, &jp_table_revisions);
+		}
 	}
 
 	if (SUCCEED == ret)
@@ -1925,13 +2415,19 @@ void	process_proxyconfig(struct zbx_json_parse *jp_data)
 	{
 		zabbix_log(LOG_LEVEL_ERR, "failed to update local proxy configuration copy: %s",
 				(NULL == error ? "database error" : error));
+
+		/* request full configuration next time */
+		DCset_proxyconfig_revisions(NULL);
 	}
 	else
 	{
 		DCsync_configuration(ZBX_DBSYNC_UPDATE);
 		DCupdate_hosts_availability();
+		DCset_proxyconfig_revisions(j_revisions.buffer);
 	}
 
+	zbx_json_free(&j_revisions);
+	zbx_free(revisions);
 	zbx_free(error);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
@@ -2214,6 +2710,247 @@ void	proxy_set_areg_lastid(const zbx_uint64_t lastid)
 	proxy_set_lastid(areg.table, areg.lastidfield, lastid);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_hist_lanes_init                                            *
+ *                                                                            *
+ ******************************************************************************/
+void	proxy_hist_lanes_init(zbx_proxy_hist_lanes_t *lanes)
+{
+	zbx_vector_uint64_pair_create(&lanes->backlogs);
+	lanes->fresh_lastid = 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_hist_lanes_destroy                                         *
+ *                                                                            *
+ ******************************************************************************/
+void	proxy_hist_lanes_destroy(zbx_proxy_hist_lanes_t *lanes)
+{
+	zbx_vector_uint64_pair_destroy(&lanes->backlogs);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_hist_lanes_lastid                                          *
+ *                                                                            *
+ * Purpose: get the id of last history record, all records up to it are       *
+ *          sent                                                              *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint64_t	proxy_hist_lanes_lastid(const zbx_proxy_hist_lanes_t *lanes)
+{
+	if (0 == lanes->backlogs.values_num)
+		return lanes->fresh_lastid;
+
+	return lanes->backlogs.values[0].first;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_hist_lanes_validate                                        *
+ *                                                                            *
+ * Purpose: check that backlog ranges are ordered, do not overlap and follow  *
+ *          the id of last history record                                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	proxy_hist_lanes_validate(const zbx_proxy_hist_lanes_t *lanes, zbx_uint64_t lastid)
+{
+	const zbx_uint64_pair_t	*range;
+	int			i;
+
+	for (i = 0; i < lanes->backlogs.values_num; i++)
+	{
+		range = &lanes->backlogs.values[i];
+
+		if (range->first < lastid || range->second <= range->first || (0 == i && range->first != lastid))
+			return FAIL;
+
+		lastid = range->second;
+	}
+
+	return lastid <= lanes->fresh_lastid ? SUCCEED : FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_get_hist_lanes                                             *
+ *                                                                            *
+ * Purpose: get the history sending positions of fresh data and backfill      *
+ *          lanes                                                             *
+ *                                                                            *
+ * Parameters: lanes - [OUT] the history lane positions                       *
+ *                                                                            *
+ * Comments: Records in backlog ranges are sent by backfill lane and records  *
+ *           after fresh_lastid are sent by fresh data lane. The records      *
+ *           between backlog ranges were already sent by fresh data lane.     *
+ *                                                                            *
+ ******************************************************************************/
+void	proxy_get_hist_lanes(zbx_proxy_hist_lanes_t *lanes)
+{
+	zbx_uint64_t		lastid, backlogs_num;
+	zbx_uint64_pair_t	range;
+	char			field[ZBX_FIELDNAME_LEN_MAX];
+	int			i;
+
+	zbx_vector_uint64_pair_clear(&lanes->backlogs);
+
+	proxy_get_lastid("proxy_history", "history_lastid", &lastid);
+	proxy_get_lastid("proxy_history", "history_fresh_lastid", &lanes->fresh_lastid);
+	proxy_get_lastid("proxy_history", "history_backlogs", &backlogs_num);
+
+	for (i = 0; i < (int)backlogs_num && i < ZBX_PROXY_HIST_BACKLOGS_MAX; i++)
+	{
+		zbx_snprintf(field, sizeof(field), "history_backlog%d_lastid", i);
+		proxy_get_lastid("proxy_history", field, &range.first);
+		zbx_snprintf(field, sizeof(field), "history_backlog%d_maxid", i);
+		proxy_get_lastid("proxy_history", field, &range.second);
+		zbx_vector_uint64_pair_append(&lanes->backlogs, range);
+	}
+
+	/* lanes are not initialized yet or history was sent by a single stream */
+	if (0 == lanes->backlogs.values_num || SUCCEED != proxy_hist_lanes_validate(lanes, lastid))
+	{
+		zbx_vector_uint64_pair_clear(&lanes->backlogs);
+		lanes->fresh_lastid = lastid;
+	}
+}
+
+void	proxy_set_hist_lanes(const zbx_proxy_hist_lanes_t *lanes)
+{
+	char	field[ZBX_FIELDNAME_LEN_MAX];
+	int	i;
+
+	proxy_set_lastid("proxy_history", "history_lastid", proxy_hist_lanes_lastid(lanes));
+	proxy_set_lastid("proxy_history", "history_fresh_lastid", lanes->fresh_lastid);
+	proxy_set_lastid("proxy_history", "history_backlogs", (zbx_uint64_t)lanes->backlogs.values_num);
+
+	for (i = 0; i < lanes->backlogs.values_num; i++)
+	{
+		zbx_snprintf(field, sizeof(field), "history_backlog%d_lastid", i);
+		proxy_set_lastid("proxy_history", field, lanes->backlogs.values[i].first);
+		zbx_snprintf(field, sizeof(field), "history_backlog%d_maxid", i);
+		proxy_set_lastid("proxy_history", field, lanes->backlogs.values[i].second);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_hist_lanes_skip                                            *
+ *                                                                            *
+ * Purpose: leave large history backlog to backfill lane so the fresh data    *
+ *          lane continues with the newest records                            *
+ *                                                                            *
+ * Parameters: lanes - [IN/OUT] the history lane positions                    *
+ *             maxid - [IN] the id of the newest history record               *
+ *                                                                            *
+ * Return value: SUCCEED - the backlog was moved to backfill lane             *
+ *               FAIL    - the backlog is small or the maximum number of      *
+ *                         backlog ranges is pending                          *
+ *                                                                            *
+ * Comments: A backlog directly following the last backlog range extends      *
+ *           it, otherwise a new range is added after the records already     *
+ *           sent by fresh data lane.                                         *
+ *                                                                            *
+ ******************************************************************************/
+int	proxy_hist_lanes_skip(zbx_proxy_hist_lanes_t *lanes, zbx_uint64_t maxid)
+{
+	zbx_uint64_pair_t	range, *last;
+
+	if (maxid <= lanes->fresh_lastid + ZBX_MAX_HRECORDS_TOTAL)
+		return FAIL;
+
+	range.first = lanes->fresh_lastid;
+	range.second = maxid - ZBX_MAX_HRECORDS;
+
+	if (0 != lanes->backlogs.values_num &&
+			(last = &lanes->backlogs.values[lanes->backlogs.values_num - 1])->second == range.first)
+	{
+		last->second = range.second;
+	}
+	else if (ZBX_PROXY_HIST_BACKLOGS_MAX > lanes->backlogs.values_num)
+		zbx_vector_uint64_pair_append(&lanes->backlogs, range);
+	else
+		return FAIL;
+
+	lanes->fresh_lastid = range.second;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_hist_lanes_fresh_sent                                      *
+ *                                                                            *
+ * Purpose: update history lane positions after server accepted records sent  *
+ *          by fresh data lane                                                *
+ *                                                                            *
+ * Parameters: lanes       - [IN/OUT] the history lane positions              *
+ *             sent_lastid - [IN] the id of last sent record                  *
+ *                                                                            *
+ ******************************************************************************/
+void	proxy_hist_lanes_fresh_sent(zbx_proxy_hist_lanes_t *lanes, zbx_uint64_t sent_lastid)
+{
+	lanes->fresh_lastid = sent_lastid;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_hist_lanes_backfill_sent                                   *
+ *                                                                            *
+ * Purpose: update history lane positions after server accepted records sent  *
+ *          by backfill lane                                                  *
+ *                                                                            *
+ * Parameters: lanes       - [IN/OUT] the history lane positions              *
+ *             sent_lastid - [IN] the id of last sent record, 0 if there were *
+ *                                no records in the oldest backlog range      *
+ *             more        - [IN] ZBX_PROXY_DATA_MORE if the oldest backlog   *
+ *                                range might have more records               *
+ *                                                                            *
+ * Comments: Backfill lane sends the oldest backlog range first. When the     *
+ *           range is sent it is removed and the records up to the next range *
+ *           or fresh data lane position are sent.                            *
+ *                                                                            *
+ ******************************************************************************/
+void	proxy_hist_lanes_backfill_sent(zbx_proxy_hist_lanes_t *lanes, zbx_uint64_t sent_lastid, int more)
+{
+	zbx_uint64_pair_t	*range;
+
+	if (0 == lanes->backlogs.values_num)
+		return;
+
+	range = &lanes->backlogs.values[0];
+
+	if (ZBX_PROXY_DATA_MORE != more || sent_lastid >= range->second)
+		zbx_vector_uint64_pair_remove(&lanes->backlogs, 0);
+	else if (sent_lastid > range->first)
+		range->first = sent_lastid;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_get_hist_maxid                                             *
+ *                                                                            *
+ * Purpose: get the id of the newest proxy history record                     *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint64_t	proxy_get_hist_maxid(void)
+{
+	DB_RESULT	result;
+	DB_ROW		row;
+	zbx_uint64_t	maxid = 0;
+
+	result = DBselect("select max(id) from proxy_history");
+
+	if (NULL != (row = DBfetch(result)) && SUCCEED != DBis_null(row[0]))
+		ZBX_STR2UINT64(maxid, row[0]);
+
+	DBfree_result(result);
+
+	return maxid;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: proxy_get_history_data_simple                                    *
@@ -2332,6 +3069,10 @@ zbx_history_data_t;
  *                                                                            *
  * Parameters: lastid             - [IN] the id of last processed proxy       *
  *                                       history record                       *
+ *             maxid              - [IN] the id of last record to read, 0 -   *
+ *                                       no limit                             *
+ *             records_max        - [IN] the maximum number of records to     *
+ *                                       read                                 *
  *             data               - [IN/OUT] the proxy history data buffer    *
  *             data_alloc         - [IN/OUT] the size of proxy history data   *
  *                                           buffer                           *
@@ -2343,8 +3084,9 @@ zbx_history_data_t;
  * Return value: The number of records read.                                  *
  *                                                                            *
  ******************************************************************************/
-static int	proxy_get_history_data(zbx_uint64_t lastid, zbx_history_data_t **data, size_t *data_alloc,
-		char **string_buffer, size_t *string_buffer_alloc, int *more)
+static int	proxy_get_history_data(zbx_uint64_t lastid, zbx_uint64_t maxid, int records_max,
+		zbx_history_data_t **data, size_t *data_alloc, char **string_buffer, size_t *string_buffer_alloc,
+		int *more)
 {
 
 	DB_RESULT		result;
@@ -2357,18 +3099,24 @@ static int	proxy_get_history_data(zbx_uint64_t lastid, zbx_history_data_t **data
 	struct timespec		t_sleep = { 0, 100000000L }, t_rem;
 	zbx_history_data_t	*hd;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() lastid:" ZBX_FS_UI64, __func__, lastid);
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() lastid:" ZBX_FS_UI64 " maxid:" ZBX_FS_UI64, __func__, lastid, maxid);
 
+	if (ZBX_MAX_HRECORDS < records_max)
+		records_max = ZBX_MAX_HRECORDS;
 try_again:
 	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
 			"select id,itemid,clock,ns,timestamp,source,severity,"
 				"value,logeventid,state,lastlogsize,mtime,flags"
 			" from proxy_history"
-			" where id>" ZBX_FS_UI64
-			" order by id",
+			" where id>" ZBX_FS_UI64,
 			lastid);
 
-	result = DBselectN(sql, ZBX_MAX_HRECORDS - data_num);
+	if (0 != maxid)
+		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, " and id<=" ZBX_FS_UI64, maxid);
+
+	zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " order by id");
+
+	result = DBselectN(sql, records_max - data_num);
 
 	zbx_free(sql);
 
@@ -2460,7 +3208,7 @@ try_again:
 	}
 	DBfree_result(result);
 
-	if (ZBX_MAX_HRECORDS != data_num && 1 == retries)
+	if ((size_t)records_max != data_num && 1 == retries)
 		*more = ZBX_PROXY_DATA_DONE;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() data_num:" ZBX_FS_SIZE_T, __func__, data_num);
@@ -2474,22 +3222,33 @@ try_again:
  *                                                                            *
  * Purpose: add history records to output json                                *
  *                                                                            *
- * Parameters: j             - [IN] the json output buffer                    *
- *             records_num   - [IN] the total number of records added         *
+ * Parameters: jsons         - [IN] the json output buffers                   *
+ *             jsons_num     - [IN] the number of json output buffers         *
+ *             jsons_lastids - [IN] the id of last record already accepted by *
+ *                                  server for each json output buffer,       *
+ *                                  NULL - no records were accepted yet       *
+ *             records_num   - [IN/OUT] the number of records added to each   *
+ *                                      json output buffer                    *
  *             dc_items      - [IN] the item configuration data               *
  *             errcodes      - [IN] the item configuration status codes       *
  *             records       - [IN] the records to add                        *
  *             string_buffer - [IN] the string buffer holding string values   *
  *             lastid        - [OUT] the id of last added record              *
  *                                                                            *
- * Return value: The total number of records added.                           *
+ * Return value: The number of records added.                                 *
+ *                                                                            *
+ * Comments: Records of the same item are always added to the same json       *
+ *           output buffer, so the records accepted by server for one buffer  *
+ *           can be skipped when the same range is read again.                *
  *                                                                            *
  ******************************************************************************/
-static int	proxy_add_hist_data(struct zbx_json *j, int records_num, const DC_ITEM *dc_items, const int *errcodes,
-		const zbx_vector_ptr_t *records, const char *string_buffer, zbx_uint64_t *lastid)
+static int	proxy_add_hist_data(struct zbx_json **jsons, int jsons_num, const zbx_uint64_t *jsons_lastids,
+		int *records_num, const DC_ITEM *dc_items, const int *errcodes, const zbx_vector_ptr_t *records,
+		const char *string_buffer, zbx_uint64_t *lastid)
 {
-	int				i;
+	int				i, index, added_num = 0;
 	const zbx_history_data_t	*hd;
+	struct zbx_json			*j;
 
 	for (i = records->values_num - 1; i >= 0; i--)
 	{
@@ -2511,7 +3270,14 @@ static int	proxy_add_hist_data(struct zbx_json *j, int records_num, const DC_ITE
 				continue;
 		}
 
-		if (0 == records_num)
+		index = (int)(hd->itemid % (zbx_uint64_t)jsons_num);
+
+		if (NULL != jsons_lastids && hd->id <= jsons_lastids[index])
+			continue;
+
+		j = jsons[index];
+
+		if (0 == records_num[index])
 			zbx_json_addarray(j, ZBX_PROTO_TAG_HISTORY_DATA);
 
 		zbx_json_addobject(j, NULL);
@@ -2554,20 +3320,68 @@ static int	proxy_add_hist_data(struct zbx_json *j, int records_num, const DC_ITE
 		}
 
 		zbx_json_close(j);
-		records_num++;
+		records_num[index]++;
+		added_num++;
 
 		/* stop gathering data to avoid exceeding the maximum packet size */
 		if (ZBX_DATA_JSON_RECORD_LIMIT < j->buffer_offset)
 			break;
 	}
 
-	return records_num;
+	return added_num;
 }
 
-int	proxy_get_hist_data(struct zbx_json *j, zbx_uint64_t *lastid, int *more)
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_jsons_size                                                 *
+ *                                                                            *
+ * Purpose: get the size of the largest json output buffer                    *
+ *                                                                            *
+ ******************************************************************************/
+static size_t	proxy_jsons_size(struct zbx_json **jsons, int jsons_num)
 {
-	int			records_num = 0, data_num, i, *errcodes = NULL, items_alloc = 0;
-	zbx_uint64_t		id;
+	int	i;
+	size_t	size = 0;
+
+	for (i = 0; i < jsons_num; i++)
+	{
+		if (size < jsons[i]->buffer_offset)
+			size = jsons[i]->buffer_offset;
+	}
+
+	return size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_get_hist_data_range                                        *
+ *                                                                            *
+ * Purpose: add proxy history records from the specified id range to output   *
+ *          json                                                              *
+ *                                                                            *
+ * Parameters: jsons         - [IN/OUT] the json output buffers, the records  *
+ *                                      are distributed between buffers by    *
+ *                                      item                                  *
+ *             jsons_num     - [IN] the number of json output buffers         *
+ *             jsons_lastids - [IN] the id of last record already accepted by *
+ *                                  server for each json output buffer,       *
+ *                                  NULL - no records were accepted yet       *
+ *             id            - [IN] the id of last sent record, only records  *
+ *                                  with larger ids are added                 *
+ *             maxid         - [IN] the id of last record to add, 0 - no      *
+ *                                  limit                                     *
+ *             records_max   - [IN] the maximum number of records to read     *
+ *             lastid        - [OUT] the id of last added record              *
+ *             more          - [OUT] set to ZBX_PROXY_DATA_MORE if there      *
+ *                                   might be more data in the range          *
+ *                                                                            *
+ * Return value: The number of records added.                                 *
+ *                                                                            *
+ ******************************************************************************/
+int	proxy_get_hist_data_range(struct zbx_json **jsons, int jsons_num, const zbx_uint64_t *jsons_lastids,
+		zbx_uint64_t id, zbx_uint64_t maxid, int records_max, zbx_uint64_t *lastid, int *more)
+{
+	int			records_num = 0, data_num, i, *errcodes = NULL, items_alloc = 0, *jsons_records_num;
 	zbx_hashset_t		itemids_added;
 	zbx_history_data_t	*data;
 	char			*string_buffer;
@@ -2582,9 +3396,9 @@ int	proxy_get_hist_data(struct zbx_json *j, zbx_uint64_t *lastid, int *more)
 	zbx_vector_ptr_create(&records);
 	data = (zbx_history_data_t *)zbx_malloc(NULL, data_alloc * sizeof(zbx_history_data_t));
 	string_buffer = (char *)zbx_malloc(NULL, string_buffer_alloc);
+	jsons_records_num = (int *)zbx_calloc(NULL, jsons_num, sizeof(int));
 
 	*more = ZBX_PROXY_DATA_MORE;
-	proxy_get_lastid("proxy_history", "history_lastid", &id);
 
 	zbx_hashset_create(&itemids_added, data_alloc, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
@@ -2592,9 +3406,9 @@ int	proxy_get_hist_data(struct zbx_json *j, zbx_uint64_t *lastid, int *more)
 	/*   1) there are no more data to read                                  */
 	/*   2) we have retrieved more than the total maximum number of records */
 	/*   3) we have gathered more than half of the maximum packet size      */
-	while (ZBX_DATA_JSON_BATCH_LIMIT > j->buffer_offset && ZBX_MAX_HRECORDS_TOTAL > records_num &&
-			0 != (data_num = proxy_get_history_data(id, &data, &data_alloc, &string_buffer,
-					&string_buffer_alloc, more)))
+	while (ZBX_DATA_JSON_BATCH_LIMIT > proxy_jsons_size(jsons, jsons_num) && records_max > records_num &&
+			0 != (data_num = proxy_get_history_data(id, maxid, records_max - records_num, &data,
+					&data_alloc, &string_buffer, &string_buffer_alloc, more)))
 	{
 		zbx_vector_uint64_reserve(&itemids, data_num);
 		zbx_vector_ptr_reserve(&records, data_num);
@@ -2625,7 +3439,8 @@ int	proxy_get_hist_data(struct zbx_json *j, zbx_uint64_t *lastid, int *more)
 
 		DCconfig_get_items_by_itemids(dc_items, itemids.values, errcodes, itemids.values_num);
 
-		records_num = proxy_add_hist_data(j, records_num, dc_items, errcodes, &records, string_buffer, lastid);
+		records_num += proxy_add_hist_data(jsons, jsons_num, jsons_lastids, jsons_records_num, dc_items,
+				errcodes, &records, string_buffer, lastid);
 		DCconfig_clean_items(dc_items, errcodes, itemids.values_num);
 
 		/* got less data than requested - either no more data to read or the history is full of */
@@ -2639,8 +3454,11 @@ int	proxy_get_hist_data(struct zbx_json *j, zbx_uint64_t *lastid, int *more)
 		id = *lastid;
 	}
 
-	if (0 != records_num)
-		zbx_json_close(j);
+	for (i = 0; i < jsons_num; i++)
+	{
+		if (0 != jsons_records_num[i])
+			zbx_json_close(jsons[i]);
+	}
 
 	zbx_hashset_destroy(&itemids_added);
 
@@ -2648,15 +3466,25 @@ int	proxy_get_hist_data(struct zbx_json *j, zbx_uint64_t *lastid, int *more)
 	zbx_free(errcodes);
 	zbx_free(data);
 	zbx_free(string_buffer);
+	zbx_free(jsons_records_num);
 	zbx_vector_ptr_destroy(&records);
 	zbx_vector_uint64_destroy(&itemids);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() lastid:" ZBX_FS_UI64 " records_num:%d size:~" ZBX_FS_SIZE_T " more:%d",
-			__func__, *lastid, records_num, j->buffer_offset, *more);
+			__func__, *lastid, records_num, proxy_jsons_size(jsons, jsons_num), *more);
 
 	return records_num;
 }
 
+int	proxy_get_hist_data(struct zbx_json *j, zbx_uint64_t *lastid, int *more)
+{
+	zbx_uint64_t	id;
+
+	proxy_get_lastid("proxy_history", "history_lastid", &id);
+
+	return proxy_get_hist_data_range(&j, 1, NULL, id, 0, ZBX_MAX_HRECORDS_TOTAL, lastid, more);
+}
+
 int	proxy_get_dhis_data(struct zbx_json *j, zbx_uint64_t *lastid, int *more)
 {
 	int		records_num = 0;
@@ -2802,7 +3630,7 @@ static void	process_item_value(const DC_ITEM *item, AGENT_RESULT *result, zbx_ti
 		if (0 != (ZBX_FLAG_DISCOVERY_RULE & item->flags))
 			zbx_lld_process_agent_result(item->itemid, result, ts, error);
 		else
-			dc_add_history(item->itemid, item->value_type, item->flags, result, ts, item->state, error);
+			dc_add_history(item->itemid, item->value_type, item->flags, result, ts, item->state, error, 0);
 	}
 }
 
@@ -4749,3 +5577,7 @@ int	zbx_check_protocol_version(DC_PROXY *proxy)
 out:
 	return ret;
 }
+
+#ifdef HAVE_TESTS
+#	include "../../../tests/libs/zbxdbhigh/get_proxyconfig_table_items_test.c"
+#endif
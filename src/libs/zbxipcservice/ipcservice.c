@@ -1966,7 +1966,7 @@ int	zbx_ipc_async_socket_recv(zbx_ipc_async_socket_t *asocket, int timeout, zbx_
 		event_base_loop(asocket->ev, flags);
 		*message = (zbx_ipc_message_t *)zbx_queue_ptr_pop(&asocket->client->rx_queue);
 	}
-	while (NULL == *message && ZBX_IPC_ASYNC_SOCKET_STATE_NONE == asocket->state);
+	while (NULL == *message && 0 != timeout && ZBX_IPC_ASYNC_SOCKET_STATE_NONE == asocket->state);
 
 	if (SUCCEED == ZBX_CHECK_LOG_LEVEL(LOG_LEVEL_TRACE) && NULL != *message)
 	{
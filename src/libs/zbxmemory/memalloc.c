@@ -779,6 +779,41 @@ void	zbx_mem_dump_stats(int level, zbx_mem_info_t *info)
 	zabbix_log(level, "================================");
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mem_get_stats                                                *
+ *                                                                            *
+ * Purpose: get memory usage and fragmentation statistics                     *
+ *                                                                            *
+ * Parameters: info  - [IN] the memory information                            *
+ *             stats - [OUT] the memory statistics                            *
+ *                                                                            *
+ * Comments: The caller must hold the lock protecting the memory.             *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_mem_get_stats(const zbx_mem_info_t *info, zbx_mem_stats_t *stats)
+{
+	void	*chunk;
+	int	index;
+
+	memset(stats, 0, sizeof(zbx_mem_stats_t));
+
+	for (index = 0; index < MEM_BUCKET_COUNT; index++)
+	{
+		for (chunk = info->buckets[index]; NULL != chunk; chunk = mem_get_next_chunk(chunk))
+		{
+			stats->free_chunks++;
+			stats->max_free_chunk = MAX(stats->max_free_chunk, CHUNK_SIZE(chunk));
+		}
+	}
+
+	stats->total_size = info->total_size;
+	stats->free_size = info->free_size;
+	stats->used_size = info->used_size;
+	stats->used_chunks = (info->total_size - info->used_size - info->free_size) / (2 * MEM_SIZE_FIELD) + 1 -
+			stats->free_chunks;
+}
+
 size_t	zbx_mem_required_size(int chunks_num, const char *descr, const char *param)
 {
 	size_t	size = 0;
@@ -106,6 +106,82 @@ static int	parse_log_level_options(const char *opt, size_t len, unsigned int *sc
 	return SUCCEED;
 }
 
+static int	parse_diaginfo_options(const char *opt, unsigned char program_type, unsigned int *scope,
+		unsigned int *data)
+{
+	const char	*rtc_options;
+	char		*section, *top;
+	unsigned short	num = ZBX_DIAGINFO_TOP_DEFAULT;
+	int		ret = FAIL;
+
+	rtc_options = opt + ZBX_CONST_STRLEN(ZBX_DIAGINFO);
+
+	if ('\0' == *rtc_options)
+	{
+		*scope = ZBX_DIAGINFO_HISTORYCACHE | ZBX_DIAGINFO_PREPROCESSING | ZBX_DIAGINFO_VMWARE;
+
+		if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+			*scope |= ZBX_DIAGINFO_VALUECACHE | ZBX_DIAGINFO_LLD;
+
+		*data = num;
+
+		return SUCCEED;
+	}
+
+	if ('=' != *rtc_options)
+	{
+		zbx_error("invalid runtime control option: %s", opt);
+		return FAIL;
+	}
+
+	section = zbx_strdup(NULL, rtc_options + 1);
+
+	if (NULL != (top = strchr(section, ',')))
+	{
+		*top++ = '\0';
+
+		/* convert the number of top items (e.g. "10" in "historycache,10") */
+		if (FAIL == is_ushort(top, &num) || 0 == num)
+		{
+			zbx_error("invalid diagnostic information option: invalid number of top items \"%s\"", top);
+			goto out;
+		}
+	}
+
+	if (0 == strcmp(section, ZBX_DIAGINFO_HISTORYCACHE_STR))
+	{
+		*scope = ZBX_DIAGINFO_HISTORYCACHE;
+	}
+	else if (0 == strcmp(section, ZBX_DIAGINFO_PREPROCESSING_STR))
+	{
+		*scope = ZBX_DIAGINFO_PREPROCESSING;
+	}
+	else if (0 == strcmp(section, ZBX_DIAGINFO_VMWARE_STR))
+	{
+		*scope = ZBX_DIAGINFO_VMWARE;
+	}
+	else if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER) && 0 == strcmp(section, ZBX_DIAGINFO_VALUECACHE_STR))
+	{
+		*scope = ZBX_DIAGINFO_VALUECACHE;
+	}
+	else if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER) && 0 == strcmp(section, ZBX_DIAGINFO_LLD_STR))
+	{
+		*scope = ZBX_DIAGINFO_LLD;
+	}
+	else
+	{
+		zbx_error("invalid diagnostic information option: unknown section \"%s\"", section);
+		goto out;
+	}
+
+	*data = num;
+	ret = SUCCEED;
+out:
+	zbx_free(section);
+
+	return ret;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: parse_rtc_options                                                *
@@ -116,7 +192,8 @@ static int	parse_log_level_options(const char *opt, size_t len, unsigned int *sc
  * Parameters: opt          - [IN] the command line argument                  *
  *             program_type - [IN] the program type                           *
  *             message      - [OUT] the message containing options for log    *
- *                                  level change or cache reload              *
+ *                                  level change, cache reload or diagnostic  *
+ *                                  information request                       *
  *                                                                            *
  * Return value: SUCCEED - the message was created successfully               *
  *               FAIL    - an error occurred                                  *
@@ -167,6 +244,14 @@ int	parse_rtc_options(const char *opt, unsigned char program_type, int *message)
 		return FAIL;
 #endif
 	}
+	else if (0 != (program_type & (ZBX_PROGRAM_TYPE_SERVER | ZBX_PROGRAM_TYPE_PROXY)) &&
+			0 == strncmp(opt, ZBX_DIAGINFO, ZBX_CONST_STRLEN(ZBX_DIAGINFO)))
+	{
+		command = ZBX_RTC_DIAGINFO;
+
+		if (SUCCEED != parse_diaginfo_options(opt, program_type, &scope, &data))
+			return FAIL;
+	}
 	else
 	{
 		zbx_error("invalid runtime control option: %s", opt);
@@ -21,6 +21,10 @@
 #include "zbxregexp.h"
 #include "log.h"
 
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
 struct zbx_regexp
 {
 	pcre			*pcre_regexp;
@@ -138,54 +142,76 @@ int	zbx_regexp_compile_ext(const char *pattern, zbx_regexp_t **regexp, int flags
 	return regexp_compile(pattern, flags, regexp, err_msg_static);
 }
 
+typedef struct
+{
+	zbx_regexp_t	*regexp;
+	char		*pattern;
+	int		flags;
+}
+zbx_regexp_cache_t;
+
 /****************************************************************************************************
  *                                                                                                  *
- * Function: regexp_prepare                                                                         *
+ * Function: regexp_prepare_cached                                                                  *
  *                                                                                                  *
- * Purpose: wrapper for zbx_regexp_compile. Caches and reuses the last used regexp.                 *
+ * Purpose: wrapper for zbx_regexp_compile. Reuses the regexp kept in the cache if it was compiled  *
+ *          from the same pattern with the same flags, otherwise replaces it.                       *
  *                                                                                                  *
  ****************************************************************************************************/
-static int	regexp_prepare(const char *pattern, int flags, zbx_regexp_t **regexp, const char **err_msg_static)
+static int	regexp_prepare_cached(zbx_regexp_cache_t *cache, const char *pattern, int flags,
+		zbx_regexp_t **regexp, const char **err_msg_static)
 {
-	static ZBX_THREAD_LOCAL zbx_regexp_t	*curr_regexp = NULL;
-	static ZBX_THREAD_LOCAL char		*curr_pattern = NULL;
-	static ZBX_THREAD_LOCAL int		curr_flags = 0;
-	int					ret = SUCCEED;
+	int	ret = SUCCEED;
 
-	if (NULL == curr_regexp || 0 != strcmp(curr_pattern, pattern) || curr_flags != flags)
+	if (NULL == cache->regexp || 0 != strcmp(cache->pattern, pattern) || cache->flags != flags)
 	{
-		if (NULL != curr_regexp)
+		if (NULL != cache->regexp)
 		{
-			zbx_regexp_free(curr_regexp);
-			zbx_free(curr_pattern);
+			zbx_regexp_free(cache->regexp);
+			zbx_free(cache->pattern);
 		}
 
-		curr_regexp = NULL;
-		curr_pattern = NULL;
-		curr_flags = 0;
+		cache->regexp = NULL;
+		cache->pattern = NULL;
+		cache->flags = 0;
 
-		if (SUCCEED == regexp_compile(pattern, flags, &curr_regexp, err_msg_static))
+		if (SUCCEED == regexp_compile(pattern, flags, &cache->regexp, err_msg_static))
 		{
-			curr_pattern = zbx_strdup(curr_pattern, pattern);
-			curr_flags = flags;
+			cache->pattern = zbx_strdup(cache->pattern, pattern);
+			cache->flags = flags;
 		}
 		else
 			ret = FAIL;
 	}
 
-	*regexp = curr_regexp;
+	*regexp = cache->regexp;
 	return ret;
 }
 
+/****************************************************************************************************
+ *                                                                                                  *
+ * Function: regexp_prepare                                                                         *
+ *                                                                                                  *
+ * Purpose: wrapper for zbx_regexp_compile. Caches and reuses the last used regexp.                 *
+ *                                                                                                  *
+ ****************************************************************************************************/
+static int	regexp_prepare(const char *pattern, int flags, zbx_regexp_t **regexp, const char **err_msg_static)
+{
+	static ZBX_THREAD_LOCAL zbx_regexp_cache_t	cache;
+
+	return regexp_prepare_cached(&cache, pattern, flags, regexp, err_msg_static);
+}
+
 /***********************************************************************************
  *                                                                                 *
- * Function: regexp_exec                                                           *
+ * Function: regexp_exec_len                                                       *
  *                                                                                 *
  * Purpose: wrapper for pcre_exec(), searches for a given pattern, specified by    *
  *          regexp, in the string                                                  *
  *                                                                                 *
  * Parameters:                                                                     *
  *     string         - [IN] string to be matched against 'regexp'                 *
+ *     len            - [IN] length of the string in bytes                         *
  *     regexp         - [IN] precompiled regular expression                        *
  *     flags          - [IN] execution flags for matching                          *
  *     count          - [IN] count of elements in matches array                    *
@@ -197,7 +223,7 @@ static int	regexp_prepare(const char *pattern, int flags, zbx_regexp_t **regexp,
  *               FAIL                 - error occurred                             *
  *                                                                                 *
  ***********************************************************************************/
-static int	regexp_exec(const char *string, const zbx_regexp_t *regexp, int flags, int count,
+static int	regexp_exec_len(const char *string, size_t len, const zbx_regexp_t *regexp, int flags, int count,
 		zbx_regmatch_t *matches)
 {
 #define MATCHES_BUFF_SIZE	(ZBX_REGEXP_GROUPS_MAX * 3)		/* see pcre_exec() in "man pcreapi" why 3 */
@@ -245,7 +271,7 @@ static int	regexp_exec(const char *string, const zbx_regexp_t *regexp, int flags
 #endif
 #endif
 	/* see "man pcreapi" about pcre_exec() return value and 'ovector' size and layout */
-	if (0 <= (r = pcre_exec(regexp->pcre_regexp, pextra, string, strlen(string), flags, 0, ovector, ovecsize)))
+	if (0 <= (r = pcre_exec(regexp->pcre_regexp, pextra, string, (int)len, flags, 0, ovector, ovecsize)))
 	{
 		if (NULL != matches)
 			memcpy(matches, ovector, (size_t)((0 < r) ? MIN(r, count) : count) * sizeof(zbx_regmatch_t));
@@ -269,6 +295,12 @@ static int	regexp_exec(const char *string, const zbx_regexp_t *regexp, int flags
 #undef MATCHES_BUFF_SIZE
 }
 
+static int	regexp_exec(const char *string, const zbx_regexp_t *regexp, int flags, int count,
+		zbx_regmatch_t *matches)
+{
+	return regexp_exec_len(string, strlen(string), regexp, flags, count, matches);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_regexp_free                                                  *
@@ -312,6 +344,136 @@ int     zbx_regexp_match_precompiled(const char *string, const zbx_regexp_t *reg
 	return (ZBX_REGEXP_MATCH == regexp_exec(string, regexp, 0, 0, NULL)) ? 0 : -1;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_regexp_prepare_lines                                         *
+ *                                                                            *
+ * Purpose: returns a regular expression compiled for searching a buffer of   *
+ *          text lines, see zbx_regexp_search_lines()                         *
+ *                                                                            *
+ * Parameters: pattern        - [IN] regular expression                       *
+ *             regexp         - [OUT] compiled regular expression             *
+ *             err_msg_static - [OUT] error message if any. Do not deallocate *
+ *                                    with zbx_free().                        *
+ *                                                                            *
+ * Return value: SUCCEED - the regular expression was compiled                *
+ *               FAIL    - the regular expression is invalid or the PCRE      *
+ *                         library does not support CR, LF and CR+LF line     *
+ *                         endings at the same time                           *
+ *                                                                            *
+ * Comments: '^' and '$' match at the beginning and at the end of every line  *
+ *           in the buffer, whatever line endings it uses.                    *
+ *                                                                            *
+ *           The last compiled regular expression is cached and reused while  *
+ *           the pattern stays the same. It is kept apart from the one used   *
+ *           for matching single lines so that both can be reused when lines  *
+ *           found in a buffer are matched again. The returned regular        *
+ *           expression must not be freed.                                    *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_regexp_prepare_lines(const char *pattern, const zbx_regexp_t **regexp, const char **err_msg_static)
+{
+#ifdef PCRE_NEWLINE_ANYCRLF
+	static ZBX_THREAD_LOCAL zbx_regexp_cache_t	cache;
+	zbx_regexp_t					*cached;
+	int						ret;
+
+#	ifdef PCRE_NO_AUTO_CAPTURE
+	ret = regexp_prepare_cached(&cache, pattern, PCRE_MULTILINE | PCRE_NEWLINE_ANYCRLF | PCRE_NO_AUTO_CAPTURE,
+			&cached, err_msg_static);
+#	else
+	ret = regexp_prepare_cached(&cache, pattern, PCRE_MULTILINE | PCRE_NEWLINE_ANYCRLF, &cached, err_msg_static);
+#	endif
+	*regexp = cached;
+
+	return ret;
+#else
+	ZBX_UNUSED(pattern);
+	ZBX_UNUSED(regexp);
+
+	*err_msg_static = "PCRE library does not support PCRE_NEWLINE_ANYCRLF";
+
+	return FAIL;
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_regexp_search_lines                                          *
+ *                                                                            *
+ * Purpose: finds the first match of a regular expression in a buffer of      *
+ *          text lines                                                        *
+ *                                                                            *
+ * Parameters: buf    - [IN] the buffer to search, not necessarily            *
+ *                           terminated with '\0'                             *
+ *             len    - [IN] the number of bytes to search                    *
+ *             regexp - [IN] regular expression returned by                   *
+ *                           zbx_regexp_prepare_lines()                       *
+ *             offset - [OUT] offset of the beginning of the match            *
+ *                                                                            *
+ * Return value: ZBX_REGEXP_MATCH    - the buffer contains a match            *
+ *               ZBX_REGEXP_NO_MATCH - there are no matches in the buffer     *
+ *               FAIL                - an error occurred                      *
+ *                                                                            *
+ * Comments: Searching a whole buffer is much faster than matching its lines  *
+ *           one by one. A line can only match if a match begins in it, but   *
+ *           a match can span several lines, so the line should still be      *
+ *           matched on its own to be sure.                                   *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_regexp_search_lines(const char *buf, size_t len, const zbx_regexp_t *regexp, size_t *offset)
+{
+	zbx_regmatch_t	match;
+	int		ret;
+
+	if (ZBX_REGEXP_MATCH == (ret = regexp_exec_len(buf, len, regexp, 0, 1, &match)))
+		*offset = (size_t)match.rm_so;
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_find_cr_lf_byte                                              *
+ *                                                                            *
+ * Purpose: finds the first CR or LF byte in a buffer                         *
+ *                                                                            *
+ * Parameters: p     - [IN] the beginning of the buffer                       *
+ *             p_end - [IN] the end of the buffer (no data from here)         *
+ *                                                                            *
+ * Return value: pointer to the first CR or LF byte or NULL if there are none *
+ *                                                                            *
+ * Comments: With SSE2 16 bytes are compared at once, log files mostly        *
+ *           consist of long lines so the scalar loop is rarely used. Used to *
+ *           split a buffer searched with zbx_regexp_search_lines() into      *
+ *           lines.                                                           *
+ *                                                                            *
+ ******************************************************************************/
+const char	*zbx_find_cr_lf_byte(const char *p, const char *p_end)
+{
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+	const __m128i	lf = _mm_set1_epi8(0xa), cr = _mm_set1_epi8(0xd);
+
+	for (; 16 <= p_end - p; p += 16)
+	{
+		__m128i	data;
+		int	mask;
+
+		data = _mm_loadu_si128((const __m128i *)p);
+
+		if (0 != (mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(data, lf), _mm_cmpeq_epi8(data, cr)))))
+			return p + __builtin_ctz((unsigned int)mask);
+	}
+#endif
+	for (; p < p_end; p++)
+	{
+		if (0xa == *p || 0xd == *p)
+			return p;
+	}
+
+	return NULL;
+}
+
 /****************************************************************************************************
  *                                                                                                  *
  * Function: zbx_regexp                                                                             *
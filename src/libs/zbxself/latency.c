@@ -0,0 +1,172 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "zbxself.h"
+
+#include "latency.h"
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_latency_bucket                                               *
+ *                                                                            *
+ * Purpose: get latency histogram bucket index                                *
+ *                                                                            *
+ * Parameters: usec - [IN] the latency in microseconds                        *
+ *                                                                            *
+ * Return value: the bucket index                                             *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_latency_bucket(zbx_uint64_t usec)
+{
+	int	shift = 0, index;
+
+	if (ZBX_LATENCY_SUB_BUCKETS > usec)
+		return (int)usec;
+
+	while (ZBX_LATENCY_SUB_BUCKETS * 2 <= (usec >> shift))
+		shift++;
+
+	/* the top bits are in range 4-7, so the sub-buckets of each range start at (shift + 1) * 4 */
+	index = shift * ZBX_LATENCY_SUB_BUCKETS + (int)(usec >> shift);
+
+	return MIN(index, ZBX_LATENCY_BUCKETS_NUM - 1);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_latency_bucket_limit                                         *
+ *                                                                            *
+ * Purpose: get the upper limit of latency histogram bucket                   *
+ *                                                                            *
+ * Parameters: index - [IN] the bucket index                                  *
+ *                                                                            *
+ * Return value: the upper bucket limit in microseconds (exclusive)           *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint64_t	zbx_latency_bucket_limit(int index)
+{
+	int	shift;
+
+	if (ZBX_LATENCY_SUB_BUCKETS * 2 > index)
+		return (zbx_uint64_t)index + 1;
+
+	shift = index / ZBX_LATENCY_SUB_BUCKETS - 1;
+
+	return (zbx_uint64_t)(index % ZBX_LATENCY_SUB_BUCKETS + ZBX_LATENCY_SUB_BUCKETS + 1) << shift;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_latency_add                                                  *
+ *                                                                            *
+ * Purpose: add latency sample to histogram                                   *
+ *                                                                            *
+ * Parameters: latency - [IN/OUT] the latency histogram                       *
+ *             value   - [IN] the latency in seconds, negative values are     *
+ *                            counted as 0                                    *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_latency_add(zbx_latency_histogram_t *latency, double value)
+{
+	if (0 > value)
+		value = 0;
+
+	latency->buckets[zbx_latency_bucket((zbx_uint64_t)(value * 1000000))]++;
+	latency->count++;
+	latency->sum += value;
+
+	if (value > latency->max)
+		latency->max = value;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_latency_merge                                                *
+ *                                                                            *
+ * Purpose: add latency histogram to another histogram                        *
+ *                                                                            *
+ * Parameters: dst - [IN/OUT] the destination histogram                       *
+ *             src - [IN] the source histogram                                *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_latency_merge(zbx_latency_histogram_t *dst, const zbx_latency_histogram_t *src)
+{
+	int	i;
+
+	if (0 == src->count)
+		return;
+
+	for (i = 0; i < ZBX_LATENCY_BUCKETS_NUM; i++)
+		dst->buckets[i] += src->buckets[i];
+
+	dst->count += src->count;
+	dst->sum += src->sum;
+
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_latency_stat                                                 *
+ *                                                                            *
+ * Purpose: calculate latency statistics from histogram                       *
+ *                                                                            *
+ * Parameters: latency    - [IN] the latency histogram                        *
+ *             stat       - [IN] the statistics to calculate, see             *
+ *                               ZBX_LATENCY_STAT_* defines                   *
+ *             percentile - [IN] the percentile (0-100) for                   *
+ *                               ZBX_LATENCY_STAT_PERCENTILE statistics       *
+ *                                                                            *
+ * Return value: the requested statistics, latencies are in seconds           *
+ *                                                                            *
+ * Comments: Percentiles are reported as the upper limit of the bucket        *
+ *           containing the percentile, but not more than the maximum value.  *
+ *                                                                            *
+ ******************************************************************************/
+double	zbx_latency_stat(const zbx_latency_histogram_t *latency, unsigned char stat, double percentile)
+{
+	zbx_uint64_t	target, total = 0;
+	int		i;
+
+	switch (stat)
+	{
+		case ZBX_LATENCY_STAT_COUNT:
+			return (double)latency->count;
+		case ZBX_LATENCY_STAT_MAX:
+			return latency->max;
+		case ZBX_LATENCY_STAT_AVG:
+			return 0 == latency->count ? 0 : latency->sum / (double)latency->count;
+	}
+
+	if (0 == latency->count)
+		return 0;
+
+	if (1 > (target = (zbx_uint64_t)ceil((double)latency->count * percentile / 100)))
+		target = 1;
+
+	for (i = 0; i < ZBX_LATENCY_BUCKETS_NUM - 1; i++)
+	{
+		if (target <= (total += latency->buckets[i]))
+			break;
+	}
+
+	return MIN((double)zbx_latency_bucket_limit(i) / 1000000, latency->max);
+}
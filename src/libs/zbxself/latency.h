@@ -0,0 +1,47 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_SELFMON_LATENCY_H
+#define ZABBIX_SELFMON_LATENCY_H
+
+#include "common.h"
+
+/* Latency histogram buckets are log-linear (HDR-style) - values below 4 microseconds have */
+/* their own buckets, then every power of two range is split into 4 equal sub-buckets,    */
+/* limiting relative error to 25% while covering latencies up to a couple of hours.       */
+#define ZBX_LATENCY_SUB_BUCKETS		4
+#define ZBX_LATENCY_BUCKETS_NUM		128
+
+/* operation latency histogram */
+typedef struct
+{
+	unsigned int	buckets[ZBX_LATENCY_BUCKETS_NUM];
+	zbx_uint64_t	count;
+	double		sum;
+	double		max;
+}
+zbx_latency_histogram_t;
+
+int		zbx_latency_bucket(zbx_uint64_t usec);
+zbx_uint64_t	zbx_latency_bucket_limit(int index);
+void		zbx_latency_add(zbx_latency_histogram_t *latency, double value);
+void		zbx_latency_merge(zbx_latency_histogram_t *dst, const zbx_latency_histogram_t *src);
+double		zbx_latency_stat(const zbx_latency_histogram_t *latency, unsigned char stat, double percentile);
+
+#endif
@@ -24,6 +24,8 @@
 #	include "mutexs.h"
 #	include "ipc.h"
 #	include "log.h"
+#	include "zbxcrypto.h"
+#	include "latency.h"
 
 #	define MAX_HISTORY	60
 
@@ -43,6 +45,9 @@ typedef struct
 
 	/* the current process state (see ZBX_PROCESS_STATE_* defines) */
 	unsigned char	state;
+
+	/* operation latencies not yet flushed to the shared histogram */
+	zbx_latency_histogram_t	latency;
 }
 zxb_stat_process_cache_t;
 
@@ -60,6 +65,13 @@ typedef struct
 
 	/* the process state cache */
 	zxb_stat_process_cache_t	cache;
+
+	/* the number of full and resumed certificate-based TLS handshakes */
+	zbx_uint64_t			tls_sessions_full;
+	zbx_uint64_t			tls_sessions_resumed;
+
+	/* operation latencies of the current and previous latency windows */
+	zbx_latency_histogram_t		latency[2];
 }
 zbx_stat_process_t;
 
@@ -74,6 +86,15 @@ typedef struct
 
 	/* ticks of the last self monitoring sync (data gathering) */
 	clock_t			ticks_sync;
+
+	/* the latency histogram slot being filled and the number of data gathering */
+	/* cycles since it was started - the slots are switched every MAX_HISTORY  */
+	/* cycles, so the statistics cover the last one to two minutes             */
+	int			latency_slot;
+	int			latency_cycles;
+
+	/* latencies of sampled item values by processing stage */
+	zbx_latency_histogram_t	value_latency[ZBX_VALUE_LATENCY_COUNT][2];
 }
 zbx_selfmon_collector_t;
 
@@ -261,6 +282,9 @@ int	init_selfmon_collector(char **error)
 	collector->process = (zbx_stat_process_t **)p; p += sz_array;
 	collector->ticks_per_sec = sysconf(_SC_CLK_TCK);
 	collector->ticks_sync = 0;
+	collector->latency_slot = 0;
+	collector->latency_cycles = 0;
+	memset(collector->value_latency, 0, sizeof(collector->value_latency));
 
 	for (proc_type = 0; ZBX_PROCESS_TYPE_COUNT > proc_type; proc_type++)
 	{
@@ -314,6 +338,52 @@ void	free_selfmon_collector(void)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: update_selfmon_latency                                           *
+ *                                                                            *
+ * Purpose: record the latency of a key operation performed by the current    *
+ *          process (a history sync batch, an item poll, a trapper request)   *
+ *                                                                            *
+ * Parameters: latency - [IN] the operation latency in seconds                *
+ *                                                                            *
+ * Comments: The latency is kept in the process local cache and is flushed    *
+ *           to the shared histogram by update_selfmon_counter().             *
+ *                                                                            *
+ ******************************************************************************/
+void	update_selfmon_latency(double latency)
+{
+	if (ZBX_PROCESS_TYPE_UNKNOWN == process_type || NULL == collector)
+		return;
+
+	zbx_latency_add(&collector->process[process_type][process_num - 1].cache.latency, latency);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: update_selfmon_value_latency                                     *
+ *                                                                            *
+ * Purpose: record the latency of a sampled item value processing stage       *
+ *                                                                            *
+ * Parameters: stage   - [IN] the processing stage, ZBX_VALUE_LATENCY_*       *
+ *             latency - [IN] the stage latency in seconds                    *
+ *                                                                            *
+ ******************************************************************************/
+void	update_selfmon_value_latency(unsigned char stage, double latency)
+{
+	zbx_latency_histogram_t	sample;
+
+	if (NULL == collector)
+		return;
+
+	memset(&sample, 0, sizeof(sample));
+	zbx_latency_add(&sample, latency);
+
+	LOCK_SM;
+	zbx_latency_merge(&collector->value_latency[stage][collector->latency_slot], &sample);
+	UNLOCK_SM;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: update_selfmon_counter                                           *
@@ -375,8 +445,16 @@ void	update_selfmon_counter(unsigned char state)
 			process->cache.counter[i] = 0;
 		}
 
-		process->cache.ticks_flush = ticks;
+		if (0 != process->cache.latency.count)
+		{
+			zbx_latency_merge(&process->latency[collector->latency_slot], &process->cache.latency);
+			memset(&process->cache.latency, 0, sizeof(zbx_latency_histogram_t));
+		}
 
+		process->cache.ticks_flush = ticks;
+#if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+		zbx_tls_get_session_stats(&process->tls_sessions_full, &process->tls_sessions_resumed);
+#endif
 		UNLOCK_SM;
 	}
 
@@ -461,6 +539,28 @@ void	collect_selfmon_stats(void)
 
 	collector->ticks_sync = ticks;
 
+	if (MAX_HISTORY <= ++collector->latency_cycles)
+	{
+		collector->latency_slot = 1 - collector->latency_slot;
+		collector->latency_cycles = 0;
+
+		for (i = 0; i < ZBX_VALUE_LATENCY_COUNT; i++)
+		{
+			memset(&collector->value_latency[i][collector->latency_slot], 0,
+					sizeof(zbx_latency_histogram_t));
+		}
+
+		for (proc_type = 0; proc_type < ZBX_PROCESS_TYPE_COUNT; proc_type++)
+		{
+			process_forks = get_process_type_forks(proc_type);
+			for (proc_num = 0; proc_num < process_forks; proc_num++)
+			{
+				memset(&collector->process[proc_type][proc_num].latency[collector->latency_slot], 0,
+						sizeof(zbx_latency_histogram_t));
+			}
+		}
+	}
+
 	UNLOCK_SM;
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
@@ -565,6 +665,183 @@ unlock:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: get_selfmon_latency                                              *
+ *                                                                            *
+ * Purpose: calculate operation latency statistics for selected process       *
+ *                                                                            *
+ * Parameters: proc_type    - [IN] type of process; ZBX_PROCESS_TYPE_*        *
+ *             aggr_func    - [IN] one of ZBX_AGGR_FUNC_*                     *
+ *             proc_num     - [IN] process number; 1 - first process;         *
+ *                                 0 - all processes                          *
+ *             stat         - [IN] one of ZBX_LATENCY_STAT_*                  *
+ *             percentile   - [IN] the percentile (0-100) for                 *
+ *                                 ZBX_LATENCY_STAT_PERCENTILE statistics     *
+ *             value        - [OUT] a pointer to a variable that receives     *
+ *                                  requested statistics                      *
+ *                                                                            *
+ * Comments: The average aggregation calculates statistics of all operations  *
+ *           performed by processes of the type while maximum and minimum     *
+ *           aggregations return the highest and lowest statistics of single  *
+ *           process.                                                         *
+ *                                                                            *
+ ******************************************************************************/
+void	get_selfmon_latency(unsigned char proc_type, unsigned char aggr_func, int proc_num,
+		unsigned char stat, double percentile, double *value)
+{
+	zbx_latency_histogram_t	latency;
+	int			process_forks, first;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+
+	process_forks = get_process_type_forks(proc_type);
+
+	switch (aggr_func)
+	{
+		case ZBX_AGGR_FUNC_ONE:
+			assert(0 < proc_num && proc_num <= process_forks);
+			process_forks = proc_num--;
+			break;
+		case ZBX_AGGR_FUNC_AVG:
+		case ZBX_AGGR_FUNC_MAX:
+		case ZBX_AGGR_FUNC_MIN:
+			assert(0 == proc_num && 0 < process_forks);
+			break;
+		default:
+			assert(0);
+	}
+
+	*value = 0;
+	memset(&latency, 0, sizeof(latency));
+
+	LOCK_SM;
+
+	for (first = proc_num; proc_num < process_forks; proc_num++)
+	{
+		zbx_stat_process_t	*process = &collector->process[proc_type][proc_num];
+		double			one_value;
+
+		zbx_latency_merge(&latency, &process->latency[0]);
+		zbx_latency_merge(&latency, &process->latency[1]);
+
+		if (ZBX_AGGR_FUNC_ONE == aggr_func || ZBX_AGGR_FUNC_AVG == aggr_func)
+			continue;
+
+		one_value = zbx_latency_stat(&latency, stat, percentile);
+		memset(&latency, 0, sizeof(latency));
+
+		if (first == proc_num || (ZBX_AGGR_FUNC_MAX == aggr_func && one_value > *value) ||
+				(ZBX_AGGR_FUNC_MIN == aggr_func && one_value < *value))
+		{
+			*value = one_value;
+		}
+	}
+
+	UNLOCK_SM;
+
+	if (ZBX_AGGR_FUNC_ONE == aggr_func || ZBX_AGGR_FUNC_AVG == aggr_func)
+		*value = zbx_latency_stat(&latency, stat, percentile);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: get_selfmon_value_latency                                        *
+ *                                                                            *
+ * Purpose: calculate latency statistics of sampled item value processing     *
+ *          stage                                                             *
+ *                                                                            *
+ * Parameters: stage      - [IN] the processing stage, ZBX_VALUE_LATENCY_*    *
+ *             stat       - [IN] one of ZBX_LATENCY_STAT_*                    *
+ *             percentile - [IN] the percentile (0-100) for                   *
+ *                               ZBX_LATENCY_STAT_PERCENTILE statistics       *
+ *             value      - [OUT] the requested statistics                    *
+ *                                                                            *
+ ******************************************************************************/
+void	get_selfmon_value_latency(unsigned char stage, unsigned char stat, double percentile, double *value)
+{
+	zbx_latency_histogram_t	latency;
+
+	memset(&latency, 0, sizeof(latency));
+
+	LOCK_SM;
+	zbx_latency_merge(&latency, &collector->value_latency[stage][0]);
+	zbx_latency_merge(&latency, &collector->value_latency[stage][1]);
+	UNLOCK_SM;
+
+	*value = zbx_latency_stat(&latency, stat, percentile);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_get_value_latency_stats                                      *
+ *                                                                            *
+ * Purpose: retrieves latency statistics of all sampled item value            *
+ *          processing stages                                                 *
+ *                                                                            *
+ * Parameters: stats - [OUT] the statistics, ZBX_VALUE_LATENCY_COUNT elements *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_get_value_latency_stats(zbx_value_latency_info_t *stats)
+{
+	zbx_latency_histogram_t	latency[ZBX_VALUE_LATENCY_COUNT];
+	int			i;
+
+	memset(latency, 0, sizeof(latency));
+
+	LOCK_SM;
+
+	for (i = 0; i < ZBX_VALUE_LATENCY_COUNT; i++)
+	{
+		zbx_latency_merge(&latency[i], &collector->value_latency[i][0]);
+		zbx_latency_merge(&latency[i], &collector->value_latency[i][1]);
+	}
+
+	UNLOCK_SM;
+
+	for (i = 0; i < ZBX_VALUE_LATENCY_COUNT; i++)
+	{
+		stats[i].count = latency[i].count;
+		stats[i].avg = zbx_latency_stat(&latency[i], ZBX_LATENCY_STAT_AVG, 0);
+		stats[i].p50 = zbx_latency_stat(&latency[i], ZBX_LATENCY_STAT_PERCENTILE, 50);
+		stats[i].p90 = zbx_latency_stat(&latency[i], ZBX_LATENCY_STAT_PERCENTILE, 90);
+		stats[i].p99 = zbx_latency_stat(&latency[i], ZBX_LATENCY_STAT_PERCENTILE, 99);
+		stats[i].max = latency[i].max;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: get_value_latency_stage_string                                   *
+ *                                                                            *
+ * Purpose: get sampled item value processing stage name                      *
+ *                                                                            *
+ * Parameters: stage - [IN] the processing stage, ZBX_VALUE_LATENCY_*         *
+ *                                                                            *
+ * Return value: the stage name or NULL for unknown stage                     *
+ *                                                                            *
+ ******************************************************************************/
+const char	*get_value_latency_stage_string(unsigned char stage)
+{
+	switch (stage)
+	{
+		case ZBX_VALUE_LATENCY_COLLECTION:
+			return "collection";
+		case ZBX_VALUE_LATENCY_PREPROCESSING:
+			return "preprocessing";
+		case ZBX_VALUE_LATENCY_CACHE:
+			return "cache";
+		case ZBX_VALUE_LATENCY_SYNC:
+			return "sync";
+		case ZBX_VALUE_LATENCY_TOTAL:
+			return "total";
+	}
+
+	return NULL;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_get_all_process_stats                                        *
@@ -597,7 +874,10 @@ int	zbx_get_all_process_stats(zbx_process_info_t *stats)
 				total_max = 0, counter_max_busy = 0, counter_max_idle = 0,
 				total_min = 0, counter_min_busy = 0, counter_min_idle = 0;
 
+		zbx_latency_histogram_t	latency;
+
 		stats[proc_type].count = get_process_type_forks(proc_type);
+		memset(&latency, 0, sizeof(latency));
 
 		for (proc_num = 0; proc_num < stats[proc_type].count; proc_num++)
 		{
@@ -607,6 +887,9 @@ int	zbx_get_all_process_stats(zbx_process_info_t *stats)
 
 			process = &collector->process[proc_type][proc_num];
 
+			zbx_latency_merge(&latency, &process->latency[0]);
+			zbx_latency_merge(&latency, &process->latency[1]);
+
 			for (s = 0; s < ZBX_PROCESS_STATE_COUNT; s++)
 			{
 				one_total += (unsigned short)(process->h_counter[s][current] -
@@ -655,6 +938,13 @@ int	zbx_get_all_process_stats(zbx_process_info_t *stats)
 		stats[proc_type].idle_avg = (0 == total_avg ? 0 : 100. * (double)counter_avg_idle / (double)total_avg);
 		stats[proc_type].idle_max = (0 == total_max ? 0 : 100. * (double)counter_max_idle / (double)total_max);
 		stats[proc_type].idle_min = (0 == total_min ? 0 : 100. * (double)counter_min_idle / (double)total_min);
+
+		stats[proc_type].latency_count = latency.count;
+		stats[proc_type].latency_avg = zbx_latency_stat(&latency, ZBX_LATENCY_STAT_AVG, 0);
+		stats[proc_type].latency_p50 = zbx_latency_stat(&latency, ZBX_LATENCY_STAT_PERCENTILE, 50);
+		stats[proc_type].latency_p90 = zbx_latency_stat(&latency, ZBX_LATENCY_STAT_PERCENTILE, 90);
+		stats[proc_type].latency_p99 = zbx_latency_stat(&latency, ZBX_LATENCY_STAT_PERCENTILE, 99);
+		stats[proc_type].latency_max = latency.max;
 	}
 
 	ret = SUCCEED;
@@ -666,6 +956,41 @@ unlock:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_get_tls_session_stats                                        *
+ *                                                                            *
+ * Purpose: get number of full and resumed certificate-based TLS handshakes   *
+ *          performed by all processes                                        *
+ *                                                                            *
+ * Parameters: full    - [OUT] number of full handshakes                      *
+ *             resumed - [OUT] number of resumed sessions                     *
+ *                                                                            *
+ * Comments: The counters are accumulated since startup and never reset.      *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_get_tls_session_stats(zbx_uint64_t *full, zbx_uint64_t *resumed)
+{
+	unsigned char	proc_type;
+	int		proc_num;
+
+	*full = 0;
+	*resumed = 0;
+
+	LOCK_SM;
+
+	for (proc_type = 0; proc_type < ZBX_PROCESS_TYPE_COUNT; proc_type++)
+	{
+		for (proc_num = 0; proc_num < get_process_type_forks(proc_type); proc_num++)
+		{
+			*full += collector->process[proc_type][proc_num].tls_sessions_full;
+			*resumed += collector->process[proc_type][proc_num].tls_sessions_resumed;
+		}
+	}
+
+	UNLOCK_SM;
+}
+
 static int	sleep_remains;
 
 /******************************************************************************
@@ -0,0 +1,456 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "log.h"
+#include "zbxjson.h"
+#include "zbxipcservice.h"
+#include "dbcache.h"
+#include "preproc.h"
+#include "zbxdiag.h"
+#include "../../zabbix_server/vmware/vmware.h"
+
+#include "diag.h"
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_diag_block_signals                                           *
+ *                                                                            *
+ * Purpose: block signals before locking shared memory caches                 *
+ *                                                                            *
+ * Parameters: orig_mask - [OUT] the signal mask to restore                   *
+ *                                                                            *
+ * Comments: Diagnostic information is collected by the main process, its     *
+ *           signal handlers terminate the server and must not be executed    *
+ *           while a cache lock is held. Signals must be blocked only for the *
+ *           time of cache access, not while waiting for other processes.     *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_diag_block_signals(sigset_t *orig_mask)
+{
+	sigset_t	mask;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGUSR1);
+	sigaddset(&mask, SIGUSR2);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGQUIT);
+	sigaddset(&mask, SIGHUP);
+	sigaddset(&mask, SIGCHLD);
+
+	if (0 > sigprocmask(SIG_BLOCK, &mask, orig_mask))
+		zabbix_log(LOG_LEVEL_WARNING, "cannot set sigprocmask to block signals");
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_diag_restore_signals                                         *
+ *                                                                            *
+ * Purpose: restore signal mask after shared memory caches were unlocked      *
+ *                                                                            *
+ * Parameters: orig_mask - [IN] the signal mask returned by                   *
+ *                              zbx_diag_block_signals()                      *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_diag_restore_signals(const sigset_t *orig_mask)
+{
+	if (0 > sigprocmask(SIG_SETMASK, orig_mask, NULL))
+		zabbix_log(LOG_LEVEL_WARNING, "cannot restore sigprocmask");
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_diag_add_mem_stats                                           *
+ *                                                                            *
+ * Purpose: add shared memory allocator statistics to json                    *
+ *                                                                            *
+ * Parameters: json  - [IN/OUT] the json data                                 *
+ *             name  - [IN] the statistics object name                        *
+ *             stats - [IN] the memory statistics                             *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_diag_add_mem_stats(struct zbx_json *json, const char *name, const zbx_mem_stats_t *stats)
+{
+	double	fragmentation = 0;
+
+	/* the share of free memory that cannot be allocated as a single chunk */
+	if (0 != stats->free_size)
+		fragmentation = 100 * (1 - (double)stats->max_free_chunk / stats->free_size);
+
+	zbx_json_addobject(json, name);
+	zbx_json_adduint64(json, "size", stats->total_size);
+	zbx_json_adduint64(json, "used", stats->used_size);
+	zbx_json_adduint64(json, "free", stats->free_size);
+
+	zbx_json_addobject(json, "chunks");
+	zbx_json_adduint64(json, "used", stats->used_chunks);
+	zbx_json_adduint64(json, "free", stats->free_chunks);
+	zbx_json_adduint64(json, "max_free", stats->max_free_chunk);
+	zbx_json_close(json);
+
+	zbx_json_addfloat(json, "fragmentation", MAX(fragmentation, 0));
+	zbx_json_close(json);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_diag_add_top_items                                           *
+ *                                                                            *
+ * Purpose: add the top items by number of values to json                     *
+ *                                                                            *
+ * Parameters: json  - [IN/OUT] the json data                                 *
+ *             items - [IN] the itemid, number of values pairs                *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_diag_add_top_items(struct zbx_json *json, const zbx_vector_uint64_pair_t *items)
+{
+	int	i;
+
+	zbx_json_addarray(json, "top");
+
+	for (i = 0; i < items->values_num; i++)
+	{
+		zbx_json_addobject(json, NULL);
+		zbx_json_adduint64(json, "itemid", items->values[i].first);
+		zbx_json_adduint64(json, "values", items->values[i].second);
+		zbx_json_close(json);
+	}
+
+	zbx_json_close(json);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: diag_compare_values_num                                          *
+ *                                                                            *
+ * Purpose: sort items by the number of values in descending order            *
+ *                                                                            *
+ ******************************************************************************/
+static int	diag_compare_values_num(const void *d1, const void *d2)
+{
+	const zbx_uint64_pair_t	*p1 = (const zbx_uint64_pair_t *)d1;
+	const zbx_uint64_pair_t	*p2 = (const zbx_uint64_pair_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(p2->second, p1->second);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: diag_add_historycache_info                                       *
+ *                                                                            *
+ * Purpose: add history cache diagnostic information to json                  *
+ *                                                                            *
+ * Parameters: top  - [IN] the number of top items to report                  *
+ *             json - [IN/OUT] the json data                                  *
+ *                                                                            *
+ * Comments: The reported time is the time the history cache was locked.      *
+ *                                                                            *
+ ******************************************************************************/
+static void	diag_add_historycache_info(int top, struct zbx_json *json)
+{
+	zbx_uint64_t			items_num, values_num;
+	zbx_mem_stats_t			data_mem, index_mem;
+	zbx_vector_uint64_pair_t	items;
+	double				time_start, time_locked;
+	sigset_t			orig_mask;
+
+	zbx_vector_uint64_pair_create(&items);
+
+	zbx_diag_block_signals(&orig_mask);
+
+	time_start = zbx_time();
+	zbx_hc_get_diag_stats(&items_num, &values_num);
+	time_locked = zbx_time() - time_start;
+
+	time_start = zbx_time();
+	zbx_hc_get_mem_stats(&data_mem, &index_mem);
+	time_locked += zbx_time() - time_start;
+
+	time_start = zbx_time();
+	zbx_hc_get_items(&items);
+	time_locked += zbx_time() - time_start;
+
+	zbx_diag_restore_signals(&orig_mask);
+
+	zbx_vector_uint64_pair_sort(&items, diag_compare_values_num);
+
+	if (items.values_num > top)
+		items.values_num = top;
+
+	zbx_json_addobject(json, ZBX_DIAGINFO_HISTORYCACHE_STR);
+	zbx_json_adduint64(json, "items", items_num);
+	zbx_json_adduint64(json, "values", values_num);
+
+	zbx_json_addobject(json, "memory");
+	zbx_diag_add_mem_stats(json, "data", &data_mem);
+	zbx_diag_add_mem_stats(json, "index", &index_mem);
+	zbx_json_close(json);
+
+	zbx_diag_add_top_items(json, &items);
+	zbx_json_addfloat(json, "time", time_locked);
+	zbx_json_close(json);
+
+	zbx_vector_uint64_pair_destroy(&items);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: diag_add_preprocessing_info                                      *
+ *                                                                            *
+ * Purpose: add preprocessing manager diagnostic information to json          *
+ *                                                                            *
+ * Parameters: top  - [IN] the number of top items to report                  *
+ *             json - [IN/OUT] the json data                                  *
+ *                                                                            *
+ * Comments: The reported time is the time spent waiting for preprocessing    *
+ *           manager to walk its queue and respond.                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	diag_add_preprocessing_info(int top, struct zbx_json *json)
+{
+	zbx_uint64_t			values_num, values_preproc_num;
+	zbx_vector_uint64_pair_t	items;
+	double				time_start;
+	char				*error = NULL;
+
+	zbx_vector_uint64_pair_create(&items);
+
+	zbx_json_addobject(json, ZBX_DIAGINFO_PREPROCESSING_STR);
+
+	time_start = zbx_time();
+
+	if (SUCCEED == zbx_preprocessor_get_diag_stats(&values_num, &values_preproc_num, &error) &&
+			SUCCEED == zbx_preprocessor_get_top_items(top, &items, &error))
+	{
+		double	time_elapsed = zbx_time() - time_start;
+
+		zbx_json_adduint64(json, "values", values_num);
+		zbx_json_adduint64(json, "values_preproc", values_preproc_num);
+		zbx_diag_add_top_items(json, &items);
+		zbx_json_addfloat(json, "time", time_elapsed);
+	}
+	else
+	{
+		zbx_json_addstring(json, ZBX_PROTO_TAG_ERROR, error, ZBX_JSON_TYPE_STRING);
+		zbx_free(error);
+	}
+
+	zbx_json_close(json);
+
+	zbx_vector_uint64_pair_destroy(&items);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: diag_add_vmware_info                                             *
+ *                                                                            *
+ * Purpose: add vmware cache diagnostic information to json                   *
+ *                                                                            *
+ * Parameters: json - [IN/OUT] the json data                                  *
+ *                                                                            *
+ * Comments: The reported time is the time the vmware cache was locked.       *
+ *                                                                            *
+ ******************************************************************************/
+static void	diag_add_vmware_info(struct zbx_json *json)
+{
+	zbx_vmware_diag_stats_t	stats;
+	zbx_mem_stats_t		mem;
+	double			time_start, time_locked;
+	sigset_t		orig_mask;
+	int			ret;
+
+	zbx_json_addobject(json, ZBX_DIAGINFO_VMWARE_STR);
+
+	zbx_diag_block_signals(&orig_mask);
+	time_start = zbx_time();
+	ret = zbx_vmware_get_diag_stats(&stats, &mem);
+	time_locked = zbx_time() - time_start;
+	zbx_diag_restore_signals(&orig_mask);
+
+	if (SUCCEED != ret)
+	{
+		zbx_json_addstring(json, ZBX_PROTO_TAG_ERROR, "no vmware collectors are running",
+				ZBX_JSON_TYPE_STRING);
+		zbx_json_close(json);
+		return;
+	}
+
+	zbx_json_adduint64(json, "services", stats.services_num);
+	zbx_json_adduint64(json, "perf_entities", stats.entities_num);
+	zbx_json_adduint64(json, "perf_instances", stats.instances_num);
+	zbx_json_adduint64(json, "perf_values", stats.values_num);
+
+	zbx_json_addobject(json, "memory");
+	zbx_diag_add_mem_stats(json, "data", &mem);
+	zbx_json_close(json);
+
+	zbx_json_addfloat(json, "time", time_locked);
+	zbx_json_close(json);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: diag_process_request                                             *
+ *                                                                            *
+ * Purpose: collect requested diagnostic information and send it to client    *
+ *                                                                            *
+ * Parameters: client  - [IN] the IPC client                                  *
+ *             message - [IN] the request with runtime control message        *
+ *                                                                            *
+ ******************************************************************************/
+static void	diag_process_request(zbx_ipc_client_t *client, const zbx_ipc_message_t *message)
+{
+	int		rtc_data, top;
+	unsigned int	sections;
+	struct zbx_json	json;
+
+	memcpy(&rtc_data, message->data, sizeof(rtc_data));
+	sections = (unsigned int)ZBX_RTC_GET_SCOPE(rtc_data);
+	top = ZBX_RTC_GET_DATA(rtc_data);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() sections:0x%x top:%d", __func__, sections, top);
+
+	zbx_json_init(&json, ZBX_JSON_STAT_BUF_LEN);
+
+	if (0 != (sections & ZBX_DIAGINFO_HISTORYCACHE))
+		diag_add_historycache_info(top, &json);
+
+	if (0 != (sections & ZBX_DIAGINFO_PREPROCESSING))
+		diag_add_preprocessing_info(top, &json);
+
+	if (0 != (sections & ZBX_DIAGINFO_VMWARE))
+		diag_add_vmware_info(&json);
+
+	zbx_diag_add_section_info_ext(sections, top, &json);
+
+	zbx_ipc_client_send(client, ZBX_IPC_DIAG_RESPONSE, (unsigned char *)json.buffer,
+			(zbx_uint32_t)json.buffer_size + 1);
+
+	zbx_json_free(&json);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_diag_serve                                                   *
+ *                                                                            *
+ * Purpose: serve diagnostic information requests                             *
+ *                                                                            *
+ * Comments: This function is called by the main process after starting       *
+ *           child processes and returns only if the diagnostic information   *
+ *           service could not be started.                                    *
+ *           Signals are blocked only while cache locks are held, requests    *
+ *           to preprocessing and LLD managers are made with signals          *
+ *           unblocked, so the main process can handle child exits and        *
+ *           shutdown while waiting for their responses.                      *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_diag_serve(void)
+{
+	zbx_ipc_service_t	service;
+	zbx_ipc_client_t	*client;
+	zbx_ipc_message_t	*message;
+	char			*error = NULL;
+
+	if (FAIL == zbx_ipc_service_start(&service, ZBX_IPC_SERVICE_DIAG, &error))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot start diagnostic information service: %s", error);
+		zbx_free(error);
+		return;
+	}
+
+	for (;;)
+	{
+		zbx_ipc_service_recv(&service, ZBX_IPC_WAIT_FOREVER, &client, &message);
+
+		if (NULL != message)
+		{
+			if (ZBX_IPC_DIAG_REQUEST == message->code)
+				diag_process_request(client, message);
+
+			zbx_ipc_message_free(message);
+		}
+
+		if (NULL != client)
+			zbx_ipc_client_release(client);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_diaginfo_send                                                *
+ *                                                                            *
+ * Purpose: request diagnostic information from the running daemon and        *
+ *          print it to standard output                                       *
+ *                                                                            *
+ * Parameters: socket_path - [IN] the IPC socket path                         *
+ *             rtc_data    - [IN] the runtime control message                 *
+ *                                                                            *
+ * Return value: SUCCEED - the diagnostic information was printed             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_diaginfo_send(const char *socket_path, int rtc_data)
+{
+	zbx_ipc_socket_t	diag_socket;
+	zbx_ipc_message_t	message;
+	char			*error = NULL;
+	int			ret = FAIL;
+
+	if (FAIL == zbx_ipc_service_init_env(socket_path, &error))
+	{
+		zbx_error("cannot initialize IPC services: %s", error);
+		zbx_free(error);
+		return FAIL;
+	}
+
+	if (FAIL == zbx_ipc_socket_open(&diag_socket, ZBX_IPC_SERVICE_DIAG, 0, &error))
+	{
+		zbx_error("cannot connect to diagnostic information service: %s", error);
+		zbx_free(error);
+		return FAIL;
+	}
+
+	zbx_ipc_message_init(&message);
+
+	if (FAIL == zbx_ipc_socket_write(&diag_socket, ZBX_IPC_DIAG_REQUEST, (unsigned char *)&rtc_data,
+			sizeof(rtc_data)))
+	{
+		zbx_error("cannot send diagnostic information request");
+		goto out;
+	}
+
+	if (FAIL == zbx_ipc_socket_read(&diag_socket, &message))
+	{
+		zbx_error("cannot read diagnostic information response");
+		goto out;
+	}
+
+	printf("%s\n", (char *)message.data);
+	ret = SUCCEED;
+out:
+	zbx_ipc_socket_close(&diag_socket);
+	zbx_ipc_message_clean(&message);
+
+	return ret;
+}
@@ -0,0 +1,34 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_DIAG_H
+#define ZABBIX_DIAG_H
+
+#include "zbxjson.h"
+#include "zbxalgo.h"
+#include "memalloc.h"
+
+void	zbx_diag_add_mem_stats(struct zbx_json *json, const char *name, const zbx_mem_stats_t *stats);
+void	zbx_diag_add_top_items(struct zbx_json *json, const zbx_vector_uint64_pair_t *items);
+void	zbx_diag_add_section_info_ext(unsigned int sections, int top, struct zbx_json *json);
+
+void	zbx_diag_block_signals(sigset_t *orig_mask);
+void	zbx_diag_restore_signals(const sigset_t *orig_mask);
+
+#endif
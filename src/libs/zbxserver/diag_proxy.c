@@ -0,0 +1,41 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "zbxjson.h"
+
+#include "diag.h"
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_diag_add_section_info_ext                                    *
+ *                                                                            *
+ * Purpose: add program type (proxy) specific diagnostic information          *
+ *                                                                            *
+ * Parameters: sections - [IN] the requested sections (ZBX_DIAGINFO_*)        *
+ *             top      - [IN] the number of top items to report              *
+ *             json     - [IN/OUT] the json data                              *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_diag_add_section_info_ext(unsigned int sections, int top, struct zbx_json *json)
+{
+	ZBX_UNUSED(sections);
+	ZBX_UNUSED(top);
+	ZBX_UNUSED(json);
+}
@@ -0,0 +1,190 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "zbxjson.h"
+#include "sysinfo.h"
+#include "valuecache.h"
+#include "zbxlld.h"
+
+#include "diag.h"
+
+/******************************************************************************
+ *                                                                            *
+ * Function: diag_compare_vc_items                                            *
+ *                                                                            *
+ * Purpose: sort value cache items by the number of values in descending      *
+ *          order                                                             *
+ *                                                                            *
+ ******************************************************************************/
+static int	diag_compare_vc_items(const void *d1, const void *d2)
+{
+	const zbx_vc_item_stats_t	*i1 = *(const zbx_vc_item_stats_t **)d1;
+	const zbx_vc_item_stats_t	*i2 = *(const zbx_vc_item_stats_t **)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(i2->values_num, i1->values_num);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: diag_add_valuecache_info                                         *
+ *                                                                            *
+ * Purpose: add value cache diagnostic information to json                    *
+ *                                                                            *
+ * Parameters: top  - [IN] the number of top items to report                  *
+ *             json - [IN/OUT] the json data                                  *
+ *                                                                            *
+ * Comments: The reported time is the time the value cache was locked.        *
+ *                                                                            *
+ ******************************************************************************/
+static void	diag_add_valuecache_info(int top, struct zbx_json *json)
+{
+	zbx_uint64_t		items_num, values_num;
+	int			mode, i;
+	zbx_mem_stats_t		mem;
+	zbx_vector_ptr_t	items;
+	double			time_start, time_locked;
+	sigset_t		orig_mask;
+
+	zbx_json_addobject(json, ZBX_DIAGINFO_VALUECACHE_STR);
+
+	zbx_diag_block_signals(&orig_mask);
+
+	time_start = zbx_time();
+
+	if (SUCCEED != zbx_vc_get_diag_stats(&items_num, &values_num, &mode))
+	{
+		zbx_diag_restore_signals(&orig_mask);
+		zbx_json_addstring(json, ZBX_PROTO_TAG_ERROR, "value cache is not initialized", ZBX_JSON_TYPE_STRING);
+		zbx_json_close(json);
+		return;
+	}
+
+	time_locked = zbx_time() - time_start;
+
+	zbx_vector_ptr_create(&items);
+
+	time_start = zbx_time();
+	zbx_vc_get_mem_stats(&mem);
+	zbx_vc_get_item_stats(&items);
+	time_locked += zbx_time() - time_start;
+
+	zbx_diag_restore_signals(&orig_mask);
+
+	zbx_vector_ptr_sort(&items, diag_compare_vc_items);
+
+	zbx_json_adduint64(json, "items", items_num);
+	zbx_json_adduint64(json, "values", values_num);
+	zbx_json_adduint64(json, "mode", mode);
+
+	zbx_json_addobject(json, "memory");
+	zbx_diag_add_mem_stats(json, "data", &mem);
+	zbx_json_close(json);
+
+	zbx_json_addarray(json, "top");
+
+	for (i = 0; i < items.values_num && i < top; i++)
+	{
+		const zbx_vc_item_stats_t	*item = (const zbx_vc_item_stats_t *)items.values[i];
+
+		zbx_json_addobject(json, NULL);
+		zbx_json_adduint64(json, "itemid", item->itemid);
+		zbx_json_adduint64(json, "values", item->values_num);
+		zbx_json_adduint64(json, "hits", item->hits);
+		zbx_json_adduint64(json, "active_range", item->active_range);
+		zbx_json_close(json);
+	}
+
+	zbx_json_close(json);
+
+	zbx_json_addfloat(json, "time", time_locked);
+	zbx_json_close(json);
+
+	zbx_vector_ptr_clear_ext(&items, zbx_ptr_free);
+	zbx_vector_ptr_destroy(&items);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: diag_add_lld_info                                                *
+ *                                                                            *
+ * Purpose: add LLD manager diagnostic information to json                    *
+ *                                                                            *
+ * Parameters: top  - [IN] the number of top LLD rules to report              *
+ *             json - [IN/OUT] the json data                                  *
+ *                                                                            *
+ * Comments: The reported time is the time spent waiting for LLD manager to   *
+ *           walk its queue and respond.                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	diag_add_lld_info(int top, struct zbx_json *json)
+{
+	zbx_uint64_t			items_num, values_num;
+	zbx_vector_uint64_pair_t	items;
+	double				time_start;
+	char				*error = NULL;
+
+	zbx_vector_uint64_pair_create(&items);
+
+	zbx_json_addobject(json, ZBX_DIAGINFO_LLD_STR);
+
+	time_start = zbx_time();
+
+	if (SUCCEED == zbx_lld_get_diag_stats(&items_num, &values_num, &error) &&
+			SUCCEED == zbx_lld_get_top_items(top, &items, &error))
+	{
+		double	time_elapsed = zbx_time() - time_start;
+
+		zbx_json_adduint64(json, "rules", items_num);
+		zbx_json_adduint64(json, "values", values_num);
+		zbx_diag_add_top_items(json, &items);
+		zbx_json_addfloat(json, "time", time_elapsed);
+	}
+	else
+	{
+		zbx_json_addstring(json, ZBX_PROTO_TAG_ERROR, error, ZBX_JSON_TYPE_STRING);
+		zbx_free(error);
+	}
+
+	zbx_json_close(json);
+
+	zbx_vector_uint64_pair_destroy(&items);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_diag_add_section_info_ext                                    *
+ *                                                                            *
+ * Purpose: add program type (server) specific diagnostic information         *
+ *                                                                            *
+ * Parameters: sections - [IN] the requested sections (ZBX_DIAGINFO_*)        *
+ *             top      - [IN] the number of top items to report              *
+ *             json     - [IN/OUT] the json data                              *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_diag_add_section_info_ext(unsigned int sections, int top, struct zbx_json *json)
+{
+	if (0 != (sections & ZBX_DIAGINFO_VALUECACHE))
+		diag_add_valuecache_info(top, json);
+
+	if (0 != (sections & ZBX_DIAGINFO_LLD))
+		diag_add_lld_info(top, json);
+}
@@ -0,0 +1,471 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "dbcache.h"
+#include "zbxself.h"
+#include "mutexs.h"
+#include "log.h"
+#include "../../zabbix_server/vmware/vmware.h"
+#include "../../zabbix_server/preprocessor/preprocessing.h"
+
+#include "zabbix_stats.h"
+#include "zabbix_metrics.h"
+
+/* the item queue is calculated by iterating all configuration cache items, so it is refreshed less frequently */
+#define ZBX_METRICS_QUEUE_PERIOD	10
+
+#define ZBX_METRICS_QUEUE_CLOSED	0
+#define ZBX_METRICS_QUEUE_IDLE		1
+#define ZBX_METRICS_QUEUE_PENDING	2
+
+static zbx_metrics_queue_t	preprocessing_queue = {ZBX_IPC_SERVICE_PREPROCESSING, ZBX_IPC_PREPROCESSOR_QUEUE};
+
+extern unsigned char	program_type;
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_metrics_get_queue_size                                       *
+ *                                                                            *
+ * Purpose: gets the last known queue size of a manager service without       *
+ *          blocking                                                          *
+ *                                                                            *
+ * Parameters: queue - [IN/OUT] the manager service queue                     *
+ *             size  - [OUT] the queue size                                   *
+ *                                                                            *
+ * Return value: SUCCEED - the queue size was returned                        *
+ *               FAIL    - the queue size has not been received yet           *
+ *                                                                            *
+ * Comments: The queue size request is sent to the service and its response   *
+ *           is picked up by one of the following calls, so the returned      *
+ *           size lags by one call.                                           *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_metrics_get_queue_size(zbx_metrics_queue_t *queue, zbx_uint64_t *size)
+{
+	zbx_ipc_message_t	*message = NULL;
+	char			*error = NULL;
+
+	if (ZBX_METRICS_QUEUE_CLOSED == queue->state)
+	{
+		if (SUCCEED != zbx_ipc_async_socket_open(&queue->asocket, queue->service_name, 0, &error))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "cannot connect to \"%s\" service: %s", queue->service_name, error);
+			zbx_free(error);
+			goto out;
+		}
+
+		queue->state = ZBX_METRICS_QUEUE_IDLE;
+	}
+
+	if (ZBX_METRICS_QUEUE_PENDING == queue->state)
+	{
+		if (SUCCEED != zbx_ipc_async_socket_recv(&queue->asocket, 0, &message))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "cannot receive queue size from \"%s\" service",
+					queue->service_name);
+			zbx_ipc_async_socket_close(&queue->asocket);
+			queue->state = ZBX_METRICS_QUEUE_CLOSED;
+			goto out;
+		}
+
+		if (NULL != message)
+		{
+			if (sizeof(zbx_uint64_t) <= message->size)
+			{
+				memcpy(&queue->size, message->data, sizeof(zbx_uint64_t));
+				queue->size_received = 1;
+			}
+
+			zbx_ipc_message_free(message);
+			queue->state = ZBX_METRICS_QUEUE_IDLE;
+		}
+	}
+
+	if (ZBX_METRICS_QUEUE_IDLE == queue->state)
+	{
+		if (SUCCEED != zbx_ipc_async_socket_send(&queue->asocket, queue->code, NULL, 0))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "cannot send queue size request to \"%s\" service",
+					queue->service_name);
+			zbx_ipc_async_socket_close(&queue->asocket);
+			queue->state = ZBX_METRICS_QUEUE_CLOSED;
+			goto out;
+		}
+
+		queue->state = ZBX_METRICS_QUEUE_PENDING;
+	}
+out:
+	if (0 == queue->size_received)
+		return FAIL;
+
+	*size = queue->size;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_metrics_add_family                                           *
+ *                                                                            *
+ * Purpose: adds metric family type and help description                      *
+ *                                                                            *
+ * Parameters: data        - [IN/OUT] the metrics data                        *
+ *             data_alloc  - [IN/OUT] the metrics data size                   *
+ *             data_offset - [IN/OUT] the metrics data length                 *
+ *             name        - [IN] the metric family name without prefix       *
+ *             type        - [IN] the metric family type, see                 *
+ *                                ZBX_METRICS_TYPE_* defines                  *
+ *             help        - [IN] the metric family description               *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_metrics_add_family(char **data, size_t *data_alloc, size_t *data_offset, const char *name,
+		const char *type, const char *help)
+{
+	zbx_snprintf_alloc(data, data_alloc, data_offset, "# TYPE zabbix_%s %s\n# HELP zabbix_%s %s\n", name, type,
+			name, help);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: metrics_add_name                                                 *
+ *                                                                            *
+ * Purpose: adds metric sample name with optional labels                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	metrics_add_name(char **data, size_t *data_alloc, size_t *data_offset, const char *name,
+		const char *labels)
+{
+	if (NULL == labels)
+		zbx_snprintf_alloc(data, data_alloc, data_offset, "zabbix_%s ", name);
+	else
+		zbx_snprintf_alloc(data, data_alloc, data_offset, "zabbix_%s{%s} ", name, labels);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_metrics_add_uint64                                           *
+ *                                                                            *
+ * Purpose: adds unsigned integer metric sample                               *
+ *                                                                            *
+ * Parameters: data        - [IN/OUT] the metrics data                        *
+ *             data_alloc  - [IN/OUT] the metrics data size                   *
+ *             data_offset - [IN/OUT] the metrics data length                 *
+ *             name        - [IN] the metric sample name without prefix       *
+ *             labels      - [IN] the formatted sample labels (optional)      *
+ *             value       - [IN] the sample value                            *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_metrics_add_uint64(char **data, size_t *data_alloc, size_t *data_offset, const char *name,
+		const char *labels, zbx_uint64_t value)
+{
+	metrics_add_name(data, data_alloc, data_offset, name, labels);
+	zbx_snprintf_alloc(data, data_alloc, data_offset, ZBX_FS_UI64 "\n", value);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_metrics_add_double                                           *
+ *                                                                            *
+ * Purpose: adds floating point metric sample                                 *
+ *                                                                            *
+ * Parameters: data        - [IN/OUT] the metrics data                        *
+ *             data_alloc  - [IN/OUT] the metrics data size                   *
+ *             data_offset - [IN/OUT] the metrics data length                 *
+ *             name        - [IN] the metric sample name without prefix       *
+ *             labels      - [IN] the formatted sample labels (optional)      *
+ *             value       - [IN] the sample value                            *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_metrics_add_double(char **data, size_t *data_alloc, size_t *data_offset, const char *name,
+		const char *labels, double value)
+{
+	metrics_add_name(data, data_alloc, data_offset, name, labels);
+	zbx_snprintf_alloc(data, data_alloc, data_offset, ZBX_FS_DBL "\n", value);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: metrics_get_queue                                                *
+ *                                                                            *
+ * Purpose: gets the number of delayed items, recalculating it at most once   *
+ *          per ZBX_METRICS_QUEUE_PERIOD seconds                              *
+ *                                                                            *
+ ******************************************************************************/
+static int	metrics_get_queue(void)
+{
+	static int	queue, queue_time;
+	int		now;
+
+	now = (int)time(NULL);
+
+	if (0 == queue_time || now - queue_time >= ZBX_METRICS_QUEUE_PERIOD)
+	{
+		queue = DCget_item_queue(NULL, ZBX_QUEUE_FROM_DEFAULT, ZBX_QUEUE_TO_INFINITY);
+		queue_time = now;
+	}
+
+	return queue;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: metrics_add_cache                                                *
+ *                                                                            *
+ * Purpose: adds cache size and usage samples                                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	metrics_add_cache(char **data, size_t *data_alloc, size_t *data_offset, const char *name,
+		const char *cache, zbx_uint64_t value)
+{
+	char	labels[64];
+
+	zbx_snprintf(labels, sizeof(labels), "cache=\"%s\"", cache);
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, name, labels, value);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_get_zabbix_metrics                                           *
+ *                                                                            *
+ * Purpose: collects internal metrics in OpenMetrics text format              *
+ *                                                                            *
+ * Parameters: data        - [IN/OUT] the metrics data                        *
+ *             data_alloc  - [IN/OUT] the metrics data size                   *
+ *             data_offset - [IN/OUT] the metrics data length                 *
+ *                                                                            *
+ * Comments: Only cheap statistics are collected - caches are locked just to  *
+ *           copy their counters, the item queue is refreshed at most once    *
+ *           per ZBX_METRICS_QUEUE_PERIOD seconds and manager queue sizes are *
+ *           requested without waiting for response.                          *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_get_zabbix_metrics(char **data, size_t *data_alloc, size_t *data_offset)
+{
+	zbx_config_cache_info_t	count_stats;
+	zbx_wcache_info_t	wcache_info;
+	zbx_vmware_stats_t	vmware_stats;
+	zbx_process_info_t	process_stats[ZBX_PROCESS_TYPE_COUNT];
+	zbx_lock_stats_t	*lock_stats;
+	const char		**lock_names;
+	char			labels[MAX_STRING_LEN];
+	int			proc_type, i, locks_num = 0, vmware_ret;
+	zbx_uint64_t		queue_size;
+
+	DCget_count_stats_all(&count_stats);
+	DCget_stats_all(&wcache_info);
+	vmware_ret = zbx_vmware_get_statistics(&vmware_stats);
+
+	zbx_metrics_add_family(data, data_alloc, data_offset, "start_time_seconds", ZBX_METRICS_TYPE_GAUGE,
+			"Start time since Unix epoch in seconds.");
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "start_time_seconds", NULL,
+			(zbx_uint64_t)CONFIG_SERVER_STARTUP_TIME);
+
+	zbx_metrics_add_family(data, data_alloc, data_offset, "hosts", ZBX_METRICS_TYPE_GAUGE,
+			"Number of monitored hosts.");
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "hosts", NULL, count_stats.hosts);
+
+	zbx_metrics_add_family(data, data_alloc, data_offset, "items", ZBX_METRICS_TYPE_GAUGE,
+			"Number of enabled items.");
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "items", NULL, count_stats.items);
+
+	zbx_metrics_add_family(data, data_alloc, data_offset, "items_unsupported", ZBX_METRICS_TYPE_GAUGE,
+			"Number of unsupported items.");
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "items_unsupported", NULL,
+			count_stats.items_unsupported);
+
+	zbx_metrics_add_family(data, data_alloc, data_offset, "required_performance", ZBX_METRICS_TYPE_GAUGE,
+			"Required performance in new values per second.");
+	zbx_metrics_add_double(data, data_alloc, data_offset, "required_performance", NULL,
+			count_stats.requiredperformance);
+
+	zbx_metrics_add_family(data, data_alloc, data_offset, "values_processed", ZBX_METRICS_TYPE_COUNTER,
+			"Number of values processed by history syncers.");
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "values_processed_total", "type=\"float\"",
+			wcache_info.stats.history_float_counter);
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "values_processed_total", "type=\"uint\"",
+			wcache_info.stats.history_uint_counter);
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "values_processed_total", "type=\"str\"",
+			wcache_info.stats.history_str_counter);
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "values_processed_total", "type=\"log\"",
+			wcache_info.stats.history_log_counter);
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "values_processed_total", "type=\"text\"",
+			wcache_info.stats.history_text_counter);
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "values_processed_total", "type=\"not supported\"",
+			wcache_info.stats.notsupported_counter);
+
+	zbx_metrics_add_family(data, data_alloc, data_offset, "queue", ZBX_METRICS_TYPE_GAUGE,
+			"Number of items delayed by 6 seconds or more.");
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "queue", NULL, (zbx_uint64_t)metrics_get_queue());
+
+	if (SUCCEED == zbx_metrics_get_queue_size(&preprocessing_queue, &queue_size))
+	{
+		zbx_metrics_add_family(data, data_alloc, data_offset, "preprocessing_queue", ZBX_METRICS_TYPE_GAUGE,
+				"Number of values queued in the preprocessing manager.");
+		zbx_metrics_add_uint64(data, data_alloc, data_offset, "preprocessing_queue", NULL, queue_size);
+	}
+
+	zbx_get_zabbix_metrics_ext(data, data_alloc, data_offset);
+
+	zbx_metrics_add_family(data, data_alloc, data_offset, "cache_size_bytes", ZBX_METRICS_TYPE_GAUGE,
+			"Shared memory cache size in bytes.");
+	metrics_add_cache(data, data_alloc, data_offset, "cache_size_bytes", "configuration",
+			*(zbx_uint64_t *)DCconfig_get_stats(ZBX_CONFSTATS_BUFFER_TOTAL));
+	metrics_add_cache(data, data_alloc, data_offset, "cache_size_bytes", "history", wcache_info.history_total);
+	metrics_add_cache(data, data_alloc, data_offset, "cache_size_bytes", "history index", wcache_info.index_total);
+
+	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+		metrics_add_cache(data, data_alloc, data_offset, "cache_size_bytes", "trend", wcache_info.trend_total);
+
+	if (SUCCEED == vmware_ret)
+	{
+		metrics_add_cache(data, data_alloc, data_offset, "cache_size_bytes", "vmware",
+				vmware_stats.memory_total);
+	}
+
+	zbx_metrics_add_family(data, data_alloc, data_offset, "cache_used_bytes", ZBX_METRICS_TYPE_GAUGE,
+			"Used shared memory cache size in bytes.");
+	metrics_add_cache(data, data_alloc, data_offset, "cache_used_bytes", "configuration",
+			*(zbx_uint64_t *)DCconfig_get_stats(ZBX_CONFSTATS_BUFFER_USED));
+	metrics_add_cache(data, data_alloc, data_offset, "cache_used_bytes", "history",
+			wcache_info.history_total - wcache_info.history_free);
+	metrics_add_cache(data, data_alloc, data_offset, "cache_used_bytes", "history index",
+			wcache_info.index_total - wcache_info.index_free);
+
+	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+	{
+		metrics_add_cache(data, data_alloc, data_offset, "cache_used_bytes", "trend",
+				wcache_info.trend_total - wcache_info.trend_free);
+	}
+
+	if (SUCCEED == vmware_ret)
+		metrics_add_cache(data, data_alloc, data_offset, "cache_used_bytes", "vmware", vmware_stats.memory_used);
+
+	if (SUCCEED == zbx_get_all_process_stats(process_stats))
+	{
+		zbx_metrics_add_family(data, data_alloc, data_offset, "process_count", ZBX_METRICS_TYPE_GAUGE,
+				"Number of started processes.");
+
+		for (proc_type = 0; proc_type < ZBX_PROCESS_TYPE_COUNT; proc_type++)
+		{
+			if (0 == process_stats[proc_type].count)
+				continue;
+
+			zbx_snprintf(labels, sizeof(labels), "process=\"%s\"", get_process_type_string(proc_type));
+			zbx_metrics_add_uint64(data, data_alloc, data_offset, "process_count", labels,
+					(zbx_uint64_t)process_stats[proc_type].count);
+		}
+
+		zbx_metrics_add_family(data, data_alloc, data_offset, "process_busy_percent", ZBX_METRICS_TYPE_GAUGE,
+				"Time spent by processes in busy state during the last minute, in percent.");
+
+		for (proc_type = 0; proc_type < ZBX_PROCESS_TYPE_COUNT; proc_type++)
+		{
+			const char	*process_name;
+
+			if (0 == process_stats[proc_type].count)
+				continue;
+
+			process_name = get_process_type_string(proc_type);
+
+			zbx_snprintf(labels, sizeof(labels), "process=\"%s\",aggregate=\"avg\"", process_name);
+			zbx_metrics_add_double(data, data_alloc, data_offset, "process_busy_percent", labels,
+					process_stats[proc_type].busy_avg);
+			zbx_snprintf(labels, sizeof(labels), "process=\"%s\",aggregate=\"max\"", process_name);
+			zbx_metrics_add_double(data, data_alloc, data_offset, "process_busy_percent", labels,
+					process_stats[proc_type].busy_max);
+			zbx_snprintf(labels, sizeof(labels), "process=\"%s\",aggregate=\"min\"", process_name);
+			zbx_metrics_add_double(data, data_alloc, data_offset, "process_busy_percent", labels,
+					process_stats[proc_type].busy_min);
+		}
+	}
+
+	/* lock statistics are copied once so that every metric family is reported from the same snapshot */
+	while (NULL != zbx_lock_name(locks_num))
+		locks_num++;
+
+	lock_stats = (zbx_lock_stats_t *)zbx_malloc(NULL, sizeof(zbx_lock_stats_t) * locks_num);
+	lock_names = (const char **)zbx_malloc(NULL, sizeof(const char *) * locks_num);
+
+	for (i = 0; i < locks_num; i++)
+	{
+		lock_names[i] = zbx_lock_name(i);
+
+		if (SUCCEED != zbx_lock_get_stats(lock_names[i], &lock_stats[i]))
+			break;
+	}
+
+	if (0 != (locks_num = i))
+	{
+		zbx_metrics_add_family(data, data_alloc, data_offset, "lock_acquisitions", ZBX_METRICS_TYPE_COUNTER,
+				"Number of times the lock was acquired.");
+
+		for (i = 0; i < locks_num; i++)
+		{
+			zbx_snprintf(labels, sizeof(labels), "lock=\"%s\"", lock_names[i]);
+			zbx_metrics_add_uint64(data, data_alloc, data_offset, "lock_acquisitions_total", labels,
+					lock_stats[i].acquisitions);
+		}
+
+		zbx_metrics_add_family(data, data_alloc, data_offset, "lock_contended", ZBX_METRICS_TYPE_COUNTER,
+				"Number of times the lock was already held when acquiring it.");
+
+		for (i = 0; i < locks_num; i++)
+		{
+			zbx_snprintf(labels, sizeof(labels), "lock=\"%s\"", lock_names[i]);
+			zbx_metrics_add_uint64(data, data_alloc, data_offset, "lock_contended_total", labels,
+					lock_stats[i].contended);
+		}
+
+		zbx_metrics_add_family(data, data_alloc, data_offset, "lock_wait_seconds", ZBX_METRICS_TYPE_COUNTER,
+				"Time spent waiting for the lock in seconds.");
+
+		for (i = 0; i < locks_num; i++)
+		{
+			zbx_snprintf(labels, sizeof(labels), "lock=\"%s\"", lock_names[i]);
+			zbx_metrics_add_double(data, data_alloc, data_offset, "lock_wait_seconds_total", labels,
+					lock_stats[i].wait_time);
+		}
+
+		zbx_metrics_add_family(data, data_alloc, data_offset, "lock_hold_seconds", ZBX_METRICS_TYPE_COUNTER,
+				"Time the lock was held in seconds.");
+
+		for (i = 0; i < locks_num; i++)
+		{
+			zbx_snprintf(labels, sizeof(labels), "lock=\"%s\"", lock_names[i]);
+			zbx_metrics_add_double(data, data_alloc, data_offset, "lock_hold_seconds_total", labels,
+					lock_stats[i].hold_time);
+		}
+
+		zbx_metrics_add_family(data, data_alloc, data_offset, "lock_hold_max_seconds", ZBX_METRICS_TYPE_GAUGE,
+				"Longest time the lock was held in seconds.");
+
+		for (i = 0; i < locks_num; i++)
+		{
+			zbx_snprintf(labels, sizeof(labels), "lock=\"%s\"", lock_names[i]);
+			zbx_metrics_add_double(data, data_alloc, data_offset, "lock_hold_max_seconds", labels,
+					lock_stats[i].hold_time_max);
+		}
+	}
+
+	zbx_free(lock_names);
+	zbx_free(lock_stats);
+
+	zbx_strcpy_alloc(data, data_alloc, data_offset, "# EOF\n");
+}
@@ -0,0 +1,54 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_ZABBIX_METRICS_H_
+#define ZABBIX_ZABBIX_METRICS_H_
+
+#include "zbxipcservice.h"
+
+#define ZBX_METRICS_CONTENT_TYPE	"application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+#define ZBX_METRICS_TYPE_GAUGE		"gauge"
+#define ZBX_METRICS_TYPE_COUNTER	"counter"
+
+/* the queue size of a manager service, requested without waiting for response */
+typedef struct
+{
+	const char		*service_name;
+	zbx_uint32_t		code;
+	zbx_ipc_async_socket_t	asocket;
+	unsigned char		state;
+	int			size_received;
+	zbx_uint64_t		size;
+}
+zbx_metrics_queue_t;
+
+int	zbx_metrics_get_queue_size(zbx_metrics_queue_t *queue, zbx_uint64_t *size);
+
+void	zbx_metrics_add_family(char **data, size_t *data_alloc, size_t *data_offset, const char *name,
+		const char *type, const char *help);
+void	zbx_metrics_add_uint64(char **data, size_t *data_alloc, size_t *data_offset, const char *name,
+		const char *labels, zbx_uint64_t value);
+void	zbx_metrics_add_double(char **data, size_t *data_alloc, size_t *data_offset, const char *name,
+		const char *labels, double value);
+
+void	zbx_get_zabbix_metrics(char **data, size_t *data_alloc, size_t *data_offset);
+void	zbx_get_zabbix_metrics_ext(char **data, size_t *data_alloc, size_t *data_offset);
+
+#endif /* ZABBIX_ZABBIX_METRICS_H_ */
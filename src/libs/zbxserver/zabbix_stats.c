@@ -40,11 +40,14 @@ extern unsigned char	program_type;
  ******************************************************************************/
 void	zbx_get_zabbix_stats(struct zbx_json *json)
 {
-	zbx_config_cache_info_t	count_stats;
-	zbx_vmware_stats_t	vmware_stats;
-	zbx_wcache_info_t	wcache_info;
-	zbx_process_info_t	process_stats[ZBX_PROCESS_TYPE_COUNT];
-	int			proc_type;
+	zbx_config_cache_info_t		count_stats;
+	zbx_vmware_stats_t		vmware_stats;
+	zbx_wcache_info_t		wcache_info;
+	zbx_process_info_t		process_stats[ZBX_PROCESS_TYPE_COUNT];
+	zbx_lock_stats_t		lock_stats;
+	zbx_value_latency_info_t	value_latency[ZBX_VALUE_LATENCY_COUNT];
+	const char			*lock_name;
+	int				proc_type, i, locks_added = FAIL;
 
 	DCget_count_stats_all(&count_stats);
 
@@ -139,6 +142,68 @@ void	zbx_get_zabbix_stats(struct zbx_json *json)
 		zbx_json_close(json);
 	}
 
+	/* zabbix[value_latency,<stage>,<stat>] */
+	zbx_get_value_latency_stats(value_latency);
+	zbx_json_addobject(json, "value_latency");
+
+	for (i = 0; i < ZBX_VALUE_LATENCY_COUNT; i++)
+	{
+		zbx_json_addobject(json, get_value_latency_stage_string((unsigned char)i));
+		zbx_json_adduint64(json, "count", value_latency[i].count);
+		zbx_json_addfloat(json, "avg", value_latency[i].avg);
+		zbx_json_addfloat(json, "p50", value_latency[i].p50);
+		zbx_json_addfloat(json, "p90", value_latency[i].p90);
+		zbx_json_addfloat(json, "p99", value_latency[i].p99);
+		zbx_json_addfloat(json, "max", value_latency[i].max);
+		zbx_json_close(json);
+	}
+
+	zbx_json_close(json);
+
+	/* zabbix[lock,<name>,<mode>] */
+	for (i = 0; NULL != (lock_name = zbx_lock_name(i)); i++)
+	{
+		int	j;
+
+		if (SUCCEED != zbx_lock_get_stats(lock_name, &lock_stats))
+			continue;
+
+		if (FAIL == locks_added)
+		{
+			zbx_json_addobject(json, "locks");
+			locks_added = SUCCEED;
+		}
+
+		zbx_json_addobject(json, lock_name);
+		zbx_json_adduint64(json, "acquisitions", lock_stats.acquisitions);
+		zbx_json_adduint64(json, "contended", lock_stats.contended);
+		zbx_json_addfloat(json, "wait", lock_stats.wait_time);
+		zbx_json_addfloat(json, "hold", lock_stats.hold_time);
+		zbx_json_addfloat(json, "hold_max", lock_stats.hold_time_max);
+		zbx_json_addarray(json, "sites");
+
+		for (j = 0; j < lock_stats.sites_num; j++)
+		{
+			zbx_lock_site_stats_t	*site = &lock_stats.sites[j];
+
+			zbx_json_addobject(json, NULL);
+			zbx_json_addstring(json, "file", site->filename, ZBX_JSON_TYPE_STRING);
+			zbx_json_adduint64(json, "line", (zbx_uint64_t)site->line);
+			zbx_json_adduint64(json, "acquisitions", site->acquisitions);
+			zbx_json_adduint64(json, "contended", site->contended);
+			zbx_json_addfloat(json, "wait", site->wait_time);
+			zbx_json_addfloat(json, "hold", site->hold_time);
+			zbx_json_addfloat(json, "hold_max", site->hold_time_max);
+			zbx_json_close(json);
+		}
+
+		zbx_json_close(json);
+		zbx_json_close(json);
+	}
+
+	if (SUCCEED == locks_added)
+		zbx_json_close(json);
+
 	/* zabbix[process,<type>,<mode>,<state>] */
 	zbx_json_addobject(json, "process");
 
@@ -160,6 +225,14 @@ void	zbx_get_zabbix_stats(struct zbx_json *json)
 			zbx_json_addfloat(json, "max", process_stats[proc_type].idle_max);
 			zbx_json_addfloat(json, "min", process_stats[proc_type].idle_min);
 			zbx_json_close(json);
+			zbx_json_addobject(json, "latency");
+			zbx_json_adduint64(json, "count", process_stats[proc_type].latency_count);
+			zbx_json_addfloat(json, "avg", process_stats[proc_type].latency_avg);
+			zbx_json_addfloat(json, "p50", process_stats[proc_type].latency_p50);
+			zbx_json_addfloat(json, "p90", process_stats[proc_type].latency_p90);
+			zbx_json_addfloat(json, "p99", process_stats[proc_type].latency_p99);
+			zbx_json_addfloat(json, "max", process_stats[proc_type].latency_max);
+			zbx_json_close(json);
 			zbx_json_adduint64(json, "count", process_stats[proc_type].count);
 			zbx_json_close(json);
 		}
@@ -20,6 +20,7 @@
 #include "common.h"
 #include "zbxjson.h"
 #include "zabbix_stats.h"
+#include "zabbix_metrics.h"
 
 /******************************************************************************
  *                                                                            *
@@ -38,3 +39,21 @@ void	zbx_get_zabbix_stats_ext(struct zbx_json *json)
 	ZBX_UNUSED(json);
 	return;
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_get_zabbix_metrics_ext                                       *
+ *                                                                            *
+ * Purpose: get program type (proxy) specific internal metrics                *
+ *                                                                            *
+ * Parameters: data        - [IN/OUT] the metrics data                        *
+ *             data_alloc  - [IN/OUT] the metrics data size                   *
+ *             data_offset - [IN/OUT] the metrics data length                 *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_get_zabbix_metrics_ext(char **data, size_t *data_alloc, size_t *data_offset)
+{
+	ZBX_UNUSED(data);
+	ZBX_UNUSED(data_alloc);
+	ZBX_UNUSED(data_offset);
+}
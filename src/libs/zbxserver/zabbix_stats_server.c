@@ -26,6 +26,10 @@
 #include "log.h"
 
 #include "zabbix_stats.h"
+#include "zabbix_metrics.h"
+#include "../../zabbix_server/lld/lld_protocol.h"
+
+static zbx_metrics_queue_t	lld_queue = {ZBX_IPC_SERVICE_LLD, ZBX_IPC_LLD_QUEUE};
 
 /******************************************************************************
  *                                                                            *
@@ -83,3 +87,55 @@ void	zbx_get_zabbix_stats_ext(struct zbx_json *json)
 		zbx_json_close(json);
 	}
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_get_zabbix_metrics_ext                                       *
+ *                                                                            *
+ * Purpose: get program type (server) specific internal metrics               *
+ *                                                                            *
+ * Parameters: data        - [IN/OUT] the metrics data                        *
+ *             data_alloc  - [IN/OUT] the metrics data size                   *
+ *             data_offset - [IN/OUT] the metrics data length                 *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_get_zabbix_metrics_ext(char **data, size_t *data_alloc, size_t *data_offset)
+{
+	zbx_vc_stats_t	vc_stats;
+	zbx_uint64_t	queue_size;
+
+	if (SUCCEED == zbx_metrics_get_queue_size(&lld_queue, &queue_size))
+	{
+		zbx_metrics_add_family(data, data_alloc, data_offset, "lld_queue", ZBX_METRICS_TYPE_GAUGE,
+				"Number of values queued in the low-level discovery manager.");
+		zbx_metrics_add_uint64(data, data_alloc, data_offset, "lld_queue", NULL, queue_size);
+	}
+
+	zbx_metrics_add_family(data, data_alloc, data_offset, "triggers", ZBX_METRICS_TYPE_GAUGE,
+			"Number of enabled triggers.");
+	zbx_metrics_add_uint64(data, data_alloc, data_offset, "triggers", NULL, DCget_trigger_count());
+
+	if (SUCCEED == zbx_vc_get_statistics(&vc_stats))
+	{
+		zbx_metrics_add_family(data, data_alloc, data_offset, "vcache_size_bytes", ZBX_METRICS_TYPE_GAUGE,
+				"Value cache size in bytes.");
+		zbx_metrics_add_uint64(data, data_alloc, data_offset, "vcache_size_bytes", NULL, vc_stats.total_size);
+
+		zbx_metrics_add_family(data, data_alloc, data_offset, "vcache_used_bytes", ZBX_METRICS_TYPE_GAUGE,
+				"Used value cache size in bytes.");
+		zbx_metrics_add_uint64(data, data_alloc, data_offset, "vcache_used_bytes", NULL,
+				vc_stats.total_size - vc_stats.free_size);
+
+		zbx_metrics_add_family(data, data_alloc, data_offset, "vcache_hits", ZBX_METRICS_TYPE_COUNTER,
+				"Number of values returned from the value cache.");
+		zbx_metrics_add_uint64(data, data_alloc, data_offset, "vcache_hits_total", NULL, vc_stats.hits);
+
+		zbx_metrics_add_family(data, data_alloc, data_offset, "vcache_misses", ZBX_METRICS_TYPE_COUNTER,
+				"Number of values read from the database into the value cache.");
+		zbx_metrics_add_uint64(data, data_alloc, data_offset, "vcache_misses_total", NULL, vc_stats.misses);
+
+		zbx_metrics_add_family(data, data_alloc, data_offset, "vcache_mode", ZBX_METRICS_TYPE_GAUGE,
+				"Value cache operating mode, 0 - normal, 1 - low memory.");
+		zbx_metrics_add_uint64(data, data_alloc, data_offset, "vcache_mode", NULL, (zbx_uint64_t)vc_stats.mode);
+	}
+}
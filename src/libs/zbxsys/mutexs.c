@@ -21,19 +21,60 @@
 #include "log.h"
 #include "mutexs.h"
 
+#ifdef ZBX_SEQLOCK
+#	include <sched.h>
+#endif
+
 #ifdef _WINDOWS
 #	include "sysinfo.h"
 #else
+/* lock names used for statistics, indexed by mutex name followed by read-write lock name */
+static const char	*lock_names[ZBX_MUTEX_COUNT + ZBX_RWLOCK_COUNT] = {"log", "cache", "trends", "cache_ids",
+		"selfmon", "cpustats", "diskstats", "itservices", "valuecache", "vmware", "sqlite3", "procstat",
+		"proc_snapshot", "proxy_history", "config"};
+
 #ifdef HAVE_PTHREAD_PROCESS_SHARED
+typedef struct
+{
+	pthread_mutex_t		lock;
+	zbx_lock_stats_t	stats;
+}
+zbx_shared_lock_stats_t;
+
 typedef struct
 {
 	pthread_mutex_t		mutexes[ZBX_MUTEX_COUNT];
 	pthread_rwlock_t	rwlocks[ZBX_RWLOCK_COUNT];
+	zbx_shared_lock_stats_t	stats[ZBX_MUTEX_COUNT + ZBX_RWLOCK_COUNT];
 }
 zbx_shared_lock_t;
 
 static zbx_shared_lock_t	*shared_lock;
 static int			shm_id, locks_disabled;
+
+/* lock acquired by the current process, kept until it is released to update the lock statistics */
+typedef struct
+{
+	const char	*filename;
+	int		line;
+	int		contended;
+	double		wait_time;
+	double		time_locked;
+}
+zbx_lock_state_t;
+
+static zbx_lock_state_t	lock_states[ZBX_MUTEX_COUNT + ZBX_RWLOCK_COUNT];
+static int		lock_stats_enabled;
+
+/* lock statistics collected by the current process since they were last added to the shared statistics */
+static zbx_lock_stats_t	lock_local_stats[ZBX_MUTEX_COUNT + ZBX_RWLOCK_COUNT];
+static double		lock_stats_flush_time;
+
+/* the delay (in seconds) of adding lock statistics collected by a process to the shared statistics */
+#define ZBX_LOCK_STATS_FLUSH_DELAY	1
+
+#define MUTEX_STATS_INDEX(mutex)	((int)((mutex) - shared_lock->mutexes))
+#define RWLOCK_STATS_INDEX(rwlock)	(ZBX_MUTEX_COUNT + (int)((rwlock) - shared_lock->rwlocks))
 #else
 #	if !HAVE_SEMUN
 		union semun
@@ -119,6 +160,15 @@ int	zbx_locks_create(char **error)
 		}
 	}
 
+	for (i = 0; i < ZBX_MUTEX_COUNT + ZBX_RWLOCK_COUNT; i++)
+	{
+		if (0 != pthread_mutex_init(&shared_lock->stats[i].lock, &mta))
+		{
+			*error = zbx_dsprintf(*error, "cannot create lock statistics mutex: %s", zbx_strerror(errno));
+			return FAIL;
+		}
+	}
+
 	if (0 != pthread_rwlockattr_init(&rwa))
 	{
 		*error = zbx_dsprintf(*error, "cannot initialize read write lock attribute: %s", zbx_strerror(errno));
@@ -198,6 +248,217 @@ int	zbx_rwlock_create(zbx_rwlock_t *rwlock, zbx_rwlock_name_t name, char **error
 	return SUCCEED;
 }
 #ifdef HAVE_PTHREAD_PROCESS_SHARED
+/******************************************************************************
+ *                                                                            *
+ * Function: lock_stats_acquired                                              *
+ *                                                                            *
+ * Purpose: remember when and where the current process acquired a lock       *
+ *                                                                            *
+ * Parameters: index      - [IN] the lock index in statistics                 *
+ *             filename   - [IN] the source file acquiring the lock           *
+ *             line       - [IN] the source line acquiring the lock           *
+ *             time_start - [IN] the time the lock was requested or 0 if it   *
+ *                               was acquired without waiting                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	lock_stats_acquired(int index, const char *filename, int line, double time_start)
+{
+	zbx_lock_state_t	*state = &lock_states[index];
+
+	state->filename = filename;
+	state->line = line;
+	state->time_locked = zbx_time();
+
+	if (0 != time_start)
+	{
+		state->contended = 1;
+		state->wait_time = state->time_locked - time_start;
+	}
+	else
+	{
+		state->contended = 0;
+		state->wait_time = 0;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: lock_stats_get_site                                              *
+ *                                                                            *
+ * Purpose: find call site statistics, add them if not found                  *
+ *                                                                            *
+ * Parameters: stats    - [IN/OUT] the lock statistics                        *
+ *             filename - [IN] the source file acquiring the lock             *
+ *             line     - [IN] the source line acquiring the lock             *
+ *                                                                            *
+ * Return value: the call site statistics                                     *
+ *                                                                            *
+ * Comments: The call sites are kept in a fixed size table. When the table is *
+ *           full a new call site replaces the one with the least hold time.  *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_lock_site_stats_t	*lock_stats_get_site(zbx_lock_stats_t *stats, const char *filename, int line)
+{
+	zbx_lock_site_stats_t	*site;
+	int			i;
+
+	for (i = 0; i < stats->sites_num; i++)
+	{
+		site = &stats->sites[i];
+
+		if (site->line == line && (site->filename == filename || 0 == strcmp(site->filename, filename)))
+			return site;
+	}
+
+	if (ZBX_LOCK_SITES_NUM > stats->sites_num)
+	{
+		site = &stats->sites[stats->sites_num++];
+	}
+	else
+	{
+		site = &stats->sites[0];
+
+		for (i = 1; i < ZBX_LOCK_SITES_NUM; i++)
+		{
+			if (stats->sites[i].hold_time < site->hold_time)
+				site = &stats->sites[i];
+		}
+	}
+
+	memset(site, 0, sizeof(zbx_lock_site_stats_t));
+	site->filename = filename;
+	site->line = line;
+
+	return site;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: lock_stats_flush                                                 *
+ *                                                                            *
+ * Purpose: add lock statistics collected by current process to the shared    *
+ *          statistics                                                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	lock_stats_flush(void)
+{
+	zbx_lock_stats_t	*local;
+	zbx_lock_site_stats_t	*site;
+	zbx_shared_lock_stats_t	*shared;
+	int			index, i;
+
+	for (index = 0; index < ZBX_MUTEX_COUNT + ZBX_RWLOCK_COUNT; index++)
+	{
+		local = &lock_local_stats[index];
+
+		if (0 == local->acquisitions)
+			continue;
+
+		shared = &shared_lock->stats[index];
+
+		if (0 != pthread_mutex_lock(&shared->lock))
+			continue;
+
+		shared->stats.acquisitions += local->acquisitions;
+		shared->stats.contended += local->contended;
+		shared->stats.wait_time += local->wait_time;
+		shared->stats.hold_time += local->hold_time;
+
+		if (local->hold_time_max > shared->stats.hold_time_max)
+			shared->stats.hold_time_max = local->hold_time_max;
+
+		for (i = 0; i < local->sites_num; i++)
+		{
+			site = lock_stats_get_site(&shared->stats, local->sites[i].filename, local->sites[i].line);
+
+			site->acquisitions += local->sites[i].acquisitions;
+			site->contended += local->sites[i].contended;
+			site->wait_time += local->sites[i].wait_time;
+			site->hold_time += local->sites[i].hold_time;
+
+			if (local->sites[i].hold_time_max > site->hold_time_max)
+				site->hold_time_max = local->sites[i].hold_time_max;
+		}
+
+		pthread_mutex_unlock(&shared->lock);
+
+		memset(local, 0, sizeof(zbx_lock_stats_t));
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: lock_stats_released                                              *
+ *                                                                            *
+ * Purpose: update statistics of a lock released by current process           *
+ *                                                                            *
+ * Parameters: index         - [IN] the lock index in statistics              *
+ *             time_unlocked - [IN] the time the lock was released            *
+ *                                                                            *
+ * Comments: The statistics are collected locally and added to the shared     *
+ *           statistics once per ZBX_LOCK_STATS_FLUSH_DELAY seconds, or when  *
+ *           the local call site table is full, so that releasing a lock does *
+ *           not require locking the shared statistics.                       *
+ *           A lock released by a signal handler while the statistics are     *
+ *           being updated is not counted.                                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	lock_stats_released(int index, double time_unlocked)
+{
+	static int		busy;
+	const zbx_lock_state_t	*state = &lock_states[index];
+	zbx_lock_stats_t	*local = &lock_local_stats[index];
+	zbx_lock_site_stats_t	*site;
+	double			hold_time;
+	int			i;
+
+	if (0 != busy)
+		return;
+
+	busy = 1;
+
+	hold_time = time_unlocked - state->time_locked;
+
+	for (i = 0; i < local->sites_num; i++)
+	{
+		if (local->sites[i].line == state->line && local->sites[i].filename == state->filename)
+			break;
+	}
+
+	/* do not lose call sites of the current period by replacing them */
+	if (i == ZBX_LOCK_SITES_NUM)
+	{
+		lock_stats_flush();
+		lock_stats_flush_time = time_unlocked;
+	}
+
+	local->acquisitions++;
+	local->contended += (zbx_uint64_t)state->contended;
+	local->wait_time += state->wait_time;
+	local->hold_time += hold_time;
+
+	if (hold_time > local->hold_time_max)
+		local->hold_time_max = hold_time;
+
+	site = lock_stats_get_site(local, state->filename, state->line);
+
+	site->acquisitions++;
+	site->contended += (zbx_uint64_t)state->contended;
+	site->wait_time += state->wait_time;
+	site->hold_time += hold_time;
+
+	if (hold_time > site->hold_time_max)
+		site->hold_time_max = hold_time;
+
+	if (ZBX_LOCK_STATS_FLUSH_DELAY <= time_unlocked - lock_stats_flush_time)
+	{
+		lock_stats_flush();
+		lock_stats_flush_time = time_unlocked;
+	}
+
+	busy = 0;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: __zbx_rwlock_wrlock                                              *
@@ -209,17 +470,28 @@ int	zbx_rwlock_create(zbx_rwlock_t *rwlock, zbx_rwlock_name_t name, char **error
  ******************************************************************************/
 void	__zbx_rwlock_wrlock(const char *filename, int line, zbx_rwlock_t rwlock)
 {
+	double	time_start = 0;
+
 	if (ZBX_RWLOCK_NULL == rwlock)
 		return;
 
 	if (0 != locks_disabled)
 		return;
 
-	if (0 != pthread_rwlock_wrlock(rwlock))
+	if (0 == lock_stats_enabled || 0 != pthread_rwlock_trywrlock(rwlock))
 	{
-		zbx_error("[file:'%s',line:%d] write lock failed: %s", filename, line, zbx_strerror(errno));
-		exit(EXIT_FAILURE);
+		if (0 != lock_stats_enabled)
+			time_start = zbx_time();
+
+		if (0 != pthread_rwlock_wrlock(rwlock))
+		{
+			zbx_error("[file:'%s',line:%d] write lock failed: %s", filename, line, zbx_strerror(errno));
+			exit(EXIT_FAILURE);
+		}
 	}
+
+	if (0 != lock_stats_enabled)
+		lock_stats_acquired(RWLOCK_STATS_INDEX(rwlock), filename, line, time_start);
 }
 
 /******************************************************************************
@@ -233,17 +505,28 @@ void	__zbx_rwlock_wrlock(const char *filename, int line, zbx_rwlock_t rwlock)
  ******************************************************************************/
 void	__zbx_rwlock_rdlock(const char *filename, int line, zbx_rwlock_t rwlock)
 {
+	double	time_start = 0;
+
 	if (ZBX_RWLOCK_NULL == rwlock)
 		return;
 
 	if (0 != locks_disabled)
 		return;
 
-	if (0 != pthread_rwlock_rdlock(rwlock))
+	if (0 == lock_stats_enabled || 0 != pthread_rwlock_tryrdlock(rwlock))
 	{
-		zbx_error("[file:'%s',line:%d] read lock failed: %s", filename, line, zbx_strerror(errno));
-		exit(EXIT_FAILURE);
+		if (0 != lock_stats_enabled)
+			time_start = zbx_time();
+
+		if (0 != pthread_rwlock_rdlock(rwlock))
+		{
+			zbx_error("[file:'%s',line:%d] read lock failed: %s", filename, line, zbx_strerror(errno));
+			exit(EXIT_FAILURE);
+		}
 	}
+
+	if (0 != lock_stats_enabled)
+		lock_stats_acquired(RWLOCK_STATS_INDEX(rwlock), filename, line, time_start);
 }
 
 /******************************************************************************
@@ -257,17 +540,25 @@ void	__zbx_rwlock_rdlock(const char *filename, int line, zbx_rwlock_t rwlock)
  ******************************************************************************/
 void	__zbx_rwlock_unlock(const char *filename, int line, zbx_rwlock_t rwlock)
 {
+	double	time_unlocked = 0;
+
 	if (ZBX_RWLOCK_NULL == rwlock)
 		return;
 
 	if (0 != locks_disabled)
 		return;
 
+	if (0 != lock_stats_enabled)
+		time_unlocked = zbx_time();
+
 	if (0 != pthread_rwlock_unlock(rwlock))
 	{
 		zbx_error("[file:'%s',line:%d] read-write lock unlock failed: %s", filename, line, zbx_strerror(errno));
 		exit(EXIT_FAILURE);
 	}
+
+	if (0 != lock_stats_enabled)
+		lock_stats_released(RWLOCK_STATS_INDEX(rwlock), time_unlocked);
 }
 
 /******************************************************************************
@@ -307,7 +598,113 @@ void	zbx_locks_disable(void)
 	/* attempting to destroy a locked pthread mutex results in undefined behavior */
 	locks_disabled = 1;
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: lock_compare_sites                                               *
+ *                                                                            *
+ * Purpose: sort lock call sites by hold time in descending order             *
+ *                                                                            *
+ ******************************************************************************/
+static int	lock_compare_sites(const void *d1, const void *d2)
+{
+	const zbx_lock_site_stats_t	*s1 = (const zbx_lock_site_stats_t *)d1;
+	const zbx_lock_site_stats_t	*s2 = (const zbx_lock_site_stats_t *)d2;
+
+	if (s1->hold_time > s2->hold_time)
+		return -1;
+
+	if (s1->hold_time < s2->hold_time)
+		return 1;
+
+	return 0;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_locks_enable_stats                                           *
+ *                                                                            *
+ * Purpose: enable lock contention and hold time statistics                   *
+ *                                                                            *
+ * Comments: Must be called by the parent process after zbx_locks_create()    *
+ *           and before starting child processes. Statistics are supported    *
+ *           only with process shared pthread locks.                          *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_locks_enable_stats(void)
+{
+#ifdef HAVE_PTHREAD_PROCESS_SHARED
+	lock_stats_enabled = 1;
 #endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_lock_name                                                    *
+ *                                                                            *
+ * Purpose: get lock name by its index in statistics                          *
+ *                                                                            *
+ * Parameters: index - [IN] the lock index                                    *
+ *                                                                            *
+ * Return value: the lock name or NULL if the index is out of range           *
+ *                                                                            *
+ ******************************************************************************/
+const char	*zbx_lock_name(int index)
+{
+	if (0 > index || ZBX_MUTEX_COUNT + ZBX_RWLOCK_COUNT <= index)
+		return NULL;
+
+	return lock_names[index];
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_lock_get_stats                                               *
+ *                                                                            *
+ * Purpose: get lock contention and hold time statistics                      *
+ *                                                                            *
+ * Parameters: name  - [IN] the lock name                                     *
+ *             stats - [OUT] the lock statistics, call sites are sorted by    *
+ *                           hold time in descending order                    *
+ *                                                                            *
+ * Return value: SUCCEED - the statistics were returned successfully          *
+ *               FAIL    - unknown lock name or statistics are disabled       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_lock_get_stats(const char *name, zbx_lock_stats_t *stats)
+{
+#ifdef HAVE_PTHREAD_PROCESS_SHARED
+	int	index;
+
+	if (0 == lock_stats_enabled || NULL == shared_lock)
+		return FAIL;
+
+	for (index = 0; ZBX_MUTEX_COUNT + ZBX_RWLOCK_COUNT > index; index++)
+	{
+		if (0 == strcmp(lock_names[index], name))
+			break;
+	}
+
+	if (ZBX_MUTEX_COUNT + ZBX_RWLOCK_COUNT == index)
+		return FAIL;
+
+	if (0 != pthread_mutex_lock(&shared_lock->stats[index].lock))
+		return FAIL;
+
+	*stats = shared_lock->stats[index].stats;
+	pthread_mutex_unlock(&shared_lock->stats[index].lock);
+
+	qsort(stats->sites, (size_t)stats->sites_num, sizeof(zbx_lock_site_stats_t), lock_compare_sites);
+
+	return SUCCEED;
+#else
+	ZBX_UNUSED(name);
+	ZBX_UNUSED(stats);
+
+	return FAIL;
+#endif
+}
 #endif	/* _WINDOWS */
 
 /******************************************************************************
@@ -361,6 +758,8 @@ void	__zbx_mutex_lock(const char *filename, int line, zbx_mutex_t mutex)
 #ifndef _WINDOWS
 #ifndef	HAVE_PTHREAD_PROCESS_SHARED
 	struct sembuf	sem_lock;
+#else
+	double		time_start = 0;
 #endif
 #else
 	DWORD   dwWaitResult;
@@ -397,11 +796,20 @@ void	__zbx_mutex_lock(const char *filename, int line, zbx_mutex_t mutex)
 	if (0 != locks_disabled)
 		return;
 
-	if (0 != pthread_mutex_lock(mutex))
+	if (0 == lock_stats_enabled || 0 != pthread_mutex_trylock(mutex))
 	{
-		zbx_error("[file:'%s',line:%d] lock failed: %s", filename, line, zbx_strerror(errno));
-		exit(EXIT_FAILURE);
+		if (0 != lock_stats_enabled)
+			time_start = zbx_time();
+
+		if (0 != pthread_mutex_lock(mutex))
+		{
+			zbx_error("[file:'%s',line:%d] lock failed: %s", filename, line, zbx_strerror(errno));
+			exit(EXIT_FAILURE);
+		}
 	}
+
+	if (0 != lock_stats_enabled)
+		lock_stats_acquired(MUTEX_STATS_INDEX(mutex), filename, line, time_start);
 #else
 	sem_lock.sem_num = mutex;
 	sem_lock.sem_op = -1;
@@ -435,6 +843,8 @@ void	__zbx_mutex_unlock(const char *filename, int line, zbx_mutex_t mutex)
 #ifndef _WINDOWS
 #ifndef	HAVE_PTHREAD_PROCESS_SHARED
 	struct sembuf	sem_unlock;
+#else
+	double		time_unlocked = 0;
 #endif
 #endif
 
@@ -453,11 +863,17 @@ void	__zbx_mutex_unlock(const char *filename, int line, zbx_mutex_t mutex)
 	if (0 != locks_disabled)
 		return;
 
+	if (0 != lock_stats_enabled)
+		time_unlocked = zbx_time();
+
 	if (0 != pthread_mutex_unlock(mutex))
 	{
 		zbx_error("[file:'%s',line:%d] unlock failed: %s", filename, line, zbx_strerror(errno));
 		exit(EXIT_FAILURE);
 	}
+
+	if (0 != lock_stats_enabled)
+		lock_stats_released(MUTEX_STATS_INDEX(mutex), time_unlocked);
 #else
 	sem_unlock.sem_num = mutex;
 	sem_unlock.sem_op = 1;
@@ -549,3 +965,82 @@ zbx_mutex_name_t	zbx_mutex_create_per_process_name(const zbx_mutex_name_t prefix
 }
 #endif
 
+#ifdef ZBX_SEQLOCK
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_seqlock_write_begin                                          *
+ *                                                                            *
+ * Purpose: mark start of data update protected by sequence lock              *
+ *                                                                            *
+ * Parameters: seqlock - [IN/OUT] the sequence lock                           *
+ *                                                                            *
+ * Comments: there must be only one writer at a time                          *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_seqlock_write_begin(zbx_seqlock_t *seqlock)
+{
+	(*seqlock)++;
+	__sync_synchronize();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_seqlock_write_end                                            *
+ *                                                                            *
+ * Purpose: mark end of data update protected by sequence lock                *
+ *                                                                            *
+ * Parameters: seqlock - [IN/OUT] the sequence lock                           *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_seqlock_write_end(zbx_seqlock_t *seqlock)
+{
+	__sync_synchronize();
+	(*seqlock)++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_seqlock_read_begin                                           *
+ *                                                                            *
+ * Purpose: start reading data protected by sequence lock                     *
+ *                                                                            *
+ * Parameters: seqlock - [IN] the sequence lock                               *
+ *                                                                            *
+ * Return value: sequence number to pass to zbx_seqlock_read_retry()          *
+ *                                                                            *
+ * Comments: waits while the data is being updated                            *
+ *                                                                            *
+ ******************************************************************************/
+unsigned int	zbx_seqlock_read_begin(const zbx_seqlock_t *seqlock)
+{
+	unsigned int	seq;
+
+	while (0 != ((seq = *seqlock) & 1))
+		sched_yield();
+
+	__sync_synchronize();
+
+	return seq;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_seqlock_read_retry                                           *
+ *                                                                            *
+ * Purpose: check if data was updated while being read                        *
+ *                                                                            *
+ * Parameters: seqlock - [IN] the sequence lock                               *
+ *             seq     - [IN] sequence number returned by                     *
+ *                            zbx_seqlock_read_begin()                        *
+ *                                                                            *
+ * Return value: SUCCEED - the data was updated and must be read again        *
+ *               FAIL    - the data read is consistent                        *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_seqlock_read_retry(const zbx_seqlock_t *seqlock, unsigned int seq)
+{
+	__sync_synchronize();
+
+	return seq == *seqlock ? FAIL : SUCCEED;
+}
+#endif
@@ -41,6 +41,110 @@ typedef struct
 }
 zbx_sysinfo_proc_t;
 
+/* memory sizes read from /proc/[pid]/status */
+#define ZBX_PROC_VMSIZE		0
+#define ZBX_PROC_VMRSS		1
+#define ZBX_PROC_VMPEAK		2
+#define ZBX_PROC_VMSWAP		3
+#define ZBX_PROC_VMLIB		4
+#define ZBX_PROC_VMLCK		5
+#define ZBX_PROC_VMPIN		6
+#define ZBX_PROC_VMHWM		7
+#define ZBX_PROC_VMDATA		8
+#define ZBX_PROC_VMSTK		9
+#define ZBX_PROC_VMEXE		10
+#define ZBX_PROC_VMPTE		11
+#define ZBX_PROC_VM_COUNT	12
+
+static const char	*proc_vm_labels[ZBX_PROC_VM_COUNT] = {"VmSize:\t", "VmRSS:\t", "VmPeak:\t", "VmSwap:\t",
+		"VmLib:\t", "VmLck:\t", "VmPin:\t", "VmHWM:\t", "VmData:\t", "VmStk:\t", "VmExe:\t", "VmPTE:\t"};
+
+/* process snapshot is shared by proc.num[] and proc.mem[] items checked within the same second */
+#define ZBX_PROC_SNAPSHOT_TTL		1
+
+/* command lines are read for new snapshots while items needed them within this period */
+#define ZBX_PROC_SNAPSHOT_CMDLINE_TTL	SEC_PER_MIN
+
+typedef struct
+{
+	pid_t		pid;
+	uid_t		uid;
+	char		state;
+
+	/* the process name from /proc/[pid]/status, limited to 15 characters */
+	char		*name;
+
+	/* SUCCEED if the command line was read, FAIL if it could not be read and */
+	/* NOTSUPPORTED if the snapshot was taken without command lines           */
+	int		cmdline_status;
+
+	/* the process name taken from the 0th argument */
+	char		*name_arg0;
+
+	/* process command line in format <arg0> <arg1> ... <argN> */
+	char		*cmdline;
+
+	/* SUCCEED, NOTSUPPORTED if the size is missing (e.g. kernel threads) or FAIL if it cannot be parsed */
+	int		vm_status[ZBX_PROC_VM_COUNT];
+	zbx_uint64_t	vm[ZBX_PROC_VM_COUNT];
+}
+zbx_proc_status_t;
+
+static ZBX_THREAD_LOCAL zbx_vector_ptr_t	proc_snapshot;
+static ZBX_THREAD_LOCAL int			proc_snapshot_created = 0;
+static ZBX_THREAD_LOCAL int			proc_snapshot_time = 0;
+static ZBX_THREAD_LOCAL int			proc_snapshot_cmdline = 0;
+
+/*
+ * The agent processes share the last snapshot through the collector shared memory segment. It is taken by the
+ * process that first finds it expired while holding the segment lock, the other processes copy it.
+ *
+ *  .--------------------------------------.
+ *  | header                               |
+ *  | ------------------------------------ |
+ *  | processes                            |
+ *  | ------------------------------------ |
+ *  | strings                              |
+ *  '--------------------------------------'
+ *
+ * Strings are referenced by offsets from the beginning of the segment, 0 offset is interpreted as NULL pointer.
+ * The segment is zeroed when it is reallocated, so the snapshot time 0 means there is no snapshot.
+ */
+typedef struct
+{
+	/* the time the snapshot was taken */
+	int	time;
+
+	/* the last time an item needed command lines */
+	int	cmdline_accessed;
+
+	/* 1 if the snapshot contains command lines */
+	int	cmdline;
+
+	int	processes_num;
+}
+zbx_proc_snapshot_header_t;
+
+typedef struct
+{
+	pid_t		pid;
+	uid_t		uid;
+	char		state;
+	int		cmdline_status;
+	size_t		name;
+	size_t		name_arg0;
+	size_t		cmdline;
+	int		vm_status[ZBX_PROC_VM_COUNT];
+	zbx_uint64_t	vm[ZBX_PROC_VM_COUNT];
+}
+zbx_proc_snapshot_entry_t;
+
+#define PROC_SNAPSHOT_ALIGNED_HEADER_SIZE	ZBX_SIZE_T_ALIGN8(sizeof(zbx_proc_snapshot_header_t))
+#define PROC_SNAPSHOT_PTR_NULL(base, offset)	(0 == (offset) ? NULL : (char *)(base) + (offset))
+
+/* local reference to the process snapshot shared memory */
+static zbx_dshm_ref_t	proc_snapshot_ref = {ZBX_NONEXISTENT_SHMID, NULL};
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_sysinfo_proc_free                                            *
@@ -92,253 +196,650 @@ static int	get_cmdline(FILE *f_cmd, char **line, size_t *line_offset)
 	return FAIL;
 }
 
-static int	cmp_status(FILE *f_stat, const char *procname)
+/******************************************************************************
+ *                                                                            *
+ * Function: parse_byte_value                                                 *
+ *                                                                            *
+ * Purpose: parses amount of memory in bytes from a /proc file value, e.g.    *
+ *          "   176712 kB\n"                                                  *
+ *                                                                            *
+ * Parameters: p_value - [IN] the value, it is modified by this function      *
+ *             bytes   - [OUT] result in bytes                                *
+ *                                                                            *
+ * Return value: SUCCEED - the value was parsed                               *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	parse_byte_value(char *p_value, zbx_uint64_t *bytes)
 {
-	char	tmp[MAX_STRING_LEN];
+	char	*p_unit;
+
+	if (NULL == (p_unit = strrchr(p_value, ' ')))
+		return FAIL;
+
+	*p_unit++ = '\0';
+
+	while (' ' == *p_value)
+		p_value++;
+
+	if (FAIL == is_uint64(p_value, bytes))
+		return FAIL;
+
+	zbx_rtrim(p_unit, "\n");
+
+	if (0 == strcasecmp(p_unit, "kB"))
+		*bytes <<= 10;
+	else if (0 == strcasecmp(p_unit, "mB"))
+		*bytes <<= 20;
+	else if (0 == strcasecmp(p_unit, "GB"))
+		*bytes <<= 30;
+	else if (0 == strcasecmp(p_unit, "TB"))
+		*bytes <<= 40;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: byte_value_from_proc_file                                        *
+ *                                                                            *
+ * Purpose: Read amount of memory in bytes from a string in /proc file.       *
+ *          For example, reading "VmSize:   176712 kB" from /proc/1/status    *
+ *          will produce a result 176712*1024 = 180953088 bytes               *
+ *                                                                            *
+ * Parameters:                                                                *
+ *     f     - [IN] file to read from                                         *
+ *     label - [IN] label to look for, e.g. "VmData:\t"                       *
+ *     guard - [IN] label before which to stop, e.g. "VmStk:\t" (optional)    *
+ *     bytes - [OUT] result in bytes                                          *
+ *                                                                            *
+ * Return value: SUCCEED - successful reading,                                *
+ *               NOTSUPPORTED - the search string was not found. For example, *
+ *                              /proc/NNN/status files for kernel threads do  *
+ *                              not contain "VmSize:" string.                 *
+ *               FAIL - the search string was found but could not be parsed.  *
+ *                                                                            *
+ ******************************************************************************/
+int	byte_value_from_proc_file(FILE *f, const char *label, const char *guard, zbx_uint64_t *bytes)
+{
+	char	buf[MAX_STRING_LEN], *p_value;
+	size_t	label_len, guard_len;
+	long	pos = 0;
+	int	ret = NOTSUPPORTED;
 
-	rewind(f_stat);
+	label_len = strlen(label);
+	p_value = buf + label_len;
 
-	while (NULL != fgets(tmp, (int)sizeof(tmp), f_stat))
+	if (NULL != guard)
 	{
-		if (0 != strncmp(tmp, "Name:\t", 6))
+		guard_len = strlen(guard);
+		if (0 > (pos = ftell(f)))
+			return FAIL;
+	}
+
+	while (NULL != fgets(buf, (int)sizeof(buf), f))
+	{
+		if (NULL != guard)
+		{
+			if (0 == strncmp(buf, guard, guard_len))
+			{
+				if (0 != fseek(f, pos, SEEK_SET))
+					ret = FAIL;
+				break;
+			}
+
+			if (0 > (pos = ftell(f)))
+			{
+				ret = FAIL;
+				break;
+			}
+		}
+
+		if (0 != strncmp(buf, label, label_len))
 			continue;
 
-		zbx_rtrim(tmp + 6, "\n");
-		if (0 == strcmp(tmp + 6, procname))
-			return SUCCEED;
+		ret = parse_byte_value(p_value, bytes);
 		break;
 	}
 
-	return FAIL;
+	return ret;
 }
 
-static int	check_procname(FILE *f_cmd, FILE *f_stat, const char *procname)
+static int	get_total_memory(zbx_uint64_t *total_memory)
 {
-	char	*tmp = NULL, *p;
-	size_t	l;
-	int	ret = SUCCEED;
+	FILE	*f;
+	int	ret = FAIL;
 
-	if (NULL == procname || '\0' == *procname)
-		return SUCCEED;
+	if (NULL != (f = fopen("/proc/meminfo", "r")))
+	{
+		ret = byte_value_from_proc_file(f, "MemTotal:", NULL, total_memory);
+		zbx_fclose(f);
+	}
 
-	/* process name in /proc/[pid]/status contains limited number of characters */
-	if (SUCCEED == cmp_status(f_stat, procname))
-		return SUCCEED;
+	return ret;
+}
 
-	if (SUCCEED == get_cmdline(f_cmd, &tmp, &l))
-	{
-		if (NULL == (p = strrchr(tmp, '/')))
-			p = tmp;
-		else
-			p++;
+/******************************************************************************
+ *                                                                            *
+ * Function: proc_status_read_cmdline                                         *
+ *                                                                            *
+ * Purpose: reads process command line                                        *
+ *                                                                            *
+ * Parameters: proc  - [IN/OUT] the process                                   *
+ *             f_cmd - [IN] the opened /proc/[pid]/cmdline file               *
+ *                                                                            *
+ ******************************************************************************/
+static void	proc_status_read_cmdline(zbx_proc_status_t *proc, FILE *f_cmd)
+{
+	char	*line = NULL, *p;
+	size_t	i, l;
 
-		if (0 == strcmp(p, procname))
-			goto clean;
-	}
+	proc->cmdline_status = FAIL;
 
-	ret = FAIL;
-clean:
-	zbx_free(tmp);
+	if (SUCCEED != get_cmdline(f_cmd, &line, &l))
+		return;
 
-	return ret;
+	if (NULL == (p = strrchr(line, '/')))
+		p = line;
+	else
+		p++;
+
+	proc->name_arg0 = zbx_strdup(NULL, p);
+
+	for (i = 0, l -= 2; i < l; i++)
+		if ('\0' == line[i])
+			line[i] = ' ';
+
+	proc->cmdline = line;
+	proc->cmdline_status = SUCCEED;
 }
 
-static int	check_user(FILE *f_stat, struct passwd *usrinfo)
+/******************************************************************************
+ *                                                                            *
+ * Function: proc_status_create                                               *
+ *                                                                            *
+ * Purpose: reads process properties from /proc/[pid]/status file and,        *
+ *          optionally, the command line                                      *
+ *                                                                            *
+ * Parameters: pid     - [IN] the process identifier                          *
+ *             cmdline - [IN] 1 - read the command line, 0 - otherwise        *
+ *                                                                            *
+ * Return value: The created process object or NULL if the process is gone.   *
+ *                                                                            *
+ * Comments: Processes with command line files that cannot be opened are      *
+ *           skipped whether the command line is read or not.                 *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_proc_status_t	*proc_status_create(pid_t pid, int cmdline)
 {
-	char	tmp[MAX_STRING_LEN], *p, *p1;
-	uid_t	uid;
+	char			tmp[MAX_STRING_LEN];
+	FILE			*f, *f_cmd;
+	zbx_proc_status_t	*proc;
+	int			i;
+	size_t			len;
 
-	if (NULL == usrinfo)
-		return SUCCEED;
+	zbx_snprintf(tmp, sizeof(tmp), "/proc/%d/cmdline", (int)pid);
+
+	if (NULL == (f_cmd = fopen(tmp, "r")))
+		return NULL;
 
-	rewind(f_stat);
+	zbx_snprintf(tmp, sizeof(tmp), "/proc/%d/status", (int)pid);
 
-	while (NULL != fgets(tmp, (int)sizeof(tmp), f_stat))
+	if (NULL == (f = fopen(tmp, "r")))
 	{
-		if (0 != strncmp(tmp, "Uid:\t", 5))
-			continue;
+		zbx_fclose(f_cmd);
+		return NULL;
+	}
 
-		p = tmp + 5;
+	proc = (zbx_proc_status_t *)zbx_malloc(NULL, sizeof(zbx_proc_status_t));
 
-		if (NULL != (p1 = strchr(p, '\t')))
-			*p1 = '\0';
+	proc->pid = pid;
+	proc->uid = (uid_t)-1;
+	proc->state = '\0';
+	proc->name = NULL;
+	proc->cmdline_status = NOTSUPPORTED;
+	proc->name_arg0 = NULL;
+	proc->cmdline = NULL;
 
-		uid = (uid_t)atoi(p);
+	for (i = 0; i < ZBX_PROC_VM_COUNT; i++)
+		proc->vm_status[i] = NOTSUPPORTED;
 
-		if (usrinfo->pw_uid == uid)
-			return SUCCEED;
-		break;
+	while (NULL != fgets(tmp, (int)sizeof(tmp), f))
+	{
+		if (0 == strncmp(tmp, "Name:\t", 6))
+		{
+			if (NULL == proc->name)
+			{
+				zbx_rtrim(tmp + 6, "\n");
+				proc->name = zbx_strdup(NULL, tmp + 6);
+			}
+		}
+		else if (0 == strncmp(tmp, "State:\t", 7))
+		{
+			if ('\0' == proc->state)
+				proc->state = tmp[7];
+		}
+		else if (0 == strncmp(tmp, "Uid:\t", 5))
+		{
+			if ((uid_t)-1 == proc->uid)
+				proc->uid = (uid_t)atoi(tmp + 5);
+		}
+		else if (0 == strncmp(tmp, "Vm", 2))
+		{
+			for (i = 0; i < ZBX_PROC_VM_COUNT; i++)
+			{
+				len = strlen(proc_vm_labels[i]);
+
+				if (0 == strncmp(tmp, proc_vm_labels[i], len))
+				{
+					proc->vm_status[i] = parse_byte_value(tmp + len, &proc->vm[i]);
+					break;
+				}
+			}
+		}
 	}
 
-	return FAIL;
+	zbx_fclose(f);
+
+	if (1 == cmdline)
+		proc_status_read_cmdline(proc, f_cmd);
+
+	zbx_fclose(f_cmd);
+
+	return proc;
 }
 
-static int	check_proccomm(FILE *f_cmd, const char *proccomm)
+static void	proc_status_free(zbx_proc_status_t *proc)
 {
-	char	*tmp = NULL;
-	size_t	i, l;
-	int	ret = SUCCEED;
+	zbx_free(proc->name);
+	zbx_free(proc->name_arg0);
+	zbx_free(proc->cmdline);
 
-	if (NULL == proccomm || '\0' == *proccomm)
+	zbx_free(proc);
+}
+
+static int	check_procname(const zbx_proc_status_t *proc, const char *procname)
+{
+	if (NULL == procname || '\0' == *procname)
 		return SUCCEED;
 
-	if (SUCCEED == get_cmdline(f_cmd, &tmp, &l))
-	{
-		for (i = 0, l -= 2; i < l; i++)
-			if ('\0' == tmp[i])
-				tmp[i] = ' ';
+	/* process name in /proc/[pid]/status contains limited number of characters */
+	if (NULL != proc->name && 0 == strcmp(proc->name, procname))
+		return SUCCEED;
 
-		if (NULL != zbx_regexp_match(tmp, proccomm, NULL))
-			goto clean;
-	}
+	if (SUCCEED == proc->cmdline_status && 0 == strcmp(proc->name_arg0, procname))
+		return SUCCEED;
 
-	ret = FAIL;
-clean:
-	zbx_free(tmp);
+	return FAIL;
+}
 
-	return ret;
+static int	check_user(const zbx_proc_status_t *proc, const struct passwd *usrinfo)
+{
+	if (NULL == usrinfo)
+		return SUCCEED;
+
+	return usrinfo->pw_uid == proc->uid ? SUCCEED : FAIL;
 }
 
-static int	check_procstate(FILE *f_stat, int zbx_proc_stat)
+static int	check_proccomm(const zbx_proc_status_t *proc, const char *proccomm)
 {
-	char	tmp[MAX_STRING_LEN], *p;
+	if (NULL == proccomm || '\0' == *proccomm)
+		return SUCCEED;
 
-	if (ZBX_PROC_STAT_ALL == zbx_proc_stat)
+	if (SUCCEED == proc->cmdline_status && NULL != zbx_regexp_match(proc->cmdline, proccomm, NULL))
 		return SUCCEED;
 
-	rewind(f_stat);
+	return FAIL;
+}
+
+static int	check_procstate(const zbx_proc_status_t *proc, int zbx_proc_stat)
+{
+	switch (zbx_proc_stat)
+	{
+		case ZBX_PROC_STAT_ALL:
+			return SUCCEED;
+		case ZBX_PROC_STAT_RUN:
+			return ('R' == proc->state) ? SUCCEED : FAIL;
+		case ZBX_PROC_STAT_SLEEP:
+			return ('S' == proc->state) ? SUCCEED : FAIL;
+		case ZBX_PROC_STAT_ZOMB:
+			return ('Z' == proc->state) ? SUCCEED : FAIL;
+		case ZBX_PROC_STAT_DISK:
+			return ('D' == proc->state) ? SUCCEED : FAIL;
+		case ZBX_PROC_STAT_TRACE:
+			return ('T' == proc->state) ? SUCCEED : FAIL;
+		default:
+			return FAIL;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proc_read_snapshot                                               *
+ *                                                                            *
+ * Purpose: reads the process table from /proc into the local snapshot        *
+ *                                                                            *
+ * Parameters: now     - [IN] the current time                                *
+ *             cmdline - [IN] 1 - read command lines, 0 - otherwise           *
+ *             error   - [OUT] the error message                              *
+ *                                                                            *
+ * Return value: SUCCEED - the process table was read                         *
+ *               FAIL    - failed to open /proc directory                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	proc_read_snapshot(int now, int cmdline, char **error)
+{
+	DIR			*dir;
+	struct dirent		*entries;
+	zbx_proc_status_t	*proc;
+	int			pid;
+
+	zbx_vector_ptr_clear_ext(&proc_snapshot, (zbx_mem_free_func_t)proc_status_free);
+	proc_snapshot_time = 0;
 
-	while (NULL != fgets(tmp, (int)sizeof(tmp), f_stat))
+	if (NULL == (dir = opendir("/proc")))
 	{
-		if (0 != strncmp(tmp, "State:\t", 7))
+		*error = zbx_dsprintf(*error, "Cannot open /proc: %s", zbx_strerror(errno));
+		return FAIL;
+	}
+
+	while (NULL != (entries = readdir(dir)))
+	{
+		/* skip entries not containing pids */
+		if (FAIL == is_uint32(entries->d_name, &pid))
 			continue;
 
-		p = tmp + 7;
+		if (NULL == (proc = proc_status_create(pid, cmdline)))
+			continue;
 
-		switch (zbx_proc_stat)
-		{
-			case ZBX_PROC_STAT_RUN:
-				return ('R' == *p) ? SUCCEED : FAIL;
-			case ZBX_PROC_STAT_SLEEP:
-				return ('S' == *p) ? SUCCEED : FAIL;
-			case ZBX_PROC_STAT_ZOMB:
-				return ('Z' == *p) ? SUCCEED : FAIL;
-			case ZBX_PROC_STAT_DISK:
-				return ('D' == *p) ? SUCCEED : FAIL;
-			case ZBX_PROC_STAT_TRACE:
-				return ('T' == *p) ? SUCCEED : FAIL;
-			default:
-				return FAIL;
-		}
+		zbx_vector_ptr_append(&proc_snapshot, proc);
 	}
 
-	return FAIL;
+	closedir(dir);
+
+	proc_snapshot_time = now;
+	proc_snapshot_cmdline = cmdline;
+
+	return SUCCEED;
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: byte_value_from_proc_file                                        *
+ * Function: proc_snapshot_strdup                                             *
  *                                                                            *
- * Purpose: Read amount of memory in bytes from a string in /proc file.       *
- *          For example, reading "VmSize:   176712 kB" from /proc/1/status    *
- *          will produce a result 176712*1024 = 180953088 bytes               *
+ * Purpose: copies a string into the process snapshot shared memory           *
  *                                                                            *
- * Parameters:                                                                *
- *     f     - [IN] file to read from                                         *
- *     label - [IN] label to look for, e.g. "VmData:\t"                       *
- *     guard - [IN] label before which to stop, e.g. "VmStk:\t" (optional)    *
- *     bytes - [OUT] result in bytes                                          *
+ * Parameters: base   - [IN] the process snapshot shared memory segment       *
+ *             offset - [IN/OUT] the offset of free space in the segment      *
+ *             str    - [IN] the string to copy                               *
  *                                                                            *
- * Return value: SUCCEED - successful reading,                                *
- *               NOTSUPPORTED - the search string was not found. For example, *
- *                              /proc/NNN/status files for kernel threads do  *
- *                              not contain "VmSize:" string.                 *
- *               FAIL - the search string was found but could not be parsed.  *
+ * Return value: The offset of the copied string or 0 if the string is NULL.  *
  *                                                                            *
  ******************************************************************************/
-int	byte_value_from_proc_file(FILE *f, const char *label, const char *guard, zbx_uint64_t *bytes)
+static size_t	proc_snapshot_strdup(void *base, size_t *offset, const char *str)
 {
-	char	buf[MAX_STRING_LEN], *p_value, *p_unit;
-	size_t	label_len, guard_len;
-	long	pos = 0;
-	int	ret = NOTSUPPORTED;
+	size_t	len, str_offset;
 
-	label_len = strlen(label);
-	p_value = buf + label_len;
+	if (NULL == str)
+		return 0;
 
-	if (NULL != guard)
+	len = strlen(str) + 1;
+	memcpy((char *)base + *offset, str, len);
+	str_offset = *offset;
+	*offset += len;
+
+	return str_offset;
+}
+
+static size_t	proc_snapshot_strlen(const char *str)
+{
+	return NULL == str ? 0 : strlen(str) + 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proc_snapshot_size                                               *
+ *                                                                            *
+ * Purpose: calculates the shared memory size required for the local snapshot *
+ *                                                                            *
+ ******************************************************************************/
+static size_t	proc_snapshot_size(void)
+{
+	const zbx_proc_status_t	*proc;
+	size_t			size;
+	int			i;
+
+	size = PROC_SNAPSHOT_ALIGNED_HEADER_SIZE + (size_t)proc_snapshot.values_num * sizeof(zbx_proc_snapshot_entry_t);
+
+	for (i = 0; i < proc_snapshot.values_num; i++)
 	{
-		guard_len = strlen(guard);
-		if (0 > (pos = ftell(f)))
-			return FAIL;
+		proc = (const zbx_proc_status_t *)proc_snapshot.values[i];
+
+		size += proc_snapshot_strlen(proc->name) + proc_snapshot_strlen(proc->name_arg0) +
+				proc_snapshot_strlen(proc->cmdline);
 	}
 
-	while (NULL != fgets(buf, (int)sizeof(buf), f))
+	return size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proc_snapshot_pack                                               *
+ *                                                                            *
+ * Purpose: copies the local snapshot into the process snapshot shared memory *
+ *                                                                            *
+ * Parameters: base - [IN] the process snapshot shared memory segment, it     *
+ *                         must be at least proc_snapshot_size() bytes large  *
+ *                                                                            *
+ ******************************************************************************/
+static void	proc_snapshot_pack(void *base)
+{
+	zbx_proc_snapshot_header_t	*header = (zbx_proc_snapshot_header_t *)base;
+	zbx_proc_snapshot_entry_t	*entries, *entry;
+	const zbx_proc_status_t		*proc;
+	size_t				offset;
+	int				i;
+
+	entries = (zbx_proc_snapshot_entry_t *)((char *)base + PROC_SNAPSHOT_ALIGNED_HEADER_SIZE);
+	offset = PROC_SNAPSHOT_ALIGNED_HEADER_SIZE + (size_t)proc_snapshot.values_num *
+			sizeof(zbx_proc_snapshot_entry_t);
+
+	for (i = 0; i < proc_snapshot.values_num; i++)
 	{
-		if (NULL != guard)
-		{
-			if (0 == strncmp(buf, guard, guard_len))
-			{
-				if (0 != fseek(f, pos, SEEK_SET))
-					ret = FAIL;
-				break;
-			}
+		proc = (const zbx_proc_status_t *)proc_snapshot.values[i];
+		entry = &entries[i];
+
+		entry->pid = proc->pid;
+		entry->uid = proc->uid;
+		entry->state = proc->state;
+		entry->cmdline_status = proc->cmdline_status;
+		entry->name = proc_snapshot_strdup(base, &offset, proc->name);
+		entry->name_arg0 = proc_snapshot_strdup(base, &offset, proc->name_arg0);
+		entry->cmdline = proc_snapshot_strdup(base, &offset, proc->cmdline);
+		memcpy(entry->vm_status, proc->vm_status, sizeof(entry->vm_status));
+		memcpy(entry->vm, proc->vm, sizeof(entry->vm));
+	}
 
-			if (0 > (pos = ftell(f)))
-			{
-				ret = FAIL;
-				break;
-			}
-		}
+	header->processes_num = proc_snapshot.values_num;
+	header->cmdline = proc_snapshot_cmdline;
+	header->time = proc_snapshot_time;
+}
 
-		if (0 != strncmp(buf, label, label_len))
-			continue;
+/******************************************************************************
+ *                                                                            *
+ * Function: proc_snapshot_unpack                                             *
+ *                                                                            *
+ * Purpose: copies the snapshot from the process snapshot shared memory into  *
+ *          the local snapshot                                                *
+ *                                                                            *
+ * Parameters: base - [IN] the process snapshot shared memory segment         *
+ *                                                                            *
+ ******************************************************************************/
+static void	proc_snapshot_unpack(const void *base)
+{
+	const zbx_proc_snapshot_header_t	*header = (const zbx_proc_snapshot_header_t *)base;
+	const zbx_proc_snapshot_entry_t		*entries, *entry;
+	zbx_proc_status_t			*proc;
+	int					i;
 
-		if (NULL == (p_unit = strrchr(p_value, ' ')))
-		{
-			ret = FAIL;
-			break;
-		}
+	zbx_vector_ptr_clear_ext(&proc_snapshot, (zbx_mem_free_func_t)proc_status_free);
+	zbx_vector_ptr_reserve(&proc_snapshot, (size_t)header->processes_num);
+
+	entries = (const zbx_proc_snapshot_entry_t *)((const char *)base + PROC_SNAPSHOT_ALIGNED_HEADER_SIZE);
 
-		*p_unit++ = '\0';
+	for (i = 0; i < header->processes_num; i++)
+	{
+		entry = &entries[i];
+		proc = (zbx_proc_status_t *)zbx_malloc(NULL, sizeof(zbx_proc_status_t));
+
+		proc->pid = entry->pid;
+		proc->uid = entry->uid;
+		proc->state = entry->state;
+		proc->cmdline_status = entry->cmdline_status;
+		proc->name = zbx_strdup(NULL, PROC_SNAPSHOT_PTR_NULL(base, entry->name));
+		proc->name_arg0 = zbx_strdup(NULL, PROC_SNAPSHOT_PTR_NULL(base, entry->name_arg0));
+		proc->cmdline = zbx_strdup(NULL, PROC_SNAPSHOT_PTR_NULL(base, entry->cmdline));
+		memcpy(proc->vm_status, entry->vm_status, sizeof(proc->vm_status));
+		memcpy(proc->vm, entry->vm, sizeof(proc->vm));
+
+		zbx_vector_ptr_append(&proc_snapshot, proc);
+	}
+
+	proc_snapshot_time = header->time;
+	proc_snapshot_cmdline = header->cmdline;
+}
 
-		while (' ' == *p_value)
-			p_value++;
+/******************************************************************************
+ *                                                                            *
+ * Function: proc_get_shared_snapshot                                         *
+ *                                                                            *
+ * Purpose: gets the process table shared by agent processes, reading /proc   *
+ *          only if the shared snapshot has expired                           *
+ *                                                                            *
+ * Parameters: now     - [IN] the current time                                *
+ *             cmdline - [IN] 1 - command lines are needed, 0 - otherwise     *
+ *             error   - [OUT] the error message                              *
+ *                                                                            *
+ * Return value: SUCCEED - the process table was copied into local snapshot   *
+ *               FAIL    - failed to open /proc directory                     *
+ *                                                                            *
+ * Comments: This function logs critical error and exits in the case of       *
+ *           shared memory segment operation failure.                         *
+ *                                                                            *
+ ******************************************************************************/
+static int	proc_get_shared_snapshot(int now, int cmdline, char **error)
+{
+	zbx_proc_snapshot_header_t	*header;
+	char				*errmsg = NULL;
+	int				ret, cmdline_accessed = 0;
+	size_t				size;
+
+	zbx_dshm_lock(&collector->proc_snapshot);
+
+	if (FAIL == zbx_dshm_validate_ref(&collector->proc_snapshot, &proc_snapshot_ref, &errmsg))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot validate process snapshot reference: %s", errmsg);
+		zbx_free(errmsg);
+		exit(EXIT_FAILURE);
+	}
+
+	if (NULL != (header = (zbx_proc_snapshot_header_t *)proc_snapshot_ref.addr))
+	{
+		if (1 == cmdline)
+			header->cmdline_accessed = now;
 
-		if (FAIL == is_uint64(p_value, bytes))
+		if (header->time <= now && now - header->time < ZBX_PROC_SNAPSHOT_TTL &&
+				(0 == cmdline || 1 == header->cmdline))
 		{
-			ret = FAIL;
-			break;
+			proc_snapshot_unpack(header);
+			ret = SUCCEED;
+			goto out;
 		}
 
-		zbx_rtrim(p_unit, "\n");
+		cmdline_accessed = header->cmdline_accessed;
 
-		if (0 == strcasecmp(p_unit, "kB"))
-			*bytes <<= 10;
-		else if (0 == strcasecmp(p_unit, "mB"))
-			*bytes <<= 20;
-		else if (0 == strcasecmp(p_unit, "GB"))
-			*bytes <<= 30;
-		else if (0 == strcasecmp(p_unit, "TB"))
-			*bytes <<= 40;
+		/* keep reading command lines while some items need them */
+		if (cmdline_accessed <= now && now - cmdline_accessed < ZBX_PROC_SNAPSHOT_CMDLINE_TTL)
+			cmdline = 1;
+	}
 
-		ret = SUCCEED;
-		break;
+	if (SUCCEED != (ret = proc_read_snapshot(now, cmdline, error)))
+		goto out;
+
+	if ((size = proc_snapshot_size()) > collector->proc_snapshot.size)
+	{
+		/* leave room for new processes */
+		if (FAIL == zbx_dshm_realloc(&collector->proc_snapshot, size + size / 4, &errmsg) ||
+				FAIL == zbx_dshm_validate_ref(&collector->proc_snapshot, &proc_snapshot_ref, &errmsg))
+		{
+			zabbix_log(LOG_LEVEL_CRIT, "cannot allocate shared memory for process snapshot: %s", errmsg);
+			zbx_free(errmsg);
+			exit(EXIT_FAILURE);
+		}
+
+		header = (zbx_proc_snapshot_header_t *)proc_snapshot_ref.addr;
+		header->cmdline_accessed = cmdline_accessed;
 	}
 
+	proc_snapshot_pack(proc_snapshot_ref.addr);
+out:
+	zbx_dshm_unlock(&collector->proc_snapshot);
+
 	return ret;
 }
 
-static int	get_total_memory(zbx_uint64_t *total_memory)
+/******************************************************************************
+ *                                                                            *
+ * Function: proc_get_snapshot                                                *
+ *                                                                            *
+ * Purpose: returns the process table, reading /proc only if the previous     *
+ *          snapshot has expired                                              *
+ *                                                                            *
+ * Parameters: cmdline   - [IN] 1 - command lines are needed, 0 - otherwise   *
+ *             processes - [OUT] the processes (zbx_proc_status_t)            *
+ *             error     - [OUT] the error message                            *
+ *                                                                            *
+ * Return value: SUCCEED - the process table was returned                     *
+ *               FAIL    - failed to open /proc directory                     *
+ *                                                                            *
+ * Comments: Reading properties of every process for every item is expensive  *
+ *           with thousands of processes and many items. Within the snapshot  *
+ *           lifetime all items share the same /proc/[pid]/status data and    *
+ *           command lines. When the collector is running the snapshot is     *
+ *           shared by all agent processes, so /proc is read at most once per *
+ *           snapshot lifetime whatever the number of processes checking the  *
+ *           items. Command lines are read only if items need them.           *
+ *                                                                            *
+ ******************************************************************************/
+static int	proc_get_snapshot(int cmdline, zbx_vector_ptr_t **processes, char **error)
 {
-	FILE	*f;
-	int	ret = FAIL;
+	int	ret, now;
 
-	if (NULL != (f = fopen("/proc/meminfo", "r")))
+	zabbix_log(LOG_LEVEL_TRACE, "In %s() cmdline:%d", __func__, cmdline);
+
+	now = (int)time(NULL);
+
+	if (0 == proc_snapshot_created)
 	{
-		ret = byte_value_from_proc_file(f, "MemTotal:", NULL, total_memory);
-		zbx_fclose(f);
+		zbx_vector_ptr_create(&proc_snapshot);
+		proc_snapshot_created = 1;
 	}
+	else if (proc_snapshot_time <= now && now - proc_snapshot_time < ZBX_PROC_SNAPSHOT_TTL &&
+			(0 == cmdline || 1 == proc_snapshot_cmdline))
+	{
+		ret = SUCCEED;
+		goto out;
+	}
+
+	if (NULL != collector)
+		ret = proc_get_shared_snapshot(now, cmdline, error);
+	else
+		ret = proc_read_snapshot(now, cmdline, error);
+out:
+	*processes = &proc_snapshot;
+
+	zabbix_log(LOG_LEVEL_TRACE, "End of %s(): %s, processes:%d", __func__, zbx_result_string(ret),
+			proc_snapshot.values_num);
 
 	return ret;
 }
@@ -360,17 +861,15 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 #define ZBX_VMEXE	12
 #define ZBX_VMPTE	13
 
-	char		tmp[MAX_STRING_LEN], *procname, *proccomm, *param;
-	DIR		*dir;
-	struct dirent	*entries;
-	struct passwd	*usrinfo;
-	FILE		*f_cmd = NULL, *f_stat = NULL;
-	zbx_uint64_t	mem_size = 0, byte_value = 0, total_memory;
-	double		pct_size = 0.0, pct_value = 0.0;
-	int		do_task, res, proccount = 0, invalid_user = 0, invalid_read = 0;
-	int		mem_type_tried = 0, mem_type_code;
-	char		*mem_type = NULL;
-	const char	*mem_type_search = NULL;
+	char			*procname, *proccomm, *param, *error = NULL;
+	zbx_vector_ptr_t	*processes;
+	zbx_proc_status_t	*proc;
+	struct passwd		*usrinfo;
+	zbx_uint64_t		mem_size = 0, byte_value = 0, total_memory;
+	double			pct_size = 0.0, pct_value = 0.0;
+	int			do_task, res, proccount = 0, invalid_user = 0, invalid_read = 0, i;
+	int			mem_type_tried = 0, mem_type_code, vm = ZBX_PROC_VMSIZE, cmdline;
+	char			*mem_type = NULL;
 
 	if (5 < request->nparam)
 	{
@@ -427,12 +926,12 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 	if (NULL == mem_type || '\0' == *mem_type || 0 == strcmp(mem_type, "vsize"))
 	{
 		mem_type_code = ZBX_VSIZE;		/* current virtual memory size (total program size) */
-		mem_type_search = "VmSize:\t";
+		vm = ZBX_PROC_VMSIZE;
 	}
 	else if (0 == strcmp(mem_type, "rss"))
 	{
 		mem_type_code = ZBX_RSS;		/* current resident set size (size of memory portions) */
-		mem_type_search = "VmRSS:\t";
+		vm = ZBX_PROC_VMRSS;
 	}
 	else if (0 == strcmp(mem_type, "pmem"))
 	{
@@ -445,52 +944,52 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 	else if (0 == strcmp(mem_type, "peak"))
 	{
 		mem_type_code = ZBX_VMPEAK;		/* peak virtual memory size */
-		mem_type_search = "VmPeak:\t";
+		vm = ZBX_PROC_VMPEAK;
 	}
 	else if (0 == strcmp(mem_type, "swap"))
 	{
 		mem_type_code = ZBX_VMSWAP;		/* size of swap space used */
-		mem_type_search = "VmSwap:\t";
+		vm = ZBX_PROC_VMSWAP;
 	}
 	else if (0 == strcmp(mem_type, "lib"))
 	{
 		mem_type_code = ZBX_VMLIB;		/* size of shared libraries */
-		mem_type_search = "VmLib:\t";
+		vm = ZBX_PROC_VMLIB;
 	}
 	else if (0 == strcmp(mem_type, "lck"))
 	{
 		mem_type_code = ZBX_VMLCK;		/* size of locked memory */
-		mem_type_search = "VmLck:\t";
+		vm = ZBX_PROC_VMLCK;
 	}
 	else if (0 == strcmp(mem_type, "pin"))
 	{
 		mem_type_code = ZBX_VMPIN;		/* size of pinned pages, they are never swappable */
-		mem_type_search = "VmPin:\t";
+		vm = ZBX_PROC_VMPIN;
 	}
 	else if (0 == strcmp(mem_type, "hwm"))
 	{
 		mem_type_code = ZBX_VMHWM;		/* peak resident set size ("high water mark") */
-		mem_type_search = "VmHWM:\t";
+		vm = ZBX_PROC_VMHWM;
 	}
 	else if (0 == strcmp(mem_type, "data"))
 	{
 		mem_type_code = ZBX_VMDATA;		/* size of data segment */
-		mem_type_search = "VmData:\t";
+		vm = ZBX_PROC_VMDATA;
 	}
 	else if (0 == strcmp(mem_type, "stk"))
 	{
 		mem_type_code = ZBX_VMSTK;		/* size of stack segment */
-		mem_type_search = "VmStk:\t";
+		vm = ZBX_PROC_VMSTK;
 	}
 	else if (0 == strcmp(mem_type, "exe"))
 	{
 		mem_type_code = ZBX_VMEXE;		/* size of text (code) segment */
-		mem_type_search = "VmExe:\t";
+		vm = ZBX_PROC_VMEXE;
 	}
 	else if (0 == strcmp(mem_type, "pte"))
 	{
 		mem_type_code = ZBX_VMPTE;		/* size of page table entries */
-		mem_type_search = "VmPTE:\t";
+		vm = ZBX_PROC_VMPTE;
 	}
 	else
 	{
@@ -517,41 +1016,28 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 		}
 	}
 
-	if (NULL == (dir = opendir("/proc")))
+	/* process names longer than 15 characters are taken from command lines */
+	cmdline = ((NULL != procname && '\0' != *procname) || (NULL != proccomm && '\0' != *proccomm)) ? 1 : 0;
+
+	if (SUCCEED != proc_get_snapshot(cmdline, &processes, &error))
 	{
-		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot open /proc: %s", zbx_strerror(errno)));
+		SET_MSG_RESULT(result, error);
 		return SYSINFO_RET_FAIL;
 	}
 
-	while (NULL != (entries = readdir(dir)))
+	for (i = 0; i < processes->values_num; i++)
 	{
-		zbx_fclose(f_cmd);
-		zbx_fclose(f_stat);
-
-		if (0 == atoi(entries->d_name))
-			continue;
-
-		zbx_snprintf(tmp, sizeof(tmp), "/proc/%s/cmdline", entries->d_name);
-
-		if (NULL == (f_cmd = fopen(tmp, "r")))
-			continue;
-
-		zbx_snprintf(tmp, sizeof(tmp), "/proc/%s/status", entries->d_name);
-
-		if (NULL == (f_stat = fopen(tmp, "r")))
-			continue;
+		proc = (zbx_proc_status_t *)processes->values[i];
 
-		if (FAIL == check_procname(f_cmd, f_stat, procname))
+		if (FAIL == check_procname(proc, procname))
 			continue;
 
-		if (FAIL == check_user(f_stat, usrinfo))
+		if (FAIL == check_user(proc, usrinfo))
 			continue;
 
-		if (FAIL == check_proccomm(f_cmd, proccomm))
+		if (FAIL == check_proccomm(proc, proccomm))
 			continue;
 
-		rewind(f_stat);
-
 		if (0 == mem_type_tried)
 			mem_type_tried = 1;
 
@@ -569,7 +1055,8 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 			case ZBX_VMSTK:
 			case ZBX_VMEXE:
 			case ZBX_VMPTE:
-				res = byte_value_from_proc_file(f_stat, mem_type_search, NULL, &byte_value);
+				res = proc->vm_status[vm];
+				byte_value = proc->vm[vm];
 
 				if (NOTSUPPORTED == res)
 					continue;
@@ -582,30 +1069,17 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 				break;
 			case ZBX_SIZE:
 				{
-					zbx_uint64_t	m;
-
-					/* VmData, VmStk and VmExe follow in /proc/PID/status file in that order. */
-					/* Therefore we do not rewind f_stat between calls. */
-
-					mem_type_search = "VmData:\t";
+					int	vms[] = {ZBX_PROC_VMDATA, ZBX_PROC_VMSTK, ZBX_PROC_VMEXE};
+					size_t	j;
 
-					if (SUCCEED == (res = byte_value_from_proc_file(f_stat, mem_type_search, NULL,
-							&byte_value)))
+					for (byte_value = 0, j = 0; j < ARRSIZE(vms); j++)
 					{
-						mem_type_search = "VmStk:\t";
+						vm = vms[j];
 
-						if (SUCCEED == (res = byte_value_from_proc_file(f_stat, mem_type_search,
-								NULL, &m)))
-						{
-							byte_value += m;
-							mem_type_search = "VmExe:\t";
-
-							if (SUCCEED == (res = byte_value_from_proc_file(f_stat,
-									mem_type_search, NULL, &m)))
-							{
-								byte_value += m;
-							}
-						}
+						if (SUCCEED != (res = proc->vm_status[vm]))
+							break;
+
+						byte_value += proc->vm[vm];
 					}
 
 					if (SUCCEED != res)
@@ -625,12 +1099,12 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 				}
 				break;
 			case ZBX_PMEM:
-				mem_type_search = "VmRSS:\t";
-				res = byte_value_from_proc_file(f_stat, mem_type_search, NULL, &byte_value);
+				vm = ZBX_PROC_VMRSS;
+				res = proc->vm_status[vm];
 
 				if (SUCCEED == res)
 				{
-					pct_value = ((double)byte_value / (double)total_memory) * 100.0;
+					pct_value = ((double)proc->vm[vm] / (double)total_memory) * 100.0;
 				}
 				else if (NOTSUPPORTED == res)
 				{
@@ -674,15 +1148,11 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 		}
 	}
 clean:
-	zbx_fclose(f_cmd);
-	zbx_fclose(f_stat);
-	closedir(dir);
-
 	if ((0 == proccount && 0 != mem_type_tried) || 0 != invalid_read)
 	{
 		char	*s;
 
-		s = zbx_strdup(NULL, mem_type_search);
+		s = zbx_strdup(NULL, proc_vm_labels[vm]);
 		zbx_rtrim(s, ":\t");
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot get amount of \"%s\" memory.", s));
 		zbx_free(s);
@@ -724,12 +1194,11 @@ out:
 
 int	PROC_NUM(AGENT_REQUEST *request, AGENT_RESULT *result)
 {
-	char		tmp[MAX_STRING_LEN], *procname, *proccomm, *param;
-	DIR		*dir;
-	struct dirent	*entries;
-	struct passwd	*usrinfo;
-	FILE		*f_cmd = NULL, *f_stat = NULL;
-	int		proccount = 0, invalid_user = 0, zbx_proc_stat;
+	char			*procname, *proccomm, *param, *error = NULL;
+	zbx_vector_ptr_t	*processes;
+	zbx_proc_status_t	*proc;
+	struct passwd		*usrinfo;
+	int			proccount = 0, invalid_user = 0, zbx_proc_stat, i, cmdline;
 
 	if (4 < request->nparam)
 	{
@@ -784,47 +1253,33 @@ int	PROC_NUM(AGENT_REQUEST *request, AGENT_RESULT *result)
 	if (1 == invalid_user)	/* handle 0 for non-existent user after all parameters have been parsed and validated */
 		goto out;
 
-	if (NULL == (dir = opendir("/proc")))
+	/* process names longer than 15 characters are taken from command lines */
+	cmdline = ((NULL != procname && '\0' != *procname) || (NULL != proccomm && '\0' != *proccomm)) ? 1 : 0;
+
+	if (SUCCEED != proc_get_snapshot(cmdline, &processes, &error))
 	{
-		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot open /proc: %s", zbx_strerror(errno)));
+		SET_MSG_RESULT(result, error);
 		return SYSINFO_RET_FAIL;
 	}
 
-	while (NULL != (entries = readdir(dir)))
+	for (i = 0; i < processes->values_num; i++)
 	{
-		zbx_fclose(f_cmd);
-		zbx_fclose(f_stat);
+		proc = (zbx_proc_status_t *)processes->values[i];
 
-		if (0 == atoi(entries->d_name))
+		if (FAIL == check_procname(proc, procname))
 			continue;
 
-		zbx_snprintf(tmp, sizeof(tmp), "/proc/%s/cmdline", entries->d_name);
-
-		if (NULL == (f_cmd = fopen(tmp, "r")))
-			continue;
-
-		zbx_snprintf(tmp, sizeof(tmp), "/proc/%s/status", entries->d_name);
-
-		if (NULL == (f_stat = fopen(tmp, "r")))
+		if (FAIL == check_user(proc, usrinfo))
 			continue;
 
-		if (FAIL == check_procname(f_cmd, f_stat, procname))
+		if (FAIL == check_proccomm(proc, proccomm))
 			continue;
 
-		if (FAIL == check_user(f_stat, usrinfo))
-			continue;
-
-		if (FAIL == check_proccomm(f_cmd, proccomm))
-			continue;
-
-		if (FAIL == check_procstate(f_stat, zbx_proc_stat))
+		if (FAIL == check_procstate(proc, zbx_proc_stat))
 			continue;
 
 		proccount++;
 	}
-	zbx_fclose(f_cmd);
-	zbx_fclose(f_stat);
-	closedir(dir);
 out:
 	SET_UI64_RESULT(result, proccount);
 
@@ -42,12 +42,34 @@ extern ZBX_THREAD_LOCAL int		server_num, process_num;
 #endif
 
 #include "zbxcrypto.h"
+#include "persistbuf.h"
 
 static ZBX_THREAD_LOCAL ZBX_ACTIVE_BUFFER	buffer;
 static ZBX_THREAD_LOCAL zbx_vector_ptr_t	active_metrics;
 static ZBX_THREAD_LOCAL zbx_vector_ptr_t	regexps;
 static ZBX_THREAD_LOCAL char			*session_token;
 static ZBX_THREAD_LOCAL zbx_uint64_t		last_valueid = 0;
+#ifndef _WINDOWS
+static ZBX_THREAD_LOCAL ZBX_PERSISTENT_BUFFER	*pbuffer = NULL;
+static ZBX_THREAD_LOCAL time_t			pbuffer_nextsend = 0;
+/* the last value id restored from the previous agent run, 0 when all restored values are sent */
+static ZBX_THREAD_LOCAL zbx_uint64_t		pbuffer_restored_id = 0;
+/* restored log values are checked against log positions received from server */
+static ZBX_THREAD_LOCAL int			pbuffer_checks_received = 0;
+/* values of this run were moved to persistent buffer behind the restored values */
+static ZBX_THREAD_LOCAL int			pbuffer_spilled = 0;
+
+/* the log position received from server for a log item with restored values */
+typedef struct
+{
+	char		*key;
+	zbx_uint64_t	lastlogsize;
+	int		mtime;
+}
+zbx_pbuf_log_position_t;
+
+static ZBX_THREAD_LOCAL zbx_vector_ptr_t	pbuffer_log_positions;
+#endif
 
 static void	init_active_metrics(void)
 {
@@ -169,6 +191,7 @@ static void	add_check(const char *key, const char *key_orig, int refresh, zbx_ui
 			metric->logfiles_num = 0;
 			metric->start_time = 0.0;
 			metric->processed_bytes = 0;
+			metric->notify_revision = 0;
 		}
 
 		/* replace metric */
@@ -226,6 +249,8 @@ static void	add_check(const char *key, const char *key_orig, int refresh, zbx_ui
 
 	metric->start_time = 0.0;
 	metric->processed_bytes = 0;
+	metric->notify_revision = 0;
+	metric->notify_lastcheck = 0;
 
 	zbx_vector_ptr_append(&active_metrics, metric);
 out:
@@ -730,96 +755,86 @@ static int	check_response(char *response)
 	return ret;
 }
 
-/******************************************************************************
- *                                                                            *
- * Function: send_buffer                                                      *
- *                                                                            *
- * Purpose: Send value stored in the buffer to Zabbix server                  *
- *                                                                            *
- * Parameters: host - IP or Hostname of Zabbix server                         *
- *             port - port number                                             *
- *                                                                            *
- * Return value: returns SUCCEED on successful sending,                       *
- *               FAIL on other cases                                          *
- *                                                                            *
- * Author: Alexei Vladishev                                                   *
- *                                                                            *
- ******************************************************************************/
-static int	send_buffer(const char *host, unsigned short port)
+static void	free_buffer_element(ZBX_ACTIVE_BUFFER_ELEMENT *el)
 {
-	ZBX_ACTIVE_BUFFER_ELEMENT	*el;
-	int				ret = SUCCEED, i, now;
-	char				*tls_arg1, *tls_arg2;
-	zbx_timespec_t			ts;
-	const char			*err_send_step = "";
-	zbx_socket_t			s;
-	struct zbx_json 		json;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'%s' port:%d entries:%d/%d",
-			__func__, host, port, buffer.count, CONFIG_BUFFER_SIZE);
+	zbx_free(el->host);
+	zbx_free(el->key);
+	zbx_free(el->value);
+	zbx_free(el->source);
+}
 
-	if (0 == buffer.count)
-		goto ret;
+static void	add_buffer_element(struct zbx_json *json, const ZBX_ACTIVE_BUFFER_ELEMENT *el)
+{
+	zbx_json_addobject(json, NULL);
+	zbx_json_addstring(json, ZBX_PROTO_TAG_HOST, el->host, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(json, ZBX_PROTO_TAG_KEY, el->key, ZBX_JSON_TYPE_STRING);
 
-	now = (int)time(NULL);
+	if (NULL != el->value)
+		zbx_json_addstring(json, ZBX_PROTO_TAG_VALUE, el->value, ZBX_JSON_TYPE_STRING);
 
-	if (CONFIG_BUFFER_SIZE / 2 > buffer.pcount && CONFIG_BUFFER_SIZE > buffer.count &&
-			CONFIG_BUFFER_SEND > now - buffer.lastsent)
+	if (ITEM_STATE_NOTSUPPORTED == el->state)
 	{
-		zabbix_log(LOG_LEVEL_DEBUG, "%s() now:%d lastsent:%d now-lastsent:%d BufferSend:%d; will not send now",
-				__func__, now, buffer.lastsent, now - buffer.lastsent, CONFIG_BUFFER_SEND);
-		goto ret;
+		zbx_json_adduint64(json, ZBX_PROTO_TAG_STATE, ITEM_STATE_NOTSUPPORTED);
 	}
-
-	zbx_json_init(&json, ZBX_JSON_STAT_BUF_LEN);
-	zbx_json_addstring(&json, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_AGENT_DATA, ZBX_JSON_TYPE_STRING);
-	zbx_json_addstring(&json, ZBX_PROTO_TAG_SESSION, session_token, ZBX_JSON_TYPE_STRING);
-	zbx_json_addarray(&json, ZBX_PROTO_TAG_DATA);
-
-	for (i = 0; i < buffer.count; i++)
+	else
 	{
-		el = &buffer.data[i];
-
-		zbx_json_addobject(&json, NULL);
-		zbx_json_addstring(&json, ZBX_PROTO_TAG_HOST, el->host, ZBX_JSON_TYPE_STRING);
-		zbx_json_addstring(&json, ZBX_PROTO_TAG_KEY, el->key, ZBX_JSON_TYPE_STRING);
-
-		if (NULL != el->value)
-			zbx_json_addstring(&json, ZBX_PROTO_TAG_VALUE, el->value, ZBX_JSON_TYPE_STRING);
+		/* add item meta information only for items in normal state */
+		if (0 != (ZBX_METRIC_FLAG_LOG & el->flags))
+			zbx_json_adduint64(json, ZBX_PROTO_TAG_LASTLOGSIZE, el->lastlogsize);
+		if (0 != (ZBX_METRIC_FLAG_LOG_LOGRT & el->flags))
+			zbx_json_adduint64(json, ZBX_PROTO_TAG_MTIME, el->mtime);
+	}
 
-		if (ITEM_STATE_NOTSUPPORTED == el->state)
-		{
-			zbx_json_adduint64(&json, ZBX_PROTO_TAG_STATE, ITEM_STATE_NOTSUPPORTED);
-		}
-		else
-		{
-			/* add item meta information only for items in normal state */
-			if (0 != (ZBX_METRIC_FLAG_LOG & el->flags))
-				zbx_json_adduint64(&json, ZBX_PROTO_TAG_LASTLOGSIZE, el->lastlogsize);
-			if (0 != (ZBX_METRIC_FLAG_LOG_LOGRT & el->flags))
-				zbx_json_adduint64(&json, ZBX_PROTO_TAG_MTIME, el->mtime);
-		}
+	if (0 != el->timestamp)
+		zbx_json_adduint64(json, ZBX_PROTO_TAG_LOGTIMESTAMP, el->timestamp);
 
-		if (0 != el->timestamp)
-			zbx_json_adduint64(&json, ZBX_PROTO_TAG_LOGTIMESTAMP, el->timestamp);
+	if (NULL != el->source)
+		zbx_json_addstring(json, ZBX_PROTO_TAG_LOGSOURCE, el->source, ZBX_JSON_TYPE_STRING);
 
-		if (NULL != el->source)
-			zbx_json_addstring(&json, ZBX_PROTO_TAG_LOGSOURCE, el->source, ZBX_JSON_TYPE_STRING);
+	if (0 != el->severity)
+		zbx_json_adduint64(json, ZBX_PROTO_TAG_LOGSEVERITY, el->severity);
 
-		if (0 != el->severity)
-			zbx_json_adduint64(&json, ZBX_PROTO_TAG_LOGSEVERITY, el->severity);
+	if (0 != el->logeventid)
+		zbx_json_adduint64(json, ZBX_PROTO_TAG_LOGEVENTID, el->logeventid);
 
-		if (0 != el->logeventid)
-			zbx_json_adduint64(&json, ZBX_PROTO_TAG_LOGEVENTID, el->logeventid);
+	zbx_json_adduint64(json, ZBX_PROTO_TAG_ID, el->id);
 
-		zbx_json_adduint64(&json, ZBX_PROTO_TAG_ID, el->id);
+	zbx_json_adduint64(json, ZBX_PROTO_TAG_CLOCK, el->ts.sec);
+	zbx_json_adduint64(json, ZBX_PROTO_TAG_NS, el->ts.ns);
+	zbx_json_close(json);
+}
 
-		zbx_json_adduint64(&json, ZBX_PROTO_TAG_CLOCK, el->ts.sec);
-		zbx_json_adduint64(&json, ZBX_PROTO_TAG_NS, el->ts.ns);
-		zbx_json_close(&json);
-	}
+static void	init_agent_data_json(struct zbx_json *json)
+{
+	zbx_json_init(json, ZBX_JSON_STAT_BUF_LEN);
+	zbx_json_addstring(json, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_AGENT_DATA, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(json, ZBX_PROTO_TAG_SESSION, session_token, ZBX_JSON_TYPE_STRING);
+	zbx_json_addarray(json, ZBX_PROTO_TAG_DATA);
+}
 
-	zbx_json_close(&json);
+/******************************************************************************
+ *                                                                            *
+ * Function: send_agent_data                                                  *
+ *                                                                            *
+ * Purpose: send agent data request to Zabbix server and check the response   *
+ *                                                                            *
+ * Parameters: host          - [IN] IP or Hostname of Zabbix server           *
+ *             port          - [IN] port number                               *
+ *             json          - [IN] the request with closed data array        *
+ *             values_num    - [IN] the number of values in the request       *
+ *             err_send_step - [OUT] the failed step                          *
+ *                                                                            *
+ * Return value: returns SUCCEED on successful sending,                       *
+ *               FAIL on other cases                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	send_agent_data(const char *host, unsigned short port, struct zbx_json *json, int values_num,
+		const char **err_send_step)
+{
+	int		ret;
+	char		*tls_arg1, *tls_arg2;
+	zbx_timespec_t	ts;
+	zbx_socket_t	s;
 
 	switch (configured_tls_connect_mode)
 	{
@@ -839,20 +854,19 @@ static int	send_buffer(const char *host, unsigned short port)
 #endif
 		default:
 			THIS_SHOULD_NEVER_HAPPEN;
-			ret = FAIL;
-			goto out;
+			return FAIL;
 	}
 
-	if (SUCCEED == (ret = zbx_tcp_connect(&s, CONFIG_SOURCE_IP, host, port, MIN(buffer.count * CONFIG_TIMEOUT, 60),
+	if (SUCCEED == (ret = zbx_tcp_connect(&s, CONFIG_SOURCE_IP, host, port, MIN(values_num * CONFIG_TIMEOUT, 60),
 			configured_tls_connect_mode, tls_arg1, tls_arg2)))
 	{
 		zbx_timespec(&ts);
-		zbx_json_adduint64(&json, ZBX_PROTO_TAG_CLOCK, ts.sec);
-		zbx_json_adduint64(&json, ZBX_PROTO_TAG_NS, ts.ns);
+		zbx_json_adduint64(json, ZBX_PROTO_TAG_CLOCK, ts.sec);
+		zbx_json_adduint64(json, ZBX_PROTO_TAG_NS, ts.ns);
 
-		zabbix_log(LOG_LEVEL_DEBUG, "JSON before sending [%s]", json.buffer);
+		zabbix_log(LOG_LEVEL_DEBUG, "JSON before sending [%s]", json->buffer);
 
-		if (SUCCEED == (ret = zbx_tcp_send(&s, json.buffer)))
+		if (SUCCEED == (ret = zbx_tcp_send(&s, json->buffer)))
 		{
 			if (SUCCEED == (ret = zbx_tcp_recv(&s)))
 			{
@@ -867,32 +881,30 @@ static int	send_buffer(const char *host, unsigned short port)
 					zabbix_log(LOG_LEVEL_DEBUG, "OK");
 			}
 			else
-				err_send_step = "[recv] ";
+				*err_send_step = "[recv] ";
 		}
 		else
-			err_send_step = "[send] ";
+			*err_send_step = "[send] ";
 
 		zbx_tcp_close(&s);
 	}
 	else
-		err_send_step = "[connect] ";
-out:
-	zbx_json_free(&json);
+		*err_send_step = "[connect] ";
 
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: update_send_status                                               *
+ *                                                                            *
+ * Purpose: log data upload failures and recoveries                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	update_send_status(const char *host, unsigned short port, int ret, const char *err_send_step, int now)
+{
 	if (SUCCEED == ret)
 	{
-		/* free buffer */
-		for (i = 0; i < buffer.count; i++)
-		{
-			el = &buffer.data[i];
-
-			zbx_free(el->host);
-			zbx_free(el->key);
-			zbx_free(el->value);
-			zbx_free(el->source);
-		}
-		buffer.count = 0;
-		buffer.pcount = 0;
 		buffer.lastsent = now;
 		if (0 != buffer.first_error)
 		{
@@ -911,6 +923,356 @@ out:
 		}
 		zabbix_log(LOG_LEVEL_DEBUG, "send value error: %s%s", err_send_step, zbx_socket_strerror());
 	}
+}
+
+#ifndef _WINDOWS
+/******************************************************************************
+ *                                                                            *
+ * Function: spill_buffer                                                     *
+ *                                                                            *
+ * Purpose: move values from memory buffer to persistent buffer               *
+ *                                                                            *
+ * Comments: Values not fitting in persistent buffer are kept in memory.      *
+ *                                                                            *
+ ******************************************************************************/
+static void	spill_buffer(void)
+{
+	int	i;
+
+	for (i = 0; i < buffer.count; i++)
+	{
+		if (SUCCEED != persistent_buffer_write(pbuffer, &buffer.data[i]))
+			break;
+
+		free_buffer_element(&buffer.data[i]);
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() moved %d of %d values to persistent buffer", __func__, i, buffer.count);
+
+	if (i != buffer.count)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "persistent buffer is full, keeping %d values in memory",
+				buffer.count - i);
+	}
+
+	if (0 == i)
+		return;
+
+	pbuffer_spilled = 1;
+
+	memmove(&buffer.data[0], &buffer.data[i], (buffer.count - i) * sizeof(ZBX_ACTIVE_BUFFER_ELEMENT));
+	buffer.count -= i;
+
+	for (buffer.pcount = 0, i = 0; i < buffer.count; i++)
+	{
+		if (0 != (ZBX_METRIC_FLAG_PERSISTENT & buffer.data[i].flags))
+			buffer.pcount++;
+	}
+}
+
+static void	pbuf_log_position_free(zbx_pbuf_log_position_t *position)
+{
+	zbx_free(position->key);
+	zbx_free(position);
+}
+
+static zbx_pbuf_log_position_t	*pbuf_log_position_get(const char *key)
+{
+	int	i;
+
+	for (i = 0; i < pbuffer_log_positions.values_num; i++)
+	{
+		zbx_pbuf_log_position_t	*position = (zbx_pbuf_log_position_t *)pbuffer_log_positions.values[i];
+
+		if (0 == strcmp(position->key, key))
+			return position;
+	}
+
+	return NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: restore_log_position                                             *
+ *                                                                            *
+ * Purpose: move log position of active check past the log value restored     *
+ *          from persistent buffer                                            *
+ *                                                                            *
+ * Parameters: el   - [IN] the restored value                                 *
+ *             data - [IN] the last restored value id                         *
+ *                                                                            *
+ * Return value: SUCCEED - continue with the next value                       *
+ *               FAIL    - all restored values have been checked              *
+ *                                                                            *
+ * Comments: Callback of persistent_buffer_scan(). The log position received  *
+ *           from server is remembered before it is moved, so that restored   *
+ *           values already received by server can be dropped when sending.   *
+ *           Log files are then read past the restored records while the      *
+ *           restored values are being sent.                                  *
+ *                                                                            *
+ ******************************************************************************/
+static int	restore_log_position(const ZBX_ACTIVE_BUFFER_ELEMENT *el, void *data)
+{
+	ZBX_ACTIVE_METRIC	*metric = NULL;
+	zbx_pbuf_log_position_t	*position;
+	int			i;
+
+	if (el->id > *(zbx_uint64_t *)data)
+		return FAIL;
+
+	if (0 == (ZBX_METRIC_FLAG_LOG & el->flags))
+		return SUCCEED;
+
+	for (i = 0; i < active_metrics.values_num; i++)
+	{
+		metric = (ZBX_ACTIVE_METRIC *)active_metrics.values[i];
+
+		if (0 == strcmp(metric->key_orig, el->key))
+			break;
+	}
+
+	if (i == active_metrics.values_num)
+		return SUCCEED;
+
+	if (NULL == (position = pbuf_log_position_get(el->key)))
+	{
+		position = (zbx_pbuf_log_position_t *)zbx_malloc(NULL, sizeof(zbx_pbuf_log_position_t));
+		position->key = zbx_strdup(NULL, el->key);
+		position->lastlogsize = metric->lastlogsize;
+		position->mtime = metric->mtime;
+		zbx_vector_ptr_append(&pbuffer_log_positions, position);
+	}
+
+	if (el->mtime > metric->mtime || (el->mtime == metric->mtime && el->lastlogsize > metric->lastlogsize))
+	{
+		metric->lastlogsize = el->lastlogsize;
+		metric->mtime = el->mtime;
+		metric->skip_old_data = 0;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: restore_log_positions                                            *
+ *                                                                            *
+ * Purpose: move log positions of active checks past the log values restored  *
+ *          from persistent buffer                                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	restore_log_positions(void)
+{
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() restored_id:" ZBX_FS_UI64, __func__, pbuffer_restored_id);
+
+	persistent_buffer_scan(pbuffer, restore_log_position, &pbuffer_restored_id);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() log items:%d", __func__, pbuffer_log_positions.values_num);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: restored_value_received                                          *
+ *                                                                            *
+ * Purpose: check if log value restored from persistent buffer was already    *
+ *          received by server                                                *
+ *                                                                            *
+ * Return value: SUCCEED - the value is at or below the log position received *
+ *                         from server and must be dropped                    *
+ *               FAIL    - the value must be sent                             *
+ *                                                                            *
+ ******************************************************************************/
+static int	restored_value_received(const ZBX_ACTIVE_BUFFER_ELEMENT *el)
+{
+	const zbx_pbuf_log_position_t	*position;
+
+	if (0 == (ZBX_METRIC_FLAG_LOG & el->flags) || NULL == (position = pbuf_log_position_get(el->key)))
+		return FAIL;
+
+	if (el->mtime < position->mtime || (el->mtime == position->mtime && el->lastlogsize <= position->lastlogsize))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() dropping value of \"%s\" with lastlogsize:" ZBX_FS_UI64 " mtime:%d",
+				__func__, el->key, el->lastlogsize, el->mtime);
+		return SUCCEED;
+	}
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: send_persistent_buffer                                           *
+ *                                                                            *
+ * Purpose: send values stored in persistent buffer to Zabbix server          *
+ *                                                                            *
+ * Parameters: host - IP or Hostname of Zabbix server                         *
+ *             port - port number                                             *
+ *                                                                            *
+ * Return value: returns SUCCEED on successful sending,                       *
+ *               FAIL on other cases                                          *
+ *                                                                            *
+ * Comments: Values are sent in batches of ZBX_PERSISTENT_BUFFER_BATCH_SIZE   *
+ *           for at most ZBX_PERSISTENT_BUFFER_SEND_TIME seconds, so that the *
+ *           backlog is drained without stopping active checks for long.      *
+ *           While only values restored from the previous run are on disk,    *
+ *           new values are kept in memory and sent alongside the backlog.    *
+ *                                                                            *
+ ******************************************************************************/
+static int	send_persistent_buffer(const char *host, unsigned short port)
+{
+	ZBX_ACTIVE_BUFFER_ELEMENT	el;
+	struct zbx_json			json;
+	const char			*err_send_step = "";
+	int				ret = SUCCEED, values_num;
+	double				deadline;
+	zbx_uint64_t			read_id;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'%s' port:%d", __func__, host, port);
+
+	/* values already on disk are older and must be sent first to keep the value order */
+	if (0 != buffer.count && (0 == pbuffer_restored_id || 0 != pbuffer_spilled))
+		spill_buffer();
+
+	/* values restored from the previous run are sent after log positions are received from server */
+	if (pbuffer_nextsend > time(NULL) || (0 != pbuffer_restored_id && 0 == pbuffer_checks_received))
+	{
+		ret = FAIL;
+		goto out;
+	}
+
+	deadline = zbx_time() + ZBX_PERSISTENT_BUFFER_SEND_TIME;
+
+	while (SUCCEED != persistent_buffer_empty(pbuffer))
+	{
+		init_agent_data_json(&json);
+		read_id = 0;
+
+		for (values_num = 0; ZBX_PERSISTENT_BUFFER_BATCH_SIZE > values_num &&
+				SUCCEED == persistent_buffer_read(pbuffer, &el);)
+		{
+			read_id = el.id;
+
+			if (el.id > pbuffer_restored_id || SUCCEED != restored_value_received(&el))
+			{
+				add_buffer_element(&json, &el);
+				values_num++;
+			}
+
+			free_buffer_element(&el);
+		}
+
+		zbx_json_close(&json);
+
+		if (0 != values_num)
+			ret = send_agent_data(host, port, &json, values_num, &err_send_step);
+
+		zbx_json_free(&json);
+
+		if (SUCCEED != ret)
+		{
+			persistent_buffer_rollback(pbuffer);
+			pbuffer_nextsend = time(NULL) + CONFIG_BUFFER_SEND;
+			break;
+		}
+
+		persistent_buffer_commit(pbuffer);
+
+		if (0 != pbuffer_restored_id && (read_id >= pbuffer_restored_id ||
+				SUCCEED == persistent_buffer_empty(pbuffer)))
+		{
+			pbuffer_restored_id = 0;
+			zbx_vector_ptr_clear_ext(&pbuffer_log_positions, (zbx_clean_func_t)pbuf_log_position_free);
+		}
+
+		if (zbx_time() > deadline)
+			break;
+	}
+
+	update_send_status(host, port, ret, err_send_step, (int)time(NULL));
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Function: send_buffer                                                      *
+ *                                                                            *
+ * Purpose: Send value stored in the buffer to Zabbix server                  *
+ *                                                                            *
+ * Parameters: host - IP or Hostname of Zabbix server                         *
+ *             port - port number                                             *
+ *                                                                            *
+ * Return value: returns SUCCEED on successful sending,                       *
+ *               FAIL on other cases                                          *
+ *                                                                            *
+ * Author: Alexei Vladishev                                                   *
+ *                                                                            *
+ * Comments: When persistent buffer is enabled the values, which could not be *
+ *           sent, are moved to disk and sent before any newer values. Values *
+ *           restored from the previous agent run do not hold back new ones.  *
+ *                                                                            *
+ ******************************************************************************/
+static int	send_buffer(const char *host, unsigned short port)
+{
+	int		ret = SUCCEED, i, now;
+	const char	*err_send_step = "";
+	struct zbx_json	json;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'%s' port:%d entries:%d/%d",
+			__func__, host, port, buffer.count, CONFIG_BUFFER_SIZE);
+#ifndef _WINDOWS
+	if (NULL != pbuffer && SUCCEED != persistent_buffer_empty(pbuffer))
+	{
+		ret = send_persistent_buffer(host, port);
+
+		if (SUCCEED != persistent_buffer_empty(pbuffer) && (0 == pbuffer_restored_id || 0 != pbuffer_spilled))
+			goto ret;
+	}
+#endif
+	if (0 == buffer.count)
+		goto ret;
+
+	now = (int)time(NULL);
+
+	if (CONFIG_BUFFER_SIZE / 2 > buffer.pcount && CONFIG_BUFFER_SIZE > buffer.count &&
+			CONFIG_BUFFER_SEND > now - buffer.lastsent)
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() now:%d lastsent:%d now-lastsent:%d BufferSend:%d; will not send now",
+				__func__, now, buffer.lastsent, now - buffer.lastsent, CONFIG_BUFFER_SEND);
+		goto ret;
+	}
+
+	init_agent_data_json(&json);
+
+	for (i = 0; i < buffer.count; i++)
+		add_buffer_element(&json, &buffer.data[i]);
+
+	zbx_json_close(&json);
+
+	ret = send_agent_data(host, port, &json, buffer.count, &err_send_step);
+
+	zbx_json_free(&json);
+
+	if (SUCCEED == ret)
+	{
+		/* free buffer */
+		for (i = 0; i < buffer.count; i++)
+			free_buffer_element(&buffer.data[i]);
+
+		buffer.count = 0;
+		buffer.pcount = 0;
+	}
+#ifndef _WINDOWS
+	else if (NULL != pbuffer)
+	{
+		spill_buffer();
+		pbuffer_nextsend = now + CONFIG_BUFFER_SEND;
+	}
+#endif
+	update_send_status(host, port, ret, err_send_step, now);
 ret:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
@@ -1029,10 +1391,7 @@ static int	process_value(const char *server, unsigned short port, const char *ho
 		{
 			zabbix_log(LOG_LEVEL_DEBUG, "remove element [%d] Key:'%s:%s'", i, el->host, el->key);
 
-			zbx_free(el->host);
-			zbx_free(el->key);
-			zbx_free(el->value);
-			zbx_free(el->source);
+			free_buffer_element(el);
 		}
 
 		sz = (CONFIG_BUFFER_SIZE - i - 1) * sizeof(ZBX_ACTIVE_BUFFER_ELEMENT);
@@ -1307,7 +1666,32 @@ ZBX_THREAD_ENTRY(active_checks_thread, args)
 	zbx_tls_init_child();
 #endif
 	init_active_metrics();
+#ifndef _WINDOWS
+	if (NULL != CONFIG_PERSISTENT_BUFFER_DIR)
+	{
+		char	*error = NULL;
 
+		pbuffer = (ZBX_PERSISTENT_BUFFER *)zbx_malloc(NULL, sizeof(ZBX_PERSISTENT_BUFFER));
+
+		if (SUCCEED != persistent_buffer_open(pbuffer, CONFIG_PERSISTENT_BUFFER_DIR, activechk_args.host,
+				activechk_args.port, CONFIG_PERSISTENT_BUFFER_SIZE, &error))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot open persistent buffer, values will be buffered in"
+					" memory only: %s", error);
+			zbx_free(error);
+			zbx_free(pbuffer);
+		}
+		else
+		{
+			last_valueid = pbuffer->last_id;
+
+			if (SUCCEED != persistent_buffer_empty(pbuffer))
+				pbuffer_restored_id = pbuffer->last_id;
+
+			zbx_vector_ptr_create(&pbuffer_log_positions);
+		}
+	}
+#endif
 	while (ZBX_IS_RUNNING())
 	{
 		zbx_update_env(zbx_time());
@@ -1315,6 +1699,10 @@ ZBX_THREAD_ENTRY(active_checks_thread, args)
 		if ((now = time(NULL)) >= nextsend)
 		{
 			send_buffer(activechk_args.host, activechk_args.port);
+#ifndef _WINDOWS
+			if (NULL != pbuffer)
+				persistent_buffer_sync(pbuffer, 0);
+#endif
 			nextsend = time(NULL) + 1;
 		}
 
@@ -1329,6 +1717,12 @@ ZBX_THREAD_ENTRY(active_checks_thread, args)
 			else
 			{
 				nextrefresh = time(NULL) + CONFIG_REFRESH_ACTIVE_CHECKS;
+#ifndef _WINDOWS
+				if (0 != pbuffer_restored_id && 0 == pbuffer_checks_received)
+					restore_log_positions();
+
+				pbuffer_checks_received = 1;
+#endif
 			}
 		}
 
@@ -1374,6 +1768,23 @@ ZBX_THREAD_ENTRY(active_checks_thread, args)
 
 	zbx_thread_exit(EXIT_SUCCESS);
 #else
+	if (NULL != CONFIG_PERSISTENT_BUFFER_DIR)
+	{
+		/* keep the values, which were not sent yet, for the next agent run */
+		if (NULL != pbuffer)
+		{
+			spill_buffer();
+			persistent_buffer_close(pbuffer);
+			zbx_free(pbuffer);
+
+			zbx_vector_ptr_clear_ext(&pbuffer_log_positions, (zbx_clean_func_t)pbuf_log_position_free);
+			zbx_vector_ptr_destroy(&pbuffer_log_positions);
+		}
+
+		/* main process waits for active checks to exit when persistent buffer is enabled */
+		exit(EXIT_SUCCESS);
+	}
+
 	zbx_setproctitle("%s #%d [terminated]", get_process_type_string(process_type), process_num);
 
 	while (1)
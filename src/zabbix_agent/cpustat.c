@@ -34,13 +34,41 @@ extern int get_numa_node_num_win32(void);
 #	include <sys/sched.h>
 #endif
 
-#if !defined(_WINDOWS)
-#	define LOCK_CPUSTATS	zbx_mutex_lock(cpustats_lock)
-#	define UNLOCK_CPUSTATS	zbx_mutex_unlock(cpustats_lock)
+#if defined(ZBX_SEQLOCK)
+/* per-CPU history is protected by sequence locks, readers never block the collector */
+#	define LOCK_CPUSTATS(cpu)	zbx_seqlock_write_begin(&(cpu)->seqlock)
+#	define UNLOCK_CPUSTATS(cpu)	zbx_seqlock_write_end(&(cpu)->seqlock)
+
+/* repeat reading while the collector updates the history */
+#	define READ_CPUSTATS(cpu, read)							\
+											\
+do											\
+{											\
+	unsigned int	seq;								\
+											\
+	do										\
+	{										\
+		seq = zbx_seqlock_read_begin(&(cpu)->seqlock);				\
+		read;									\
+	}										\
+	while (SUCCEED == zbx_seqlock_read_retry(&(cpu)->seqlock, seq));	\
+}											\
+while (0)
+#elif !defined(_WINDOWS)
+#	define LOCK_CPUSTATS(cpu)	zbx_mutex_lock(cpustats_lock)
+#	define UNLOCK_CPUSTATS(cpu)	zbx_mutex_unlock(cpustats_lock)
+
+#	define READ_CPUSTATS(cpu, read)							\
+											\
+do											\
+{											\
+	LOCK_CPUSTATS(cpu);								\
+	read;										\
+	UNLOCK_CPUSTATS(cpu);								\
+}											\
+while (0)
+
 static zbx_mutex_t	cpustats_lock = ZBX_MUTEX_NULL;
-#else
-#	define LOCK_CPUSTATS
-#	define UNLOCK_CPUSTATS
 #endif
 
 #ifdef HAVE_KSTAT_H
@@ -123,7 +151,9 @@ static int	refresh_kstat(ZBX_CPUS_STAT_DATA *pcpus)
 
 int	init_cpu_collector(ZBX_CPUS_STAT_DATA *pcpus)
 {
+#if defined(_WINDOWS) || !defined(ZBX_SEQLOCK)
 	char				*error = NULL;
+#endif
 	int				idx, ret = FAIL;
 #ifdef _WINDOWS
 	wchar_t				cpu[16]; /* 16 is enough to store instance name string (group and index) */
@@ -237,12 +267,14 @@ clean:
 	}
 
 #else	/* not _WINDOWS */
+#ifndef ZBX_SEQLOCK
 	if (SUCCEED != zbx_mutex_create(&cpustats_lock, ZBX_MUTEX_CPUSTATS, &error))
 	{
 		zbx_error("unable to create mutex for cpu collector: %s", error);
 		zbx_free(error);
 		exit(EXIT_FAILURE);
 	}
+#endif
 
 	pcpus->cpu[0].cpu_num = ZBX_CPUNUM_ALL;
 
@@ -301,8 +333,10 @@ void	free_cpu_collector(ZBX_CPUS_STAT_DATA *pcpus)
 	}
 #else
 	ZBX_UNUSED(pcpus);
+#ifndef ZBX_SEQLOCK
 	zbx_mutex_destroy(&cpustats_lock);
 #endif
+#endif
 
 #ifdef HAVE_KSTAT_H
 	kstat_close(kc);
@@ -344,7 +378,7 @@ static void	update_cpu_counters(ZBX_SINGLE_CPU_STAT_DATA *cpu, zbx_uint64_t *cou
 {
 	int	i, index;
 
-	LOCK_CPUSTATS;
+	LOCK_CPUSTATS(cpu);
 
 	if (MAX_COLLECTOR_HISTORY <= (index = cpu->h_first + cpu->h_count))
 		index -= MAX_COLLECTOR_HISTORY;
@@ -364,7 +398,7 @@ static void	update_cpu_counters(ZBX_SINGLE_CPU_STAT_DATA *cpu, zbx_uint64_t *cou
 	else
 		cpu->h_status[index] = SYSINFO_RET_FAIL;
 
-	UNLOCK_CPUSTATS;
+	UNLOCK_CPUSTATS(cpu);
 }
 
 static void	update_cpustats(ZBX_CPUS_STAT_DATA *pcpus)
@@ -727,10 +761,77 @@ static ZBX_SINGLE_CPU_STAT_DATA	*get_cpustat_by_num(ZBX_CPUS_STAT_DATA *pcpus, i
 	return NULL;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: get_cpu_counters                                                 *
+ *                                                                            *
+ * Purpose: calculate CPU state and total counter increase over the period    *
+ *                                                                            *
+ * Parameters: cpu     - [IN] the CPU statistics                              *
+ *             state   - [IN] the CPU state                                   *
+ *             time    - [IN] the period in seconds                           *
+ *             counter - [OUT] the CPU state counter increase                 *
+ *             total   - [OUT] the total counter increase of all states       *
+ *                                                                            *
+ * Return value: SUCCEED - the counters were calculated                       *
+ *               FAIL    - the last CPU statistics collection failed          *
+ *                                                                            *
+ * Comments: History indexes are range checked because with sequence locks   *
+ *           the history can be modified while being read.                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	get_cpu_counters(const ZBX_SINGLE_CPU_STAT_DATA *cpu, int state, int time, zbx_uint64_t *counter,
+		zbx_uint64_t *total)
+{
+	int	i, h_count, idx_curr, idx_base;
+
+	*total = 0;
+
+	if (MAX_COLLECTOR_HISTORY < (h_count = cpu->h_count) || 0 >= h_count)
+		return FAIL;
+
+	if (MAX_COLLECTOR_HISTORY <= (idx_curr = (cpu->h_first + h_count - 1)))
+		idx_curr -= MAX_COLLECTOR_HISTORY;
+
+	if (0 > idx_curr || MAX_COLLECTOR_HISTORY <= idx_curr || SYSINFO_RET_FAIL == cpu->h_status[idx_curr])
+		return FAIL;
+
+	if (1 == h_count)
+	{
+		for (i = 0; i < ZBX_CPU_STATE_COUNT; i++)
+			*total += cpu->h_counter[i][idx_curr];
+		*counter = cpu->h_counter[state][idx_curr];
+	}
+	else
+	{
+		if (0 > (idx_base = idx_curr - MIN(h_count - 1, time)))
+			idx_base += MAX_COLLECTOR_HISTORY;
+
+		while (SYSINFO_RET_OK != cpu->h_status[idx_base] && idx_base != idx_curr)
+			if (MAX_COLLECTOR_HISTORY == ++idx_base)
+				idx_base -= MAX_COLLECTOR_HISTORY;
+
+		for (i = 0; i < ZBX_CPU_STATE_COUNT; i++)
+		{
+			if (cpu->h_counter[i][idx_curr] > cpu->h_counter[i][idx_base])
+				*total += cpu->h_counter[i][idx_curr] - cpu->h_counter[i][idx_base];
+		}
+
+		/* current counter might be less than previous due to guest time sometimes not being fully included */
+		/* in user time by "/proc/stat" */
+		if (cpu->h_counter[state][idx_curr] > cpu->h_counter[state][idx_base])
+			*counter = cpu->h_counter[state][idx_curr] - cpu->h_counter[state][idx_base];
+		else
+			*counter = 0;
+	}
+
+	return SUCCEED;
+}
+
 int	get_cpustat(AGENT_RESULT *result, int cpu_num, int state, int mode)
 {
-	int				i, time, idx_curr, idx_base;
-	zbx_uint64_t			counter, total = 0;
+	int				time, ret;
+	zbx_uint64_t			counter = 0, total;
 	ZBX_SINGLE_CPU_STAT_DATA	*cpu;
 
 	if (0 > state || state >= ZBX_CPU_STATE_COUNT)
@@ -769,52 +870,41 @@ int	get_cpustat(AGENT_RESULT *result, int cpu_num, int state, int mode)
 		return SYSINFO_RET_OK;
 	}
 
-	LOCK_CPUSTATS;
-
-	if (MAX_COLLECTOR_HISTORY <= (idx_curr = (cpu->h_first + cpu->h_count - 1)))
-		idx_curr -= MAX_COLLECTOR_HISTORY;
+	READ_CPUSTATS(cpu, ret = get_cpu_counters(cpu, state, time, &counter, &total));
 
-	if (SYSINFO_RET_FAIL == cpu->h_status[idx_curr])
+	if (SUCCEED != ret)
 	{
-		UNLOCK_CPUSTATS;
 		SET_MSG_RESULT(result, zbx_strdup(NULL, "Cannot obtain CPU information."));
 		return SYSINFO_RET_FAIL;
 	}
 
-	if (1 == cpu->h_count)
-	{
-		for (i = 0; i < ZBX_CPU_STATE_COUNT; i++)
-			total += cpu->h_counter[i][idx_curr];
-		counter = cpu->h_counter[state][idx_curr];
-	}
-	else
-	{
-		if (0 > (idx_base = idx_curr - MIN(cpu->h_count - 1, time)))
-			idx_base += MAX_COLLECTOR_HISTORY;
-
-		while (SYSINFO_RET_OK != cpu->h_status[idx_base])
-			if (MAX_COLLECTOR_HISTORY == ++idx_base)
-				idx_base -= MAX_COLLECTOR_HISTORY;
+	SET_DBL_RESULT(result, 0 == total ? 0 : 100. * (double)counter / (double)total);
 
-		for (i = 0; i < ZBX_CPU_STATE_COUNT; i++)
-		{
-			if (cpu->h_counter[i][idx_curr] > cpu->h_counter[i][idx_base])
-				total += cpu->h_counter[i][idx_curr] - cpu->h_counter[i][idx_base];
-		}
+	return SYSINFO_RET_OK;
+}
 
-		/* current counter might be less than previous due to guest time sometimes not being fully included */
-		/* in user time by "/proc/stat" */
-		if (cpu->h_counter[state][idx_curr] > cpu->h_counter[state][idx_base])
-			counter = cpu->h_counter[state][idx_curr] - cpu->h_counter[state][idx_base];
-		else
-			counter = 0;
-	}
+/******************************************************************************
+ *                                                                            *
+ * Function: get_cpu_last_status                                              *
+ *                                                                            *
+ * Purpose: get status of the last CPU statistics collection                  *
+ *                                                                            *
+ * Parameters: cpu - [IN] the CPU statistics                                  *
+ *                                                                            *
+ * Return value: SYSINFO_RET_OK or SYSINFO_RET_FAIL                           *
+ *                                                                            *
+ ******************************************************************************/
+static int	get_cpu_last_status(const ZBX_SINGLE_CPU_STAT_DATA *cpu)
+{
+	int	index;
 
-	UNLOCK_CPUSTATS;
+	if (MAX_COLLECTOR_HISTORY <= (index = cpu->h_first + cpu->h_count - 1))
+		index -= MAX_COLLECTOR_HISTORY;
 
-	SET_DBL_RESULT(result, 0 == total ? 0 : 100. * (double)counter / (double)total);
+	if (0 > index || MAX_COLLECTOR_HISTORY <= index)
+		return SYSINFO_RET_FAIL;
 
-	return SYSINFO_RET_OK;
+	return cpu->h_status[index];
 }
 
 static int	get_cpu_status(int pc_status)
@@ -848,8 +938,6 @@ int	get_cpus(zbx_vector_uint64_pair_t *vector)
 	if (!CPU_COLLECTOR_STARTED(collector) || NULL == (pcpus = &collector->cpus))
 		goto out;
 
-	LOCK_CPUSTATS;
-
 	/* Per-CPU information is stored in the ZBX_SINGLE_CPU_STAT_DATA array */
 	/* starting with index 1. Index 0 contains information about all CPUs. */
 
@@ -858,15 +946,13 @@ int	get_cpus(zbx_vector_uint64_pair_t *vector)
 		zbx_uint64_pair_t		pair;
 #ifndef _WINDOWS
 		ZBX_SINGLE_CPU_STAT_DATA	*cpu;
-		int				index;
+		int				status;
 
 		cpu = &pcpus->cpu[idx];
-
-		if (MAX_COLLECTOR_HISTORY <= (index = cpu->h_first + cpu->h_count - 1))
-			index -= MAX_COLLECTOR_HISTORY;
+		READ_CPUSTATS(cpu, status = get_cpu_last_status(cpu));
 
 		pair.first = cpu->cpu_num;
-		pair.second = get_cpu_status(cpu->h_status[index]);
+		pair.second = get_cpu_status(status);
 #else
 		pair.first = idx - 1;
 		pair.second = get_cpu_perf_counter_status(pcpus->cpu_counter[idx]->status);
@@ -874,8 +960,6 @@ int	get_cpus(zbx_vector_uint64_pair_t *vector)
 		zbx_vector_uint64_pair_append(vector, pair);
 	}
 
-	UNLOCK_CPUSTATS;
-
 	ret = SUCCEED;
 out:
 	return ret;
@@ -22,6 +22,7 @@
 
 #include "sysinfo.h"
 #include "zbxalgo.h"
+#include "mutexs.h"
 
 #ifdef _WINDOWS
 #	include "perfmon.h"
@@ -50,7 +51,8 @@ typedef struct
 	int		h_first;
 	int		h_count;
 	int		cpu_num;
-	int		padding1;	/* for 8-byte alignment */
+	zbx_seqlock_t	seqlock;	/* protects history against concurrent readers, keeps the layout of */
+					/* the 4-byte padding it replaced                                  */
 }
 ZBX_SINGLE_CPU_STAT_DATA;
 
@@ -110,32 +110,90 @@ static void	process_diskstat(ZBX_SINGLE_DISKDEVICE_DATA *device)
 	device->ticks_since_polled++;
 }
 
+typedef struct
+{
+	char		name[32];
+	int		ret;
+	zbx_uint64_t	dstat[ZBX_DSTAT_MAX];
+}
+zbx_diskstat_read_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Function: collect_stats_diskdevices                                        *
+ *                                                                            *
+ * Purpose: update statistics of all disk devices in collector                *
+ *                                                                            *
+ * Comments: Disk statistics is read without holding the lock, so processes   *
+ *           polling vfs.dev.read[] and vfs.dev.write[] items wait only while *
+ *           the already read values are being applied.                       *
+ *                                                                            *
+ ******************************************************************************/
 void	collect_stats_diskdevices(void)
 {
-	int	i;
+	int			i, j, count;
+	time_t			now;
+	zbx_diskstat_read_t	*stats;
 
 	LOCK_DISKSTATS;
 	diskstat_shm_reattach();
 
-	for (i = 0; i < diskdevices->count; i++)
+	if (0 == (count = diskdevices->count))
 	{
-		process_diskstat(&diskdevices->device[i]);
+		UNLOCK_DISKSTATS;
+		return;
+	}
+
+	stats = (zbx_diskstat_read_t *)zbx_malloc(NULL, sizeof(zbx_diskstat_read_t) * count);
+
+	for (i = 0; i < count; i++)
+		zbx_strlcpy(stats[i].name, diskdevices->device[i].name, sizeof(stats[i].name));
+
+	UNLOCK_DISKSTATS;
+
+	now = time(NULL);
+
+	for (i = 0; i < count; i++)
+		stats[i].ret = get_diskstat(stats[i].name, stats[i].dstat);
+
+	LOCK_DISKSTATS;
+	diskstat_shm_reattach();
+
+	/* devices are only appended by other processes meanwhile, so the order of known devices is kept */
+	for (i = 0, j = 0; i < diskdevices->count; i++)
+	{
+		ZBX_SINGLE_DISKDEVICE_DATA	*device = &diskdevices->device[i];
+
+		for (; j < count && 0 != strcmp(device->name, stats[j].name); j++)
+			;
+
+		if (j < count)
+		{
+			if (SUCCEED == stats[j].ret)
+			{
+				apply_diskstat(device, now, stats[j].dstat);
+				device->ticks_since_polled++;
+			}
+
+			j++;
+		}
 
 		/* remove device from collector if not being polled for long time */
-		if (DISKDEVICE_TTL <= diskdevices->device[i].ticks_since_polled)
+		if (DISKDEVICE_TTL <= device->ticks_since_polled)
 		{
 			if ((diskdevices->count - 1) > i)
 			{
-				memcpy(diskdevices->device + i, diskdevices->device + i + 1,
-					sizeof(ZBX_SINGLE_DISKDEVICE_DATA) * (diskdevices->count - i));
+				memmove(diskdevices->device + i, diskdevices->device + i + 1,
+					sizeof(ZBX_SINGLE_DISKDEVICE_DATA) * (diskdevices->count - i - 1));
 			}
-
 			diskdevices->count--;
 			i--;
 		}
 	}
 
 	UNLOCK_DISKSTATS;
+
+	zbx_free(stats);
 }
 
 ZBX_SINGLE_DISKDEVICE_DATA	*collector_diskdevice_get(const char *devname)
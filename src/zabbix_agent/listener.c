@@ -22,6 +22,7 @@
 
 #include "comms.h"
 #include "cfg.h"
+#include "zbxjson.h"
 #include "zbxconf.h"
 #include "stats.h"
 #include "sysinfo.h"
@@ -30,6 +31,7 @@
 extern unsigned char			program_type;
 extern ZBX_THREAD_LOCAL unsigned char	process_type;
 extern ZBX_THREAD_LOCAL int		server_num, process_num;
+extern int				CONFIG_PASSIVE_FORKS;
 
 #if defined(ZABBIX_SERVICE)
 #	include "service.h"
@@ -40,16 +42,152 @@ extern ZBX_THREAD_LOCAL int		server_num, process_num;
 #include "zbxcrypto.h"
 #include "../libs/zbxcrypto/tls_tcp_active.h"
 
-static void	process_listener(zbx_socket_t *s)
+/******************************************************************************
+ *                                                                            *
+ * Function: process_passive_checks                                           *
+ *                                                                            *
+ * Purpose: processes multiple passive checks requested at once               *
+ *                                                                            *
+ * Parameters: s         - [IN] the connection                                *
+ *             jp        - [IN] the request                                   *
+ *             keepalive - [OUT] the number of seconds to wait for the next   *
+ *                               request on the same connection, 0 - close    *
+ *                                                                            *
+ * Return value: SUCCEED - the response was sent                              *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The request is                                                   *
+ *             {"request":"passive checks","keys":["<key>",...],              *
+ *                     "keepalive":<seconds>}                                 *
+ *           and a separate response is sent for every key in the same order  *
+ *           as soon as the key is evaluated                                  *
+ *             {"response":"success","value":"<value>"}                       *
+ *             {"response":"success","error":"<error>"}                       *
+ *           so that server can wait for each of them as for a single         *
+ *           passive check. Invalid request gets a single response            *
+ *             {"response":"failed","error":"<error>"}                        *
+ *           Optional keepalive asks to keep the connection open for further  *
+ *           requests, the last response tells for how long the agent will    *
+ *           wait, limited by ListenKeepAlive.                                *
+ *           The last listener never keeps the connection open, so at most    *
+ *           StartAgents - 1 connections from all server and proxy pollers    *
+ *           are kept alive and new connections are still accepted while the  *
+ *           other listeners wait for requests on kept alive connections.     *
+ *                                                                            *
+ ******************************************************************************/
+static int	process_passive_checks(zbx_socket_t *s, const struct zbx_json_parse *jp, int *keepalive)
 {
-	AGENT_RESULT	result;
-	char		**value = NULL;
-	int		ret;
+	struct zbx_json_parse	jp_keys;
+	struct zbx_json		json;
+	AGENT_RESULT		result;
+	const char		*p = NULL, *error;
+	char			*key = NULL, **value, tmp[MAX_ID_LEN + 1];
+	size_t			key_alloc = 0;
+	int			ret = SUCCEED, keepalive_local = 0, keys_num = 0;
+
+	zbx_json_init(&json, ZBX_JSON_STAT_BUF_LEN);
+
+	if (SUCCEED == zbx_json_brackets_by_name(jp, ZBX_PROTO_TAG_KEYS, &jp_keys))
+	{
+		while (NULL != (p = zbx_json_next(&jp_keys, p)))
+			keys_num++;
+
+		error = "no keys requested";
+	}
+	else
+		error = zbx_json_strerror();
 
-	if (SUCCEED == (ret = zbx_tcp_recv_to(s, CONFIG_TIMEOUT)))
+	if (0 == keys_num)
+	{
+		zbx_json_addstring(&json, ZBX_PROTO_TAG_RESPONSE, ZBX_PROTO_VALUE_FAILED, ZBX_JSON_TYPE_STRING);
+		zbx_json_addstring(&json, ZBX_PROTO_TAG_ERROR, error, ZBX_JSON_TYPE_STRING);
+		zabbix_log(LOG_LEVEL_DEBUG, "Sending back [%s]", json.buffer);
+		ret = zbx_tcp_send_to(s, json.buffer, CONFIG_TIMEOUT);
+		goto out;
+	}
+
+	if (0 != CONFIG_LISTEN_KEEPALIVE && CONFIG_PASSIVE_FORKS > process_num &&
+			SUCCEED == zbx_json_value_by_name(jp, ZBX_PROTO_TAG_KEEPALIVE, tmp, sizeof(tmp), NULL) &&
+			SUCCEED == is_uint31(tmp, &keepalive_local))
+	{
+		keepalive_local = MIN(keepalive_local, CONFIG_LISTEN_KEEPALIVE);
+	}
+
+	while (SUCCEED == ret && NULL != (p = zbx_json_next_value_dyn(&jp_keys, p, &key, &key_alloc, NULL)))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "Requested [%s]", key);
+
+		init_result(&result);
+		zbx_json_clean(&json);
+		zbx_json_addstring(&json, ZBX_PROTO_TAG_RESPONSE, ZBX_PROTO_VALUE_SUCCESS, ZBX_JSON_TYPE_STRING);
+
+		if (SUCCEED == process(key, PROCESS_WITH_ALIAS, &result) && NULL != (value = GET_TEXT_RESULT(&result)))
+			zbx_json_addstring(&json, ZBX_PROTO_TAG_VALUE, *value, ZBX_JSON_TYPE_STRING);
+		else if (NULL != (value = GET_MSG_RESULT(&result)))
+			zbx_json_addstring(&json, ZBX_PROTO_TAG_ERROR, *value, ZBX_JSON_TYPE_STRING);
+		else
+			zbx_json_addstring(&json, ZBX_PROTO_TAG_ERROR, ZBX_NOTSUPPORTED_MSG, ZBX_JSON_TYPE_STRING);
+
+		free_result(&result);
+
+		if (0 == --keys_num && 0 != keepalive_local)
+			zbx_json_adduint64(&json, ZBX_PROTO_TAG_KEEPALIVE, keepalive_local);
+
+		zabbix_log(LOG_LEVEL_DEBUG, "Sending back [%s]", json.buffer);
+		ret = zbx_tcp_send_to(s, json.buffer, CONFIG_TIMEOUT);
+	}
+
+	if (SUCCEED == ret)
+		*keepalive = keepalive_local;
+out:
+	zbx_json_free(&json);
+	zbx_free(key);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: process_listener                                                 *
+ *                                                                            *
+ * Purpose: receives and processes a passive check request                    *
+ *                                                                            *
+ * Parameters: s       - [IN] the connection                                  *
+ *             timeout - [IN] 0 - the first request of the connection, or     *
+ *                            the number of seconds to wait for the next      *
+ *                            request on a kept alive connection              *
+ *                                                                            *
+ * Return value: the number of seconds to wait for the next request on the    *
+ *               same connection, 0 - the connection must be closed           *
+ *                                                                            *
+ ******************************************************************************/
+static int	process_listener(zbx_socket_t *s, int timeout)
+{
+	AGENT_RESULT		result;
+	struct zbx_json_parse	jp;
+	char			**value = NULL, request[MAX_STRING_LEN];
+	int			ret, keepalive = 0;
+	ssize_t			received_len;
+
+	received_len = zbx_tcp_recv_ext(s, 0 == timeout ? CONFIG_TIMEOUT : timeout);
+
+	/* kept alive connection is closed by server or is idle for too long */
+	if (0 != timeout && 0 >= received_len)
+		return 0;
+
+	if (SUCCEED == (ret = SUCCEED_OR_FAIL(received_len)))
 	{
 		zbx_rtrim(s->buffer, "\r\n");
 
+		/* item keys cannot start with '{', so it can only be a JSON request */
+		if ('{' == *s->buffer && SUCCEED == zbx_json_open(s->buffer, &jp) &&
+				SUCCEED == zbx_json_value_by_name(&jp, ZBX_PROTO_TAG_REQUEST, request, sizeof(request),
+				NULL) && 0 == strcmp(request, ZBX_PROTO_VALUE_GET_PASSIVE_CHECKS))
+		{
+			ret = process_passive_checks(s, &jp, &keepalive);
+			goto out;
+		}
+
 		zabbix_log(LOG_LEVEL_DEBUG, "Requested [%s]", s->buffer);
 
 		init_result(&result);
@@ -94,9 +232,11 @@ static void	process_listener(zbx_socket_t *s)
 
 		free_result(&result);
 	}
-
+out:
 	if (FAIL == ret)
 		zabbix_log(LOG_LEVEL_DEBUG, "Process listener error: %s", zbx_socket_strerror());
+
+	return keepalive;
 }
 
 ZBX_THREAD_ENTRY(listener_thread, args)
@@ -142,7 +282,15 @@ ZBX_THREAD_ENTRY(listener_thread, args)
 						SUCCEED == (ret = zbx_check_server_issuer_subject(&s, &msg)))
 #endif
 				{
-					process_listener(&s);
+					int	keepalive;
+
+					keepalive = process_listener(&s, 0);
+
+					while (0 != keepalive && ZBX_IS_RUNNING())
+					{
+						zbx_setproctitle("listener #%d [waiting for request]", process_num);
+						keepalive = process_listener(&s, keepalive);
+					}
 				}
 			}
 
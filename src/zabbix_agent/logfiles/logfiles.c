@@ -19,6 +19,7 @@
 
 #include "common.h"
 #include "logfiles.h"
+#include "logwatch.h"
 #include "log.h"
 #include "sysinfo.h"
 
@@ -1506,11 +1507,33 @@ clean:
 #else
 	DIR		*dir = NULL;
 	struct dirent	*d_ent = NULL;
+#ifdef HAVE_SYS_INOTIFY_H
+	const zbx_vector_str_t	*cached;
+	zbx_vector_str_t	names;
+	zbx_uint64_t		revision;
+	int			i;
 
+	/* directory entries are cached until files are created, removed or renamed in the directory */
+	if (SUCCEED == logwatch_get_entries(directory, &cached))
+	{
+		*use_ino = 1;
+
+		for (i = 0; i < cached->values_num; i++)
+			pick_logfile(directory, cached->values[i], mtime, re, logfiles, logfiles_alloc, logfiles_num);
+
+		return SUCCEED;
+	}
+
+	revision = logwatch_get_revision(directory);
+	zbx_vector_str_create(&names);
+#endif
 	if (NULL == (dir = opendir(directory)))
 	{
 		*err_msg = zbx_dsprintf(*err_msg, "Cannot open directory \"%s\" for reading: %s", directory,
 				zbx_strerror(errno));
+#ifdef HAVE_SYS_INOTIFY_H
+		zbx_vector_str_destroy(&names);
+#endif
 		return FAIL;
 	}
 
@@ -1520,14 +1543,26 @@ clean:
 	while (NULL != (d_ent = readdir(dir)))
 	{
 		pick_logfile(directory, d_ent->d_name, mtime, re, logfiles, logfiles_alloc, logfiles_num);
+#ifdef HAVE_SYS_INOTIFY_H
+		if (0 != revision)
+			zbx_vector_str_append(&names, zbx_strdup(NULL, d_ent->d_name));
+#endif
 	}
 
 	if (-1 == closedir(dir))
 	{
 		*err_msg = zbx_dsprintf(*err_msg, "Cannot close directory \"%s\": %s", directory, zbx_strerror(errno));
+#ifdef HAVE_SYS_INOTIFY_H
+		zbx_vector_str_clear_ext(&names, zbx_str_free);
+		zbx_vector_str_destroy(&names);
+#endif
 		return FAIL;
 	}
-
+#ifdef HAVE_SYS_INOTIFY_H
+	logwatch_set_entries(directory, revision, &names);
+	zbx_vector_str_clear_ext(&names, zbx_str_free);
+	zbx_vector_str_destroy(&names);
+#endif
 	return SUCCEED;
 #endif
 }
@@ -1741,35 +1776,38 @@ static char	*buf_find_newline(char *p, char **p_next, const char *p_end, const c
 {
 	if (1 == szbyte)	/* single-byte character set */
 	{
-		for (; p < p_end; p++)
-		{
-			if (0xd < *p || 0xa > *p)
-				continue;
+		if (NULL == (p = (char *)zbx_find_cr_lf_byte(p, p_end)))
+			return (char *)NULL;
 
-			if (0xa == *p)  /* LF (Unix) */
-			{
-				*p_next = p + 1;
-				return p;
-			}
-
-			if (0xd == *p)	/* CR (Mac) */
-			{
-				if (p < p_end - 1 && 0xa == *(p + 1))   /* CR+LF (Windows) */
-				{
-					*p_next = p + 2;
-					return p;
-				}
+		if (0xa == *p)  /* LF (Unix) */
+		{
+			*p_next = p + 1;
+			return p;
+		}
 
-				*p_next = p + 1;
-				return p;
-			}
+		/* CR (Mac) */
+		if (p < p_end - 1 && 0xa == *(p + 1))   /* CR+LF (Windows) */
+		{
+			*p_next = p + 2;
+			return p;
 		}
-		return (char *)NULL;
+
+		*p_next = p + 1;
+		return p;
 	}
 	else
 	{
-		while (p <= p_end - szbyte)
+		char	*p_start = p, *p_byte;
+
+		/* CR and LF characters of all supported multi-byte encodings contain a CR or LF byte, */
+		/* look for such bytes and check the characters they belong to                         */
+		while (NULL != (p_byte = (char *)zbx_find_cr_lf_byte(p, p_end)))
 		{
+			p = p_start + (size_t)(p_byte - p_start) / szbyte * szbyte;
+
+			if (p > p_end - szbyte)
+				break;
+
 			if (0 == memcmp(p, lf, szbyte))		/* LF (Unix) */
 			{
 				*p_next = p + szbyte;
@@ -1795,6 +1833,55 @@ static char	*buf_find_newline(char *p, char **p_next, const char *p_end, const c
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: prepare_lines_regexp                                             *
+ *                                                                            *
+ * Purpose: gets item regular expression compiled for searching whole buffers *
+ *          of log records instead of matching records one by one             *
+ *                                                                            *
+ * Parameters: pattern  - [IN] item regular expression                        *
+ *             encoding - [IN] log file encoding                              *
+ *                                                                            *
+ * Return value: compiled regular expression or NULL if records have to be    *
+ *               matched one by one                                           *
+ *                                                                            *
+ * Comments: Buffer search is used only if a record that matches on its own   *
+ *           cannot be missed, i.e. the regular expression does not look      *
+ *           outside of the matched record. Lookaround assertions, options,   *
+ *           verbs and assertions of subject start and end are therefore not  *
+ *           supported. Records converted to UTF-8 are matched one by one.    *
+ *                                                                            *
+ *           The regular expression is cached by zbx_regexp_prepare_lines()   *
+ *           and must not be freed.                                           *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_regexp_t	*prepare_lines_regexp(const char *pattern, const char *encoding)
+{
+	const zbx_regexp_t	*regexp;
+	const char		*p, *err_msg_static = NULL;
+
+	if ('\0' != *encoding || NULL == pattern || '\0' == *pattern || '@' == *pattern)
+		return NULL;
+
+	if (NULL != strstr(pattern, "(?") || NULL != strstr(pattern, "(*"))
+		return NULL;
+
+	for (p = pattern; NULL != (p = strchr(p, '\\')); p += 2)
+	{
+		if ('\0' == p[1])
+			break;
+
+		if (NULL != strchr("AzZGK", p[1]))
+			return NULL;
+	}
+
+	if (SUCCEED != zbx_regexp_prepare_lines(pattern, &regexp, &err_msg_static))
+		return NULL;
+
+	return regexp;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: update_new_list_from_old                                         *
@@ -1810,13 +1897,14 @@ static int	zbx_read2(int fd, unsigned char flags, zbx_uint64_t *lastlogsize, int
 {
 	static ZBX_THREAD_LOCAL char	*buf = NULL;
 
-	int				ret, nbytes, regexp_ret;
-	const char			*cr, *lf, *p_end;
+	int				ret, nbytes, regexp_ret, lines_search;
+	const char			*cr, *lf, *p_end, *p_match;
 	char				*p_start, *p, *p_nl, *p_next, *item_value = NULL;
 	size_t				szbyte;
 	zbx_offset_t			offset;
 	int				send_err;
 	zbx_uint64_t			lastlogsize1;
+	const zbx_regexp_t		*lines_regexp;
 
 #define BUF_SIZE	(256 * ZBX_KIBIBYTE)	/* The longest encodings use 4 bytes for every character. To send */
 						/* up to 64 k characters to Zabbix server a 256 kB buffer might be */
@@ -1827,6 +1915,8 @@ static int	zbx_read2(int fd, unsigned char flags, zbx_uint64_t *lastlogsize, int
 
 	find_cr_lf_szbyte(encoding, &cr, &lf, &szbyte);
 
+	lines_regexp = prepare_lines_regexp(pattern, encoding);
+
 	for (;;)
 	{
 		if (0 >= *p_count || 0 >= *s_count)
@@ -1979,6 +2069,10 @@ static int	zbx_read2(int fd, unsigned char flags, zbx_uint64_t *lastlogsize, int
 			/* (or trailing part of a large record) in the buffer */
 			*incomplete = 0;
 
+			/* records are matched one by one if they contain null bytes */
+			lines_search = (NULL != lines_regexp && NULL == memchr(buf, '\0', (size_t)nbytes));
+			p_match = NULL;
+
 			for (;;)
 			{
 				if (0 >= *p_count || 0 >= *s_count)
@@ -1992,6 +2086,26 @@ static int	zbx_read2(int fd, unsigned char flags, zbx_uint64_t *lastlogsize, int
 				{
 					char	*value;
 
+					if (0 != lines_search && (NULL == p_match || p_match < p_start))
+					{
+						size_t	match_offset;
+
+						/* find the next record where a match begins, records before it can be */
+						/* skipped without matching them one by one */
+						switch (zbx_regexp_search_lines(p_start, (size_t)(p_end - p_start),
+								lines_regexp, &match_offset))
+						{
+							case ZBX_REGEXP_MATCH:
+								p_match = p_start + match_offset;
+								break;
+							case ZBX_REGEXP_NO_MATCH:
+								p_match = p_end;
+								break;
+							default:
+								lines_search = 0;
+						}
+					}
+
 					*p_nl = '\0';
 
 					if ('\0' != *encoding)
@@ -2002,7 +2116,12 @@ static int	zbx_read2(int fd, unsigned char flags, zbx_uint64_t *lastlogsize, int
 					lastlogsize1 = (size_t)offset + (size_t)(p_next - buf);
 					send_err = FAIL;
 
-					if (0 == (ZBX_METRIC_FLAG_LOG_COUNT & flags))   /* log[] or logrt[] */
+					if (0 != lines_search && p_match >= p_next)
+					{
+						/* no match begins in this record */
+						regexp_ret = ZBX_REGEXP_NO_MATCH;
+					}
+					else if (0 == (ZBX_METRIC_FLAG_LOG_COUNT & flags))   /* log[] or logrt[] */
 					{
 						if (ZBX_REGEXP_MATCH == (regexp_ret = regexp_sub_ex(regexps, value,
 								pattern, ZBX_CASE_SENSITIVE, output_template,
@@ -3372,6 +3491,103 @@ static int	init_rotation_type(unsigned char flags, const AGENT_REQUEST *request,
 	return SUCCEED;
 }
 
+#ifdef HAVE_SYS_INOTIFY_H
+/******************************************************************************
+ *                                                                            *
+ * Function: get_log_directory                                                *
+ *                                                                            *
+ * Purpose: get directory of log[] item file or logrt[] item file name        *
+ *          regular expression                                                *
+ *                                                                            *
+ * Parameters: flags    - [IN] metric flags                                   *
+ *             filename - [IN] the first parameter of the item key            *
+ *                                                                            *
+ * Return value: the directory with trailing separator or NULL                *
+ *                                                                            *
+ ******************************************************************************/
+static char	*get_log_directory(unsigned char flags, const char *filename)
+{
+	char		*directory = NULL, *filename_regexp = NULL, *error = NULL;
+	const char	*separator;
+
+	if (0 != (ZBX_METRIC_FLAG_LOG_LOGRT & flags))
+	{
+		if (SUCCEED != split_filename(filename, &directory, &filename_regexp, &error))
+		{
+			zbx_free(error);
+			return NULL;
+		}
+
+		zbx_free(filename_regexp);
+
+		return directory;
+	}
+
+	if (NULL == (separator = strrchr(filename, PATH_SEPARATOR)))
+		return NULL;
+
+	directory = (char *)zbx_malloc(NULL, (size_t)(separator - filename) + 2);
+	zbx_strlcpy(directory, filename, (size_t)(separator - filename) + 2);
+
+	return directory;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: is_log_unchanged                                                 *
+ *                                                                            *
+ * Purpose: check if log files of an item are unchanged since the last check, *
+ *          which processed all their data                                    *
+ *                                                                            *
+ * Parameters: metric   - [IN] the active check                               *
+ *             revision - [IN] the current revision of the log directory      *
+ *                                                                            *
+ * Return value: SUCCEED - the log files do not need to be checked            *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	is_log_unchanged(const ZBX_ACTIVE_METRIC *metric, zbx_uint64_t revision)
+{
+	if (0 == revision || metric->notify_revision != revision)
+		return FAIL;
+
+	if (ZBX_LOGWATCH_FULL_CHECK_PERIOD <= time(NULL) - metric->notify_lastcheck)
+		return FAIL;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: is_log_processed                                                 *
+ *                                                                            *
+ * Purpose: check if all data of item log files has been processed and the    *
+ *          files can be watched for changes through their directory          *
+ *                                                                            *
+ * Comments: Modifications of files behind symbolic links are not reported    *
+ *           for the directory of the link, such files are always checked.    *
+ *                                                                            *
+ ******************************************************************************/
+static int	is_log_processed(const ZBX_ACTIVE_METRIC *metric)
+{
+	int	i;
+
+	for (i = 0; i < metric->logfiles_num; i++)
+	{
+		const struct st_logfile	*logfile = &metric->logfiles[i];
+		zbx_stat_t		buf;
+
+		if (logfile->processed_size < logfile->size && 0 == logfile->incomplete)
+			return FAIL;
+
+		if (0 != lstat(logfile->filename, &buf) || S_ISLNK(buf.st_mode))
+			return FAIL;
+	}
+
+	return SUCCEED;
+}
+#endif
+
 /******************************************************************************
  *                                                                            *
  * Function: process_log_check                                                *
@@ -3390,11 +3606,15 @@ int	process_log_check(char *server, unsigned short port, zbx_vector_ptr_t *regex
 	AGENT_REQUEST		request;
 	const char		*filename, *regexp, *encoding, *skip, *output_template;
 	char			*encoding_uc = NULL;
-	int			max_lines_per_sec, ret = FAIL, s_count, p_count, s_count_orig, is_count_item,
-				mtime_orig, big_rec_orig, logfiles_num_new = 0, jumped = 0, rotation_type;
-	zbx_uint64_t		lastlogsize_orig;
+	int			max_lines_per_sec, ret = FAIL, s_count, p_count, s_count_orig = 0, is_count_item,
+				mtime_orig = 0, big_rec_orig = 0, logfiles_num_new = 0, jumped = 0, rotation_type;
+	zbx_uint64_t		lastlogsize_orig = 0;
 	float			max_delay;
 	struct st_logfile	*logfiles_new = NULL;
+#ifdef HAVE_SYS_INOTIFY_H
+	char			*directory = NULL;
+	zbx_uint64_t		revision = 0;
+#endif
 
 	if (0 != (ZBX_METRIC_FLAG_LOG_COUNT & metric->flags))
 		is_count_item = 1;
@@ -3515,6 +3735,23 @@ int	process_log_check(char *server, unsigned short port, zbx_vector_ptr_t *regex
 		/* not be sent to server. */
 	}
 
+#ifdef HAVE_SYS_INOTIFY_H
+	/* log[] and logrt[] items do not send anything if their files have not changed since the last check */
+	if (0 == is_count_item && NULL != (directory = get_log_directory(metric->flags, filename)))
+	{
+		revision = logwatch_get_revision(directory);
+
+		if (SUCCEED == is_log_unchanged(metric, revision))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "%s() log files of \"%s\" have not changed", __func__,
+					metric->key_orig);
+			ret = SUCCEED;
+			goto out;
+		}
+	}
+
+	metric->notify_revision = 0;
+#endif
 	ret = process_logrt(metric->flags, filename, &metric->lastlogsize, &metric->mtime, lastlogsize_sent, mtime_sent,
 			&metric->skip_old_data, &metric->big_rec, &metric->use_ino, error, &metric->logfiles,
 			&metric->logfiles_num, &logfiles_new, &logfiles_num_new, encoding, regexps, regexp,
@@ -3530,6 +3767,15 @@ int	process_log_check(char *server, unsigned short port, zbx_vector_ptr_t *regex
 		metric->logfiles = logfiles_new;
 		metric->logfiles_num = logfiles_num_new;
 	}
+#ifdef HAVE_SYS_INOTIFY_H
+	/* the revision was taken before the check, so changes made during the check are not missed */
+	if (SUCCEED == ret && 0 != revision && 0 < p_count && 0 < s_count && 0.0 == metric->start_time &&
+			SUCCEED == is_log_processed(metric))
+	{
+		metric->notify_revision = revision;
+		metric->notify_lastcheck = (int)time(NULL);
+	}
+#endif
 
 	if (SUCCEED == ret)
 	{
@@ -3603,6 +3849,9 @@ int	process_log_check(char *server, unsigned short port, zbx_vector_ptr_t *regex
 		}
 	}
 out:
+#ifdef HAVE_SYS_INOTIFY_H
+	zbx_free(directory);
+#endif
 	zbx_free(encoding_uc);
 	free_request(&request);
 
@@ -0,0 +1,441 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "log.h"
+#include "logwatch.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+#include <sys/inotify.h>
+
+/******************************************************************************
+ *                                                                            *
+ * Directories of log[] and logrt[] items are watched with inotify. Every     *
+ * change in a directory increments its revision, so an item, which has       *
+ * processed all data of its files at some revision, does not need to read    *
+ * the directory, stat and checksum the files until the revision changes.     *
+ * The directory entry names are cached until files are created, removed or   *
+ * renamed.                                                                   *
+ *                                                                            *
+ ******************************************************************************/
+
+#define ZBX_LOGWATCH_DIR_EVENTS	(IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+#define ZBX_LOGWATCH_SELF_EVENTS	(IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_IGNORED)
+#define ZBX_LOGWATCH_EVENTS	(IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | ZBX_LOGWATCH_DIR_EVENTS | \
+		IN_DELETE_SELF | IN_MOVE_SELF)
+
+/* directories not used by any item for this long (seconds) are not watched anymore */
+#define ZBX_LOGWATCH_UNUSED_PERIOD	SEC_PER_HOUR
+
+typedef struct
+{
+	char			*path;
+	int			wd;		/* -1 - the directory is not watched */
+	int			unsupported;	/* the directory is on a file system without notifications */
+	int			lastaccess;
+	zbx_uint64_t		revision;
+	int			entries_valid;
+	zbx_vector_str_t	entries;
+}
+zbx_logwatch_dir_t;
+
+typedef struct
+{
+	int			wd;
+	zbx_logwatch_dir_t	*dir;
+}
+zbx_logwatch_wd_t;
+
+static ZBX_THREAD_LOCAL int		inotify_fd = -1;
+static ZBX_THREAD_LOCAL int		initialized = 0, lastclean = 0;
+static ZBX_THREAD_LOCAL zbx_hashset_t	dirs;
+static ZBX_THREAD_LOCAL zbx_hashset_t	wds;
+
+static zbx_hash_t	logwatch_dir_hash(const void *data)
+{
+	return ZBX_DEFAULT_STRING_HASH_FUNC(((const zbx_logwatch_dir_t *)data)->path);
+}
+
+static int	logwatch_dir_compare(const void *d1, const void *d2)
+{
+	return strcmp(((const zbx_logwatch_dir_t *)d1)->path, ((const zbx_logwatch_dir_t *)d2)->path);
+}
+
+static zbx_hash_t	logwatch_wd_hash(const void *data)
+{
+	return ZBX_DEFAULT_HASH_ALGO(data, sizeof(int), ZBX_DEFAULT_HASH_SEED);
+}
+
+static void	logwatch_dir_clean(void *data)
+{
+	zbx_logwatch_dir_t	*dir = (zbx_logwatch_dir_t *)data;
+
+	zbx_vector_str_clear_ext(&dir->entries, zbx_str_free);
+	zbx_vector_str_destroy(&dir->entries);
+	zbx_free(dir->path);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: logwatch_init                                                    *
+ *                                                                            *
+ * Purpose: create inotify instance of the active checks process              *
+ *                                                                            *
+ * Return value: SUCCEED - change notifications are available                 *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	logwatch_init(void)
+{
+	if (0 != initialized)
+		return -1 != inotify_fd ? SUCCEED : FAIL;
+
+	initialized = 1;
+
+	if (-1 == (inotify_fd = inotify_init()))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot initialize log file change notifications: %s",
+				zbx_strerror(errno));
+		return FAIL;
+	}
+
+	if (-1 == fcntl(inotify_fd, F_SETFL, fcntl(inotify_fd, F_GETFL) | O_NONBLOCK) ||
+			-1 == fcntl(inotify_fd, F_SETFD, FD_CLOEXEC))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot initialize log file change notifications: %s",
+				zbx_strerror(errno));
+		close(inotify_fd);
+		inotify_fd = -1;
+		return FAIL;
+	}
+
+	zbx_hashset_create_ext(&dirs, 10, logwatch_dir_hash, logwatch_dir_compare, logwatch_dir_clean,
+			ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+	zbx_hashset_create(&wds, 10, logwatch_wd_hash, ZBX_DEFAULT_INT_COMPARE_FUNC);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: logwatch_is_remote_fs                                            *
+ *                                                                            *
+ * Purpose: check if directory is on a network or user space file system,     *
+ *          which does not report changes made by other hosts                 *
+ *                                                                            *
+ ******************************************************************************/
+static int	logwatch_is_remote_fs(const char *path)
+{
+#ifdef HAVE_SYS_VFS_H
+	struct statfs	buf;
+
+	if (0 != statfs(path, &buf))
+		return FAIL;
+
+	switch ((unsigned long)buf.f_type)
+	{
+		case 0x6969:		/* NFS */
+		case 0x517b:		/* SMB */
+		case 0xff534d42:	/* CIFS */
+		case 0xfe534d42:	/* SMB2 */
+		case 0x65735546:	/* FUSE */
+		case 0x00c36400:	/* CEPH */
+		case 0x01021997:	/* 9P */
+		case 0x5346414f:	/* AFS */
+		case 0x01161970:	/* GFS2 */
+		case 0x7461636f:	/* OCFS2 */
+		case 0x0bd00bd0:	/* LUSTRE */
+			return SUCCEED;
+	}
+#else
+	ZBX_UNUSED(path);
+#endif
+	return FAIL;
+}
+
+static void	logwatch_dir_invalidate(zbx_logwatch_dir_t *dir)
+{
+	dir->revision++;
+	dir->entries_valid = 0;
+}
+
+static void	logwatch_dir_unwatch(zbx_logwatch_dir_t *dir, int ignored)
+{
+	if (-1 == dir->wd)
+		return;
+
+	if (0 == ignored)
+		inotify_rm_watch(inotify_fd, dir->wd);
+
+	zbx_hashset_remove(&wds, &dir->wd);
+	dir->wd = -1;
+	logwatch_dir_invalidate(dir);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: logwatch_process_events                                          *
+ *                                                                            *
+ * Purpose: read pending change notifications and update directory revisions  *
+ *                                                                            *
+ ******************************************************************************/
+static void	logwatch_process_events(void)
+{
+	union
+	{
+		struct inotify_event	event;
+		char			buf[4096 * 4];
+	}
+	events;
+	const char	*buf = events.buf;
+	ssize_t		len;
+
+	while (0 < (len = read(inotify_fd, events.buf, sizeof(events.buf))))
+	{
+		const struct inotify_event	*event;
+		const char			*ptr;
+
+		for (ptr = buf; ptr < buf + len; ptr += sizeof(struct inotify_event) + event->len)
+		{
+			zbx_logwatch_wd_t	*wd;
+
+			event = (const struct inotify_event *)ptr;
+
+			if (0 != (event->mask & IN_Q_OVERFLOW))
+			{
+				zbx_hashset_iter_t	iter;
+				zbx_logwatch_dir_t	*dir;
+
+				zabbix_log(LOG_LEVEL_DEBUG, "log file change notification queue overflow");
+
+				zbx_hashset_iter_reset(&dirs, &iter);
+				while (NULL != (dir = (zbx_logwatch_dir_t *)zbx_hashset_iter_next(&iter)))
+					logwatch_dir_invalidate(dir);
+
+				continue;
+			}
+
+			if (NULL == (wd = (zbx_logwatch_wd_t *)zbx_hashset_search(&wds, &event->wd)))
+				continue;
+
+			if (0 != (event->mask & ZBX_LOGWATCH_SELF_EVENTS))
+			{
+				/* the directory was removed or renamed, it will be watched again when requested */
+				logwatch_dir_unwatch(wd->dir, 0 != (event->mask & IN_IGNORED));
+				continue;
+			}
+
+			wd->dir->revision++;
+
+			if (0 != (event->mask & ZBX_LOGWATCH_DIR_EVENTS))
+				wd->dir->entries_valid = 0;
+		}
+	}
+
+	if (-1 == len && EAGAIN != errno && EINTR != errno)
+		zabbix_log(LOG_LEVEL_DEBUG, "cannot read log file change notifications: %s", zbx_strerror(errno));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: logwatch_remove_unused                                           *
+ *                                                                            *
+ * Purpose: stop watching directories no longer used by items                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	logwatch_remove_unused(int now)
+{
+	zbx_hashset_iter_t	iter;
+	zbx_logwatch_dir_t	*dir;
+
+	if (ZBX_LOGWATCH_UNUSED_PERIOD > now - lastclean)
+		return;
+
+	lastclean = now;
+
+	zbx_hashset_iter_reset(&dirs, &iter);
+	while (NULL != (dir = (zbx_logwatch_dir_t *)zbx_hashset_iter_next(&iter)))
+	{
+		if (ZBX_LOGWATCH_UNUSED_PERIOD > now - dir->lastaccess)
+			continue;
+
+		logwatch_dir_unwatch(dir, 0);
+		zbx_hashset_iter_remove(&iter);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: logwatch_get_dir                                                 *
+ *                                                                            *
+ * Purpose: get watched directory, start watching it if necessary             *
+ *                                                                            *
+ * Parameters: directory - [IN] the directory path                            *
+ *                                                                            *
+ * Return value: the watched directory or NULL if changes cannot be watched   *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_logwatch_dir_t	*logwatch_get_dir(const char *directory)
+{
+	zbx_logwatch_dir_t	*dir, dir_local;
+	int			now;
+
+	if (SUCCEED != logwatch_init())
+		return NULL;
+
+	logwatch_process_events();
+
+	now = (int)time(NULL);
+	logwatch_remove_unused(now);
+
+	dir_local.path = (char *)directory;
+
+	if (NULL == (dir = (zbx_logwatch_dir_t *)zbx_hashset_search(&dirs, &dir_local)))
+	{
+		dir_local.path = zbx_strdup(NULL, directory);
+		dir_local.wd = -1;
+		dir_local.unsupported = (SUCCEED == logwatch_is_remote_fs(directory) ? 1 : 0);
+		dir_local.revision = 0;
+		dir_local.entries_valid = 0;
+		zbx_vector_str_create(&dir_local.entries);
+
+		dir = (zbx_logwatch_dir_t *)zbx_hashset_insert(&dirs, &dir_local, sizeof(dir_local));
+
+		if (0 != dir->unsupported)
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "changes of \"%s\" cannot be watched on a network file system",
+					directory);
+		}
+	}
+
+	dir->lastaccess = now;
+
+	if (0 != dir->unsupported)
+		return NULL;
+
+	if (-1 == dir->wd)
+	{
+		zbx_logwatch_wd_t	wd_local, *wd;
+
+		if (-1 == (wd_local.wd = inotify_add_watch(inotify_fd, directory, ZBX_LOGWATCH_EVENTS)))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "cannot watch changes of \"%s\": %s", directory,
+					zbx_strerror(errno));
+			return NULL;
+		}
+
+		/* the same watch descriptor is returned for another path of an already watched directory */
+		if (NULL != (wd = (zbx_logwatch_wd_t *)zbx_hashset_search(&wds, &wd_local.wd)))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "changes of \"%s\" are already watched as \"%s\"", directory,
+					wd->dir->path);
+			dir->unsupported = 1;
+			return NULL;
+		}
+
+		dir->wd = wd_local.wd;
+
+		/* a directory can be watched again after it was replaced, consider it changed */
+		logwatch_dir_invalidate(dir);
+
+		wd_local.dir = dir;
+		zbx_hashset_insert(&wds, &wd_local, sizeof(wd_local));
+	}
+
+	return dir;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: logwatch_get_revision                                            *
+ *                                                                            *
+ * Purpose: get the change revision of log file directory                     *
+ *                                                                            *
+ * Parameters: directory - [IN] the directory path                            *
+ *                                                                            *
+ * Return value: the directory revision, changed by every modification of     *
+ *               the directory or the files in it, or 0 if the changes        *
+ *               cannot be watched                                            *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint64_t	logwatch_get_revision(const char *directory)
+{
+	zbx_logwatch_dir_t	*dir;
+
+	if (NULL == (dir = logwatch_get_dir(directory)))
+		return 0;
+
+	return dir->revision;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: logwatch_get_entries                                             *
+ *                                                                            *
+ * Purpose: get cached directory entry names                                  *
+ *                                                                            *
+ * Parameters: directory - [IN] the directory path                            *
+ *             names     - [OUT] the entry names                              *
+ *                                                                            *
+ * Return value: SUCCEED - no files were created, removed or renamed since    *
+ *                         the names were cached                              *
+ *               FAIL    - the directory must be read                         *
+ *                                                                            *
+ ******************************************************************************/
+int	logwatch_get_entries(const char *directory, const zbx_vector_str_t **names)
+{
+	zbx_logwatch_dir_t	*dir;
+
+	if (NULL == (dir = logwatch_get_dir(directory)) || 0 == dir->entries_valid)
+		return FAIL;
+
+	*names = &dir->entries;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: logwatch_set_entries                                             *
+ *                                                                            *
+ * Purpose: cache directory entry names                                       *
+ *                                                                            *
+ * Parameters: directory - [IN] the directory path                            *
+ *             revision  - [IN] the directory revision before it was read     *
+ *             names     - [IN/OUT] the entry names, moved to the cache       *
+ *                                                                            *
+ * Comments: The names are not cached if the directory changed while it was   *
+ *           read.                                                            *
+ *                                                                            *
+ ******************************************************************************/
+void	logwatch_set_entries(const char *directory, zbx_uint64_t revision, zbx_vector_str_t *names)
+{
+	zbx_logwatch_dir_t	*dir;
+
+	if (0 == revision || NULL == (dir = logwatch_get_dir(directory)) || revision != dir->revision)
+		return;
+
+	zbx_vector_str_clear_ext(&dir->entries, zbx_str_free);
+	zbx_vector_str_append_array(&dir->entries, names->values, names->values_num);
+	zbx_vector_str_clear(names);
+	dir->entries_valid = 1;
+}
+
+#endif	/* HAVE_SYS_INOTIFY_H */
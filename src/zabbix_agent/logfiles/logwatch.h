@@ -0,0 +1,37 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_LOGWATCH_H
+#define ZABBIX_LOGWATCH_H
+
+#include "zbxalgo.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+/* log files are checked in full at least this often (seconds) even without change notifications, */
+/* in case a notification was missed, e.g. for a file changed through a symbolic link              */
+#define ZBX_LOGWATCH_FULL_CHECK_PERIOD	300
+
+zbx_uint64_t	logwatch_get_revision(const char *directory);
+int		logwatch_get_entries(const char *directory, const zbx_vector_str_t **names);
+void		logwatch_set_entries(const char *directory, zbx_uint64_t revision, zbx_vector_str_t *names);
+
+#endif
+
+#endif
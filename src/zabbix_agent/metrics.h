@@ -62,6 +62,10 @@ typedef struct
 						/* items. Used for measuring duration of checks. */
 	zbx_uint64_t		processed_bytes;	/* number of processed bytes for log[], log.count[], logrt[], */
 							/* logrt.count[] items */
+	zbx_uint64_t		notify_revision;	/* log directory change revision at the last check, which */
+							/* processed all data of log[] and logrt[] item files, */
+							/* 0 - the files must be checked */
+	int			notify_lastcheck;	/* time of the last check of log[] and logrt[] item files */
 }
 ZBX_ACTIVE_METRIC;
 
@@ -0,0 +1,944 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "log.h"
+#include "zbxalgo.h"
+#include "persistbuf.h"
+
+#include <sys/mman.h>
+
+/******************************************************************************
+ *                                                                            *
+ * The persistent buffer keeps active check values, which could not be sent   *
+ * to server, in a sequence of memory mapped segment files:                   *
+ *                                                                            *
+ *   <PersistentBufferDir>/zabbix_agentd.<host>_<port>.<seq>.buf              *
+ *                                                                            *
+ * Each segment starts with a header holding the committed read and write     *
+ * offsets, followed by the records. Records are written into the last        *
+ * segment and read from the first one. Fully read segments are removed.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#define ZBX_PBUF_MAGIC		0x5a425546	/* "ZBUF" */
+#define ZBX_PBUF_VERSION	1
+#define ZBX_PBUF_SUFFIX		".buf"
+#define ZBX_PBUF_NULL_STR	0xffffffff
+
+#define ZBX_PBUF_ALIGN(size)	(((size) + 7) & ~(zbx_uint64_t)7)
+
+typedef struct
+{
+	zbx_uint32_t	magic;
+	zbx_uint32_t	version;
+	zbx_uint64_t	read_offset;
+	zbx_uint64_t	write_offset;
+}
+zbx_pbuf_header_t;
+
+typedef struct
+{
+	zbx_uint32_t	size;
+	zbx_uint32_t	checksum;
+}
+zbx_pbuf_record_header_t;
+
+typedef struct
+{
+	zbx_uint64_t	lastlogsize;
+	zbx_uint64_t	id;
+	int		timestamp;
+	int		severity;
+	int		logeventid;
+	int		mtime;
+	int		sec;
+	int		ns;
+	zbx_uint32_t	len[4];
+	unsigned char	state;
+	unsigned char	flags;
+}
+zbx_pbuf_record_t;
+
+#define ZBX_PBUF_HEADER(seg)	((zbx_pbuf_header_t *)(seg)->data)
+
+static char	*pbuf_segment_path(const ZBX_PERSISTENT_BUFFER *pbuf, zbx_uint64_t seq)
+{
+	return zbx_dsprintf(NULL, "%s" ZBX_FS_UI64 ZBX_PBUF_SUFFIX, pbuf->prefix, seq);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: pbuf_segment_unmap                                               *
+ *                                                                            *
+ * Purpose: unmap and close segment file                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	pbuf_segment_unmap(ZBX_PERSISTENT_BUFFER_SEGMENT *seg)
+{
+	if (NULL != seg->data)
+	{
+		munmap(seg->data, seg->size);
+		seg->data = NULL;
+	}
+
+	if (-1 != seg->fd)
+	{
+		close(seg->fd);
+		seg->fd = -1;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: pbuf_segment_map                                                 *
+ *                                                                            *
+ * Purpose: open and map an existing segment file                             *
+ *                                                                            *
+ * Parameters: pbuf  - [IN] the persistent buffer                             *
+ *             seq   - [IN] the segment sequence number                       *
+ *             seg   - [OUT] the mapped segment                               *
+ *             error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: SUCCEED - the segment was mapped                             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	pbuf_segment_map(const ZBX_PERSISTENT_BUFFER *pbuf, zbx_uint64_t seq,
+		ZBX_PERSISTENT_BUFFER_SEGMENT *seg, char **error)
+{
+	char			*path;
+	zbx_stat_t		st;
+	zbx_pbuf_header_t	*hdr;
+	int			ret = FAIL;
+
+	path = pbuf_segment_path(pbuf, seq);
+
+	seg->seq = seq;
+	seg->data = NULL;
+
+	if (-1 == (seg->fd = open(path, O_RDWR)))
+	{
+		*error = zbx_dsprintf(*error, "cannot open \"%s\": %s", path, zbx_strerror(errno));
+		goto out;
+	}
+
+	if (0 != zbx_fstat(seg->fd, &st))
+	{
+		*error = zbx_dsprintf(*error, "cannot stat \"%s\": %s", path, zbx_strerror(errno));
+		goto out;
+	}
+
+	if ((zbx_uint64_t)st.st_size < sizeof(zbx_pbuf_header_t))
+	{
+		*error = zbx_dsprintf(*error, "segment \"%s\" is too small", path);
+		goto out;
+	}
+
+	seg->size = (zbx_uint64_t)st.st_size;
+
+	if (MAP_FAILED == (seg->data = (char *)mmap(NULL, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0)))
+	{
+		seg->data = NULL;
+		*error = zbx_dsprintf(*error, "cannot map \"%s\": %s", path, zbx_strerror(errno));
+		goto out;
+	}
+
+	hdr = ZBX_PBUF_HEADER(seg);
+
+	if (ZBX_PBUF_MAGIC != hdr->magic || ZBX_PBUF_VERSION != hdr->version || hdr->read_offset > hdr->write_offset ||
+			hdr->write_offset > seg->size || sizeof(zbx_pbuf_header_t) > hdr->read_offset)
+	{
+		*error = zbx_dsprintf(*error, "segment \"%s\" has invalid header", path);
+		goto out;
+	}
+
+	ret = SUCCEED;
+out:
+	if (SUCCEED != ret)
+		pbuf_segment_unmap(seg);
+
+	zbx_free(path);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: pbuf_segment_create                                              *
+ *                                                                            *
+ * Purpose: create, preallocate and map a new segment file                    *
+ *                                                                            *
+ * Comments: The file blocks are written explicitly rather than extended with *
+ *           ftruncate() so that running out of disk space is reported here   *
+ *           instead of raising SIGBUS when the mapped memory is written.     *
+ *                                                                            *
+ ******************************************************************************/
+static int	pbuf_segment_create(const ZBX_PERSISTENT_BUFFER *pbuf, zbx_uint64_t seq, zbx_uint64_t size,
+		ZBX_PERSISTENT_BUFFER_SEGMENT *seg, char **error)
+{
+	char			*path, zeros[ZBX_KIBIBYTE * 64];
+	zbx_uint64_t		offset;
+	zbx_pbuf_header_t	*hdr;
+	int			ret = FAIL;
+
+	path = pbuf_segment_path(pbuf, seq);
+
+	seg->seq = seq;
+	seg->size = size;
+	seg->data = NULL;
+
+	if (-1 == (seg->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)))
+	{
+		*error = zbx_dsprintf(*error, "cannot create \"%s\": %s", path, zbx_strerror(errno));
+		goto out;
+	}
+
+	memset(zeros, 0, sizeof(zeros));
+
+	for (offset = 0; offset < size;)
+	{
+		ssize_t	n;
+
+		if (-1 == (n = write(seg->fd, zeros, (size_t)MIN(sizeof(zeros), size - offset))))
+		{
+			if (EINTR == errno)
+				continue;
+
+			*error = zbx_dsprintf(*error, "cannot allocate \"%s\": %s", path, zbx_strerror(errno));
+			goto out;
+		}
+
+		offset += (zbx_uint64_t)n;
+	}
+
+	if (MAP_FAILED == (seg->data = (char *)mmap(NULL, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0)))
+	{
+		seg->data = NULL;
+		*error = zbx_dsprintf(*error, "cannot map \"%s\": %s", path, zbx_strerror(errno));
+		goto out;
+	}
+
+	hdr = ZBX_PBUF_HEADER(seg);
+	hdr->magic = ZBX_PBUF_MAGIC;
+	hdr->version = ZBX_PBUF_VERSION;
+	hdr->read_offset = sizeof(zbx_pbuf_header_t);
+	hdr->write_offset = sizeof(zbx_pbuf_header_t);
+
+	ret = SUCCEED;
+out:
+	if (SUCCEED != ret)
+	{
+		pbuf_segment_unmap(seg);
+		unlink(path);
+	}
+
+	zbx_free(path);
+
+	return ret;
+}
+
+static void	pbuf_segment_remove(const ZBX_PERSISTENT_BUFFER *pbuf, zbx_uint64_t seq)
+{
+	char	*path;
+
+	path = pbuf_segment_path(pbuf, seq);
+
+	if (0 != unlink(path))
+		zabbix_log(LOG_LEVEL_WARNING, "cannot remove \"%s\": %s", path, zbx_strerror(errno));
+
+	zbx_free(path);
+}
+
+static zbx_uint32_t	pbuf_checksum(const char *data, zbx_uint32_t size)
+{
+	return (zbx_uint32_t)zbx_hash_modfnv(data, size, ZBX_DEFAULT_HASH_SEED);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: pbuf_record_check                                                *
+ *                                                                            *
+ * Purpose: check that segment record lies within written data and matches    *
+ *          its checksum                                                      *
+ *                                                                            *
+ * Parameters: seg    - [IN] the segment                                      *
+ *             offset - [IN] the record offset                                *
+ *             rh     - [OUT] the record header                               *
+ *                                                                            *
+ * Return value: SUCCEED - the record is valid                                *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The write offset comes from the mapped file and was only checked *
+ *           against the segment size, so nothing is read before checking it. *
+ *                                                                            *
+ ******************************************************************************/
+static int	pbuf_record_check(const ZBX_PERSISTENT_BUFFER_SEGMENT *seg, zbx_uint64_t offset,
+		zbx_pbuf_record_header_t *rh)
+{
+	const zbx_pbuf_header_t	*hdr = ZBX_PBUF_HEADER(seg);
+
+	if (offset + sizeof(zbx_pbuf_record_header_t) > hdr->write_offset)
+		return FAIL;
+
+	memcpy(rh, seg->data + offset, sizeof(zbx_pbuf_record_header_t));
+
+	if (sizeof(zbx_pbuf_record_t) > rh->size || offset + sizeof(zbx_pbuf_record_header_t) + rh->size >
+			hdr->write_offset)
+	{
+		return FAIL;
+	}
+
+	if (rh->checksum != pbuf_checksum(seg->data + offset + sizeof(zbx_pbuf_record_header_t), rh->size))
+		return FAIL;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: pbuf_segment_scan                                                *
+ *                                                                            *
+ * Purpose: validate unread segment records after restart                     *
+ *                                                                            *
+ * Parameters: seg     - [IN] the segment                                     *
+ *             records - [OUT] the number of valid unread records             *
+ *             last_id - [IN/OUT] the largest value id found                  *
+ *                                                                            *
+ * Comments: Writes are synced in batches, so after a crash the tail of the   *
+ *           segment can be lost. The segment is truncated at the first       *
+ *           record failing the checksum.                                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	pbuf_segment_scan(ZBX_PERSISTENT_BUFFER_SEGMENT *seg, int *records, zbx_uint64_t *last_id)
+{
+	zbx_pbuf_header_t		*hdr = ZBX_PBUF_HEADER(seg);
+	zbx_pbuf_record_header_t	rh;
+	zbx_pbuf_record_t		rec;
+	zbx_uint64_t			offset;
+
+	for (offset = hdr->read_offset; offset < hdr->write_offset; offset += ZBX_PBUF_ALIGN(sizeof(rh) + rh.size))
+	{
+		if (SUCCEED != pbuf_record_check(seg, offset, &rh))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "persistent buffer segment " ZBX_FS_UI64 " is damaged at offset "
+					ZBX_FS_UI64 ", discarding " ZBX_FS_UI64 " bytes", seg->seq, offset,
+					hdr->write_offset - offset);
+			hdr->write_offset = offset;
+			break;
+		}
+
+		memcpy(&rec, seg->data + offset + sizeof(rh), sizeof(rec));
+
+		if (*last_id < rec.id)
+			*last_id = rec.id;
+
+		(*records)++;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: pbuf_read_segment                                                *
+ *                                                                            *
+ * Purpose: get the segment values are currently read from                    *
+ *                                                                            *
+ ******************************************************************************/
+static ZBX_PERSISTENT_BUFFER_SEGMENT	*pbuf_read_segment(ZBX_PERSISTENT_BUFFER *pbuf)
+{
+	if (pbuf->seqs.values[0] == pbuf->wseg.seq)
+		return &pbuf->wseg;
+
+	return &pbuf->rseg;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: persistent_buffer_open                                           *
+ *                                                                            *
+ * Purpose: open persistent buffer of the specified server, recovering        *
+ *          the values left by the previous agent run                         *
+ *                                                                            *
+ * Parameters: pbuf     - [OUT] the persistent buffer                         *
+ *             dir      - [IN] the buffer directory                           *
+ *             host     - [IN] the server (proxy) host                        *
+ *             port     - [IN] the server (proxy) port                        *
+ *             max_size - [IN] the maximum disk space used by the buffer      *
+ *             error    - [OUT] the error message                             *
+ *                                                                            *
+ * Return value: SUCCEED - the buffer was opened                              *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	persistent_buffer_open(ZBX_PERSISTENT_BUFFER *pbuf, const char *dir, const char *host, unsigned short port,
+		zbx_uint64_t max_size, char **error)
+{
+	DIR		*d;
+	struct dirent	*entry;
+	char		*name, *ptr;
+	size_t		name_len;
+	int		i, records = 0, ret = FAIL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() dir:'%s' host:'%s' port:%hu", __func__, dir, host, port);
+
+	memset(pbuf, 0, sizeof(ZBX_PERSISTENT_BUFFER));
+	pbuf->rseg.fd = -1;
+	pbuf->wseg.fd = -1;
+	pbuf->max_size = max_size;
+	pbuf->lastsync = time(NULL);
+	zbx_vector_uint64_create(&pbuf->seqs);
+
+	/* the host name can contain characters not allowed in file names */
+	name = zbx_dsprintf(NULL, "zabbix_agentd.%s_%hu.", host, port);
+
+	for (ptr = name; '\0' != *ptr; ptr++)
+	{
+		if (0 == isalnum((unsigned char)*ptr) && NULL == strchr("._-", *ptr))
+			*ptr = '_';
+	}
+
+	name_len = strlen(name);
+	pbuf->prefix = zbx_dsprintf(NULL, "%s/%s", dir, name);
+
+	if (NULL == (d = opendir(dir)))
+	{
+		*error = zbx_dsprintf(*error, "cannot open directory \"%s\": %s", dir, zbx_strerror(errno));
+		goto out;
+	}
+
+	while (NULL != (entry = readdir(d)))
+	{
+		zbx_uint64_t	seq;
+		size_t		len;
+
+		if (0 != strncmp(entry->d_name, name, name_len))
+			continue;
+
+		len = strlen(entry->d_name + name_len);
+
+		if (ZBX_CONST_STRLEN(ZBX_PBUF_SUFFIX) >= len ||
+				0 != strcmp(entry->d_name + name_len + len - ZBX_CONST_STRLEN(ZBX_PBUF_SUFFIX),
+				ZBX_PBUF_SUFFIX))
+		{
+			continue;
+		}
+
+		if (SUCCEED != is_uint64_n(entry->d_name + name_len, len - ZBX_CONST_STRLEN(ZBX_PBUF_SUFFIX), &seq))
+			continue;
+
+		zbx_vector_uint64_append(&pbuf->seqs, seq);
+	}
+
+	closedir(d);
+
+	zbx_vector_uint64_sort(&pbuf->seqs, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	/* drop damaged and fully read segments, count the remaining records */
+	for (i = 0; i < pbuf->seqs.values_num;)
+	{
+		ZBX_PERSISTENT_BUFFER_SEGMENT	seg;
+		zbx_pbuf_header_t		*hdr;
+		char				*map_error = NULL;
+
+		if (SUCCEED != pbuf_segment_map(pbuf, pbuf->seqs.values[i], &seg, &map_error))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "discarding persistent buffer segment: %s", map_error);
+			zbx_free(map_error);
+			pbuf_segment_remove(pbuf, pbuf->seqs.values[i]);
+			zbx_vector_uint64_remove(&pbuf->seqs, i);
+			continue;
+		}
+
+		pbuf_segment_scan(&seg, &records, &pbuf->last_id);
+		hdr = ZBX_PBUF_HEADER(&seg);
+
+		if (hdr->read_offset == hdr->write_offset && i != pbuf->seqs.values_num - 1)
+		{
+			pbuf_segment_unmap(&seg);
+			pbuf_segment_remove(pbuf, pbuf->seqs.values[i]);
+			zbx_vector_uint64_remove(&pbuf->seqs, i);
+			continue;
+		}
+
+		pbuf->used_size += seg.size;
+		pbuf_segment_unmap(&seg);
+		i++;
+	}
+
+	if (0 == pbuf->seqs.values_num)
+	{
+		if (SUCCEED != pbuf_segment_create(pbuf, 1, ZBX_PERSISTENT_BUFFER_SEGMENT_SIZE, &pbuf->wseg, error))
+			goto out;
+
+		zbx_vector_uint64_append(&pbuf->seqs, 1);
+		pbuf->used_size = pbuf->wseg.size;
+	}
+	else if (SUCCEED != pbuf_segment_map(pbuf, pbuf->seqs.values[pbuf->seqs.values_num - 1], &pbuf->wseg,
+			error))
+	{
+		goto out;
+	}
+
+	if (pbuf->seqs.values[0] != pbuf->wseg.seq &&
+			SUCCEED != pbuf_segment_map(pbuf, pbuf->seqs.values[0], &pbuf->rseg, error))
+	{
+		goto out;
+	}
+
+	pbuf->read_offset = ZBX_PBUF_HEADER(pbuf_read_segment(pbuf))->read_offset;
+
+	if (0 != records)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "found %d unsent values in persistent buffer \"%s*" ZBX_PBUF_SUFFIX "\"",
+				records, pbuf->prefix);
+	}
+
+	ret = SUCCEED;
+out:
+	if (SUCCEED != ret)
+		persistent_buffer_close(pbuf);
+
+	zbx_free(name);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s records:%d", __func__, zbx_result_string(ret), records);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: persistent_buffer_close                                          *
+ *                                                                            *
+ * Purpose: sync and close persistent buffer                                  *
+ *                                                                            *
+ ******************************************************************************/
+void	persistent_buffer_close(ZBX_PERSISTENT_BUFFER *pbuf)
+{
+	if (NULL != pbuf->wseg.data)
+		persistent_buffer_sync(pbuf, 1);
+
+	pbuf_segment_unmap(&pbuf->rseg);
+	pbuf_segment_unmap(&pbuf->wseg);
+
+	zbx_vector_uint64_destroy(&pbuf->seqs);
+	zbx_free(pbuf->prefix);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: persistent_buffer_sync                                           *
+ *                                                                            *
+ * Purpose: flush buffered writes and read offsets to disk                    *
+ *                                                                            *
+ * Parameters: pbuf  - [IN] the persistent buffer                             *
+ *             force - [IN] 1 - flush regardless of the sync limits           *
+ *                                                                            *
+ * Comments: Syncing every value would limit the agent to the disk IOPS, so   *
+ *           writes are synced after ZBX_PERSISTENT_BUFFER_SYNC_RECORDS       *
+ *           values or ZBX_PERSISTENT_BUFFER_SYNC_PERIOD seconds.             *
+ *                                                                            *
+ ******************************************************************************/
+void	persistent_buffer_sync(ZBX_PERSISTENT_BUFFER *pbuf, int force)
+{
+	time_t	now;
+
+	if (0 == pbuf->unsynced)
+		return;
+
+	now = time(NULL);
+
+	if (0 == force && ZBX_PERSISTENT_BUFFER_SYNC_RECORDS > pbuf->unsynced &&
+			ZBX_PERSISTENT_BUFFER_SYNC_PERIOD > now - pbuf->lastsync)
+	{
+		return;
+	}
+
+	if (0 != msync(pbuf->wseg.data, pbuf->wseg.size, MS_SYNC))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot sync persistent buffer segment " ZBX_FS_UI64 ": %s",
+				pbuf->wseg.seq, zbx_strerror(errno));
+	}
+
+	if (NULL != pbuf->rseg.data)
+		msync(pbuf->rseg.data, sizeof(zbx_pbuf_header_t), MS_ASYNC);
+
+	pbuf->unsynced = 0;
+	pbuf->lastsync = now;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: persistent_buffer_write                                          *
+ *                                                                            *
+ * Purpose: append value to persistent buffer                                 *
+ *                                                                            *
+ * Parameters: pbuf - [IN] the persistent buffer                              *
+ *             el   - [IN] the value to store                                 *
+ *                                                                            *
+ * Return value: SUCCEED - the value was stored                               *
+ *               FAIL    - the buffer size limit was reached or a new segment *
+ *                         could not be created                               *
+ *                                                                            *
+ ******************************************************************************/
+int	persistent_buffer_write(ZBX_PERSISTENT_BUFFER *pbuf, const ZBX_ACTIVE_BUFFER_ELEMENT *el)
+{
+	const char			*strs[4];
+	zbx_pbuf_record_t		rec;
+	zbx_pbuf_record_header_t	rh;
+	zbx_pbuf_header_t		*hdr;
+	zbx_uint64_t			need, size;
+	char				*ptr;
+	int				i;
+
+	strs[0] = el->host;
+	strs[1] = el->key;
+	strs[2] = el->value;
+	strs[3] = el->source;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.lastlogsize = el->lastlogsize;
+	rec.id = el->id;
+	rec.timestamp = el->timestamp;
+	rec.severity = el->severity;
+	rec.logeventid = el->logeventid;
+	rec.mtime = el->mtime;
+	rec.sec = el->ts.sec;
+	rec.ns = el->ts.ns;
+	rec.state = el->state;
+	rec.flags = el->flags;
+
+	need = sizeof(rec);
+
+	for (i = 0; i < (int)ARRSIZE(strs); i++)
+	{
+		if (NULL == strs[i])
+		{
+			rec.len[i] = ZBX_PBUF_NULL_STR;
+			continue;
+		}
+
+		rec.len[i] = (zbx_uint32_t)strlen(strs[i]);
+		need += rec.len[i];
+	}
+
+	rh.size = (zbx_uint32_t)need;
+	need = ZBX_PBUF_ALIGN(sizeof(rh) + need);
+
+	if (ZBX_PBUF_HEADER(&pbuf->wseg)->write_offset + need > pbuf->wseg.size)
+	{
+		ZBX_PERSISTENT_BUFFER_SEGMENT	seg;
+		char				*error = NULL;
+
+		size = MAX(ZBX_PERSISTENT_BUFFER_SEGMENT_SIZE, ZBX_PBUF_ALIGN(sizeof(zbx_pbuf_header_t) + need));
+
+		if (pbuf->used_size + size > pbuf->max_size)
+			return FAIL;
+
+		if (SUCCEED != pbuf_segment_create(pbuf, pbuf->wseg.seq + 1, size, &seg, &error))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot extend persistent buffer: %s", error);
+			zbx_free(error);
+			return FAIL;
+		}
+
+		persistent_buffer_sync(pbuf, 1);
+
+		/* the current write segment is kept mapped if it becomes the read segment */
+		if (pbuf->seqs.values[0] == pbuf->wseg.seq)
+			pbuf->rseg = pbuf->wseg;
+		else
+			pbuf_segment_unmap(&pbuf->wseg);
+
+		pbuf->wseg = seg;
+		pbuf->used_size += seg.size;
+		zbx_vector_uint64_append(&pbuf->seqs, seg.seq);
+	}
+
+	hdr = ZBX_PBUF_HEADER(&pbuf->wseg);
+	ptr = pbuf->wseg.data + hdr->write_offset + sizeof(rh);
+
+	memcpy(ptr, &rec, sizeof(rec));
+	ptr += sizeof(rec);
+
+	for (i = 0; i < (int)ARRSIZE(strs); i++)
+	{
+		if (ZBX_PBUF_NULL_STR == rec.len[i])
+			continue;
+
+		memcpy(ptr, strs[i], rec.len[i]);
+		ptr += rec.len[i];
+	}
+
+	rh.checksum = pbuf_checksum(pbuf->wseg.data + hdr->write_offset + sizeof(rh), rh.size);
+	memcpy(pbuf->wseg.data + hdr->write_offset, &rh, sizeof(rh));
+
+	hdr->write_offset += need;
+
+	if (pbuf->last_id < el->id)
+		pbuf->last_id = el->id;
+
+	pbuf->unsynced++;
+
+	persistent_buffer_sync(pbuf, 0);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: pbuf_record_read                                                 *
+ *                                                                            *
+ * Purpose: decode value record                                               *
+ *                                                                            *
+ * Parameters: data - [IN] the record                                         *
+ *             el   - [OUT] the value, strings must be freed by the caller    *
+ *                                                                            *
+ * Return value: the record size in segment                                   *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_uint64_t	pbuf_record_read(const char *data, ZBX_ACTIVE_BUFFER_ELEMENT *el)
+{
+	zbx_pbuf_record_header_t	rh;
+	zbx_pbuf_record_t		rec;
+	char				**strs[4];
+	const char			*ptr;
+	int				i;
+
+	memcpy(&rh, data, sizeof(rh));
+	ptr = data + sizeof(rh);
+	memcpy(&rec, ptr, sizeof(rec));
+	ptr += sizeof(rec);
+
+	memset(el, 0, sizeof(ZBX_ACTIVE_BUFFER_ELEMENT));
+	el->lastlogsize = rec.lastlogsize;
+	el->id = rec.id;
+	el->timestamp = rec.timestamp;
+	el->severity = rec.severity;
+	el->logeventid = rec.logeventid;
+	el->mtime = rec.mtime;
+	el->ts.sec = rec.sec;
+	el->ts.ns = rec.ns;
+	el->state = rec.state;
+	el->flags = rec.flags;
+
+	strs[0] = &el->host;
+	strs[1] = &el->key;
+	strs[2] = &el->value;
+	strs[3] = &el->source;
+
+	for (i = 0; i < (int)ARRSIZE(strs); i++)
+	{
+		if (ZBX_PBUF_NULL_STR == rec.len[i])
+			continue;
+
+		*strs[i] = (char *)zbx_malloc(NULL, rec.len[i] + 1);
+		memcpy(*strs[i], ptr, rec.len[i]);
+		(*strs[i])[rec.len[i]] = '\0';
+		ptr += rec.len[i];
+	}
+
+	return ZBX_PBUF_ALIGN(sizeof(rh) + rh.size);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: persistent_buffer_read                                           *
+ *                                                                            *
+ * Purpose: read the next value from persistent buffer                        *
+ *                                                                            *
+ * Parameters: pbuf - [IN] the persistent buffer                              *
+ *             el   - [OUT] the value, strings must be freed by the caller    *
+ *                                                                            *
+ * Return value: SUCCEED - the value was read                                 *
+ *               FAIL    - no more values can be read before the read         *
+ *                         position is committed                              *
+ *                                                                            *
+ * Comments: The read position is advanced only in memory, the values are     *
+ *           removed from the buffer by persistent_buffer_commit() after they *
+ *           have been accepted by server.                                    *
+ *                                                                            *
+ ******************************************************************************/
+int	persistent_buffer_read(ZBX_PERSISTENT_BUFFER *pbuf, ZBX_ACTIVE_BUFFER_ELEMENT *el)
+{
+	ZBX_PERSISTENT_BUFFER_SEGMENT	*seg;
+
+	seg = pbuf_read_segment(pbuf);
+
+	if (pbuf->read_offset >= ZBX_PBUF_HEADER(seg)->write_offset)
+	{
+		/* values are not read across segments, the exhausted segment is removed by commit */
+		if (seg == &pbuf->wseg || ZBX_PBUF_HEADER(seg)->read_offset != pbuf->read_offset)
+			return FAIL;
+
+		persistent_buffer_commit(pbuf);
+		seg = pbuf_read_segment(pbuf);
+
+		if (pbuf->read_offset >= ZBX_PBUF_HEADER(seg)->write_offset)
+			return FAIL;
+	}
+
+	pbuf->read_offset += pbuf_record_read(seg->data + pbuf->read_offset, el);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: persistent_buffer_commit                                         *
+ *                                                                            *
+ * Purpose: remove the values read since the last commit from the buffer      *
+ *                                                                            *
+ ******************************************************************************/
+void	persistent_buffer_commit(ZBX_PERSISTENT_BUFFER *pbuf)
+{
+	ZBX_PERSISTENT_BUFFER_SEGMENT	*seg;
+	zbx_pbuf_header_t		*hdr;
+
+	seg = pbuf_read_segment(pbuf);
+	hdr = ZBX_PBUF_HEADER(seg);
+
+	hdr->read_offset = pbuf->read_offset;
+
+	if (hdr->read_offset != hdr->write_offset)
+		return;
+
+	if (seg == &pbuf->wseg)
+	{
+		/* reuse the write segment once everything has been sent */
+		hdr->read_offset = sizeof(zbx_pbuf_header_t);
+		hdr->write_offset = sizeof(zbx_pbuf_header_t);
+		pbuf->read_offset = hdr->read_offset;
+		return;
+	}
+
+	pbuf->used_size -= seg->size;
+	pbuf_segment_unmap(seg);
+	pbuf_segment_remove(pbuf, pbuf->seqs.values[0]);
+	zbx_vector_uint64_remove(&pbuf->seqs, 0);
+
+	while (pbuf->seqs.values[0] != pbuf->wseg.seq)
+	{
+		char	*error = NULL;
+
+		if (SUCCEED == pbuf_segment_map(pbuf, pbuf->seqs.values[0], &pbuf->rseg, &error))
+			break;
+
+		/* the values of unreadable segment are lost, continue with the next one */
+		zabbix_log(LOG_LEVEL_WARNING, "cannot read persistent buffer: %s", error);
+		zbx_free(error);
+		pbuf_segment_remove(pbuf, pbuf->seqs.values[0]);
+		zbx_vector_uint64_remove(&pbuf->seqs, 0);
+	}
+
+	pbuf->read_offset = ZBX_PBUF_HEADER(pbuf_read_segment(pbuf))->read_offset;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: persistent_buffer_empty                                          *
+ *                                                                            *
+ * Purpose: check if persistent buffer has unsent values                      *
+ *                                                                            *
+ * Return value: SUCCEED - the buffer is empty                                *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	persistent_buffer_empty(const ZBX_PERSISTENT_BUFFER *pbuf)
+{
+	const zbx_pbuf_header_t	*hdr = ZBX_PBUF_HEADER(&pbuf->wseg);
+
+	if (1 == pbuf->seqs.values_num && hdr->read_offset == hdr->write_offset)
+		return SUCCEED;
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: persistent_buffer_rollback                                       *
+ *                                                                            *
+ * Purpose: return the read position to the last commit                       *
+ *                                                                            *
+ ******************************************************************************/
+void	persistent_buffer_rollback(ZBX_PERSISTENT_BUFFER *pbuf)
+{
+	pbuf->read_offset = ZBX_PBUF_HEADER(pbuf_read_segment(pbuf))->read_offset;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: persistent_buffer_scan                                           *
+ *                                                                            *
+ * Purpose: pass the unsent values to callback without reading them           *
+ *                                                                            *
+ * Parameters: pbuf - [IN] the persistent buffer                              *
+ *             cb   - [IN] the callback, FAIL stops the scan                  *
+ *             data - [IN] the callback data                                  *
+ *                                                                            *
+ * Comments: Values are scanned from the committed read position across all   *
+ *           segments, the read position is not changed.                      *
+ *                                                                            *
+ ******************************************************************************/
+void	persistent_buffer_scan(ZBX_PERSISTENT_BUFFER *pbuf, zbx_pbuf_scan_func_t cb, void *data)
+{
+	ZBX_PERSISTENT_BUFFER_SEGMENT	tmp, *seg;
+	ZBX_ACTIVE_BUFFER_ELEMENT	el;
+	zbx_uint64_t			offset;
+	int				i, ret = SUCCEED;
+
+	for (i = 0; i < pbuf->seqs.values_num && SUCCEED == ret; i++)
+	{
+		if (pbuf->seqs.values[i] == pbuf->wseg.seq)
+		{
+			seg = &pbuf->wseg;
+		}
+		else if (0 == i)
+		{
+			seg = &pbuf->rseg;
+		}
+		else
+		{
+			char	*error = NULL;
+
+			if (SUCCEED != pbuf_segment_map(pbuf, pbuf->seqs.values[i], &tmp, &error))
+			{
+				zabbix_log(LOG_LEVEL_DEBUG, "%s() cannot scan segment: %s", __func__, error);
+				zbx_free(error);
+				continue;
+			}
+
+			seg = &tmp;
+		}
+
+		for (offset = ZBX_PBUF_HEADER(seg)->read_offset; offset < ZBX_PBUF_HEADER(seg)->write_offset &&
+				SUCCEED == ret;)
+		{
+			offset += pbuf_record_read(seg->data + offset, &el);
+			ret = cb(&el, data);
+
+			zbx_free(el.host);
+			zbx_free(el.key);
+			zbx_free(el.value);
+			zbx_free(el.source);
+		}
+
+		if (seg == &tmp)
+			pbuf_segment_unmap(&tmp);
+	}
+}
@@ -0,0 +1,86 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_PERSISTBUF_H
+#define ZABBIX_PERSISTBUF_H
+
+#include "active.h"
+
+#ifndef _WINDOWS
+
+extern char		*CONFIG_PERSISTENT_BUFFER_DIR;
+extern zbx_uint64_t	CONFIG_PERSISTENT_BUFFER_SIZE;
+
+/* the default size of a buffer segment file, larger values get segments of their own */
+#define ZBX_PERSISTENT_BUFFER_SEGMENT_SIZE	(16 * ZBX_MEBIBYTE)
+
+/* buffered writes are flushed to disk when either of the limits is reached */
+#define ZBX_PERSISTENT_BUFFER_SYNC_RECORDS	1000
+#define ZBX_PERSISTENT_BUFFER_SYNC_PERIOD	1
+
+/* the backlog is sent in batches for limited time to keep active checks running */
+#define ZBX_PERSISTENT_BUFFER_BATCH_SIZE	1000
+#define ZBX_PERSISTENT_BUFFER_SEND_TIME		1
+
+typedef struct
+{
+	zbx_uint64_t	seq;
+	int		fd;
+	char		*data;
+	zbx_uint64_t	size;
+}
+ZBX_PERSISTENT_BUFFER_SEGMENT;
+
+typedef struct
+{
+	char				*prefix;
+	zbx_uint64_t			max_size;
+	zbx_uint64_t			used_size;
+
+	/* segment sequence numbers present on disk, the first one is read and the last one is written */
+	zbx_vector_uint64_t		seqs;
+
+	ZBX_PERSISTENT_BUFFER_SEGMENT	rseg;
+	ZBX_PERSISTENT_BUFFER_SEGMENT	wseg;
+
+	/* the uncommitted read position in the read segment */
+	zbx_uint64_t			read_offset;
+
+	zbx_uint64_t			last_id;
+	int				unsynced;
+	time_t				lastsync;
+}
+ZBX_PERSISTENT_BUFFER;
+
+typedef int	(*zbx_pbuf_scan_func_t)(const ZBX_ACTIVE_BUFFER_ELEMENT *el, void *data);
+
+int	persistent_buffer_open(ZBX_PERSISTENT_BUFFER *pbuf, const char *dir, const char *host, unsigned short port,
+		zbx_uint64_t max_size, char **error);
+void	persistent_buffer_close(ZBX_PERSISTENT_BUFFER *pbuf);
+int	persistent_buffer_write(ZBX_PERSISTENT_BUFFER *pbuf, const ZBX_ACTIVE_BUFFER_ELEMENT *el);
+int	persistent_buffer_read(ZBX_PERSISTENT_BUFFER *pbuf, ZBX_ACTIVE_BUFFER_ELEMENT *el);
+void	persistent_buffer_commit(ZBX_PERSISTENT_BUFFER *pbuf);
+void	persistent_buffer_rollback(ZBX_PERSISTENT_BUFFER *pbuf);
+void	persistent_buffer_sync(ZBX_PERSISTENT_BUFFER *pbuf, int force);
+int	persistent_buffer_empty(const ZBX_PERSISTENT_BUFFER *pbuf);
+void	persistent_buffer_scan(ZBX_PERSISTENT_BUFFER *pbuf, zbx_pbuf_scan_func_t cb, void *data);
+
+#endif	/* _WINDOWS */
+
+#endif	/* ZABBIX_PERSISTBUF_H */
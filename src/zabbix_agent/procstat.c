@@ -964,6 +964,23 @@ int	zbx_procstat_collector_started(void)
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: proc_snapshot_copy_data                                          *
+ *                                                                            *
+ * Purpose: initializes a new process snapshot shared memory segment          *
+ *                                                                            *
+ * Comments: The snapshot is not copied, it is taken again after the segment  *
+ *           is reallocated.                                                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	proc_snapshot_copy_data(void *dst, size_t size_dst, const void *src)
+{
+	ZBX_UNUSED(src);
+
+	memset(dst, 0, size_dst);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_procstat_init                                                *
@@ -985,6 +1002,15 @@ void	zbx_procstat_init(void)
 		exit(EXIT_FAILURE);
 	}
 
+	/* process table snapshot shared by proc.num[] and proc.mem[] items on Linux, see proc_get_snapshot() */
+	if (SUCCEED != zbx_dshm_create(&collector->proc_snapshot, 0, ZBX_MUTEX_PROC_SNAPSHOT,
+			proc_snapshot_copy_data, &errmsg))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot initialize process snapshot: %s", errmsg);
+		zbx_free(errmsg);
+		exit(EXIT_FAILURE);
+	}
+
 	procstat_ref.shmid = ZBX_NONEXISTENT_SHMID;
 	procstat_ref.addr = NULL;
 }
@@ -1006,6 +1032,12 @@ void	zbx_procstat_destroy(void)
 		zbx_free(errmsg);
 	}
 
+	if (SUCCEED != zbx_dshm_destroy(&collector->proc_snapshot, &errmsg))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot free resources allocated by process snapshot: %s", errmsg);
+		zbx_free(errmsg);
+	}
+
 	procstat_ref.shmid = ZBX_NONEXISTENT_SHMID;
 	procstat_ref.addr = NULL;
 }
@@ -46,6 +46,7 @@ typedef struct
 #endif
 #ifdef ZBX_PROCSTAT_COLLECTOR
 	zbx_dshm_t		procstat;
+	zbx_dshm_t		proc_snapshot;
 #endif
 #ifdef _AIX
 	ZBX_VMSTAT_DATA		vmstat;
@@ -40,12 +40,18 @@ int	CONFIG_UNSAFE_USER_PARAMETERS	= 0;
 int	CONFIG_LISTEN_PORT		= ZBX_DEFAULT_AGENT_PORT;
 int	CONFIG_REFRESH_ACTIVE_CHECKS	= 120;
 char	*CONFIG_LISTEN_IP		= NULL;
+int	CONFIG_LISTEN_KEEPALIVE		= 0;
 char	*CONFIG_SOURCE_IP		= NULL;
 int	CONFIG_LOG_LEVEL		= LOG_LEVEL_WARNING;
 
 int	CONFIG_BUFFER_SIZE		= 100;
 int	CONFIG_BUFFER_SEND		= 5;
 
+#ifndef _WINDOWS
+char		*CONFIG_PERSISTENT_BUFFER_DIR	= NULL;
+zbx_uint64_t	CONFIG_PERSISTENT_BUFFER_SIZE	= 256 * ZBX_MEBIBYTE;
+#endif
+
 int	CONFIG_MAX_LINES_PER_SECOND		= 20;
 int	CONFIG_EVENTLOG_MAX_LINES_PER_SECOND	= 20;
 
@@ -758,6 +764,8 @@ static void	zbx_load_config(int requirement, ZBX_TASK_EX *task)
 			PARM_OPT,	1024,			32767},
 		{"ListenIP",			&CONFIG_LISTEN_IP,			TYPE_STRING_LIST,
 			PARM_OPT,	0,			0},
+		{"ListenKeepAlive",		&CONFIG_LISTEN_KEEPALIVE,		TYPE_INT,
+			PARM_OPT,	0,			SEC_PER_MIN * 5},
 		{"SourceIP",			&CONFIG_SOURCE_IP,			TYPE_STRING,
 			PARM_OPT,	0,			0},
 		{"DebugLevel",			&CONFIG_LOG_LEVEL,			TYPE_INT,
@@ -787,6 +795,10 @@ static void	zbx_load_config(int requirement, ZBX_TASK_EX *task)
 			PARM_OPT,	0,			1},
 		{"User",			&CONFIG_USER,				TYPE_STRING,
 			PARM_OPT,	0,			0},
+		{"PersistentBufferDir",		&CONFIG_PERSISTENT_BUFFER_DIR,		TYPE_STRING,
+			PARM_OPT,	0,			0},
+		{"PersistentBufferSize",	&CONFIG_PERSISTENT_BUFFER_SIZE,		TYPE_UINT64,
+			PARM_OPT,	16 * ZBX_MEBIBYTE,	__UINT64_C(1024) * ZBX_GIBIBYTE},
 #endif
 #ifdef _WINDOWS
 		{"PerfCounter",			&CONFIG_PERF_COUNTERS,			TYPE_MULTISTRING,
@@ -1046,6 +1058,11 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 				zbx_thread_start(listener_thread, thread_args, &threads[i]);
 				break;
 			case ZBX_PROCESS_TYPE_ACTIVE_CHECKS:
+#ifndef _WINDOWS
+				/* unsent values are moved to persistent buffer when active checks exit */
+				if (NULL != CONFIG_PERSISTENT_BUFFER_DIR)
+					threads_flags[i] = ZBX_THREAD_WAIT_EXIT;
+#endif
 				thread_args->args = &CONFIG_ACTIVE_ARGS[j++];
 				zbx_thread_start(active_checks_thread, thread_args, &threads[i]);
 				break;
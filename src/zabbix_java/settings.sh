@@ -42,6 +42,30 @@ PID_FILE="/tmp/zabbix_java.pid"
 # Default:
 # TIMEOUT=3
 
+### Option: zabbix.keepAliveTimeout
+#	How long to keep server connection open waiting for the next request, in seconds.
+#	Zabbix server and proxy Java pollers reuse their connections if it is enabled.
+#	Each open connection occupies a worker thread also while it is idle, until the
+#	next request arrives or this timeout expires. Every Java poller keeps its own
+#	connection, so if the total number of Java pollers (StartJavaPollers) of all
+#	servers and proxies using this gateway is equal to or greater than START_POLLERS,
+#	the remaining pollers cannot be served and their requests time out.
+#	0 - close connection after each request.
+#
+# Mandatory: no
+# Range: 0-3600
+# Default:
+# KEEP_ALIVE_TIMEOUT=0
+
+### Option: zabbix.jmxConnectionIdleTimeout
+#	How long to keep unused JMX connection open for the next request, in seconds.
+#	0 - close JMX connection after each request.
+#
+# Mandatory: no
+# Range: 0-3600
+# Default:
+# JMX_CONNECTION_IDLE_TIMEOUT=0
+
 # uncomment to enable remote monitoring of the standard JMX objects on the Zabbix Java Gateway itself
 #JAVA_OPTIONS="$JAVA_OPTIONS -Dcom.sun.management.jmxremote -Dcom.sun.management.jmxremote.port=12345
 #	-Dcom.sun.management.jmxremote.authenticate=false -Dcom.sun.management.jmxremote.ssl=false"
@@ -21,6 +21,7 @@ package com.zabbix.gateway;
 
 import java.io.*;
 import java.net.Socket;
+import java.net.SocketTimeoutException;
 import java.nio.ByteBuffer;
 import java.nio.ByteOrder;
 import java.nio.charset.Charset;
@@ -47,7 +48,8 @@ class BinaryProtocolSpeaker
 
 	String getRequest() throws IOException, ZabbixException
 	{
-		dis = new DataInputStream(socket.getInputStream());
+		if (null == dis)
+			dis = new DataInputStream(new BufferedInputStream(socket.getInputStream()));
 
 		byte[] data;
 
@@ -80,7 +82,8 @@ class BinaryProtocolSpeaker
 
 	void sendResponse(String response) throws IOException, ZabbixException
 	{
-		bos = new BufferedOutputStream(socket.getOutputStream());
+		if (null == bos)
+			bos = new BufferedOutputStream(socket.getOutputStream());
 
 		logger.debug("sending the following data in response: {}", response);
 
@@ -102,6 +105,40 @@ class BinaryProtocolSpeaker
 		bos.flush();
 	}
 
+	// Waits up to timeout milliseconds for the next request on the same connection. Returns false if the
+	// connection was closed by the other side or no request has arrived in time.
+
+	boolean hasRequest(int timeout) throws IOException
+	{
+		if (null == dis)
+			dis = new DataInputStream(new BufferedInputStream(socket.getInputStream()));
+
+		int soTimeout = socket.getSoTimeout();
+
+		try
+		{
+			socket.setSoTimeout(timeout);
+			dis.mark(1);
+
+			if (-1 == dis.read())
+				return false;
+
+			dis.reset();
+
+			return true;
+		}
+		catch (SocketTimeoutException e)
+		{
+			logger.debug("no request received in {} ms, closing connection", timeout);
+
+			return false;
+		}
+		finally
+		{
+			socket.setSoTimeout(soTimeout);
+		}
+	}
+
 	void close()
 	{
 		try { if (null != dis) dis.close(); } catch (Exception e) { }
@@ -34,6 +34,8 @@ class ConfigurationManager
 	static final String LISTEN_PORT = "listenPort";
 	static final String START_POLLERS = "startPollers";
 	static final String TIMEOUT = "timeout";
+	static final String KEEP_ALIVE_TIMEOUT = "keepAliveTimeout";
+	static final String JMX_CONNECTION_IDLE_TIMEOUT = "jmxConnectionIdleTimeout";
 
 	private static ConfigurationParameter[] parameters =
 	{
@@ -73,6 +75,12 @@ class ConfigurationManager
 				null),
 		new ConfigurationParameter(TIMEOUT, ConfigurationParameter.TYPE_INTEGER, 3,
 				new IntegerValidator(1, 30),
+				null),
+		new ConfigurationParameter(KEEP_ALIVE_TIMEOUT, ConfigurationParameter.TYPE_INTEGER, 0,
+				new IntegerValidator(0, 3600),
+				null),
+		new ConfigurationParameter(JMX_CONNECTION_IDLE_TIMEOUT, ConfigurationParameter.TYPE_INTEGER, 0,
+				new IntegerValidator(0, 3600),
 				null)
 	};
 
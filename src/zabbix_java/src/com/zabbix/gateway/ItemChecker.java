@@ -39,6 +39,8 @@ abstract class ItemChecker
 	static final String JSON_TAG_USERNAME = "username";
 	static final String JSON_TAG_VALUE = "value";
 	static final String JSON_TAG_JMX_ENDPOINT = "jmx_endpoint";
+	static final String JSON_TAG_JMX_ENDPOINTS = "jmx_endpoints";
+	static final String JSON_TAG_TIMEOUT = "timeout";
 
 	static final String JSON_REQUEST_INTERNAL = "java gateway internal";
 	static final String JSON_REQUEST_JMX = "java gateway jmx";
@@ -0,0 +1,212 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+package com.zabbix.gateway;
+
+import java.io.IOException;
+import java.util.HashMap;
+import java.util.concurrent.ConcurrentHashMap;
+
+import javax.management.Notification;
+import javax.management.NotificationListener;
+import javax.management.remote.JMXConnectionNotification;
+import javax.management.remote.JMXConnector;
+import javax.management.remote.JMXServiceURL;
+
+import org.slf4j.Logger;
+import org.slf4j.LoggerFactory;
+
+// Keeps JMX connections open between requests so that polling the same JMX endpoint does not pay for RMI
+// handshake every time. Connections are shared by concurrent requests and closed after they have not been
+// used for jmxConnectionIdleTimeout seconds. Caching is disabled if the timeout is 0.
+
+class JMXConnectionCache
+{
+	private static final Logger logger = LoggerFactory.getLogger(JMXConnectionCache.class);
+
+	private static final long CLEANUP_INTERVAL_MAX = 1000 * 60;
+
+	private static final ConcurrentHashMap<String, Connection> connections = new ConcurrentHashMap<String, Connection>();
+	private static long cleanupTime = System.currentTimeMillis();
+
+	static class Connection
+	{
+		private final String key;
+		private final JMXServiceURL url;
+		private final JMXConnector jmxc;
+		private int users = 0;
+		private boolean closed = false;
+		private long lastAccess;
+
+		private Connection(String key, JMXServiceURL url, JMXConnector jmxc)
+		{
+			this.key = key;
+			this.url = url;
+			this.jmxc = jmxc;
+		}
+
+		JMXConnector getConnector()
+		{
+			return jmxc;
+		}
+
+		private synchronized boolean use()
+		{
+			if (closed)
+				return false;
+
+			users++;
+			lastAccess = System.currentTimeMillis();
+
+			return true;
+		}
+
+		private synchronized boolean release(boolean failed)
+		{
+			users--;
+			lastAccess = System.currentTimeMillis();
+
+			if (null == key || failed)
+				closed = true;
+
+			return closed;
+		}
+
+		private synchronized boolean expire(long now, long idleTimeout)
+		{
+			if (0 == users && now - lastAccess >= idleTimeout)
+				closed = true;
+
+			return closed;
+		}
+
+		private synchronized void invalidate()
+		{
+			closed = true;
+		}
+
+		private void close()
+		{
+			if (null != key)
+				connections.remove(key, this);
+
+			try { jmxc.close(); } catch (Exception e) { }
+		}
+	}
+
+	static Connection acquire(JMXServiceURL url, HashMap<String, String[]> env, String username, String password)
+			throws IOException
+	{
+		long idleTimeout = ConfigurationManager.getIntegerParameterValue(ConfigurationManager.JMX_CONNECTION_IDLE_TIMEOUT) * 1000L;
+
+		if (0 == idleTimeout)
+		{
+			Connection connection = new Connection(null, url, ZabbixJMXConnectorFactory.connect(url, env));
+
+			connection.use();
+
+			return connection;
+		}
+
+		removeIdle(idleTimeout);
+
+		String key = url + "\0" + (null == username ? "" : username) + "\0" + (null == password ? "" : password);
+		Connection connection = connections.get(key);
+
+		if (null != connection && connection.use())
+		{
+			try
+			{
+				// a cheap remote call to make sure that the connection is still alive
+				connection.jmxc.getConnectionId();
+
+				logger.debug("reusing connection to JMX agent at '{}'", url);
+
+				return connection;
+			}
+			catch (IOException e)
+			{
+				logger.debug("cached connection to JMX agent at '{}' is broken: {}", url,
+						ZabbixException.getRootCauseMessage(e));
+
+				release(connection, true);
+			}
+		}
+		else if (null != connection)
+			connection.close();
+
+		final Connection newConnection = new Connection(key, url, ZabbixJMXConnectorFactory.connect(url, env));
+
+		newConnection.use();
+
+		if (null != connections.putIfAbsent(key, newConnection))
+		{
+			// another request has cached a connection to the same endpoint in the meantime
+			Connection uncached = new Connection(null, url, newConnection.jmxc);
+
+			uncached.use();
+
+			return uncached;
+		}
+
+		newConnection.jmxc.addConnectionNotificationListener(new NotificationListener()
+		{
+			@Override
+			public void handleNotification(Notification notification, Object handback)
+			{
+				if (notification.getType().equals(JMXConnectionNotification.FAILED) ||
+						notification.getType().equals(JMXConnectionNotification.CLOSED))
+				{
+					newConnection.invalidate();
+				}
+			}
+		}, null, null);
+
+		return newConnection;
+	}
+
+	static void release(Connection connection, boolean failed)
+	{
+		if (connection.release(failed))
+			connection.close();
+	}
+
+	private static void removeIdle(long idleTimeout)
+	{
+		long now = System.currentTimeMillis();
+
+		synchronized (JMXConnectionCache.class)
+		{
+			if (now < cleanupTime)
+				return;
+
+			cleanupTime = now + Math.min(idleTimeout, CLEANUP_INTERVAL_MAX);
+		}
+
+		for (Connection connection : connections.values())
+		{
+			if (connection.expire(now, idleTimeout))
+			{
+				logger.debug("closing idle connection to JMX agent at '{}'", connection.url);
+
+				connection.close();
+			}
+		}
+	}
+}
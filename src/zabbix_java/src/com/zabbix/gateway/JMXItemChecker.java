@@ -19,9 +19,17 @@
 
 package com.zabbix.gateway;
 
+import java.util.ArrayList;
 import java.util.HashMap;
 import java.util.Map;
 import java.util.HashSet;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
 import javax.management.AttributeList;
 
 import javax.management.InstanceNotFoundException;
@@ -43,8 +51,11 @@ class JMXItemChecker extends ItemChecker
 {
 	private static final Logger logger = LoggerFactory.getLogger(JMXItemChecker.class);
 
+	private static final ExecutorService executor = Executors.newCachedThreadPool(
+			new ZabbixJMXConnectorFactory.DaemonThreadFactory());
+
 	private JMXServiceURL url;
-	private JMXConnector jmxc;
+	private JMXConnectionCache.Connection connection;
 	private MBeanServerConnection mbsc;
 
 	private String username;
@@ -72,7 +83,7 @@ class JMXItemChecker extends ItemChecker
 		try
 		{
 			url = new JMXServiceURL(jmx_endpoint);
-			jmxc = null;
+			connection = null;
 			mbsc = null;
 
 			username = request.optString(JSON_TAG_USERNAME, null);
@@ -88,6 +99,7 @@ class JMXItemChecker extends ItemChecker
 	JSONArray getValues() throws ZabbixException
 	{
 		JSONArray values = new JSONArray();
+		boolean failed = true;
 
 		try
 		{
@@ -99,11 +111,13 @@ class JMXItemChecker extends ItemChecker
 				env.put(JMXConnector.CREDENTIALS, new String[] {username, password});
 			}
 
-			jmxc = ZabbixJMXConnectorFactory.connect(url, env);
-			mbsc = jmxc.getMBeanServerConnection();
+			connection = JMXConnectionCache.acquire(url, env, username, password);
+			mbsc = connection.getConnector().getMBeanServerConnection();
 
 			for (String key : keys)
 				values.put(getJSONValue(key));
+
+			failed = false;
 		}
 		catch (SecurityException e1)
 		{
@@ -132,15 +146,102 @@ class JMXItemChecker extends ItemChecker
 		}
 		finally
 		{
-			try { if (null != jmxc) jmxc.close(); } catch (java.io.IOException exception) { }
+			if (null != connection)
+				JMXConnectionCache.release(connection, failed);
 
-			jmxc = null;
+			connection = null;
 			mbsc = null;
 		}
 
 		return values;
 	}
 
+	// Gets values of multiple JMX endpoints in parallel. The result contains either the values or the error message
+	// for each endpoint in the order of the request, so that failure of one endpoint does not affect the others.
+	// The values are waited for at most timeout milliseconds (if positive) or the configured timeout, whichever is
+	// shorter, so that the response reaches the server before its own timeout expires.
+
+	static JSONArray getEndpointValues(JSONArray endpoints, long timeout) throws ZabbixException
+	{
+		ArrayList<Future<JSONArray>> futures = new ArrayList<Future<JSONArray>>();
+		ArrayList<String> errors = new ArrayList<String>();
+
+		try
+		{
+			for (int i = 0; i < endpoints.length(); i++)
+			{
+				try
+				{
+					final JMXItemChecker checker = new JMXItemChecker(endpoints.getJSONObject(i));
+
+					futures.add(executor.submit(new Callable<JSONArray>()
+					{
+						@Override
+						public JSONArray call() throws ZabbixException
+						{
+							return checker.getValues();
+						}
+					}));
+					errors.add(null);
+				}
+				catch (ZabbixException e)
+				{
+					futures.add(null);
+					errors.add(ZabbixException.getRootCauseMessage(e));
+				}
+			}
+
+			long maxTimeout = ConfigurationManager.getIntegerParameterValue(ConfigurationManager.TIMEOUT) * 1000L;
+			long deadline = System.currentTimeMillis() + (0 < timeout ? Math.min(timeout, maxTimeout) : maxTimeout);
+			JSONArray results = new JSONArray();
+
+			for (int i = 0; i < futures.size(); i++)
+			{
+				JSONObject result = new JSONObject();
+				Future<JSONArray> future = futures.get(i);
+				String error = errors.get(i);
+
+				if (null != future)
+				{
+					try
+					{
+						result.put(JSON_TAG_DATA, future.get(Math.max(deadline - System.currentTimeMillis(), 0),
+								TimeUnit.MILLISECONDS));
+					}
+					catch (TimeoutException e)
+					{
+						future.cancel(true);
+						error = "Timeout while getting values: " + endpoints.getJSONObject(i).optString(JSON_TAG_JMX_ENDPOINT);
+					}
+					catch (ExecutionException e)
+					{
+						error = ZabbixException.getRootCauseMessage(e.getCause());
+					}
+				}
+
+				if (null != error)
+				{
+					logger.warn("error processing request for JMX endpoint: {}", error);
+					result.put(JSON_TAG_ERROR, error);
+				}
+
+				results.put(result);
+			}
+
+			return results;
+		}
+		catch (Exception e)
+		{
+			for (Future<JSONArray> future : futures)
+			{
+				if (null != future)
+					future.cancel(true);
+			}
+
+			throw new ZabbixException(e);
+		}
+	}
+
 	@Override
 	protected String getStringValue(String key) throws Exception
 	{
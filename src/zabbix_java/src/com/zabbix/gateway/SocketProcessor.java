@@ -47,14 +47,44 @@ class SocketProcessor implements Runnable
 	{
 		logger.debug("starting to process incoming connection");
 
-		BinaryProtocolSpeaker speaker = null;
+		BinaryProtocolSpeaker speaker = new BinaryProtocolSpeaker(socket);
+
+		try
+		{
+			int keepAliveTimeout = ConfigurationManager.getIntegerParameterValue(ConfigurationManager.KEEP_ALIVE_TIMEOUT);
+
+			// with keep-alive enabled the server sends further requests over the same connection
+			while (processRequest(speaker) && 0 != keepAliveTimeout && speaker.hasRequest(keepAliveTimeout * 1000))
+				logger.debug("processing next request on the same connection");
+		}
+		catch (Exception e)
+		{
+			logger.debug("error waiting for next request: {}", ZabbixException.getRootCauseMessage(e));
+		}
+		finally
+		{
+			try { speaker.close(); } catch (Exception e) { }
+			try { if (null != socket) socket.close(); } catch (Exception e) { }
+		}
+
+		logger.debug("finished processing incoming connection");
+	}
+
+	// Returns true if the response was sent and the connection can be used for the next request.
+
+	private boolean processRequest(BinaryProtocolSpeaker speaker)
+	{
 		ItemChecker checker = null;
+		boolean received = false;
 
 		try
 		{
-			speaker = new BinaryProtocolSpeaker(socket);
+			String text = speaker.getRequest();
+			JSONArray values;
 
-			JSONObject request = new JSONObject(speaker.getRequest());
+			received = true;
+
+			JSONObject request = new JSONObject(text);
 
 			if (request.getString(ItemChecker.JSON_TAG_REQUEST).equals(ItemChecker.JSON_REQUEST_INTERNAL))
 			{
@@ -62,7 +92,8 @@ class SocketProcessor implements Runnable
 			}
 			else if (request.getString(ItemChecker.JSON_TAG_REQUEST).equals(ItemChecker.JSON_REQUEST_JMX))
 			{
-				checker = new JMXItemChecker(request);
+				if (!request.has(ItemChecker.JSON_TAG_JMX_ENDPOINTS))
+					checker = new JMXItemChecker(request);
 
 				long now = System.currentTimeMillis();
 
@@ -75,14 +106,25 @@ class SocketProcessor implements Runnable
 			else
 				throw new ZabbixException("bad request tag value: '%s'", request.getString(ItemChecker.JSON_TAG_REQUEST));
 
-			logger.debug("dispatched request to class {}", checker.getClass().getName());
-			JSONArray values = checker.getValues();
+			if (null != checker)
+			{
+				logger.debug("dispatched request to class {}", checker.getClass().getName());
+				values = checker.getValues();
+			}
+			else
+			{
+				logger.debug("dispatched request to multiple JMX endpoints");
+				values = JMXItemChecker.getEndpointValues(request.getJSONArray(ItemChecker.JSON_TAG_JMX_ENDPOINTS),
+						request.optLong(ItemChecker.JSON_TAG_TIMEOUT, 0));
+			}
 
 			JSONObject response = new JSONObject();
 			response.put(ItemChecker.JSON_TAG_RESPONSE, ItemChecker.JSON_RESPONSE_SUCCESS);
 			response.put(ItemChecker.JSON_TAG_DATA, values);
 
 			speaker.sendResponse(response.toString());
+
+			return true;
 		}
 		catch (Exception e1)
 		{
@@ -103,6 +145,8 @@ class SocketProcessor implements Runnable
 				response.put(ItemChecker.JSON_TAG_ERROR, error);
 
 				speaker.sendResponse(response.toString());
+
+				return received;
 			}
 			catch (Exception e2)
 			{
@@ -110,13 +154,8 @@ class SocketProcessor implements Runnable
 				logger.debug("error caused by", e2);
 			}
 		}
-		finally
-		{
-			try { if (null != speaker) speaker.close(); } catch (Exception e) { }
-			try { if (null != socket) socket.close(); } catch (Exception e) { }
-		}
 
-		logger.debug("finished processing incoming connection");
+		return false;
 	}
 
 	private void cleanDiscoveredObjects(long now)
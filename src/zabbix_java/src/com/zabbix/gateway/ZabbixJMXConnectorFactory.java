@@ -43,7 +43,7 @@ class ZabbixJMXConnectorFactory
 
 	private static final ExecutorService executor = Executors.newCachedThreadPool(new DaemonThreadFactory());
 
-	private static class DaemonThreadFactory implements ThreadFactory
+	static class DaemonThreadFactory implements ThreadFactory
 	{
 		private ThreadFactory f = Executors.defaultThreadFactory();
 
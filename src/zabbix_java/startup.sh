@@ -40,6 +40,12 @@ fi
 if [ -n "$TIMEOUT" ]; then
 	ZABBIX_OPTIONS="$ZABBIX_OPTIONS -Dzabbix.timeout=$TIMEOUT"
 fi
+if [ -n "$KEEP_ALIVE_TIMEOUT" ]; then
+	ZABBIX_OPTIONS="$ZABBIX_OPTIONS -Dzabbix.keepAliveTimeout=$KEEP_ALIVE_TIMEOUT"
+fi
+if [ -n "$JMX_CONNECTION_IDLE_TIMEOUT" ]; then
+	ZABBIX_OPTIONS="$ZABBIX_OPTIONS -Dzabbix.jmxConnectionIdleTimeout=$JMX_CONNECTION_IDLE_TIMEOUT"
+fi
 
 tcp_timeout=${TIMEOUT:=3}000
 ZABBIX_OPTIONS="$ZABBIX_OPTIONS -Dsun.rmi.transport.tcp.responseTimeout=$tcp_timeout"
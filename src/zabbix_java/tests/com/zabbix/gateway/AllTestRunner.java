@@ -25,7 +25,9 @@ public class AllTestRunner
 	{
 		String[] testClasses = new String[]
 		{
+			"BinaryProtocolSpeakerTest",
 			"IntegerValidatorTest",
+			"JMXItemCheckerTest",
 			"ZabbixItemTest"
 		};
 
@@ -0,0 +1,80 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+package com.zabbix.gateway;
+
+import java.io.OutputStream;
+import java.net.InetAddress;
+import java.net.ServerSocket;
+import java.net.Socket;
+
+import org.junit.*;
+import static org.junit.Assert.*;
+
+public class BinaryProtocolSpeakerTest
+{
+	private ServerSocket listener;
+	private Socket client;
+	private Socket server;
+
+	@Before
+	public void connect() throws Exception
+	{
+		listener = new ServerSocket(0, 1, InetAddress.getByName("127.0.0.1"));
+		client = new Socket(listener.getInetAddress(), listener.getLocalPort());
+		server = listener.accept();
+	}
+
+	@After
+	public void close() throws Exception
+	{
+		client.close();
+		server.close();
+		listener.close();
+	}
+
+	@Test
+	public void testNoRequestInTime() throws Exception
+	{
+		assertFalse(new BinaryProtocolSpeaker(server).hasRequest(100));
+	}
+
+	@Test
+	public void testNextRequest() throws Exception
+	{
+		BinaryProtocolSpeaker speaker = new BinaryProtocolSpeaker(server);
+		OutputStream os = client.getOutputStream();
+
+		os.write('Z');
+		os.flush();
+
+		assertTrue(speaker.hasRequest(1000));
+
+		// the peeked byte is left for the request
+		assertTrue(speaker.hasRequest(1000));
+	}
+
+	@Test
+	public void testConnectionClosed() throws Exception
+	{
+		client.shutdownOutput();
+
+		assertFalse(new BinaryProtocolSpeaker(server).hasRequest(1000));
+	}
+}
@@ -0,0 +1,67 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+package com.zabbix.gateway;
+
+import org.json.*;
+import org.junit.*;
+import static org.junit.Assert.*;
+
+public class JMXItemCheckerTest
+{
+	private static JSONObject createEndpoint(String jmxEndpoint) throws JSONException
+	{
+		JSONObject endpoint = new JSONObject();
+
+		if (null != jmxEndpoint)
+			endpoint.put(ItemChecker.JSON_TAG_JMX_ENDPOINT, jmxEndpoint);
+
+		endpoint.put(ItemChecker.JSON_TAG_KEYS, new JSONArray().put("jmx[java.lang:type=Runtime,Uptime]"));
+
+		return endpoint;
+	}
+
+	@Test
+	public void testEndpointFailuresAreReportedSeparately() throws Exception
+	{
+		JSONArray endpoints = new JSONArray();
+
+		endpoints.put(createEndpoint("invalid endpoint"));
+		endpoints.put(createEndpoint(null));
+		endpoints.put(createEndpoint("service:jmx:rmi:///jndi/rmi://127.0.0.1:1/jmxrmi"));
+
+		JSONArray results = JMXItemChecker.getEndpointValues(endpoints, 0);
+
+		assertEquals(endpoints.length(), results.length());
+
+		for (int i = 0; i < results.length(); i++)
+		{
+			JSONObject result = results.getJSONObject(i);
+
+			assertTrue(result.has(ItemChecker.JSON_TAG_ERROR));
+			assertFalse(result.has(ItemChecker.JSON_TAG_DATA));
+		}
+	}
+
+	@Test
+	public void testNoEndpoints() throws Exception
+	{
+		assertEquals(0, JMXItemChecker.getEndpointValues(new JSONArray(), 0).length());
+	}
+}
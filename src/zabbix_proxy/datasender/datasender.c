@@ -44,10 +44,431 @@ extern int		server_num, process_num;
 #define ZBX_DATASENDER_TASKS_RECV		0x0020
 #define ZBX_DATASENDER_TASKS_REQUEST		0x8000
 
+#define ZBX_DATASENDER_PART_SENT	1
+
 #define ZBX_DATASENDER_DB_UPDATE	(ZBX_DATASENDER_HISTORY | ZBX_DATASENDER_DISCOVERY |		\
 					ZBX_DATASENDER_AUTOREGISTRATION | ZBX_DATASENDER_TASKS |	\
 					ZBX_DATASENDER_TASKS_RECV)
 
+/* additional connection used to send a part of large history backlog or the older history records by backfill */
+/* lane in parallel with the main request                                                                       */
+typedef struct
+{
+	char		*session_token;
+	zbx_socket_t	sock;
+	struct zbx_json	j;
+	size_t		header_size;
+	int		state;
+}
+zbx_datasender_part_t;
+
+static zbx_datasender_part_t	*parts = NULL;
+static struct zbx_json		**parts_jsons = NULL;
+
+/* the id of last history record accepted by server for each request of split history, the first is the main */
+/* request - the records of items assigned to a request are not resent after the request is acknowledged     */
+static zbx_uint64_t		*parts_lastids = NULL;
+
+static zbx_datasender_part_t	backfill;
+static double			backfill_budget = 0;
+static zbx_proxy_hist_lanes_t	hist_lanes;
+
+/******************************************************************************
+ *                                                                            *
+ * Function: datasender_get_hist_data                                         *
+ *                                                                            *
+ * Purpose: get history data to be sent by fresh data lane                    *
+ *                                                                            *
+ * Parameters: j            - [IN/OUT] the main request                       *
+ *             parts_num    - [OUT] the number of additional requests holding *
+ *                                  parts of history data                     *
+ *             fresh_lastid - [OUT] the id of last history record sent by     *
+ *                                  fresh data lane before this request       *
+ *             lastid       - [OUT] the id of last added history record       *
+ *             more         - [OUT] set to ZBX_PROXY_DATA_MORE if there is    *
+ *                                  more history data                         *
+ *                                                                            *
+ * Comments: Without backfill lane all history is sent in a single stream.    *
+ *           Otherwise when the history backlog becomes too large the older   *
+ *           records are left to backfill lane so the newest values are sent  *
+ *           first. Fresh data lane always continues after the records it has *
+ *           already sent, also when backfill lane is disabled while backlog  *
+ *           is still pending.                                                *
+ *           A large history backlog is split by items between the main and   *
+ *           additional requests, so the server can process it by several     *
+ *           processes in parallel while the values of each item are still    *
+ *           processed in order. While only some of the requests are          *
+ *           acknowledged the backlog is split in the same way and the        *
+ *           records already accepted by server are skipped. The              *
+ *           acknowledgements are kept in memory, after restart the whole     *
+ *           range is sent again.                                             *
+ *           Passive proxy is not covered - it returns history in a single    *
+ *           response to server request.                                      *
+ *                                                                            *
+ ******************************************************************************/
+static int	datasender_get_hist_data(struct zbx_json *j, int *parts_num, zbx_uint64_t *fresh_lastid,
+		zbx_uint64_t *lastid, int *more)
+{
+	zbx_uint64_t	maxid;
+	int		i, partial = FAIL;
+
+	proxy_get_hist_lanes(&hist_lanes);
+	*fresh_lastid = hist_lanes.fresh_lastid;
+	maxid = proxy_get_hist_maxid();
+
+	for (i = 0; i < CONFIG_PROXYDATA_CONNECTIONS; i++)
+	{
+		if (parts_lastids[i] > *fresh_lastid)
+			partial = SUCCEED;
+	}
+
+	/* partially acknowledged backlog is not left to backfill lane, it would resend the accepted records */
+	if (SUCCEED != partial && 0 != CONFIG_PROXYDATA_BACKFILL_RATE &&
+			SUCCEED == proxy_hist_lanes_skip(&hist_lanes, maxid))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "sending newest history values first, " ZBX_FS_UI64 " older values will"
+				" be sent in parallel at %d values per second", hist_lanes.fresh_lastid - *fresh_lastid,
+				CONFIG_PROXYDATA_BACKFILL_RATE);
+
+		*fresh_lastid = hist_lanes.fresh_lastid;
+
+		DBbegin();
+		proxy_set_hist_lanes(&hist_lanes);
+		DBcommit();
+	}
+
+	for (i = 0; i < CONFIG_PROXYDATA_CONNECTIONS; i++)
+	{
+		if (parts_lastids[i] < *fresh_lastid)
+			parts_lastids[i] = *fresh_lastid;
+	}
+
+	parts_jsons[0] = j;
+	*parts_num = 0;
+
+	/* the backlog is split only when there is more data than a single request can hold */
+	if (1 < CONFIG_PROXYDATA_CONNECTIONS && (SUCCEED == partial || maxid > *fresh_lastid + ZBX_MAX_HRECORDS_TOTAL))
+	{
+		for (i = 0; i < CONFIG_PROXYDATA_CONNECTIONS - 1; i++)
+		{
+			zbx_json_init(&parts[i].j, 16 * ZBX_KIBIBYTE);
+			zbx_json_addstring(&parts[i].j, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_PROXY_DATA,
+					ZBX_JSON_TYPE_STRING);
+			zbx_json_addstring(&parts[i].j, ZBX_PROTO_TAG_HOST, CONFIG_HOSTNAME, ZBX_JSON_TYPE_STRING);
+			zbx_json_addstring(&parts[i].j, ZBX_PROTO_TAG_SESSION, parts[i].session_token,
+					ZBX_JSON_TYPE_STRING);
+			parts[i].header_size = parts[i].j.buffer_offset;
+			parts[i].state = FAIL;
+			parts_jsons[i + 1] = &parts[i].j;
+		}
+
+		*parts_num = CONFIG_PROXYDATA_CONNECTIONS - 1;
+	}
+
+	return proxy_get_hist_data_range(parts_jsons, *parts_num + 1, parts_lastids, *fresh_lastid, 0,
+			ZBX_MAX_HRECORDS_TOTAL * (*parts_num + 1), lastid, more);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: datasender_parts_send                                            *
+ *                                                                            *
+ * Purpose: send the additional requests holding parts of history data        *
+ *          without waiting for the responses                                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	datasender_parts_send(int parts_num)
+{
+	int			i;
+	char			*error = NULL;
+	zbx_timespec_t		ts;
+	zbx_datasender_part_t	*part;
+
+	for (i = 0; i < parts_num; i++)
+	{
+		part = &parts[i];
+
+		/* nothing to send if none of the history records went to this part */
+		if (part->header_size == part->j.buffer_offset)
+		{
+			part->state = SUCCEED;
+			continue;
+		}
+
+		zbx_json_addstring(&part->j, ZBX_PROTO_TAG_VERSION, ZABBIX_VERSION, ZBX_JSON_TYPE_STRING);
+
+		if (FAIL == connect_to_server(&part->sock, 600, 0))
+			continue;
+
+		zbx_timespec(&ts);
+		zbx_json_adduint64(&part->j, ZBX_PROTO_TAG_CLOCK, ts.sec);
+		zbx_json_adduint64(&part->j, ZBX_PROTO_TAG_NS, ts.ns);
+
+		if (SUCCEED != send_data_to_server(&part->sock, &part->j, &error))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot send proxy data to server at \"%s\": %s",
+					part->sock.peer, error);
+			zbx_free(error);
+			disconnect_server(&part->sock);
+			continue;
+		}
+
+		part->state = ZBX_DATASENDER_PART_SENT;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: datasender_parts_recv                                            *
+ *                                                                            *
+ * Purpose: receive server responses for the additional requests, acknowledge *
+ *          the accepted requests and release their resources                 *
+ *                                                                            *
+ * Parameters: parts_num - [IN] the number of additional requests             *
+ *             lastid    - [IN] the id of last history record in the requests *
+ *                                                                            *
+ ******************************************************************************/
+static void	datasender_parts_recv(int parts_num, zbx_uint64_t lastid)
+{
+	int			i;
+	char			*error = NULL;
+	zbx_datasender_part_t	*part;
+
+	for (i = 0; i < parts_num; i++)
+	{
+		part = &parts[i];
+
+		if (ZBX_DATASENDER_PART_SENT == part->state)
+		{
+			if (SUCCEED != (part->state = zbx_recv_response(&part->sock, 0, &error)))
+			{
+				zabbix_log(LOG_LEVEL_WARNING, "cannot send proxy data to server at \"%s\": %s",
+						part->sock.peer, error);
+				zbx_free(error);
+			}
+
+			disconnect_server(&part->sock);
+		}
+
+		if (SUCCEED == part->state)
+			parts_lastids[i + 1] = lastid;
+
+		zbx_json_free(&part->j);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: datasender_get_hist_acked                                        *
+ *                                                                            *
+ * Purpose: get the id of last history record accepted by server in all       *
+ *          requests of split history                                         *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_uint64_t	datasender_get_hist_acked(int parts_num)
+{
+	zbx_uint64_t	lastid = parts_lastids[0];
+	int		i;
+
+	for (i = 1; i <= parts_num; i++)
+	{
+		if (lastid > parts_lastids[i])
+			lastid = parts_lastids[i];
+	}
+
+	return lastid;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: datasender_set_hist_lastid                                       *
+ *                                                                            *
+ * Purpose: update the id of last history record acknowledged by server for   *
+ *          fresh data lane                                                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	datasender_set_hist_lastid(zbx_uint64_t lastid)
+{
+	proxy_get_hist_lanes(&hist_lanes);
+	proxy_hist_lanes_fresh_sent(&hist_lanes, lastid);
+
+	/* without pending backlog the lane positions are reset to history_lastid when read */
+	if (0 == hist_lanes.backlogs.values_num)
+		proxy_set_hist_lastid(lastid);
+	else
+		proxy_set_hist_lanes(&hist_lanes);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: datasender_backfill_send                                         *
+ *                                                                            *
+ * Purpose: send older history records by backfill lane without waiting for   *
+ *          the response                                                      *
+ *                                                                            *
+ * Parameters: lastid - [OUT] the id of last sent record                      *
+ *             more   - [OUT] set to ZBX_PROXY_DATA_MORE if the backlog range *
+ *                            might have more records                         *
+ *                                                                            *
+ * Return value: The number of sent records.                                  *
+ *                                                                            *
+ * Comments: Backfill lane runs concurrently with fresh data lane - in every  *
+ *           data sender cycle its request is sent over its own connection    *
+ *           before the main request and the response is received after the   *
+ *           main request is processed. The configured rate is the share of   *
+ *           backfill lane that fresh data lane cannot take over, so the      *
+ *           backlog is drained also while newer values keep arriving. When   *
+ *           backfill lane is disabled the pending backlog is sent without    *
+ *           rate limit.                                                      *
+ *           The oldest backlog range is sent first. The server receives      *
+ *           backlog values after or together with the newer values of the    *
+ *           same items. Backfill lane uses its own data session so the       *
+ *           server does not discard its values as duplicates of the newer    *
+ *           values received by fresh data lane.                              *
+ *                                                                            *
+ ******************************************************************************/
+static int	datasender_backfill_send(zbx_uint64_t *lastid, int *more)
+{
+	static double	budget_time = 0;
+
+	const zbx_uint64_pair_t	*range;
+	struct zbx_json		*pj = &backfill.j;
+	int			records, records_max = ZBX_MAX_HRECORDS_TOTAL;
+	double			now;
+	char			*error = NULL;
+	zbx_timespec_t		ts;
+
+	backfill.state = FAIL;
+	*lastid = 0;
+
+	proxy_get_hist_lanes(&hist_lanes);
+
+	if (0 == hist_lanes.backlogs.values_num)
+	{
+		budget_time = 0;
+		return 0;
+	}
+
+	if (0 != CONFIG_PROXYDATA_BACKFILL_RATE)
+	{
+		now = zbx_time();
+
+		if (0 != budget_time)
+			backfill_budget += (now - budget_time) * CONFIG_PROXYDATA_BACKFILL_RATE;
+		else
+			backfill_budget = CONFIG_PROXYDATA_BACKFILL_RATE;
+
+		budget_time = now;
+
+		if (ZBX_MAX_HRECORDS_TOTAL < backfill_budget)
+			backfill_budget = ZBX_MAX_HRECORDS_TOTAL;
+
+		if (1 > backfill_budget)
+			return 0;
+
+		records_max = (int)backfill_budget;
+	}
+
+	range = &hist_lanes.backlogs.values[0];
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() lastid:" ZBX_FS_UI64 " maxid:" ZBX_FS_UI64 " backlogs:%d", __func__,
+			range->first, range->second, hist_lanes.backlogs.values_num);
+
+	zbx_json_init(&backfill.j, 16 * ZBX_KIBIBYTE);
+
+	zbx_json_addstring(&backfill.j, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_PROXY_DATA, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(&backfill.j, ZBX_PROTO_TAG_HOST, CONFIG_HOSTNAME, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(&backfill.j, ZBX_PROTO_TAG_SESSION, backfill.session_token, ZBX_JSON_TYPE_STRING);
+
+	/* the range without records to send is acknowledged without request */
+	if (0 == (records = proxy_get_hist_data_range(&pj, 1, NULL, range->first, range->second, records_max,
+			lastid, more)))
+	{
+		backfill.state = SUCCEED;
+		goto out;
+	}
+
+	if (ZBX_PROXY_DATA_MORE == *more)
+		zbx_json_adduint64(&backfill.j, ZBX_PROTO_TAG_MORE, ZBX_PROXY_DATA_MORE);
+
+	zbx_json_addstring(&backfill.j, ZBX_PROTO_TAG_VERSION, ZABBIX_VERSION, ZBX_JSON_TYPE_STRING);
+
+	if (FAIL == connect_to_server(&backfill.sock, 600, 0))
+		goto out;
+
+	zbx_timespec(&ts);
+	zbx_json_adduint64(&backfill.j, ZBX_PROTO_TAG_CLOCK, ts.sec);
+	zbx_json_adduint64(&backfill.j, ZBX_PROTO_TAG_NS, ts.ns);
+
+	if (SUCCEED != send_data_to_server(&backfill.sock, &backfill.j, &error))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot send backfill history data to server at \"%s\": %s",
+				backfill.sock.peer, error);
+		zbx_free(error);
+		disconnect_server(&backfill.sock);
+		goto out;
+	}
+
+	backfill.state = ZBX_DATASENDER_PART_SENT;
+out:
+	zbx_json_free(&backfill.j);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() records:%d", __func__, records);
+
+	return records;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: datasender_backfill_recv                                         *
+ *                                                                            *
+ * Purpose: receive server response for backfill lane request and update      *
+ *          backfill lane position                                            *
+ *                                                                            *
+ * Parameters: records      - [IN] the number of sent records                 *
+ *             lastid       - [IN] the id of last sent record                 *
+ *             more_backlog - [IN] ZBX_PROXY_DATA_MORE if the backlog range   *
+ *                                 might have more records                    *
+ *             more         - [OUT] set to ZBX_PROXY_DATA_MORE if backlog     *
+ *                                  must be sent without delay                *
+ *                                                                            *
+ * Return value: The number of records accepted by server.                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	datasender_backfill_recv(int records, zbx_uint64_t lastid, int more_backlog, int *more)
+{
+	char	*error = NULL;
+
+	if (ZBX_DATASENDER_PART_SENT == backfill.state)
+	{
+		if (SUCCEED != (backfill.state = zbx_recv_response(&backfill.sock, 0, &error)))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot send backfill history data to server at \"%s\": %s",
+					backfill.sock.peer, error);
+			zbx_free(error);
+		}
+
+		disconnect_server(&backfill.sock);
+	}
+
+	if (SUCCEED != backfill.state)
+		return 0;
+
+	if (0 != CONFIG_PROXYDATA_BACKFILL_RATE)
+		backfill_budget -= records;
+
+	DBbegin();
+	proxy_get_hist_lanes(&hist_lanes);
+	proxy_hist_lanes_backfill_sent(&hist_lanes, lastid, more_backlog);
+	proxy_set_hist_lanes(&hist_lanes);
+	DBcommit();
+
+	if (0 == CONFIG_PROXYDATA_BACKFILL_RATE && ZBX_PROXY_DATA_MORE == more_backlog)
+		*more = ZBX_PROXY_DATA_MORE;
+
+	return records;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: proxy_data_sender                                                *
@@ -64,8 +485,10 @@ static int	proxy_data_sender(int *more, int now)
 	struct zbx_json		j;
 	struct zbx_json_parse	jp, jp_tasks;
 	int			availability_ts, history_records = 0, discovery_records = 0,
-				areg_records = 0, more_history = 0, more_discovery = 0, more_areg = 0;
-	zbx_uint64_t		history_lastid = 0, discovery_lastid = 0, areg_lastid = 0, flags = 0;
+				areg_records = 0, more_history = 0, more_discovery = 0, more_areg = 0,
+				backfill_records = 0, more_backlog = 0, parts_num = 0;
+	zbx_uint64_t		history_lastid = 0, discovery_lastid = 0, areg_lastid = 0, flags = 0,
+				fresh_lastid = 0, acked_lastid = 0, backlog_lastid = 0;
 	zbx_timespec_t		ts;
 	char			*error = NULL;
 	zbx_vector_ptr_t	tasks;
@@ -84,7 +507,8 @@ static int	proxy_data_sender(int *more, int now)
 		if (SUCCEED == get_host_availability_data(&j, &availability_ts))
 			flags |= ZBX_DATASENDER_AVAILABILITY;
 
-		history_records = proxy_get_hist_data(&j, &history_lastid, &more_history);
+		history_records = datasender_get_hist_data(&j, &parts_num, &fresh_lastid, &history_lastid,
+				&more_history);
 		if (0 != history_lastid)
 			flags |= ZBX_DATASENDER_HISTORY;
 
@@ -123,6 +547,10 @@ static int	proxy_data_sender(int *more, int now)
 	if (SUCCEED != upload_state)
 		flags |= ZBX_DATASENDER_TASKS_REQUEST;
 
+	/* older values are sent in every cycle in parallel with the main request so they are not starved */
+	if (SUCCEED == upload_state)
+		backfill_records = datasender_backfill_send(&backlog_lastid, &more_backlog);
+
 	if (0 != flags)
 	{
 		if (ZBX_PROXY_DATA_MORE == more_history || ZBX_PROXY_DATA_MORE == more_discovery ||
@@ -138,6 +566,8 @@ static int	proxy_data_sender(int *more, int now)
 		if (FAIL == connect_to_server(&sock, 600, CONFIG_PROXYDATA_FREQUENCY))
 			goto clean;
 
+		datasender_parts_send(parts_num);
+
 		zbx_timespec(&ts);
 		zbx_json_adduint64(&j, ZBX_PROTO_TAG_CLOCK, ts.sec);
 		zbx_json_adduint64(&j, ZBX_PROTO_TAG_NS, ts.ns);
@@ -160,6 +590,23 @@ static int	proxy_data_sender(int *more, int now)
 					flags |= ZBX_DATASENDER_TASKS_RECV;
 			}
 
+			datasender_parts_recv(parts_num, history_lastid);
+
+			/* each request acknowledges the records of its own items, the history lane position */
+			/* is advanced up to the records accepted in all requests                             */
+			if (0 != (flags & ZBX_DATASENDER_HISTORY))
+			{
+				parts_lastids[0] = history_lastid;
+
+				if (fresh_lastid == (acked_lastid = datasender_get_hist_acked(parts_num)))
+					flags &= ~(zbx_uint64_t)ZBX_DATASENDER_HISTORY;
+
+				if (acked_lastid != history_lastid)
+					*more = ZBX_PROXY_DATA_DONE;
+			}
+
+			parts_num = 0;
+
 			if (0 != (flags & ZBX_DATASENDER_DB_UPDATE))
 			{
 				DBbegin();
@@ -177,7 +624,7 @@ static int	proxy_data_sender(int *more, int now)
 				}
 
 				if (0 != (flags & ZBX_DATASENDER_HISTORY))
-					proxy_set_hist_lastid(history_lastid);
+					datasender_set_hist_lastid(acked_lastid);
 
 				if (0 != (flags & ZBX_DATASENDER_DISCOVERY))
 					proxy_set_dhis_lastid(discovery_lastid);
@@ -192,6 +639,21 @@ static int	proxy_data_sender(int *more, int now)
 		disconnect_server(&sock);
 	}
 clean:
+	/* the additional requests accepted by server are acknowledged also when the main request failed */
+	if (0 != parts_num)
+	{
+		datasender_parts_recv(parts_num, history_lastid);
+
+		if (fresh_lastid != (acked_lastid = datasender_get_hist_acked(parts_num)))
+		{
+			DBbegin();
+			datasender_set_hist_lastid(acked_lastid);
+			DBcommit();
+		}
+	}
+
+	backfill_records = datasender_backfill_recv(backfill_records, backlog_lastid, more_backlog, more);
+
 	zbx_vector_ptr_clear_ext(&tasks, (zbx_clean_func_t)zbx_tm_task_free);
 	zbx_vector_ptr_destroy(&tasks);
 
@@ -200,7 +662,7 @@ clean:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s more:%d flags:0x" ZBX_FS_UX64, __func__,
 			zbx_result_string(upload_state), *more, flags);
 
-	return history_records + discovery_records + areg_records;
+	return history_records + discovery_records + areg_records + backfill_records;
 }
 
 /******************************************************************************
@@ -231,6 +693,23 @@ ZBX_THREAD_ENTRY(datasender_thread, args)
 
 	DBconnect(ZBX_DB_CONNECT_NORMAL);
 
+	backfill.session_token = zbx_create_token(0);
+	proxy_hist_lanes_init(&hist_lanes);
+
+	parts_jsons = (struct zbx_json **)zbx_malloc(NULL, sizeof(struct zbx_json *) * CONFIG_PROXYDATA_CONNECTIONS);
+	parts_lastids = (zbx_uint64_t *)zbx_calloc(NULL, CONFIG_PROXYDATA_CONNECTIONS, sizeof(zbx_uint64_t));
+
+	if (1 < CONFIG_PROXYDATA_CONNECTIONS)
+	{
+		int	i;
+
+		parts = (zbx_datasender_part_t *)zbx_malloc(NULL, sizeof(zbx_datasender_part_t) *
+				(CONFIG_PROXYDATA_CONNECTIONS - 1));
+
+		for (i = 0; i < CONFIG_PROXYDATA_CONNECTIONS - 1; i++)
+			parts[i].session_token = zbx_create_token(i + 1);
+	}
+
 	while (ZBX_IS_RUNNING())
 	{
 		time_now = zbx_time();
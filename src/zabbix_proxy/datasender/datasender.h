@@ -23,6 +23,8 @@
 #include "threads.h"
 
 extern int	CONFIG_PROXYDATA_FREQUENCY;
+extern int	CONFIG_PROXYDATA_BACKFILL_RATE;
+extern int	CONFIG_PROXYDATA_CONNECTIONS;
 
 ZBX_THREAD_ENTRY(datasender_thread, args);
 
@@ -56,6 +56,7 @@
 #include "setproctitle.h"
 #include "zbxcrypto.h"
 #include "zbxipcservice.h"
+#include "zbxdiag.h"
 #include "../zabbix_server/preprocessor/preproc_manager.h"
 #include "../zabbix_server/preprocessor/preproc_worker.h"
 
@@ -94,6 +95,10 @@ const char	*help_message[] = {
 	"      " ZBX_LOG_LEVEL_DECREASE "=target  Decrease log level, affects all processes if",
 	"                                 target is not specified",
 	"      " ZBX_SNMP_CACHE_RELOAD "          Reload SNMP cache",
+	"      " ZBX_DIAGINFO "=section,N         Print diagnostic information, affects all",
+	"                                 sections if section is not specified",
+	"                                 (historycache, preprocessing, vmware),",
+	"                                 N - number of top items (default 25)",
 	"",
 	"      Log level control targets:",
 	"        process-type             All processes of specified type",
@@ -191,6 +196,8 @@ int	CONFIG_HEARTBEAT_FREQUENCY	= 60;
 
 int	CONFIG_PROXYCONFIG_FREQUENCY	= SEC_PER_HOUR;
 int	CONFIG_PROXYDATA_FREQUENCY	= 1;
+int	CONFIG_PROXYDATA_BACKFILL_RATE	= 0;
+int	CONFIG_PROXYDATA_CONNECTIONS	= 1;
 
 int	CONFIG_HISTSYNCER_FORKS		= 4;
 int	CONFIG_HISTSYNCER_FREQUENCY	= 1;
@@ -239,11 +246,16 @@ char	*CONFIG_SNMPTRAP_FILE		= NULL;
 
 char	*CONFIG_JAVA_GATEWAY		= NULL;
 int	CONFIG_JAVA_GATEWAY_PORT	= ZBX_DEFAULT_GATEWAY_PORT;
+int	CONFIG_JAVA_GATEWAY_MULTI_ENDPOINT	= 0;
 
 char	*CONFIG_SSH_KEY_LOCATION	= NULL;
 
 int	CONFIG_LOG_SLOW_QUERIES		= 0;	/* ms; 0 - disable */
 
+int	CONFIG_LOCK_STATISTICS		= 0;
+int	CONFIG_LATENCY_SAMPLE_RATE	= 0;	/* 0 - disable */
+int	CONFIG_METRICS_LISTEN_PORT	= 0;	/* 0 - disable */
+
 /* zabbix server startup time */
 int	CONFIG_SERVER_STARTUP_TIME	= 0;
 
@@ -647,6 +659,8 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"JavaGatewayPort",		&CONFIG_JAVA_GATEWAY_PORT,		TYPE_INT,
 			PARM_OPT,	1024,			32767},
+		{"JavaGatewayMultiEndpoint",	&CONFIG_JAVA_GATEWAY_MULTI_ENDPOINT,	TYPE_INT,
+			PARM_OPT,	0,			1},
 		{"SNMPTrapperFile",		&CONFIG_SNMPTRAP_FILE,			TYPE_STRING,
 			PARM_OPT,	0,			0},
 		{"StartSNMPTrapper",		&CONFIG_SNMPTRAPPER_FORKS,		TYPE_INT,
@@ -669,6 +683,10 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	1,			SEC_PER_WEEK},
 		{"DataSenderFrequency",		&CONFIG_PROXYDATA_FREQUENCY,		TYPE_INT,
 			PARM_OPT,	1,			SEC_PER_HOUR},
+		{"DataSenderBackfillRate",	&CONFIG_PROXYDATA_BACKFILL_RATE,	TYPE_INT,
+			PARM_OPT,	0,			ZBX_MAX_HRECORDS_TOTAL},
+		{"DataSenderConnections",	&CONFIG_PROXYDATA_CONNECTIONS,		TYPE_INT,
+			PARM_OPT,	1,			16},
 		{"TmpDir",			&CONFIG_TMPDIR,				TYPE_STRING,
 			PARM_OPT,	0,			0},
 		{"FpingLocation",		&CONFIG_FPING_LOCATION,			TYPE_STRING,
@@ -721,6 +739,12 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"LogSlowQueries",		&CONFIG_LOG_SLOW_QUERIES,		TYPE_INT,
 			PARM_OPT,	0,			3600000},
+		{"LockStatistics",		&CONFIG_LOCK_STATISTICS,		TYPE_INT,
+			PARM_OPT,	0,			1},
+		{"LatencySampleRate",		&CONFIG_LATENCY_SAMPLE_RATE,		TYPE_INT,
+			PARM_OPT,	0,			1000000},
+		{"MetricsListenPort",		&CONFIG_METRICS_LISTEN_PORT,		TYPE_INT,
+			PARM_OPT,	0,			65535},
 		{"LoadModulePath",		&CONFIG_LOAD_MODULE_PATH,		TYPE_STRING,
 			PARM_OPT,	0,			0},
 		{"LoadModule",			&CONFIG_LOAD_MODULE,			TYPE_MULTISTRING,
@@ -893,7 +917,12 @@ int	main(int argc, char **argv)
 	zbx_load_config(&t);
 
 	if (ZBX_TASK_RUNTIME_CONTROL == t.task)
+	{
+		if (ZBX_RTC_DIAGINFO == ZBX_RTC_GET_MSG(t.data))
+			exit(SUCCEED == zbx_diaginfo_send(CONFIG_SOCKET_PATH, t.data) ? EXIT_SUCCESS : EXIT_FAILURE);
+
 		exit(SUCCEED == zbx_sigusr_send(t.data) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
 
 	if (FAIL == zbx_ipc_service_init_env(CONFIG_SOCKET_PATH, &error))
 	{
@@ -907,7 +936,7 @@ int	main(int argc, char **argv)
 
 int	MAIN_ZABBIX_ENTRY(int flags)
 {
-	zbx_socket_t	listen_sock;
+	zbx_socket_t	listen_sock, metrics_sock;
 	char		*error = NULL;
 	int		i, db_type;
 
@@ -925,6 +954,9 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 		exit(EXIT_FAILURE);
 	}
 
+	if (0 != CONFIG_LOCK_STATISTICS)
+		zbx_locks_enable_stats();
+
 	if (SUCCEED != zabbix_open_log(CONFIG_LOG_TYPE, CONFIG_LOG_LEVEL, CONFIG_LOG_FILE, &error))
 	{
 		zbx_error("cannot open log:%s", error);
@@ -1084,6 +1116,15 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 		}
 	}
 
+	if (0 != CONFIG_METRICS_LISTEN_PORT)
+	{
+		if (FAIL == zbx_tcp_listen(&metrics_sock, CONFIG_LISTEN_IP, (unsigned short)CONFIG_METRICS_LISTEN_PORT))
+		{
+			zabbix_log(LOG_LEVEL_CRIT, "metrics listener failed: %s", zbx_socket_strerror());
+			exit(EXIT_FAILURE);
+		}
+	}
+
 #if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
 	zbx_tls_init_parent();
 #endif
@@ -1156,6 +1197,7 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 				zbx_thread_start(snmptrapper_thread, &thread_args, &threads[i]);
 				break;
 			case ZBX_PROCESS_TYPE_SELFMON:
+				thread_args.args = (0 != CONFIG_METRICS_LISTEN_PORT ? &metrics_sock : NULL);
 				zbx_thread_start(selfmon_thread, &thread_args, &threads[i]);
 				break;
 			case ZBX_PROCESS_TYPE_VMWARE:
@@ -1181,6 +1223,9 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 		}
 	}
 
+	/* serve diagnostic information requests until terminated by signal handlers */
+	zbx_diag_serve();
+
 	while (-1 == wait(&i))	/* wait for any child to exit */
 	{
 		if (EINTR != errno)
@@ -56,7 +56,7 @@ static void	process_configuration_sync(size_t *data_size)
 {
 	zbx_socket_t	sock;
 	struct		zbx_json_parse jp;
-	char		value[16], *error = NULL;
+	char		value[16], *error = NULL, *revisions;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -66,13 +66,19 @@ static void	process_configuration_sync(size_t *data_size)
 	if (FAIL == connect_to_server(&sock, 600, CONFIG_PROXYCONFIG_RETRY))	/* retry till have a connection */
 		goto out;
 
-	if (SUCCEED != get_data_from_server(&sock, ZBX_PROTO_VALUE_PROXY_CONFIG, &error))
+	/* report revisions of the applied configuration to receive only the changed data */
+	revisions = DCget_proxyconfig_revisions();
+
+	if (SUCCEED != get_data_from_server(&sock, ZBX_PROTO_VALUE_PROXY_CONFIG, revisions, &error))
 	{
 		zabbix_log(LOG_LEVEL_WARNING, "cannot obtain configuration data from server at \"%s\": %s",
 				sock.peer, error);
+		zbx_free(revisions);
 		goto error;
 	}
 
+	zbx_free(revisions);
+
 	if ('\0' == *sock.buffer)
 	{
 		zabbix_log(LOG_LEVEL_WARNING, "cannot obtain configuration data from server at \"%s\": %s",
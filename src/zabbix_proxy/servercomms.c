@@ -115,11 +115,17 @@ void	disconnect_server(zbx_socket_t *sock)
  *                                                                            *
  * Purpose: get configuration and other data from server                      *
  *                                                                            *
+ * Parameters: sock      - [IN] the connection to server                      *
+ *             request   - [IN] the request type                              *
+ *             revisions - [IN] the revisions of the applied configuration    *
+ *                              in json format, can be NULL                   *
+ *             error     - [OUT] the error message                            *
+ *                                                                            *
  * Return value: SUCCEED - processed successfully                             *
  *               FAIL - an error occurred                                     *
  *                                                                            *
  ******************************************************************************/
-int	get_data_from_server(zbx_socket_t *sock, const char *request, char **error)
+int	get_data_from_server(zbx_socket_t *sock, const char *request, const char *revisions, char **error)
 {
 	int		ret = FAIL;
 	struct zbx_json	j;
@@ -131,6 +137,9 @@ int	get_data_from_server(zbx_socket_t *sock, const char *request, char **error)
 	zbx_json_addstring(&j, "host", CONFIG_HOSTNAME, ZBX_JSON_TYPE_STRING);
 	zbx_json_addstring(&j, ZBX_PROTO_TAG_VERSION, ZABBIX_VERSION, ZBX_JSON_TYPE_STRING);
 
+	if (NULL != revisions)
+		zbx_json_addraw(&j, ZBX_PROTO_TAG_REVISIONS, revisions);
+
 	if (SUCCEED != zbx_tcp_send_ext(sock, j.buffer, strlen(j.buffer), ZBX_TCP_PROTOCOL | ZBX_TCP_COMPRESS, 0))
 	{
 		*error = zbx_strdup(*error, zbx_socket_strerror());
@@ -154,6 +163,29 @@ exit:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: send_data_to_server                                              *
+ *                                                                            *
+ * Purpose: send data to server without waiting for the response              *
+ *                                                                            *
+ * Return value: SUCCEED - the data was sent successfully                     *
+ *               FAIL - an error occurred                                     *
+ *                                                                            *
+ ******************************************************************************/
+int	send_data_to_server(zbx_socket_t *sock, struct zbx_json *j, char **error)
+{
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() datalen:" ZBX_FS_SIZE_T, __func__, (zbx_fs_size_t)j->buffer_size);
+
+	if (SUCCEED != zbx_tcp_send_ext(sock, j->buffer, strlen(j->buffer), ZBX_TCP_PROTOCOL | ZBX_TCP_COMPRESS, 0))
+	{
+		*error = zbx_strdup(*error, zbx_socket_strerror());
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: put_data_to_server                                               *
@@ -170,11 +202,8 @@ int	put_data_to_server(zbx_socket_t *sock, struct zbx_json *j, char **error)
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() datalen:" ZBX_FS_SIZE_T, __func__, (zbx_fs_size_t)j->buffer_size);
 
-	if (SUCCEED != zbx_tcp_send_ext(sock, j->buffer, strlen(j->buffer), ZBX_TCP_PROTOCOL | ZBX_TCP_COMPRESS, 0))
-	{
-		*error = zbx_strdup(*error, zbx_socket_strerror());
+	if (SUCCEED != send_data_to_server(sock, j, error))
 		goto out;
-	}
 
 	if (SUCCEED != zbx_recv_response(sock, 0, error))
 		goto out;
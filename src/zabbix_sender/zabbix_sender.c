@@ -25,6 +25,7 @@
 #include "log.h"
 #include "zbxgetopt.h"
 #include "zbxjson.h"
+#include "zbxalgo.h"
 #include "mutexs.h"
 #include "zbxcrypto.h"
 #if defined(_WINDOWS)
@@ -33,18 +34,24 @@
 #	include "zbxnix.h"
 #endif
 
+/* sending a huge amount of values in a single connection is likely to */
+/* take long and hit timeout, so by default we limit values to 250 per connection */
+#define VALUES_MAX		250
+#define VALUES_MAX_LIMIT	10000
+#define CONNECTIONS_MAX		64
+
 const char	*progname = NULL;
 const char	title_message[] = "zabbix_sender";
 const char	syslog_app_name[] = "zabbix_sender";
 
 const char	*usage_message[] = {
 	"[-v]", "-z server", "[-p port]", "[-I IP-address]", "-s host", "-k key", "-o value", NULL,
-	"[-v]", "-z server", "[-p port]", "[-I IP-address]", "[-s host]", "[-T]", "[-N]", "[-r]", "-i input-file",
-	NULL,
+	"[-v]", "-z server", "[-p port]", "[-I IP-address]", "[-s host]", "[-T]", "[-N]", "[-r]",
+	"[--batch-size values]", "[--connections count]", "[--compress]", "-i input-file", NULL,
 	"[-v]", "-c config-file", "[-z server]", "[-p port]", "[-I IP-address]", "[-s host]", "-k key", "-o value",
 	NULL,
 	"[-v]", "-c config-file", "[-z server]", "[-p port]", "[-I IP-address]", "[-s host]", "[-T]", "[-N]", "[-r]",
-	"-i input-file", NULL,
+	"[--batch-size values]", "[--connections count]", "[--compress]", "-i input-file", NULL,
 #if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
 	"[-v]", "-z server", "[-p port]", "[-I IP-address]", "-s host", "--tls-connect cert", "--tls-ca-file CA-file",
 	"[--tls-crl-file CRL-file]", "[--tls-server-cert-issuer cert-issuer]",
@@ -127,6 +134,22 @@ const char	*help_message[] = {
 	"                             received. This can be used when reading from",
 	"                             standard input",
 	"",
+	"  --batch-size values        Maximum number of values sent in one connection.",
+	"                             This can be used with --input-file option",
+	"                             (default: " ZBX_STR(VALUES_MAX) ", range: 1-" ZBX_STR(VALUES_MAX_LIMIT) ")",
+	"",
+	"  --connections count        Number of batches of values sent concurrently",
+	"                             while the input file is being read. Values of",
+	"                             the same item keep their order, values of",
+	"                             different items can reach server in different",
+	"                             order than in the input file. This can be used",
+	"                             with --input-file option (default: 1,",
+	"                             range: 1-" ZBX_STR(CONNECTIONS_MAX) ")",
+	"",
+	"  --compress                 Compress sent data. Requires Zabbix server or",
+	"                             proxy version 4.0 or newer. This can be used",
+	"                             with --input-file option",
+	"",
 	"  -v --verbose               Verbose mode, -vv for more details",
 	"",
 	"  -h --help                  Display this help message",
@@ -221,6 +244,9 @@ static struct zbx_option	longopts[] =
 	{"with-timestamps",		0,	NULL,	'T'},
 	{"with-ns",			0,	NULL,	'N'},
 	{"real-time",			0,	NULL,	'r'},
+	{"batch-size",			1,	NULL,	'B'},
+	{"connections",			1,	NULL,	'P'},
+	{"compress",			0,	NULL,	'Z'},
 	{"verbose",			0,	NULL,	'v'},
 	{"help",			0,	NULL,	'h'},
 	{"version",			0,	NULL,	'V'},
@@ -247,6 +273,9 @@ static char	*INPUT_FILE = NULL;
 static int	WITH_TIMESTAMPS = 0;
 static int	WITH_NS = 0;
 static int	REAL_TIME = 0;
+static int	BATCH_SIZE = VALUES_MAX;
+static int	CONNECTIONS = 1;
+static int	COMPRESSION = 0;
 
 static char	*CONFIG_SOURCE_IP = NULL;
 static char	*ZABBIX_SERVER = NULL;
@@ -259,7 +288,6 @@ typedef struct
 {
 	char			*host;
 	unsigned short		port;
-	ZBX_THREAD_HANDLE	*thread;
 }
 zbx_send_destinations_t;
 
@@ -308,6 +336,29 @@ ZBX_THREAD_SENDVAL_ARGS;
 
 #define SUCCEED_PARTIAL	2
 
+/* values being sent to all destinations, up to CONNECTIONS batches are sent concurrently */
+typedef struct
+{
+	ZBX_THREAD_SENDVAL_ARGS	*sendval_args;	/* per destination, values are in JSON of the first one */
+	ZBX_THREAD_HANDLE	*threads;
+	int			threads_num;	/* number of running threads, 0 if batch is not being sent */
+	int			values_num;	/* number of values added to JSON */
+	double			time_start;
+}
+zbx_send_batch_t;
+
+/* Values of the same item are always sent through the same lane, one batch after another, so that    */
+/* they reach server in the order they were read. Each lane fills one batch while sending the other.   */
+typedef struct
+{
+	zbx_send_batch_t	*batches[2];
+	int			filled;		/* index of the batch values are added to */
+}
+zbx_send_lane_t;
+
+static int	batches_sent = 0;
+static double	batches_time_total = 0, batches_time_max = 0;
+
 /******************************************************************************
  *                                                                            *
  * Function: sender_threads_wait                                              *
@@ -316,9 +367,10 @@ ZBX_THREAD_SENDVAL_ARGS;
  *          exit status updates                                               *
  *                                                                            *
  * Parameters:                                                                *
- *      threads -     [IN] thread handles                                     *
- *      threads_num - [IN] thread count                                       *
- *      old_status  - [IN] previous status                                    *
+ *      threads      - [IN] thread handles                                    *
+ *      sendval_args - [IN] arguments the threads were started with           *
+ *      threads_num  - [IN] thread count                                      *
+ *      old_status   - [IN] previous status                                   *
  *                                                                            *
  * Return value:  SUCCEED - success with all values at all destinations       *
  *                FAIL - an error occurred                                    *
@@ -330,7 +382,8 @@ ZBX_THREAD_SENDVAL_ARGS;
  *           SUCCEED statuses that come after should not overwrite it         *
  *                                                                            *
  ******************************************************************************/
-static int	sender_threads_wait(ZBX_THREAD_HANDLE *threads, int threads_num, const int old_status)
+static int	sender_threads_wait(ZBX_THREAD_HANDLE *threads, const ZBX_THREAD_SENDVAL_ARGS *sendval_args,
+		int threads_num, const int old_status)
 {
 	int		i, sp_count = 0, fail_count = 0;
 #if defined(_WINDOWS)
@@ -350,7 +403,8 @@ static int	sender_threads_wait(ZBX_THREAD_HANDLE *threads, int threads_num, cons
 
 			for (fail_count++, j = 0; j < destinations_count; j++)
 			{
-				if (destinations[j].thread == &threads[i])
+				if (0 == strcmp(destinations[j].host, sendval_args[i].server) &&
+						destinations[j].port == sendval_args[i].port)
 				{
 					zbx_free(destinations[j].host);
 					destinations[j] = destinations[--destinations_count];
@@ -574,7 +628,9 @@ static	ZBX_THREAD_ENTRY(send_value, args)
 			zbx_json_adduint64(&sendval_args->json, ZBX_PROTO_TAG_NS, ts.ns);
 		}
 
-		if (SUCCEED == (tcp_ret = zbx_tcp_send(&sock, sendval_args->json.buffer)))
+		if (SUCCEED == (tcp_ret = zbx_tcp_send_ext(&sock, sendval_args->json.buffer,
+				strlen(sendval_args->json.buffer), ZBX_TCP_PROTOCOL | (1 == COMPRESSION ?
+				ZBX_TCP_COMPRESS : 0), 0)))
 		{
 			if (SUCCEED == (tcp_ret = zbx_tcp_recv(&sock)))
 			{
@@ -600,28 +656,18 @@ out:
 
 /******************************************************************************
  *                                                                            *
- * Function: perform_data_sending                                             *
+ * Function: sender_batch_start                                               *
  *                                                                            *
- * Purpose: Send data to all destinations each in a separate thread and wait  *
- *          till threads have completed their task                            *
+ * Purpose: start sending a batch of values to all destinations, each in a    *
+ *          separate thread                                                   *
  *                                                                            *
- * Parameters:                                                                *
- *      sendval_args - [IN] arguments for thread function                     *
- *      old_status   - [IN] previous status                                   *
- *                                                                            *
- * Return value:  SUCCEED - success with all values at all destinations       *
- *                FAIL - an error occurred                                    *
- *                SUCCEED_PARTIAL - data sending was completed successfully   *
- *                to at least one destination or processing of at least one   *
- *                value at least at one destination failed                    *
+ * Parameters: batch - [IN/OUT] batch with values in JSON of the first thread *
+ *                              arguments                                     *
  *                                                                            *
  ******************************************************************************/
-static int	perform_data_sending(ZBX_THREAD_SENDVAL_ARGS *sendval_args, int old_status)
+static void	sender_batch_start(zbx_send_batch_t *batch)
 {
-	int			i, ret;
-	ZBX_THREAD_HANDLE	*threads = NULL;
-
-	threads = (ZBX_THREAD_HANDLE *)zbx_calloc(threads, destinations_count, sizeof(ZBX_THREAD_HANDLE));
+	int	i;
 
 	for (i = 0; i < destinations_count; i++)
 	{
@@ -629,35 +675,240 @@ static int	perform_data_sending(ZBX_THREAD_SENDVAL_ARGS *sendval_args, int old_s
 
 		thread_args = (zbx_thread_args_t *)zbx_malloc(NULL, sizeof(zbx_thread_args_t));
 
-		thread_args->args = &sendval_args[i];
+		thread_args->args = &batch->sendval_args[i];
 
-		sendval_args[i].server = destinations[i].host;
-		sendval_args[i].port = destinations[i].port;
+		/* destination can be removed while the thread is running, so the thread gets its own copy */
+		batch->sendval_args[i].server = zbx_strdup(batch->sendval_args[i].server, destinations[i].host);
+		batch->sendval_args[i].port = destinations[i].port;
 
 		if (0 != i)
 		{
-			sendval_args[i].json = sendval_args[0].json;
+			batch->sendval_args[i].json = batch->sendval_args[0].json;
 #if defined(_WINDOWS) && (defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL))
-			sendval_args[i].tls_vars = sendval_args[0].tls_vars;
+			batch->sendval_args[i].tls_vars = batch->sendval_args[0].tls_vars;
 #endif
-			sendval_args[i].sync_timestamp = sendval_args[0].sync_timestamp;
+			batch->sendval_args[i].sync_timestamp = batch->sendval_args[0].sync_timestamp;
 		}
 
-		destinations[i].thread = &threads[i];
-
-		zbx_thread_start(send_value, thread_args, &threads[i]);
+		zbx_thread_start(send_value, thread_args, &batch->threads[i]);
 #ifndef _WINDOWS
 		zbx_free(thread_args);
 #endif
 	}
 
-	ret = sender_threads_wait(threads, destinations_count, old_status);
+	batch->threads_num = destinations_count;
+	batch->time_start = zbx_time();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: sender_batch_wait                                                *
+ *                                                                            *
+ * Purpose: wait till all threads sending a batch have completed their task   *
+ *                                                                            *
+ * Parameters:                                                                *
+ *      batch      - [IN/OUT] batch being sent                                *
+ *      old_status - [IN] previous status                                     *
+ *                                                                            *
+ * Return value:  SUCCEED - success with all values at all destinations       *
+ *                FAIL - an error occurred                                    *
+ *                SUCCEED_PARTIAL - data sending was completed successfully   *
+ *                to at least one destination or processing of at least one   *
+ *                value at least at one destination failed                    *
+ *                                                                            *
+ * Comments: FAIL status is sticky, batches which were sent concurrently with *
+ *           the failed one are only waited for                               *
+ *                                                                            *
+ ******************************************************************************/
+static int	sender_batch_wait(zbx_send_batch_t *batch, int old_status)
+{
+	int	i, ret;
+	double	time_spent;
+
+	ret = sender_threads_wait(batch->threads, batch->sendval_args, batch->threads_num, old_status);
+
+	for (i = 0; i < batch->threads_num; i++)
+		zbx_free(batch->sendval_args[i].server);
+
+	/* with concurrent batches this is the time till the batch was waited for, i.e. the upper bound */
+	time_spent = zbx_time() - batch->time_start;
+	batches_sent++;
+	batches_time_total += time_spent;
+
+	if (batches_time_max < time_spent)
+		batches_time_max = time_spent;
+
+	batch->threads_num = 0;
+
+	/* concurrent batches may have failed at different destinations each leaving others */
+	if (0 == destinations_count)
+		ret = FAIL;
+
+	return FAIL == old_status ? FAIL : ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: sender_batches_init                                              *
+ *                                                                            *
+ * Purpose: allocate batches for sending values concurrently                  *
+ *                                                                            *
+ * Parameters: batches_num    - [IN] number of batches                        *
+ *             sync_timestamp - [IN] 1 if values have timestamps              *
+ *                                                                            *
+ * Return value: allocated batches with empty JSON for values                 *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_send_batch_t	*sender_batches_init(int batches_num, int sync_timestamp)
+{
+	zbx_send_batch_t	*batches;
+	int			i;
+
+	batches = (zbx_send_batch_t *)zbx_calloc(NULL, batches_num, sizeof(zbx_send_batch_t));
+
+	for (i = 0; i < batches_num; i++)
+	{
+		ZBX_THREAD_SENDVAL_ARGS	*sendval_args;
+
+		sendval_args = (ZBX_THREAD_SENDVAL_ARGS *)zbx_calloc(NULL, destinations_count,
+				sizeof(ZBX_THREAD_SENDVAL_ARGS));
+		batches[i].threads = (ZBX_THREAD_HANDLE *)zbx_calloc(NULL, destinations_count,
+				sizeof(ZBX_THREAD_HANDLE));
+		batches[i].sendval_args = sendval_args;
+
+#if defined(_WINDOWS) && (defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL))
+		if (ZBX_TCP_SEC_UNENCRYPTED != configured_tls_connect_mode)
+		{
+			/* prepare to pass necessary TLS data to 'send_value' thread (to be started soon) */
+			zbx_tls_pass_vars(&sendval_args->tls_vars);
+		}
+#endif
+		sendval_args->sync_timestamp = sync_timestamp;
+		zbx_json_init(&sendval_args->json, ZBX_JSON_STAT_BUF_LEN);
+		zbx_json_addstring(&sendval_args->json, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_SENDER_DATA,
+				ZBX_JSON_TYPE_STRING);
+		zbx_json_addarray(&sendval_args->json, ZBX_PROTO_TAG_DATA);
+	}
+
+	return batches;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: sender_batch_clean                                               *
+ *                                                                            *
+ * Purpose: remove values from batch which was sent                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	sender_batch_clean(zbx_send_batch_t *batch)
+{
+	zbx_json_clean(&batch->sendval_args->json);
+	zbx_json_addstring(&batch->sendval_args->json, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_SENDER_DATA,
+			ZBX_JSON_TYPE_STRING);
+	zbx_json_addarray(&batch->sendval_args->json, ZBX_PROTO_TAG_DATA);
+	batch->values_num = 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: sender_lanes_init                                                *
+ *                                                                            *
+ * Purpose: split batches between lanes, two batches per lane                *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_send_lane_t	*sender_lanes_init(zbx_send_batch_t *batches, int lanes_num)
+{
+	zbx_send_lane_t	*lanes;
+	int		i;
+
+	lanes = (zbx_send_lane_t *)zbx_malloc(NULL, lanes_num * sizeof(zbx_send_lane_t));
+
+	for (i = 0; i < lanes_num; i++)
+	{
+		lanes[i].batches[0] = &batches[i * 2];
+		lanes[i].batches[1] = &batches[i * 2 + 1];
+		lanes[i].filled = 0;
+	}
+
+	return lanes;
+}
 
-	zbx_free(threads);
+/******************************************************************************
+ *                                                                            *
+ * Function: sender_lane_get                                                  *
+ *                                                                            *
+ * Purpose: get the lane item values are sent through                         *
+ *                                                                            *
+ * Parameters: lanes     - [IN] the lanes                                     *
+ *             lanes_num - [IN] the number of lanes                           *
+ *             host      - [IN] the item host name                            *
+ *             key       - [IN] the item key                                  *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_send_lane_t	*sender_lane_get(zbx_send_lane_t *lanes, int lanes_num, const char *host, const char *key)
+{
+	zbx_hash_t	hash;
+
+	hash = ZBX_DEFAULT_STRING_HASH_ALGO(host, strlen(host), ZBX_DEFAULT_HASH_SEED);
+	hash = ZBX_DEFAULT_STRING_HASH_ALGO(key, strlen(key), hash);
+
+	return &lanes[hash % (zbx_hash_t)lanes_num];
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: sender_lane_flush                                                *
+ *                                                                            *
+ * Purpose: start sending the values added to the lane                        *
+ *                                                                            *
+ * Parameters: lane       - [IN/OUT] the lane                                 *
+ *             old_status - [IN] the status of previously sent batches        *
+ *                                                                            *
+ * Return value: the status of sending, see sender_batch_wait()               *
+ *                                                                            *
+ * Comments: The previous batch of the lane is waited for before the next one *
+ *           is started.                                                      *
+ *                                                                            *
+ ******************************************************************************/
+static int	sender_lane_flush(zbx_send_lane_t *lane, int old_status)
+{
+	zbx_send_batch_t	*batch = lane->batches[lane->filled], *next = lane->batches[1 - lane->filled];
+	int			ret = old_status;
+
+	if (0 == batch->values_num)
+		return ret;
+
+	if (0 != next->threads_num)
+		ret = sender_batch_wait(next, ret);
+
+	zbx_json_close(&batch->sendval_args->json);
+	sender_batch_start(batch);
+
+	sender_batch_clean(next);
+	lane->filled = 1 - lane->filled;
 
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: sender_batches_free                                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	sender_batches_free(zbx_send_batch_t *batches, int batches_num)
+{
+	int	i;
+
+	for (i = 0; i < batches_num; i++)
+	{
+		zbx_json_free(&batches[i].sendval_args->json);
+		zbx_free(batches[i].sendval_args);
+		zbx_free(batches[i].threads);
+	}
+
+	zbx_free(batches);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: sender_add_serveractive_host_cb                                  *
@@ -844,6 +1095,25 @@ static void	parse_commandline(int argc, char **argv)
 			case 'r':
 				REAL_TIME = 1;
 				break;
+			case 'B':
+				if (SUCCEED != is_uint_range(zbx_optarg, &BATCH_SIZE, 1, VALUES_MAX_LIMIT))
+				{
+					zbx_error("option \"--batch-size\" used with invalid value \"%s\", valid values"
+							" are 1-%d", zbx_optarg, VALUES_MAX_LIMIT);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'P':
+				if (SUCCEED != is_uint_range(zbx_optarg, &CONNECTIONS, 1, CONNECTIONS_MAX))
+				{
+					zbx_error("option \"--connections\" used with invalid value \"%s\", valid values"
+							" are 1-%d", zbx_optarg, CONNECTIONS_MAX);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'Z':
+				COMPRESSION = 1;
+				break;
 			case 'v':
 				if (LOG_LEVEL_WARNING > CONFIG_LOG_LEVEL)
 					CONFIG_LOG_LEVEL = LOG_LEVEL_WARNING;
@@ -1124,6 +1394,13 @@ static void	parse_commandline(int argc, char **argv)
 	/*   c  z  s  k  o  -  -  -  -  p  -  0x7c2                    */
 	/*   c  z  s  k  o  -  -  -  -  p  I  0x7c3                    */
 
+	if (0 == opt_count['i'] && 0 != opt_count['B'] + opt_count['P'] + opt_count['Z'])
+	{
+		zbx_error("options \"--batch-size\", \"--connections\" and \"--compress\" can be used only with"
+				" \"-i\" or \"--input-file\" option");
+		exit(EXIT_FAILURE);
+	}
+
 	if (0 == opt_count['c'] + opt_count['z'])
 	{
 		zbx_error("either '-c' or '-z' option must be specified");
@@ -1237,15 +1514,13 @@ static char	*zbx_fgets_alloc(char **buffer, size_t *buffer_alloc, FILE *fp)
 	return *buffer;
 }
 
-/* sending a huge amount of values in a single connection is likely to */
-/* take long and hit timeout, so we limit values to 250 per connection */
-#define VALUES_MAX	250
-
 int	main(int argc, char **argv)
 {
 	char			*error = NULL;
-	int			total_count = 0, succeed_count = 0, ret = FAIL, timestamp, ns;
+	int			total_count = 0, succeed_count = 0, ret = FAIL, timestamp, ns, batches_num = 1;
+	double			time_start;
 	ZBX_THREAD_SENDVAL_ARGS	*sendval_args = NULL;
+	zbx_send_batch_t	*batches = NULL;
 
 	progname = get_program_name(argv[0]);
 
@@ -1311,27 +1586,24 @@ int	main(int argc, char **argv)
 #endif
 	}
 
-	sendval_args = (ZBX_THREAD_SENDVAL_ARGS *)zbx_calloc(sendval_args, destinations_count,
-			sizeof(ZBX_THREAD_SENDVAL_ARGS));
+	/* values are read from input file into the next batch of a lane while the previous one is being sent */
+	if (NULL != INPUT_FILE)
+		batches_num = CONNECTIONS * 2;
 
-#if defined(_WINDOWS) && (defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL))
-	if (ZBX_TCP_SEC_UNENCRYPTED != configured_tls_connect_mode)
-	{
-		/* prepare to pass necessary TLS data to 'send_value' thread (to be started soon) */
-		zbx_tls_pass_vars(&sendval_args->tls_vars);
-	}
-#endif
-	zbx_json_init(&sendval_args->json, ZBX_JSON_STAT_BUF_LEN);
-	zbx_json_addstring(&sendval_args->json, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_SENDER_DATA, ZBX_JSON_TYPE_STRING);
-	zbx_json_addarray(&sendval_args->json, ZBX_PROTO_TAG_DATA);
+	batches = sender_batches_init(batches_num, NULL != INPUT_FILE ? WITH_TIMESTAMPS : 0);
+	sendval_args = batches[0].sendval_args;
+	time_start = zbx_time();
 
 	if (INPUT_FILE)
 	{
-		FILE	*in;
-		char	*in_line = NULL, *key = NULL, *key_value = NULL;
-		int	buffer_count = 0;
-		size_t	key_alloc = 0, in_line_alloc = MAX_BUFFER_LEN;
-		double	last_send = 0;
+		FILE		*in;
+		char		*in_line = NULL, *key = NULL, *key_value = NULL;
+		int		i;
+		size_t		key_alloc = 0, in_line_alloc = MAX_BUFFER_LEN;
+		double		last_send = 0;
+		zbx_send_lane_t	*lanes, *lane;
+
+		lanes = sender_lanes_init(batches, CONNECTIONS);
 
 		if (0 == strcmp(INPUT_FILE, "-"))
 		{
@@ -1348,7 +1620,6 @@ int	main(int argc, char **argv)
 			goto free;
 		}
 
-		sendval_args->sync_timestamp = WITH_TIMESTAMPS;
 		in_line = (char *)zbx_malloc(NULL, in_line_alloc);
 
 		ret = SUCCEED;
@@ -1465,6 +1736,9 @@ int	main(int argc, char **argv)
 				break;
 			}
 
+			lane = sender_lane_get(lanes, CONNECTIONS, hostname, key);
+			sendval_args = lane->batches[lane->filled]->sendval_args;
+
 			zbx_json_addobject(&sendval_args->json, NULL);
 			zbx_json_addstring(&sendval_args->json, ZBX_PROTO_TAG_HOST, hostname, ZBX_JSON_TYPE_STRING);
 			zbx_json_addstring(&sendval_args->json, ZBX_PROTO_TAG_KEY, key, ZBX_JSON_TYPE_STRING);
@@ -1481,7 +1755,7 @@ int	main(int argc, char **argv)
 			zbx_json_close(&sendval_args->json);
 
 			succeed_count++;
-			buffer_count++;
+			lane->batches[lane->filled]->values_num++;
 
 			if (stdin == in && 1 == REAL_TIME)
 			{
@@ -1510,28 +1784,31 @@ int	main(int argc, char **argv)
 				}
 			}
 
-			if (VALUES_MAX == buffer_count || (stdin == in && 1 == REAL_TIME && 0 >= read_more))
+			if (stdin == in && 1 == REAL_TIME && 0 >= read_more)
 			{
-				zbx_json_close(&sendval_args->json);
-
 				last_send = zbx_time();
 
-				ret = perform_data_sending(sendval_args, ret);
-
-				buffer_count = 0;
-				zbx_json_clean(&sendval_args->json);
-				zbx_json_addstring(&sendval_args->json, ZBX_PROTO_TAG_REQUEST,
-						ZBX_PROTO_VALUE_SENDER_DATA, ZBX_JSON_TYPE_STRING);
-				zbx_json_addarray(&sendval_args->json, ZBX_PROTO_TAG_DATA);
+				for (i = 0; i < CONNECTIONS; i++)
+					ret = sender_lane_flush(&lanes[i], ret);
 			}
+			else if (BATCH_SIZE == lane->batches[lane->filled]->values_num)
+				ret = sender_lane_flush(lane, ret);
 		}
 
-		if (FAIL != ret && 0 != buffer_count)
+		if (FAIL != ret)
 		{
-			zbx_json_close(&sendval_args->json);
-			ret = perform_data_sending(sendval_args, ret);
+			for (i = 0; i < CONNECTIONS; i++)
+				ret = sender_lane_flush(&lanes[i], ret);
+		}
+
+		for (i = 0; i < batches_num; i++)
+		{
+			if (0 != batches[i].threads_num)
+				ret = sender_batch_wait(&batches[i], ret);
 		}
 
+		zbx_free(lanes);
+
 		if (in != stdin)
 			fclose(in);
 
@@ -1541,7 +1818,6 @@ int	main(int argc, char **argv)
 	}
 	else
 	{
-		sendval_args->sync_timestamp = 0;
 		total_count++;
 
 		do /* try block simulation */
@@ -1572,17 +1848,26 @@ int	main(int argc, char **argv)
 
 			succeed_count++;
 
-			ret = perform_data_sending(sendval_args, ret);
+			sender_batch_start(&batches[0]);
+			ret = sender_batch_wait(&batches[0], ret);
 		}
 		while (0); /* try block simulation */
 	}
 free:
-	zbx_json_free(&sendval_args->json);
-	zbx_free(sendval_args);
+	sender_batches_free(batches, batches_num);
 exit:
 	if (FAIL != ret)
 	{
 		printf("sent: %d; skipped: %d; total: %d\n", succeed_count, total_count - succeed_count, total_count);
+
+		if (NULL != INPUT_FILE && 0 != batches_sent)
+		{
+			double	time_spent = zbx_time() - time_start;
+
+			printf("seconds spent: %.6f; values per second: %.2f; batches: %d; batch time avg: %.6f;"
+					" max: %.6f\n", time_spent, 0 < time_spent ? succeed_count / time_spent : 0,
+					batches_sent, batches_time_total / batches_sent, batches_time_max);
+		}
 	}
 	else
 	{
@@ -138,7 +138,11 @@ ZBX_THREAD_ENTRY(dbsyncer_thread, args)
 
 		total_values_num += values_num;
 		total_triggers_num += triggers_num;
-		total_sec += zbx_time() - sec;
+		sec = zbx_time() - sec;
+		total_sec += sec;
+
+		if (0 != values_num)
+			update_selfmon_latency(sec);
 
 		sleeptime = (ZBX_SYNC_MORE == more ? 0 : CONFIG_HISTSYNCER_FREQUENCY);
 
@@ -132,10 +132,40 @@ typedef struct zbx_ipmi_host
 	unsigned int		domain_nr;	/* Domain number. It is converted to text string and used as */
 						/* domain name. */
 	char			*err;
+	int			busy;		/* 1 - the host is used by an asynchronous request, 0 - otherwise */
+	int			expired;	/* 1 - the operation of a timed out request has not completed yet */
 	struct zbx_ipmi_host	*next;
 }
 zbx_ipmi_host_t;
 
+/* asynchronous IPMI request states */
+#define ZBX_IPMI_ASYNC_STATE_INIT	0	/* the request is not started */
+#define ZBX_IPMI_ASYNC_STATE_CONNECT	1	/* waiting for the domain to come up */
+#define ZBX_IPMI_ASYNC_STATE_READ	2	/* waiting for sensor/control reading or control setting */
+#define ZBX_IPMI_ASYNC_STATE_THRESHOLDS	3	/* waiting for sensor thresholds during discovery */
+#define ZBX_IPMI_ASYNC_STATE_DONE	4	/* the request has been finished */
+
+struct zbx_ipmi_async
+{
+	unsigned char		type;
+	unsigned char		state;
+	zbx_uint64_t		objectid;
+	char			*addr;
+	unsigned short		port;
+	signed char		authtype;
+	unsigned char		privilege;
+	char			*username;
+	char			*password;
+	char			*sensor;
+	int			command;
+	zbx_ipmi_host_t		*host;
+	int			sensor_index;	/* the index of sensor being discovered */
+	struct zbx_json		json;		/* the discovery data */
+	double			expire;		/* the time when request expires */
+	int			errcode;
+	char			*value;		/* the resulting value or error message */
+};
+
 static unsigned int	domain_nr = 0;		/* for making a sequence of domain names "0", "1", "2", ... */
 static zbx_ipmi_host_t	*hosts = NULL;		/* head of single-linked list of monitored hosts */
 static os_handler_t	*os_hnd;
@@ -930,10 +960,45 @@ void	zbx_perform_all_openipmi_ops(int timeout)
 	}
 }
 
-static void	zbx_read_ipmi_sensor(zbx_ipmi_host_t *h, const zbx_ipmi_sensor_t *s)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_perform_openipmi_op                                          *
+ *                                                                            *
+ * Purpose: Pass control to OpenIPMI library to process a single event        *
+ *                                                                            *
+ * Parameters: timeout_ms - [IN] the maximum time to wait for an event in     *
+ *                               milliseconds                                 *
+ *                                                                            *
+ *****************************************************************************/
+void	zbx_perform_openipmi_op(int timeout_ms)
+{
+	struct timeval	tv;
+	int		res;
+
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+	/* perform_one_op() returns 0 on success, errno on failure (timeout means success) */
+	if (0 != (res = os_hnd->perform_one_op(os_hnd, &tv)))
+		zabbix_log(LOG_LEVEL_DEBUG, "IPMI error: %s", zbx_strerror(res));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_read_ipmi_sensor                                             *
+ *                                                                            *
+ * Purpose: starts reading IPMI sensor value                                  *
+ *                                                                            *
+ * Return value: SUCCEED - the reading was started, the host 'done' flag is   *
+ *                         set when it completes                              *
+ *               FAIL    - the reading could not be started, the error is     *
+ *                         stored in host                                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_read_ipmi_sensor(zbx_ipmi_host_t *h, const zbx_ipmi_sensor_t *s)
 {
 	char		id_str[2 * IPMI_SENSOR_ID_SZ + 1];
-	int		ret;
+	int		ret, started = FAIL;
 	const char	*s_reading_type_string;
 
 	/* copy sensor details at start - it can go away and we won't be able to make an error message */
@@ -1006,15 +1071,28 @@ static void	zbx_read_ipmi_sensor(zbx_ipmi_host_t *h, const zbx_ipmi_sensor_t *s)
 			goto out;
 	}
 
-	zbx_perform_openipmi_ops(h, __func__);	/* ignore returned result */
+	started = SUCCEED;
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(h->ret));
+
+	return started;
 }
 
-static void	zbx_read_ipmi_thresholds(zbx_ipmi_host_t *h, const zbx_ipmi_sensor_t *s)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_read_ipmi_thresholds                                         *
+ *                                                                            *
+ * Purpose: starts reading IPMI sensor thresholds                             *
+ *                                                                            *
+ * Return value: SUCCEED - the reading was started, the host 'done' flag is   *
+ *                         set when it completes                              *
+ *               FAIL    - the thresholds are not accessible                  *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_read_ipmi_thresholds(zbx_ipmi_host_t *h, const zbx_ipmi_sensor_t *s)
 {
 	char	id_str[2 * IPMI_SENSOR_ID_SZ + 1];
-	int 	ret;
+	int 	ret, started = FAIL;
 	int	thr_access;
 
 	/* copy sensor details at start - it can go away and we won't be able to make an error message */
@@ -1038,9 +1116,11 @@ static void	zbx_read_ipmi_thresholds(zbx_ipmi_host_t *h, const zbx_ipmi_sensor_t
 		goto out;
 	}
 
-	zbx_perform_openipmi_ops(h, __func__);	/* ignore returned result */
+	started = SUCCEED;
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(h->ret));
+
+	return started;
 }
 /* callback function invoked from OpenIPMI */
 static void	zbx_got_control_reading_cb(ipmi_control_t *control, int err, int *val, void *cb_data)
@@ -1136,9 +1216,21 @@ static void	zbx_got_control_setting_cb(ipmi_control_t *control, int err, void *c
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(h->ret));
 }
 
-static void	zbx_read_ipmi_control(zbx_ipmi_host_t *h, const zbx_ipmi_control_t *c)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_read_ipmi_control                                            *
+ *                                                                            *
+ * Purpose: starts reading IPMI control value                                 *
+ *                                                                            *
+ * Return value: SUCCEED - the reading was started, the host 'done' flag is   *
+ *                         set when it completes                              *
+ *               FAIL    - the reading could not be started, the error is     *
+ *                         stored in host                                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_read_ipmi_control(zbx_ipmi_host_t *h, const zbx_ipmi_control_t *c)
 {
-	int	ret;
+	int	ret, started = FAIL;
 	char	control_name[128];	/* internally defined CONTROL_ID_LEN is 32 in OpenIPMI 2.0.22 */
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() control:'%s@[%s]:%d'", __func__, c->c_name, h->ip, h->port);
@@ -1166,14 +1258,28 @@ static void	zbx_read_ipmi_control(zbx_ipmi_host_t *h, const zbx_ipmi_control_t *
 		goto out;
 	}
 
-	zbx_perform_openipmi_ops(h, __func__);	/* ignore returned result */
+	started = SUCCEED;
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(h->ret));
+
+	return started;
 }
 
-static void	zbx_set_ipmi_control(zbx_ipmi_host_t *h, zbx_ipmi_control_t *c, int value)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_set_ipmi_control                                             *
+ *                                                                            *
+ * Purpose: starts setting IPMI control value                                 *
+ *                                                                            *
+ * Return value: SUCCEED - the setting was started, the host 'done' flag is   *
+ *                         set when it completes                              *
+ *               FAIL    - the setting could not be started, the error is     *
+ *                         stored in host                                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_set_ipmi_control(zbx_ipmi_host_t *h, zbx_ipmi_control_t *c, int value)
 {
-	int	ret;
+	int	ret, started = FAIL;
 	char	control_name[128];	/* internally defined CONTROL_ID_LEN is 32 in OpenIPMI 2.0.22 */
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() control:'%s@[%s]:%d' value:%d",
@@ -1212,9 +1318,11 @@ static void	zbx_set_ipmi_control(zbx_ipmi_host_t *h, zbx_ipmi_control_t *c, int
 		goto out;
 	}
 
-	zbx_perform_openipmi_ops(h, __func__);	/* ignore returned result */
+	started = SUCCEED;
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(h->ret));
+
+	return started;
 }
 
 /* callback function invoked from OpenIPMI */
@@ -1478,10 +1586,20 @@ void	zbx_free_ipmi_handler(void)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
-static zbx_ipmi_host_t	*zbx_init_ipmi_host(const char *ip, int port, int authtype, int privilege, const char *username,
-		const char *password)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_connect_ipmi_host                                            *
+ *                                                                            *
+ * Purpose: starts opening IPMI domain of the host                            *
+ *                                                                            *
+ * Return value: SUCCEED - the domain opening was started, the host 'done'    *
+ *                         flag is set when the domain comes up or fails      *
+ *               FAIL    - the connection could not be started, the error is  *
+ *                         stored in host                                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_connect_ipmi_host(zbx_ipmi_host_t *h)
 {
-	zbx_ipmi_host_t		*h;
 	ipmi_open_option_t	options[4];
 
 	/* Although we use only one address and port we pass them in 2-element arrays. The reason is */
@@ -1497,19 +1615,9 @@ static zbx_ipmi_host_t	*zbx_init_ipmi_host(const char *ip, int port, int authtyp
 	char			*addrs[2] = {NULL}, *ports[2] = {NULL};
 
 	char			domain_name[11];	/* max int length */
-	int			ret;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'[%s]:%d'", __func__, ip, port);
-
-	/* Host already in the list? */
+	int			ret, started = FAIL;
 
-	if (NULL != (h = zbx_get_ipmi_host(ip, port, authtype, privilege, username, password)))
-	{
-		if (1 == h->domain_up)
-			goto out;
-	}
-	else
-		h = zbx_allocate_ipmi_host(ip, port, authtype, privilege, username, password);
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'[%s]:%d'", __func__, h->ip, h->port);
 
 	h->ret = SUCCEED;
 	h->done = 0;
@@ -1558,14 +1666,15 @@ static zbx_ipmi_host_t	*zbx_init_ipmi_host(const char *ip, int port, int authtyp
 		goto out;
 	}
 
-	zbx_perform_openipmi_ops(h, __func__);	/* ignore returned result */
+	started = SUCCEED;
 out:
 	zbx_free(addrs[0]);
 	zbx_free(ports[0]);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%p domain_nr:%u", __func__, (void *)h, h->domain_nr);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s domain_nr:%u", __func__, zbx_result_string(started),
+			h->domain_nr);
 
-	return h;
+	return started;
 }
 
 static ipmi_domain_id_t	domain_id;		/* global variable for passing OpenIPMI domain ID between callbacks */
@@ -1657,7 +1766,9 @@ void	zbx_delete_inactive_ipmi_hosts(time_t last_check)
 
 	while (NULL != h)
 	{
-		if (last_check - h->lastaccess > INACTIVE_HOST_LIMIT)
+		/* hosts used by asynchronous requests or waiting for timed out operations cannot be closed */
+		if (0 == h->busy && (0 == h->expired || 0 != h->done) &&
+				last_check - h->lastaccess > INACTIVE_HOST_LIMIT)
 		{
 			next = h->next;
 
@@ -1719,254 +1830,123 @@ static int	has_name_prefix(const char *str, size_t *prefix_len)
 #undef ZBX_NAME_PREFIX
 }
 
-int	get_value_ipmi(zbx_uint64_t itemid, const char *addr, unsigned short port, signed char authtype,
-		unsigned char privilege, const char *username, const char *password, const char *sensor, char **value)
-{
-	zbx_ipmi_host_t		*h;
-	zbx_ipmi_sensor_t	*s;
-	zbx_ipmi_control_t	*c = NULL;
-	size_t			offset;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64, __func__, itemid);
-
-	if (NULL == os_hnd)
-	{
-		*value = zbx_strdup(*value, "IPMI handler is not initialised.");
-		return CONFIG_ERROR;
-	}
-
-	h = zbx_init_ipmi_host(addr, port, authtype, privilege, username, password);
-
-	h->lastaccess = time(NULL);
-
-	if (0 == h->domain_up)
-	{
-		if (NULL != h->err)
-			*value = zbx_strdup(*value, h->err);
-
-		return h->ret;
-	}
-
-	if (0 == has_name_prefix(sensor, &offset))
-	{
-		if (NULL == (s = zbx_get_ipmi_sensor_by_id(h, sensor + offset)))
-			c = zbx_get_ipmi_control_by_name(h, sensor + offset);
-	}
-	else
-	{
-		if (NULL == (s = zbx_get_ipmi_sensor_by_full_name(h, sensor + offset)))
-			c = zbx_get_ipmi_control_by_full_name(h, sensor + offset);
-	}
-
-	if (NULL == s && NULL == c)
-	{
-		*value = zbx_dsprintf(*value, "sensor or control %s@[%s]:%d does not exist", sensor, h->ip, h->port);
-		return NOTSUPPORTED;
-	}
-
-	if (NULL != s)
-		zbx_read_ipmi_sensor(h, s);
-	else
-		zbx_read_ipmi_control(h, c);
-
-	if (h->ret != SUCCEED)
-	{
-		if (NULL != h->err)
-			*value = zbx_strdup(*value, h->err);
-
-		return h->ret;
-	}
-
-	if (NULL != s)
-	{
-		if (IPMI_EVENT_READING_TYPE_THRESHOLD == s->reading_type)
-			*value = zbx_dsprintf(*value, ZBX_FS_DBL, s->value.threshold);
-		else
-			*value = zbx_dsprintf(*value, ZBX_FS_UI64, s->value.discrete);
-	}
-
-	if (NULL != c)
-		*value = zbx_dsprintf(*value, "%d", c->val[0]);
-
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s value:%s", __func__, zbx_result_string(h->ret),
-			ZBX_NULL2EMPTY_STR(*value));
-
-	return h->ret;
-}
-
 static void add_threshold_ipmi(struct zbx_json *json, const char *tag, zbx_ipmi_sensor_threshold_t *threshold)
 {
 	if (ZBX_IPMI_THRESHOLD_STATUS_ENABLED == threshold->status)
 		zbx_json_addfloat(json, tag, threshold->val);
 }
 
-int	get_discovery_ipmi(zbx_uint64_t itemid, const char *addr, unsigned short port, signed char authtype,
-		unsigned char privilege, const char *username, const char *password, char **value)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_ipmi_discovery_add_sensor                                    *
+ *                                                                            *
+ * Purpose: adds discovered sensor to low level discovery data                *
+ *                                                                            *
+ * Parameters: json - [IN/OUT] the discovery data                             *
+ *             s    - [IN] the sensor with value and thresholds read          *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_ipmi_discovery_add_sensor(struct zbx_json *json, zbx_ipmi_sensor_t *s)
 {
-	zbx_ipmi_host_t		*h;
-	int 			i, j;
-	struct zbx_json		json;
+	const char 	*p;
+	char 		state_name[MAX_STRING_LEN];
+	size_t		offset = 0;
+	zbx_uint64_t	state;
+	int		j;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64, __func__, itemid);
+	zbx_json_addobject(json, NULL);
 
-	if (NULL == os_hnd)
-	{
-		*value = zbx_strdup(*value, "IPMI handler is not initialised.");
-		return CONFIG_ERROR;
-	}
+	zbx_json_addstring(json, ZBX_IPMI_TAG_ID, s->id, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(json, ZBX_IPMI_TAG_NAME, s->full_name, ZBX_JSON_TYPE_STRING);
 
-	h = zbx_init_ipmi_host(addr, port, authtype, privilege, username, password);
+	zbx_json_addobject(json, ZBX_IPMI_TAG_SENSOR);
+	zbx_json_adduint64(json, ZBX_IPMI_TAG_TYPE, (zbx_uint64_t)s->type);
+	p = ipmi_sensor_get_sensor_type_string(s->sensor);
+	zbx_json_addstring(json, ZBX_IPMI_TAG_TEXT, p, ZBX_JSON_TYPE_STRING);
+	zbx_json_close(json);
 
-	h->lastaccess = time(NULL);
+	zbx_json_addobject(json, ZBX_IPMI_TAG_READING);
+	zbx_json_adduint64(json, ZBX_IPMI_TAG_TYPE, (zbx_uint64_t)s->reading_type);
+	p = ipmi_sensor_get_event_reading_type_string(s->sensor);
+	zbx_json_addstring(json, ZBX_IPMI_TAG_TEXT, p, ZBX_JSON_TYPE_STRING);
+	zbx_json_close(json);
 
-	if (0 == h->domain_up)
-	{
-		if (NULL != h->err)
-			*value = zbx_strdup(*value, h->err);
-
-		return h->ret;
-	}
-
-	zbx_json_initarray(&json, ZBX_JSON_STAT_BUF_LEN);
-
-	for (i = 0; i < h->sensor_count; i++)
+	if (IPMI_EVENT_READING_TYPE_THRESHOLD != s->reading_type)	/* discrete */
 	{
-		const char 	*p;
-		char 		state_name[MAX_STRING_LEN];
-		size_t		offset = 0;
-		zbx_uint64_t	state;
+		state = s->value.discrete;
+		zbx_json_addobject(json, ZBX_IPMI_TAG_STATE);
+		zbx_json_adduint64(json, ZBX_IPMI_TAG_STATE, state);
 
-		zbx_read_ipmi_sensor(h, &h->sensors[i]);
-		if (SUCCEED != h->ret)
+		state_name[0] = '\0';
+		for (j = 0; j < MAX_DISCRETE_STATES; j++)
 		{
-			zabbix_log(LOG_LEVEL_DEBUG,"Sensor '%s' cannot be discovered. Error: %s",h->sensors[i].id,
-					ZBX_NULL2EMPTY_STR(h->err));
-
-			continue;
-		}
-
-		if (IPMI_EVENT_READING_TYPE_THRESHOLD == h->sensors[i].reading_type)
-		{
-			zbx_read_ipmi_thresholds(h, &h->sensors[i]);
-			if (SUCCEED != h->ret)
+			if (0 != (state & (1u << j)))
 			{
-				zabbix_log(LOG_LEVEL_DEBUG,"Sensor '%s' cannot be discovered. Error: %s",
-						h->sensors[i].id, ZBX_NULL2EMPTY_STR(h->err));
-
-				continue;
-			}
-		}
-
-		zbx_json_addobject(&json, NULL);
-
-		zbx_json_addstring(&json, ZBX_IPMI_TAG_ID, h->sensors[i].id, ZBX_JSON_TYPE_STRING);
-		zbx_json_addstring(&json, ZBX_IPMI_TAG_NAME, h->sensors[i].full_name, ZBX_JSON_TYPE_STRING);
-
-		zbx_json_addobject(&json, ZBX_IPMI_TAG_SENSOR);
-		zbx_json_adduint64(&json, ZBX_IPMI_TAG_TYPE, (zbx_uint64_t)h->sensors[i].type);
-		p = ipmi_sensor_get_sensor_type_string(h->sensors[i].sensor);
-		zbx_json_addstring(&json, ZBX_IPMI_TAG_TEXT, p,	ZBX_JSON_TYPE_STRING);
-		zbx_json_close(&json);
-
-		zbx_json_addobject(&json, ZBX_IPMI_TAG_READING);
-		zbx_json_adduint64(&json, ZBX_IPMI_TAG_TYPE, (zbx_uint64_t)h->sensors[i].reading_type);
-		p = ipmi_sensor_get_event_reading_type_string(h->sensors[i].sensor);
-		zbx_json_addstring(&json, ZBX_IPMI_TAG_TEXT, p,	ZBX_JSON_TYPE_STRING);
-		zbx_json_close(&json);
-
-		if (IPMI_EVENT_READING_TYPE_THRESHOLD != h->sensors[i].reading_type)	/* discrete */
-		{
-			state = h->sensors[i].value.discrete;
-			zbx_json_addobject(&json, ZBX_IPMI_TAG_STATE);
-			zbx_json_adduint64(&json, ZBX_IPMI_TAG_STATE, state);
-
-			state_name[0] = '\0';
-			for (j = 0; j < MAX_DISCRETE_STATES; j++)
-			{
-				if (0 != (state & (1u << j)))
+				if (NULL != (p = ipmi_sensor_reading_name_string(s->sensor, j)))
 				{
-					if (NULL != (p = ipmi_sensor_reading_name_string(h->sensors[i].sensor, j)))
+					if (0 < offset)
 					{
-						if (0 < offset)
-							offset += zbx_snprintf(state_name + offset,
-									sizeof(state_name) - offset,", ");
 						offset += zbx_snprintf(state_name + offset, sizeof(state_name) - offset,
-								"%s", p);
+								", ");
 					}
+					offset += zbx_snprintf(state_name + offset, sizeof(state_name) - offset, "%s",
+							p);
 				}
 			}
-
-			zbx_json_addstring(&json, ZBX_IPMI_TAG_TEXT, state_name, ZBX_JSON_TYPE_STRING);
-			zbx_json_close(&json);
 		}
-		else	/* threshold */
-		{
-			char	*units;
 
-			state = (zbx_uint64_t)h->sensors[i].state;
-			zbx_json_addobject(&json, ZBX_IPMI_TAG_STATE);
-			zbx_json_adduint64(&json, ZBX_IPMI_TAG_STATE, state);
+		zbx_json_addstring(json, ZBX_IPMI_TAG_TEXT, state_name, ZBX_JSON_TYPE_STRING);
+		zbx_json_close(json);
+	}
+	else	/* threshold */
+	{
+		char	*units;
+
+		state = (zbx_uint64_t)s->state;
+		zbx_json_addobject(json, ZBX_IPMI_TAG_STATE);
+		zbx_json_adduint64(json, ZBX_IPMI_TAG_STATE, state);
 
-			state_name[0] = '\0';
-			for (j = IPMI_LOWER_NON_CRITICAL; j <= IPMI_UPPER_NON_RECOVERABLE; j++)
+		state_name[0] = '\0';
+		for (j = IPMI_LOWER_NON_CRITICAL; j <= IPMI_UPPER_NON_RECOVERABLE; j++)
+		{
+			if (0 != (state & (1u << j)))
 			{
-				if (0 != (state & (1u << j)))
-				{
-					if (0 < offset)
-						offset += zbx_snprintf(state_name + offset,
-								sizeof(state_name) - offset,", ");
-					offset += zbx_snprintf(state_name + offset, sizeof(state_name) - offset,
-							"%s - out of range", ipmi_get_threshold_string(j));
-				}
+				if (0 < offset)
+					offset += zbx_snprintf(state_name + offset, sizeof(state_name) - offset, ", ");
+				offset += zbx_snprintf(state_name + offset, sizeof(state_name) - offset,
+						"%s - out of range", ipmi_get_threshold_string(j));
 			}
+		}
 
-			zbx_json_addstring(&json, ZBX_IPMI_TAG_TEXT, state_name, ZBX_JSON_TYPE_STRING);
-			zbx_json_close(&json);
-
-			zbx_json_addfloat(&json, ZBX_IPMI_TAG_VALUE, h->sensors[i].value.threshold);
-
-			units = zbx_get_ipmi_units(h->sensors[i].sensor);
-			zbx_json_addstring(&json, ZBX_IPMI_TAG_UNITS, units, ZBX_JSON_TYPE_STRING);
-			zbx_free(units);
+		zbx_json_addstring(json, ZBX_IPMI_TAG_TEXT, state_name, ZBX_JSON_TYPE_STRING);
+		zbx_json_close(json);
 
-			zbx_read_ipmi_thresholds(h, &h->sensors[i]);
+		zbx_json_addfloat(json, ZBX_IPMI_TAG_VALUE, s->value.threshold);
 
-			zbx_json_addobject(&json, ZBX_IPMI_TAG_THRESHOLD);
-			zbx_json_addobject(&json, ZBX_IPMI_TAG_LOWER);
+		units = zbx_get_ipmi_units(s->sensor);
+		zbx_json_addstring(json, ZBX_IPMI_TAG_UNITS, units, ZBX_JSON_TYPE_STRING);
+		zbx_free(units);
 
-			add_threshold_ipmi(&json,ZBX_IPMI_TAG_NON_CRIT,
-					&h->sensors[i].thresholds[IPMI_LOWER_NON_CRITICAL]);
-			add_threshold_ipmi(&json,ZBX_IPMI_TAG_CRIT,
-					&h->sensors[i].thresholds[IPMI_LOWER_CRITICAL]);
-			add_threshold_ipmi(&json,ZBX_IPMI_TAG_NON_RECOVER,
-					&h->sensors[i].thresholds[IPMI_LOWER_NON_RECOVERABLE]);
+		zbx_json_addobject(json, ZBX_IPMI_TAG_THRESHOLD);
+		zbx_json_addobject(json, ZBX_IPMI_TAG_LOWER);
 
-			zbx_json_close(&json);
+		add_threshold_ipmi(json, ZBX_IPMI_TAG_NON_CRIT, &s->thresholds[IPMI_LOWER_NON_CRITICAL]);
+		add_threshold_ipmi(json, ZBX_IPMI_TAG_CRIT, &s->thresholds[IPMI_LOWER_CRITICAL]);
+		add_threshold_ipmi(json, ZBX_IPMI_TAG_NON_RECOVER, &s->thresholds[IPMI_LOWER_NON_RECOVERABLE]);
 
-			zbx_json_addobject(&json, ZBX_IPMI_TAG_UPPER);
+		zbx_json_close(json);
 
-			add_threshold_ipmi(&json,ZBX_IPMI_TAG_NON_CRIT,
-					&h->sensors[i].thresholds[IPMI_UPPER_NON_CRITICAL]);
-			add_threshold_ipmi(&json,ZBX_IPMI_TAG_CRIT,
-					&h->sensors[i].thresholds[IPMI_UPPER_CRITICAL]);
-			add_threshold_ipmi(&json,ZBX_IPMI_TAG_NON_RECOVER,
-					&h->sensors[i].thresholds[IPMI_UPPER_NON_RECOVERABLE]);
+		zbx_json_addobject(json, ZBX_IPMI_TAG_UPPER);
 
-			zbx_json_close(&json);
-			zbx_json_close(&json);
-		}
-		zbx_json_close(&json);
+		add_threshold_ipmi(json, ZBX_IPMI_TAG_NON_CRIT, &s->thresholds[IPMI_UPPER_NON_CRITICAL]);
+		add_threshold_ipmi(json, ZBX_IPMI_TAG_CRIT, &s->thresholds[IPMI_UPPER_CRITICAL]);
+		add_threshold_ipmi(json, ZBX_IPMI_TAG_NON_RECOVER, &s->thresholds[IPMI_UPPER_NON_RECOVERABLE]);
 
+		zbx_json_close(json);
+		zbx_json_close(json);
 	}
-	zbx_json_close(&json);
-
-	*value = zbx_strdup(*value, json.buffer);
-
-	zbx_json_free(&json);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() value:%s", __func__, ZBX_NULL2EMPTY_STR(*value));
-
-	return SUCCEED;
+	zbx_json_close(json);
 }
 
 /* function 'zbx_parse_ipmi_command' requires 'c_name' with size 'ITEM_IPMI_SENSOR_LEN_MAX' */
@@ -2019,62 +1999,462 @@ fail:
 	return ret;
 }
 
-int	zbx_set_ipmi_control_value(zbx_uint64_t hostid, const char *addr, unsigned short port, signed char authtype,
-		unsigned char privilege, const char *username, const char *password, const char *sensor,
-		int value, char **error)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_ipmi_async_create                                            *
+ *                                                                            *
+ * Purpose: creates asynchronous IPMI request                                 *
+ *                                                                            *
+ * Parameters: type      - [IN] the request type, see ZBX_IPMI_ASYNC_* defines *
+ *             objectid  - [IN] the item or host identifier (for logging)     *
+ *             addr      - [IN] the IPMI interface address                    *
+ *             port      - [IN] the IPMI interface port                       *
+ *             authtype  - [IN] the IPMI authentication type                  *
+ *             privilege - [IN] the IPMI privilege level                      *
+ *             username  - [IN] the IPMI user name                            *
+ *             password  - [IN] the IPMI password                             *
+ *             sensor    - [IN] the sensor or control name                    *
+ *             command   - [IN] the control value to set                      *
+ *                                                                            *
+ * Return value: The created request.                                         *
+ *                                                                            *
+ ******************************************************************************/
+zbx_ipmi_async_t	*zbx_ipmi_async_create(unsigned char type, zbx_uint64_t objectid, const char *addr,
+		unsigned short port, signed char authtype, unsigned char privilege, const char *username,
+		const char *password, const char *sensor, int command)
 {
-	zbx_ipmi_host_t		*h;
-	zbx_ipmi_control_t	*c;
+	zbx_ipmi_async_t	*async;
+
+	async = (zbx_ipmi_async_t *)zbx_malloc(NULL, sizeof(zbx_ipmi_async_t));
+	memset(async, 0, sizeof(zbx_ipmi_async_t));
+
+	async->type = type;
+	async->state = ZBX_IPMI_ASYNC_STATE_INIT;
+	async->objectid = objectid;
+	async->addr = zbx_strdup(NULL, addr);
+	async->port = port;
+	async->authtype = authtype;
+	async->privilege = privilege;
+	async->username = zbx_strdup(NULL, username);
+	async->password = zbx_strdup(NULL, password);
+	async->sensor = zbx_strdup(NULL, sensor);
+	async->command = command;
+	async->errcode = SUCCEED;
+
+	if (ZBX_IPMI_ASYNC_DISCOVERY == type)
+		zbx_json_initarray(&async->json, ZBX_JSON_STAT_BUF_LEN);
+
+	return async;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_ipmi_async_free                                              *
+ *                                                                            *
+ * Purpose: frees asynchronous IPMI request                                   *
+ *                                                                            *
+ * Comments: Only finished or not started requests can be freed.              *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_ipmi_async_free(zbx_ipmi_async_t *async)
+{
+	if (ZBX_IPMI_ASYNC_DISCOVERY == async->type)
+		zbx_json_free(&async->json);
+
+	zbx_free(async->addr);
+	zbx_free(async->username);
+	zbx_free(async->password);
+	zbx_free(async->sensor);
+	zbx_free(async->value);
+	zbx_free(async);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ipmi_async_finish                                                *
+ *                                                                            *
+ * Purpose: finishes asynchronous IPMI request and releases its host          *
+ *                                                                            *
+ * Parameters: async   - [IN] the request                                     *
+ *             errcode - [IN] the result error code                           *
+ *             value   - [IN] the resulting value or error message (optional) *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipmi_async_finish(zbx_ipmi_async_t *async, int errcode, const char *value)
+{
+	async->state = ZBX_IPMI_ASYNC_STATE_DONE;
+	async->errcode = errcode;
+
+	if (NULL != value)
+		async->value = zbx_strdup(async->value, value);
+
+	if (NULL != async->host)
+		async->host->busy = 0;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() objectid:" ZBX_FS_UI64 " errcode:%d value:%s", __func__, async->objectid,
+			errcode, ZBX_NULL2EMPTY_STR(async->value));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ipmi_async_finish_host                                           *
+ *                                                                            *
+ * Purpose: finishes asynchronous IPMI request with the result of the last    *
+ *          operation performed on the host                                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipmi_async_finish_host(zbx_ipmi_async_t *async)
+{
+	ipmi_async_finish(async, async->host->ret, async->host->err);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ipmi_async_find                                                  *
+ *                                                                            *
+ * Purpose: finds the sensor or control requested by asynchronous request     *
+ *                                                                            *
+ * Parameters: async - [IN] the request                                       *
+ *             s     - [OUT] the sensor, NULL if control was found            *
+ *             c     - [OUT] the control, NULL if sensor was found            *
+ *                                                                            *
+ * Comments: The sensors and controls can be reallocated by OpenIPMI          *
+ *           callbacks, so they are searched again after every operation.     *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipmi_async_find(const zbx_ipmi_async_t *async, zbx_ipmi_sensor_t **s, zbx_ipmi_control_t **c)
+{
+	const zbx_ipmi_host_t	*h = async->host;
 	size_t			offset;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() hostid:" ZBX_FS_UI64 "control:%s value:%d",
-			__func__, hostid, sensor, value);
+	*s = NULL;
+	*c = NULL;
 
-	if (NULL == os_hnd)
+	if (0 == has_name_prefix(async->sensor, &offset))
 	{
-		*error = zbx_strdup(*error, "IPMI handler is not initialized.");
-		zabbix_log(LOG_LEVEL_DEBUG, "%s", *error);
-		return NOTSUPPORTED;
+		if (ZBX_IPMI_ASYNC_COMMAND == async->type ||
+				NULL == (*s = zbx_get_ipmi_sensor_by_id(h, async->sensor + offset)))
+		{
+			*c = zbx_get_ipmi_control_by_name(h, async->sensor + offset);
+		}
+	}
+	else
+	{
+		if (ZBX_IPMI_ASYNC_COMMAND == async->type ||
+				NULL == (*s = zbx_get_ipmi_sensor_by_full_name(h, async->sensor + offset)))
+		{
+			*c = zbx_get_ipmi_control_by_full_name(h, async->sensor + offset);
+		}
 	}
+}
 
-	h = zbx_init_ipmi_host(addr, port, authtype, privilege, username, password);
+/******************************************************************************
+ *                                                                            *
+ * Function: ipmi_async_discover_next                                         *
+ *                                                                            *
+ * Purpose: starts reading the next sensor to be discovered or finishes the   *
+ *          discovery request when all sensors are processed                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipmi_async_discover_next(zbx_ipmi_async_t *async)
+{
+	zbx_ipmi_host_t	*h = async->host;
 
-	if (0 == h->domain_up)
+	while (++async->sensor_index < h->sensor_count)
 	{
-		if (NULL != h->err)
+		if (SUCCEED == zbx_read_ipmi_sensor(h, &h->sensors[async->sensor_index]))
 		{
-			*error = zbx_strdup(*error, h->err);
-			zabbix_log(LOG_LEVEL_DEBUG, "%s", h->err);
+			async->state = ZBX_IPMI_ASYNC_STATE_READ;
+			return;
 		}
-		return h->ret;
+
+		zabbix_log(LOG_LEVEL_DEBUG, "Sensor '%s' cannot be discovered. Error: %s",
+				h->sensors[async->sensor_index].id, ZBX_NULL2EMPTY_STR(h->err));
 	}
 
-	if (0 == has_name_prefix(sensor, &offset))
-		c = zbx_get_ipmi_control_by_name(h, sensor + offset);
+	zbx_json_close(&async->json);
+	ipmi_async_finish(async, SUCCEED, async->json.buffer);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ipmi_async_discover_sensor                                       *
+ *                                                                            *
+ * Purpose: processes the completed sensor operation of discovery request     *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipmi_async_discover_sensor(zbx_ipmi_async_t *async)
+{
+	zbx_ipmi_host_t		*h = async->host;
+	zbx_ipmi_sensor_t	*s;
+
+	/* the sensor could have been removed while waiting for the operation to complete */
+	if (async->sensor_index >= h->sensor_count)
+		goto next;
+
+	s = &h->sensors[async->sensor_index];
+
+	if (SUCCEED != h->ret)
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "Sensor '%s' cannot be discovered. Error: %s", s->id,
+				ZBX_NULL2EMPTY_STR(h->err));
+		goto next;
+	}
+
+	if (ZBX_IPMI_ASYNC_STATE_READ == async->state && IPMI_EVENT_READING_TYPE_THRESHOLD == s->reading_type &&
+			SUCCEED == zbx_read_ipmi_thresholds(h, s))
+	{
+		async->state = ZBX_IPMI_ASYNC_STATE_THRESHOLDS;
+		return;
+	}
+
+	zbx_ipmi_discovery_add_sensor(&async->json, s);
+next:
+	ipmi_async_discover_next(async);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ipmi_async_start_operation                                       *
+ *                                                                            *
+ * Purpose: starts the requested operation after the host domain is up        *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipmi_async_start_operation(zbx_ipmi_async_t *async)
+{
+	zbx_ipmi_host_t		*h = async->host;
+	zbx_ipmi_sensor_t	*s;
+	zbx_ipmi_control_t	*c;
+	int			started;
+	char			*error;
+
+	if (ZBX_IPMI_ASYNC_DISCOVERY == async->type)
+	{
+		async->sensor_index = -1;
+		ipmi_async_discover_next(async);
+		return;
+	}
+
+	ipmi_async_find(async, &s, &c);
+
+	if (NULL == s && NULL == c)
+	{
+		if (ZBX_IPMI_ASYNC_COMMAND == async->type)
+		{
+			error = zbx_dsprintf(NULL, "Control \"%s\" at address \"%s:%d\" does not exist.", async->sensor,
+					h->ip, h->port);
+		}
+		else
+			error = zbx_dsprintf(NULL, "sensor or control %s@[%s]:%d does not exist", async->sensor, h->ip,
+					h->port);
+
+		ipmi_async_finish(async, NOTSUPPORTED, error);
+		zbx_free(error);
+		return;
+	}
+
+	if (ZBX_IPMI_ASYNC_COMMAND == async->type)
+		started = zbx_set_ipmi_control(h, c, async->command);
+	else if (NULL != s)
+		started = zbx_read_ipmi_sensor(h, s);
 	else
-		c = zbx_get_ipmi_control_by_full_name(h, sensor + offset);
+		started = zbx_read_ipmi_control(h, c);
 
-	if (NULL == c)
+	if (SUCCEED == started)
+		async->state = ZBX_IPMI_ASYNC_STATE_READ;
+	else
+		ipmi_async_finish_host(async);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ipmi_async_finish_read                                           *
+ *                                                                            *
+ * Purpose: finishes value or command request after its operation completed  *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipmi_async_finish_read(zbx_ipmi_async_t *async)
+{
+	zbx_ipmi_host_t		*h = async->host;
+	zbx_ipmi_sensor_t	*s;
+	zbx_ipmi_control_t	*c;
+	char			*value;
+
+	if (SUCCEED != h->ret || ZBX_IPMI_ASYNC_COMMAND == async->type)
+	{
+		ipmi_async_finish_host(async);
+		return;
+	}
+
+	ipmi_async_find(async, &s, &c);
+
+	if (NULL != s)
+	{
+		if (IPMI_EVENT_READING_TYPE_THRESHOLD == s->reading_type)
+			value = zbx_dsprintf(NULL, ZBX_FS_DBL, s->value.threshold);
+		else
+			value = zbx_dsprintf(NULL, ZBX_FS_UI64, s->value.discrete);
+
+		ipmi_async_finish(async, SUCCEED, value);
+	}
+	else if (NULL != c)
 	{
-		*error = zbx_dsprintf(*error, "Control \"%s\" at address \"%s:%d\" does not exist.", sensor, h->ip, h->port);
-		zabbix_log(LOG_LEVEL_DEBUG, "%s", *error);
-		return NOTSUPPORTED;
+		value = zbx_dsprintf(NULL, "%d", c->val[0]);
+		ipmi_async_finish(async, SUCCEED, value);
 	}
+	else
+	{
+		value = zbx_dsprintf(NULL, "sensor or control %s@[%s]:%d does not exist", async->sensor, h->ip,
+				h->port);
+		ipmi_async_finish(async, NOTSUPPORTED, value);
+	}
+
+	zbx_free(value);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_ipmi_async_start                                             *
+ *                                                                            *
+ * Purpose: starts asynchronous IPMI request                                  *
+ *                                                                            *
+ * Parameters: async   - [IN] the request                                     *
+ *             timeout - [IN] the request timeout in seconds                  *
+ *                                                                            *
+ * Return value: SUCCEED - the request was started or finished immediately    *
+ *               FAIL    - the IPMI host is being used by another request,    *
+ *                         the request must be started later                  *
+ *                                                                            *
+ * Comments: Only one request is processed for an IPMI host at a time, while  *
+ *           requests for different hosts run concurrently in the OpenIPMI    *
+ *           event loop driven by zbx_perform_openipmi_op().                  *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_ipmi_async_start(zbx_ipmi_async_t *async, int timeout)
+{
+	zbx_ipmi_host_t	*h;
 
-	zbx_set_ipmi_control(h, c, value);
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() objectid:" ZBX_FS_UI64 " type:%d", __func__, async->objectid,
+			(int)async->type);
+
+	if (NULL == os_hnd)
+	{
+		ipmi_async_finish(async, ZBX_IPMI_ASYNC_COMMAND == async->type ? NOTSUPPORTED : CONFIG_ERROR,
+				"IPMI handler is not initialised.");
+		goto out;
+	}
 
-	if (h->ret != SUCCEED)
+	if (NULL != (h = zbx_get_ipmi_host(async->addr, async->port, async->authtype, async->privilege,
+			async->username, async->password)))
 	{
-		if (NULL != h->err)
+		/* wait for the operation of timed out request to complete before reusing the host */
+		if (0 != h->busy || (0 != h->expired && 0 == h->done))
 		{
-			*error = zbx_strdup(*error, h->err);
-			zabbix_log(LOG_LEVEL_DEBUG, "%s", h->err);
+			zabbix_log(LOG_LEVEL_DEBUG, "End of %s(): host is busy", __func__);
+			return FAIL;
 		}
+
+		h->expired = 0;
+	}
+	else
+	{
+		h = zbx_allocate_ipmi_host(async->addr, async->port, async->authtype, async->privilege,
+				async->username, async->password);
+	}
+
+	h->busy = 1;
+	h->lastaccess = time(NULL);
+
+	async->host = h;
+	async->expire = zbx_time() + timeout;
+
+	if (1 == h->domain_up)
+		ipmi_async_start_operation(async);
+	else if (SUCCEED == zbx_connect_ipmi_host(h))
+		async->state = ZBX_IPMI_ASYNC_STATE_CONNECT;
+	else
+		ipmi_async_finish_host(async);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() state:%d", __func__, (int)async->state);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_ipmi_async_check                                             *
+ *                                                                            *
+ * Purpose: advances asynchronous IPMI request after OpenIPMI events were     *
+ *          processed                                                         *
+ *                                                                            *
+ * Parameters: async - [IN] the request                                       *
+ *             now   - [IN] the current time                                  *
+ *                                                                            *
+ * Return value: SUCCEED - the request is finished                            *
+ *               FAIL    - the request is still in progress                   *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_ipmi_async_check(zbx_ipmi_async_t *async, double now)
+{
+	zbx_ipmi_host_t	*h = async->host;
+	char		*error;
+
+	if (ZBX_IPMI_ASYNC_STATE_DONE == async->state)
+		return SUCCEED;
+
+	if (0 == h->done)
+	{
+		if (now < async->expire)
+			return FAIL;
+
+		/* the host stays reserved until OpenIPMI completes the pending operation */
+		h->expired = 1;
+
+		error = zbx_dsprintf(NULL, "Timeout while waiting for IPMI host [%s]:%d.", h->ip, h->port);
+		ipmi_async_finish(async, TIMEOUT_ERROR, error);
+		zbx_free(error);
+
+		return SUCCEED;
+	}
+
+	switch (async->state)
+	{
+		case ZBX_IPMI_ASYNC_STATE_CONNECT:
+			if (0 == h->domain_up)
+				ipmi_async_finish_host(async);
+			else
+				ipmi_async_start_operation(async);
+			break;
+		case ZBX_IPMI_ASYNC_STATE_READ:
+		case ZBX_IPMI_ASYNC_STATE_THRESHOLDS:
+			if (ZBX_IPMI_ASYNC_DISCOVERY == async->type)
+				ipmi_async_discover_sensor(async);
+			else
+				ipmi_async_finish_read(async);
+			break;
 	}
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);\
+	return ZBX_IPMI_ASYNC_STATE_DONE == async->state ? SUCCEED : FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_ipmi_async_result                                            *
+ *                                                                            *
+ * Purpose: returns the result of finished asynchronous IPMI request          *
+ *                                                                            *
+ * Parameters: async - [IN] the request                                       *
+ *             value - [OUT] the resulting value or error message, can be     *
+ *                           NULL                                             *
+ *                                                                            *
+ * Return value: The result error code.                                       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_ipmi_async_result(const zbx_ipmi_async_t *async, const char **value)
+{
+	*value = async->value;
 
-	return h->ret;
+	return async->errcode;
 }
 
 #endif	/* HAVE_OPENIPMI */
@@ -30,21 +30,26 @@
 int	zbx_init_ipmi_handler(void);
 void	zbx_free_ipmi_handler(void);
 
-int	get_value_ipmi(zbx_uint64_t itemid, const char *addr, unsigned short port, signed char authtype,
-		unsigned char privilege, const char *username, const char *password, const char *sensor, char **value);
+#define ZBX_IPMI_ASYNC_VALUE		0
+#define ZBX_IPMI_ASYNC_DISCOVERY	1
+#define ZBX_IPMI_ASYNC_COMMAND		2
 
-int	get_discovery_ipmi(zbx_uint64_t itemid, const char *addr, unsigned short port, signed char authtype,
-		unsigned char privilege, const char *username, const char *password, char **value);
+typedef struct zbx_ipmi_async zbx_ipmi_async_t;
 
-int	zbx_parse_ipmi_command(const char *command, char *c_name, int *val, char *error, size_t max_error_len);
+zbx_ipmi_async_t	*zbx_ipmi_async_create(unsigned char type, zbx_uint64_t objectid, const char *addr,
+		unsigned short port, signed char authtype, unsigned char privilege, const char *username,
+		const char *password, const char *sensor, int command);
+void	zbx_ipmi_async_free(zbx_ipmi_async_t *async);
+int	zbx_ipmi_async_start(zbx_ipmi_async_t *async, int timeout);
+int	zbx_ipmi_async_check(zbx_ipmi_async_t *async, double now);
+int	zbx_ipmi_async_result(const zbx_ipmi_async_t *async, const char **value);
 
-int	zbx_set_ipmi_control_value(zbx_uint64_t hostid, const char *addr, unsigned short port, signed char authtype,
-		unsigned char privilege, const char *username, const char *password, const char *sensor,
-		int value, char **error);
+int	zbx_parse_ipmi_command(const char *command, char *c_name, int *val, char *error, size_t max_error_len);
 
 void	zbx_delete_inactive_ipmi_hosts(time_t last_check);
 
 void	zbx_perform_all_openipmi_ops(int timeout);
+void	zbx_perform_openipmi_op(int timeout_ms);
 
 #endif	/* HAVE_OPENIPMI */
 
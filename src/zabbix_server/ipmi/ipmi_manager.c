@@ -51,6 +51,9 @@ extern int	CONFIG_IPMIPOLLER_FORKS;
 #define ZBX_IPMI_MANAGER_CLEANUP_DELAY		SEC_PER_HOUR
 #define ZBX_IPMI_MANAGER_HOST_TTL		SEC_PER_DAY
 
+/* the maximum number of requests processed concurrently by a poller */
+#define ZBX_IPMI_POLLER_REQUESTS_MAX		32
+
 /* IPMI request queued by pollers */
 typedef struct
 {
@@ -86,8 +89,8 @@ typedef struct
 	/* the request queue */
 	zbx_binary_heap_t	requests;
 
-	/* the currently processing request */
-	zbx_ipmi_request_t	*request;
+	/* the requests being processed by the poller */
+	zbx_vector_ptr_t	active;
 
 	/* the number of hosts handled by the poller */
 	int			hosts_num;
@@ -101,6 +104,9 @@ typedef struct
 	int			disable_until;
 	int			lastcheck;
 	zbx_ipmi_poller_t	*poller;
+
+	/* 1 if a request for the host is being processed by the poller, 0 otherwise */
+	int			busy;
 }
 zbx_ipmi_manager_host_t;
 
@@ -275,52 +281,65 @@ static void	ipmi_poller_push_request(zbx_ipmi_poller_t *poller, zbx_ipmi_request
  * Purpose: sends request to IPMI poller                                      *
  *                                                                            *
  * Parameters: poller  - [IN] the IPMI poller                                 *
- *             message - [IN] the message to send                             *
+ *             host    - [IN] the target host                                 *
+ *             request - [IN] the request to send                             *
+ *                                                                            *
+ * Comments: The request is prefixed with its identifier, which is returned   *
+ *           by poller together with the result as the poller can process     *
+ *           several requests concurrently.                                   *
  *                                                                            *
  ******************************************************************************/
-static void	ipmi_poller_send_request(zbx_ipmi_poller_t *poller, zbx_ipmi_request_t *request)
+static void	ipmi_poller_send_request(zbx_ipmi_poller_t *poller, zbx_ipmi_manager_host_t *host,
+		zbx_ipmi_request_t *request)
 {
-	if (FAIL == zbx_ipc_client_send(poller->client, request->message.code, request->message.data,
-			request->message.size))
+	unsigned char	*data;
+	zbx_uint32_t	data_len;
+
+	data_len = zbx_ipmi_serialize_requestid(&data, request->requestid, request->message.data,
+			request->message.size);
+
+	if (FAIL == zbx_ipc_client_send(poller->client, request->message.code, data, data_len))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "cannot send data to IPMI poller");
 		exit(EXIT_FAILURE);
 	}
 
-	poller->request = request;
-}
+	zbx_free(data);
 
-/******************************************************************************
- *                                                                            *
- * Function: ipmi_poller_schedule_request                                     *
- *                                                                            *
- * Purpose: schedules request to IPMI poller                                  *
- *                                                                            *
- * Parameters: poller  - [IN] the IPMI poller                                 *
- *             request - [IN] the request to send                             *
- *                                                                            *
- ******************************************************************************/
-static void	ipmi_poller_schedule_request(zbx_ipmi_poller_t *poller, zbx_ipmi_request_t *request)
-{
-	if (NULL == poller->request && NULL != poller->client)
-		ipmi_poller_send_request(poller, request);
-	else
-		ipmi_poller_push_request(poller, request);
+	zbx_vector_ptr_append(&poller->active, request);
+	host->busy = 1;
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: ipmi_poller_free_request                                         *
+ * Function: ipmi_poller_remove_request                                       *
  *                                                                            *
- * Purpose: frees the current request processed by IPMI poller                *
+ * Purpose: removes request processed by IPMI poller                          *
  *                                                                            *
- * Parameters: poller  - [IN] the IPMI poller                                 *
+ * Parameters: poller    - [IN] the IPMI poller                               *
+ *             requestid - [IN] the request identifier                        *
+ *                                                                            *
+ * Return value: The removed request or NULL if the poller is not processing  *
+ *               request with the specified identifier.                       *
  *                                                                            *
  ******************************************************************************/
-static void	ipmi_poller_free_request(zbx_ipmi_poller_t *poller)
+static zbx_ipmi_request_t	*ipmi_poller_remove_request(zbx_ipmi_poller_t *poller, zbx_uint64_t requestid)
 {
-	ipmi_request_free(poller->request);
-	poller->request = NULL;
+	int			i;
+	zbx_ipmi_request_t	*request;
+
+	for (i = 0; i < poller->active.values_num; i++)
+	{
+		request = (zbx_ipmi_request_t *)poller->active.values[i];
+
+		if (request->requestid == requestid)
+		{
+			zbx_vector_ptr_remove_noorder(&poller->active, i);
+			return request;
+		}
+	}
+
+	return NULL;
 }
 
 /******************************************************************************
@@ -341,6 +360,9 @@ static void	ipmi_poller_free(zbx_ipmi_poller_t *poller)
 
 	zbx_binary_heap_destroy(&poller->requests);
 
+	zbx_vector_ptr_clear_ext(&poller->active, (zbx_clean_func_t)ipmi_request_free);
+	zbx_vector_ptr_destroy(&poller->active);
+
 	zbx_free(poller);
 }
 
@@ -372,10 +394,10 @@ static void	ipmi_manager_init(zbx_ipmi_manager_t *manager)
 		poller = (zbx_ipmi_poller_t *)zbx_malloc(NULL, sizeof(zbx_ipmi_poller_t));
 
 		poller->client = NULL;
-		poller->request = NULL;
 		poller->hosts_num = 0;
 
 		zbx_binary_heap_create(&poller->requests, ipmi_request_compare, 0);
+		zbx_vector_ptr_create(&poller->active);
 
 		zbx_vector_ptr_append(&manager->pollers, poller);
 
@@ -560,45 +582,94 @@ static zbx_ipmi_poller_t	*ipmi_manager_get_host_poller(zbx_ipmi_manager_t *manag
  *             poller  - [IN] the IPMI poller                                 *
  *             now     - [IN] the current time                                *
  *                                                                            *
- * Comments: This function will send the next request in queue to the poller, *
- *           skipping requests for unreachable hosts for unreachable period.  *
+ * Comments: This function will send queued requests to the poller until it  *
+ *           is processing ZBX_IPMI_POLLER_REQUESTS_MAX requests, skipping    *
+ *           requests for unreachable hosts for unreachable period and        *
+ *           keeping in queue requests for hosts already being polled.        *
  *                                                                            *
  ******************************************************************************/
 static void	ipmi_manager_process_poller_queue(zbx_ipmi_manager_t *manager, zbx_ipmi_poller_t *poller, int now)
 {
 	zbx_ipmi_request_t	*request;
 	zbx_ipmi_manager_host_t	*host;
+	zbx_vector_ptr_t	requests_busy;
+	int			i;
 
-	while (NULL != (request = ipmi_poller_pop_request(poller)))
+	zbx_vector_ptr_create(&requests_busy);
+
+	while (ZBX_IPMI_POLLER_REQUESTS_MAX > poller->active.values_num &&
+			NULL != (request = ipmi_poller_pop_request(poller)))
 	{
-		switch (request->message.code)
+		if (NULL == (host = (zbx_ipmi_manager_host_t *)zbx_hashset_search(&manager->hosts,
+				&request->hostid)))
 		{
-			case ZBX_IPC_IPMI_COMMAND_REQUEST:
-			case ZBX_IPC_IPMI_CLEANUP_REQUEST:
-				break;
-			case ZBX_IPC_IPMI_VALUE_REQUEST:
-				if (NULL != request->client)
-					break;
+			THIS_SHOULD_NEVER_HAPPEN;
+
+			if (NULL != request->client)
+				zbx_ipc_client_release(request->client);
 
-				if (NULL == (host = (zbx_ipmi_manager_host_t *)zbx_hashset_search(&manager->hosts,
-						&request->hostid)))
-				{
-					THIS_SHOULD_NEVER_HAPPEN;
-					ipmi_request_free(request);
-					continue;
-				}
-				if (now < host->disable_until)
-				{
-					zbx_dc_requeue_unreachable_items(&request->itemid, 1);
-					ipmi_request_free(request);
-					continue;
-				}
-				break;
+			ipmi_request_free(request);
+			continue;
+		}
+
+		/* only one request per host is processed at a time */
+		if (0 != host->busy)
+		{
+			zbx_vector_ptr_append(&requests_busy, request);
+			continue;
+		}
+
+		if (ZBX_IPC_IPMI_VALUE_REQUEST == request->message.code && NULL == request->client &&
+				now < host->disable_until)
+		{
+			zbx_dc_requeue_unreachable_items(&request->itemid, 1);
+			ipmi_request_free(request);
+			continue;
 		}
 
-		ipmi_poller_send_request(poller, request);
-		break;
+		ipmi_poller_send_request(poller, host, request);
 	}
+
+	for (i = 0; i < requests_busy.values_num; i++)
+		ipmi_poller_push_request(poller, (zbx_ipmi_request_t *)requests_busy.values[i]);
+
+	zbx_vector_ptr_destroy(&requests_busy);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ipmi_manager_finish_request                                      *
+ *                                                                            *
+ * Purpose: finds the request of the result received from IPMI poller and     *
+ *          releases its host                                                 *
+ *                                                                            *
+ * Parameters: manager - [IN] the IPMI manager                                *
+ *             poller  - [IN] the IPMI poller                                 *
+ *             message - [IN] the result message                              *
+ *             data    - [OUT] the result data following request identifier   *
+ *                                                                            *
+ * Return value: The finished request or NULL if it was not found.            *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_ipmi_request_t	*ipmi_manager_finish_request(zbx_ipmi_manager_t *manager, zbx_ipmi_poller_t *poller,
+		const zbx_ipc_message_t *message, const unsigned char **data)
+{
+	zbx_ipmi_request_t	*request;
+	zbx_ipmi_manager_host_t	*host;
+	zbx_uint64_t		requestid;
+
+	*data = zbx_ipmi_deserialize_requestid(message->data, &requestid);
+
+	if (NULL == (request = ipmi_poller_remove_request(poller, requestid)))
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		return NULL;
+	}
+
+	if (NULL != (host = (zbx_ipmi_manager_host_t *)zbx_hashset_search(&manager->hosts, &request->hostid)))
+		host->busy = 0;
+
+	return request;
 }
 
 /******************************************************************************
@@ -626,6 +697,7 @@ static zbx_ipmi_manager_host_t	*ipmi_manager_cache_host(zbx_ipmi_manager_t *mana
 		host = (zbx_ipmi_manager_host_t *)zbx_hashset_insert(&manager->hosts, &host_local, sizeof(host_local));
 
 		host->disable_until = 0;
+		host->busy = 0;
 		host->poller = ipmi_manager_get_host_poller(manager);
 	}
 
@@ -750,7 +822,14 @@ static void	ipmi_manager_schedule_request(zbx_ipmi_manager_t *manager, zbx_uint6
 	zbx_ipmi_manager_host_t	*host;
 
 	host = ipmi_manager_cache_host(manager, hostid, now);
-	ipmi_poller_schedule_request(host->poller, request);
+
+	if (NULL != host->poller->client && 0 == host->busy &&
+			ZBX_IPMI_POLLER_REQUESTS_MAX > host->poller->active.values_num)
+	{
+		ipmi_poller_send_request(host->poller, host, request);
+	}
+	else
+		ipmi_poller_push_request(host->poller, request);
 }
 
 /******************************************************************************
@@ -832,7 +911,7 @@ static void	ipmi_manager_process_client_request(zbx_ipmi_manager_t *manager, zbx
 
 	zbx_ipc_client_addref(client);
 
-	request = ipmi_request_create(0);
+	request = ipmi_request_create(hostid);
 	request->client = client;
 	zbx_ipc_message_copy(&request->message, message);
 	request->message.code = code;
@@ -842,10 +921,31 @@ static void	ipmi_manager_process_client_request(zbx_ipmi_manager_t *manager, zbx
 
 /******************************************************************************
  *                                                                            *
- * Function: ipmi_manager_process_client_result                               *
+ * Function: ipmi_manager_forward_client_result                               *
  *                                                                            *
  * Purpose: forwards result of request to the client                          *
  *                                                                            *
+ * Parameters: request - [IN] the finished client request                     *
+ *             message - [IN] the result message                              *
+ *             data    - [IN] the result data following request identifier   *
+ *             code    - [IN] the result message code                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipmi_manager_forward_client_result(zbx_ipmi_request_t *request, const zbx_ipc_message_t *message,
+		const unsigned char *data, int code)
+{
+	if (SUCCEED == zbx_ipc_client_connected(request->client))
+		zbx_ipc_client_send(request->client, code, data, message->size - (zbx_uint32_t)(data - message->data));
+
+	zbx_ipc_client_release(request->client);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ipmi_manager_process_client_result                               *
+ *                                                                            *
+ * Purpose: forwards result of command request to the client                  *
+ *                                                                            *
  * Parameters: manager - [IN] the IPMI manager                                *
  *             client  - [IN] the IPMI poller client                          *
  *             message - [IN] the command result message                      *
@@ -857,6 +957,8 @@ static void	ipmi_manager_process_client_result(zbx_ipmi_manager_t *manager, zbx_
 		zbx_ipc_message_t *message, int now, int code)
 {
 	zbx_ipmi_poller_t	*poller;
+	zbx_ipmi_request_t	*request;
+	const unsigned char	*data;
 
 	if (NULL == (poller = ipmi_manager_get_poller_by_client(manager, client)))
 	{
@@ -864,13 +966,12 @@ static void	ipmi_manager_process_client_result(zbx_ipmi_manager_t *manager, zbx_
 		return;
 	}
 
-	if (SUCCEED == zbx_ipc_client_connected(poller->request->client))
+	if (NULL != (request = ipmi_manager_finish_request(manager, poller, message, &data)))
 	{
-		zbx_ipc_client_send(poller->request->client, code, message->data, message->size);
-		zbx_ipc_client_release(poller->request->client);
+		ipmi_manager_forward_client_result(request, message, data, code);
+		ipmi_request_free(request);
 	}
 
-	ipmi_poller_free_request(poller);
 	ipmi_manager_process_poller_queue(manager, poller, now);
 }
 
@@ -895,8 +996,10 @@ static void	ipmi_manager_process_value_result(zbx_ipmi_manager_t *manager, zbx_i
 	int			errcode;
 	AGENT_RESULT		result;
 	zbx_ipmi_poller_t	*poller;
+	zbx_ipmi_request_t	*request;
 	zbx_uint64_t		itemid;
 	unsigned char		flags;
+	const unsigned char	*data;
 
 	if (NULL == (poller = ipmi_manager_get_poller_by_client(manager, client)))
 	{
@@ -904,16 +1007,19 @@ static void	ipmi_manager_process_value_result(zbx_ipmi_manager_t *manager, zbx_i
 		return;
 	}
 
-	if (NULL != poller->request->client)
+	if (NULL == (request = ipmi_manager_finish_request(manager, poller, message, &data)))
+		goto out;
+
+	if (NULL != request->client)
 	{
-		ipmi_manager_process_client_result(manager, client, message, now, ZBX_IPC_IPMI_VALUE_RESULT);
-		return;
+		ipmi_manager_forward_client_result(request, message, data, ZBX_IPC_IPMI_VALUE_RESULT);
+		goto clean;
 	}
 
-	itemid = poller->request->itemid;
-	flags = poller->request->item_flags;
+	itemid = request->itemid;
+	flags = request->item_flags;
 
-	zbx_ipmi_deserialize_result(message->data, &ts, &errcode, &value);
+	zbx_ipmi_deserialize_result(data, &ts, &errcode, &value);
 
 	/* update host availability */
 	switch (errcode)
@@ -957,15 +1063,16 @@ static void	ipmi_manager_process_value_result(zbx_ipmi_manager_t *manager, zbx_i
 			break;
 		default:
 			/* don't change item's state when network related error occurs */
-			state = poller->request->item_state;
+			state = request->item_state;
 	}
 
 	zbx_free(value);
 
 	/* put back the item in configuration cache IPMI poller queue */
 	DCrequeue_items(&itemid, &state, &ts.sec, &errcode, 1);
-
-	ipmi_poller_free_request(poller);
+clean:
+	ipmi_request_free(request);
+out:
 	ipmi_manager_process_poller_queue(manager, poller, now);
 }
 
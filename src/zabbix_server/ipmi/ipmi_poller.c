@@ -36,6 +36,7 @@
 
 extern unsigned char	process_type, program_type;
 extern int		server_num, process_num;
+extern int		CONFIG_TIMEOUT;
 
 /******************************************************************************
  *                                                                            *
@@ -55,6 +56,23 @@ static void	ipmi_poller_register(zbx_ipc_async_socket_t *socket)
 	zbx_ipc_async_socket_send(socket, ZBX_IPC_IPMI_REGISTER, (unsigned char *)&ppid, sizeof(ppid));
 }
 
+/* the maximum time to wait for OpenIPMI events while there are requests in progress */
+#define ZBX_IPMI_POLLER_EVENT_TIMEOUT_MS	100
+
+typedef struct
+{
+	zbx_uint64_t		requestid;
+	zbx_uint32_t		code;
+	zbx_ipmi_async_t	*async;
+}
+zbx_ipmi_poller_request_t;
+
+static void	ipmi_poller_request_free(zbx_ipmi_poller_request_t *request)
+{
+	zbx_ipmi_async_free(request->async);
+	zbx_free(request);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: ipmi_poller_send_result                                          *
@@ -62,125 +80,160 @@ static void	ipmi_poller_register(zbx_ipc_async_socket_t *socket)
  * Purpose: sends IPMI poll result to manager                                 *
  *                                                                            *
  * Parameters: socket  - [IN] the connections socket                          *
- *             itemid  - [IN] the item identifier                             *
- *             errcode - [IN] the result error code                           *
- *             value   - [IN] the resulting value/error message               *
+ *             request - [IN] the finished request                            *
  *                                                                            *
  ******************************************************************************/
-static void	ipmi_poller_send_result(zbx_ipc_async_socket_t *socket, zbx_uint32_t code, int errcode,
-		const char *value)
+static void	ipmi_poller_send_result(zbx_ipc_async_socket_t *socket, const zbx_ipmi_poller_request_t *request)
 {
-	unsigned char	*data;
-	zbx_uint32_t	data_len;
+	unsigned char	*result, *data;
+	zbx_uint32_t	result_len, data_len;
 	zbx_timespec_t	ts;
+	const char	*value;
+	int		errcode;
+
+	errcode = zbx_ipmi_async_result(request->async, &value);
 
 	zbx_timespec(&ts);
-	data_len = zbx_ipmi_serialize_result(&data, &ts, errcode, value);
-	zbx_ipc_async_socket_send(socket, code, data, data_len);
+	result_len = zbx_ipmi_serialize_result(&result, &ts, errcode, value);
+	data_len = zbx_ipmi_serialize_requestid(&data, request->requestid, result, result_len);
+	zbx_ipc_async_socket_send(socket, request->code, data, data_len);
 
 	zbx_free(data);
+	zbx_free(result);
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: ipmi_poller_process_value_request                                *
+ * Function: ipmi_poller_process_request                                      *
  *                                                                            *
- * Purpose: gets IPMI sensor value from the specified host                    *
+ * Purpose: starts processing of IPMI value or command request                *
  *                                                                            *
- * Parameters: socket  - [IN] the connections socket                          *
- *             message - [IN] the value request message                       *
+ * Parameters: message - [IN] the request message                             *
+ *             active  - [IN/OUT] the requests in progress                    *
+ *             pending - [IN/OUT] the requests waiting for their IPMI host    *
  *                                                                            *
  ******************************************************************************/
-static void	ipmi_poller_process_value_request(zbx_ipc_async_socket_t *socket, zbx_ipc_message_t *message)
+static void	ipmi_poller_process_request(const zbx_ipc_message_t *message, zbx_vector_ptr_t *active,
+		zbx_vector_ptr_t *pending)
 {
-	zbx_uint64_t	itemid;
-	char		*addr, *username, *password, *sensor, *value = NULL, *key;
-	signed char	authtype;
-	unsigned char	privilege;
-	unsigned short	port;
-	int		errcode, command;
+	zbx_ipmi_poller_request_t	*request;
+	zbx_uint64_t			objectid;
+	char				*addr, *username, *password, *sensor, *key;
+	signed char			authtype;
+	unsigned char			privilege, type;
+	unsigned short			port;
+	int				command;
+	const unsigned char		*data;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
-	zbx_ipmi_deserialize_request(message->data, &itemid, &addr, &port, &authtype, &privilege, &username, &password,
+	request = (zbx_ipmi_poller_request_t *)zbx_malloc(NULL, sizeof(zbx_ipmi_poller_request_t));
+
+	data = zbx_ipmi_deserialize_requestid(message->data, &request->requestid);
+	zbx_ipmi_deserialize_request(data, &objectid, &addr, &port, &authtype, &privilege, &username, &password,
 			&sensor, &command, &key);
 
-	if (0 == strcmp(key, "ipmi.get") || 0 == strncmp(key, "ipmi.get[", ZBX_CONST_STRLEN("ipmi.get[")))
+	if (ZBX_IPC_IPMI_COMMAND_REQUEST == message->code)
 	{
-		zabbix_log(LOG_LEVEL_TRACE, "%s() for discovery itemid:" ZBX_FS_UI64 " addr:%s port:%d authtype:%d"
-				" privilege:%d username:%s", __func__, itemid, addr, (int)port, (int)authtype,
-				(int)privilege,	username);
-		errcode = get_discovery_ipmi(itemid, addr, port, authtype, privilege, username, password, &value);
-		ipmi_poller_send_result(socket, ZBX_IPC_IPMI_VALUE_RESULT, errcode, value);
+		request->code = ZBX_IPC_IPMI_COMMAND_RESULT;
+		type = ZBX_IPMI_ASYNC_COMMAND;
 	}
 	else
 	{
-		zabbix_log(LOG_LEVEL_TRACE, "%s() itemid:" ZBX_FS_UI64 " addr:%s port:%d authtype:%d privilege:%d"
-				" username:%s sensor:%s", __func__, itemid, addr, (int)port, (int)authtype,
-				(int)privilege, username, sensor);
-		errcode = get_value_ipmi(itemid, addr, port, authtype, privilege, username, password, sensor, &value);
-		ipmi_poller_send_result(socket, ZBX_IPC_IPMI_VALUE_RESULT, errcode, value);
+		request->code = ZBX_IPC_IPMI_VALUE_RESULT;
+
+		if (0 == strcmp(key, "ipmi.get") || 0 == strncmp(key, "ipmi.get[", ZBX_CONST_STRLEN("ipmi.get[")))
+			type = ZBX_IPMI_ASYNC_DISCOVERY;
+		else
+			type = ZBX_IPMI_ASYNC_VALUE;
 	}
 
-	zbx_free(value);
+	zabbix_log(LOG_LEVEL_TRACE, "%s() requestid:" ZBX_FS_UI64 " type:%d objectid:" ZBX_FS_UI64 " addr:%s port:%d"
+			" authtype:%d privilege:%d username:%s sensor:%s", __func__, request->requestid, (int)type,
+			objectid, addr, (int)port, (int)authtype, (int)privilege, username, sensor);
+
+	request->async = zbx_ipmi_async_create(type, objectid, addr, port, authtype, privilege, username, password,
+			sensor, command);
+
+	/* the IPMI host can still be used by a timed out request or shared by several Zabbix hosts */
+	if (SUCCEED == zbx_ipmi_async_start(request->async, CONFIG_TIMEOUT))
+		zbx_vector_ptr_append(active, request);
+	else
+		zbx_vector_ptr_append(pending, request);
+
 	zbx_free(addr);
 	zbx_free(username);
 	zbx_free(password);
 	zbx_free(sensor);
 	zbx_free(key);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() active:%d pending:%d", __func__, active->values_num,
+			pending->values_num);
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: ipmi_poller_process_command_request                              *
+ * Function: ipmi_poller_check_requests                                       *
  *                                                                            *
- * Purpose:sets IPMI sensor value                                             *
+ * Purpose: sends results of finished requests and starts pending requests    *
+ *          whose IPMI hosts were released                                    *
  *                                                                            *
  * Parameters: socket  - [IN] the connections socket                          *
- *             message - [IN] the command request message                     *
+ *             active  - [IN/OUT] the requests in progress                    *
+ *             pending - [IN/OUT] the requests waiting for their IPMI host    *
+ *                                                                            *
+ * Return value: The number of finished requests.                             *
  *                                                                            *
  ******************************************************************************/
-static void	ipmi_poller_process_command_request(zbx_ipc_async_socket_t *socket, zbx_ipc_message_t *message)
+static int	ipmi_poller_check_requests(zbx_ipc_async_socket_t *socket, zbx_vector_ptr_t *active,
+		zbx_vector_ptr_t *pending)
 {
-	zbx_uint64_t	itemid;
-	char		*addr, *username, *password, *sensor, *error = NULL, *key;
-	signed char	authtype;
-	unsigned char	privilege;
-	unsigned short	port;
-	int		errcode, command;
+	int				i, finished_num = 0;
+	double				now;
+	zbx_ipmi_poller_request_t	*request;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+	now = zbx_time();
 
-	zbx_ipmi_deserialize_request(message->data, &itemid, &addr, &port, &authtype, &privilege, &username, &password,
-			&sensor, &command, &key);
+	for (i = 0; i < active->values_num;)
+	{
+		request = (zbx_ipmi_poller_request_t *)active->values[i];
 
-	zabbix_log(LOG_LEVEL_TRACE, "%s() hostid:" ZBX_FS_UI64 " addr:%s port:%d authtype:%d privilege:%d username:%s"
-			" sensor:%s", __func__, itemid, addr, (int)port, (int)authtype, (int)privilege,
-			username, sensor);
+		if (SUCCEED != zbx_ipmi_async_check(request->async, now))
+		{
+			i++;
+			continue;
+		}
 
-	errcode = zbx_set_ipmi_control_value(itemid, addr, port, authtype, privilege, username, password, sensor,
-			command, &error);
+		ipmi_poller_send_result(socket, request);
+		ipmi_poller_request_free(request);
+		zbx_vector_ptr_remove(active, i);
+		finished_num++;
+	}
 
-	ipmi_poller_send_result(socket, ZBX_IPC_IPMI_COMMAND_RESULT, errcode, error);
+	for (i = 0; i < pending->values_num;)
+	{
+		request = (zbx_ipmi_poller_request_t *)pending->values[i];
 
-	zbx_free(error);
-	zbx_free(addr);
-	zbx_free(username);
-	zbx_free(password);
-	zbx_free(sensor);
-	zbx_free(key);
+		if (SUCCEED != zbx_ipmi_async_start(request->async, CONFIG_TIMEOUT))
+		{
+			i++;
+			continue;
+		}
+
+		zbx_vector_ptr_append(active, request);
+		zbx_vector_ptr_remove(pending, i);
+	}
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	return finished_num;
 }
 
 ZBX_THREAD_ENTRY(ipmi_poller_thread, args)
 {
 	char			*error = NULL;
 	zbx_ipc_async_socket_t	ipmi_socket;
-	int			polled_num = 0;
+	int			polled_num = 0, cleanup = 0;
 	double			time_stat, time_idle = 0, time_now, time_read;
+	zbx_vector_ptr_t	active, pending;
 
 #define	STAT_INTERVAL	5	/* if a process is busy and does not sleep then update status not faster than */
 				/* once in STAT_INTERVAL seconds */
@@ -206,6 +259,9 @@ ZBX_THREAD_ENTRY(ipmi_poller_thread, args)
 
 	zbx_init_ipmi_handler();
 
+	zbx_vector_ptr_create(&active);
+	zbx_vector_ptr_create(&pending);
+
 	ipmi_poller_register(&ipmi_socket);
 
 	time_stat = zbx_time();
@@ -229,48 +285,94 @@ ZBX_THREAD_ENTRY(ipmi_poller_thread, args)
 			polled_num = 0;
 		}
 
-		update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
-
-		while (ZBX_IS_RUNNING())
+		/* closing IPMI hosts blocks the poller, it is done when no requests are in progress */
+		if (0 != cleanup && 0 == active.values_num && 0 == pending.values_num)
 		{
-			const int ipc_timeout = 2;
-			const int ipmi_timeout = 1;
+			zbx_delete_inactive_ipmi_hosts(time(NULL));
+			cleanup = 0;
+		}
 
-			if (SUCCEED != zbx_ipc_async_socket_recv(&ipmi_socket, ipc_timeout, &message))
+		if (0 != active.values_num)
+		{
+			/* poll the manager without blocking while OpenIPMI operations are in progress */
+			if (SUCCEED != zbx_ipc_async_socket_recv(&ipmi_socket, 0, &message))
 			{
 				zabbix_log(LOG_LEVEL_CRIT, "cannot read IPMI service request");
 				exit(EXIT_FAILURE);
 			}
 
-			if (NULL != message)
-				break;
+			if (NULL == message)
+			{
+				update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+				zbx_perform_openipmi_op(ZBX_IPMI_POLLER_EVENT_TIMEOUT_MS);
+				update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+				time_read = zbx_time();
+				time_idle += time_read - time_now;
+				zbx_update_env(time_read);
 
-			zbx_perform_all_openipmi_ops(ipmi_timeout);
+				polled_num += ipmi_poller_check_requests(&ipmi_socket, &active, &pending);
+				continue;
+			}
 		}
+		else
+		{
+			update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+
+			while (ZBX_IS_RUNNING())
+			{
+				const int ipc_timeout = 2;
+				const int ipmi_timeout = 1;
+
+				if (SUCCEED != zbx_ipc_async_socket_recv(&ipmi_socket, ipc_timeout, &message))
+				{
+					zabbix_log(LOG_LEVEL_CRIT, "cannot read IPMI service request");
+					exit(EXIT_FAILURE);
+				}
+
+				if (NULL != message)
+					break;
+
+				zbx_perform_all_openipmi_ops(ipmi_timeout);
+
+				/* pending requests can be waiting for timed out operations to complete */
+				if (0 != pending.values_num)
+				{
+					polled_num += ipmi_poller_check_requests(&ipmi_socket, &active, &pending);
+
+					if (0 != active.values_num)
+						break;
+				}
+			}
 
-		update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+			update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
 
-		if (NULL == message)
-			break;
+			if (NULL == message)
+			{
+				if (0 != active.values_num || 0 != pending.values_num)
+					continue;
+				break;
+			}
 
-		time_read = zbx_time();
-		time_idle += time_read - time_now;
-		zbx_update_env(time_read);
+			time_read = zbx_time();
+			time_idle += time_read - time_now;
+			zbx_update_env(time_read);
+		}
 
 		switch (message->code)
 		{
 			case ZBX_IPC_IPMI_VALUE_REQUEST:
-				ipmi_poller_process_value_request(&ipmi_socket, message);
-				polled_num++;
-				break;
 			case ZBX_IPC_IPMI_COMMAND_REQUEST:
-				ipmi_poller_process_command_request(&ipmi_socket, message);
+				ipmi_poller_process_request(message, &active, &pending);
 				break;
 			case ZBX_IPC_IPMI_CLEANUP_REQUEST:
-				zbx_delete_inactive_ipmi_hosts(time(NULL));
+				cleanup = 1;
 				break;
 		}
 
+		/* requests for hosts with established domains can finish immediately */
+		polled_num += ipmi_poller_check_requests(&ipmi_socket, &active, &pending);
+
 		zbx_ipc_message_free(message);
 		message = NULL;
 	}
@@ -280,6 +382,11 @@ ZBX_THREAD_ENTRY(ipmi_poller_thread, args)
 	while (1)
 		zbx_sleep(SEC_PER_MIN);
 
+	zbx_vector_ptr_clear_ext(&pending, (zbx_clean_func_t)ipmi_poller_request_free);
+	zbx_vector_ptr_destroy(&pending);
+	zbx_vector_ptr_clear_ext(&active, (zbx_clean_func_t)ipmi_poller_request_free);
+	zbx_vector_ptr_destroy(&active);
+
 	zbx_ipc_async_socket_close(&ipmi_socket);
 
 	zbx_free_ipmi_handler();
@@ -81,6 +81,27 @@ void	zbx_ipmi_deserialize_request_objectid(const unsigned char *data, zbx_uint64
 	(void)zbx_deserialize_uint64(data, objectid);
 }
 
+zbx_uint32_t	zbx_ipmi_serialize_requestid(unsigned char **data, zbx_uint64_t requestid, const unsigned char *payload,
+		zbx_uint32_t payload_len)
+{
+	zbx_uint32_t	data_len;
+
+	data_len = sizeof(zbx_uint64_t) + payload_len;
+	*data = (unsigned char *)zbx_malloc(NULL, data_len);
+
+	(void)zbx_serialize_uint64(*data, requestid);
+
+	if (0 != payload_len)
+		memcpy(*data + sizeof(zbx_uint64_t), payload, payload_len);
+
+	return data_len;
+}
+
+const unsigned char	*zbx_ipmi_deserialize_requestid(const unsigned char *data, zbx_uint64_t *requestid)
+{
+	return data + zbx_deserialize_uint64(data, requestid);
+}
+
 zbx_uint32_t	zbx_ipmi_serialize_result(unsigned char **data, const zbx_timespec_t *ts, int errcode,
 		const char *value)
 {
@@ -48,6 +48,11 @@ void	zbx_ipmi_deserialize_request(const unsigned char *data, zbx_uint64_t *objec
 
 void	zbx_ipmi_deserialize_request_objectid(const unsigned char *data, zbx_uint64_t *objectid);
 
+zbx_uint32_t	zbx_ipmi_serialize_requestid(unsigned char **data, zbx_uint64_t requestid, const unsigned char *payload,
+		zbx_uint32_t payload_len);
+
+const unsigned char	*zbx_ipmi_deserialize_requestid(const unsigned char *data, zbx_uint64_t *requestid);
+
 zbx_uint32_t	zbx_ipmi_serialize_result(unsigned char **data, const zbx_timespec_t *ts, int errcode,
 		const char *value);
 
@@ -470,6 +470,90 @@ static void	lld_process_result(zbx_lld_manager_t *manager, zbx_ipc_client_t *cli
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: lld_get_diag_stats                                               *
+ *                                                                            *
+ * Purpose: return diagnostic statistics                                      *
+ *                                                                            *
+ * Parameters: manager - [IN] the LLD manager                                 *
+ *             client  - [IN] IPC client                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	lld_get_diag_stats(zbx_lld_manager_t *manager, zbx_ipc_client_t *client)
+{
+	zbx_uint64_t	data[2] = {(zbx_uint64_t)manager->rule_index.num_data, manager->queued_num};
+
+	zbx_ipc_client_send(client, ZBX_IPC_LLD_DIAG_STATS, (unsigned char *)data, sizeof(data));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: lld_compare_values_num                                           *
+ *                                                                            *
+ * Purpose: sort rules by the number of queued values in descending order     *
+ *                                                                            *
+ *****************************************************************************/
+static int	lld_compare_values_num(const void *d1, const void *d2)
+{
+	const zbx_uint64_pair_t	*p1 = (const zbx_uint64_pair_t *)d1;
+	const zbx_uint64_pair_t	*p2 = (const zbx_uint64_pair_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(p2->second, p1->second);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: lld_get_top_items                                                *
+ *                                                                            *
+ * Purpose: return the LLD rules with most values in queue                    *
+ *                                                                            *
+ * Parameters: manager - [IN] the LLD manager                                 *
+ *             client  - [IN] IPC client                                      *
+ *             message - [IN] the message with number of top rules to return  *
+ *                                                                            *
+ ******************************************************************************/
+static void	lld_get_top_items(zbx_lld_manager_t *manager, zbx_ipc_client_t *client,
+		const zbx_ipc_message_t *message)
+{
+	int				limit;
+	zbx_hashset_iter_t		iter;
+	zbx_lld_rule_t			*rule;
+	zbx_lld_data_t			*data;
+	zbx_vector_uint64_pair_t	top;
+	unsigned char			*out;
+	zbx_uint32_t			size;
+
+	memcpy(&limit, message->data, sizeof(limit));
+
+	zbx_vector_uint64_pair_create(&top);
+	zbx_vector_uint64_pair_reserve(&top, manager->rule_index.num_data);
+
+	zbx_hashset_iter_reset(&manager->rule_index, &iter);
+	while (NULL != (rule = (zbx_lld_rule_t *)zbx_hashset_iter_next(&iter)))
+	{
+		zbx_uint64_pair_t	pair = {rule->itemid, 0};
+
+		for (data = rule->head; NULL != data; data = data->next)
+			pair.second++;
+
+		zbx_vector_uint64_pair_append_ptr(&top, &pair);
+	}
+
+	zbx_vector_uint64_pair_sort(&top, lld_compare_values_num);
+
+	if (top.values_num > limit)
+		top.values_num = limit;
+
+	size = zbx_lld_serialize_top_items(&out, &top);
+	zbx_ipc_client_send(client, ZBX_IPC_LLD_TOP_ITEMS, out, size);
+
+	zbx_free(out);
+	zbx_vector_uint64_pair_destroy(&top);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: lld_manager_thread                                               *
@@ -556,6 +640,12 @@ ZBX_THREAD_ENTRY(lld_manager_thread, args)
 					zbx_ipc_client_send(client, message->code, (unsigned char *)&manager.queued_num,
 							sizeof(zbx_uint64_t));
 					break;
+				case ZBX_IPC_LLD_DIAG_STATS:
+					lld_get_diag_stats(&manager, client);
+					break;
+				case ZBX_IPC_LLD_TOP_ITEMS:
+					lld_get_top_items(&manager, client, message);
+					break;
 			}
 
 			zbx_ipc_message_free(message);
@@ -87,6 +87,65 @@ void	zbx_lld_deserialize_item_value(const unsigned char *data, zbx_uint64_t *ite
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_lld_serialize_top_items                                      *
+ *                                                                            *
+ * Purpose: serialize LLD rules with the number of queued values              *
+ *                                                                            *
+ * Parameters: data  - [OUT] memory buffer for serialized data                *
+ *             items - [IN] the rule itemid, number of queued values pairs    *
+ *                                                                            *
+ * Return value: size of serialized data                                      *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint32_t	zbx_lld_serialize_top_items(unsigned char **data, const zbx_vector_uint64_pair_t *items)
+{
+	unsigned char	*ptr;
+	zbx_uint32_t	size;
+	int		i;
+
+	size = sizeof(int) + (zbx_uint32_t)items->values_num * sizeof(zbx_uint64_t) * 2;
+	ptr = *data = (unsigned char *)zbx_malloc(NULL, size);
+
+	ptr += zbx_serialize_int(ptr, items->values_num);
+
+	for (i = 0; i < items->values_num; i++)
+	{
+		ptr += zbx_serialize_uint64(ptr, items->values[i].first);
+		ptr += zbx_serialize_uint64(ptr, items->values[i].second);
+	}
+
+	return size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_lld_deserialize_top_items                                    *
+ *                                                                            *
+ * Purpose: deserialize LLD rules with the number of queued values            *
+ *                                                                            *
+ * Parameters: data  - [IN] the serialized data                               *
+ *             items - [OUT] the rule itemid, number of queued values pairs   *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_lld_deserialize_top_items(const unsigned char *data, zbx_vector_uint64_pair_t *items)
+{
+	int			i, items_num;
+	zbx_uint64_pair_t	pair;
+
+	data += zbx_deserialize_int(data, &items_num);
+
+	zbx_vector_uint64_pair_reserve(items, items_num);
+
+	for (i = 0; i < items_num; i++)
+	{
+		data += zbx_deserialize_uint64(data, &pair.first);
+		data += zbx_deserialize_uint64(data, &pair.second);
+		zbx_vector_uint64_pair_append_ptr(items, &pair);
+	}
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_lld_process_value                                            *
@@ -205,3 +264,64 @@ out:
 
 	return ret;
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_lld_get_diag_stats                                           *
+ *                                                                            *
+ * Purpose: get LLD manager diagnostic statistics                             *
+ *                                                                            *
+ * Parameters: items_num  - [OUT] the number of LLD rules with queued values  *
+ *             values_num - [OUT] the number of queued values                 *
+ *             error      - [OUT] the error message                           *
+ *                                                                            *
+ * Return value: SUCCEED - the statistics were returned successfully          *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_lld_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, char **error)
+{
+	unsigned char	*result;
+
+	if (SUCCEED != zbx_ipc_async_exchange(ZBX_IPC_SERVICE_LLD, ZBX_IPC_LLD_DIAG_STATS, SEC_PER_MIN, NULL, 0,
+			&result, error))
+	{
+		return FAIL;
+	}
+
+	memcpy(items_num, result, sizeof(zbx_uint64_t));
+	memcpy(values_num, result + sizeof(zbx_uint64_t), sizeof(zbx_uint64_t));
+	zbx_free(result);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_lld_get_top_items                                            *
+ *                                                                            *
+ * Purpose: get the LLD rules with most values in queue                       *
+ *                                                                            *
+ * Parameters: limit - [IN] the number of top rules to return                 *
+ *             items - [OUT] the rule itemid, number of queued values pairs   *
+ *             error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: SUCCEED - the top rules were returned successfully           *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_lld_get_top_items(int limit, zbx_vector_uint64_pair_t *items, char **error)
+{
+	unsigned char	*result;
+
+	if (SUCCEED != zbx_ipc_async_exchange(ZBX_IPC_SERVICE_LLD, ZBX_IPC_LLD_TOP_ITEMS, SEC_PER_MIN,
+			(unsigned char *)&limit, sizeof(limit), &result, error))
+	{
+		return FAIL;
+	}
+
+	zbx_lld_deserialize_top_items(result, items);
+	zbx_free(result);
+
+	return SUCCEED;
+}
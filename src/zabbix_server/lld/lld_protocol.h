@@ -21,6 +21,7 @@
 #define ZABBIX_LLD_PROTOCOL_H
 
 #include "common.h"
+#include "zbxalgo.h"
 
 #define ZBX_IPC_SERVICE_LLD	"lld"
 
@@ -37,10 +38,17 @@
 /* poller -> LLD */
 #define ZBX_IPC_LLD_QUEUE		1300
 
+/* main process -> LLD */
+#define ZBX_IPC_LLD_DIAG_STATS		1400
+#define ZBX_IPC_LLD_TOP_ITEMS		1401
+
 zbx_uint32_t	zbx_lld_serialize_item_value(unsigned char **data, zbx_uint64_t itemid, const char *value,
 		const zbx_timespec_t *ts, unsigned char meta, zbx_uint64_t lastlogsize, int mtime, const char *error);
 
 void	zbx_lld_deserialize_item_value(const unsigned char *data, zbx_uint64_t *itemid, char **value,
 		zbx_timespec_t *ts, unsigned char *meta, zbx_uint64_t *lastlogsize, int *mtime, char **error);
 
+zbx_uint32_t	zbx_lld_serialize_top_items(unsigned char **data, const zbx_vector_uint64_pair_t *items);
+void	zbx_lld_deserialize_top_items(const unsigned char *data, zbx_vector_uint64_pair_t *items);
+
 #endif
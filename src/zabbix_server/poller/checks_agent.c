@@ -20,6 +20,8 @@
 #include "common.h"
 #include "comms.h"
 #include "log.h"
+#include "zbxjson.h"
+#include "zbxself.h"
 #include "../../libs/zbxcrypto/tls_tcp_active.h"
 
 #include "checks_agent.h"
@@ -28,6 +30,91 @@
 extern unsigned char	program_type;
 #endif
 
+/* agents that failed a request of multiple passive checks are polled one item at a time for this period */
+#define ZBX_AGENT_BATCH_RETRY_PERIOD	(10 * SEC_PER_MIN)
+
+typedef struct
+{
+	zbx_uint64_t	interfaceid;
+	time_t		retry;
+}
+zbx_agent_interface_t;
+
+static zbx_hashset_t	legacy_interfaces;
+static int		legacy_interfaces_created = 0;
+
+/* connections kept open by agents between requests of multiple passive checks, per poller */
+#define ZBX_AGENT_KEEPALIVE		(5 * SEC_PER_MIN)	/* requested, agent may allow less */
+#define ZBX_AGENT_CONNECTIONS_MAX	256
+#define ZBX_AGENT_CONNECTIONS_CLEANUP	SEC_PER_MIN
+
+typedef struct
+{
+	zbx_uint64_t	interfaceid;
+	zbx_socket_t	*s;
+	char		*addr;
+	char		*tls_arg1;
+	char		*tls_arg2;
+	time_t		expires;
+	unsigned short	port;
+	unsigned char	tls_connect;
+}
+zbx_agent_connection_t;
+
+static zbx_hashset_t	agent_connections;
+static int		agent_connections_created = 0;
+static time_t		agent_connections_cleanup = 0;
+
+/******************************************************************************
+ *                                                                            *
+ * Function: get_agent_tls_args                                               *
+ *                                                                            *
+ * Purpose: gets TLS connection parameters of the item host                   *
+ *                                                                            *
+ * Parameters: item     - [IN] the item                                       *
+ *             tls_arg1 - [OUT] the certificate issuer or PSK identity        *
+ *             tls_arg2 - [OUT] the certificate subject or PSK                *
+ *             result   - [OUT] the error message                             *
+ *                                                                            *
+ * Return value: SUCCEED      - the parameters were returned                  *
+ *               CONFIG_ERROR - invalid connection type                       *
+ *                                                                            *
+ ******************************************************************************/
+static int	get_agent_tls_args(const DC_ITEM *item, const char **tls_arg1, const char **tls_arg2,
+		AGENT_RESULT *result)
+{
+	switch (item->host.tls_connect)
+	{
+		case ZBX_TCP_SEC_UNENCRYPTED:
+			*tls_arg1 = NULL;
+			*tls_arg2 = NULL;
+			break;
+#if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+		case ZBX_TCP_SEC_TLS_CERT:
+			*tls_arg1 = item->host.tls_issuer;
+			*tls_arg2 = item->host.tls_subject;
+			break;
+		case ZBX_TCP_SEC_TLS_PSK:
+			*tls_arg1 = item->host.tls_psk_identity;
+			*tls_arg2 = item->host.tls_psk;
+			break;
+#else
+		case ZBX_TCP_SEC_TLS_CERT:
+		case ZBX_TCP_SEC_TLS_PSK:
+			SET_MSG_RESULT(result, zbx_dsprintf(NULL, "A TLS connection is configured to be used with agent"
+					" but support for TLS was not compiled into %s.",
+					get_program_type_string(program_type)));
+			return CONFIG_ERROR;
+#endif
+		default:
+			THIS_SHOULD_NEVER_HAPPEN;
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid TLS connection parameters."));
+			return CONFIG_ERROR;
+	}
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: get_value_agent                                                  *
@@ -58,36 +145,8 @@ int	get_value_agent(const DC_ITEM *item, AGENT_RESULT *result)
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'%s' addr:'%s' key:'%s' conn:'%s'", __func__, item->host.host,
 			item->interface.addr, item->key, zbx_tcp_connection_type_name(item->host.tls_connect));
 
-	switch (item->host.tls_connect)
-	{
-		case ZBX_TCP_SEC_UNENCRYPTED:
-			tls_arg1 = NULL;
-			tls_arg2 = NULL;
-			break;
-#if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
-		case ZBX_TCP_SEC_TLS_CERT:
-			tls_arg1 = item->host.tls_issuer;
-			tls_arg2 = item->host.tls_subject;
-			break;
-		case ZBX_TCP_SEC_TLS_PSK:
-			tls_arg1 = item->host.tls_psk_identity;
-			tls_arg2 = item->host.tls_psk;
-			break;
-#else
-		case ZBX_TCP_SEC_TLS_CERT:
-		case ZBX_TCP_SEC_TLS_PSK:
-			SET_MSG_RESULT(result, zbx_dsprintf(NULL, "A TLS connection is configured to be used with agent"
-					" but support for TLS was not compiled into %s.",
-					get_program_type_string(program_type)));
-			ret = CONFIG_ERROR;
-			goto out;
-#endif
-		default:
-			THIS_SHOULD_NEVER_HAPPEN;
-			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid TLS connection parameters."));
-			ret = CONFIG_ERROR;
-			goto out;
-	}
+	if (SUCCEED != (ret = get_agent_tls_args(item, &tls_arg1, &tls_arg2, result)))
+		goto out;
 
 	if (SUCCEED == (ret = zbx_tcp_connect(&s, CONFIG_SOURCE_IP, item->interface.addr, item->interface.port, 0,
 			item->host.tls_connect, tls_arg1, tls_arg2)))
@@ -144,3 +203,519 @@ out:
 
 	return ret;
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: agent_batch_supported                                            *
+ *                                                                            *
+ * Purpose: checks if multiple passive checks can be requested from agent at  *
+ *          once                                                              *
+ *                                                                            *
+ ******************************************************************************/
+static int	agent_batch_supported(zbx_uint64_t interfaceid, time_t now)
+{
+	zbx_agent_interface_t	*interface;
+
+	if (0 == legacy_interfaces_created ||
+			NULL == (interface = (zbx_agent_interface_t *)zbx_hashset_search(&legacy_interfaces, &interfaceid)))
+	{
+		return SUCCEED;
+	}
+
+	if (interface->retry > now)
+		return FAIL;
+
+	zbx_hashset_remove_direct(&legacy_interfaces, interface);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: agent_batch_disable                                              *
+ *                                                                            *
+ * Purpose: polls agent one item at a time for a while                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	agent_batch_disable(const DC_ITEM *item, time_t now, const char *reason)
+{
+	zbx_agent_interface_t	interface_local;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "cannot request multiple passive checks from agent at [%s]:%hu: %s",
+			item->interface.addr, item->interface.port, reason);
+
+	if (0 == legacy_interfaces_created)
+	{
+		zbx_hashset_create(&legacy_interfaces, 100, ZBX_DEFAULT_UINT64_HASH_FUNC,
+				ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+		legacy_interfaces_created = 1;
+	}
+
+	interface_local.interfaceid = item->interface.interfaceid;
+	interface_local.retry = now + ZBX_AGENT_BATCH_RETRY_PERIOD;
+
+	zbx_hashset_insert(&legacy_interfaces, &interface_local, sizeof(interface_local));
+}
+
+static void	agent_socket_free(zbx_socket_t *s)
+{
+	zbx_tcp_close(s);
+	zbx_free(s);
+}
+
+static void	agent_connection_clean(void *data)
+{
+	zbx_agent_connection_t	*connection = (zbx_agent_connection_t *)data;
+
+	if (NULL != connection->s)
+		agent_socket_free(connection->s);
+
+	zbx_free(connection->addr);
+	zbx_free(connection->tls_arg1);
+	zbx_free(connection->tls_arg2);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: agent_connection_get                                             *
+ *                                                                            *
+ * Purpose: takes an idle connection to the item interface out of the pool    *
+ *                                                                            *
+ * Return value: the connection or NULL if there is no usable connection      *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_socket_t	*agent_connection_get(const DC_ITEM *item, const char *tls_arg1, const char *tls_arg2,
+		time_t now)
+{
+	zbx_agent_connection_t	*connection;
+	zbx_socket_t		*s = NULL;
+
+	if (0 == agent_connections_created || NULL == (connection = (zbx_agent_connection_t *)zbx_hashset_search(
+			&agent_connections, &item->interface.interfaceid)))
+	{
+		return NULL;
+	}
+
+	/* interface or host encryption settings could have been changed since the connection was made */
+	if (connection->expires > now && 0 == strcmp(connection->addr, item->interface.addr) &&
+			connection->port == item->interface.port && connection->tls_connect == item->host.tls_connect &&
+			0 == zbx_strcmp_null(connection->tls_arg1, tls_arg1) &&
+			0 == zbx_strcmp_null(connection->tls_arg2, tls_arg2))
+	{
+		s = connection->s;
+		connection->s = NULL;
+	}
+
+	zbx_hashset_remove_direct(&agent_connections, connection);
+
+	return s;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: agent_connection_put                                             *
+ *                                                                            *
+ * Purpose: keeps the connection open for the next request if agent allows it *
+ *          or closes it                                                      *
+ *                                                                            *
+ * Parameters: item      - [IN] the item the connection was made for          *
+ *             tls_arg1  - [IN] the connection TLS parameters                 *
+ *             tls_arg2  - [IN]                                               *
+ *             s         - [IN] the connection, the ownership is passed to    *
+ *                              this function                                 *
+ *             keepalive - [IN] seconds the agent will wait for the next      *
+ *                              request                                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	agent_connection_put(const DC_ITEM *item, const char *tls_arg1, const char *tls_arg2, zbx_socket_t *s,
+		int keepalive)
+{
+	zbx_agent_connection_t	connection_local;
+	time_t			now;
+
+	now = time(NULL);
+
+	if (0 == agent_connections_created)
+	{
+		zbx_hashset_create_ext(&agent_connections, 100, ZBX_DEFAULT_UINT64_HASH_FUNC,
+				ZBX_DEFAULT_UINT64_COMPARE_FUNC, agent_connection_clean,
+				ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+		agent_connections_created = 1;
+	}
+
+	if (agent_connections_cleanup + ZBX_AGENT_CONNECTIONS_CLEANUP <= now)
+	{
+		zbx_hashset_iter_t	iter;
+		zbx_agent_connection_t	*connection;
+
+		zbx_hashset_iter_reset(&agent_connections, &iter);
+
+		while (NULL != (connection = (zbx_agent_connection_t *)zbx_hashset_iter_next(&iter)))
+		{
+			if (connection->expires <= now)
+				zbx_hashset_iter_remove(&iter);
+		}
+
+		agent_connections_cleanup = now;
+	}
+
+	/* leave a second for the request to reach the agent before it closes the connection */
+	if (1 >= keepalive || ZBX_AGENT_CONNECTIONS_MAX <= agent_connections.num_data)
+	{
+		agent_socket_free(s);
+		return;
+	}
+
+	connection_local.interfaceid = item->interface.interfaceid;
+	connection_local.s = s;
+	connection_local.addr = zbx_strdup(NULL, item->interface.addr);
+	connection_local.port = item->interface.port;
+	connection_local.tls_connect = item->host.tls_connect;
+	connection_local.tls_arg1 = (NULL != tls_arg1 ? zbx_strdup(NULL, tls_arg1) : NULL);
+	connection_local.tls_arg2 = (NULL != tls_arg2 ? zbx_strdup(NULL, tls_arg2) : NULL);
+	connection_local.expires = now + keepalive - 1;
+
+	zbx_hashset_insert(&agent_connections, &connection_local, sizeof(connection_local));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: agent_recv                                                       *
+ *                                                                            *
+ * Purpose: receives agent response                                           *
+ *                                                                            *
+ * Return value: SUCCEED       - the response was received                    *
+ *               NETWORK_ERROR - network related error occurred               *
+ *               TIMEOUT_ERROR - the response was not received in time        *
+ *                                                                            *
+ ******************************************************************************/
+static int	agent_recv(zbx_socket_t *s, ssize_t *received_len)
+{
+	if (FAIL != (*received_len = zbx_tcp_recv_ext(s, 0)))
+		return SUCCEED;
+
+	if (SUCCEED == zbx_alarm_timed_out())
+		return TIMEOUT_ERROR;
+
+	return NETWORK_ERROR;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: agent_exchange                                                   *
+ *                                                                            *
+ * Purpose: sends request to agent and receives the first response            *
+ *                                                                            *
+ * Return value: SUCCEED       - the response was received                    *
+ *               NETWORK_ERROR - network related error occurred               *
+ *               TIMEOUT_ERROR - the response was not received in time        *
+ *                                                                            *
+ ******************************************************************************/
+static int	agent_exchange(zbx_socket_t *s, const char *request, ssize_t *received_len)
+{
+	zabbix_log(LOG_LEVEL_DEBUG, "Sending [%s]", request);
+
+	if (SUCCEED != zbx_tcp_send(s, request))
+		return NETWORK_ERROR;
+
+	return agent_recv(s, received_len);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: parse_agent_value                                                *
+ *                                                                            *
+ * Purpose: parses agent response to one of multiple passive checks           *
+ *                                                                            *
+ * Parameters: response  - [IN] the response                                  *
+ *             result    - [OUT] the item value or error message              *
+ *             errcode   - [OUT] the item error code                          *
+ *             keepalive - [OUT] seconds the agent will keep the connection   *
+ *                               open for the next request, set by the last   *
+ *                               response only                                *
+ *             error     - [OUT] the error message                            *
+ *                                                                            *
+ * Return value: SUCCEED     - the response was parsed                        *
+ *               FAIL        - the request was rejected, result was not       *
+ *                             changed                                        *
+ *               AGENT_ERROR - the response is invalid, result was not        *
+ *                             changed                                        *
+ *                                                                            *
+ * Comments: Agents, which do not support multiple passive checks, reply with *
+ *           ZBX_NOTSUPPORTED or reject the request.                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	parse_agent_value(const char *response, AGENT_RESULT *result, int *errcode, int *keepalive,
+		const char **error)
+{
+	struct zbx_json_parse	jp;
+	char			tmp[MAX_STRING_LEN], *value = NULL;
+	size_t			value_alloc = 0;
+
+	if (SUCCEED != zbx_json_open(response, &jp))
+	{
+		*error = "cannot open received JSON";
+		return FAIL;
+	}
+
+	if (SUCCEED != zbx_json_value_by_name(&jp, ZBX_PROTO_TAG_RESPONSE, tmp, sizeof(tmp), NULL) ||
+			0 != strcmp(tmp, ZBX_PROTO_VALUE_SUCCESS))
+	{
+		*error = "request failed";
+		return FAIL;
+	}
+
+	if (SUCCEED == zbx_json_value_by_name_dyn(&jp, ZBX_PROTO_TAG_VALUE, &value, &value_alloc, NULL))
+	{
+		set_result_type(result, ITEM_VALUE_TYPE_TEXT, value);
+		*errcode = SUCCEED;
+	}
+	else if (SUCCEED == zbx_json_value_by_name_dyn(&jp, ZBX_PROTO_TAG_ERROR, &value, &value_alloc, NULL))
+	{
+		SET_MSG_RESULT(result, value);
+		*errcode = NOTSUPPORTED;
+		value = NULL;
+	}
+	else
+	{
+		*error = "cannot get item value or error message from received JSON";
+		return AGENT_ERROR;
+	}
+
+	zbx_free(value);
+
+	if (SUCCEED == zbx_json_value_by_name(&jp, ZBX_PROTO_TAG_KEEPALIVE, tmp, sizeof(tmp), NULL) &&
+			SUCCEED != is_uint31(tmp, keepalive))
+	{
+		*keepalive = 0;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: get_values_agent                                                 *
+ *                                                                            *
+ * Purpose: retrieve values of multiple items from the same Zabbix agent      *
+ *                                                                            *
+ * Parameters: items    - [IN] items of the same interface                    *
+ *             results  - [OUT] the item values or error messages             *
+ *             errcodes - [IN/OUT] the item error codes, only items with      *
+ *                                 SUCCEED error code are retrieved           *
+ *             num      - [IN] the number of items                            *
+ *                                                                            *
+ * Comments: All keys are requested in a single connection, which is kept     *
+ *           open for the next poll of the interface if agent allows it.      *
+ *           Agent evaluates the keys one after another and replies to each   *
+ *           of them separately, every reply is waited for CONFIG_TIMEOUT     *
+ *           seconds as for a single passive check.                           *
+ *           Agents that reject the request are polled one item at a time,    *
+ *           as get_value_agent() would, and are not asked for multiple keys  *
+ *           again for ZBX_AGENT_BATCH_RETRY_PERIOD.                          *
+ *                                                                            *
+ *           Unlike get_value_agent() this function sets its own alarms and   *
+ *           records the latency of every request it makes.                   *
+ *                                                                            *
+ ******************************************************************************/
+void	get_values_agent(const DC_ITEM *items, AGENT_RESULT *results, int *errcodes, int num)
+{
+	zbx_socket_t	*s;
+	struct zbx_json	json;
+	const char	*tls_arg1, *tls_arg2, *error = NULL;
+	int		i, j, ret, keepalive = 0;
+	ssize_t		received_len;
+	time_t		now;
+	double		sec;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'%s' addr:'%s' num:%d", __func__, items[0].host.host,
+			items[0].interface.addr, num);
+
+	for (j = 0; j < num; j++)	/* locate first supported item to use as a reference */
+	{
+		if (SUCCEED == errcodes[j])
+			break;
+	}
+
+	if (j == num)
+		goto out;
+
+	now = time(NULL);
+
+	if (SUCCEED != agent_batch_supported(items[j].interface.interfaceid, now))
+		goto fallback;
+
+	if (SUCCEED != (ret = get_agent_tls_args(&items[j], &tls_arg1, &tls_arg2, &results[j])))
+	{
+		errcodes[j] = ret;
+
+		for (i = j + 1; i < num; i++)
+		{
+			if (SUCCEED != errcodes[i])
+				continue;
+
+			SET_MSG_RESULT(&results[i], zbx_strdup(NULL, results[j].msg));
+			errcodes[i] = ret;
+		}
+
+		goto out;
+	}
+
+	zbx_json_init(&json, ZBX_JSON_STAT_BUF_LEN);
+	zbx_json_addstring(&json, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_GET_PASSIVE_CHECKS, ZBX_JSON_TYPE_STRING);
+	zbx_json_addarray(&json, ZBX_PROTO_TAG_KEYS);
+
+	for (i = j; i < num; i++)
+	{
+		if (SUCCEED != errcodes[i])
+			continue;
+
+		zbx_json_addstring(&json, NULL, items[i].key, ZBX_JSON_TYPE_STRING);
+	}
+
+	zbx_json_close(&json);
+	zbx_json_adduint64(&json, ZBX_PROTO_TAG_KEEPALIVE, ZBX_AGENT_KEEPALIVE);
+
+	sec = zbx_time();
+
+	/* agent might have closed the idle connection, in that case the request is repeated over a new one */
+	if (NULL != (s = agent_connection_get(&items[j], tls_arg1, tls_arg2, now)))
+	{
+		zbx_alarm_on(CONFIG_TIMEOUT);
+		ret = agent_exchange(s, json.buffer, &received_len);
+		zbx_alarm_off();
+
+		if (NETWORK_ERROR == ret || (SUCCEED == ret && 0 == received_len))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "kept alive connection to [%s]:%hu was closed",
+					items[j].interface.addr, items[j].interface.port);
+			agent_socket_free(s);
+			s = NULL;
+		}
+	}
+
+	if (NULL == s)
+	{
+		s = (zbx_socket_t *)zbx_malloc(NULL, sizeof(zbx_socket_t));
+
+		zbx_alarm_on(CONFIG_TIMEOUT);
+
+		if (SUCCEED == (ret = zbx_tcp_connect(s, CONFIG_SOURCE_IP, items[j].interface.addr,
+				items[j].interface.port, 0, items[j].host.tls_connect, tls_arg1, tls_arg2)))
+		{
+			ret = agent_exchange(s, json.buffer, &received_len);
+		}
+		else
+			ret = NETWORK_ERROR;
+
+		zbx_alarm_off();
+	}
+
+	zbx_json_free(&json);
+
+	/* agent replies to every key separately, each reply is waited for as long as for a single passive check */
+	for (i = j; i < num; i++)
+	{
+		if (SUCCEED != errcodes[i])
+			continue;
+
+		if (i != j)
+		{
+			zbx_alarm_on(CONFIG_TIMEOUT);
+			ret = agent_recv(s, &received_len);
+			zbx_alarm_off();
+		}
+
+		if (SUCCEED != ret)
+			break;
+
+		zabbix_log(LOG_LEVEL_DEBUG, "get value from agent result: '%s'", s->buffer);
+
+		if (0 == received_len)
+		{
+			error = "Received empty response from Zabbix Agent. Assuming that agent dropped connection"
+					" because of access permissions.";
+			ret = NETWORK_ERROR;
+			break;
+		}
+
+		if (SUCCEED != (ret = parse_agent_value(s->buffer, &results[i], &errcodes[i], &keepalive, &error)))
+		{
+			/* agent has accepted the request if the first key was answered */
+			if (FAIL == ret && i != j)
+				ret = AGENT_ERROR;
+
+			break;
+		}
+	}
+
+	update_selfmon_latency(zbx_time() - sec);
+
+	if (SUCCEED == ret)
+		agent_connection_put(&items[j], tls_arg1, tls_arg2, s, keepalive);
+	else
+		agent_socket_free(s);
+
+	/* only a rejected request means that agent does not support multiple passive checks */
+	if (FAIL == ret)
+	{
+		agent_batch_disable(&items[j], now, error);
+		goto fallback;
+	}
+
+	if (SUCCEED != ret)
+	{
+		if (NETWORK_ERROR == ret && NULL == error)
+			error = zbx_socket_strerror();
+		else if (TIMEOUT_ERROR == ret)
+			error = "Timeout while waiting for value from agent.";
+
+		/* items answered before the failure keep their values */
+		for (; i < num; i++)
+		{
+			if (SUCCEED != errcodes[i])
+				continue;
+
+			if (NETWORK_ERROR == ret)
+			{
+				SET_MSG_RESULT(&results[i], zbx_dsprintf(NULL, "Get value from agent failed: %s",
+						error));
+			}
+			else
+				SET_MSG_RESULT(&results[i], zbx_strdup(NULL, error));
+
+			errcodes[i] = ret;
+		}
+	}
+
+	goto out;
+fallback:
+	for (i = j; i < num; i++)
+	{
+		if (SUCCEED != errcodes[i])
+			continue;
+
+		sec = zbx_time();
+		zbx_alarm_on(CONFIG_TIMEOUT);
+		errcodes[i] = get_value_agent(&items[i], &results[i]);
+		zbx_alarm_off();
+		update_selfmon_latency(zbx_time() - sec);
+
+		/* do not wait for other items of unreachable agent */
+		if (NETWORK_ERROR == errcodes[i] || TIMEOUT_ERROR == errcodes[i])
+		{
+			for (j = i + 1; j < num; j++)
+			{
+				if (SUCCEED != errcodes[j])
+					continue;
+
+				SET_MSG_RESULT(&results[j], zbx_strdup(NULL, results[i].msg));
+				errcodes[j] = errcodes[i];
+			}
+
+			break;
+		}
+	}
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
@@ -26,5 +26,6 @@
 extern char	*CONFIG_SOURCE_IP;
 
 int	get_value_agent(const DC_ITEM *item, AGENT_RESULT *result);
+void	get_values_agent(const DC_ITEM *items, AGENT_RESULT *results, int *errcodes, int num);
 
 #endif
@@ -401,13 +401,13 @@ int	get_value_internal(const DC_ITEM *item, AGENT_RESULT *result)
 			goto out;
 		}
 	}
-	else if (0 == strcmp(tmp, "process"))			/* zabbix["process",<type>,<mode>,<state>] */
+	else if (0 == strcmp(tmp, "process"))			/* zabbix["process",<type>,<mode>,<state>,<stat>] */
 	{
 		unsigned char	process_type = ZBX_PROCESS_TYPE_UNKNOWN;
 		int		process_forks;
 		double		value;
 
-		if (2 > nparams || nparams > 4)
+		if (2 > nparams || nparams > 5)
 		{
 			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid number of parameters."));
 			goto out;
@@ -445,7 +445,7 @@ int	get_value_internal(const DC_ITEM *item, AGENT_RESULT *result)
 
 		if (0 == strcmp(tmp, "count"))
 		{
-			if (4 == nparams)
+			if (4 <= nparams)
 			{
 				SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid number of parameters."));
 				goto out;
@@ -485,17 +485,55 @@ int	get_value_internal(const DC_ITEM *item, AGENT_RESULT *result)
 				goto out;
 			}
 
-			if (NULL == (tmp = get_rparam(&request, 3)) || '\0' == *tmp || 0 == strcmp(tmp, "busy"))
-				state = ZBX_PROCESS_STATE_BUSY;
-			else if (0 == strcmp(tmp, "idle"))
-				state = ZBX_PROCESS_STATE_IDLE;
-			else
+			if (NULL != (tmp = get_rparam(&request, 3)) && 0 == strcmp(tmp, "latency"))
 			{
-				SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid fourth parameter."));
-				goto out;
+				unsigned char	stat;
+				double		percentile = 0;
+
+				if (NULL == (tmp = get_rparam(&request, 4)) || '\0' == *tmp)
+				{
+					stat = ZBX_LATENCY_STAT_PERCENTILE;
+					percentile = 99;
+				}
+				else if (0 == strcmp(tmp, "avg"))
+					stat = ZBX_LATENCY_STAT_AVG;
+				else if (0 == strcmp(tmp, "max"))
+					stat = ZBX_LATENCY_STAT_MAX;
+				else if (0 == strcmp(tmp, "count"))
+					stat = ZBX_LATENCY_STAT_COUNT;
+				else if ('p' == *tmp && SUCCEED == is_double(tmp + 1, &percentile) && 0 < percentile &&
+						100 >= percentile)
+				{
+					stat = ZBX_LATENCY_STAT_PERCENTILE;
+				}
+				else
+				{
+					SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid fifth parameter."));
+					goto out;
+				}
+
+				get_selfmon_latency(process_type, aggr_func, process_num, stat, percentile, &value);
 			}
+			else
+			{
+				if (5 == nparams)
+				{
+					SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid number of parameters."));
+					goto out;
+				}
 
-			get_selfmon_stats(process_type, aggr_func, process_num, state, &value);
+				if (NULL == tmp || '\0' == *tmp || 0 == strcmp(tmp, "busy"))
+					state = ZBX_PROCESS_STATE_BUSY;
+				else if (0 == strcmp(tmp, "idle"))
+					state = ZBX_PROCESS_STATE_IDLE;
+				else
+				{
+					SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid fourth parameter."));
+					goto out;
+				}
+
+				get_selfmon_stats(process_type, aggr_func, process_num, state, &value);
+			}
 
 			SET_DBL_RESULT(result, value);
 		}
@@ -634,6 +672,142 @@ int	get_value_internal(const DC_ITEM *item, AGENT_RESULT *result)
 			goto out;
 		}
 	}
+	else if (0 == strcmp(tmp, "tls"))			/* zabbix[tls,handshakes,<type>] */
+	{
+		zbx_uint64_t	full, resumed;
+
+		if (3 != nparams)
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid number of parameters."));
+			goto out;
+		}
+
+		tmp = get_rparam(&request, 1);
+		tmp1 = get_rparam(&request, 2);
+
+		if (0 != strcmp(tmp, "handshakes"))
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid second parameter."));
+			goto out;
+		}
+
+		/* the counters are accumulated since startup, rates are left for "Change per second" preprocessing */
+		zbx_get_tls_session_stats(&full, &resumed);
+
+		if (0 == strcmp(tmp1, "resumed"))
+			SET_UI64_RESULT(result, resumed);
+		else if (0 == strcmp(tmp1, "full"))
+			SET_UI64_RESULT(result, full);
+		else
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid third parameter."));
+			goto out;
+		}
+	}
+	else if (0 == strcmp(tmp, "value_latency"))		/* zabbix[value_latency,<stage>,<stat>] */
+	{
+		unsigned char	stage, stat;
+		double		percentile = 0, value;
+
+		if (2 > nparams || nparams > 3)
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid number of parameters."));
+			goto out;
+		}
+
+		tmp = get_rparam(&request, 1);
+
+		for (stage = 0; stage < ZBX_VALUE_LATENCY_COUNT; stage++)
+		{
+			if (0 == strcmp(get_value_latency_stage_string(stage), tmp))
+				break;
+		}
+
+		if (ZBX_VALUE_LATENCY_COUNT == stage)
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid second parameter."));
+			goto out;
+		}
+
+		if (NULL == (tmp1 = get_rparam(&request, 2)) || '\0' == *tmp1)
+		{
+			stat = ZBX_LATENCY_STAT_PERCENTILE;
+			percentile = 99;
+		}
+		else if (0 == strcmp(tmp1, "avg"))
+			stat = ZBX_LATENCY_STAT_AVG;
+		else if (0 == strcmp(tmp1, "max"))
+			stat = ZBX_LATENCY_STAT_MAX;
+		else if (0 == strcmp(tmp1, "count"))
+			stat = ZBX_LATENCY_STAT_COUNT;
+		else if ('p' == *tmp1 && SUCCEED == is_double(tmp1 + 1, &percentile) && 0 < percentile &&
+				100 >= percentile)
+		{
+			stat = ZBX_LATENCY_STAT_PERCENTILE;
+		}
+		else
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid third parameter."));
+			goto out;
+		}
+
+		get_selfmon_value_latency(stage, stat, percentile, &value);
+		SET_DBL_RESULT(result, value);
+	}
+	else if (0 == strcmp(tmp, "lock"))			/* zabbix[lock,<name>,<mode>] */
+	{
+		zbx_lock_stats_t	stats;
+		const char		*name;
+		int			i;
+
+		if (2 > nparams || nparams > 3)
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid number of parameters."));
+			goto out;
+		}
+
+		tmp = get_rparam(&request, 1);
+		tmp1 = get_rparam(&request, 2);
+
+		for (i = 0; NULL != (name = zbx_lock_name(i)); i++)
+		{
+			if (0 == strcmp(name, tmp))
+				break;
+		}
+
+		if (NULL == name)
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid second parameter."));
+			goto out;
+		}
+
+		if (SUCCEED != zbx_lock_get_stats(name, &stats))
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Lock statistics are not enabled."));
+			goto out;
+		}
+
+		if (NULL == tmp1 || '\0' == *tmp1 || 0 == strcmp(tmp1, "acquisitions"))
+			SET_UI64_RESULT(result, stats.acquisitions);
+		else if (0 == strcmp(tmp1, "contended"))
+			SET_UI64_RESULT(result, stats.contended);
+		else if (0 == strcmp(tmp1, "pcontended"))
+		{
+			SET_DBL_RESULT(result, 0 == stats.acquisitions ? 0 : 100.0 * (double)stats.contended /
+					(double)stats.acquisitions);
+		}
+		else if (0 == strcmp(tmp1, "wait"))
+			SET_DBL_RESULT(result, stats.wait_time);
+		else if (0 == strcmp(tmp1, "hold"))
+			SET_DBL_RESULT(result, stats.hold_time);
+		else if (0 == strcmp(tmp1, "hold_max"))
+			SET_DBL_RESULT(result, stats.hold_time_max);
+		else
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid third parameter."));
+			goto out;
+		}
+	}
 	else if (0 == strcmp(tmp, "vmware"))
 	{
 		zbx_vmware_stats_t	stats;
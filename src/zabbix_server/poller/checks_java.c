@@ -25,14 +25,154 @@
 
 #include "checks_java.h"
 
-static int	parse_response(AGENT_RESULT *results, int *errcodes, int num, char *response,
-		char *error, int max_error_len)
+/* part of Timeout reserved for sending multiple JMX endpoint request and receiving response, in milliseconds */
+#define ZBX_JAVA_GATEWAY_EXCHANGE_TIME	500
+
+/* connection to Java gateway kept open between JMX requests */
+static zbx_socket_t	gateway_sock;
+static int		gateway_connected = 0;
+
+/******************************************************************************
+ *                                                                            *
+ * Function: parse_values                                                     *
+ *                                                                            *
+ * Purpose: parse values of one JMX endpoint received from Java gateway       *
+ *                                                                            *
+ * Parameters: jp_data       - [IN] the data array                            *
+ *             results       - [OUT] the item results                         *
+ *             errcodes      - [IN/OUT] the item error codes                  *
+ *             groups        - [IN] the endpoint index of each item, NULL if  *
+ *                                  all items belong to the same endpoint     *
+ *             group         - [IN] the endpoint index to parse values for    *
+ *             num           - [IN] the number of items                       *
+ *             error         - [OUT] the error message                        *
+ *             max_error_len - [IN] the error message buffer size             *
+ *                                                                            *
+ * Return value: SUCCEED - the values were parsed successfully                *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	parse_values(const struct zbx_json_parse *jp_data, AGENT_RESULT *results, int *errcodes,
+		const int *groups, int group, int num, char *error, int max_error_len)
 {
-	const char		*p;
-	struct zbx_json_parse	jp, jp_data, jp_row;
+	const char		*p = NULL;
+	struct zbx_json_parse	jp_row;
 	char			*value = NULL;
 	size_t			value_alloc = 0;
-	int			i, ret = GATEWAY_ERROR;
+	int			i, ret = FAIL;
+
+	for (i = 0; i < num; i++)
+	{
+		if (SUCCEED != errcodes[i] || (NULL != groups && group != groups[i]))
+			continue;
+
+		if (NULL == (p = zbx_json_next(jp_data, p)))
+		{
+			zbx_strlcpy(error, "Not all values included in received JSON", max_error_len);
+			goto exit;
+		}
+
+		if (SUCCEED != zbx_json_brackets_open(p, &jp_row))
+		{
+			zbx_strlcpy(error, "Cannot open value object in received JSON", max_error_len);
+			goto exit;
+		}
+
+		if (SUCCEED == zbx_json_value_by_name_dyn(&jp_row, ZBX_PROTO_TAG_VALUE, &value, &value_alloc, NULL))
+		{
+			set_result_type(&results[i], ITEM_VALUE_TYPE_TEXT, value);
+			errcodes[i] = SUCCEED;
+		}
+		else if (SUCCEED == zbx_json_value_by_name_dyn(&jp_row, ZBX_PROTO_TAG_ERROR, &value, &value_alloc,
+				NULL))
+		{
+			SET_MSG_RESULT(&results[i], zbx_strdup(NULL, value));
+			errcodes[i] = NOTSUPPORTED;
+		}
+		else
+		{
+			SET_MSG_RESULT(&results[i], zbx_strdup(NULL, "Cannot get item value or error message"));
+			errcodes[i] = AGENT_ERROR;
+		}
+	}
+
+	ret = SUCCEED;
+exit:
+	zbx_free(value);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: parse_endpoint_values                                            *
+ *                                                                            *
+ * Purpose: parse values of multiple JMX endpoints received from Java gateway *
+ *                                                                            *
+ * Comments: Failure to connect to one endpoint is reported as network error  *
+ *           for the items of that endpoint only.                             *
+ *                                                                            *
+ ******************************************************************************/
+static int	parse_endpoint_values(const struct zbx_json_parse *jp_data, AGENT_RESULT *results, int *errcodes,
+		const int *groups, int groups_num, int num, char *error, int max_error_len)
+{
+	const char		*p = NULL;
+	struct zbx_json_parse	jp_endpoint, jp_values;
+	char			endpoint_error[MAX_STRING_LEN];
+	int			i, group;
+
+	for (group = 0; group < groups_num; group++)
+	{
+		if (NULL == (p = zbx_json_next(jp_data, p)))
+		{
+			zbx_strlcpy(error, "Not all endpoints included in received JSON", max_error_len);
+			return FAIL;
+		}
+
+		if (SUCCEED != zbx_json_brackets_open(p, &jp_endpoint))
+		{
+			zbx_strlcpy(error, "Cannot open endpoint object in received JSON", max_error_len);
+			return FAIL;
+		}
+
+		if (SUCCEED == zbx_json_brackets_by_name(&jp_endpoint, ZBX_PROTO_TAG_DATA, &jp_values))
+		{
+			if (SUCCEED != parse_values(&jp_values, results, errcodes, groups, group, num, error,
+					max_error_len))
+			{
+				return FAIL;
+			}
+
+			continue;
+		}
+
+		if (SUCCEED != zbx_json_value_by_name(&jp_endpoint, ZBX_PROTO_TAG_ERROR, endpoint_error,
+				sizeof(endpoint_error), NULL))
+		{
+			zbx_strlcpy(endpoint_error, "Cannot get error message describing reasons for failure",
+					sizeof(endpoint_error));
+		}
+
+		for (i = 0; i < num; i++)
+		{
+			if (SUCCEED != errcodes[i] || group != groups[i])
+				continue;
+
+			SET_MSG_RESULT(&results[i], zbx_strdup(NULL, endpoint_error));
+			errcodes[i] = NETWORK_ERROR;
+		}
+	}
+
+	return SUCCEED;
+}
+
+static int	parse_response(AGENT_RESULT *results, int *errcodes, const int *groups, int groups_num, int num,
+		char *response, char *error, int max_error_len)
+{
+	struct zbx_json_parse	jp, jp_data;
+	char			*value = NULL;
+	size_t			value_alloc = 0;
+	int			ret = GATEWAY_ERROR;
 
 	if (SUCCEED == zbx_json_open(response, &jp))
 	{
@@ -50,45 +190,16 @@ static int	parse_response(AGENT_RESULT *results, int *errcodes, int num, char *r
 				goto exit;
 			}
 
-			p = NULL;
-
-			for (i = 0; i < num; i++)
+			if (1 < groups_num)
 			{
-				if (SUCCEED != errcodes[i])
-					continue;
-
-				if (NULL == (p = zbx_json_next(&jp_data, p)))
-				{
-					zbx_strlcpy(error, "Not all values included in received JSON", max_error_len);
-					goto exit;
-				}
-
-				if (SUCCEED != zbx_json_brackets_open(p, &jp_row))
-				{
-					zbx_strlcpy(error, "Cannot open value object in received JSON", max_error_len);
-					goto exit;
-				}
-
-				if (SUCCEED == zbx_json_value_by_name_dyn(&jp_row, ZBX_PROTO_TAG_VALUE, &value,
-						&value_alloc, NULL))
-				{
-					set_result_type(&results[i], ITEM_VALUE_TYPE_TEXT, value);
-					errcodes[i] = SUCCEED;
-				}
-				else if (SUCCEED == zbx_json_value_by_name_dyn(&jp_row, ZBX_PROTO_TAG_ERROR, &value,
-						&value_alloc, NULL))
-				{
-					SET_MSG_RESULT(&results[i], zbx_strdup(NULL, value));
-					errcodes[i] = NOTSUPPORTED;
-				}
-				else
-				{
-					SET_MSG_RESULT(&results[i], zbx_strdup(NULL, "Cannot get item value or error message"));
-					errcodes[i] = AGENT_ERROR;
-				}
+				ret = parse_endpoint_values(&jp_data, results, errcodes, groups, groups_num, num, error,
+						max_error_len);
 			}
+			else
+				ret = parse_values(&jp_data, results, errcodes, NULL, 0, num, error, max_error_len);
 
-			ret = SUCCEED;
+			if (SUCCEED != ret)
+				ret = GATEWAY_ERROR;
 		}
 		else if (0 == strcmp(value, ZBX_PROTO_VALUE_FAILED))
 		{
@@ -117,6 +228,140 @@ exit:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: java_gateway_disconnect                                          *
+ *                                                                            *
+ ******************************************************************************/
+static void	java_gateway_disconnect(void)
+{
+	if (0 == gateway_connected)
+		return;
+
+	zbx_tcp_close(&gateway_sock);
+	gateway_connected = 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: java_gateway_closed                                              *
+ *                                                                            *
+ * Purpose: check if idle connection to Java gateway was closed by gateway    *
+ *                                                                            *
+ * Return value: SUCCEED - the connection was closed or is broken             *
+ *               FAIL    - the connection can be reused                       *
+ *                                                                            *
+ * Comments: An idle connection becomes readable only when gateway closes it, *
+ *           either after each request or when its keep-alive timeout expires.*
+ *                                                                            *
+ ******************************************************************************/
+static int	java_gateway_closed(void)
+{
+	fd_set		fds;
+	struct timeval	tv = {0, 0};
+
+	FD_ZERO(&fds);
+	FD_SET(gateway_sock.socket, &fds);
+
+	return 0 == select(gateway_sock.socket + 1, &fds, NULL, NULL, &tv) ? FAIL : SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: java_gateway_exchange                                            *
+ *                                                                            *
+ * Purpose: send request to Java gateway and receive response over the        *
+ *          persistent connection                                             *
+ *                                                                            *
+ * Parameters: data - [IN] the request                                        *
+ *                                                                            *
+ * Return value: SUCCEED - the response is stored in gateway_sock buffer      *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: Caller is responsible for the timeout. Failed request over       *
+ *           reused connection is retried once over a new connection, as      *
+ *           gateway might have closed it in the meantime, unless the request *
+ *           failed because the timeout expired.                              *
+ *                                                                            *
+ ******************************************************************************/
+static int	java_gateway_exchange(const char *data)
+{
+	int	reused, ret = FAIL;
+
+	if (0 != gateway_connected && SUCCEED == java_gateway_closed())
+		java_gateway_disconnect();
+
+	do
+	{
+		if (0 == (reused = gateway_connected))
+		{
+			if (SUCCEED != zbx_tcp_connect(&gateway_sock, CONFIG_SOURCE_IP, CONFIG_JAVA_GATEWAY,
+					CONFIG_JAVA_GATEWAY_PORT, 0, ZBX_TCP_SEC_UNENCRYPTED, NULL, NULL))
+			{
+				break;
+			}
+
+			gateway_connected = 1;
+		}
+
+		if (SUCCEED == (ret = zbx_tcp_send(&gateway_sock, data)) &&
+				SUCCEED == (ret = zbx_tcp_recv(&gateway_sock)))
+		{
+			break;
+		}
+
+		java_gateway_disconnect();
+	}
+	while (0 != reused && SUCCEED != zbx_alarm_timed_out());
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: java_add_endpoint                                                *
+ *                                                                            *
+ * Purpose: add JMX endpoint connection parameters to the request             *
+ *                                                                            *
+ ******************************************************************************/
+static void	java_add_endpoint(struct zbx_json *json, const DC_ITEM *item)
+{
+	if ('\0' != *item->username)
+		zbx_json_addstring(json, ZBX_PROTO_TAG_USERNAME, item->username, ZBX_JSON_TYPE_STRING);
+
+	if ('\0' != *item->password)
+		zbx_json_addstring(json, ZBX_PROTO_TAG_PASSWORD, item->password, ZBX_JSON_TYPE_STRING);
+
+	if ('\0' != *item->jmx_endpoint)
+		zbx_json_addstring(json, ZBX_PROTO_TAG_JMX_ENDPOINT, item->jmx_endpoint, ZBX_JSON_TYPE_STRING);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: java_add_keys                                                    *
+ *                                                                            *
+ * Purpose: add keys of supported items of the specified endpoint (or of all  *
+ *          items if groups is NULL) to the request                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	java_add_keys(struct zbx_json *json, const DC_ITEM *items, const int *errcodes, const int *groups,
+		int group, int num)
+{
+	int	i;
+
+	zbx_json_addarray(json, ZBX_PROTO_TAG_KEYS);
+
+	for (i = 0; i < num; i++)
+	{
+		if (SUCCEED != errcodes[i] || (NULL != groups && group != groups[i]))
+			continue;
+
+		zbx_json_addstring(json, NULL, items[i].key, ZBX_JSON_TYPE_STRING);
+	}
+
+	zbx_json_close(json);
+}
+
 int	get_value_java(unsigned char request, const DC_ITEM *item, AGENT_RESULT *result)
 {
 	int	errcode = SUCCEED;
@@ -126,12 +371,30 @@ int	get_value_java(unsigned char request, const DC_ITEM *item, AGENT_RESULT *res
 	return errcode;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: get_values_java                                                  *
+ *                                                                            *
+ * Purpose: get values of JMX items or internal Java gateway items in a       *
+ *          single request                                                    *
+ *                                                                            *
+ * Comments: JMX requests are sent over a connection kept open between calls, *
+ *           it is closed by gateway unless gateway keep-alive is enabled.    *
+ *                                                                            *
+ *           Items of different JMX endpoints are requested using             *
+ *           "jmx_endpoints" array only if JavaGatewayMultiEndpoint is        *
+ *           enabled, older gateways support one endpoint per request.        *
+ *           Such request also limits the time gateway may spend on the       *
+ *           endpoints so that the response is received before Timeout set   *
+ *           by caller expires, even if some endpoints do not respond.        *
+ *                                                                            *
+ ******************************************************************************/
 void	get_values_java(unsigned char request, const DC_ITEM *items, AGENT_RESULT *results, int *errcodes, int num)
 {
 	zbx_socket_t	s;
 	struct zbx_json	json;
 	char		error[MAX_STRING_LEN];
-	int		i, j, err = SUCCEED;
+	int		i, j, k, group, *groups = NULL, groups_num = 0, err = SUCCEED;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() jmx_endpoint:'%s' num:%d", __func__, items[0].jmx_endpoint, num);
 
@@ -157,79 +420,104 @@ void	get_values_java(unsigned char request, const DC_ITEM *items, AGENT_RESULT *
 	{
 		zbx_json_addstring(&json, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_JAVA_GATEWAY_INTERNAL,
 				ZBX_JSON_TYPE_STRING);
+		java_add_keys(&json, items, errcodes, NULL, 0, num);
 	}
 	else if (ZBX_JAVA_GATEWAY_REQUEST_JMX == request)
 	{
-		for (i = j + 1; i < num; i++)
+		/* group items by connection parameters, items of the same endpoint are expected to follow each other */
+		groups = (int *)zbx_malloc(NULL, sizeof(int) * num);
+
+		for (i = j, k = j; i < num; i++)
 		{
 			if (SUCCEED != errcodes[i])
 				continue;
 
-			if (0 != strcmp(items[j].username, items[i].username) ||
-					0 != strcmp(items[j].password, items[i].password) ||
-					0 != strcmp(items[j].jmx_endpoint, items[i].jmx_endpoint))
+			if (0 == groups_num || 0 != strcmp(items[k].username, items[i].username) ||
+					0 != strcmp(items[k].password, items[i].password) ||
+					0 != strcmp(items[k].jmx_endpoint, items[i].jmx_endpoint))
 			{
-				err = GATEWAY_ERROR;
-				strscpy(error, "Java poller received items with different connection parameters");
-				goto exit;
+				groups_num++;
 			}
-		}
 
-		zbx_json_addstring(&json, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_JAVA_GATEWAY_JMX, ZBX_JSON_TYPE_STRING);
+			groups[i] = groups_num - 1;
+			k = i;
+		}
 
-		if ('\0' != *items[j].username)
+		if (1 < groups_num && 0 == CONFIG_JAVA_GATEWAY_MULTI_ENDPOINT)
 		{
-			zbx_json_addstring(&json, ZBX_PROTO_TAG_USERNAME, items[j].username, ZBX_JSON_TYPE_STRING);
+			err = GATEWAY_ERROR;
+			strscpy(error, "Java poller received items with different connection parameters");
+			goto exit;
 		}
-		if ('\0' != *items[j].password)
+
+		zbx_json_addstring(&json, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_JAVA_GATEWAY_JMX, ZBX_JSON_TYPE_STRING);
+
+		if (1 == groups_num)
 		{
-			zbx_json_addstring(&json, ZBX_PROTO_TAG_PASSWORD, items[j].password, ZBX_JSON_TYPE_STRING);
+			java_add_endpoint(&json, &items[j]);
+			java_add_keys(&json, items, errcodes, NULL, 0, num);
 		}
-		if ('\0' != *items[j].jmx_endpoint)
+		else
 		{
-			zbx_json_addstring(&json, ZBX_PROTO_TAG_JMX_ENDPOINT, items[j].jmx_endpoint,
-					ZBX_JSON_TYPE_STRING);
+			zbx_json_addarray(&json, ZBX_PROTO_TAG_JMX_ENDPOINTS);
+
+			for (group = 0, i = j; group < groups_num; group++)
+			{
+				while (SUCCEED != errcodes[i] || group != groups[i])
+					i++;
+
+				zbx_json_addobject(&json, NULL);
+				java_add_endpoint(&json, &items[i]);
+				java_add_keys(&json, items, errcodes, groups, group, num);
+				zbx_json_close(&json);
+			}
+
+			zbx_json_close(&json);
+
+			/* the time in milliseconds gateway may wait for the values of all endpoints */
+			zbx_json_adduint64(&json, ZBX_PROTO_TAG_TIMEOUT, CONFIG_TIMEOUT * 1000 - ZBX_JAVA_GATEWAY_EXCHANGE_TIME);
 		}
 	}
 	else
 		assert(0);
 
-	zbx_json_addarray(&json, ZBX_PROTO_TAG_KEYS);
-	for (i = j; i < num; i++)
+	zabbix_log(LOG_LEVEL_DEBUG, "JSON before sending [%s]", json.buffer);
+
+	if (ZBX_JAVA_GATEWAY_REQUEST_JMX == request)
 	{
-		if (SUCCEED != errcodes[i])
-			continue;
+		if (SUCCEED == (err = java_gateway_exchange(json.buffer)))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "JSON back [%s]", gateway_sock.buffer);
 
-		zbx_json_addstring(&json, NULL, items[i].key, ZBX_JSON_TYPE_STRING);
+			err = parse_response(results, errcodes, groups, groups_num, num, gateway_sock.buffer, error,
+					sizeof(error));
+		}
 	}
-	zbx_json_close(&json);
-
-	if (SUCCEED == (err = zbx_tcp_connect(&s, CONFIG_SOURCE_IP, CONFIG_JAVA_GATEWAY, CONFIG_JAVA_GATEWAY_PORT,
+	else if (SUCCEED == (err = zbx_tcp_connect(&s, CONFIG_SOURCE_IP, CONFIG_JAVA_GATEWAY, CONFIG_JAVA_GATEWAY_PORT,
 			CONFIG_TIMEOUT, ZBX_TCP_SEC_UNENCRYPTED, NULL, NULL)))
 	{
-		zabbix_log(LOG_LEVEL_DEBUG, "JSON before sending [%s]", json.buffer);
-
 		if (SUCCEED == (err = zbx_tcp_send(&s, json.buffer)))
 		{
 			if (SUCCEED == (err = zbx_tcp_recv(&s)))
 			{
 				zabbix_log(LOG_LEVEL_DEBUG, "JSON back [%s]", s.buffer);
 
-				err = parse_response(results, errcodes, num, s.buffer, error, sizeof(error));
+				err = parse_response(results, errcodes, NULL, 1, num, s.buffer, error, sizeof(error));
 			}
 		}
 
 		zbx_tcp_close(&s);
 	}
 
-	zbx_json_free(&json);
-
 	if (FAIL == err)
 	{
 		strscpy(error, zbx_socket_strerror());
 		err = GATEWAY_ERROR;
 	}
 exit:
+	zbx_json_free(&json);
+	zbx_free(groups);
+
 	if (NETWORK_ERROR == err || GATEWAY_ERROR == err)
 	{
 		zabbix_log(LOG_LEVEL_DEBUG, "getting Java values failed: %s", error);
@@ -224,7 +224,6 @@ static int	vmware_service_get_counter_value_by_id(zbx_vmware_service_t *service,
 {
 	zbx_vmware_perf_entity_t	*entity;
 	zbx_vmware_perf_counter_t	*perfcounter;
-	zbx_str_uint64_pair_t		*perfvalue;
 	int				i, ret = SYSINFO_RET_FAIL;
 	zbx_uint64_t			value;
 
@@ -265,28 +264,24 @@ static int	vmware_service_get_counter_value_by_id(zbx_vmware_service_t *service,
 		goto out;
 	}
 
-	for (i = 0; i < perfcounter->values.values_num; i++)
-	{
-		perfvalue = &perfcounter->values.values[i];
-
-		if (0 == strcmp(perfvalue->name, instance))
-			break;
-	}
-
-	if (i == perfcounter->values.values_num)
+	/* counter values are in the order of the sorted counter instances */
+	if (FAIL == (i = zbx_vector_str_bsearch(perfcounter->instances, (char *)instance,
+			ZBX_DEFAULT_STR_COMPARE_FUNC)))
 	{
 		SET_MSG_RESULT(result, zbx_strdup(NULL, "Performance counter instance was not found."));
 		goto out;
 	}
 
+	value = perfcounter->values.values[i];
+
 	/* VMware returns -1 value if the performance data for the specified period is not ready - ignore it */
-	if (ZBX_MAX_UINT64 == perfvalue->value)
+	if (ZBX_MAX_UINT64 == value)
 	{
 		ret = SYSINFO_RET_OK;
 		goto out;
 	}
 
-	value = perfvalue->value * coeff;
+	value *= coeff;
 	SET_UI64_RESULT(result, value);
 	ret = SYSINFO_RET_OK;
 out:
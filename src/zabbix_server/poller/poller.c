@@ -708,7 +708,8 @@ void	zbx_prepare_items(DC_ITEM *items, int *errcodes, int num, AGENT_RESULT *res
 	zbx_free(port);
 }
 
-void	zbx_check_items(DC_ITEM *items, int *errcodes, int num, AGENT_RESULT *results, zbx_vector_ptr_t *add_results)
+void	zbx_check_items(DC_ITEM *items, int *errcodes, int num, AGENT_RESULT *results, zbx_vector_ptr_t *add_results,
+		unsigned char agent_connection)
 {
 	if (SUCCEED == is_snmp_type(items[0].type))
 	{
@@ -734,6 +735,11 @@ void	zbx_check_items(DC_ITEM *items, int *errcodes, int num, AGENT_RESULT *resul
 		get_values_java(ZBX_JAVA_GATEWAY_REQUEST_JMX, items, results, errcodes, num);
 		zbx_alarm_off();
 	}
+	else if (ITEM_TYPE_ZABBIX == items[0].type && ZBX_AGENT_CONNECTION_POOLED == agent_connection)
+	{
+		/* Zabbix agent checks use their own timeouts */
+		get_values_agent(items, results, errcodes, num);
+	}
 	else if (1 == num)
 	{
 		if (SUCCEED == errcodes[0])
@@ -821,6 +827,7 @@ static int	get_values(unsigned char poller_type, int *nextcheck)
 	zbx_timespec_t		timespec;
 	int			i, num, last_available = HOST_AVAILABLE_UNKNOWN;
 	zbx_vector_ptr_t	add_results;
+	double			sec;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -835,13 +842,24 @@ static int	get_values(unsigned char poller_type, int *nextcheck)
 	zbx_vector_ptr_create(&add_results);
 
 	zbx_prepare_items(items, errcodes, num, results, MACRO_EXPAND_YES);
-	zbx_check_items(items, errcodes, num, results, &add_results);
+
+	/* values are retrieved together, except Zabbix agent checks falling back to one request per */
+	/* item - those record the latency of every request to agent themselves                      */
+	sec = zbx_time();
+	zbx_check_items(items, errcodes, num, results, &add_results, ZBX_AGENT_CONNECTION_POOLED);
+
+	if (ITEM_TYPE_ZABBIX != items[0].type)
+		update_selfmon_latency(zbx_time() - sec);
 
 	zbx_timespec(&timespec);
 
 	/* process item values */
 	for (i = 0; i < num; i++)
 	{
+		/* Java pollers batch items of different hosts */
+		if (0 != i && items[i].host.hostid != items[i - 1].host.hostid)
+			last_available = HOST_AVAILABLE_UNKNOWN;
+
 		switch (errcodes[i])
 		{
 			case SUCCEED:
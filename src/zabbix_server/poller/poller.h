@@ -27,12 +27,17 @@ extern int	CONFIG_UNAVAILABLE_DELAY;
 extern int	CONFIG_UNREACHABLE_PERIOD;
 extern int	CONFIG_UNREACHABLE_DELAY;
 
+/* connections used by zbx_check_items() for Zabbix agent checks */
+#define ZBX_AGENT_CONNECTION_NEW	0
+#define ZBX_AGENT_CONNECTION_POOLED	1
+
 ZBX_THREAD_ENTRY(poller_thread, args);
 
 void	zbx_activate_item_host(DC_ITEM *item, zbx_timespec_t *ts);
 void	zbx_deactivate_item_host(DC_ITEM *item, zbx_timespec_t *ts, const char *error);
 void	zbx_prepare_items(DC_ITEM *items, int *errcodes, int num, AGENT_RESULT *results, unsigned char expand_macros);
-void	zbx_check_items(DC_ITEM *items, int *errcodes, int num, AGENT_RESULT *results, zbx_vector_ptr_t *add_results);
+void	zbx_check_items(DC_ITEM *items, int *errcodes, int num, AGENT_RESULT *results, zbx_vector_ptr_t *add_results,
+		unsigned char agent_connection);
 void	zbx_clean_items(DC_ITEM *items, int num, AGENT_RESULT *results);
 void	zbx_free_result_ptr(AGENT_RESULT *result);
 
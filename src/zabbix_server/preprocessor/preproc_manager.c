@@ -496,8 +496,11 @@ static void	preprocessor_flush_value(const zbx_preproc_item_value_t *value)
 {
 	if (0 == (value->item_flags & ZBX_FLAG_DISCOVERY_RULE) || 0 == (program_type & ZBX_PROGRAM_TYPE_SERVER))
 	{
+		if (0 != value->sample_origin)
+			update_selfmon_value_latency(ZBX_VALUE_LATENCY_PREPROCESSING, zbx_time() - value->sample_time);
+
 		dc_add_history(value->itemid, value->item_value_type, value->item_flags, value->result, value->ts,
-				value->state, value->error);
+				value->state, value->error, value->sample_origin);
 	}
 	else
 		zbx_lld_process_agent_result(value->itemid, value->result, value->ts, value->error);
@@ -791,6 +794,7 @@ static void	preprocessor_enqueue_dependent(zbx_preprocessing_manager_t *manager,
 				preprocessor_copy_value(&value, source_value);
 				value.itemid = item->dep_itemids[i].first;
 				value.item_flags = item->dep_itemids[i].second;
+				value.sample_origin = 0;
 				preprocessor_enqueue(manager, &value, master);
 			}
 
@@ -824,6 +828,14 @@ static void	preprocessor_add_request(zbx_preprocessing_manager_t *manager, zbx_i
 	while (offset < message->size)
 	{
 		offset += zbx_preprocessor_unpack_value(&value, message->data + offset);
+
+		if (0 != value.sample_origin)
+		{
+			value.sample_time = zbx_time();
+			update_selfmon_value_latency(ZBX_VALUE_LATENCY_COLLECTION,
+					value.sample_time - value.sample_origin);
+		}
+
 		preprocessor_enqueue(manager, &value, NULL);
 	}
 
@@ -1087,6 +1099,103 @@ static void	preprocessor_flush_test_result(zbx_preprocessing_manager_t *manager,
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: preprocessor_get_diag_stats                                      *
+ *                                                                            *
+ * Purpose: return diagnostic statistics                                      *
+ *                                                                            *
+ * Parameters: manager - [IN] preprocessing manager                           *
+ *             client  - [IN] IPC client                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	preprocessor_get_diag_stats(zbx_preprocessing_manager_t *manager, zbx_ipc_client_t *client)
+{
+	zbx_uint64_t	data[2] = {manager->queued_num, manager->preproc_num};
+
+	zbx_ipc_client_send(client, ZBX_IPC_PREPROCESSOR_DIAG_STATS, (unsigned char *)data, sizeof(data));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: preprocessor_compare_values_num                                  *
+ *                                                                            *
+ * Purpose: sort items by the number of queued values in descending order     *
+ *                                                                            *
+ *****************************************************************************/
+static int	preprocessor_compare_values_num(const void *d1, const void *d2)
+{
+	const zbx_uint64_pair_t	*p1 = (const zbx_uint64_pair_t *)d1;
+	const zbx_uint64_pair_t	*p2 = (const zbx_uint64_pair_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(p2->second, p1->second);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: preprocessor_get_top_items                                       *
+ *                                                                            *
+ * Purpose: return the items with most values in preprocessing queue          *
+ *                                                                            *
+ * Parameters: manager - [IN] preprocessing manager                           *
+ *             client  - [IN] IPC client                                      *
+ *             message - [IN] the message with number of top items to return  *
+ *                                                                            *
+ ******************************************************************************/
+static void	preprocessor_get_top_items(zbx_preprocessing_manager_t *manager, zbx_ipc_client_t *client,
+		const zbx_ipc_message_t *message)
+{
+	int				limit;
+	zbx_list_iterator_t		iterator;
+	zbx_preprocessing_request_t	*request;
+	zbx_hashset_t			items;
+	zbx_hashset_iter_t		iter;
+	zbx_uint64_pair_t		*item, item_local;
+	zbx_vector_uint64_pair_t	top;
+	unsigned char			*data;
+	zbx_uint32_t			size;
+
+	memcpy(&limit, message->data, sizeof(limit));
+
+	zbx_hashset_create(&items, 1000, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_vector_uint64_pair_create(&top);
+
+	zbx_list_iterator_init(&manager->queue, &iterator);
+	while (SUCCEED == zbx_list_iterator_next(&iterator))
+	{
+		zbx_list_iterator_peek(&iterator, (void **)&request);
+
+		if (NULL == (item = (zbx_uint64_pair_t *)zbx_hashset_search(&items, &request->value.itemid)))
+		{
+			item_local.first = request->value.itemid;
+			item_local.second = 0;
+			item = (zbx_uint64_pair_t *)zbx_hashset_insert(&items, &item_local, sizeof(item_local));
+		}
+
+		item->second++;
+	}
+
+	zbx_vector_uint64_pair_reserve(&top, items.num_data);
+
+	zbx_hashset_iter_reset(&items, &iter);
+	while (NULL != (item = (zbx_uint64_pair_t *)zbx_hashset_iter_next(&iter)))
+		zbx_vector_uint64_pair_append_ptr(&top, item);
+
+	zbx_vector_uint64_pair_sort(&top, preprocessor_compare_values_num);
+
+	if (top.values_num > limit)
+		top.values_num = limit;
+
+	size = zbx_preprocessor_pack_top_items(&data, &top);
+	zbx_ipc_client_send(client, ZBX_IPC_PREPROCESSOR_TOP_ITEMS, data, size);
+
+	zbx_free(data);
+	zbx_vector_uint64_pair_destroy(&top);
+	zbx_hashset_destroy(&items);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: preprocessor_init_manager                                        *
@@ -1264,9 +1373,11 @@ ZBX_THREAD_ENTRY(preprocessing_manager_thread, args)
 					break;
 				case ZBX_IPC_PREPROCESSOR_REQUEST:
 					preprocessor_add_request(&manager, message);
+					update_selfmon_latency(zbx_time() - sec);
 					break;
 				case ZBX_IPC_PREPROCESSOR_RESULT:
 					preprocessor_add_result(&manager, client, message);
+					update_selfmon_latency(zbx_time() - sec);
 					break;
 				case ZBX_IPC_PREPROCESSOR_QUEUE:
 					zbx_ipc_client_send(client, message->code, (unsigned char *)&manager.queued_num,
@@ -1278,6 +1389,12 @@ ZBX_THREAD_ENTRY(preprocessing_manager_thread, args)
 				case ZBX_IPC_PREPROCESSOR_TEST_RESULT:
 					preprocessor_flush_test_result(&manager, client, message);
 					break;
+				case ZBX_IPC_PREPROCESSOR_DIAG_STATS:
+					preprocessor_get_diag_stats(&manager, client);
+					break;
+				case ZBX_IPC_PREPROCESSOR_TOP_ITEMS:
+					preprocessor_get_top_items(&manager, client, message);
+					break;
 			}
 
 			zbx_ipc_message_free(message);
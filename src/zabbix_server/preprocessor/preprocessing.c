@@ -46,6 +46,9 @@ zbx_packed_field_t;
 
 static zbx_ipc_message_t	cached_message;
 static int			cached_values;
+static int			sample_values;
+
+extern int	CONFIG_LATENCY_SAMPLE_RATE;
 
 /******************************************************************************
  *                                                                            *
@@ -125,11 +128,12 @@ static zbx_uint32_t	message_pack_data(zbx_ipc_message_t *message, zbx_packed_fie
  ******************************************************************************/
 static zbx_uint32_t	preprocessor_pack_value(zbx_ipc_message_t *message, zbx_preproc_item_value_t *value)
 {
-	zbx_packed_field_t	fields[23], *offset = fields;	/* 23 - max field count */
-	unsigned char		ts_marker, result_marker, log_marker;
+	zbx_packed_field_t	fields[25], *offset = fields;	/* 25 - max field count */
+	unsigned char		ts_marker, result_marker, log_marker, sample_marker;
 
 	ts_marker = (NULL != value->ts);
 	result_marker = (NULL != value->result);
+	sample_marker = (0 != value->sample_origin);
 
 	*offset++ = PACKED_FIELD(&value->itemid, sizeof(zbx_uint64_t));
 	*offset++ = PACKED_FIELD(&value->item_value_type, sizeof(unsigned char));
@@ -170,6 +174,11 @@ static zbx_uint32_t	preprocessor_pack_value(zbx_ipc_message_t *message, zbx_prep
 		}
 	}
 
+	*offset++ = PACKED_FIELD(&sample_marker, sizeof(unsigned char));
+
+	if (0 != sample_marker)
+		*offset++ = PACKED_FIELD(&value->sample_origin, sizeof(double));
+
 	return message_pack_data(message, fields, offset - fields);
 }
 
@@ -615,7 +624,7 @@ zbx_uint32_t	zbx_preprocessor_unpack_value(zbx_preproc_item_value_t *value, unsi
 	zbx_timespec_t	*timespec = NULL;
 	AGENT_RESULT	*agent_result = NULL;
 	zbx_log_t	*log = NULL;
-	unsigned char	*offset = data, ts_marker, result_marker, log_marker;
+	unsigned char	*offset = data, ts_marker, result_marker, log_marker, sample_marker;
 
 	offset += zbx_deserialize_uint64(offset, &value->itemid);
 	offset += zbx_deserialize_char(offset, &value->item_value_type);
@@ -665,6 +674,15 @@ zbx_uint32_t	zbx_preprocessor_unpack_value(zbx_preproc_item_value_t *value, unsi
 
 	value->result = agent_result;
 
+	offset += zbx_deserialize_char(offset, &sample_marker);
+
+	if (0 != sample_marker)
+		offset += zbx_deserialize_double(offset, &value->sample_origin);
+	else
+		value->sample_origin = 0;
+
+	value->sample_time = 0;
+
 	return offset - data;
 }
 
@@ -772,6 +790,65 @@ void	zbx_preprocessor_unpack_test_result(zbx_vector_ptr_t *results, zbx_vector_p
 
 	(void)zbx_deserialize_str(offset, error, value_len);
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_preprocessor_pack_top_items                                  *
+ *                                                                            *
+ * Purpose: pack top items by the number of queued values                     *
+ *                                                                            *
+ * Parameters: data  - [OUT] memory buffer for packed data                    *
+ *             items - [IN] the itemid, number of queued values pairs         *
+ *                                                                            *
+ * Return value: size of packed data                                          *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint32_t	zbx_preprocessor_pack_top_items(unsigned char **data, const zbx_vector_uint64_pair_t *items)
+{
+	unsigned char	*ptr;
+	zbx_uint32_t	size;
+	int		i;
+
+	size = sizeof(int) + (zbx_uint32_t)items->values_num * sizeof(zbx_uint64_t) * 2;
+	ptr = *data = (unsigned char *)zbx_malloc(NULL, size);
+
+	ptr += zbx_serialize_int(ptr, items->values_num);
+
+	for (i = 0; i < items->values_num; i++)
+	{
+		ptr += zbx_serialize_uint64(ptr, items->values[i].first);
+		ptr += zbx_serialize_uint64(ptr, items->values[i].second);
+	}
+
+	return size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_preprocessor_unpack_top_items                                *
+ *                                                                            *
+ * Purpose: unpack top items by the number of queued values                   *
+ *                                                                            *
+ * Parameters: items - [OUT] the itemid, number of queued values pairs        *
+ *             data  - [IN] the packed data                                   *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_preprocessor_unpack_top_items(zbx_vector_uint64_pair_t *items, const unsigned char *data)
+{
+	int			i, items_num;
+	zbx_uint64_pair_t	pair;
+
+	data += zbx_deserialize_int(data, &items_num);
+
+	zbx_vector_uint64_pair_reserve(items, items_num);
+
+	for (i = 0; i < items_num; i++)
+	{
+		data += zbx_deserialize_uint64(data, &pair.first);
+		data += zbx_deserialize_uint64(data, &pair.second);
+		zbx_vector_uint64_pair_append_ptr(items, &pair);
+	}
+}
 /******************************************************************************
  *                                                                            *
  * Function: preprocessor_send                                                *
@@ -837,6 +914,13 @@ void	zbx_preprocess_item_value(zbx_uint64_t itemid, unsigned char item_value_typ
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
+	/* every Nth value is sampled to track its latency through the processing pipeline */
+	if (0 != CONFIG_LATENCY_SAMPLE_RATE && CONFIG_LATENCY_SAMPLE_RATE <= ++sample_values)
+	{
+		value.sample_origin = zbx_time();
+		sample_values = 0;
+	}
+
 	preprocessor_pack_value(&cached_message, &value);
 
 	if (MAX_VALUES_LOCAL < ++cached_values)
@@ -886,6 +970,68 @@ zbx_uint64_t	zbx_preprocessor_get_queue_size(void)
 	return size;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_preprocessor_get_diag_stats                                  *
+ *                                                                            *
+ * Purpose: get preprocessing manager diagnostic statistics                   *
+ *                                                                            *
+ * Parameters: values_num         - [OUT] the number of queued values         *
+ *             values_preproc_num - [OUT] the number of queued values with    *
+ *                                        preprocessing steps                 *
+ *             error              - [OUT] the error message                   *
+ *                                                                            *
+ * Return value: SUCCEED - the statistics were returned successfully          *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_preprocessor_get_diag_stats(zbx_uint64_t *values_num, zbx_uint64_t *values_preproc_num, char **error)
+{
+	unsigned char	*result;
+
+	if (SUCCEED != zbx_ipc_async_exchange(ZBX_IPC_SERVICE_PREPROCESSING, ZBX_IPC_PREPROCESSOR_DIAG_STATS,
+			SEC_PER_MIN, NULL, 0, &result, error))
+	{
+		return FAIL;
+	}
+
+	memcpy(values_num, result, sizeof(zbx_uint64_t));
+	memcpy(values_preproc_num, result + sizeof(zbx_uint64_t), sizeof(zbx_uint64_t));
+	zbx_free(result);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_preprocessor_get_top_items                                   *
+ *                                                                            *
+ * Purpose: get the items with most values in preprocessing queue             *
+ *                                                                            *
+ * Parameters: limit - [IN] the number of top items to return                 *
+ *             items - [OUT] the itemid, number of queued values pairs        *
+ *             error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: SUCCEED - the top items were returned successfully           *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_preprocessor_get_top_items(int limit, zbx_vector_uint64_pair_t *items, char **error)
+{
+	unsigned char	*result;
+
+	if (SUCCEED != zbx_ipc_async_exchange(ZBX_IPC_SERVICE_PREPROCESSING, ZBX_IPC_PREPROCESSOR_TOP_ITEMS,
+			SEC_PER_MIN, (unsigned char *)&limit, sizeof(limit), &result, error))
+	{
+		return FAIL;
+	}
+
+	zbx_preprocessor_unpack_top_items(items, result);
+	zbx_free(result);
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_preproc_op_free                                              *
@@ -34,6 +34,8 @@
 #define ZBX_IPC_PREPROCESSOR_QUEUE		4
 #define ZBX_IPC_PREPROCESSOR_TEST_REQUEST	5
 #define ZBX_IPC_PREPROCESSOR_TEST_RESULT	6
+#define ZBX_IPC_PREPROCESSOR_DIAG_STATS		7
+#define ZBX_IPC_PREPROCESSOR_TOP_ITEMS		8
 
 /* item value data used in preprocessing manager */
 typedef struct
@@ -45,6 +47,8 @@ typedef struct
 	char		*error;		 /* error message (if any) */
 	unsigned char	item_flags;	 /* item flags */
 	unsigned char	state;		 /* item state */
+	double		sample_origin;	 /* collection time of value sampled for latency statistics */
+	double		sample_time;	 /* time the sampled value was received by preprocessing manager */
 }
 zbx_preproc_item_value_t;
 
@@ -70,4 +74,7 @@ zbx_uint32_t	zbx_preprocessor_pack_test_result(unsigned char **data, const zbx_p
 void	zbx_preprocessor_unpack_test_result(zbx_vector_ptr_t *results, zbx_vector_ptr_t *history,
 		char **error, const unsigned char *data);
 
+zbx_uint32_t	zbx_preprocessor_pack_top_items(unsigned char **data, const zbx_vector_uint64_pair_t *items);
+void	zbx_preprocessor_unpack_top_items(zbx_vector_uint64_pair_t *items, const unsigned char *data);
+
 #endif /* ZABBIX_PREPROCESSING_H */
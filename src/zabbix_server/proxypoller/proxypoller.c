@@ -30,259 +30,569 @@
 #include "log.h"
 #include "proxy.h"
 #include "zbxcrypto.h"
+#include "zbxtasks.h"
 #include "../trapper/proxydata.h"
 
 extern unsigned char	process_type, program_type;
 extern int		server_num, process_num;
 
-static int	connect_to_proxy(const DC_PROXY *proxy, zbx_socket_t *sock, int timeout)
+typedef struct
 {
-	int		ret = FAIL;
-	const char	*tls_arg1, *tls_arg2;
+	zbx_uint64_t	hostid;
+	char		*revisions;
+}
+zbx_proxy_revisions_t;
+
+/* revisions of the configuration applied by passive proxies, reported in configuration update responses */
+static zbx_hashset_t	proxy_revisions;
+
+/* maximum number of passive proxies handled by one proxy poller iteration */
+#define ZBX_PROXY_SESSIONS_MAX		32
+
+/* proxy connection states */
+#define ZBX_PROXY_CONN_IDLE		0	/* not connected */
+#define ZBX_PROXY_CONN_CONNECT		1	/* connecting, including TLS handshake */
+#define ZBX_PROXY_CONN_SEND		2	/* sending request */
+#define ZBX_PROXY_CONN_RECV		3	/* receiving response */
+#define ZBX_PROXY_CONN_READY		4	/* response received, waiting to be processed */
+#define ZBX_PROXY_CONN_ACK		5	/* sending response acknowledgement */
+
+typedef struct
+{
+	zbx_socket_t		s;
+	zbx_tcp_send_context_t	send;
+	zbx_tcp_recv_context_t	recv;
+	zbx_timespec_t		ts;		/* the connection timestamp */
+	time_t			deadline;	/* the time until the current network operation must be finished */
+	zbx_vector_ptr_t	tasks;		/* the remote tasks sent with acknowledgement */
+	int			wait;		/* the socket events the connection is waiting for */
+	unsigned char		polled;		/* the connection socket is added to the select() sets */
+	unsigned char		state;
+}
+zbx_proxy_conn_t;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() address:%s port:%hu timeout:%d conn:%u", __func__, proxy->addr,
-			proxy->port, timeout, (unsigned int)proxy->tls_connect);
+typedef struct
+{
+	DC_PROXY		proxy;
+	DC_PROXY		proxy_old;
+	zbx_proxy_conn_t	conns[2];	/* the second connection is used to request the next proxy */
+						/* data batch while the current one is being processed     */
+	const char		*request;	/* the type of the request being processed */
+	int			cur;		/* the connection with the oldest request */
+	int			ret;
+	unsigned char		update_nextcheck;
+	unsigned char		pending;	/* the requests to be sent, ZBX_PROXY_*_NEXTCHECK flags */
+	unsigned char		done;
+}
+zbx_proxy_session_t;
 
+static int	proxy_get_tls_args(const DC_PROXY *proxy, const char **tls_arg1, const char **tls_arg2)
+{
 	switch (proxy->tls_connect)
 	{
 		case ZBX_TCP_SEC_UNENCRYPTED:
-			tls_arg1 = NULL;
-			tls_arg2 = NULL;
-			break;
+			*tls_arg1 = NULL;
+			*tls_arg2 = NULL;
+			return SUCCEED;
 #if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
 		case ZBX_TCP_SEC_TLS_CERT:
-			tls_arg1 = proxy->tls_issuer;
-			tls_arg2 = proxy->tls_subject;
-			break;
+			*tls_arg1 = proxy->tls_issuer;
+			*tls_arg2 = proxy->tls_subject;
+			return SUCCEED;
 		case ZBX_TCP_SEC_TLS_PSK:
-			tls_arg1 = proxy->tls_psk_identity;
-			tls_arg2 = proxy->tls_psk;
-			break;
+			*tls_arg1 = proxy->tls_psk_identity;
+			*tls_arg2 = proxy->tls_psk;
+			return SUCCEED;
 #else
 		case ZBX_TCP_SEC_TLS_CERT:
 		case ZBX_TCP_SEC_TLS_PSK:
 			zabbix_log(LOG_LEVEL_ERR, "TLS connection is configured to be used with passive proxy \"%s\""
 					" but support for TLS was not compiled into %s.", proxy->host,
 					get_program_type_string(program_type));
-			ret = CONFIG_ERROR;
-			goto out;
+			return CONFIG_ERROR;
 #endif
 		default:
 			THIS_SHOULD_NEVER_HAPPEN;
-			goto out;
+			return FAIL;
 	}
-
-	if (FAIL == (ret = zbx_tcp_connect(sock, CONFIG_SOURCE_IP, proxy->addr, proxy->port, timeout,
-			proxy->tls_connect, tls_arg1, tls_arg2)))
-	{
-		zabbix_log(LOG_LEVEL_ERR, "cannot connect to proxy \"%s\": %s", proxy->host, zbx_socket_strerror());
-		ret = NETWORK_ERROR;
-	}
-out:
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
-
-	return ret;
 }
 
-static int	send_data_to_proxy(const DC_PROXY *proxy, zbx_socket_t *sock, const char *data, size_t size)
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_conn_open                                                  *
+ *                                                                            *
+ * Purpose: start connecting to proxy, the data is sent once the connection   *
+ *          is established                                                    *
+ *                                                                            *
+ * Parameters: proxy - [IN] the proxy                                         *
+ *             conn  - [OUT] the proxy connection                             *
+ *             data  - [IN] the data to send                                  *
+ *             size  - [IN] the data size                                     *
+ *                                                                            *
+ * Return value: SUCCEED - the connection is in progress                      *
+ *               other code - an error occurred                               *
+ *                                                                            *
+ * Comments: Proxy address is resolved synchronously.                         *
+ *                                                                            *
+ ******************************************************************************/
+static int	proxy_conn_open(const DC_PROXY *proxy, zbx_proxy_conn_t *conn, const char *data, size_t size)
 {
-	int	ret, flags = ZBX_TCP_PROTOCOL;
+	const char	*tls_arg1, *tls_arg2;
+	int		ret, flags = ZBX_TCP_PROTOCOL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() address:%s port:%hu conn:%u data:'%s'", __func__, proxy->addr,
+			proxy->port, (unsigned int)proxy->tls_connect, data);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() data:'%s'", __func__, data);
+	conn->polled = 0;
+
+	if (SUCCEED != (ret = proxy_get_tls_args(proxy, &tls_arg1, &tls_arg2)))
+		goto out;
 
 	if (0 != proxy->auto_compress)
 		flags |= ZBX_TCP_COMPRESS;
 
-	if (FAIL == (ret = zbx_tcp_send_ext(sock, data, size, flags, 0)))
+	if (SUCCEED != zbx_tcp_send_context_init(&conn->send, data, size, flags))
 	{
 		zabbix_log(LOG_LEVEL_ERR, "cannot send data to proxy \"%s\": %s", proxy->host, zbx_socket_strerror());
+		ret = NETWORK_ERROR;
+		goto out;
+	}
 
+	if (FAIL == zbx_tcp_connect_nowait(&conn->s, CONFIG_SOURCE_IP, proxy->addr, proxy->port,
+			proxy->tls_connect, tls_arg1, tls_arg2, &conn->wait))
+	{
+		zabbix_log(LOG_LEVEL_ERR, "cannot connect to proxy \"%s\": %s", proxy->host, zbx_socket_strerror());
+		zbx_tcp_send_context_clear(&conn->send);
 		ret = NETWORK_ERROR;
+		goto out;
 	}
 
+	conn->deadline = time(NULL) + CONFIG_TRAPPER_TIMEOUT;
+
+	if (0 != conn->wait)
+	{
+		conn->state = ZBX_PROXY_CONN_CONNECT;
+	}
+	else
+	{
+		zbx_timespec(&conn->ts);
+		conn->state = ZBX_PROXY_CONN_SEND;
+		conn->wait = ZBX_TCP_WAIT_WRITE;
+	}
+out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
 	return ret;
 }
 
-static int	recv_data_from_proxy(const DC_PROXY *proxy, zbx_socket_t *sock)
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_conn_close                                                 *
+ *                                                                            *
+ * Purpose: close proxy connection and release its resources                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_conn_close(zbx_proxy_conn_t *conn)
 {
-	int	ret;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
-
-	if (FAIL == (ret = zbx_tcp_recv(sock)))
+	switch (conn->state)
 	{
-		zabbix_log(LOG_LEVEL_ERR, "cannot obtain data from proxy \"%s\": %s", proxy->host,
-				zbx_socket_strerror());
+		case ZBX_PROXY_CONN_IDLE:
+			return;
+		case ZBX_PROXY_CONN_ACK:
+			zbx_vector_ptr_clear_ext(&conn->tasks, (zbx_clean_func_t)zbx_tm_task_free);
+			zbx_vector_ptr_destroy(&conn->tasks);
+			ZBX_FALLTHROUGH;
+		case ZBX_PROXY_CONN_CONNECT:
+		case ZBX_PROXY_CONN_SEND:
+			zbx_tcp_send_context_clear(&conn->send);
+			break;
 	}
-	else
-		zabbix_log(LOG_LEVEL_DEBUG, "obtained data from proxy \"%s\": [%s]", proxy->host, sock->buffer);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+	zbx_tcp_close(&conn->s);
 
-	return ret;
+	conn->state = ZBX_PROXY_CONN_IDLE;
+	conn->wait = 0;
+	conn->polled = 0;
 }
 
-static void	disconnect_proxy(zbx_socket_t *sock)
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_conn_step                                                  *
+ *                                                                            *
+ * Purpose: continue the network operation of proxy connection after its      *
+ *          socket became ready                                               *
+ *                                                                            *
+ * Parameters: proxy - [IN] the proxy                                         *
+ *             conn  - [IN/OUT] the proxy connection                          *
+ *                                                                            *
+ * Return value: SUCCEED - the operation is in progress or finished           *
+ *               NETWORK_ERROR - an error occurred, the connection is closed  *
+ *                                                                            *
+ * Comments: The connection is closed after the acknowledgement is sent.      *
+ *                                                                            *
+ ******************************************************************************/
+static int	proxy_conn_step(const DC_PROXY *proxy, zbx_proxy_conn_t *conn)
 {
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+	const char	*tls_arg1 = NULL, *tls_arg2 = NULL;
 
-	zbx_tcp_close(sock);
+	switch (conn->state)
+	{
+		case ZBX_PROXY_CONN_CONNECT:
+			proxy_get_tls_args(proxy, &tls_arg1, &tls_arg2);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+			if (FAIL == zbx_tcp_connect_continue(&conn->s, proxy->tls_connect, tls_arg1, tls_arg2,
+					&conn->wait))
+			{
+				zabbix_log(LOG_LEVEL_ERR, "cannot connect to proxy \"%s\": %s", proxy->host,
+						zbx_socket_strerror());
+
+				/* the socket is already closed */
+				zbx_tcp_send_context_clear(&conn->send);
+				conn->state = ZBX_PROXY_CONN_IDLE;
+				conn->wait = 0;
+				return NETWORK_ERROR;
+			}
+
+			if (0 != conn->wait)
+				break;
+
+			zbx_timespec(&conn->ts);
+			conn->state = ZBX_PROXY_CONN_SEND;
+			ZBX_FALLTHROUGH;
+		case ZBX_PROXY_CONN_SEND:
+		case ZBX_PROXY_CONN_ACK:
+			if (FAIL == zbx_tcp_send_context(&conn->s, &conn->send, &conn->wait))
+			{
+				zabbix_log(LOG_LEVEL_ERR, "cannot send data to proxy \"%s\": %s", proxy->host,
+						zbx_socket_strerror());
+				proxy_conn_close(conn);
+				return NETWORK_ERROR;
+			}
+
+			if (0 != conn->wait)
+				break;
+
+			if (ZBX_PROXY_CONN_ACK == conn->state)
+			{
+				if (0 != conn->tasks.values_num)
+					zbx_tm_update_task_status(&conn->tasks, ZBX_TM_STATUS_INPROGRESS);
+
+				proxy_conn_close(conn);
+				break;
+			}
+
+			zbx_tcp_send_context_clear(&conn->send);
+			zbx_tcp_recv_context_init(&conn->s, &conn->recv);
+			conn->state = ZBX_PROXY_CONN_RECV;
+			conn->wait = ZBX_TCP_WAIT_READ;
+			conn->deadline = time(NULL) + CONFIG_TRAPPER_TIMEOUT;
+			break;
+		case ZBX_PROXY_CONN_RECV:
+			if (FAIL == zbx_tcp_recv_context(&conn->s, &conn->recv, &conn->wait))
+			{
+				zabbix_log(LOG_LEVEL_ERR, "cannot obtain data from proxy \"%s\": %s", proxy->host,
+						zbx_socket_strerror());
+				proxy_conn_close(conn);
+				return NETWORK_ERROR;
+			}
+
+			if (0 != conn->wait)
+				break;
+
+			zabbix_log(LOG_LEVEL_DEBUG, "obtained data from proxy \"%s\": [%s]", proxy->host,
+					conn->s.buffer);
+			conn->state = ZBX_PROXY_CONN_READY;
+			break;
+	}
+
+	return SUCCEED;
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: get_data_from_proxy                                              *
+ * Function: proxy_conn_timeout                                               *
+ *                                                                            *
+ * Purpose: close proxy connection which did not finish its network operation *
+ *          in time                                                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_conn_timeout(const DC_PROXY *proxy, zbx_proxy_conn_t *conn)
+{
+	switch (conn->state)
+	{
+		case ZBX_PROXY_CONN_CONNECT:
+			zabbix_log(LOG_LEVEL_ERR, "cannot connect to proxy \"%s\": timeout while connecting",
+					proxy->host);
+			break;
+		case ZBX_PROXY_CONN_SEND:
+		case ZBX_PROXY_CONN_ACK:
+			zabbix_log(LOG_LEVEL_ERR, "cannot send data to proxy \"%s\": timeout while sending",
+					proxy->host);
+			break;
+		default:
+			zabbix_log(LOG_LEVEL_ERR, "cannot obtain data from proxy \"%s\": timeout while waiting"
+					" for response", proxy->host);
+	}
+
+	proxy_conn_close(conn);
+}
+
+/******************************************************************************
  *                                                                            *
- * Purpose: get historical data from proxy                                    *
+ * Function: proxy_session_send_request                                       *
  *                                                                            *
- * Parameters: proxy   - [IN/OUT] proxy data                                  *
+ * Purpose: start sending data request to proxy                               *
+ *                                                                            *
+ * Parameters: session - [IN] the proxy session                               *
+ *             conn    - [OUT] the connection to use                          *
  *             request - [IN] requested data type                             *
- *             data    - [OUT] data received from proxy                       *
- *             ts      - [OUT] timestamp when the proxy connection was        *
- *                             established                                    *
- *             tasks   - [IN] proxy task response flag                        *
  *                                                                            *
- * Return value: SUCCESS - processed successfully                             *
+ * Return value: SUCCESS - the request is being sent                          *
  *               other code - an error occurred                               *
  *                                                                            *
- * Comments: The proxy->compress property is updated depending on the         *
- *           protocol flags sent by proxy.                                    *
- *                                                                            *
  ******************************************************************************/
-static int	get_data_from_proxy(DC_PROXY *proxy, const char *request, char **data, zbx_timespec_t *ts)
+static int	proxy_session_send_request(zbx_proxy_session_t *session, zbx_proxy_conn_t *conn, const char *request)
 {
-	zbx_socket_t	s;
 	struct zbx_json	j;
 	int		ret;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() request:'%s'", __func__, request);
-
 	zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
 
 	zbx_json_addstring(&j, "request", request, ZBX_JSON_TYPE_STRING);
 
-	if (SUCCEED == (ret = connect_to_proxy(proxy, &s, CONFIG_TRAPPER_TIMEOUT)))
-	{
-		/* get connection timestamp if required */
-		if (NULL != ts)
-			zbx_timespec(ts);
-
-		if (SUCCEED == (ret = send_data_to_proxy(proxy, &s, j.buffer, j.buffer_size)))
-		{
-			if (SUCCEED == (ret = recv_data_from_proxy(proxy, &s)))
-			{
-				if (0 != (s.protocol & ZBX_TCP_COMPRESS))
-					proxy->auto_compress = 1;
+	if (SUCCEED == (ret = proxy_conn_open(&session->proxy, conn, j.buffer, j.buffer_size)))
+		session->request = request;
 
-				if (!ZBX_IS_RUNNING())
-				{
-					int	flags = ZBX_TCP_PROTOCOL;
-
-					if (0 != (s.protocol & ZBX_TCP_COMPRESS))
-						flags |= ZBX_TCP_COMPRESS;
-
-					zbx_send_response_ext(&s, FAIL, "Zabbix server shutdown in progress", NULL,
-							flags, CONFIG_TIMEOUT);
+	zbx_json_free(&j);
 
-					zabbix_log(LOG_LEVEL_WARNING, "cannot process proxy data from passive proxy at"
-							" \"%s\": Zabbix server shutdown in progress", s.peer);
-					ret = FAIL;
-				}
-				else
-				{
-					ret = zbx_send_proxy_data_response(proxy, &s, NULL);
+	return ret;
+}
 
-					if (SUCCEED == ret)
-						*data = zbx_strdup(*data, s.buffer);
-				}
-			}
-		}
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_update_revisions                                           *
+ *                                                                            *
+ * Purpose: remember revisions of the configuration applied by proxy          *
+ *                                                                            *
+ * Parameters: hostid - [IN] the proxy identifier                             *
+ *             jp     - [IN] the configuration update response                *
+ *                                                                            *
+ * Comments: Proxies not reporting revisions will receive full configuration. *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_update_revisions(zbx_uint64_t hostid, const struct zbx_json_parse *jp)
+{
+	struct zbx_json_parse	jp_revisions;
+	zbx_proxy_revisions_t	*revisions, revisions_local;
+	size_t			len;
 
-		disconnect_proxy(&s);
+	if (NULL != (revisions = (zbx_proxy_revisions_t *)zbx_hashset_search(&proxy_revisions, &hostid)))
+	{
+		zbx_free(revisions->revisions);
+		zbx_hashset_remove_direct(&proxy_revisions, revisions);
 	}
 
-	zbx_json_free(&j);
+	if (SUCCEED != zbx_json_brackets_by_name(jp, ZBX_PROTO_TAG_REVISIONS, &jp_revisions))
+		return;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+	len = (size_t)(jp_revisions.end - jp_revisions.start + 1);
 
-	return ret;
+	revisions_local.hostid = hostid;
+	revisions_local.revisions = (char *)zbx_malloc(NULL, len + 1);
+	memcpy(revisions_local.revisions, jp_revisions.start, len);
+	revisions_local.revisions[len] = '\0';
+
+	zbx_hashset_insert(&proxy_revisions, &revisions_local, sizeof(revisions_local));
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: proxy_send_configuration                                         *
+ * Function: proxy_session_send_configuration                                 *
  *                                                                            *
- * Purpose: sends configuration data to proxy                                 *
+ * Purpose: collect configuration data and start sending it to proxy          *
  *                                                                            *
- * Parameters: proxy - [IN/OUT] proxy data                                    *
+ * Parameters: session - [IN/OUT] the proxy session                           *
  *                                                                            *
- * Return value: SUCCEED - processed successfully                             *
+ * Return value: SUCCEED - the configuration data is being sent               *
  *               other code - an error occurred                               *
  *                                                                            *
- * Comments: This function updates proxy version, compress and lastaccess     *
- *           properties.                                                      *
+ * Comments: Configuration data is collected from database synchronously.     *
  *                                                                            *
  ******************************************************************************/
-static int	proxy_send_configuration(DC_PROXY *proxy)
+static int	proxy_session_send_configuration(zbx_proxy_session_t *session)
 {
-	char		*error = NULL;
-	int		ret;
-	zbx_socket_t	s;
-	struct zbx_json	j;
+	DC_PROXY		*proxy = &session->proxy;
+	char			*error = NULL;
+	int			ret;
+	struct zbx_json		j;
+	struct zbx_json_parse	jp_revisions, *pjp_revisions = NULL;
+	zbx_proxy_revisions_t	*revisions;
 
 	zbx_json_init(&j, 512 * ZBX_KIBIBYTE);
 
 	zbx_json_addstring(&j, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_PROXY_CONFIG, ZBX_JSON_TYPE_STRING);
 	zbx_json_addobject(&j, ZBX_PROTO_TAG_DATA);
 
-	if (SUCCEED != (ret = get_proxyconfig_data(proxy->hostid, &j, &error)))
+	if (NULL != (revisions = (zbx_proxy_revisions_t *)zbx_hashset_search(&proxy_revisions, &proxy->hostid)) &&
+			SUCCEED == zbx_json_open(revisions->revisions, &jp_revisions))
+	{
+		pjp_revisions = &jp_revisions;
+	}
+
+	if (SUCCEED != (ret = get_proxyconfig_data(proxy->hostid, &j, pjp_revisions, &error)))
 	{
 		zabbix_log(LOG_LEVEL_ERR, "cannot collect configuration data for proxy \"%s\": %s",
 				proxy->host, error);
 		goto out;
 	}
 
-	if (SUCCEED != (ret = connect_to_proxy(proxy, &s, CONFIG_TRAPPER_TIMEOUT)))
+	if (SUCCEED != (ret = proxy_conn_open(proxy, &session->conns[session->cur], j.buffer, j.buffer_size)))
 		goto out;
 
+	session->request = ZBX_PROTO_VALUE_PROXY_CONFIG;
+
 	zabbix_log(LOG_LEVEL_WARNING, "sending configuration data to proxy \"%s\" at \"%s\", datalen " ZBX_FS_SIZE_T,
-			proxy->host, s.peer, (zbx_fs_size_t)j.buffer_size);
+			proxy->host, session->conns[session->cur].s.peer, (zbx_fs_size_t)j.buffer_size);
+out:
+	zbx_free(error);
+	zbx_json_free(&j);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_session_finish                                             *
+ *                                                                            *
+ * Purpose: updates proxy properties and returns proxy to the poller queue    *
+ *                                                                            *
+ * Parameters: session - [IN/OUT] the finished proxy session                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_session_finish(zbx_proxy_session_t *session)
+{
+	const DC_PROXY	*proxy = &session->proxy, *proxy_old = &session->proxy_old;
+
+	if (proxy_old->version != proxy->version || proxy_old->auto_compress != proxy->auto_compress ||
+			proxy_old->lastaccess != proxy->lastaccess)
+	{
+		zbx_update_proxy_data((DC_PROXY *)proxy_old, proxy->version, proxy->lastaccess, proxy->auto_compress);
+	}
+
+	DCrequeue_proxy(proxy->hostid, session->update_nextcheck, session->ret);
+
+	session->done = 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_session_next                                               *
+ *                                                                            *
+ * Purpose: start the next pending request or finish the session if there     *
+ *          are none                                                          *
+ *                                                                            *
+ * Parameters: session - [IN/OUT] the proxy session without open connections  *
+ *                                                                            *
+ * Comments: Configuration is sent first, then either proxy data or proxy     *
+ *           tasks are requested.                                             *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_session_next(zbx_proxy_session_t *session)
+{
+	unsigned char	pending = session->pending;
 
-	if (SUCCEED == (ret = send_data_to_proxy(proxy, &s, j.buffer, j.buffer_size)))
+	session->pending = 0;
+
+	if (0 != (pending & ZBX_PROXY_CONFIG_NEXTCHECK))
 	{
-		if (SUCCEED != (ret = zbx_recv_response(&s, 0, &error)))
+		if (SUCCEED == (session->ret = proxy_session_send_configuration(session)))
 		{
-			zabbix_log(LOG_LEVEL_WARNING, "cannot send configuration data to proxy"
-					" \"%s\" at \"%s\": %s", proxy->host, s.peer, error);
+			session->pending = pending & ~ZBX_PROXY_CONFIG_NEXTCHECK;
+			return;
 		}
-		else
+	}
+	else if (0 != (pending & ZBX_PROXY_DATA_NEXTCHECK))
+	{
+		if (SUCCEED == (session->ret = proxy_session_send_request(session, &session->conns[session->cur],
+				ZBX_PROTO_VALUE_PROXY_DATA)))
 		{
-			struct zbx_json_parse	jp;
-
-			if (SUCCEED != zbx_json_open(s.buffer, &jp))
-			{
-				zabbix_log(LOG_LEVEL_WARNING, "invalid configuration data response received from proxy"
-						" \"%s\" at \"%s\": %s", proxy->host, s.peer, zbx_json_strerror());
-			}
-			else
-			{
-				proxy->version = zbx_get_proxy_protocol_version(&jp);
-				proxy->auto_compress = (0 != (s.protocol & ZBX_TCP_COMPRESS) ? 1 : 0);
-				proxy->lastaccess = time(NULL);
-			}
+			return;
+		}
+	}
+	else if (0 != (pending & ZBX_PROXY_TASKS_NEXTCHECK))
+	{
+		if (ZBX_COMPONENT_VERSION(3, 2) >= session->proxy.version)
+			session->ret = FAIL;
+		else if (SUCCEED == (session->ret = proxy_session_send_request(session,
+				&session->conns[session->cur], ZBX_PROTO_VALUE_PROXY_TASKS)))
+		{
+			return;
 		}
 	}
 
-	disconnect_proxy(&s);
-out:
-	zbx_free(error);
-	zbx_json_free(&j);
+	proxy_session_finish(session);
+}
 
-	return ret;
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_session_check_idle                                         *
+ *                                                                            *
+ * Purpose: continue with the next request when all session connections are   *
+ *          closed                                                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_session_check_idle(zbx_proxy_session_t *session)
+{
+	if (ZBX_PROXY_CONN_IDLE != session->conns[0].state || ZBX_PROXY_CONN_IDLE != session->conns[1].state)
+		return;
+
+	/* stop after failed request */
+	if (SUCCEED != session->ret)
+		session->pending = 0;
+
+	proxy_session_next(session);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_session_recv_configuration                                 *
+ *                                                                            *
+ * Purpose: process proxy response to configuration data                      *
+ *                                                                            *
+ * Parameters: session - [IN/OUT] the proxy session                           *
+ *             conn    - [IN] the connection with received response           *
+ *                                                                            *
+ * Comments: This function updates proxy version, compress and lastaccess     *
+ *           properties.                                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_session_recv_configuration(zbx_proxy_session_t *session, zbx_proxy_conn_t *conn)
+{
+	DC_PROXY		*proxy = &session->proxy;
+	char			*error = NULL;
+	struct zbx_json_parse	jp;
+
+	if (SUCCEED != (session->ret = zbx_check_response(conn->s.buffer, &error)))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot send configuration data to proxy"
+				" \"%s\" at \"%s\": %s", proxy->host, conn->s.peer, error);
+		zbx_free(error);
+	}
+	else if (SUCCEED != zbx_json_open(conn->s.buffer, &jp))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "invalid configuration data response received from proxy"
+				" \"%s\" at \"%s\": %s", proxy->host, conn->s.peer, zbx_json_strerror());
+	}
+	else
+	{
+		proxy->version = zbx_get_proxy_protocol_version(&jp);
+		proxy->auto_compress = (0 != (conn->s.protocol & ZBX_TCP_COMPRESS) ? 1 : 0);
+		proxy->lastaccess = time(NULL);
+
+		proxy_update_revisions(proxy->hostid, &jp);
+	}
+
+	proxy_conn_close(conn);
 }
 
 /******************************************************************************
@@ -295,7 +605,7 @@ out:
  *             answer - [IN] data received from proxy                         *
  *             ts     - [IN] timestamp when the proxy connection was          *
  *                           established                                      *
- *             more   - [OUT] available data flag                             *
+ *             error  - [OUT] the error message                               *
  *                                                                            *
  * Return value: SUCCEED - data were received and processed successfully      *
  *               FAIL - otherwise                                             *
@@ -304,27 +614,18 @@ out:
  *           sent by proxy.                                                   *
  *                                                                            *
  ******************************************************************************/
-static int	proxy_process_proxy_data(DC_PROXY *proxy, const char *answer, zbx_timespec_t *ts, int *more)
+static int	proxy_process_proxy_data(DC_PROXY *proxy, const char *answer, zbx_timespec_t *ts, char **error)
 {
 	struct zbx_json_parse	jp;
-	char			*error = NULL;
 	int			ret = FAIL;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
-	*more = ZBX_PROXY_DATA_DONE;
-
-	if ('\0' == *answer)
-	{
-		zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned no proxy data:"
-				" check allowed connection types and access rights", proxy->host, proxy->addr);
-		goto out;
-	}
-
 	if (SUCCEED != zbx_json_open(answer, &jp))
 	{
+		*error = zbx_strdup(*error, zbx_json_strerror());
 		zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid proxy data: %s",
-				proxy->host, proxy->addr, zbx_json_strerror());
+				proxy->host, proxy->addr, *error);
 		goto out;
 	}
 
@@ -332,24 +633,16 @@ static int	proxy_process_proxy_data(DC_PROXY *proxy, const char *answer, zbx_tim
 
 	if (SUCCEED != zbx_check_protocol_version(proxy))
 	{
+		*error = zbx_strdup(*error, "protocol version not supported");
 		goto out;
 	}
 
-	if (SUCCEED != (ret = process_proxy_data(proxy, &jp, ts, &error)))
+	if (SUCCEED != (ret = process_proxy_data(proxy, &jp, ts, error)))
 	{
 		zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid proxy data: %s",
-				proxy->host, proxy->addr, error);
-	}
-	else
-	{
-		char	value[MAX_STRING_LEN];
-
-		if (SUCCEED == zbx_json_value_by_name(&jp, ZBX_PROTO_TAG_MORE, value, sizeof(value), NULL))
-			*more = atoi(value);
+				proxy->host, proxy->addr, *error);
 	}
 out:
-	zbx_free(error);
-
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
 	return ret;
@@ -357,189 +650,481 @@ out:
 
 /******************************************************************************
  *                                                                            *
- * Function: proxy_get_data                                                   *
+ * Function: proxy_data_has_more                                              *
+ *                                                                            *
+ * Purpose: check if proxy has more data than sent in the received batch      *
+ *                                                                            *
+ ******************************************************************************/
+static int	proxy_data_has_more(const char *answer)
+{
+	struct zbx_json_parse	jp;
+	char			value[MAX_STRING_LEN];
+
+	if (SUCCEED != zbx_json_open(answer, &jp) ||
+			SUCCEED != zbx_json_value_by_name(&jp, ZBX_PROTO_TAG_MORE, value, sizeof(value), NULL))
+	{
+		return FAIL;
+	}
+
+	return ZBX_PROXY_DATA_MORE == atoi(value) ? SUCCEED : FAIL;
+}
+
+/******************************************************************************
  *                                                                            *
- * Purpose: gets data from proxy ('proxy data' request)                       *
+ * Function: proxy_session_process_data                                       *
  *                                                                            *
- * Parameters: proxy  - [IN] proxy data                                       *
- *             more   - [OUT] available data flag                             *
+ * Purpose: processes data received from proxy ('proxy data' or 'proxy tasks' *
+ *          request) and starts sending acknowledgement                       *
  *                                                                            *
- * Return value: SUCCEED - data were received and processed successfully      *
- *               other code - an error occurred                               *
+ * Parameters: session - [IN/OUT] the proxy session                           *
+ *             conn    - [IN/OUT] the connection with received data           *
  *                                                                            *
- * Comments: This function updates proxy version, compress and lastaccess     *
+ * Comments: When proxy has more data the next batch is requested over        *
+ *           another connection before processing the received one. Proxy     *
+ *           holds the next batch until the current one is acknowledged, so   *
+ *           the acknowledgement is sent only after the data is processed and *
+ *           failed processing is reported to proxy to send the data again.   *
+ *           Proxy waits for the acknowledgement for its Timeout seconds, a   *
+ *           batch processed slower than that will be sent again.             *
+ *           This function updates proxy version, compress and lastaccess     *
  *           properties.                                                      *
  *                                                                            *
  ******************************************************************************/
-static int	proxy_get_data(DC_PROXY *proxy, int *more)
+static void	proxy_session_process_data(zbx_proxy_session_t *session, zbx_proxy_conn_t *conn)
 {
-	char		*answer = NULL;
-	int		ret;
-	zbx_timespec_t	ts;
+	DC_PROXY		*proxy = &session->proxy;
+	zbx_proxy_conn_t	*next = &session->conns[session->cur ^ 1];
+	const char		*answer = conn->s.buffer;
+	char			*error = NULL;
+	struct zbx_json		j;
+	int			ret, data_request, flags = ZBX_TCP_PROTOCOL;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() proxy:'%s' request:'%s'", __func__, proxy->host, session->request);
 
-	if (SUCCEED != (ret = get_data_from_proxy(proxy, ZBX_PROTO_VALUE_PROXY_DATA, &answer, &ts)))
-		goto out;
+	data_request = (0 == strcmp(session->request, ZBX_PROTO_VALUE_PROXY_DATA));
 
-	/* handle pre 3.4 proxies that did not support proxy data request */
 	if ('\0' == *answer)
 	{
-		proxy->version = ZBX_COMPONENT_VERSION(3, 2);
-		zbx_free(answer);
-		ret = FAIL;
+		/* handle pre 3.4 proxies that did not support proxy data request */
+		if (0 != data_request)
+		{
+			proxy->version = ZBX_COMPONENT_VERSION(3, 2);
+		}
+		else
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned no proxy data:"
+					" check allowed connection types and access rights", proxy->host, proxy->addr);
+		}
+
+		session->ret = ret = FAIL;
+		proxy_conn_close(conn);
 		goto out;
 	}
 
+	if (0 != (conn->s.protocol & ZBX_TCP_COMPRESS))
+		proxy->auto_compress = 1;
+
 	proxy->lastaccess = time(NULL);
-	ret = proxy_process_proxy_data(proxy, answer, &ts, more);
-	zbx_free(answer);
-out:
-	if (SUCCEED == ret)
-		zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s more:%d", __func__, zbx_result_string(ret), *more);
+
+	if (!ZBX_IS_RUNNING())
+	{
+		error = zbx_strdup(error, "Zabbix server shutdown in progress");
+		zabbix_log(LOG_LEVEL_WARNING, "cannot process proxy data from passive proxy at \"%s\": %s",
+				conn->s.peer, error);
+		ret = FAIL;
+	}
 	else
-		zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+	{
+		if (0 != data_request && ZBX_PROXY_CONN_IDLE == next->state && SUCCEED == proxy_data_has_more(answer))
+		{
+			int	ret_next;
 
-	return ret;
+			if (SUCCEED != (ret_next = proxy_session_send_request(session, next, ZBX_PROTO_VALUE_PROXY_DATA)))
+				session->ret = ret_next;
+		}
+
+		ret = proxy_process_proxy_data(proxy, answer, &conn->ts, &error);
+	}
+
+	if (SUCCEED != ret)
+	{
+		/* without acknowledgement proxy sends the same data again */
+		session->ret = ret;
+		proxy_conn_close(next);
+	}
+
+	if (0 != proxy->auto_compress)
+		flags |= ZBX_TCP_COMPRESS;
+
+	zbx_vector_ptr_create(&conn->tasks);
+	zbx_proxy_data_response_prepare(proxy, ret, error, &j, &conn->tasks);
+
+	if (SUCCEED != zbx_tcp_send_context_init(&conn->send, j.buffer, strlen(j.buffer), flags))
+	{
+		zabbix_log(LOG_LEVEL_ERR, "cannot send data to proxy \"%s\": %s", proxy->host, zbx_socket_strerror());
+		zbx_vector_ptr_clear_ext(&conn->tasks, (zbx_clean_func_t)zbx_tm_task_free);
+		zbx_vector_ptr_destroy(&conn->tasks);
+		session->ret = NETWORK_ERROR;
+		proxy_conn_close(conn);
+		proxy_conn_close(next);
+	}
+	else
+	{
+		conn->state = ZBX_PROXY_CONN_ACK;
+		conn->wait = ZBX_TCP_WAIT_WRITE;
+		conn->deadline = time(NULL) + CONFIG_TRAPPER_TIMEOUT;
+	}
+
+	zbx_json_free(&j);
+	zbx_free(error);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: proxy_get_tasks                                                  *
+ * Function: proxy_session_process                                            *
+ *                                                                            *
+ * Purpose: process response to the oldest session request if it is received  *
  *                                                                            *
- * Purpose: gets data from proxy ('proxy data' request)                       *
+ ******************************************************************************/
+static void	proxy_session_process(zbx_proxy_session_t *session)
+{
+	zbx_proxy_conn_t	*conn = &session->conns[session->cur];
+
+	if (ZBX_PROXY_CONN_READY != conn->state)
+		return;
+
+	if (0 == strcmp(session->request, ZBX_PROTO_VALUE_PROXY_CONFIG))
+		proxy_session_recv_configuration(session, conn);
+	else
+		proxy_session_process_data(session, conn);
+
+	proxy_session_check_idle(session);
+}
+
+/******************************************************************************
  *                                                                            *
- * Parameters: proxy - [IN/OUT] the proxy data                                *
+ * Function: proxy_session_start                                              *
  *                                                                            *
- * Return value: SUCCEED - data were received and processed successfully      *
- *               other code - an error occurred                               *
+ * Purpose: starts sending configuration to proxy or requesting data or tasks *
+ *          if required                                                       *
  *                                                                            *
- * Comments: This function updates proxy version, compress and lastaccess     *
- *           properties.                                                      *
+ * Parameters: session - [IN/OUT] the proxy session                           *
+ *             now     - [IN] the current time                                *
  *                                                                            *
  ******************************************************************************/
-static int	proxy_get_tasks(DC_PROXY *proxy)
+static void	proxy_session_start(zbx_proxy_session_t *session, time_t now)
 {
-	char		*answer = NULL;
-	int		ret = FAIL, more;
-	zbx_timespec_t	ts;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
-
-	if (ZBX_COMPONENT_VERSION(3, 2) >= proxy->version)
+	DC_PROXY	*proxy = &session->proxy;
+	char		*port = NULL;
+
+	memcpy(&session->proxy_old, proxy, sizeof(DC_PROXY));
+
+	session->conns[0].state = ZBX_PROXY_CONN_IDLE;
+	session->conns[1].state = ZBX_PROXY_CONN_IDLE;
+	session->cur = 0;
+	session->ret = FAIL;
+	session->update_nextcheck = 0;
+	session->pending = 0;
+	session->done = 0;
+
+	if (proxy->proxy_config_nextcheck <= now)
+		session->update_nextcheck |= ZBX_PROXY_CONFIG_NEXTCHECK;
+	if (proxy->proxy_data_nextcheck <= now)
+		session->update_nextcheck |= ZBX_PROXY_DATA_NEXTCHECK;
+	if (proxy->proxy_tasks_nextcheck <= now)
+		session->update_nextcheck |= ZBX_PROXY_TASKS_NEXTCHECK;
+
+	/* Check if passive proxy has been misconfigured on the server side. If it has happened more */
+	/* recently than last synchronisation of cache then there is no point to retry connecting to */
+	/* proxy again. The next reconnection attempt will happen after cache synchronisation. */
+	if (proxy->last_cfg_error_time >= DCconfig_get_last_sync_time())
 		goto out;
 
-	if (SUCCEED != (ret = get_data_from_proxy(proxy, ZBX_PROTO_VALUE_PROXY_TASKS, &answer, &ts)))
+	proxy->addr = proxy->addr_orig;
+
+	port = zbx_strdup(port, proxy->port_orig);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+			&port, MACRO_TYPE_COMMON, NULL, 0);
+	if (FAIL == is_ushort(port, &proxy->port))
+	{
+		zabbix_log(LOG_LEVEL_ERR, "invalid proxy \"%s\" port: \"%s\"", proxy->host, port);
+		session->ret = CONFIG_ERROR;
+		zbx_free(port);
 		goto out;
+	}
+	zbx_free(port);
 
-	proxy->lastaccess = time(NULL);
+	session->pending = session->update_nextcheck;
+out:
+	proxy_session_next(session);
+}
 
-	ret = proxy_process_proxy_data(proxy, answer, &ts, &more);
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_session_conn_failed                                        *
+ *                                                                            *
+ * Purpose: handle failed (already closed) session connection                 *
+ *                                                                            *
+ * Parameters: session - [IN/OUT] the proxy session                           *
+ *             index   - [IN] the failed connection index                     *
+ *             ret     - [IN] the error code                                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_session_conn_failed(zbx_proxy_session_t *session, int index, int ret)
+{
+	session->ret = ret;
 
-	zbx_free(answer);
-out:
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+	/* without acknowledgement of the current batch proxy would send the same data to the pipelined request */
+	if (index == session->cur)
+		proxy_conn_close(&session->conns[index ^ 1]);
 
-	return ret;
+	proxy_session_check_idle(session);
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: process_proxy                                                    *
+ * Function: proxy_session_update                                             *
+ *                                                                            *
+ * Purpose: continue the network operation of session connection after its    *
+ *          socket became ready                                               *
  *                                                                            *
- * Purpose: retrieve values of metrics from monitored hosts                   *
+ * Parameters: session - [IN/OUT] the proxy session                           *
+ *             index   - [IN] the connection index                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_session_update(zbx_proxy_session_t *session, int index)
+{
+	zbx_proxy_conn_t	*conn = &session->conns[index], *next;
+	unsigned char		state = conn->state;
+	int			ret;
+
+	if (SUCCEED != (ret = proxy_conn_step(&session->proxy, conn)))
+	{
+		proxy_session_conn_failed(session, index, ret);
+		return;
+	}
+
+	if (ZBX_PROXY_CONN_ACK != state || ZBX_PROXY_CONN_IDLE != conn->state)
+		return;
+
+	/* the acknowledgement is sent, switch to the pipelined request if there is one */
+	next = &session->conns[index ^ 1];
+
+	if (ZBX_PROXY_CONN_IDLE != next->state)
+	{
+		session->cur = index ^ 1;
+
+		/* proxy starts preparing the next batch only after the current one is acknowledged */
+		if (ZBX_PROXY_CONN_RECV == next->state)
+			next->deadline = time(NULL) + CONFIG_TRAPPER_TIMEOUT;
+	}
+
+	proxy_session_check_idle(session);
+}
+
+/******************************************************************************
  *                                                                            *
- * Parameters:                                                                *
+ * Function: proxy_sessions_wait                                              *
  *                                                                            *
- * Return value:                                                              *
+ * Purpose: performs network operations of proxy sessions as the sockets      *
+ *          become ready and processes the received data                      *
  *                                                                            *
- * Author: Alexei Vladishev                                                   *
+ * Parameters: sessions - [IN/OUT] the proxy sessions                         *
+ *             num      - [IN] the number of sessions                         *
  *                                                                            *
- * Comments:                                                                  *
+ * Comments: Connecting (except name resolution), TLS handshakes, sending and *
+ *           receiving do not block the poller. Collecting configuration and  *
+ *           processing of the received data is done synchronously, one batch *
+ *           per session between the waits, while proxies prepare the next    *
+ *           data batches.                                                    *
  *                                                                            *
  ******************************************************************************/
-static int	process_proxy(void)
+static void	proxy_sessions_wait(zbx_proxy_session_t *sessions, int num)
 {
-	DC_PROXY	proxy, proxy_old;
-	int		num, i;
-	time_t		now;
+	zbx_proxy_session_t	*session;
+	zbx_proxy_conn_t	*conn;
+	fd_set			rfds, wfds;
+	struct timeval		tv;
+	ZBX_SOCKET		max_fd;
+	time_t			now, timeout;
+	int			i, j, active, ready;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() sessions:%d", __func__, num);
 
-	if (0 == (num = DCconfig_get_proxypoller_hosts(&proxy, 1)))
-		goto exit;
+	while (1)
+	{
+		now = time(NULL);
 
-	now = time(NULL);
+		for (i = 0; i < num; i++)
+		{
+			session = &sessions[i];
 
-	for (i = 0; i < num; i++)
-	{
-		int		ret = FAIL;
-		unsigned char	update_nextcheck = 0;
+			for (j = 0; j < 2 && 0 == session->done; j++)
+			{
+				conn = &session->conns[j];
 
-		memcpy(&proxy_old, &proxy, sizeof(DC_PROXY));
+				if (ZBX_PROXY_CONN_IDLE == conn->state || ZBX_PROXY_CONN_READY == conn->state)
+					continue;
 
-		if (proxy.proxy_config_nextcheck <= now)
-			update_nextcheck |= ZBX_PROXY_CONFIG_NEXTCHECK;
-		if (proxy.proxy_data_nextcheck <= now)
-			update_nextcheck |= ZBX_PROXY_DATA_NEXTCHECK;
-		if (proxy.proxy_tasks_nextcheck <= now)
-			update_nextcheck |= ZBX_PROXY_TASKS_NEXTCHECK;
+				/* pipelined request waits for the current batch to be acknowledged */
+				if (ZBX_PROXY_CONN_RECV == conn->state && j != session->cur)
+					continue;
 
-		/* Check if passive proxy has been misconfigured on the server side. If it has happened more */
-		/* recently than last synchronisation of cache then there is no point to retry connecting to */
-		/* proxy again. The next reconnection attempt will happen after cache synchronisation. */
-		if (proxy.last_cfg_error_time < DCconfig_get_last_sync_time())
+				if (conn->deadline > now)
+					continue;
+
+				proxy_conn_timeout(&session->proxy, conn);
+				proxy_session_conn_failed(session, j, NETWORK_ERROR);
+			}
+		}
+
+		FD_ZERO(&rfds);
+		FD_ZERO(&wfds);
+		max_fd = 0;
+		active = 0;
+		ready = 0;
+		timeout = CONFIG_TRAPPER_TIMEOUT;
+
+		for (i = 0; i < num; i++)
 		{
-			char	*port = NULL;
+			session = &sessions[i];
 
-			proxy.addr = proxy.addr_orig;
+			if (0 != session->done)
+				continue;
 
-			port = zbx_strdup(port, proxy.port_orig);
-			substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-					&port, MACRO_TYPE_COMMON, NULL, 0);
-			if (FAIL == is_ushort(port, &proxy.port))
+			for (j = 0; j < 2; j++)
 			{
-				zabbix_log(LOG_LEVEL_ERR, "invalid proxy \"%s\" port: \"%s\"", proxy.host, port);
-				ret = CONFIG_ERROR;
-				zbx_free(port);
-				goto error;
+				conn = &session->conns[j];
+
+				if (ZBX_PROXY_CONN_IDLE == conn->state)
+					continue;
+
+				active++;
+
+				if (ZBX_PROXY_CONN_READY == conn->state)
+				{
+					if (j == session->cur)
+						ready++;
+					continue;
+				}
+
+				if (0 != (conn->wait & ZBX_TCP_WAIT_READ))
+					FD_SET(conn->s.socket, &rfds);
+
+				if (0 != (conn->wait & ZBX_TCP_WAIT_WRITE))
+					FD_SET(conn->s.socket, &wfds);
+
+				conn->polled = 1;
+
+				if (max_fd < conn->s.socket)
+					max_fd = conn->s.socket;
+
+				if ((ZBX_PROXY_CONN_RECV != conn->state || j == session->cur) &&
+						timeout > conn->deadline - now)
+				{
+					timeout = conn->deadline - now;
+				}
 			}
-			zbx_free(port);
+		}
+
+		if (0 == active)
+			break;
+
+		/* do not wait if there is data to process */
+		tv.tv_sec = (0 == ready ? timeout : 0);
+		tv.tv_usec = 0;
+
+		if (-1 == select(max_fd + 1, &rfds, &wfds, NULL, &tv))
+		{
+			if (EINTR == errno)
+				continue;
+
+			zabbix_log(LOG_LEVEL_ERR, "cannot wait for data from proxies: %s", zbx_strerror(errno));
 
-			if (proxy.proxy_config_nextcheck <= now)
+			for (i = 0; i < num; i++)
 			{
-				if (SUCCEED != (ret = proxy_send_configuration(&proxy)))
-					goto error;
+				session = &sessions[i];
+
+				if (0 != session->done)
+					continue;
+
+				proxy_conn_close(&session->conns[0]);
+				proxy_conn_close(&session->conns[1]);
+				session->ret = NETWORK_ERROR;
+				proxy_session_check_idle(session);
 			}
+			break;
+		}
 
-			if (proxy.proxy_data_nextcheck <= now)
+		for (i = 0; i < num; i++)
+		{
+			session = &sessions[i];
+
+			for (j = 0; j < 2 && 0 == session->done; j++)
 			{
-				int	more;
+				conn = &session->conns[j];
+
+				/* skip connections opened after select() even if they reuse socket of closed one */
+				if (0 == conn->polled)
+					continue;
+
+				conn->polled = 0;
 
-				do
+				if ((0 != (conn->wait & ZBX_TCP_WAIT_READ) && FD_ISSET(conn->s.socket, &rfds)) ||
+						(0 != (conn->wait & ZBX_TCP_WAIT_WRITE) && FD_ISSET(conn->s.socket, &wfds)))
 				{
-					if (SUCCEED != (ret = proxy_get_data(&proxy, &more)))
-						goto error;
+					proxy_session_update(session, j);
 				}
-				while (ZBX_PROXY_DATA_MORE == more);
-			}
-			else if (proxy.proxy_tasks_nextcheck <= now)
-			{
-				if (SUCCEED != (ret = proxy_get_tasks(&proxy)))
-					goto error;
 			}
 		}
-error:
-		if (proxy_old.version != proxy.version || proxy_old.auto_compress != proxy.auto_compress ||
-				proxy_old.lastaccess != proxy.lastaccess)
+
+		for (i = 0; i < num; i++)
 		{
-			zbx_update_proxy_data(&proxy_old, proxy.version, proxy.lastaccess, proxy.auto_compress);
+			if (0 == sessions[i].done)
+				proxy_session_process(&sessions[i]);
 		}
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: process_proxy                                                    *
+ *                                                                            *
+ * Purpose: exchange configuration and data with passive proxies              *
+ *                                                                            *
+ * Return value: the number of processed proxies                              *
+ *                                                                            *
+ * Comments: All proxies due for a check are handled at once, slow proxies do *
+ *           not delay each other while connecting or preparing data.         *
+ *                                                                            *
+ ******************************************************************************/
+static int	process_proxy(void)
+{
+	static zbx_proxy_session_t	sessions[ZBX_PROXY_SESSIONS_MAX];
+	static DC_PROXY			proxies[ZBX_PROXY_SESSIONS_MAX];
+	int				num, i;
+	time_t				now;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
-		DCrequeue_proxy(proxy.hostid, update_nextcheck, ret);
+	if (0 == (num = DCconfig_get_proxypoller_hosts(proxies, ZBX_PROXY_SESSIONS_MAX)))
+		goto exit;
+
+	now = time(NULL);
+
+	for (i = 0; i < num; i++)
+	{
+		memcpy(&sessions[i].proxy, &proxies[i], sizeof(DC_PROXY));
+		proxy_session_start(&sessions[i], now);
 	}
+
+	proxy_sessions_wait(sessions, num);
 exit:
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%d", __func__, num);
 
 	return num;
 }
@@ -570,6 +1155,8 @@ ZBX_THREAD_ENTRY(proxypoller_thread, args)
 
 	DBconnect(ZBX_DB_CONNECT_NORMAL);
 
+	zbx_hashset_create(&proxy_revisions, 0, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
 	while (ZBX_IS_RUNNING())
 	{
 		sec = zbx_time();
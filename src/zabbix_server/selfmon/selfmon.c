@@ -21,10 +21,289 @@
 #include "daemon.h"
 #include "zbxself.h"
 #include "log.h"
+#include "comms.h"
+#include "../../libs/zbxserver/zabbix_metrics.h"
 #include "selfmon.h"
 
+#include <event.h>
+
+#define ZBX_METRICS_PATH		"/metrics"
+#define ZBX_METRICS_TIMEOUT		1	/* seconds to receive request and send response */
+#define ZBX_METRICS_REQUEST_LEN_MAX	4096
+
 extern unsigned char	process_type, program_type;
 extern int		server_num, process_num;
+extern char		*CONFIG_STATS_ALLOWED_IP;
+
+typedef struct
+{
+	zbx_socket_t	sock;
+	struct event	*event;
+	double		deadline;
+	size_t		request_len;
+	char		request[ZBX_METRICS_REQUEST_LEN_MAX + 1];
+}
+zbx_metrics_client_t;
+
+static struct event_base	*metrics_base = NULL;
+static struct event		metrics_events[ZBX_SOCKET_COUNT];
+
+/* metrics are collected once per self-monitoring cycle and served from this snapshot */
+static char	*metrics_data = NULL;
+static size_t	metrics_data_alloc = 0, metrics_data_offset = 0;
+
+/******************************************************************************
+ *                                                                            *
+ * Function: metrics_send_response                                            *
+ *                                                                            *
+ * Purpose: sends HTTP response to metrics client                             *
+ *                                                                            *
+ * Parameters: sock   - [IN] the client socket                                *
+ *             status - [IN] the HTTP status line                             *
+ *             type   - [IN] the response content type                        *
+ *             body   - [IN] the response body                                *
+ *                                                                            *
+ ******************************************************************************/
+static void	metrics_send_response(zbx_socket_t *sock, const char *status, const char *type, const char *body)
+{
+	char	*data = NULL;
+	size_t	data_alloc = 0, data_offset = 0;
+
+	zbx_snprintf_alloc(&data, &data_alloc, &data_offset, "HTTP/1.1 %s\r\n"
+			"Content-Type: %s\r\n"
+			"Content-Length: " ZBX_FS_SIZE_T "\r\n"
+			"Connection: close\r\n"
+			"\r\n%s", status, type, (zbx_fs_size_t)strlen(body), body);
+
+	if (SUCCEED != zbx_tcp_send_ext(sock, data, data_offset, 0, ZBX_METRICS_TIMEOUT))
+		zabbix_log(LOG_LEVEL_DEBUG, "cannot send metrics to \"%s\": %s", sock->peer, zbx_socket_strerror());
+
+	zbx_free(data);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: metrics_process_request                                          *
+ *                                                                            *
+ * Purpose: responds to received HTTP request with internal metrics snapshot  *
+ *                                                                            *
+ * Parameters: client - [IN] the metrics client                               *
+ *                                                                            *
+ ******************************************************************************/
+static void	metrics_process_request(zbx_metrics_client_t *client)
+{
+	char	*request = client->request, *path;
+	size_t	path_len = ZBX_CONST_STRLEN(ZBX_METRICS_PATH);
+
+	/* only the request line is used, headers are ignored */
+	request[strcspn(request, "\r\n")] = '\0';
+
+	if (0 != strncmp(request, "GET ", ZBX_CONST_STRLEN("GET ")))
+	{
+		metrics_send_response(&client->sock, "405 Method Not Allowed", "text/plain", "Method Not Allowed\n");
+		return;
+	}
+
+	path = request + ZBX_CONST_STRLEN("GET ");
+
+	if (0 != strncmp(path, ZBX_METRICS_PATH, path_len) || (' ' != path[path_len] && '?' != path[path_len]))
+	{
+		metrics_send_response(&client->sock, "404 Not Found", "text/plain", "Not Found\n");
+		return;
+	}
+
+	metrics_send_response(&client->sock, "200 OK", ZBX_METRICS_CONTENT_TYPE, metrics_data);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: metrics_client_free                                              *
+ *                                                                            *
+ * Purpose: closes metrics client connection and frees its resources          *
+ *                                                                            *
+ ******************************************************************************/
+static void	metrics_client_free(zbx_metrics_client_t *client)
+{
+	if (NULL != client->event)
+		event_free(client->event);
+
+	zbx_tcp_close(&client->sock);
+	zbx_free(client);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: metrics_client_cb                                                *
+ *                                                                            *
+ * Purpose: reads HTTP request from metrics client when data is available,    *
+ *          responds when the request headers are received                    *
+ *                                                                            *
+ * Comments: The socket is read only when it is readable, so a slow client    *
+ *           never blocks the self-monitoring process. Clients failing to     *
+ *           send the request within ZBX_METRICS_TIMEOUT are disconnected.    *
+ *                                                                            *
+ ******************************************************************************/
+static void	metrics_client_cb(int fd, short what, void *arg)
+{
+	zbx_metrics_client_t	*client = (zbx_metrics_client_t *)arg;
+	ssize_t			nbytes;
+	double			timeout;
+	struct timeval		tv;
+
+	update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+	if (0 != (what & EV_TIMEOUT))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "timeout while reading metrics request from \"%s\"", client->sock.peer);
+		goto out;
+	}
+
+	if (0 >= (nbytes = ZBX_TCP_READ(fd, client->request + client->request_len,
+			ZBX_METRICS_REQUEST_LEN_MAX - client->request_len)))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "cannot read metrics request from \"%s\": %s", client->sock.peer,
+				0 == nbytes ? "connection closed" : strerror_from_system(zbx_socket_last_error()));
+		goto out;
+	}
+
+	client->request_len += (size_t)nbytes;
+	client->request[client->request_len] = '\0';
+
+	if (NULL != strstr(client->request, "\r\n\r\n") || NULL != strstr(client->request, "\n\n"))
+	{
+		metrics_process_request(client);
+		goto out;
+	}
+
+	if (ZBX_METRICS_REQUEST_LEN_MAX == client->request_len)
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "metrics request from \"%s\" is too long", client->sock.peer);
+		goto out;
+	}
+
+	if (0 >= (timeout = client->deadline - zbx_time()))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "timeout while reading metrics request from \"%s\"", client->sock.peer);
+		goto out;
+	}
+
+	tv.tv_sec = (long)timeout;
+	tv.tv_usec = (long)((timeout - tv.tv_sec) * 1000000);
+	event_add(client->event, &tv);
+
+	update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+
+	return;
+out:
+	metrics_client_free(client);
+
+	update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: metrics_accept_cb                                                *
+ *                                                                            *
+ * Purpose: accepts incoming connection on metrics listener socket            *
+ *                                                                            *
+ * Comments: Connections from peers not listed in StatsAllowedIP are closed   *
+ *           right away without reading from them.                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	metrics_accept_cb(int fd, short what, void *arg)
+{
+	zbx_metrics_client_t	*client;
+	struct timeval		tv = {ZBX_METRICS_TIMEOUT, 0};
+
+	ZBX_UNUSED(what);
+	ZBX_UNUSED(arg);
+
+	update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+	client = (zbx_metrics_client_t *)zbx_malloc(NULL, sizeof(zbx_metrics_client_t));
+
+	if (SUCCEED != zbx_tcp_accept_nowait(fd, &client->sock))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot accept metrics connection: %s", zbx_socket_strerror());
+		zbx_free(client);
+		goto out;
+	}
+
+	if (NULL == CONFIG_STATS_ALLOWED_IP ||
+			SUCCEED != zbx_tcp_check_allowed_peers(&client->sock, CONFIG_STATS_ALLOWED_IP))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "failed to accept an incoming metrics connection: %s",
+				NULL == CONFIG_STATS_ALLOWED_IP ? "StatsAllowedIP not set" : zbx_socket_strerror());
+		zbx_tcp_close(&client->sock);
+		zbx_free(client);
+		goto out;
+	}
+
+	client->deadline = zbx_time() + ZBX_METRICS_TIMEOUT;
+	client->request_len = 0;
+	client->event = event_new(metrics_base, client->sock.socket, EV_READ, metrics_client_cb, client);
+	event_add(client->event, &tv);
+out:
+	update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: metrics_init                                                     *
+ *                                                                            *
+ * Purpose: registers metrics listener sockets in event base                  *
+ *                                                                            *
+ * Parameters: sock - [IN] the metrics listener socket                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	metrics_init(zbx_socket_t *sock)
+{
+	int	i;
+
+	metrics_base = event_base_new();
+
+	for (i = 0; i < sock->num_socks; i++)
+	{
+		event_set(&metrics_events[i], sock->sockets[i], EV_READ | EV_PERSIST, metrics_accept_cb, sock);
+		event_base_set(metrics_base, &metrics_events[i]);
+		event_add(&metrics_events[i], NULL);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: metrics_update                                                   *
+ *                                                                            *
+ * Purpose: collects internal metrics snapshot served to metrics clients      *
+ *                                                                            *
+ ******************************************************************************/
+static void	metrics_update(void)
+{
+	metrics_data_offset = 0;
+	zbx_get_zabbix_metrics(&metrics_data, &metrics_data_alloc, &metrics_data_offset);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: metrics_sleep_loop                                               *
+ *                                                                            *
+ * Purpose: serves metrics requests while sleeping between statistics         *
+ *          collection                                                        *
+ *                                                                            *
+ * Parameters: sleeptime - [IN] the sleep time in seconds                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	metrics_sleep_loop(int sleeptime)
+{
+	struct timeval	tv = {sleeptime, 0};
+
+	update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+
+	event_base_loopexit(metrics_base, &tv);
+	event_base_dispatch(metrics_base);
+
+	update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+}
 
 ZBX_THREAD_ENTRY(selfmon_thread, args)
 {
@@ -39,6 +318,9 @@ ZBX_THREAD_ENTRY(selfmon_thread, args)
 
 	update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
 
+	if (NULL != ((zbx_thread_args_t *)args)->args)
+		metrics_init((zbx_socket_t *)((zbx_thread_args_t *)args)->args);
+
 	while (ZBX_IS_RUNNING())
 	{
 		sec = zbx_time();
@@ -47,12 +329,19 @@ ZBX_THREAD_ENTRY(selfmon_thread, args)
 		zbx_setproctitle("%s [processing data]", get_process_type_string(process_type));
 
 		collect_selfmon_stats();
+
+		if (NULL != metrics_base)
+			metrics_update();
+
 		sec = zbx_time() - sec;
 
 		zbx_setproctitle("%s [processed data in " ZBX_FS_DBL " sec, idle 1 sec]",
 				get_process_type_string(process_type), sec);
 
-		zbx_sleep_loop(ZBX_SELFMON_DELAY);
+		if (NULL != metrics_base)
+			metrics_sleep_loop(ZBX_SELFMON_DELAY);
+		else
+			zbx_sleep_loop(ZBX_SELFMON_DELAY);
 	}
 
 	zbx_setproctitle("%s #%d [terminated]", get_process_type_string(process_type), process_num);
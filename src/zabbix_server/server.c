@@ -68,6 +68,7 @@
 #include "setproctitle.h"
 #include "zbxcrypto.h"
 #include "zbxipcservice.h"
+#include "zbxdiag.h"
 #include "zbxhistory.h"
 #include "postinit.h"
 #include "export.h"
@@ -105,6 +106,11 @@ const char	*help_message[] = {
 	"      " ZBX_LOG_LEVEL_DECREASE "=target  Decrease log level, affects all processes if",
 	"                                 target is not specified",
 	"      " ZBX_SNMP_CACHE_RELOAD "          Reload SNMP cache",
+	"      " ZBX_DIAGINFO "=section,N         Print diagnostic information, affects all",
+	"                                 sections if section is not specified",
+	"                                 (historycache, valuecache, preprocessing, lld,",
+	"                                 vmware),",
+	"                                 N - number of top items (default 25)",
 	"",
 	"      Log level control targets:",
 	"        process-type             All processes of specified type",
@@ -241,11 +247,16 @@ char	*CONFIG_SNMPTRAP_FILE		= NULL;
 
 char	*CONFIG_JAVA_GATEWAY		= NULL;
 int	CONFIG_JAVA_GATEWAY_PORT	= ZBX_DEFAULT_GATEWAY_PORT;
+int	CONFIG_JAVA_GATEWAY_MULTI_ENDPOINT	= 0;
 
 char	*CONFIG_SSH_KEY_LOCATION	= NULL;
 
 int	CONFIG_LOG_SLOW_QUERIES		= 0;	/* ms; 0 - disable */
 
+int	CONFIG_LOCK_STATISTICS		= 0;
+int	CONFIG_LATENCY_SAMPLE_RATE	= 0;	/* 0 - disable */
+int	CONFIG_METRICS_LISTEN_PORT	= 0;	/* 0 - disable */
+
 int	CONFIG_SERVER_STARTUP_TIME	= 0;	/* zabbix server startup time */
 
 int	CONFIG_PROXYPOLLER_FORKS	= 1;	/* parameters for passive proxies */
@@ -633,6 +644,8 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"JavaGatewayPort",		&CONFIG_JAVA_GATEWAY_PORT,		TYPE_INT,
 			PARM_OPT,	1024,			32767},
+		{"JavaGatewayMultiEndpoint",	&CONFIG_JAVA_GATEWAY_MULTI_ENDPOINT,	TYPE_INT,
+			PARM_OPT,	0,			1},
 		{"SNMPTrapperFile",		&CONFIG_SNMPTRAP_FILE,			TYPE_STRING,
 			PARM_OPT,	0,			0},
 		{"StartSNMPTrapper",		&CONFIG_SNMPTRAPPER_FORKS,		TYPE_INT,
@@ -707,6 +720,12 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"LogSlowQueries",		&CONFIG_LOG_SLOW_QUERIES,		TYPE_INT,
 			PARM_OPT,	0,			3600000},
+		{"LockStatistics",		&CONFIG_LOCK_STATISTICS,		TYPE_INT,
+			PARM_OPT,	0,			1},
+		{"LatencySampleRate",		&CONFIG_LATENCY_SAMPLE_RATE,		TYPE_INT,
+			PARM_OPT,	0,			1000000},
+		{"MetricsListenPort",		&CONFIG_METRICS_LISTEN_PORT,		TYPE_INT,
+			PARM_OPT,	0,			65535},
 		{"StartProxyPollers",		&CONFIG_PROXYPOLLER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			250},
 		{"ProxyConfigFrequency",	&CONFIG_PROXYCONFIG_FREQUENCY,		TYPE_INT,
@@ -882,7 +901,12 @@ int	main(int argc, char **argv)
 	zbx_load_config(&t);
 
 	if (ZBX_TASK_RUNTIME_CONTROL == t.task)
+	{
+		if (ZBX_RTC_DIAGINFO == ZBX_RTC_GET_MSG(t.data))
+			exit(SUCCEED == zbx_diaginfo_send(CONFIG_SOCKET_PATH, t.data) ? EXIT_SUCCESS : EXIT_FAILURE);
+
 		exit(SUCCEED == zbx_sigusr_send(t.data) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
 
 	zbx_initialize_events();
 
@@ -898,7 +922,7 @@ int	main(int argc, char **argv)
 
 int	MAIN_ZABBIX_ENTRY(int flags)
 {
-	zbx_socket_t	listen_sock;
+	zbx_socket_t	listen_sock, metrics_sock;
 	char		*error = NULL;
 	int		i, db_type;
 
@@ -915,6 +939,9 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 		exit(EXIT_FAILURE);
 	}
 
+	if (0 != CONFIG_LOCK_STATISTICS)
+		zbx_locks_enable_stats();
+
 	if (SUCCEED != zabbix_open_log(CONFIG_LOG_TYPE, CONFIG_LOG_LEVEL, CONFIG_LOG_FILE, &error))
 	{
 		zbx_error("cannot open log: %s", error);
@@ -1094,6 +1121,15 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 		}
 	}
 
+	if (0 != CONFIG_METRICS_LISTEN_PORT)
+	{
+		if (FAIL == zbx_tcp_listen(&metrics_sock, CONFIG_LISTEN_IP, (unsigned short)CONFIG_METRICS_LISTEN_PORT))
+		{
+			zabbix_log(LOG_LEVEL_CRIT, "metrics listener failed: %s", zbx_socket_strerror());
+			exit(EXIT_FAILURE);
+		}
+	}
+
 #if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
 	zbx_tls_init_parent();
 #endif
@@ -1187,6 +1223,7 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 				zbx_thread_start(proxypoller_thread, &thread_args, &threads[i]);
 				break;
 			case ZBX_PROCESS_TYPE_SELFMON:
+				thread_args.args = (0 != CONFIG_METRICS_LISTEN_PORT ? &metrics_sock : NULL);
 				zbx_thread_start(selfmon_thread, &thread_args, &threads[i]);
 				break;
 			case ZBX_PROCESS_TYPE_VMWARE:
@@ -1230,6 +1267,9 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 		zbx_problems_export_init("main-process", 0);
 	}
 
+	/* serve diagnostic information requests until terminated by signal handlers */
+	zbx_diag_serve();
+
 	while (-1 == wait(&i))	/* wait for any child to exit */
 	{
 		if (EINTR != errno)
@@ -37,10 +37,11 @@
  ******************************************************************************/
 void	send_proxyconfig(zbx_socket_t *sock, struct zbx_json_parse *jp)
 {
-	char		*error = NULL;
-	struct zbx_json	j;
-	DC_PROXY	proxy;
-	int		flags = ZBX_TCP_PROTOCOL;
+	char			*error = NULL;
+	struct zbx_json		j;
+	struct zbx_json_parse	jp_revisions, *pjp_revisions = NULL;
+	DC_PROXY		proxy;
+	int			flags = ZBX_TCP_PROTOCOL;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -64,9 +65,13 @@ void	send_proxyconfig(zbx_socket_t *sock, struct zbx_json_parse *jp)
 	if (0 != proxy.auto_compress)
 		flags |= ZBX_TCP_COMPRESS;
 
+	/* proxies report revisions of the applied configuration to receive only the changed data */
+	if (SUCCEED == zbx_json_brackets_by_name(jp, ZBX_PROTO_TAG_REVISIONS, &jp_revisions))
+		pjp_revisions = &jp_revisions;
+
 	zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
 
-	if (SUCCEED != get_proxyconfig_data(proxy.hostid, &j, &error))
+	if (SUCCEED != get_proxyconfig_data(proxy.hostid, &j, pjp_revisions, &error))
 	{
 		zbx_send_response_ext(sock, FAIL, error, NULL, flags, CONFIG_TIMEOUT);
 		zabbix_log(LOG_LEVEL_WARNING, "cannot collect configuration data for proxy \"%s\" at \"%s\": %s",
@@ -91,6 +96,41 @@ out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: send_proxyconfig_response                                        *
+ *                                                                            *
+ * Purpose: send configuration update response to server together with the    *
+ *          revisions of the applied configuration (for passive proxies)      *
+ *                                                                            *
+ ******************************************************************************/
+static void	send_proxyconfig_response(zbx_socket_t *sock)
+{
+	struct zbx_json	j;
+	char		*revisions;
+
+	zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
+
+	zbx_json_addstring(&j, ZBX_PROTO_TAG_RESPONSE, ZBX_PROTO_VALUE_SUCCESS, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(&j, ZBX_PROTO_TAG_VERSION, ZABBIX_VERSION, ZBX_JSON_TYPE_STRING);
+
+	if (NULL != (revisions = DCget_proxyconfig_revisions()))
+	{
+		zbx_json_addraw(&j, ZBX_PROTO_TAG_REVISIONS, revisions);
+		zbx_free(revisions);
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() '%s'", __func__, j.buffer);
+
+	if (SUCCEED != zbx_tcp_send_ext(sock, j.buffer, strlen(j.buffer), ZBX_TCP_PROTOCOL | ZBX_TCP_COMPRESS,
+			CONFIG_TIMEOUT))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "Error sending result back: %s", zbx_socket_strerror());
+	}
+
+	zbx_json_free(&j);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: recv_proxyconfig                                                 *
@@ -119,7 +159,7 @@ void	recv_proxyconfig(zbx_socket_t *sock, struct zbx_json_parse *jp)
 		goto out;
 
 	process_proxyconfig(&jp_data);
-	zbx_send_proxy_response(sock, ret, NULL, CONFIG_TIMEOUT);
+	send_proxyconfig_response(sock);
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
@@ -34,6 +34,44 @@ static zbx_mutex_t	proxy_lock = ZBX_MUTEX_NULL;
 #define	LOCK_PROXY_HISTORY	if (0 != (program_type & ZBX_PROGRAM_TYPE_PROXY_PASSIVE)) zbx_mutex_lock(proxy_lock)
 #define	UNLOCK_PROXY_HISTORY	if (0 != (program_type & ZBX_PROGRAM_TYPE_PROXY_PASSIVE)) zbx_mutex_unlock(proxy_lock)
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_proxy_data_response_prepare                                  *
+ *                                                                            *
+ * Purpose: prepare response to 'proxy data' or 'proxy tasks' request         *
+ *                                                                            *
+ * Parameters: proxy  - [IN] the proxy                                        *
+ *             status - [IN] SUCCEED - the data was processed successfully,   *
+ *                           FAIL - otherwise                                 *
+ *             info   - [IN] additional information (optional)                *
+ *             json   - [OUT] the response                                    *
+ *             tasks  - [OUT] the remote tasks included in the response       *
+ *                                                                            *
+ * Comments: Remote tasks are sent only with successful response, their       *
+ *           status must be updated with zbx_tm_update_task_status() after    *
+ *           the response is sent.                                            *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_proxy_data_response_prepare(const DC_PROXY *proxy, int status, const char *info, struct zbx_json *json,
+		zbx_vector_ptr_t *tasks)
+{
+	zbx_json_init(json, ZBX_JSON_STAT_BUF_LEN);
+
+	zbx_json_addstring(json, ZBX_PROTO_TAG_RESPONSE, SUCCEED == status ? ZBX_PROTO_VALUE_SUCCESS :
+			ZBX_PROTO_VALUE_FAILED, ZBX_JSON_TYPE_STRING);
+
+	if (NULL != info && '\0' != *info)
+		zbx_json_addstring(json, ZBX_PROTO_TAG_INFO, info, ZBX_JSON_TYPE_STRING);
+
+	if (SUCCEED != status)
+		return;
+
+	zbx_tm_get_remote_tasks(tasks, proxy->hostid);
+
+	if (0 != tasks->values_num)
+		zbx_tm_json_serialize_tasks(json, tasks);
+}
+
 int	zbx_send_proxy_data_response(const DC_PROXY *proxy, zbx_socket_t *sock, const char *info)
 {
 	struct zbx_json		json;
@@ -42,17 +80,7 @@ int	zbx_send_proxy_data_response(const DC_PROXY *proxy, zbx_socket_t *sock, cons
 
 	zbx_vector_ptr_create(&tasks);
 
-	zbx_tm_get_remote_tasks(&tasks, proxy->hostid);
-
-	zbx_json_init(&json, ZBX_JSON_STAT_BUF_LEN);
-
-	zbx_json_addstring(&json, ZBX_PROTO_TAG_RESPONSE, ZBX_PROTO_VALUE_SUCCESS, ZBX_JSON_TYPE_STRING);
-
-	if (NULL != info && '\0' != *info)
-		zbx_json_addstring(&json, ZBX_PROTO_TAG_INFO, info, ZBX_JSON_TYPE_STRING);
-
-	if (0 != tasks.values_num)
-		zbx_tm_json_serialize_tasks(&json, &tasks);
+	zbx_proxy_data_response_prepare(proxy, SUCCEED, info, &json, &tasks);
 
 	if (0 != proxy->auto_compress)
 		flags |= ZBX_TCP_COMPRESS;
@@ -30,6 +30,8 @@ void	zbx_recv_proxy_data(zbx_socket_t *sock, struct zbx_json_parse *jp, zbx_time
 void	zbx_send_proxy_data(zbx_socket_t *sock, zbx_timespec_t *ts);
 void	zbx_send_task_data(zbx_socket_t *sock, zbx_timespec_t *ts);
 
+void	zbx_proxy_data_response_prepare(const DC_PROXY *proxy, int status, const char *info, struct zbx_json *json,
+		zbx_vector_ptr_t *tasks);
 int	zbx_send_proxy_data_response(const DC_PROXY *proxy, zbx_socket_t *sock, const char *info);
 
 int	init_proxy_history_lock(char **error);
@@ -1377,6 +1377,8 @@ ZBX_THREAD_ENTRY(trapper_thread, args)
 			process_trapper_child(&s, &ts);
 			sec = zbx_time() - sec;
 
+			update_selfmon_latency(sec);
+
 			zbx_tcp_unaccept(&s);
 		}
 		else if (EINTR != zbx_socket_last_error())
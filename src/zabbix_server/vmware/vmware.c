@@ -107,7 +107,9 @@ static zbx_vmware_t	*vmware = NULL;
 #define ZBX_VPXD_STATS_MAXQUERYMETRICS	64
 #define ZBX_MAXQUERYMETRICS_UNLIMITED	1000
 
-ZBX_VECTOR_IMPL(str_uint64_pair, zbx_str_uint64_pair_t)
+/* the maximum number of SOAP requests sent simultaneously during one service update */
+#define ZBX_VMWARE_PARALLEL_REQUESTS	8
+
 ZBX_PTR_VECTOR_IMPL(vmware_datastore, zbx_vmware_datastore_t *)
 
 /* VMware service object name mapping for vcenter and vsphere installations */
@@ -421,6 +423,7 @@ static int	zbx_xml_try_read_value(const char *data, size_t len, const char *xpat
 		char **error);
 static char	*zbx_xml_read_node_value(xmlDoc *doc, xmlNode *node, const char *xpath);
 static char	*zbx_xml_read_doc_value(xmlDoc *xdoc, const char *xpath);
+static void	libxml_handle_error(void *user_data, xmlErrorPtr err);
 
 static size_t	curl_write_cb(void *ptr, size_t size, size_t nmemb, void *userdata)
 {
@@ -490,6 +493,48 @@ static int	zbx_http_post(CURL *easyhandle, const char *request, ZBX_HTTPPAGE **r
 
 	return SUCCEED;
 }
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_soap_read_response                                           *
+ *                                                                            *
+ * Purpose: parses vmware web service response with SOAP error validation     *
+ *                                                                            *
+ * Parameters: fn_parent - [IN] the parent function name for Log records      *
+ *             resp      - [IN] the http response                             *
+ *             xdoc      - [OUT] the xml document response (optional)         *
+ *             error     - [OUT] the error message in the case of failure     *
+ *                               (optional)                                   *
+ *                                                                            *
+ * Return value: SUCCEED - the SOAP response has no errors                    *
+ *               FAIL    - the SOAP response contains error or is invalid     *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_soap_read_response(const char *fn_parent, const ZBX_HTTPPAGE *resp, xmlDoc **xdoc, char **error)
+{
+	xmlDoc	*doc = NULL;
+	int	ret = SUCCEED;
+
+	if (NULL != fn_parent)
+		zabbix_log(LOG_LEVEL_TRACE, "%s() SOAP response: %s", fn_parent, resp->data);
+
+	if (SUCCEED != zbx_xml_try_read_value(resp->data, resp->offset, ZBX_XPATH_FAULTSTRING(), &doc, error, error)
+			|| NULL != *error)
+	{
+		ret = FAIL;
+	}
+
+	if (NULL != xdoc)
+	{
+		*xdoc = doc;
+	}
+	else
+	{
+		zbx_xml_free_doc(doc);
+	}
+
+	return ret;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_soap_post                                                    *
@@ -508,32 +553,293 @@ static int	zbx_http_post(CURL *easyhandle, const char *request, ZBX_HTTPPAGE **r
  ******************************************************************************/
 static int	zbx_soap_post(const char *fn_parent, CURL *easyhandle, const char *request, xmlDoc **xdoc, char **error)
 {
-	xmlDoc		*doc;
 	ZBX_HTTPPAGE	*resp;
-	int		ret = SUCCEED;
 
 	if (SUCCEED != zbx_http_post(easyhandle, request, &resp, error))
 		return FAIL;
 
-	if (NULL != fn_parent)
-		zabbix_log(LOG_LEVEL_TRACE, "%s() SOAP response: %s", fn_parent, resp->data);
+	return zbx_soap_read_response(fn_parent, resp, xdoc, error);
+}
 
-	if (SUCCEED != zbx_xml_try_read_value(resp->data, resp->offset, ZBX_XPATH_FAULTSTRING(), &doc, error, error)
-			|| NULL != *error)
+/* starts the request of a parallel SOAP job on the specified cURL handle */
+typedef int	(*zbx_vmware_job_start_func_t)(void *job, CURL *easyhandle, char **error);
+
+/* processes results of a parallel SOAP job, error is NULL if the transfer succeeded */
+typedef void	(*zbx_vmware_job_finish_func_t)(void *job, const char *error);
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_post_sequential                                           *
+ *                                                                            *
+ * Purpose: performs SOAP jobs one after another using the specified handle   *
+ *                                                                            *
+ * Parameters: easyhandle - [IN] the authenticated CURL handle                *
+ *             jobs       - [IN/OUT] the jobs to perform                      *
+ *             job_start  - [IN] the job request setup callback               *
+ *             job_finish - [IN] the job response processing callback         *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_post_sequential(CURL *easyhandle, zbx_vector_ptr_t *jobs, zbx_vmware_job_start_func_t job_start,
+		zbx_vmware_job_finish_func_t job_finish)
+{
+	ZBX_HTTPPAGE	*page = NULL;
+	CURLcode	err;
+	char		*error = NULL;
+	int		i;
+
+	curl_easy_getinfo(easyhandle, CURLINFO_PRIVATE, (char **)&page);
+
+	for (i = 0; i < jobs->values_num; i++)
 	{
-		ret = FAIL;
+		if (SUCCEED != job_start(jobs->values[i], easyhandle, &error))
+		{
+			if (NULL == error)
+				error = zbx_strdup(NULL, "Cannot start request.");
+		}
+		else if (CURLE_OK != (err = curl_easy_perform(easyhandle)))
+			error = zbx_strdup(error, curl_easy_strerror(err));
+
+		job_finish(jobs->values[i], error);
+		zbx_free(error);
 	}
 
-	if (NULL != xdoc)
+	/* restore the default response handling */
+	curl_easy_setopt(easyhandle, CURLOPT_WRITEFUNCTION, curl_write_cb);
+	curl_easy_setopt(easyhandle, CURLOPT_WRITEDATA, page);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_duplicate_handle                                          *
+ *                                                                            *
+ * Purpose: creates a copy of authenticated CURL handle sharing its session   *
+ *                                                                            *
+ * Parameters: easyhandle - [IN] the authenticated CURL handle                *
+ *             cookies    - [IN] the session cookies                          *
+ *                                                                            *
+ * Return value: the new CURL handle or NULL on failure                       *
+ *                                                                            *
+ ******************************************************************************/
+static CURL	*vmware_duplicate_handle(CURL *easyhandle, const struct curl_slist *cookies)
+{
+	CURL	*handle;
+
+	if (NULL == (handle = curl_easy_duphandle(easyhandle)))
+		return NULL;
+
+	/* duplicated handle gets empty cookie storage, so the session cookie must be copied */
+	for (; NULL != cookies; cookies = cookies->next)
 	{
-		*xdoc = doc;
+		if (CURLE_OK != curl_easy_setopt(handle, CURLOPT_COOKIELIST, cookies->data))
+		{
+			curl_easy_cleanup(handle);
+			return NULL;
+		}
 	}
-	else
+
+	return handle;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_multi_wait                                                *
+ *                                                                            *
+ * Purpose: waits for activity on the transfers of CURL multi handle          *
+ *                                                                            *
+ * Parameters: multihandle - [IN] the CURL multi handle                       *
+ *             timeout_ms  - [IN] the maximum wait time in milliseconds       *
+ *                                                                            *
+ * Return value: CURLM_OK - the wait has completed or timed out               *
+ *               otherwise the CURL multi interface error                     *
+ *                                                                            *
+ * Comments: curl_multi_wait() is supported starting with version 7.28.0      *
+ *           (0x071c00), with older versions the transfer sockets are waited  *
+ *           for with select().                                               *
+ *                                                                            *
+ ******************************************************************************/
+static CURLMcode	vmware_multi_wait(CURLM *multihandle, int timeout_ms)
+{
+#if LIBCURL_VERSION_NUM >= 0x071c00
+	int	fds;
+
+	return curl_multi_wait(multihandle, NULL, 0, timeout_ms, &fds);
+#else
+	fd_set		fdread, fdwrite, fdexcep;
+	int		maxfd = -1;
+	long		curl_timeout = -1;
+	struct timeval	tv;
+	CURLMcode	code;
+
+	if (CURLM_OK != (code = curl_multi_timeout(multihandle, &curl_timeout)))
+		return code;
+
+	if (0 <= curl_timeout && curl_timeout < timeout_ms)
+		timeout_ms = (int)curl_timeout;
+
+	FD_ZERO(&fdread);
+	FD_ZERO(&fdwrite);
+	FD_ZERO(&fdexcep);
+
+	if (CURLM_OK != (code = curl_multi_fdset(multihandle, &fdread, &fdwrite, &fdexcep, &maxfd)))
+		return code;
+
+	/* no sockets to wait for while transfers are being set up (resolving host names etc) */
+	if (-1 == maxfd && 100 < timeout_ms)
+		timeout_ms = 100;
+
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+	/* failed or interrupted wait is not an error, the transfers are checked by curl_multi_perform() */
+	if (-1 == select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &tv))
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() select() failed: %s", __func__, zbx_strerror(errno));
+
+	return CURLM_OK;
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_post_parallel                                             *
+ *                                                                            *
+ * Purpose: performs SOAP jobs simultaneously within the authenticated        *
+ *          vmware service session                                            *
+ *                                                                            *
+ * Parameters: easyhandle - [IN] the authenticated CURL handle                *
+ *             jobs       - [IN/OUT] the jobs to perform                      *
+ *             job_start  - [IN] the job request setup callback               *
+ *             job_finish - [IN] the job response processing callback         *
+ *                                                                            *
+ * Comments: Up to ZBX_VMWARE_PARALLEL_REQUESTS copies of the session handle  *
+ *           are kept busy with the jobs. The job_finish callback is called   *
+ *           for every job exactly once, in the order of job completion.      *
+ *           If parallel transfers cannot be set up, the jobs are performed   *
+ *           sequentially with the session handle.                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_post_parallel(CURL *easyhandle, zbx_vector_ptr_t *jobs, zbx_vmware_job_start_func_t job_start,
+		zbx_vmware_job_finish_func_t job_finish)
+{
+	CURLM			*multihandle = NULL;
+	CURL			*handles[ZBX_VMWARE_PARALLEL_REQUESTS];
+	CURLMsg			*msg;
+	CURLMcode		code = CURLM_OK;
+	struct curl_slist	*cookies = NULL;
+	zbx_vector_ptr_t	idle;
+	int			i, handles_num = 0, next = 0, active = 0, running, msgnum;
+	char			*error = NULL;
+	void			*job;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() jobs:%d", __func__, jobs->values_num);
+
+	if (2 > jobs->values_num)
+		goto sequential;
+
+	if (CURLE_OK != curl_easy_getinfo(easyhandle, CURLINFO_COOKIELIST, &cookies))
+		goto sequential;
+
+	if (NULL == (multihandle = curl_multi_init()))
+		goto sequential;
+
+	for (; handles_num < MIN(jobs->values_num, ZBX_VMWARE_PARALLEL_REQUESTS); handles_num++)
 	{
-		zbx_xml_free_doc(doc);
+		if (NULL == (handles[handles_num] = vmware_duplicate_handle(easyhandle, cookies)))
+			break;
 	}
 
-	return ret;
+	if (0 == handles_num)
+		goto sequential;
+
+	zbx_vector_ptr_create(&idle);
+	zbx_vector_ptr_append_array(&idle, (void **)handles, handles_num);
+
+	while (next < jobs->values_num || 0 != active)
+	{
+		/* keep all idle handles busy while there are jobs left */
+		while (0 != idle.values_num && next < jobs->values_num)
+		{
+			CURL	*handle = idle.values[idle.values_num - 1];
+
+			job = jobs->values[next++];
+
+			if (SUCCEED != job_start(job, handle, &error) ||
+					CURLE_OK != curl_easy_setopt(handle, CURLOPT_PRIVATE, job) ||
+					CURLM_OK != curl_multi_add_handle(multihandle, handle))
+			{
+				if (NULL == error)
+					error = zbx_strdup(NULL, "Cannot start request.");
+
+				job_finish(job, error);
+				zbx_free(error);
+				continue;
+			}
+
+			zbx_vector_ptr_remove_noorder(&idle, idle.values_num - 1);
+			active++;
+		}
+
+		if (0 == active)
+			continue;
+
+		if (CURLM_OK != (code = curl_multi_perform(multihandle, &running)) ||
+				CURLM_OK != (code = vmware_multi_wait(multihandle, 1000)))
+		{
+			break;
+		}
+
+		while (NULL != (msg = curl_multi_info_read(multihandle, &msgnum)))
+		{
+			if (CURLMSG_DONE != msg->msg)
+				continue;
+
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&job);
+			curl_multi_remove_handle(multihandle, msg->easy_handle);
+			zbx_vector_ptr_append(&idle, msg->easy_handle);
+			active--;
+
+			job_finish(job, CURLE_OK == msg->data.result ? NULL : curl_easy_strerror(msg->data.result));
+		}
+	}
+
+	if (0 != active || next < jobs->values_num)
+	{
+		const char	*multi_error = curl_multi_strerror(code);
+
+		/* fail the jobs in progress and the jobs not started yet */
+		for (i = 0; i < handles_num; i++)
+		{
+			if (FAIL != zbx_vector_ptr_search(&idle, handles[i], ZBX_DEFAULT_PTR_COMPARE_FUNC))
+				continue;
+
+			curl_easy_getinfo(handles[i], CURLINFO_PRIVATE, (char **)&job);
+			curl_multi_remove_handle(multihandle, handles[i]);
+			job_finish(job, multi_error);
+		}
+
+		while (next < jobs->values_num)
+			job_finish(jobs->values[next++], multi_error);
+	}
+
+	zbx_vector_ptr_destroy(&idle);
+
+	for (i = 0; i < handles_num; i++)
+		curl_easy_cleanup(handles[i]);
+
+	curl_multi_cleanup(multihandle);
+	curl_slist_free_all(cookies);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() requests:%d", __func__, handles_num);
+
+	return;
+sequential:
+	if (NULL != multihandle)
+		curl_multi_cleanup(multihandle);
+
+	curl_slist_free_all(cookies);
+
+	vmware_post_sequential(easyhandle, jobs, job_start, job_finish);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() requests:sequential", __func__);
 }
 
 /******************************************************************************
@@ -704,27 +1010,41 @@ static void	vmware_counters_shared_copy(zbx_hashset_t *dst, const zbx_vector_ptr
 
 /******************************************************************************
  *                                                                            *
- * Function: vmware_vector_str_uint64_pair_shared_clean                       *
+ * Function: vmware_perf_instanceset_shared_free                              *
+ *                                                                            *
+ * Purpose: frees shared resources allocated to store performance counter     *
+ *          instance set                                                      *
+ *                                                                            *
+ * Parameters: instanceset - [IN] the instance set, referencing entity        *
+ *                                instance names                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_perf_instanceset_shared_free(zbx_vector_str_t *instanceset)
+{
+	zbx_vector_str_destroy(instanceset);
+	__vm_mem_free_func(instanceset);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_perf_instances_shared_clean                               *
  *                                                                            *
- * Purpose: frees shared resources allocated to store instance performance    *
- *          counter values                                                    *
+ * Purpose: frees shared resources allocated to store performance counter     *
+ *          instance names and instance sets of an entity                     *
  *                                                                            *
- * Parameters: pairs - [IN] vector of performance counter pairs               *
+ * Parameters: entity - [IN] the performance entity                           *
  *                                                                            *
  ******************************************************************************/
-static void	vmware_vector_str_uint64_pair_shared_clean(zbx_vector_str_uint64_pair_t *pairs)
+static void	vmware_perf_instances_shared_clean(zbx_vmware_perf_entity_t *entity)
 {
 	int	i;
 
-	for (i = 0; i < pairs->values_num; i++)
-	{
-		zbx_str_uint64_pair_t	*pair = &pairs->values[i];
+	zbx_vector_ptr_clear_ext(&entity->instancesets, (zbx_mem_free_func_t)vmware_perf_instanceset_shared_free);
 
-		if (NULL != pair->name)
-			vmware_shared_strfree(pair->name);
-	}
+	for (i = 0; i < entity->instances.values_num; i++)
+		vmware_shared_strfree(entity->instances.values[i]);
 
-	pairs->values_num = 0;
+	entity->instances.values_num = 0;
 }
 
 /******************************************************************************
@@ -739,8 +1059,7 @@ static void	vmware_vector_str_uint64_pair_shared_clean(zbx_vector_str_uint64_pai
  ******************************************************************************/
 static void	vmware_perf_counter_shared_free(zbx_vmware_perf_counter_t *counter)
 {
-	vmware_vector_str_uint64_pair_shared_clean(&counter->values);
-	zbx_vector_str_uint64_pair_destroy(&counter->values);
+	zbx_vector_uint64_destroy(&counter->values);
 	__vm_mem_free_func(counter);
 }
 
@@ -765,11 +1084,13 @@ static void	vmware_entities_shared_clean_stats(zbx_hashset_t *entities)
 		for (i = 0; i < entity->counters.values_num; i++)
 		{
 			counter = (zbx_vmware_perf_counter_t *)entity->counters.values[i];
-			vmware_vector_str_uint64_pair_shared_clean(&counter->values);
+			counter->instances = NULL;
+			zbx_vector_uint64_clear(&counter->values);
 
 			if (0 != (counter->state & ZBX_VMWARE_COUNTER_UPDATING))
 				counter->state = ZBX_VMWARE_COUNTER_READY;
 		}
+		vmware_perf_instances_shared_clean(entity);
 		vmware_shared_strfree(entity->error);
 		entity->error = NULL;
 	}
@@ -1021,6 +1342,10 @@ static void	vmware_shared_perf_entity_clean(zbx_vmware_perf_entity_t *entity)
 	zbx_vector_ptr_clear_ext(&entity->counters, (zbx_mem_free_func_t)vmware_perf_counter_shared_free);
 	zbx_vector_ptr_destroy(&entity->counters);
 
+	vmware_perf_instances_shared_clean(entity);
+	zbx_vector_ptr_destroy(&entity->instancesets);
+	zbx_vector_str_destroy(&entity->instances);
+
 	vmware_shared_strfree(entity->query_instance);
 	vmware_shared_strfree(entity->type);
 	vmware_shared_strfree(entity->id);
@@ -1068,6 +1393,12 @@ static void	vmware_service_shared_free(zbx_vmware_service_t *service)
 	if (NULL != service->fullname)
 		vmware_shared_strfree(service->fullname);
 
+	if (NULL != service->session)
+		vmware_shared_strfree(service->session);
+
+	if (NULL != service->update_version)
+		vmware_shared_strfree(service->update_version);
+
 	vmware_data_shared_free(service->data);
 
 	zbx_hashset_iter_reset(&service->entities, &iter);
@@ -1585,42 +1916,24 @@ static void	vmware_counter_free(zbx_vmware_counter_t *counter)
 
 /******************************************************************************
  *                                                                            *
- * Function: vmware_service_authenticate                                      *
+ * Function: vmware_service_init_curl                                         *
  *                                                                            *
- * Purpose: authenticates vmware service                                      *
+ * Purpose: sets up CURL handle for vmware service requests                   *
  *                                                                            *
  * Parameters: service    - [IN] the vmware service                           *
  *             easyhandle - [IN] the CURL handle                              *
  *             page       - [IN] the CURL output buffer                       *
  *             error      - [OUT] the error message in the case of failure    *
  *                                                                            *
- * Return value: SUCCEED - the authentication was completed successfully      *
- *               FAIL    - the authentication process has failed              *
- *                                                                            *
- * Comments: If service type is unknown this function will attempt to         *
- *           determine the right service type by trying to login with vCenter *
- *           and vSphere session managers.                                    *
+ * Return value: SUCCEED - the handle was set up successfully                 *
+ *               FAIL    - otherwise                                          *
  *                                                                            *
  ******************************************************************************/
-static int	vmware_service_authenticate(zbx_vmware_service_t *service, CURL *easyhandle, ZBX_HTTPPAGE *page,
+static int	vmware_service_init_curl(const zbx_vmware_service_t *service, CURL *easyhandle, ZBX_HTTPPAGE *page,
 		char **error)
 {
-#	define ZBX_POST_VMWARE_AUTH						\
-		ZBX_POST_VSPHERE_HEADER						\
-		"<ns0:Login xsi:type=\"ns0:LoginRequestType\">"			\
-			"<ns0:_this type=\"SessionManager\">%s</ns0:_this>"	\
-			"<ns0:userName>%s</ns0:userName>"			\
-			"<ns0:password>%s</ns0:password>"			\
-		"</ns0:Login>"							\
-		ZBX_POST_VSPHERE_FOOTER
-
-	char		xml[MAX_STRING_LEN], *error_object = NULL, *username_esc = NULL, *password_esc = NULL;
 	CURLoption	opt;
 	CURLcode	err;
-	xmlDoc		*doc = NULL;
-	int		ret = FAIL;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() '%s'@'%s'", __func__, service->username, service->url);
 
 	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_COOKIEFILE, "")) ||
 			CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_FOLLOWLOCATION, 1L)) ||
@@ -1636,7 +1949,7 @@ static int	vmware_service_authenticate(zbx_vmware_service_t *service, CURL *easy
 			CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_SSL_VERIFYHOST, 0L)))
 	{
 		*error = zbx_dsprintf(*error, "Cannot set cURL option %d: %s.", (int)opt, curl_easy_strerror(err));
-		goto out;
+		return FAIL;
 	}
 
 	if (NULL != CONFIG_SOURCE_IP)
@@ -1645,10 +1958,53 @@ static int	vmware_service_authenticate(zbx_vmware_service_t *service, CURL *easy
 		{
 			*error = zbx_dsprintf(*error, "Cannot set cURL option %d: %s.", (int)opt,
 					curl_easy_strerror(err));
-			goto out;
+			return FAIL;
 		}
 	}
 
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_authenticate                                      *
+ *                                                                            *
+ * Purpose: authenticates vmware service                                      *
+ *                                                                            *
+ * Parameters: service    - [IN] the vmware service                           *
+ *             easyhandle - [IN] the CURL handle                              *
+ *             page       - [IN] the CURL output buffer                       *
+ *             error      - [OUT] the error message in the case of failure    *
+ *                                                                            *
+ * Return value: SUCCEED - the authentication was completed successfully      *
+ *               FAIL    - the authentication process has failed              *
+ *                                                                            *
+ * Comments: If service type is unknown this function will attempt to         *
+ *           determine the right service type by trying to login with vCenter *
+ *           and vSphere session managers.                                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_service_authenticate(zbx_vmware_service_t *service, CURL *easyhandle, ZBX_HTTPPAGE *page,
+		char **error)
+{
+#	define ZBX_POST_VMWARE_AUTH						\
+		ZBX_POST_VSPHERE_HEADER						\
+		"<ns0:Login xsi:type=\"ns0:LoginRequestType\">"			\
+			"<ns0:_this type=\"SessionManager\">%s</ns0:_this>"	\
+			"<ns0:userName>%s</ns0:userName>"			\
+			"<ns0:password>%s</ns0:password>"			\
+		"</ns0:Login>"							\
+		ZBX_POST_VSPHERE_FOOTER
+
+	char	xml[MAX_STRING_LEN], *error_object = NULL, *username_esc = NULL, *password_esc = NULL;
+	xmlDoc	*doc = NULL;
+	int	ret = FAIL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() '%s'@'%s'", __func__, service->username, service->url);
+
+	if (SUCCEED != vmware_service_init_curl(service, easyhandle, page, error))
+		goto out;
+
 	username_esc = xml_escape_dyn(service->username);
 	password_esc = xml_escape_dyn(service->password);
 
@@ -1715,7 +2071,7 @@ out:
  *             error      - [OUT] the error message in the case of failure    *
  *                                                                            *
  ******************************************************************************/
-static int	vmware_service_logout(zbx_vmware_service_t *service, CURL *easyhandle, char **error)
+static int	vmware_service_logout(const zbx_vmware_service_t *service, CURL *easyhandle, char **error)
 {
 #	define ZBX_POST_VMWARE_LOGOUT						\
 		ZBX_POST_VSPHERE_HEADER						\
@@ -1730,17 +2086,104 @@ static int	vmware_service_logout(zbx_vmware_service_t *service, CURL *easyhandle
 	return zbx_soap_post(__func__, easyhandle, tmp, NULL, error);
 }
 
-typedef struct
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_get_session                                       *
+ *                                                                            *
+ * Purpose: gets the session cookies of authenticated CURL handle             *
+ *                                                                            *
+ * Parameters: easyhandle - [IN] the authenticated CURL handle                *
+ *                                                                            *
+ * Return value: the allocated cookie lines separated by newlines or NULL if  *
+ *               the cookies cannot be retrieved                              *
+ *                                                                            *
+ ******************************************************************************/
+static char	*vmware_service_get_session(CURL *easyhandle)
 {
-	const char	*property_collector;
-	CURL		*easyhandle;
-	char		*token;
-}
-zbx_property_collection_iter;
+	struct curl_slist	*cookies = NULL, *cookie;
+	char			*session = NULL;
+	size_t			session_alloc = 0, session_offset = 0;
 
-static int	zbx_property_collection_init(CURL *easyhandle, const char *property_collection_query,
-		const char *property_collector, zbx_property_collection_iter **iter, xmlDoc **xdoc, char **error)
-{
+	if (CURLE_OK != curl_easy_getinfo(easyhandle, CURLINFO_COOKIELIST, &cookies))
+		return NULL;
+
+	for (cookie = cookies; NULL != cookie; cookie = cookie->next)
+	{
+		if (0 != session_offset)
+			zbx_chrcpy_alloc(&session, &session_alloc, &session_offset, '\n');
+
+		zbx_strcpy_alloc(&session, &session_alloc, &session_offset, cookie->data);
+	}
+
+	curl_slist_free_all(cookies);
+
+	return session;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_resume_session                                    *
+ *                                                                            *
+ * Purpose: sets up CURL handle to continue the previously opened session     *
+ *                                                                            *
+ * Parameters: service    - [IN] the vmware service                           *
+ *             easyhandle - [IN] the CURL handle                              *
+ *             page       - [IN] the CURL output buffer                       *
+ *             session    - [IN] the session cookies                          *
+ *             error      - [OUT] the error message in the case of failure    *
+ *                                                                            *
+ * Return value: SUCCEED - the handle was set up successfully                 *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_service_resume_session(const zbx_vmware_service_t *service, CURL *easyhandle,
+		ZBX_HTTPPAGE *page, const char *session, char **error)
+{
+	const char	*ptr, *end;
+	char		*cookie = NULL;
+	size_t		cookie_alloc = 0, cookie_offset;
+	CURLcode	err;
+	int		ret = SUCCEED;
+
+	if (SUCCEED != vmware_service_init_curl(service, easyhandle, page, error))
+		return FAIL;
+
+	for (ptr = session; '\0' != *ptr; ptr = end)
+	{
+		if (NULL == (end = strchr(ptr, '\n')))
+			end = ptr + strlen(ptr);
+
+		cookie_offset = 0;
+		zbx_strncpy_alloc(&cookie, &cookie_alloc, &cookie_offset, ptr, end - ptr);
+
+		if ('\n' == *end)
+			end++;
+
+		if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_COOKIELIST, cookie)))
+		{
+			*error = zbx_dsprintf(*error, "Cannot set cURL option %d: %s.", (int)CURLOPT_COOKIELIST,
+					curl_easy_strerror(err));
+			ret = FAIL;
+			break;
+		}
+	}
+
+	zbx_free(cookie);
+
+	return ret;
+}
+
+typedef struct
+{
+	const char	*property_collector;
+	CURL		*easyhandle;
+	char		*token;
+}
+zbx_property_collection_iter;
+
+static int	zbx_property_collection_init(CURL *easyhandle, const char *property_collection_query,
+		const char *property_collector, zbx_property_collection_iter **iter, xmlDoc **xdoc, char **error)
+{
 #	define ZBX_XPATH_RETRIEVE_PROPERTIES_TOKEN			\
 		"/*[local-name()='Envelope']/*[local-name()='Body']"	\
 		"/*[local-name()='RetrievePropertiesExResponse']"	\
@@ -2303,24 +2746,20 @@ clean:
 
 /******************************************************************************
  *                                                                            *
- * Function: vmware_service_get_vm_data                                       *
+ * Function: vmware_service_get_vm_request                                    *
  *                                                                            *
- * Purpose: gets the virtual machine data                                     *
+ * Purpose: creates the virtual machine data request                          *
  *                                                                            *
  * Parameters: service      - [IN] the vmware service                         *
- *             easyhandle   - [IN] the CURL handle                            *
  *             vmid         - [IN] the virtual machine id                     *
  *             propmap      - [IN] the xpaths of the properties to read       *
  *             props_num    - [IN] the number of properties to read           *
- *             xdoc         - [OUT] a reference to output xml document        *
- *             error        - [OUT] the error message in the case of failure  *
  *                                                                            *
- * Return value: SUCCEED - the operation has completed successfully           *
- *               FAIL    - the operation has failed                           *
+ * Return value: the allocated SOAP request                                   *
  *                                                                            *
  ******************************************************************************/
-static int	vmware_service_get_vm_data(zbx_vmware_service_t *service, CURL *easyhandle, const char *vmid,
-		const zbx_vmware_propmap_t *propmap, int props_num, xmlDoc **xdoc, char **error)
+static char	*vmware_service_get_vm_request(const zbx_vmware_service_t *service, const char *vmid,
+		const zbx_vmware_propmap_t *propmap, int props_num)
 {
 #	define ZBX_POST_VMWARE_VM_STATUS_EX 						\
 		ZBX_POST_VSPHERE_HEADER							\
@@ -2344,9 +2783,8 @@ static int	vmware_service_get_vm_data(zbx_vmware_service_t *service, CURL *easyh
 		ZBX_POST_VSPHERE_FOOTER
 
 	char	tmp[MAX_STRING_LEN], props[MAX_STRING_LEN], *vmid_esc;
-	int	i, ret = FAIL;
+	int	i;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() vmid:'%s'", __func__, vmid);
 	props[0] = '\0';
 
 	for (i = 0; i < props_num; i++)
@@ -2363,14 +2801,7 @@ static int	vmware_service_get_vm_data(zbx_vmware_service_t *service, CURL *easyh
 
 	zbx_free(vmid_esc);
 
-	if (SUCCEED != zbx_soap_post(__func__, easyhandle, tmp, xdoc, error))
-		goto out;
-
-	ret = SUCCEED;
-out:
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
-
-	return ret;
+	return zbx_strdup(NULL, tmp);
 }
 
 /******************************************************************************
@@ -2380,20 +2811,18 @@ out:
  * Purpose: create virtual machine object                                     *
  *                                                                            *
  * Parameters: service      - [IN] the vmware service                         *
- *             easyhandle   - [IN] the CURL handle                            *
  *             id           - [IN] the virtual machine id                     *
- *             error        - [OUT] the error message in the case of failure  *
+ *             details      - [IN] the virtual machine data                   *
  *                                                                            *
  * Return value: The created virtual machine object or NULL if an error was   *
  *               detected.                                                    *
  *                                                                            *
  ******************************************************************************/
-static zbx_vmware_vm_t	*vmware_service_create_vm(zbx_vmware_service_t *service,  CURL *easyhandle,
-		const char *id, char **error)
+static zbx_vmware_vm_t	*vmware_service_create_vm(const zbx_vmware_service_t *service, const char *id,
+		xmlDoc *details)
 {
 	zbx_vmware_vm_t	*vm;
 	char		*value;
-	xmlDoc		*details = NULL;
 	const char	*uuid_xpath[3] = {NULL, ZBX_XPATH_VM_UUID(), ZBX_XPATH_VM_INSTANCE_UUID()};
 	int		ret = FAIL;
 
@@ -2405,12 +2834,6 @@ static zbx_vmware_vm_t	*vmware_service_create_vm(zbx_vmware_service_t *service,
 	zbx_vector_ptr_create(&vm->devs);
 	zbx_vector_ptr_create(&vm->file_systems);
 
-	if (SUCCEED != vmware_service_get_vm_data(service, easyhandle, id, vm_propmap,
-			ZBX_VMWARE_VMPROPS_NUM, &details, error))
-	{
-		goto out;
-	}
-
 	if (NULL == (value = zbx_xml_read_doc_value(details, uuid_xpath[service->type])))
 		goto out;
 
@@ -2426,8 +2849,6 @@ static zbx_vmware_vm_t	*vmware_service_create_vm(zbx_vmware_service_t *service,
 
 	ret = SUCCEED;
 out:
-	zbx_xml_free_doc(details);
-
 	if (SUCCEED != ret)
 	{
 		vmware_vm_free(vm);
@@ -2439,6 +2860,135 @@ out:
 	return vm;
 }
 
+/* the virtual machine data retrieval job */
+typedef struct
+{
+	const zbx_vmware_service_t	*service;
+
+	/* the hypervisor the virtual machine belongs to */
+	zbx_vmware_hv_t			*hv;
+
+	char				*id;
+	char				*request;
+	ZBX_HTTPPAGE			page;
+
+	zbx_vmware_vm_t			*vm;
+	char				*error;
+}
+zbx_vmware_vm_job_t;
+
+static void	vmware_vm_job_free(zbx_vmware_vm_job_t *job)
+{
+	zbx_free(job->id);
+	zbx_free(job->request);
+	zbx_free(job->page.data);
+	zbx_free(job->error);
+
+	if (NULL != job->vm)
+		vmware_vm_free(job->vm);
+
+	zbx_free(job);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_vm_job_start                                              *
+ *                                                                            *
+ * Purpose: sets up virtual machine data request on the specified handle      *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_vm_job_start(void *data, CURL *easyhandle, char **error)
+{
+	zbx_vmware_vm_job_t	*job = (zbx_vmware_vm_job_t *)data;
+	CURLoption		opt;
+	CURLcode		err;
+
+	job->page.offset = 0;
+
+	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_WRITEFUNCTION, curl_write_cb)) ||
+			CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_WRITEDATA, &job->page)) ||
+			CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_POSTFIELDS, job->request)))
+	{
+		*error = zbx_dsprintf(*error, "Cannot set cURL option %d: %s.", (int)opt, curl_easy_strerror(err));
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_vm_job_finish                                             *
+ *                                                                            *
+ * Purpose: creates virtual machine object from the received data             *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_vm_job_finish(void *data, const char *error)
+{
+	zbx_vmware_vm_job_t	*job = (zbx_vmware_vm_job_t *)data;
+	xmlDoc			*details = NULL;
+
+	if (NULL != error)
+		job->error = zbx_strdup(job->error, error);
+	else if (SUCCEED == zbx_soap_read_response(__func__, &job->page, &details, &job->error))
+		job->vm = vmware_service_create_vm(job->service, job->id, details);
+
+	zbx_xml_free_doc(details);
+
+	/* release the response buffer as soon as it is processed */
+	zbx_free(job->page.data);
+	job->page.alloc = 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_create_vms                                        *
+ *                                                                            *
+ * Purpose: retrieves virtual machines of hypervisors with parallel requests  *
+ *                                                                            *
+ * Parameters: easyhandle   - [IN] the authenticated CURL handle              *
+ *             jobs         - [IN] the virtual machine jobs                   *
+ *             error        - [OUT] the error message in the case of failure  *
+ *                                                                            *
+ * Comments: The created virtual machines are added to their hypervisors in   *
+ *           the job order. Only the jobs without virtual machine object are  *
+ *           performed.                                                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_service_create_vms(CURL *easyhandle, zbx_vector_ptr_t *jobs, char **error)
+{
+	zbx_vector_ptr_t	requests;
+	int			i;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() vms:%d", __func__, jobs->values_num);
+
+	zbx_vector_ptr_create(&requests);
+
+	for (i = 0; i < jobs->values_num; i++)
+	{
+		if (NULL == ((zbx_vmware_vm_job_t *)jobs->values[i])->vm)
+			zbx_vector_ptr_append(&requests, jobs->values[i]);
+	}
+
+	vmware_post_parallel(easyhandle, &requests, vmware_vm_job_start, vmware_vm_job_finish);
+	zbx_vector_ptr_destroy(&requests);
+
+	for (i = 0; i < jobs->values_num; i++)
+	{
+		zbx_vmware_vm_job_t	*job = (zbx_vmware_vm_job_t *)jobs->values[i];
+
+		if (NULL != job->vm)
+		{
+			zbx_vector_ptr_append(&job->hv->vms, job->vm);
+			job->vm = NULL;
+		}
+		else if (NULL != job->error)
+			*error = zbx_strdup(*error, job->error);
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: vmware_service_refresh_datastore_info                            *
@@ -2850,6 +3400,7 @@ static int	vmware_ds_id_compare(const void *d1, const void *d2)
  *             id           - [IN] the vmware hypervisor id                   *
  *             dss          - [IN/OUT] the vector with all Datastores         *
  *             hv           - [OUT] the hypervisor object (must be allocated) *
+ *             vms          - [OUT] the hypervisor virtual machine ids        *
  *             error        - [OUT] the error message in the case of failure  *
  *                                                                            *
  * Return value: SUCCEED - the hypervisor object was initialized successfully *
@@ -2857,11 +3408,11 @@ static int	vmware_ds_id_compare(const void *d1, const void *d2)
  *                                                                            *
  ******************************************************************************/
 static int	vmware_service_init_hv(zbx_vmware_service_t *service, CURL *easyhandle, const char *id,
-		zbx_vector_vmware_datastore_t *dss, zbx_vmware_hv_t *hv, char **error)
+		zbx_vector_vmware_datastore_t *dss, zbx_vmware_hv_t *hv, zbx_vector_str_t *vms, char **error)
 {
 	char			*value;
 	xmlDoc			*details = NULL;
-	zbx_vector_str_t	datastores, vms;
+	zbx_vector_str_t	datastores;
 	int			i, j, ret = FAIL;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() hvid:'%s'", __func__, id);
@@ -2872,7 +3423,6 @@ static int	vmware_service_init_hv(zbx_vmware_service_t *service, CURL *easyhandl
 	zbx_vector_ptr_create(&hv->vms);
 
 	zbx_vector_str_create(&datastores);
-	zbx_vector_str_create(&vms);
 
 	if (SUCCEED != vmware_service_get_hv_data(service, easyhandle, id, hv_propmap,
 			ZBX_VMWARE_HVPROPS_NUM, &details, error))
@@ -2918,24 +3468,13 @@ static int	vmware_service_init_hv(zbx_vmware_service_t *service, CURL *easyhandl
 	}
 
 	zbx_vector_str_sort(&hv->ds_names, ZBX_DEFAULT_STR_COMPARE_FUNC);
-	zbx_xml_read_values(details, ZBX_XPATH_HV_VMS(), &vms);
-	zbx_vector_ptr_reserve(&hv->vms, vms.values_num + hv->vms.values_alloc);
-
-	for (i = 0; i < vms.values_num; i++)
-	{
-		zbx_vmware_vm_t	*vm;
-
-		if (NULL != (vm = vmware_service_create_vm(service, easyhandle, vms.values[i], error)))
-			zbx_vector_ptr_append(&hv->vms, vm);
-	}
+	zbx_xml_read_values(details, ZBX_XPATH_HV_VMS(), vms);
+	zbx_vector_ptr_reserve(&hv->vms, vms->values_num + hv->vms.values_alloc);
 
 	ret = SUCCEED;
 out:
 	zbx_xml_free_doc(details);
 
-	zbx_vector_str_clear_ext(&vms, zbx_str_free);
-	zbx_vector_str_destroy(&vms);
-
 	zbx_vector_str_clear_ext(&datastores, zbx_str_free);
 	zbx_vector_str_destroy(&datastores);
 
@@ -2947,6 +3486,115 @@ out:
 	return ret;
 }
 
+/* the inventory traversal from root folder to hypervisors, virtual machines and datastores */
+#define ZBX_POST_VMWARE_INVENTORY_OBJECTSET				\
+	"<ns0:objectSet>"						\
+		"<ns0:obj type=\"Folder\">%s</ns0:obj>"			\
+		"<ns0:skip>false</ns0:skip>"				\
+		"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
+			"<ns0:name>visitFolders</ns0:name>"		\
+			"<ns0:type>Folder</ns0:type>"			\
+			"<ns0:path>childEntity</ns0:path>"		\
+			"<ns0:skip>false</ns0:skip>"			\
+			"<ns0:selectSet>"				\
+				"<ns0:name>visitFolders</ns0:name>"	\
+			"</ns0:selectSet>"				\
+			"<ns0:selectSet>"				\
+				"<ns0:name>dcToHf</ns0:name>"		\
+			"</ns0:selectSet>"				\
+			"<ns0:selectSet>"				\
+				"<ns0:name>dcToVmf</ns0:name>"		\
+			"</ns0:selectSet>"				\
+			"<ns0:selectSet>"				\
+				"<ns0:name>crToH</ns0:name>"		\
+			"</ns0:selectSet>"				\
+			"<ns0:selectSet>"				\
+				"<ns0:name>crToRp</ns0:name>"		\
+			"</ns0:selectSet>"				\
+			"<ns0:selectSet>"				\
+				"<ns0:name>dcToDs</ns0:name>"		\
+			"</ns0:selectSet>"				\
+			"<ns0:selectSet>"				\
+				"<ns0:name>hToVm</ns0:name>"		\
+			"</ns0:selectSet>"				\
+			"<ns0:selectSet>"				\
+				"<ns0:name>rpToVm</ns0:name>"		\
+			"</ns0:selectSet>"				\
+		"</ns0:selectSet>"					\
+		"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
+			"<ns0:name>dcToVmf</ns0:name>"			\
+			"<ns0:type>Datacenter</ns0:type>"		\
+			"<ns0:path>vmFolder</ns0:path>"			\
+			"<ns0:skip>false</ns0:skip>"			\
+			"<ns0:selectSet>"				\
+				"<ns0:name>visitFolders</ns0:name>"	\
+			"</ns0:selectSet>"				\
+		"</ns0:selectSet>"					\
+		"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
+			"<ns0:name>dcToDs</ns0:name>"			\
+			"<ns0:type>Datacenter</ns0:type>"		\
+			"<ns0:path>datastore</ns0:path>"		\
+			"<ns0:skip>false</ns0:skip>"			\
+			"<ns0:selectSet>"				\
+				"<ns0:name>visitFolders</ns0:name>"	\
+			"</ns0:selectSet>"				\
+		"</ns0:selectSet>"					\
+		"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
+			"<ns0:name>dcToHf</ns0:name>"			\
+			"<ns0:type>Datacenter</ns0:type>"		\
+			"<ns0:path>hostFolder</ns0:path>"		\
+			"<ns0:skip>false</ns0:skip>"			\
+			"<ns0:selectSet>"				\
+				"<ns0:name>visitFolders</ns0:name>"	\
+			"</ns0:selectSet>"				\
+		"</ns0:selectSet>"					\
+		"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
+			"<ns0:name>crToH</ns0:name>"			\
+			"<ns0:type>ComputeResource</ns0:type>"		\
+			"<ns0:path>host</ns0:path>"			\
+			"<ns0:skip>false</ns0:skip>"			\
+		"</ns0:selectSet>"					\
+		"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
+			"<ns0:name>crToRp</ns0:name>"			\
+			"<ns0:type>ComputeResource</ns0:type>"		\
+			"<ns0:path>resourcePool</ns0:path>"		\
+			"<ns0:skip>false</ns0:skip>"			\
+			"<ns0:selectSet>"				\
+				"<ns0:name>rpToRp</ns0:name>"		\
+			"</ns0:selectSet>"				\
+			"<ns0:selectSet>"				\
+				"<ns0:name>rpToVm</ns0:name>"		\
+			"</ns0:selectSet>"				\
+		"</ns0:selectSet>"					\
+		"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
+			"<ns0:name>rpToRp</ns0:name>"			\
+			"<ns0:type>ResourcePool</ns0:type>"		\
+			"<ns0:path>resourcePool</ns0:path>"		\
+			"<ns0:skip>false</ns0:skip>"			\
+			"<ns0:selectSet>"				\
+				"<ns0:name>rpToRp</ns0:name>"		\
+			"</ns0:selectSet>"				\
+			"<ns0:selectSet>"				\
+				"<ns0:name>rpToVm</ns0:name>"		\
+			"</ns0:selectSet>"				\
+		"</ns0:selectSet>"					\
+		"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
+			"<ns0:name>hToVm</ns0:name>"			\
+			"<ns0:type>HostSystem</ns0:type>"		\
+			"<ns0:path>vm</ns0:path>"			\
+			"<ns0:skip>false</ns0:skip>"			\
+			"<ns0:selectSet>"				\
+				"<ns0:name>visitFolders</ns0:name>"	\
+			"</ns0:selectSet>"				\
+		"</ns0:selectSet>"					\
+		"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
+			"<ns0:name>rpToVm</ns0:name>"			\
+			"<ns0:type>ResourcePool</ns0:type>"		\
+			"<ns0:path>vm</ns0:path>"			\
+			"<ns0:skip>false</ns0:skip>"			\
+		"</ns0:selectSet>"					\
+	"</ns0:objectSet>"
+
 /******************************************************************************
  *                                                                            *
  * Function: vmware_service_get_hv_ds_list                                    *
@@ -2977,112 +3625,7 @@ static int	vmware_service_get_hv_ds_list(const zbx_vmware_service_t *service, CU
 				"<ns0:propSet>"							\
 					"<ns0:type>Datastore</ns0:type>"			\
 				"</ns0:propSet>"						\
-				"<ns0:objectSet>"						\
-					"<ns0:obj type=\"Folder\">%s</ns0:obj>"			\
-					"<ns0:skip>false</ns0:skip>"				\
-					"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
-						"<ns0:name>visitFolders</ns0:name>"		\
-						"<ns0:type>Folder</ns0:type>"			\
-						"<ns0:path>childEntity</ns0:path>"		\
-						"<ns0:skip>false</ns0:skip>"			\
-						"<ns0:selectSet>"				\
-							"<ns0:name>visitFolders</ns0:name>"	\
-						"</ns0:selectSet>"				\
-						"<ns0:selectSet>"				\
-							"<ns0:name>dcToHf</ns0:name>"		\
-						"</ns0:selectSet>"				\
-						"<ns0:selectSet>"				\
-							"<ns0:name>dcToVmf</ns0:name>"		\
-						"</ns0:selectSet>"				\
-						"<ns0:selectSet>"				\
-							"<ns0:name>crToH</ns0:name>"		\
-						"</ns0:selectSet>"				\
-						"<ns0:selectSet>"				\
-							"<ns0:name>crToRp</ns0:name>"		\
-						"</ns0:selectSet>"				\
-						"<ns0:selectSet>"				\
-							"<ns0:name>dcToDs</ns0:name>"		\
-						"</ns0:selectSet>"				\
-						"<ns0:selectSet>"				\
-							"<ns0:name>hToVm</ns0:name>"		\
-						"</ns0:selectSet>"				\
-						"<ns0:selectSet>"				\
-							"<ns0:name>rpToVm</ns0:name>"		\
-						"</ns0:selectSet>"				\
-					"</ns0:selectSet>"					\
-					"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
-						"<ns0:name>dcToVmf</ns0:name>"			\
-						"<ns0:type>Datacenter</ns0:type>"		\
-						"<ns0:path>vmFolder</ns0:path>"			\
-						"<ns0:skip>false</ns0:skip>"			\
-						"<ns0:selectSet>"				\
-							"<ns0:name>visitFolders</ns0:name>"	\
-						"</ns0:selectSet>"				\
-					"</ns0:selectSet>"					\
-					"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
-						"<ns0:name>dcToDs</ns0:name>"			\
-						"<ns0:type>Datacenter</ns0:type>"		\
-						"<ns0:path>datastore</ns0:path>"		\
-						"<ns0:skip>false</ns0:skip>"			\
-						"<ns0:selectSet>"				\
-							"<ns0:name>visitFolders</ns0:name>"	\
-						"</ns0:selectSet>"				\
-					"</ns0:selectSet>"					\
-					"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
-						"<ns0:name>dcToHf</ns0:name>"			\
-						"<ns0:type>Datacenter</ns0:type>"		\
-						"<ns0:path>hostFolder</ns0:path>"		\
-						"<ns0:skip>false</ns0:skip>"			\
-						"<ns0:selectSet>"				\
-							"<ns0:name>visitFolders</ns0:name>"	\
-						"</ns0:selectSet>"				\
-					"</ns0:selectSet>"					\
-					"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
-						"<ns0:name>crToH</ns0:name>"			\
-						"<ns0:type>ComputeResource</ns0:type>"		\
-						"<ns0:path>host</ns0:path>"			\
-						"<ns0:skip>false</ns0:skip>"			\
-					"</ns0:selectSet>"					\
-					"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
-						"<ns0:name>crToRp</ns0:name>"			\
-						"<ns0:type>ComputeResource</ns0:type>"		\
-						"<ns0:path>resourcePool</ns0:path>"		\
-						"<ns0:skip>false</ns0:skip>"			\
-						"<ns0:selectSet>"				\
-							"<ns0:name>rpToRp</ns0:name>"		\
-						"</ns0:selectSet>"				\
-						"<ns0:selectSet>"				\
-							"<ns0:name>rpToVm</ns0:name>"		\
-						"</ns0:selectSet>"				\
-					"</ns0:selectSet>"					\
-					"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
-						"<ns0:name>rpToRp</ns0:name>"			\
-						"<ns0:type>ResourcePool</ns0:type>"		\
-						"<ns0:path>resourcePool</ns0:path>"		\
-						"<ns0:skip>false</ns0:skip>"			\
-						"<ns0:selectSet>"				\
-							"<ns0:name>rpToRp</ns0:name>"		\
-						"</ns0:selectSet>"				\
-						"<ns0:selectSet>"				\
-							"<ns0:name>rpToVm</ns0:name>"		\
-						"</ns0:selectSet>"				\
-					"</ns0:selectSet>"					\
-					"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
-						"<ns0:name>hToVm</ns0:name>"			\
-						"<ns0:type>HostSystem</ns0:type>"		\
-						"<ns0:path>vm</ns0:path>"			\
-						"<ns0:skip>false</ns0:skip>"			\
-						"<ns0:selectSet>"				\
-							"<ns0:name>visitFolders</ns0:name>"	\
-						"</ns0:selectSet>"				\
-					"</ns0:selectSet>"					\
-					"<ns0:selectSet xsi:type=\"ns0:TraversalSpec\">"	\
-						"<ns0:name>rpToVm</ns0:name>"			\
-						"<ns0:type>ResourcePool</ns0:type>"		\
-						"<ns0:path>vm</ns0:path>"			\
-						"<ns0:skip>false</ns0:skip>"			\
-					"</ns0:selectSet>"					\
-				"</ns0:objectSet>"						\
+				ZBX_POST_VMWARE_INVENTORY_OBJECTSET				\
 			"</ns0:specSet>"							\
 			"<ns0:options/>"							\
 		"</ns0:RetrievePropertiesEx>"							\
@@ -3235,55 +3778,6 @@ out:
 #	undef ZBX_POST_VMWARE_DESTROY_EVENT_COLLECTOR
 }
 
-/******************************************************************************
- *                                                                            *
- * Function: vmware_service_read_previous_events                              *
- *                                                                            *
- * Purpose: reads events from "scrollable view" and moves it back in time     *
- *                                                                            *
- * Parameters: easyhandle     - [IN] the CURL handle                          *
- *             event_session  - [IN] event session (EventHistoryCollector)    *
- *                                   identifier                               *
- *             soap_count     - [IN] max count of events in response          *
- *             xdoc           - [OUT] the result as xml document              *
- *             error          - [OUT] the error message in the case of failure*
- *                                                                            *
- * Return value: SUCCEED - the operation has completed successfully           *
- *               FAIL    - the operation has failed                           *
- *                                                                            *
- ******************************************************************************/
-static int	vmware_service_read_previous_events(CURL *easyhandle, const char *event_session, int soap_count,
-		xmlDoc **xdoc, char **error)
-{
-#	define ZBX_POST_VMWARE_READ_PREVIOUS_EVENTS					\
-		ZBX_POST_VSPHERE_HEADER							\
-		"<ns0:ReadPreviousEvents>"						\
-			"<ns0:_this type=\"EventHistoryCollector\">%s</ns0:_this>"	\
-			"<ns0:maxCount>%d</ns0:maxCount>"				\
-		"</ns0:ReadPreviousEvents>"						\
-		ZBX_POST_VSPHERE_FOOTER
-
-	int	ret = FAIL;
-	char	tmp[MAX_STRING_LEN], *event_session_esc;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() soap_count: %d", __func__, soap_count);
-
-	event_session_esc = xml_escape_dyn(event_session);
-
-	zbx_snprintf(tmp, sizeof(tmp), ZBX_POST_VMWARE_READ_PREVIOUS_EVENTS, event_session_esc, soap_count);
-
-	zbx_free(event_session_esc);
-
-	if (SUCCEED != zbx_soap_post(__func__, easyhandle, tmp, xdoc, error))
-		goto out;
-
-	ret = SUCCEED;
-out:
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
-
-	return ret;
-}
-
 /******************************************************************************
  *                                                                            *
  * Function: vmware_service_destroy_event_session                             *
@@ -3331,35 +3825,27 @@ out:
 
 /******************************************************************************
  *                                                                            *
- * Function: vmware_service_put_event_data                                    *
+ * Function: vmware_event_create                                              *
  *                                                                            *
- * Purpose: read event data by id from xml and put to array of events         *
+ * Purpose: creates event from its message and creation time                  *
  *                                                                            *
- * Parameters: events    - [IN/OUT] the array of parsed events                *
- *             xml_event - [IN] the xml node and id of parsed event           *
- *             xdoc      - [IN] xml document with eventlog records            *
+ * Parameters: key      - [IN] the event key                                  *
+ *             message  - [IN] the event message, the event takes ownership   *
+ *             time_str - [IN] the event creation time (optional)             *
+ *                                                                            *
+ * Return value: the created event                                            *
  *                                                                            *
- * Return value: SUCCEED - the operation has completed successfully           *
- *               FAIL    - the operation has failed                           *
  ******************************************************************************/
-static int	vmware_service_put_event_data(zbx_vector_ptr_t *events, zbx_id_xmlnode_t xml_event, xmlDoc *xdoc)
+static zbx_vmware_event_t	*vmware_event_create(zbx_uint64_t key, char *message, const char *time_str)
 {
-	zbx_vmware_event_t	*event = NULL;
-	char			*message, *time_str;
+	zbx_vmware_event_t	*event;
 	int			timestamp = 0;
 
-	if (NULL == (message = zbx_xml_read_node_value(xdoc, xml_event.xml_node, ZBX_XPATH_NN("fullFormattedMessage"))))
-	{
-		zabbix_log(LOG_LEVEL_TRACE, "skipping event key '" ZBX_FS_UI64 "', fullFormattedMessage"
-				" is missing", xml_event.id);
-		return FAIL;
-	}
-
 	zbx_replace_invalid_utf8(message);
 
-	if (NULL == (time_str = zbx_xml_read_node_value(xdoc, xml_event.xml_node, ZBX_XPATH_NN("createdTime"))))
+	if (NULL == time_str)
 	{
-		zabbix_log(LOG_LEVEL_TRACE, "createdTime is missing for event key '" ZBX_FS_UI64 "'", xml_event.id);
+		zabbix_log(LOG_LEVEL_TRACE, "createdTime is missing for event key '" ZBX_FS_UI64 "'", key);
 	}
 	else
 	{
@@ -3369,256 +3855,558 @@ static int	vmware_service_put_event_data(zbx_vector_ptr_t *events, zbx_id_xmlnod
 		if (6 != sscanf(time_str, "%d-%d-%dT%d:%d:%d.%*s", &year, &mon, &mday, &hour, &min, &sec))
 		{
 			zabbix_log(LOG_LEVEL_TRACE, "unexpected format of createdTime '%s' for event"
-					" key '" ZBX_FS_UI64 "'", time_str, xml_event.id);
+					" key '" ZBX_FS_UI64 "'", time_str, key);
 		}
 		else if (SUCCEED != zbx_utc_time(year, mon, mday, hour, min, sec, &t))
 		{
 			zabbix_log(LOG_LEVEL_TRACE, "cannot convert createdTime '%s' for event key '"
-					ZBX_FS_UI64 "'", time_str, xml_event.id);
+					ZBX_FS_UI64 "'", time_str, key);
 		}
 		else
 			timestamp = t;
-
-		zbx_free(time_str);
 	}
 
-	event = (zbx_vmware_event_t *)zbx_malloc(event, sizeof(zbx_vmware_event_t));
-	event->key = xml_event.id;
+	event = (zbx_vmware_event_t *)zbx_malloc(NULL, sizeof(zbx_vmware_event_t));
+	event->key = key;
 	event->message = message;
 	event->timestamp = timestamp;
-	zbx_vector_ptr_append(events, event);
 
-	return SUCCEED;
+	return event;
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: vmware_service_parse_event_data                                  *
- *                                                                            *
- * Purpose: parse multiple events data                                        *
+ * Function: vmware_service_put_event_data                                    *
  *                                                                            *
- * Parameters: events   - [IN/OUT] the array of parsed events                 *
- *             last_key - [IN] the key of last parsed event                   *
- *             xdoc     - [IN] xml document with eventlog records             *
+ * Purpose: read event data by id from xml and put to array of events         *
  *                                                                            *
- * Return value: The count of events successfully parsed                      *
+ * Parameters: events    - [IN/OUT] the array of parsed events                *
+ *             xml_event - [IN] the xml node and id of parsed event           *
+ *             xdoc      - [IN] xml document with eventlog records            *
  *                                                                            *
+ * Return value: SUCCEED - the operation has completed successfully           *
+ *               FAIL    - the operation has failed                           *
  ******************************************************************************/
-static int	vmware_service_parse_event_data(zbx_vector_ptr_t *events, zbx_uint64_t last_key, xmlDoc *xdoc)
+static int	vmware_service_put_event_data(zbx_vector_ptr_t *events, zbx_id_xmlnode_t xml_event, xmlDoc *xdoc)
 {
-	zbx_vector_id_xmlnode_t	ids;
-	int			i, parsed_num = 0;
-	char			*value;
-	xmlXPathContext		*xpathCtx;
-	xmlXPathObject		*xpathObj;
-	xmlNodeSetPtr		nodeset;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() last_key:" ZBX_FS_UI64, __func__, last_key);
-
-	xpathCtx = xmlXPathNewContext(xdoc);
+	char	*message, *time_str;
 
-	if (NULL == (xpathObj = xmlXPathEvalExpression((xmlChar *)"/*/*/*"ZBX_XPATH_LN("returnval"), xpathCtx)))
+	if (NULL == (message = zbx_xml_read_node_value(xdoc, xml_event.xml_node, ZBX_XPATH_NN("fullFormattedMessage"))))
 	{
-		zabbix_log(LOG_LEVEL_DEBUG, "Cannot make evenlog list parsing query.");
-		goto clean;
+		zabbix_log(LOG_LEVEL_TRACE, "skipping event key '" ZBX_FS_UI64 "', fullFormattedMessage"
+				" is missing", xml_event.id);
+		return FAIL;
 	}
 
-	if (0 != xmlXPathNodeSetIsEmpty(xpathObj->nodesetval))
-	{
-		zabbix_log(LOG_LEVEL_DEBUG, "Cannot find items in evenlog list.");
-		goto clean;
-	}
+	time_str = zbx_xml_read_node_value(xdoc, xml_event.xml_node, ZBX_XPATH_NN("createdTime"));
+	zbx_vector_ptr_append(events, vmware_event_create(xml_event.id, message, time_str));
+	zbx_free(time_str);
 
-	nodeset = xpathObj->nodesetval;
-	zbx_vector_id_xmlnode_create(&ids);
-	zbx_vector_id_xmlnode_reserve(&ids, nodeset->nodeNr);
+	return SUCCEED;
+}
 
-	for (i = 0; i < nodeset->nodeNr; i++)
-	{
-		zbx_id_xmlnode_t	xml_event;
-		zbx_uint64_t		key;
+/* ReadPreviousEvents response elements, which text is collected by streaming parser */
+#define ZBX_EVENT_XML_NONE	0
+#define ZBX_EVENT_XML_KEY	1
+#define ZBX_EVENT_XML_MESSAGE	2
+#define ZBX_EVENT_XML_TIME	3
+#define ZBX_EVENT_XML_FAULT	4
 
-		if (NULL == (value = zbx_xml_read_node_value(xdoc, nodeset->nodeTab[i], ZBX_XPATH_NN("key"))))
-		{
-			zabbix_log(LOG_LEVEL_TRACE, "skipping eventlog record without key, xml number '%d'", i);
-			continue;
-		}
+/* ReadPreviousEvents response element depths: Envelope/Body/ReadPreviousEventsResponse/returnval/key */
+#define ZBX_EVENT_XML_DEPTH_EVENT	4
+#define ZBX_EVENT_XML_DEPTH_PROPERTY	5
 
-		if (SUCCEED != is_uint64(value, &key))
-		{
-			zabbix_log(LOG_LEVEL_TRACE, "skipping eventlog key '%s', not a number", value);
-			zbx_free(value);
-			continue;
-		}
+/* the streaming ReadPreviousEvents response parser state */
+typedef struct
+{
+	xmlParserCtxtPtr	ctxt;
 
-		zbx_free(value);
+	/* the parsed events newer than last_key */
+	zbx_vector_ptr_t	events;
+	zbx_uint64_t		last_key;
 
-		if (key <= last_key)
-		{
-			zabbix_log(LOG_LEVEL_TRACE, "skipping event key '" ZBX_FS_UI64 "', has been processed", key);
-			continue;
-		}
+	/* the number of eventlog records in response */
+	int			records_num;
 
-		xml_event.id = key;
-		xml_event.xml_node = nodeset->nodeTab[i];
-		zbx_vector_id_xmlnode_append(&ids, xml_event);
-	}
+	int			depth;
+	int			element;
 
-	if (0 != ids.values_num)
-	{
-		zbx_vector_id_xmlnode_sort(&ids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
-		zbx_vector_ptr_reserve(events, ids.values_num + events->values_alloc);
+	char			*text;
+	size_t			text_alloc;
+	size_t			text_offset;
 
-		/* we are reading "scrollable views" in reverse chronological order, */
-		/* so inside a "scrollable view" latest events should come first too */
-		for (i = ids.values_num - 1; i >= 0; i--)
-		{
-			if (SUCCEED == vmware_service_put_event_data(events, ids.values[i], xdoc))
-				parsed_num++;
-		}
-	}
+	/* the eventlog record being parsed */
+	char			*key;
+	char			*message;
+	char			*time;
 
-	zbx_vector_id_xmlnode_destroy(&ids);
-clean:
-	if (NULL != xpathObj)
-		xmlXPathFreeObject(xpathObj);
+	char			*fault;
+	char			*error;
+}
+zbx_vmware_event_parser_t;
 
-	xmlXPathFreeContext(xpathCtx);
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_event_parser_take_text                                    *
+ *                                                                            *
+ * Purpose: returns the collected element text and stops collecting           *
+ *                                                                            *
+ ******************************************************************************/
+static char	*vmware_event_parser_take_text(zbx_vmware_event_parser_t *parser)
+{
+	char	*text;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() parsed:%d", __func__, parsed_num);
+	text = (char *)zbx_malloc(NULL, parser->text_offset + 1);
 
-	return parsed_num;
+	if (0 != parser->text_offset)
+		memcpy(text, parser->text, parser->text_offset);
+
+	text[parser->text_offset] = '\0';
+	parser->text_offset = 0;
+	parser->element = ZBX_EVENT_XML_NONE;
+
+	return text;
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: vmware_service_get_event_data                                    *
- *                                                                            *
- * Purpose: retrieves event data                                              *
- *                                                                            *
- * Parameters: service      - [IN] the vmware service                         *
- *             easyhandle   - [IN] the CURL handle                            *
- *             events       - [OUT] a pointer to the output variable          *
- *             error        - [OUT] the error message in the case of failure  *
+ * Function: vmware_event_parser_add_event                                    *
  *                                                                            *
- * Return value: SUCCEED - the operation has completed successfully           *
- *               FAIL    - the operation has failed                           *
+ * Purpose: adds parsed eventlog record to events unless it has been          *
+ *          processed before                                                  *
  *                                                                            *
  ******************************************************************************/
-static int	vmware_service_get_event_data(const zbx_vmware_service_t *service, CURL *easyhandle,
-		zbx_vector_ptr_t *events, char **error)
+static void	vmware_event_parser_add_event(zbx_vmware_event_parser_t *parser)
 {
-	char		*event_session = NULL;
-	int		ret = FAIL, soap_count = 5; /* 10 - initial value of eventlog records number in one response */
-	xmlDoc		*doc = NULL;
-	zbx_uint64_t	eventlog_last_key;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+	zbx_uint64_t	key;
 
-	if (SUCCEED != vmware_service_get_event_session(service, easyhandle, &event_session, error))
-		goto out;
-
-	if (SUCCEED != vmware_service_reset_event_history_collector(easyhandle, event_session, error))
-		goto end_session;
+	parser->records_num++;
 
-	if (NULL != service->data && 0 != service->data->events.values_num &&
-			((const zbx_vmware_event_t *)service->data->events.values[0])->key > service->eventlog.last_key)
+	if (NULL == parser->key)
 	{
-		eventlog_last_key = ((const zbx_vmware_event_t *)service->data->events.values[0])->key;
+		zabbix_log(LOG_LEVEL_TRACE, "skipping eventlog record without key, xml number '%d'",
+				parser->records_num - 1);
+	}
+	else if (SUCCEED != is_uint64(parser->key, &key))
+	{
+		zabbix_log(LOG_LEVEL_TRACE, "skipping eventlog key '%s', not a number", parser->key);
+	}
+	else if (key <= parser->last_key)
+	{
+		zabbix_log(LOG_LEVEL_TRACE, "skipping event key '" ZBX_FS_UI64 "', has been processed", key);
+	}
+	else if (NULL == parser->message)
+	{
+		zabbix_log(LOG_LEVEL_TRACE, "skipping event key '" ZBX_FS_UI64 "', fullFormattedMessage"
+				" is missing", key);
 	}
 	else
-		eventlog_last_key = service->eventlog.last_key;
-
-	do
 	{
-		zbx_xml_free_doc(doc);
-		doc = NULL;
-
-		if ((ZBX_MAXQUERYMETRICS_UNLIMITED / 2) >= soap_count)
-			soap_count = soap_count * 2;
-		else if (ZBX_MAXQUERYMETRICS_UNLIMITED != soap_count)
-			soap_count = ZBX_MAXQUERYMETRICS_UNLIMITED;
+		zbx_vector_ptr_append(&parser->events, vmware_event_create(key, parser->message, parser->time));
+		parser->message = NULL;
+	}
 
-		if (0 != events->values_num &&
-				(((const zbx_vmware_event_t *)events->values[events->values_num - 1])->key -
-				eventlog_last_key -1) < (unsigned int)soap_count)
-		{
-			soap_count = ((const zbx_vmware_event_t *)events->values[events->values_num - 1])->key -
-					eventlog_last_key - 1;
-		}
+	zbx_free(parser->key);
+	zbx_free(parser->message);
+	zbx_free(parser->time);
+}
 
-		if (0 < soap_count && SUCCEED != vmware_service_read_previous_events(easyhandle, event_session,
-				soap_count, &doc, error))
-		{
-			goto end_session;
-		}
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_event_parser_start_element                                *
+ *                                                                            *
+ * Purpose: libxml2 SAX2 element start callback of ReadPreviousEvents         *
+ *          response parser                                                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_event_parser_start_element(void *ctx, const xmlChar *localname, const xmlChar *prefix,
+		const xmlChar *URI, int nb_namespaces, const xmlChar **namespaces, int nb_attributes, int nb_defaulted,
+		const xmlChar **attributes)
+{
+	zbx_vmware_event_parser_t	*parser = (zbx_vmware_event_parser_t *)ctx;
+	const char			*name = (const char *)localname;
+
+	ZBX_UNUSED(prefix);
+	ZBX_UNUSED(URI);
+	ZBX_UNUSED(nb_namespaces);
+	ZBX_UNUSED(namespaces);
+	ZBX_UNUSED(nb_attributes);
+	ZBX_UNUSED(nb_defaulted);
+	ZBX_UNUSED(attributes);
+
+	parser->depth++;
+	parser->text_offset = 0;
+	parser->element = ZBX_EVENT_XML_NONE;
+
+	if (0 == strcmp(name, "faultstring"))
+	{
+		parser->element = ZBX_EVENT_XML_FAULT;
+		return;
 	}
-	while (0 < vmware_service_parse_event_data(events, eventlog_last_key, doc));
-
-	ret = SUCCEED;
-end_session:
-	if (SUCCEED != vmware_service_destroy_event_session(easyhandle, event_session, error))
-		ret = FAIL;
-out:
-	zbx_free(event_session);
-	zbx_xml_free_doc(doc);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+	if (ZBX_EVENT_XML_DEPTH_PROPERTY != parser->depth)
+		return;
 
-	return ret;
+	if (0 == strcmp(name, "key"))
+		parser->element = ZBX_EVENT_XML_KEY;
+	else if (0 == strcmp(name, "fullFormattedMessage"))
+		parser->element = ZBX_EVENT_XML_MESSAGE;
+	else if (0 == strcmp(name, "createdTime"))
+		parser->element = ZBX_EVENT_XML_TIME;
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: vmware_service_get_last_event_data                               *
- *                                                                            *
- * Purpose: retrieves data only last event                                    *
- *                                                                            *
- * Parameters: service      - [IN] the vmware service                         *
- *             easyhandle   - [IN] the CURL handle                            *
- *             events       - [OUT] a pointer to the output variable          *
- *             error        - [OUT] the error message in the case of failure  *
+ * Function: vmware_event_parser_end_element                                  *
  *                                                                            *
- * Return value: SUCCEED - the operation has completed successfully           *
- *               FAIL    - the operation has failed                           *
+ * Purpose: libxml2 SAX2 element end callback of ReadPreviousEvents response  *
+ *          parser                                                            *
  *                                                                            *
  ******************************************************************************/
-static int	vmware_service_get_last_event_data(const zbx_vmware_service_t *service, CURL *easyhandle,
-		zbx_vector_ptr_t *events, char **error)
+static void	vmware_event_parser_end_element(void *ctx, const xmlChar *localname, const xmlChar *prefix,
+		const xmlChar *URI)
 {
-#	define ZBX_POST_VMWARE_LASTEVENT 								\
-		ZBX_POST_VSPHERE_HEADER									\
-		"<ns0:RetrievePropertiesEx>"								\
-			"<ns0:_this type=\"PropertyCollector\">%s</ns0:_this>"				\
-			"<ns0:specSet>"									\
-				"<ns0:propSet>"								\
-					"<ns0:type>EventManager</ns0:type>"				\
-					"<ns0:all>false</ns0:all>"					\
-					"<ns0:pathSet>latestEvent</ns0:pathSet>"			\
-				"</ns0:propSet>"							\
-				"<ns0:objectSet>"							\
-					"<ns0:obj type=\"EventManager\">%s</ns0:obj>"			\
-				"</ns0:objectSet>"							\
-			"</ns0:specSet>"								\
-			"<ns0:options/>"								\
-		"</ns0:RetrievePropertiesEx>"								\
-		ZBX_POST_VSPHERE_FOOTER
+	zbx_vmware_event_parser_t	*parser = (zbx_vmware_event_parser_t *)ctx;
 
-	char			tmp[MAX_STRING_LEN], *value;
-	int			ret = FAIL;
-	xmlDoc			*doc = NULL;
-	zbx_id_xmlnode_t	xml_event;
-	xmlXPathContext		*xpathCtx;
-	xmlXPathObject		*xpathObj;
+	ZBX_UNUSED(prefix);
+	ZBX_UNUSED(URI);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+	switch (parser->element)
+	{
+		case ZBX_EVENT_XML_FAULT:
+			zbx_free(parser->fault);
+			parser->fault = vmware_event_parser_take_text(parser);
+			break;
+		case ZBX_EVENT_XML_KEY:
+			zbx_free(parser->key);
+			parser->key = vmware_event_parser_take_text(parser);
+			break;
+		case ZBX_EVENT_XML_MESSAGE:
+			zbx_free(parser->message);
+			parser->message = vmware_event_parser_take_text(parser);
+			break;
+		case ZBX_EVENT_XML_TIME:
+			zbx_free(parser->time);
+			parser->time = vmware_event_parser_take_text(parser);
+			break;
+	}
 
-	zbx_snprintf(tmp, sizeof(tmp), ZBX_POST_VMWARE_LASTEVENT,
-			vmware_service_objects[service->type].property_collector,
-			vmware_service_objects[service->type].event_manager);
+	if (ZBX_EVENT_XML_DEPTH_EVENT == parser->depth && 0 == strcmp((const char *)localname, "returnval"))
+		vmware_event_parser_add_event(parser);
 
-	if (SUCCEED != zbx_soap_post(__func__, easyhandle, tmp, &doc, error))
-		goto out;
+	parser->depth--;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_event_parser_characters                                   *
+ *                                                                            *
+ * Purpose: libxml2 SAX2 text callback of ReadPreviousEvents response parser  *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_event_parser_characters(void *ctx, const xmlChar *ch, int len)
+{
+	zbx_vmware_event_parser_t	*parser = (zbx_vmware_event_parser_t *)ctx;
+
+	if (ZBX_EVENT_XML_NONE == parser->element)
+		return;
+
+	zbx_strncpy_alloc(&parser->text, &parser->text_alloc, &parser->text_offset, (const char *)ch, len);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: curl_write_events_cb                                             *
+ *                                                                            *
+ * Purpose: passes received ReadPreviousEvents response data to the           *
+ *          streaming parser                                                  *
+ *                                                                            *
+ ******************************************************************************/
+static size_t	curl_write_events_cb(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	size_t				r_size = size * nmemb;
+	zbx_vmware_event_parser_t	*parser = (zbx_vmware_event_parser_t *)userdata;
+
+	zabbix_log(LOG_LEVEL_TRACE, "vmware_service_read_previous_events() SOAP response: %.*s",
+			(int)r_size, (const char *)ptr);
+
+	if (0 != xmlParseChunk(parser->ctxt, (const char *)ptr, (int)r_size, 0))
+	{
+		parser->error = zbx_strdup(parser->error, "Received response has no valid XML data.");
+		return 0;
+	}
+
+	return r_size;
+}
+
+static int	vmware_event_key_compare(const void *d1, const void *d2)
+{
+	const zbx_vmware_event_t	*event1 = *(const zbx_vmware_event_t * const *)d1;
+	const zbx_vmware_event_t	*event2 = *(const zbx_vmware_event_t * const *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(event1->key, event2->key);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_read_previous_events                              *
+ *                                                                            *
+ * Purpose: reads events from "scrollable view" and moves it back in time     *
+ *                                                                            *
+ * Parameters: easyhandle     - [IN] the CURL handle                          *
+ *             event_session  - [IN] event session (EventHistoryCollector)    *
+ *                                   identifier                               *
+ *             soap_count     - [IN] max count of events in response          *
+ *             last_key       - [IN] the key of last parsed event             *
+ *             events         - [IN/OUT] the array of parsed events           *
+ *             error          - [OUT] the error message in the case of failure*
+ *                                                                            *
+ * Return value: SUCCEED - the operation has completed successfully           *
+ *               FAIL    - the operation has failed                           *
+ *                                                                            *
+ * Comments: The events are extracted by SAX parser fed directly from the     *
+ *           cURL write callback, so neither the response nor its document    *
+ *           tree are kept in memory. Only events newer than last_key are     *
+ *           added.                                                           *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_service_read_previous_events(CURL *easyhandle, const char *event_session, int soap_count,
+		zbx_uint64_t last_key, zbx_vector_ptr_t *events, char **error)
+{
+#	define ZBX_POST_VMWARE_READ_PREVIOUS_EVENTS					\
+		ZBX_POST_VSPHERE_HEADER							\
+		"<ns0:ReadPreviousEvents>"						\
+			"<ns0:_this type=\"EventHistoryCollector\">%s</ns0:_this>"	\
+			"<ns0:maxCount>%d</ns0:maxCount>"				\
+		"</ns0:ReadPreviousEvents>"						\
+		ZBX_POST_VSPHERE_FOOTER
+
+	int				i, ret = FAIL;
+	char				tmp[MAX_STRING_LEN], *event_session_esc;
+	zbx_vmware_event_parser_t	parser;
+	xmlSAXHandler			sax;
+	ZBX_HTTPPAGE			*page = NULL;
+	CURLoption			opt;
+	CURLcode			err;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() soap_count: %d", __func__, soap_count);
+
+	event_session_esc = xml_escape_dyn(event_session);
+
+	zbx_snprintf(tmp, sizeof(tmp), ZBX_POST_VMWARE_READ_PREVIOUS_EVENTS, event_session_esc, soap_count);
+
+	zbx_free(event_session_esc);
+
+	memset(&parser, 0, sizeof(parser));
+	parser.last_key = last_key;
+	zbx_vector_ptr_create(&parser.events);
+
+	memset(&sax, 0, sizeof(sax));
+	sax.initialized = XML_SAX2_MAGIC;
+	sax.startElementNs = vmware_event_parser_start_element;
+	sax.endElementNs = vmware_event_parser_end_element;
+	sax.characters = vmware_event_parser_characters;
+
+	if (NULL == (parser.ctxt = xmlCreatePushParserCtxt(&sax, &parser, NULL, 0, ZBX_VM_NONAME_XML)))
+	{
+		*error = zbx_strdup(*error, "Cannot create XML parser.");
+		goto out;
+	}
+
+	xmlCtxtUseOptions(parser.ctxt, ZBX_XML_PARSE_OPTS);
+
+	curl_easy_getinfo(easyhandle, CURLINFO_PRIVATE, (char **)&page);
+
+	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_WRITEFUNCTION, curl_write_events_cb)) ||
+			CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_WRITEDATA, &parser)) ||
+			CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_POSTFIELDS, tmp)))
+	{
+		*error = zbx_dsprintf(*error, "Cannot set cURL option %d: %s.", (int)opt, curl_easy_strerror(err));
+	}
+	else if (CURLE_OK != (err = curl_easy_perform(easyhandle)))
+	{
+		/* keep the parser error if it has aborted the transfer */
+		if (NULL != parser.error)
+			*error = zbx_strdup(*error, parser.error);
+		else
+			*error = zbx_strdup(*error, curl_easy_strerror(err));
+	}
+	else if (0 != xmlParseChunk(parser.ctxt, NULL, 0, 1) || 0 == parser.ctxt->wellFormed)
+	{
+		*error = zbx_strdup(*error, "Received response has no valid XML data.");
+	}
+	else if (NULL != parser.fault)
+	{
+		*error = zbx_strdup(*error, parser.fault);
+	}
+	else
+	{
+		zbx_vector_ptr_sort(&parser.events, vmware_event_key_compare);
+		zbx_vector_ptr_reserve(events, events->values_num + parser.events.values_num);
+
+		/* we are reading "scrollable views" in reverse chronological order, */
+		/* so inside a "scrollable view" latest events should come first too */
+		for (i = parser.events.values_num - 1; i >= 0; i--)
+			zbx_vector_ptr_append(events, parser.events.values[i]);
+
+		zbx_vector_ptr_clear(&parser.events);
+		ret = SUCCEED;
+	}
+
+	/* restore the default response handling */
+	curl_easy_setopt(easyhandle, CURLOPT_WRITEFUNCTION, curl_write_cb);
+	curl_easy_setopt(easyhandle, CURLOPT_WRITEDATA, page);
+
+	xmlFreeParserCtxt(parser.ctxt);
+out:
+	zbx_vector_ptr_clear_ext(&parser.events, (zbx_mem_free_func_t)vmware_event_free);
+	zbx_vector_ptr_destroy(&parser.events);
+	zbx_free(parser.key);
+	zbx_free(parser.message);
+	zbx_free(parser.time);
+	zbx_free(parser.fault);
+	zbx_free(parser.error);
+	zbx_free(parser.text);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s events:%d", __func__, zbx_result_string(ret), events->values_num);
+
+	return ret;
+
+#	undef ZBX_POST_VMWARE_READ_PREVIOUS_EVENTS
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_get_event_data                                    *
+ *                                                                            *
+ * Purpose: retrieves event data                                              *
+ *                                                                            *
+ * Parameters: service      - [IN] the vmware service                         *
+ *             easyhandle   - [IN] the CURL handle                            *
+ *             events       - [OUT] a pointer to the output variable          *
+ *             error        - [OUT] the error message in the case of failure  *
+ *                                                                            *
+ * Return value: SUCCEED - the operation has completed successfully           *
+ *               FAIL    - the operation has failed                           *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_service_get_event_data(const zbx_vmware_service_t *service, CURL *easyhandle,
+		zbx_vector_ptr_t *events, char **error)
+{
+	char		*event_session = NULL;
+	int		ret = FAIL, soap_count = 5; /* 10 - initial value of eventlog records number in one response */
+	int		events_num;
+	zbx_uint64_t	eventlog_last_key;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+
+	if (SUCCEED != vmware_service_get_event_session(service, easyhandle, &event_session, error))
+		goto out;
+
+	if (SUCCEED != vmware_service_reset_event_history_collector(easyhandle, event_session, error))
+		goto end_session;
+
+	if (NULL != service->data && 0 != service->data->events.values_num &&
+			((const zbx_vmware_event_t *)service->data->events.values[0])->key > service->eventlog.last_key)
+	{
+		eventlog_last_key = ((const zbx_vmware_event_t *)service->data->events.values[0])->key;
+	}
+	else
+		eventlog_last_key = service->eventlog.last_key;
+
+	do
+	{
+		if ((ZBX_MAXQUERYMETRICS_UNLIMITED / 2) >= soap_count)
+			soap_count = soap_count * 2;
+		else if (ZBX_MAXQUERYMETRICS_UNLIMITED != soap_count)
+			soap_count = ZBX_MAXQUERYMETRICS_UNLIMITED;
+
+		if (0 != events->values_num &&
+				(((const zbx_vmware_event_t *)events->values[events->values_num - 1])->key -
+				eventlog_last_key -1) < (unsigned int)soap_count)
+		{
+			soap_count = ((const zbx_vmware_event_t *)events->values[events->values_num - 1])->key -
+					eventlog_last_key - 1;
+		}
+
+		if (0 >= soap_count)
+			break;
+
+		events_num = events->values_num;
+
+		if (SUCCEED != vmware_service_read_previous_events(easyhandle, event_session, soap_count,
+				eventlog_last_key, events, error))
+		{
+			goto end_session;
+		}
+	}
+	while (events_num < events->values_num);
+
+	ret = SUCCEED;
+end_session:
+	if (SUCCEED != vmware_service_destroy_event_session(easyhandle, event_session, error))
+		ret = FAIL;
+out:
+	zbx_free(event_session);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_get_last_event_data                               *
+ *                                                                            *
+ * Purpose: retrieves data only last event                                    *
+ *                                                                            *
+ * Parameters: service      - [IN] the vmware service                         *
+ *             easyhandle   - [IN] the CURL handle                            *
+ *             events       - [OUT] a pointer to the output variable          *
+ *             error        - [OUT] the error message in the case of failure  *
+ *                                                                            *
+ * Return value: SUCCEED - the operation has completed successfully           *
+ *               FAIL    - the operation has failed                           *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_service_get_last_event_data(const zbx_vmware_service_t *service, CURL *easyhandle,
+		zbx_vector_ptr_t *events, char **error)
+{
+#	define ZBX_POST_VMWARE_LASTEVENT 								\
+		ZBX_POST_VSPHERE_HEADER									\
+		"<ns0:RetrievePropertiesEx>"								\
+			"<ns0:_this type=\"PropertyCollector\">%s</ns0:_this>"				\
+			"<ns0:specSet>"									\
+				"<ns0:propSet>"								\
+					"<ns0:type>EventManager</ns0:type>"				\
+					"<ns0:all>false</ns0:all>"					\
+					"<ns0:pathSet>latestEvent</ns0:pathSet>"			\
+				"</ns0:propSet>"							\
+				"<ns0:objectSet>"							\
+					"<ns0:obj type=\"EventManager\">%s</ns0:obj>"			\
+				"</ns0:objectSet>"							\
+			"</ns0:specSet>"								\
+			"<ns0:options/>"								\
+		"</ns0:RetrievePropertiesEx>"								\
+		ZBX_POST_VSPHERE_FOOTER
+
+	char			tmp[MAX_STRING_LEN], *value;
+	int			ret = FAIL;
+	xmlDoc			*doc = NULL;
+	zbx_id_xmlnode_t	xml_event;
+	xmlXPathContext		*xpathCtx;
+	xmlXPathObject		*xpathObj;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+
+	zbx_snprintf(tmp, sizeof(tmp), ZBX_POST_VMWARE_LASTEVENT,
+			vmware_service_objects[service->type].property_collector,
+			vmware_service_objects[service->type].event_manager);
+
+	if (SUCCEED != zbx_soap_post(__func__, easyhandle, tmp, &doc, error))
+		goto out;
 
 	xpathCtx = xmlXPathNewContext(doc);
 
@@ -4047,8 +4835,9 @@ static void	vmware_counters_add_new(zbx_vector_ptr_t *counters, zbx_uint64_t cou
 	counter = (zbx_vmware_perf_counter_t *)__vm_mem_malloc_func(NULL, sizeof(zbx_vmware_perf_counter_t));
 	counter->counterid = counterid;
 	counter->state = ZBX_VMWARE_COUNTER_NEW;
+	counter->instances = NULL;
 
-	zbx_vector_str_uint64_pair_create_ext(&counter->values, __vm_mem_malloc_func, __vm_mem_realloc_func,
+	zbx_vector_uint64_create_ext(&counter->values, __vm_mem_malloc_func, __vm_mem_realloc_func,
 			__vm_mem_free_func);
 
 	zbx_vector_ptr_append(counters, counter);
@@ -4142,6 +4931,10 @@ static void	vmware_service_add_perf_entity(zbx_vmware_service_t *service, const
 
 		zbx_vector_ptr_create_ext(&pentity->counters, __vm_mem_malloc_func, __vm_mem_realloc_func,
 				__vm_mem_free_func);
+		zbx_vector_str_create_ext(&pentity->instances, __vm_mem_malloc_func, __vm_mem_realloc_func,
+				__vm_mem_free_func);
+		zbx_vector_ptr_create_ext(&pentity->instancesets, __vm_mem_malloc_func, __vm_mem_realloc_func,
+				__vm_mem_free_func);
 
 		for (i = 0; NULL != counters[i]; i++)
 		{
@@ -4232,33 +5025,969 @@ static void	vmware_service_update_perf_entities(zbx_vmware_service_t *service)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() entities:%d", __func__, service->entities.num_data);
 }
 
-/******************************************************************************
- *                                                                            *
- * Function: vmware_service_update                                            *
- *                                                                            *
- * Purpose: updates object with a new data from vmware service                *
- *                                                                            *
- * Parameters: service      - [IN] the vmware service                         *
- *                                                                            *
- ******************************************************************************/
-static void	vmware_service_update(zbx_vmware_service_t *service)
-{
-	CURL			*easyhandle = NULL;
-	CURLoption		opt;
-	CURLcode		err;
-	struct curl_slist	*headers = NULL;
-	zbx_vmware_data_t	*data;
-	zbx_vector_str_t	hvs, dss;
-	zbx_vector_ptr_t	events;
-	int			i, ret = FAIL;
-	ZBX_HTTPPAGE		page;	/* 347K/87K */
-	unsigned char		skip_old = service->eventlog.skip_old;
+/* inventory object update kinds */
+#define ZBX_VMWARE_UPDATE_ENTER		0
+#define ZBX_VMWARE_UPDATE_MODIFY	1
+#define ZBX_VMWARE_UPDATE_LEAVE		2
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() '%s'@'%s'", __func__, service->username, service->url);
+/* inventory object types */
+#define ZBX_VMWARE_OBJECT_HV		0
+#define ZBX_VMWARE_OBJECT_VM		1
+#define ZBX_VMWARE_OBJECT_DS		2
 
-	data = (zbx_vmware_data_t *)zbx_malloc(NULL, sizeof(zbx_vmware_data_t));
-	memset(data, 0, sizeof(zbx_vmware_data_t));
-	page.alloc = 0;
+/* the changed virtual machine data besides properties */
+#define ZBX_VMWARE_UPDATE_DEVS		0x01
+#define ZBX_VMWARE_UPDATE_FS		0x02
+#define ZBX_VMWARE_UPDATE_UUID		0x04
+#define ZBX_VMWARE_UPDATE_HOST		0x08
+/* the change affects inventory structure and cannot be applied incrementally */
+#define ZBX_VMWARE_UPDATE_STRUCTURE	0x10
+
+/* the maximum number of objects returned by one inventory update request */
+#define ZBX_VMWARE_UPDATES_MAX		100
+
+/* the inventory object update received from property collector */
+typedef struct
+{
+	char		*id;
+	unsigned char	type;
+	unsigned char	kind;
+	unsigned char	flags;
+
+	/* the changed properties as bitmask of property map indexes */
+	zbx_uint64_t	props_mask;
+
+	/* the hypervisor properties */
+	char		**props;
+
+	/* the created virtual machine or the changed virtual machine data */
+	zbx_vmware_vm_t	*vm;
+
+	/* the hypervisor the virtual machine runs on */
+	char		*hvid;
+}
+zbx_vmware_obj_update_t;
+
+static void	vmware_obj_update_free(zbx_vmware_obj_update_t *update)
+{
+	zbx_free(update->id);
+	zbx_free(update->hvid);
+	vmware_props_free(update->props, ZBX_VMWARE_HVPROPS_NUM);
+
+	if (NULL != update->vm)
+		vmware_vm_free(update->vm);
+
+	zbx_free(update);
+}
+
+static int	vmware_obj_update_compare(const void *d1, const void *d2)
+{
+	const zbx_vmware_obj_update_t	*u1 = *(const zbx_vmware_obj_update_t * const *)d1;
+	const zbx_vmware_obj_update_t	*u2 = *(const zbx_vmware_obj_update_t * const *)d2;
+
+	return strcmp(u1->id, u2->id);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_propmap_get_pathset                                       *
+ *                                                                            *
+ * Purpose: formats property collector path set of the specified properties   *
+ *                                                                            *
+ * Parameters: propmap   - [IN] the properties                                *
+ *             props_num - [IN] the number of properties                      *
+ *                                                                            *
+ * Return value: the allocated path set                                       *
+ *                                                                            *
+ ******************************************************************************/
+static char	*vmware_propmap_get_pathset(const zbx_vmware_propmap_t *propmap, int props_num)
+{
+	char	*pathset = NULL;
+	size_t	pathset_alloc = 0, pathset_offset = 0;
+	int	i;
+
+	zbx_strcpy_alloc(&pathset, &pathset_alloc, &pathset_offset, "");
+
+	for (i = 0; i < props_num; i++)
+	{
+		zbx_snprintf_alloc(&pathset, &pathset_alloc, &pathset_offset, "<ns0:pathSet>%s</ns0:pathSet>",
+				propmap[i].name);
+	}
+
+	return pathset;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_create_update_filter                              *
+ *                                                                            *
+ * Purpose: creates property collector filter of monitored inventory          *
+ *          properties within the current session                             *
+ *                                                                            *
+ * Parameters: service    - [IN] the vmware service                           *
+ *             easyhandle - [IN] the CURL handle                              *
+ *             error      - [OUT] the error message in the case of failure    *
+ *                                                                            *
+ * Return value: SUCCEED - the operation has completed successfully           *
+ *               FAIL    - the operation has failed                           *
+ *                                                                            *
+ * Comments: The filter is destroyed together with the session.               *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_service_create_update_filter(const zbx_vmware_service_t *service, CURL *easyhandle,
+		char **error)
+{
+#	define ZBX_POST_VMWARE_CREATE_FILTER						\
+		ZBX_POST_VSPHERE_HEADER							\
+		"<ns0:CreateFilter>"							\
+			"<ns0:_this type=\"PropertyCollector\">%s</ns0:_this>"		\
+			"<ns0:spec>"							\
+				"<ns0:propSet>"						\
+					"<ns0:type>HostSystem</ns0:type>"		\
+					"<ns0:pathSet>parent</ns0:pathSet>"		\
+					"<ns0:pathSet>datastore</ns0:pathSet>"		\
+					"%s"						\
+				"</ns0:propSet>"					\
+				"<ns0:propSet>"						\
+					"<ns0:type>VirtualMachine</ns0:type>"		\
+					"<ns0:pathSet>config.hardware</ns0:pathSet>"	\
+					"<ns0:pathSet>config.uuid</ns0:pathSet>"	\
+					"<ns0:pathSet>config.instanceUuid</ns0:pathSet>"\
+					"<ns0:pathSet>guest.disk</ns0:pathSet>"		\
+					"<ns0:pathSet>runtime.host</ns0:pathSet>"	\
+					"%s"						\
+				"</ns0:propSet>"					\
+				"<ns0:propSet>"						\
+					"<ns0:type>Datastore</ns0:type>"		\
+					"<ns0:pathSet>name</ns0:pathSet>"		\
+				"</ns0:propSet>"					\
+				ZBX_POST_VMWARE_INVENTORY_OBJECTSET			\
+			"</ns0:spec>"							\
+			"<ns0:partialUpdates>false</ns0:partialUpdates>"		\
+		"</ns0:CreateFilter>"							\
+		ZBX_POST_VSPHERE_FOOTER
+
+	char	*hv_props, *vm_props, *request;
+	int	ret;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+
+	hv_props = vmware_propmap_get_pathset(hv_propmap, ZBX_VMWARE_HVPROPS_NUM);
+	vm_props = vmware_propmap_get_pathset(vm_propmap, ZBX_VMWARE_VMPROPS_NUM);
+
+	request = zbx_dsprintf(NULL, ZBX_POST_VMWARE_CREATE_FILTER,
+			vmware_service_objects[service->type].property_collector, hv_props, vm_props,
+			vmware_service_objects[service->type].root_folder);
+
+	ret = zbx_soap_post(__func__, easyhandle, request, NULL, error);
+
+	zbx_free(request);
+	zbx_free(vm_props);
+	zbx_free(hv_props);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_obj_update_create_doc                                     *
+ *                                                                            *
+ * Purpose: converts object change set into property retrieval response       *
+ *          format, so the object properties can be read with the same        *
+ *          xpaths as the data retrieved by RetrievePropertiesEx requests     *
+ *                                                                            *
+ * Parameters: xdoc  - [IN] the update response                               *
+ *             node  - [IN] the object update node                            *
+ *             names - [OUT] the changed property names                       *
+ *                                                                            *
+ * Return value: the created document                                         *
+ *                                                                            *
+ ******************************************************************************/
+static xmlDoc	*vmware_obj_update_create_doc(xmlDoc *xdoc, xmlNode *node, zbx_vector_str_t *names)
+{
+	xmlDoc	*doc;
+	xmlNode	*objects, *propset, *change, *child;
+	char	*name;
+
+	doc = xmlNewDoc((const xmlChar *)"1.0");
+	objects = xmlNewNode(NULL, (const xmlChar *)"Envelope");
+	xmlDocSetRootElement(doc, objects);
+	objects = xmlNewChild(objects, NULL, (const xmlChar *)"Body", NULL);
+	objects = xmlNewChild(objects, NULL, (const xmlChar *)"RetrievePropertiesExResponse", NULL);
+	objects = xmlNewChild(objects, NULL, (const xmlChar *)"returnval", NULL);
+	objects = xmlNewChild(objects, NULL, (const xmlChar *)"objects", NULL);
+
+	for (change = node->children; NULL != change; change = change->next)
+	{
+		if (XML_ELEMENT_NODE != change->type || 0 != xmlStrcmp(change->name, (const xmlChar *)"changeSet"))
+			continue;
+
+		if (NULL == (name = zbx_xml_read_node_value(xdoc, change, "*[local-name()='name']")))
+			continue;
+
+		propset = xmlNewChild(objects, NULL, (const xmlChar *)"propSet", NULL);
+		xmlNewTextChild(propset, NULL, (const xmlChar *)"name", (const xmlChar *)name);
+
+		/* removed properties have no value */
+		for (child = change->children; NULL != child; child = child->next)
+		{
+			if (XML_ELEMENT_NODE == child->type && 0 == xmlStrcmp(child->name, (const xmlChar *)"val"))
+				xmlAddChild(propset, xmlDocCopyNode(child, doc, 1));
+		}
+
+		zbx_vector_str_append(names, name);
+	}
+
+	return doc;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_propmap_get_mask                                          *
+ *                                                                            *
+ * Purpose: gets bitmask of the properties present in the property names      *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_uint64_t	vmware_propmap_get_mask(const zbx_vmware_propmap_t *propmap, int props_num,
+		const zbx_vector_str_t *names)
+{
+	zbx_uint64_t	mask = 0;
+	int		i;
+
+	for (i = 0; i < props_num; i++)
+	{
+		if (FAIL != zbx_vector_str_search(names, propmap[i].name, ZBX_DEFAULT_STR_COMPARE_FUNC))
+			mask |= __UINT64_C(1) << i;
+	}
+
+	return mask;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_parse_obj_update                                  *
+ *                                                                            *
+ * Purpose: parses inventory object update                                    *
+ *                                                                            *
+ * Parameters: service - [IN] the vmware service                              *
+ *             xdoc    - [IN] the update response                             *
+ *             node    - [IN] the object update node                          *
+ *                                                                            *
+ * Return value: the parsed object update or NULL if the object is not        *
+ *               monitored                                                    *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_vmware_obj_update_t	*vmware_service_parse_obj_update(const zbx_vmware_service_t *service,
+		xmlDoc *xdoc, xmlNode *node)
+{
+	const char		*uuid_props[3] = {NULL, "config.uuid", "config.instanceUuid"};
+	const char		*uuid_xpath[3] = {NULL, ZBX_XPATH_VM_UUID(), ZBX_XPATH_VM_INSTANCE_UUID()};
+	zbx_vmware_obj_update_t	*update = NULL;
+	zbx_vmware_vm_t		*vm;
+	char			*kind = NULL, *type = NULL;
+	xmlDoc			*props = NULL;
+	zbx_vector_str_t	names;
+
+	zbx_vector_str_create(&names);
+
+	if (NULL == (kind = zbx_xml_read_node_value(xdoc, node, "*[local-name()='kind']")) ||
+			NULL == (type = zbx_xml_read_node_value(xdoc, node, "*[local-name()='obj']/@type")))
+	{
+		goto out;
+	}
+
+	update = (zbx_vmware_obj_update_t *)zbx_malloc(NULL, sizeof(zbx_vmware_obj_update_t));
+	memset(update, 0, sizeof(zbx_vmware_obj_update_t));
+
+	if (0 == strcmp(type, "HostSystem"))
+		update->type = ZBX_VMWARE_OBJECT_HV;
+	else if (0 == strcmp(type, "VirtualMachine"))
+		update->type = ZBX_VMWARE_OBJECT_VM;
+	else if (0 == strcmp(type, "Datastore"))
+		update->type = ZBX_VMWARE_OBJECT_DS;
+	else
+		goto fail;
+
+	if (0 == strcmp(kind, "enter"))
+		update->kind = ZBX_VMWARE_UPDATE_ENTER;
+	else if (0 == strcmp(kind, "modify"))
+		update->kind = ZBX_VMWARE_UPDATE_MODIFY;
+	else if (0 == strcmp(kind, "leave"))
+		update->kind = ZBX_VMWARE_UPDATE_LEAVE;
+	else
+		goto fail;
+
+	if (NULL == (update->id = zbx_xml_read_node_value(xdoc, node, "*[local-name()='obj']")))
+		goto fail;
+
+	/* datastore list and hypervisor list changes are applied by full update */
+	if (ZBX_VMWARE_OBJECT_DS == update->type ||
+			(ZBX_VMWARE_OBJECT_HV == update->type && ZBX_VMWARE_UPDATE_MODIFY != update->kind))
+	{
+		update->flags |= ZBX_VMWARE_UPDATE_STRUCTURE;
+		goto out;
+	}
+
+	if (ZBX_VMWARE_UPDATE_LEAVE == update->kind)
+		goto out;
+
+	props = vmware_obj_update_create_doc(xdoc, node, &names);
+
+	if (ZBX_VMWARE_OBJECT_HV == update->type)
+	{
+		update->props_mask = vmware_propmap_get_mask(hv_propmap, ZBX_VMWARE_HVPROPS_NUM, &names);
+
+		if (0 != (update->props_mask & (__UINT64_C(1) << ZBX_VMWARE_HVPROP_HW_UUID)) ||
+				FAIL != zbx_vector_str_search(&names, "parent", ZBX_DEFAULT_STR_COMPARE_FUNC) ||
+				FAIL != zbx_vector_str_search(&names, "datastore", ZBX_DEFAULT_STR_COMPARE_FUNC))
+		{
+			update->flags |= ZBX_VMWARE_UPDATE_STRUCTURE;
+		}
+
+		update->props = xml_read_props(props, hv_propmap, ZBX_VMWARE_HVPROPS_NUM);
+		goto out;
+	}
+
+	update->props_mask = vmware_propmap_get_mask(vm_propmap, ZBX_VMWARE_VMPROPS_NUM, &names);
+
+	if (FAIL != zbx_vector_str_search(&names, "config.hardware", ZBX_DEFAULT_STR_COMPARE_FUNC))
+		update->flags |= ZBX_VMWARE_UPDATE_DEVS;
+
+	if (FAIL != zbx_vector_str_search(&names, "guest.disk", ZBX_DEFAULT_STR_COMPARE_FUNC))
+		update->flags |= ZBX_VMWARE_UPDATE_FS;
+
+	if (FAIL != zbx_vector_str_search(&names, uuid_props[service->type], ZBX_DEFAULT_STR_COMPARE_FUNC))
+		update->flags |= ZBX_VMWARE_UPDATE_UUID;
+
+	if (FAIL != zbx_vector_str_search(&names, "runtime.host", ZBX_DEFAULT_STR_COMPARE_FUNC))
+		update->flags |= ZBX_VMWARE_UPDATE_HOST;
+
+	update->hvid = zbx_xml_read_doc_value(props, ZBX_XPATH_PROP_NAME("runtime.host"));
+
+	if (ZBX_VMWARE_UPDATE_ENTER == update->kind)
+	{
+		if (NULL == (update->vm = vmware_service_create_vm(service, update->id, props)))
+			goto fail;
+
+		goto out;
+	}
+
+	vm = (zbx_vmware_vm_t *)zbx_malloc(NULL, sizeof(zbx_vmware_vm_t));
+	memset(vm, 0, sizeof(zbx_vmware_vm_t));
+	zbx_vector_ptr_create(&vm->devs);
+	zbx_vector_ptr_create(&vm->file_systems);
+	update->vm = vm;
+
+	vm->id = zbx_strdup(NULL, update->id);
+	vm->props = xml_read_props(props, vm_propmap, ZBX_VMWARE_VMPROPS_NUM);
+
+	if (0 != (update->flags & ZBX_VMWARE_UPDATE_DEVS))
+	{
+		vmware_vm_get_nic_devices(vm, props);
+		vmware_vm_get_disk_devices(vm, props);
+	}
+
+	if (0 != (update->flags & ZBX_VMWARE_UPDATE_FS))
+		vmware_vm_get_file_systems(vm, props);
+
+	/* virtual machines without uuid are not monitored */
+	if (0 != (update->flags & ZBX_VMWARE_UPDATE_UUID) &&
+			NULL == (vm->uuid = zbx_xml_read_doc_value(props, uuid_xpath[service->type])))
+	{
+		update->kind = ZBX_VMWARE_UPDATE_LEAVE;
+	}
+
+	goto out;
+fail:
+	vmware_obj_update_free(update);
+	update = NULL;
+out:
+	zbx_xml_free_doc(props);
+	zbx_vector_str_clear_ext(&names, zbx_str_free);
+	zbx_vector_str_destroy(&names);
+	zbx_free(type);
+	zbx_free(kind);
+
+	return update;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_parse_updates                                     *
+ *                                                                            *
+ * Purpose: parses WaitForUpdatesEx response                                  *
+ *                                                                            *
+ * Parameters: service   - [IN] the vmware service                            *
+ *             xdoc      - [IN] the update response                           *
+ *             updates   - [OUT] the object updates in the order received     *
+ *             version   - [OUT] the data version after the updates           *
+ *             truncated - [OUT] 1 if more updates are available, 0 otherwise *
+ *                                                                            *
+ * Return value: SUCCEED - the response contains updates                      *
+ *               FAIL    - the response is empty (there were no changes)      *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_service_parse_updates(const zbx_vmware_service_t *service, xmlDoc *xdoc,
+		zbx_vector_ptr_t *updates, char **version, int *truncated)
+{
+#	define ZBX_XPATH_UPDATE_VERSION()						\
+		"/*/*/*/*/*[local-name()='version']"
+
+#	define ZBX_XPATH_UPDATE_TRUNCATED()						\
+		"/*/*/*/*/*[local-name()='truncated']"
+
+#	define ZBX_XPATH_UPDATE_OBJECTS()						\
+		"/*/*/*/*/*[local-name()='filterSet']/*[local-name()='objectSet']"
+
+	xmlXPathContext		*xpathCtx;
+	xmlXPathObject		*xpathObj;
+	zbx_vmware_obj_update_t	*update;
+	char			*value;
+	int			i;
+
+	if (NULL == (value = zbx_xml_read_doc_value(xdoc, ZBX_XPATH_UPDATE_VERSION())))
+		return FAIL;
+
+	zbx_free(*version);
+	*version = value;
+
+	*truncated = 0;
+
+	if (NULL != (value = zbx_xml_read_doc_value(xdoc, ZBX_XPATH_UPDATE_TRUNCATED())))
+	{
+		*truncated = (0 == strcmp(value, "true"));
+		zbx_free(value);
+	}
+
+	xpathCtx = xmlXPathNewContext(xdoc);
+
+	if (NULL != (xpathObj = xmlXPathEvalExpression((const xmlChar *)ZBX_XPATH_UPDATE_OBJECTS(), xpathCtx)))
+	{
+		if (0 == xmlXPathNodeSetIsEmpty(xpathObj->nodesetval))
+		{
+			for (i = 0; i < xpathObj->nodesetval->nodeNr; i++)
+			{
+				if (NULL != (update = vmware_service_parse_obj_update(service, xdoc,
+						xpathObj->nodesetval->nodeTab[i])))
+				{
+					zbx_vector_ptr_append(updates, update);
+				}
+			}
+		}
+
+		xmlXPathFreeObject(xpathObj);
+	}
+
+	xmlXPathFreeContext(xpathCtx);
+
+	return SUCCEED;
+
+#	undef ZBX_XPATH_UPDATE_VERSION
+#	undef ZBX_XPATH_UPDATE_TRUNCATED
+#	undef ZBX_XPATH_UPDATE_OBJECTS
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_get_updates                                       *
+ *                                                                            *
+ * Purpose: retrieves inventory changes since the specified version of        *
+ *          property collector filter data                                    *
+ *                                                                            *
+ * Parameters: service     - [IN] the vmware service                          *
+ *             easyhandle  - [IN] the CURL handle                             *
+ *             version     - [IN] the data version, empty string to retrieve  *
+ *                                all monitored objects                       *
+ *             updates     - [OUT] the object updates in the order received   *
+ *             new_version - [OUT] the data version after the updates         *
+ *             error       - [OUT] the error message in the case of failure   *
+ *                                                                            *
+ * Return value: SUCCEED - the operation has completed successfully           *
+ *               FAIL    - the operation has failed                           *
+ *                                                                            *
+ * Comments: Unlike QueryPerf and event history the responses are parsed as   *
+ *           documents, because object updates are read with property XPath   *
+ *           helpers shared with the full inventory queries. The document     *
+ *           size is bounded by maxObjectUpdates - one response holds at most *
+ *           ZBX_VMWARE_UPDATES_MAX changed objects with the same properties  *
+ *           as the inventory queries retrieve per object, and the rest is    *
+ *           requested while the response is truncated.                       *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_service_get_updates(const zbx_vmware_service_t *service, CURL *easyhandle,
+		const char *version, zbx_vector_ptr_t *updates, char **new_version, char **error)
+{
+#	define ZBX_POST_VMWARE_WAIT_FOR_UPDATES						\
+		ZBX_POST_VSPHERE_HEADER							\
+		"<ns0:WaitForUpdatesEx>"						\
+			"<ns0:_this type=\"PropertyCollector\">%s</ns0:_this>"		\
+			"<ns0:version>%s</ns0:version>"					\
+			"<ns0:options>"							\
+				"<ns0:maxWaitSeconds>0</ns0:maxWaitSeconds>"		\
+				"<ns0:maxObjectUpdates>%d</ns0:maxObjectUpdates>"	\
+			"</ns0:options>"						\
+		"</ns0:WaitForUpdatesEx>"						\
+		ZBX_POST_VSPHERE_FOOTER
+
+	char	tmp[MAX_STRING_LEN], *version_esc;
+	xmlDoc	*doc = NULL;
+	int	truncated, ret = FAIL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() version:'%s'", __func__, version);
+
+	*new_version = zbx_strdup(NULL, version);
+
+	do
+	{
+		version_esc = xml_escape_dyn(*new_version);
+		zbx_snprintf(tmp, sizeof(tmp), ZBX_POST_VMWARE_WAIT_FOR_UPDATES,
+				vmware_service_objects[service->type].property_collector, version_esc,
+				ZBX_VMWARE_UPDATES_MAX);
+		zbx_free(version_esc);
+
+		if (SUCCEED != zbx_soap_post(__func__, easyhandle, tmp, &doc, error))
+			goto out;
+
+		/* the response is empty if there were no changes */
+		if (SUCCEED != vmware_service_parse_updates(service, doc, updates, new_version, &truncated))
+			break;
+
+		zbx_xml_free_doc(doc);
+		doc = NULL;
+	}
+	while (0 != truncated);
+
+	ret = SUCCEED;
+out:
+	zbx_xml_free_doc(doc);
+
+	if (SUCCEED != ret)
+		zbx_free(*new_version);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s updates:%d", __func__, zbx_result_string(ret),
+			updates->values_num);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_obj_updates_incremental                                   *
+ *                                                                            *
+ * Purpose: checks if inventory changes can be applied to the shared          *
+ *          inventory in place                                                *
+ *                                                                            *
+ * Return value: SUCCEED - the changes can be applied incrementally           *
+ *               FAIL    - the inventory structure has changed and requires   *
+ *                         full update                                        *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_obj_updates_incremental(const zbx_vector_ptr_t *updates)
+{
+	int	i;
+
+	for (i = 0; i < updates->values_num; i++)
+	{
+		if (0 != (((const zbx_vmware_obj_update_t *)updates->values[i])->flags & ZBX_VMWARE_UPDATE_STRUCTURE))
+			return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_take_dump_vm                                      *
+ *                                                                            *
+ * Purpose: takes virtual machine from the initial inventory dump             *
+ *                                                                            *
+ * Parameters: dump - [IN/OUT] the object updates sorted by object ids        *
+ *             vmid - [IN] the virtual machine id                             *
+ *                                                                            *
+ * Return value: the virtual machine or NULL if the virtual machine was not   *
+ *               found or changed while the inventory was being dumped        *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_vmware_vm_t	*vmware_service_take_dump_vm(zbx_vector_ptr_t *dump, const char *vmid)
+{
+	zbx_vmware_obj_update_t	update_local, *update = &update_local;
+	zbx_vmware_vm_t		*vm;
+	int			i;
+
+	update_local.id = (char *)vmid;
+
+	if (FAIL == (i = zbx_vector_ptr_bsearch(dump, update, vmware_obj_update_compare)))
+		return NULL;
+
+	/* objects changed during the dump are retrieved separately */
+	if ((0 < i && 0 == vmware_obj_update_compare(&dump->values[i - 1], &update)) ||
+			(i + 1 < dump->values_num && 0 == vmware_obj_update_compare(&dump->values[i + 1], &update)))
+	{
+		return NULL;
+	}
+
+	update = (zbx_vmware_obj_update_t *)dump->values[i];
+
+	if (ZBX_VMWARE_OBJECT_VM != update->type || ZBX_VMWARE_UPDATE_ENTER != update->kind)
+		return NULL;
+
+	vm = update->vm;
+	update->vm = NULL;
+
+	return vm;
+}
+
+/* the virtual machine reference in shared inventory */
+typedef struct
+{
+	const char	*id;
+	zbx_vmware_hv_t	*hv;
+	zbx_vmware_vm_t	*vm;
+}
+zbx_vmware_vm_ref_t;
+
+static zbx_hash_t	vmware_vm_ref_hash(const void *data)
+{
+	const zbx_vmware_vm_ref_t	*ref = (const zbx_vmware_vm_ref_t *)data;
+
+	return ZBX_DEFAULT_STRING_HASH_ALGO(ref->id, strlen(ref->id), ZBX_DEFAULT_HASH_SEED);
+}
+
+static int	vmware_vm_ref_compare(const void *d1, const void *d2)
+{
+	const zbx_vmware_vm_ref_t	*ref1 = (const zbx_vmware_vm_ref_t *)d1;
+	const zbx_vmware_vm_ref_t	*ref2 = (const zbx_vmware_vm_ref_t *)d2;
+
+	return strcmp(ref1->id, ref2->id);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_data_shared_find_hv                                       *
+ *                                                                            *
+ * Purpose: finds hypervisor in shared inventory by its id                    *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_vmware_hv_t	*vmware_data_shared_find_hv(zbx_vmware_data_t *data, const char *id)
+{
+	zbx_hashset_iter_t	iter;
+	zbx_vmware_hv_t		*hv;
+
+	if (NULL == id)
+		return NULL;
+
+	zbx_hashset_iter_reset(&data->hvs, &iter);
+	while (NULL != (hv = (zbx_vmware_hv_t *)zbx_hashset_iter_next(&iter)))
+	{
+		if (0 == strcmp(hv->id, id))
+			return hv;
+	}
+
+	return NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_data_shared_remove_vm                                     *
+ *                                                                            *
+ * Purpose: removes virtual machine from shared inventory                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_data_shared_remove_vm(zbx_vmware_data_t *data, zbx_hashset_t *vms, zbx_vmware_vm_ref_t *ref)
+{
+	zbx_vmware_vm_index_t	vmi_local = {ref->vm, ref->hv};
+	zbx_vmware_vm_t		*vm = ref->vm;
+	int			i;
+
+	if (FAIL != (i = zbx_vector_ptr_search(&ref->hv->vms, vm, ZBX_DEFAULT_PTR_COMPARE_FUNC)))
+		zbx_vector_ptr_remove(&ref->hv->vms, i);
+
+	zbx_hashset_remove(&data->vms_index, &vmi_local);
+	zbx_hashset_remove_direct(vms, ref);
+	vmware_vm_shared_free(vm);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_data_shared_add_vm                                        *
+ *                                                                            *
+ * Purpose: adds virtual machine to shared inventory                          *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_data_shared_add_vm(zbx_vmware_data_t *data, zbx_hashset_t *vms, zbx_vmware_hv_t *hv,
+		const zbx_vmware_vm_t *src)
+{
+	zbx_vmware_vm_index_t	vmi_local;
+	zbx_vmware_vm_ref_t	ref_local;
+
+	vmi_local.vm = vmware_vm_shared_dup(src);
+	vmi_local.hv = hv;
+
+	zbx_vector_ptr_append(&hv->vms, vmi_local.vm);
+	zbx_hashset_insert(&data->vms_index, &vmi_local, sizeof(vmi_local));
+
+	ref_local.id = vmi_local.vm->id;
+	ref_local.hv = hv;
+	ref_local.vm = vmi_local.vm;
+	zbx_hashset_insert(vms, &ref_local, sizeof(ref_local));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_props_shared_patch                                        *
+ *                                                                            *
+ * Purpose: replaces the changed properties in shared properties list         *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_props_shared_patch(char **dst, char **src, int props_num, zbx_uint64_t mask)
+{
+	int	i;
+
+	for (i = 0; i < props_num; i++)
+	{
+		if (0 == (mask & (__UINT64_C(1) << i)))
+			continue;
+
+		if (NULL != dst[i])
+			vmware_shared_strfree(dst[i]);
+
+		dst[i] = vmware_shared_strdup(src[i]);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_data_shared_modify_vm                                     *
+ *                                                                            *
+ * Purpose: applies virtual machine changes to shared inventory               *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_data_shared_modify_vm(zbx_vmware_data_t *data, zbx_hashset_t *vms, zbx_vmware_vm_ref_t *ref,
+		const zbx_vmware_obj_update_t *update)
+{
+	zbx_vmware_vm_t	*vm = ref->vm;
+	int		i;
+
+	vmware_props_shared_patch(vm->props, update->vm->props, ZBX_VMWARE_VMPROPS_NUM, update->props_mask);
+
+	if (0 != (update->flags & ZBX_VMWARE_UPDATE_DEVS))
+	{
+		zbx_vector_ptr_clear_ext(&vm->devs, (zbx_clean_func_t)vmware_dev_shared_free);
+
+		for (i = 0; i < update->vm->devs.values_num; i++)
+		{
+			zbx_vector_ptr_append(&vm->devs,
+					vmware_dev_shared_dup((zbx_vmware_dev_t *)update->vm->devs.values[i]));
+		}
+	}
+
+	if (0 != (update->flags & ZBX_VMWARE_UPDATE_FS))
+	{
+		zbx_vector_ptr_clear_ext(&vm->file_systems, (zbx_clean_func_t)vmware_fs_shared_free);
+
+		for (i = 0; i < update->vm->file_systems.values_num; i++)
+		{
+			zbx_vector_ptr_append(&vm->file_systems,
+					vmware_fs_shared_dup((zbx_vmware_fs_t *)update->vm->file_systems.values[i]));
+		}
+	}
+
+	if (0 != (update->flags & ZBX_VMWARE_UPDATE_UUID) && 0 != strcmp(vm->uuid, update->vm->uuid))
+	{
+		zbx_vmware_vm_index_t	vmi_local = {vm, ref->hv};
+
+		zbx_hashset_remove(&data->vms_index, &vmi_local);
+		vmware_shared_strfree(vm->uuid);
+		vm->uuid = vmware_shared_strdup(update->vm->uuid);
+		zbx_hashset_insert(&data->vms_index, &vmi_local, sizeof(vmi_local));
+	}
+
+	if (0 != (update->flags & ZBX_VMWARE_UPDATE_HOST) && NULL != update->hvid &&
+			0 != strcmp(ref->hv->id, update->hvid))
+	{
+		zbx_vmware_vm_index_t	vmi_local = {vm, NULL}, *vmi;
+		zbx_vmware_hv_t		*hv;
+
+		/* virtual machines are monitored only on the known hypervisors */
+		if (NULL == (hv = vmware_data_shared_find_hv(data, update->hvid)))
+		{
+			vmware_data_shared_remove_vm(data, vms, ref);
+			return;
+		}
+
+		if (FAIL != (i = zbx_vector_ptr_search(&ref->hv->vms, vm, ZBX_DEFAULT_PTR_COMPARE_FUNC)))
+			zbx_vector_ptr_remove(&ref->hv->vms, i);
+
+		zbx_vector_ptr_append(&hv->vms, vm);
+
+		if (NULL != (vmi = (zbx_vmware_vm_index_t *)zbx_hashset_search(&data->vms_index, &vmi_local)))
+			vmi->hv = hv;
+
+		ref->hv = hv;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_data_shared_update                                        *
+ *                                                                            *
+ * Purpose: applies inventory changes to the vmware service data in shared    *
+ *          memory                                                            *
+ *                                                                            *
+ * Parameters: data    - [IN/OUT] the shared vmware service data              *
+ *             src     - [IN] the new datastores, clusters, events and error  *
+ *             updates - [IN] the hypervisor and virtual machine changes      *
+ *                                                                            *
+ * Comments: Datastore, cluster and event data is replaced while hypervisors  *
+ *           and virtual machines are patched in place.                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_data_shared_update(zbx_vmware_data_t *data, zbx_vmware_data_t *src,
+		const zbx_vector_ptr_t *updates)
+{
+	zbx_hashset_t		vms;
+	zbx_hashset_iter_t	iter;
+	zbx_vmware_hv_t		*hv;
+	zbx_vmware_vm_ref_t	ref_local, *ref;
+	int			i, j, k;
+
+	/* datastore hypervisor lists do not change without structure changes, which require full update */
+	for (i = 0; i < src->datastores.values_num; i++)
+	{
+		zbx_vmware_datastore_t	*ds = src->datastores.values[i];
+
+		for (j = 0; j < data->datastores.values_num; j++)
+		{
+			zbx_vmware_datastore_t	*ds_old = data->datastores.values[j];
+
+			if (0 != strcmp(ds->id, ds_old->id))
+				continue;
+
+			for (k = 0; k < ds_old->hv_uuids.values_num; k++)
+				zbx_vector_str_append(&ds->hv_uuids, zbx_strdup(NULL, ds_old->hv_uuids.values[k]));
+
+			break;
+		}
+	}
+
+	zbx_vector_vmware_datastore_clear_ext(&data->datastores, vmware_datastore_shared_free);
+
+	for (i = 0; i < src->datastores.values_num; i++)
+	{
+		zbx_vector_vmware_datastore_append(&data->datastores,
+				vmware_datastore_shared_dup(src->datastores.values[i]));
+	}
+
+	zbx_vector_ptr_clear_ext(&data->clusters, (zbx_clean_func_t)vmware_cluster_shared_free);
+
+	for (i = 0; i < src->clusters.values_num; i++)
+	{
+		zbx_vector_ptr_append(&data->clusters,
+				vmware_cluster_shared_dup((zbx_vmware_cluster_t *)src->clusters.values[i]));
+	}
+
+	zbx_vector_ptr_clear_ext(&data->events, (zbx_clean_func_t)vmware_event_shared_free);
+
+	for (i = 0; i < src->events.values_num; i++)
+	{
+		zbx_vector_ptr_append(&data->events,
+				vmware_event_shared_dup((zbx_vmware_event_t *)src->events.values[i]));
+	}
+
+	if (NULL != data->error)
+		vmware_shared_strfree(data->error);
+
+	data->error = vmware_shared_strdup(src->error);
+	data->max_query_metrics = src->max_query_metrics;
+
+	if (0 == updates->values_num)
+		return;
+
+	zbx_hashset_create(&vms, data->vms_index.num_data, vmware_vm_ref_hash, vmware_vm_ref_compare);
+
+	zbx_hashset_iter_reset(&data->hvs, &iter);
+	while (NULL != (hv = (zbx_vmware_hv_t *)zbx_hashset_iter_next(&iter)))
+	{
+		for (i = 0; i < hv->vms.values_num; i++)
+		{
+			ref_local.vm = (zbx_vmware_vm_t *)hv->vms.values[i];
+			ref_local.id = ref_local.vm->id;
+			ref_local.hv = hv;
+			zbx_hashset_insert(&vms, &ref_local, sizeof(ref_local));
+		}
+	}
+
+	for (i = 0; i < updates->values_num; i++)
+	{
+		const zbx_vmware_obj_update_t	*update = (const zbx_vmware_obj_update_t *)updates->values[i];
+
+		if (ZBX_VMWARE_OBJECT_HV == update->type)
+		{
+			if (NULL != (hv = vmware_data_shared_find_hv(data, update->id)))
+			{
+				vmware_props_shared_patch(hv->props, update->props, ZBX_VMWARE_HVPROPS_NUM,
+						update->props_mask);
+			}
+
+			continue;
+		}
+
+		ref_local.id = update->id;
+		ref = (zbx_vmware_vm_ref_t *)zbx_hashset_search(&vms, &ref_local);
+
+		switch (update->kind)
+		{
+			case ZBX_VMWARE_UPDATE_ENTER:
+				if (NULL != ref)
+					vmware_data_shared_remove_vm(data, &vms, ref);
+
+				if (NULL != (hv = vmware_data_shared_find_hv(data, update->hvid)))
+					vmware_data_shared_add_vm(data, &vms, hv, update->vm);
+				break;
+			case ZBX_VMWARE_UPDATE_MODIFY:
+				if (NULL != ref)
+					vmware_data_shared_modify_vm(data, &vms, ref, update);
+				break;
+			case ZBX_VMWARE_UPDATE_LEAVE:
+				if (NULL != ref)
+					vmware_data_shared_remove_vm(data, &vms, ref);
+				break;
+		}
+	}
+
+	zbx_hashset_destroy(&vms);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_update                                            *
+ *                                                                            *
+ * Purpose: updates object with a new data from vmware service                *
+ *                                                                            *
+ * Parameters: service      - [IN] the vmware service                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_service_update(zbx_vmware_service_t *service)
+{
+	CURL			*easyhandle = NULL;
+	CURLoption		opt;
+	CURLcode		err;
+	struct curl_slist	*headers = NULL;
+	zbx_vmware_data_t	*data;
+	zbx_vector_str_t	hvs, dss, vms;
+	zbx_vector_ptr_t	events, vm_jobs, updates;
+	int			i, incremental = 0, ret = FAIL;
+	ZBX_HTTPPAGE		page;	/* 347K/87K */
+	unsigned char		skip_old = service->eventlog.skip_old;
+	char			*session = NULL, *version = NULL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() '%s'@'%s'", __func__, service->username, service->url);
+
+	data = (zbx_vmware_data_t *)zbx_malloc(NULL, sizeof(zbx_vmware_data_t));
+	memset(data, 0, sizeof(zbx_vmware_data_t));
+	page.alloc = 0;
 
 	zbx_hashset_create(&data->hvs, 1, vmware_hv_hash, vmware_hv_compare);
 	zbx_vector_ptr_create(&data->clusters);
@@ -4267,6 +5996,9 @@ static void	vmware_service_update(zbx_vmware_service_t *service)
 
 	zbx_vector_str_create(&hvs);
 	zbx_vector_str_create(&dss);
+	zbx_vector_str_create(&vms);
+	zbx_vector_ptr_create(&vm_jobs);
+	zbx_vector_ptr_create(&updates);
 
 	if (NULL == (easyhandle = curl_easy_init()))
 	{
@@ -4286,13 +6018,50 @@ static void	vmware_service_update(zbx_vmware_service_t *service)
 		goto clean;
 	}
 
-	if (SUCCEED != vmware_service_authenticate(service, easyhandle, &page, &data->error))
-		goto clean;
+	/* the inventory changes are retrieved within the session kept since the previous update */
+	if (NULL != service->session)
+	{
+		char	*error = NULL;
+
+		session = zbx_strdup(NULL, service->session);
+
+		if (SUCCEED == vmware_service_resume_session(service, easyhandle, &page, session, &error) &&
+				NULL != service->update_version &&
+				SUCCEED == vmware_service_get_updates(service, easyhandle, service->update_version,
+				&updates, &version, &error))
+		{
+			incremental = (SUCCEED == vmware_obj_updates_incremental(&updates));
+		}
+
+		if (0 == incremental)
+		{
+			if (NULL != error)
+				zabbix_log(LOG_LEVEL_DEBUG, "Cannot retrieve vmware inventory updates: %s", error);
+			else
+				zabbix_log(LOG_LEVEL_DEBUG, "vmware inventory structure has changed");
+
+			if (SUCCEED != vmware_service_logout(service, easyhandle, &error))
+				zabbix_log(LOG_LEVEL_DEBUG, "Cannot close vmware connection: %s.", error);
+
+			curl_easy_setopt(easyhandle, CURLOPT_COOKIELIST, "ALL");
+			zbx_vector_ptr_clear_ext(&updates, (zbx_clean_func_t)vmware_obj_update_free);
+			zbx_free(version);
+			zbx_free(session);
+		}
+
+		zbx_free(error);
+	}
 
-	if (0 != (service->state & ZBX_VMWARE_STATE_NEW) &&
-			SUCCEED != vmware_service_initialize(service, easyhandle, &data->error))
+	if (0 == incremental)
 	{
-		goto clean;
+		if (SUCCEED != vmware_service_authenticate(service, easyhandle, &page, &data->error))
+			goto clean;
+
+		if (0 != (service->state & ZBX_VMWARE_STATE_NEW) &&
+				SUCCEED != vmware_service_initialize(service, easyhandle, &data->error))
+		{
+			goto clean;
+		}
 	}
 
 	if (SUCCEED != vmware_service_get_hv_ds_list(service, easyhandle, &hvs, &dss, &data->error))
@@ -4310,23 +6079,69 @@ static void	vmware_service_update(zbx_vmware_service_t *service)
 
 	zbx_vector_vmware_datastore_sort(&data->datastores, vmware_ds_id_compare);
 
+	/* hypervisors and virtual machines are patched with the retrieved changes */
+	if (0 != incremental)
+		goto datastores;
+
 	if (SUCCEED != zbx_hashset_reserve(&data->hvs, hvs.values_num))
 	{
 		THIS_SHOULD_NEVER_HAPPEN;
 		exit(EXIT_FAILURE);
 	}
 
+	/* the initial inventory dump of new session provides virtual machine data and the base version */
+	/* for the next incremental updates                                                             */
+	if (SUCCEED == vmware_service_create_update_filter(service, easyhandle, &data->error) &&
+			SUCCEED == vmware_service_get_updates(service, easyhandle, "", &updates, &version, &data->error))
+	{
+		zbx_vector_ptr_sort(&updates, vmware_obj_update_compare);
+	}
+	else
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "Cannot retrieve vmware inventory updates: %s", data->error);
+		zbx_free(data->error);
+		zbx_vector_ptr_clear_ext(&updates, (zbx_clean_func_t)vmware_obj_update_free);
+	}
+
 	for (i = 0; i < hvs.values_num; i++)
 	{
-		zbx_vmware_hv_t	hv_local;
+		zbx_vmware_hv_t		hv_local, *hv;
+		zbx_vmware_vm_job_t	*job;
+		int			j;
+
+		if (SUCCEED != vmware_service_init_hv(service, easyhandle, hvs.values[i], &data->datastores, &hv_local,
+				&vms, &data->error))
+		{
+			continue;
+		}
+
+		hv = (zbx_vmware_hv_t *)zbx_hashset_insert(&data->hvs, &hv_local, sizeof(hv_local));
 
-		if (SUCCEED == vmware_service_init_hv(service, easyhandle, hvs.values[i], &data->datastores, &hv_local,
-				&data->error))
+		for (j = 0; j < vms.values_num; j++)
 		{
-			zbx_hashset_insert(&data->hvs, &hv_local, sizeof(hv_local));
+			job = (zbx_vmware_vm_job_t *)zbx_malloc(NULL, sizeof(zbx_vmware_vm_job_t));
+			memset(job, 0, sizeof(zbx_vmware_vm_job_t));
+
+			job->service = service;
+			job->hv = hv;
+			job->id = vms.values[j];
+
+			if (NULL == (job->vm = vmware_service_take_dump_vm(&updates, job->id)))
+			{
+				job->request = vmware_service_get_vm_request(service, job->id, vm_propmap,
+						ZBX_VMWARE_VMPROPS_NUM);
+			}
+
+			zbx_vector_ptr_append(&vm_jobs, job);
 		}
+
+		zbx_vector_str_clear(&vms);
 	}
 
+	/* virtual machines of all hypervisors are retrieved with parallel requests */
+	vmware_service_create_vms(easyhandle, &vm_jobs, &data->error);
+	zbx_vector_ptr_clear_ext(&updates, (zbx_clean_func_t)vmware_obj_update_free);
+datastores:
 	for (i = 0; i < data->datastores.values_num; i++)
 	{
 		zbx_vector_str_sort(&data->datastores.values[i]->hv_uuids, ZBX_DEFAULT_STR_COMPARE_FUNC);
@@ -4366,7 +6181,11 @@ static void	vmware_service_update(zbx_vmware_service_t *service)
 	else if (SUCCEED != vmware_service_get_maxquerymetrics(easyhandle, &data->max_query_metrics, &data->error))
 		goto clean;
 
-	if (SUCCEED != vmware_service_logout(service, easyhandle, &data->error))
+	/* the session is kept open for incremental updates if the update version was retrieved */
+	if (0 == incremental && NULL != version)
+		session = vmware_service_get_session(easyhandle);
+
+	if (NULL == session && SUCCEED != vmware_service_logout(service, easyhandle, &data->error))
 	{
 		zabbix_log(LOG_LEVEL_DEBUG, "Cannot close vmware connection: %s.", data->error);
 		zbx_free(data->error);
@@ -4383,9 +6202,30 @@ clean:
 	zbx_vector_str_clear_ext(&dss, zbx_str_free);
 	zbx_vector_str_destroy(&dss);
 out:
+	zbx_vector_str_destroy(&vms);
+	zbx_vector_ptr_clear_ext(&vm_jobs, (zbx_clean_func_t)vmware_vm_job_free);
+	zbx_vector_ptr_destroy(&vm_jobs);
+
 	zbx_vector_ptr_create(&events);
 	zbx_vmware_lock();
 
+	if (NULL != service->session)
+		vmware_shared_strfree(service->session);
+
+	if (NULL != service->update_version)
+		vmware_shared_strfree(service->update_version);
+
+	if (SUCCEED == ret && NULL != session && NULL != version)
+	{
+		service->session = vmware_shared_strdup(session);
+		service->update_version = vmware_shared_strdup(version);
+	}
+	else
+	{
+		service->session = NULL;
+		service->update_version = NULL;
+	}
+
 	/* remove UPDATING flag and set READY or FAILED flag */
 	service->state &= ~(ZBX_VMWARE_STATE_MASK | ZBX_VMWARE_STATE_UPDATING);
 	service->state |= (SUCCEED == ret) ? ZBX_VMWARE_STATE_READY : ZBX_VMWARE_STATE_FAILED;
@@ -4397,8 +6237,16 @@ out:
 		zbx_vector_ptr_clear(&service->data->events);
 	}
 
-	vmware_data_shared_free(service->data);
-	service->data = vmware_data_shared_dup(data);
+	if (0 != incremental && SUCCEED == ret)
+	{
+		vmware_data_shared_update(service->data, data, &updates);
+	}
+	else
+	{
+		vmware_data_shared_free(service->data);
+		service->data = vmware_data_shared_dup(data);
+	}
+
 	service->eventlog.skip_old = skip_old;
 
 	if (0 != events.values_num)
@@ -4412,149 +6260,421 @@ out:
 
 	vmware_data_free(data);
 	zbx_vector_ptr_destroy(&events);
+	zbx_vector_ptr_clear_ext(&updates, (zbx_clean_func_t)vmware_obj_update_free);
+	zbx_vector_ptr_destroy(&updates);
+	zbx_free(version);
+	zbx_free(session);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s \tprocessed:" ZBX_FS_SIZE_T " bytes of data", __func__,
-			zbx_result_string(ret), (zbx_fs_size_t)page.alloc);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s incremental:%d \tprocessed:" ZBX_FS_SIZE_T " bytes of data",
+			__func__, zbx_result_string(ret), incremental, (zbx_fs_size_t)page.alloc);
+}
+
+/* QueryPerf response elements, which text is collected by streaming parser */
+#define ZBX_PERF_XML_NONE	0
+#define ZBX_PERF_XML_ENTITY	1
+#define ZBX_PERF_XML_COUNTER	2
+#define ZBX_PERF_XML_INSTANCE	3
+#define ZBX_PERF_XML_VALUE	4
+#define ZBX_PERF_XML_FAULT	5
+
+/* QueryPerf response element depths: Envelope/Body/QueryPerfResponse/returnval/value/id/counterId */
+#define ZBX_PERF_XML_DEPTH_ENTITY	4
+#define ZBX_PERF_XML_DEPTH_METRIC	5
+#define ZBX_PERF_XML_DEPTH_SAMPLE	6
+#define ZBX_PERF_XML_DEPTH_ID		7
+
+/* the streaming QueryPerf response parser state */
+typedef struct
+{
+	zbx_vector_ptr_t	*perfdata;
+
+	/* the performance entity being parsed and whether it has at least one valid value */
+	zbx_vmware_perf_data_t	*data;
+	int			data_ret;
+
+	int			depth;
+	int			element;
+
+	char			*text;
+	size_t			text_alloc;
+	size_t			text_offset;
+
+	/* the performance metric being parsed */
+	char			*counter;
+	char			*instance;
+	char			*value;
+
+	char			*fault;
 }
+zbx_vmware_perf_parser_t;
 
 /******************************************************************************
  *                                                                            *
- * Function: vmware_service_process_perf_entity_data                          *
+ * Function: vmware_perf_parser_take_text                                     *
+ *                                                                            *
+ * Purpose: returns the collected element text and stops collecting           *
  *                                                                            *
- * Purpose: updates vmware performance statistics data                        *
+ ******************************************************************************/
+static char	*vmware_perf_parser_take_text(zbx_vmware_perf_parser_t *parser)
+{
+	char	*text;
+
+	text = (char *)zbx_malloc(NULL, parser->text_offset + 1);
+
+	if (0 != parser->text_offset)
+		memcpy(text, parser->text, parser->text_offset);
+
+	text[parser->text_offset] = '\0';
+	parser->text_offset = 0;
+	parser->element = ZBX_PERF_XML_NONE;
+
+	return text;
+}
+
+/******************************************************************************
  *                                                                            *
- * Parameters: pervalues - [OUT] the performance counter values               *
- *             xdoc      - [IN] the XML document containing performance       *
- *                              counter values for all entities               *
- *             node      - [IN] the XML node containing performance counter   *
- *                              values for the specified entity               *
+ * Function: vmware_perf_parser_add_value                                     *
  *                                                                            *
- * Return value: SUCCEED - the performance entity data was parsed             *
- *               FAIL    - the perofmance entity data did not contain valid   *
- *                         values                                             *
+ * Purpose: adds parsed performance metric value to the entity being parsed   *
  *                                                                            *
  ******************************************************************************/
-static int	vmware_service_process_perf_entity_data(zbx_vector_ptr_t *pervalues, xmlDoc *xdoc, xmlNode *node)
+static void	vmware_perf_parser_add_value(zbx_vmware_perf_parser_t *parser)
 {
-	xmlXPathContext		*xpathCtx;
-	xmlXPathObject		*xpathObj;
-	xmlNodeSetPtr		nodeset;
-	char			*instance, *counter, *value;
-	int			i, values = 0, ret = FAIL;
 	zbx_vmware_perf_value_t	*perfvalue;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+	if (NULL != parser->data && NULL != parser->value && NULL != parser->counter)
+	{
+		perfvalue = (zbx_vmware_perf_value_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_value_t));
 
-	xpathCtx = xmlXPathNewContext(xdoc);
-	xpathCtx->node = node;
+		ZBX_STR2UINT64(perfvalue->counterid, parser->counter);
+		perfvalue->instance = (NULL != parser->instance ? parser->instance : zbx_strdup(NULL, ""));
+		parser->instance = NULL;
 
-	if (NULL == (xpathObj = xmlXPathEvalExpression((xmlChar *)"*[local-name()='value']", xpathCtx)))
-		goto out;
+		if (0 == strcmp(parser->value, "-1") || SUCCEED != is_uint64(parser->value, &perfvalue->value))
+			perfvalue->value = UINT64_MAX;
+		else
+			parser->data_ret = SUCCEED;
 
-	if (0 != xmlXPathNodeSetIsEmpty(xpathObj->nodesetval))
-		goto out;
+		zbx_vector_ptr_append(&parser->data->values, perfvalue);
+	}
 
-	nodeset = xpathObj->nodesetval;
-	zbx_vector_ptr_reserve(pervalues, nodeset->nodeNr + pervalues->values_alloc);
+	zbx_free(parser->counter);
+	zbx_free(parser->instance);
+	zbx_free(parser->value);
+}
 
-	for (i = 0; i < nodeset->nodeNr; i++)
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_perf_parser_start_element                                 *
+ *                                                                            *
+ * Purpose: libxml2 SAX2 element start callback of QueryPerf response parser  *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_perf_parser_start_element(void *ctx, const xmlChar *localname, const xmlChar *prefix,
+		const xmlChar *URI, int nb_namespaces, const xmlChar **namespaces, int nb_attributes, int nb_defaulted,
+		const xmlChar **attributes)
+{
+	zbx_vmware_perf_parser_t	*parser = (zbx_vmware_perf_parser_t *)ctx;
+	const char			*name = (const char *)localname;
+	int				i;
+
+	ZBX_UNUSED(prefix);
+	ZBX_UNUSED(URI);
+	ZBX_UNUSED(nb_namespaces);
+	ZBX_UNUSED(namespaces);
+	ZBX_UNUSED(nb_defaulted);
+
+	parser->depth++;
+	parser->text_offset = 0;
+	parser->element = ZBX_PERF_XML_NONE;
+
+	if (0 == strcmp(name, "faultstring"))
 	{
-		value = zbx_xml_read_node_value(xdoc, nodeset->nodeTab[i], "*[local-name()='value'][last()]");
-		instance = zbx_xml_read_node_value(xdoc, nodeset->nodeTab[i], "*[local-name()='id']"
-				"/*[local-name()='instance']");
-		counter = zbx_xml_read_node_value(xdoc, nodeset->nodeTab[i], "*[local-name()='id']"
-				"/*[local-name()='counterId']");
+		parser->element = ZBX_PERF_XML_FAULT;
+		return;
+	}
 
-		if (NULL != value && NULL != counter)
-		{
-			perfvalue = (zbx_vmware_perf_value_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_value_t));
+	switch (parser->depth)
+	{
+		case ZBX_PERF_XML_DEPTH_ENTITY:
+			parser->data = (zbx_vmware_perf_data_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_data_t));
+			parser->data->id = NULL;
+			parser->data->type = NULL;
+			parser->data->error = NULL;
+			zbx_vector_ptr_create(&parser->data->values);
+			parser->data_ret = FAIL;
+			break;
+		case ZBX_PERF_XML_DEPTH_METRIC:
+			if (NULL == parser->data || 0 != strcmp(name, "entity"))
+				break;
+
+			parser->element = ZBX_PERF_XML_ENTITY;
+
+			/* attributes are passed as localname/prefix/URI/value/end tuples */
+			for (i = 0; i < nb_attributes; i++)
+			{
+				const xmlChar	**attr = attributes + i * 5;
+
+				if (0 == strcmp((const char *)attr[0], "type"))
+				{
+					zbx_free(parser->data->type);
+					parser->data->type = zbx_dsprintf(NULL, "%.*s", (int)(attr[4] - attr[3]),
+							(const char *)attr[3]);
+				}
+			}
+			break;
+		case ZBX_PERF_XML_DEPTH_SAMPLE:
+			if (0 == strcmp(name, "value"))
+				parser->element = ZBX_PERF_XML_VALUE;
+			break;
+		case ZBX_PERF_XML_DEPTH_ID:
+			if (0 == strcmp(name, "counterId"))
+				parser->element = ZBX_PERF_XML_COUNTER;
+			else if (0 == strcmp(name, "instance"))
+				parser->element = ZBX_PERF_XML_INSTANCE;
+			break;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_perf_parser_end_element                                   *
+ *                                                                            *
+ * Purpose: libxml2 SAX2 element end callback of QueryPerf response parser    *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_perf_parser_end_element(void *ctx, const xmlChar *localname, const xmlChar *prefix,
+		const xmlChar *URI)
+{
+	zbx_vmware_perf_parser_t	*parser = (zbx_vmware_perf_parser_t *)ctx;
+
+	ZBX_UNUSED(prefix);
+	ZBX_UNUSED(URI);
+
+	switch (parser->element)
+	{
+		case ZBX_PERF_XML_FAULT:
+			zbx_free(parser->fault);
+			parser->fault = vmware_perf_parser_take_text(parser);
+			break;
+		case ZBX_PERF_XML_ENTITY:
+			zbx_free(parser->data->id);
+			parser->data->id = vmware_perf_parser_take_text(parser);
+			break;
+		case ZBX_PERF_XML_VALUE:
+			/* only the last sample is used */
+			zbx_free(parser->value);
+			parser->value = vmware_perf_parser_take_text(parser);
+			break;
+		case ZBX_PERF_XML_COUNTER:
+			zbx_free(parser->counter);
+			parser->counter = vmware_perf_parser_take_text(parser);
+			break;
+		case ZBX_PERF_XML_INSTANCE:
+			zbx_free(parser->instance);
+			parser->instance = vmware_perf_parser_take_text(parser);
+			break;
+	}
+
+	switch (parser->depth)
+	{
+		case ZBX_PERF_XML_DEPTH_ENTITY:
+			if (NULL == parser->data)
+				break;
+
+			if (SUCCEED == parser->data_ret && NULL != parser->data->type && NULL != parser->data->id)
+				zbx_vector_ptr_append(parser->perfdata, parser->data);
+			else
+				vmware_free_perfdata(parser->data);
+
+			parser->data = NULL;
+			break;
+		case ZBX_PERF_XML_DEPTH_METRIC:
+			if (0 == strcmp((const char *)localname, "value"))
+				vmware_perf_parser_add_value(parser);
+			break;
+	}
+
+	parser->depth--;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_perf_parser_characters                                    *
+ *                                                                            *
+ * Purpose: libxml2 SAX2 text callback of QueryPerf response parser           *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_perf_parser_characters(void *ctx, const xmlChar *ch, int len)
+{
+	zbx_vmware_perf_parser_t	*parser = (zbx_vmware_perf_parser_t *)ctx;
+
+	if (ZBX_PERF_XML_NONE == parser->element)
+		return;
+
+	zbx_strncpy_alloc(&parser->text, &parser->text_alloc, &parser->text_offset, (const char *)ch, len);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: curl_write_perf_cb                                               *
+ *                                                                            *
+ * Purpose: passes received QueryPerf response data to the streaming parser   *
+ *                                                                            *
+ ******************************************************************************/
+/* the performance counter query job */
+typedef struct
+{
+	char				*request;
+
+	/* the range of entities (indexes in the entity vector) included in the query */
+	int				from;
+	int				to;
+
+	xmlParserCtxtPtr		ctxt;
+	zbx_vmware_perf_parser_t	parser;
+
+	/* the parsed performance entity data */
+	zbx_vector_ptr_t		perfdata;
+	char				*error;
+}
+zbx_vmware_perf_job_t;
 
-			ZBX_STR2UINT64(perfvalue->counterid, counter);
-			perfvalue->instance = (NULL != instance ? instance : zbx_strdup(NULL, ""));
+static size_t	curl_write_perf_cb(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	size_t			r_size = size * nmemb;
+	zbx_vmware_perf_job_t	*job = (zbx_vmware_perf_job_t *)userdata;
 
-			if (0 == strcmp(value, "-1") || SUCCEED != is_uint64(value, &perfvalue->value))
-				perfvalue->value = UINT64_MAX;
-			else if (FAIL == ret)
-				ret = SUCCEED;
+	zabbix_log(LOG_LEVEL_TRACE, "vmware_service_retrieve_perf_counters() SOAP response: %.*s",
+			(int)r_size, (const char *)ptr);
 
-			zbx_vector_ptr_append(pervalues, perfvalue);
+	if (0 != xmlParseChunk(job->ctxt, (const char *)ptr, (int)r_size, 0))
+	{
+		job->error = zbx_strdup(job->error, "Received response has no valid XML data.");
+		return 0;
+	}
 
-			instance = NULL;
-			values++;
-		}
+	return r_size;
+}
 
-		zbx_free(counter);
-		zbx_free(instance);
-		zbx_free(value);
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_perf_job_clean_parser                                     *
+ *                                                                            *
+ * Purpose: releases the streaming parser resources                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_perf_job_clean_parser(zbx_vmware_perf_job_t *job)
+{
+	if (NULL != job->ctxt)
+	{
+		xmlFreeParserCtxt(job->ctxt);
+		job->ctxt = NULL;
 	}
 
-out:
-	if (NULL != xpathObj)
-		xmlXPathFreeObject(xpathObj);
+	if (NULL != job->parser.data)
+		vmware_free_perfdata(job->parser.data);
 
-	xmlXPathFreeContext(xpathCtx);
+	zbx_free(job->parser.counter);
+	zbx_free(job->parser.instance);
+	zbx_free(job->parser.value);
+	zbx_free(job->parser.fault);
+	zbx_free(job->parser.text);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() values:%d", __func__, values);
+	memset(&job->parser, 0, sizeof(job->parser));
+}
 
-	return ret;
+static void	vmware_perf_job_free(zbx_vmware_perf_job_t *job)
+{
+	vmware_perf_job_clean_parser(job);
+
+	zbx_vector_ptr_clear_ext(&job->perfdata, (zbx_mem_free_func_t)vmware_free_perfdata);
+	zbx_vector_ptr_destroy(&job->perfdata);
+
+	zbx_free(job->request);
+	zbx_free(job->error);
+	zbx_free(job);
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: vmware_service_parse_perf_data                                   *
+ * Function: vmware_perf_job_start                                            *
  *                                                                            *
- * Purpose: updates vmware performance statistics data                        *
+ * Purpose: sets up QueryPerf request on the specified handle with response   *
+ *          parsed while it is being received                                 *
  *                                                                            *
- * Parameters: perfdata - [OUT] performance entity data                       *
- *             xdoc     - [IN] the performance data xml document              *
+ * Comments: QueryPerf responses for large environments can be hundreds of    *
+ *           megabytes, so instead of storing the response and building its   *
+ *           document tree the required values are extracted in one pass by   *
+ *           SAX parser fed directly from the cURL write callback.            *
  *                                                                            *
  ******************************************************************************/
-static void	vmware_service_parse_perf_data(zbx_vector_ptr_t *perfdata, xmlDoc *xdoc)
+static int	vmware_perf_job_start(void *data, CURL *easyhandle, char **error)
 {
-	xmlXPathContext	*xpathCtx;
-	xmlXPathObject	*xpathObj;
-	xmlNodeSetPtr	nodeset;
-	int		i;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+	zbx_vmware_perf_job_t	*job = (zbx_vmware_perf_job_t *)data;
+	xmlSAXHandler		sax;
+	CURLoption		opt;
+	CURLcode		err;
 
-	xpathCtx = xmlXPathNewContext(xdoc);
+	memset(&job->parser, 0, sizeof(job->parser));
+	job->parser.perfdata = &job->perfdata;
 
-	if (NULL == (xpathObj = xmlXPathEvalExpression((xmlChar *)"/*/*/*/*", xpathCtx)))
-		goto clean;
+	memset(&sax, 0, sizeof(sax));
+	sax.initialized = XML_SAX2_MAGIC;
+	sax.startElementNs = vmware_perf_parser_start_element;
+	sax.endElementNs = vmware_perf_parser_end_element;
+	sax.characters = vmware_perf_parser_characters;
 
-	if (0 != xmlXPathNodeSetIsEmpty(xpathObj->nodesetval))
-		goto clean;
+	if (NULL == (job->ctxt = xmlCreatePushParserCtxt(&sax, &job->parser, NULL, 0, ZBX_VM_NONAME_XML)))
+	{
+		*error = zbx_strdup(*error, "Cannot create XML parser.");
+		return FAIL;
+	}
 
-	nodeset = xpathObj->nodesetval;
-	zbx_vector_ptr_reserve(perfdata, nodeset->nodeNr + perfdata->values_alloc);
+	xmlCtxtUseOptions(job->ctxt, ZBX_XML_PARSE_OPTS);
 
-	for (i = 0; i < nodeset->nodeNr; i++)
+	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_WRITEFUNCTION, curl_write_perf_cb)) ||
+			CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_WRITEDATA, job)) ||
+			CURLE_OK != (err = curl_easy_setopt(easyhandle, opt = CURLOPT_POSTFIELDS, job->request)))
 	{
-		zbx_vmware_perf_data_t 	*data;
-		int			ret = FAIL;
-
-		data = (zbx_vmware_perf_data_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_data_t));
+		*error = zbx_dsprintf(*error, "Cannot set cURL option %d: %s.", (int)opt, curl_easy_strerror(err));
+		return FAIL;
+	}
 
-		data->id = zbx_xml_read_node_value(xdoc, nodeset->nodeTab[i], "*[local-name()='entity']");
-		data->type = zbx_xml_read_node_value(xdoc, nodeset->nodeTab[i], "*[local-name()='entity']/@type");
-		data->error = NULL;
-		zbx_vector_ptr_create(&data->values);
+	return SUCCEED;
+}
 
-		if (NULL != data->type && NULL != data->id)
-			ret = vmware_service_process_perf_entity_data(&data->values, xdoc, nodeset->nodeTab[i]);
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_perf_job_finish                                           *
+ *                                                                            *
+ * Purpose: completes parsing of QueryPerf response                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_perf_job_finish(void *data, const char *error)
+{
+	zbx_vmware_perf_job_t	*job = (zbx_vmware_perf_job_t *)data;
 
-		if (SUCCEED == ret)
-			zbx_vector_ptr_append(perfdata, data);
-		else
-			vmware_free_perfdata(data);
+	if (NULL != error)
+	{
+		/* keep the parser error if it has aborted the transfer */
+		if (NULL == job->error)
+			job->error = zbx_strdup(NULL, error);
+	}
+	else if (0 != xmlParseChunk(job->ctxt, NULL, 0, 1) || 0 == job->ctxt->wellFormed)
+	{
+		job->error = zbx_strdup(job->error, "Received response has no valid XML data.");
+	}
+	else if (NULL != job->parser.fault)
+	{
+		job->error = job->parser.fault;
+		job->parser.fault = NULL;
 	}
-clean:
-	if (NULL != xpathObj)
-		xmlXPathFreeObject(xpathObj);
 
-	xmlXPathFreeContext(xpathCtx);
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	if (NULL != job->error)
+		zbx_vector_ptr_clear_ext(&job->perfdata, (zbx_mem_free_func_t)vmware_free_perfdata);
+
+	vmware_perf_job_clean_parser(job);
 }
 
 /******************************************************************************
@@ -4588,6 +6708,89 @@ static void	vmware_perf_data_add_error(zbx_vector_ptr_t *perfdata, const char *t
 	zbx_vector_ptr_append(perfdata, data);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_perf_data_compare                                         *
+ *                                                                            *
+ * Purpose: sorting function to sort performance data by entity type and id   *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_perf_data_compare(const void *d1, const void *d2)
+{
+	const zbx_vmware_perf_data_t	*data1 = *(const zbx_vmware_perf_data_t * const *)d1;
+	const zbx_vmware_perf_data_t	*data2 = *(const zbx_vmware_perf_data_t * const *)d2;
+	int				ret;
+
+	if (0 != (ret = strcmp(data1->type, data2->type)))
+		return ret;
+
+	return strcmp(data1->id, data2->id);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_perf_value_compare                                        *
+ *                                                                            *
+ * Purpose: sorting function to sort performance values by counter id and     *
+ *          instance                                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_perf_value_compare(const void *d1, const void *d2)
+{
+	const zbx_vmware_perf_value_t	*value1 = *(const zbx_vmware_perf_value_t * const *)d1;
+	const zbx_vmware_perf_value_t	*value2 = *(const zbx_vmware_perf_value_t * const *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(value1->counterid, value2->counterid);
+
+	return strcmp(value1->instance, value2->instance);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_perf_entity_get_instanceset                               *
+ *                                                                            *
+ * Purpose: gets entity instance set with the specified instances, creating   *
+ *          it if necessary                                                   *
+ *                                                                            *
+ * Parameters: entity    - [IN] the performance entity                        *
+ *             instances - [IN] the sorted instances, referencing entity      *
+ *                              instance names                                *
+ *                                                                            *
+ * Return value: the instance set in vmware cache                             *
+ *                                                                            *
+ * Comments: Instance sets are compared by the instance name references, the  *
+ *           number of distinct sets is small - usually a single total        *
+ *           instance and a list of device or CPU instances.                  *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_vector_str_t	*vmware_perf_entity_get_instanceset(zbx_vmware_perf_entity_t *entity,
+		const zbx_vector_str_t *instances)
+{
+	zbx_vector_str_t	*instanceset;
+	int			i;
+
+	for (i = 0; i < entity->instancesets.values_num; i++)
+	{
+		instanceset = (zbx_vector_str_t *)entity->instancesets.values[i];
+
+		if (instanceset->values_num == instances->values_num && 0 == memcmp(instanceset->values,
+				instances->values, sizeof(char *) * instances->values_num))
+		{
+			return instanceset;
+		}
+	}
+
+	instanceset = (zbx_vector_str_t *)__vm_mem_malloc_func(NULL, sizeof(zbx_vector_str_t));
+	zbx_vector_str_create_ext(instanceset, __vm_mem_malloc_func, __vm_mem_realloc_func, __vm_mem_free_func);
+	zbx_vector_str_reserve(instanceset, instances->values_num);
+	memcpy(instanceset->values, instances->values, sizeof(char *) * instances->values_num);
+	instanceset->values_num = instances->values_num;
+
+	zbx_vector_ptr_append(&entity->instancesets, instanceset);
+
+	return instanceset;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: vmware_service_copy_perf_data                                    *
@@ -4597,34 +6800,88 @@ static void	vmware_perf_data_add_error(zbx_vector_ptr_t *perfdata, const char *t
  * Parameters: service  - [IN] the vmware service                             *
  *             perfdata - [IN/OUT] the performance data                       *
  *                                                                            *
+ * Comments: The instance names are stored once per entity. Each counter      *
+ *           references the set of its instances, shared with other counters  *
+ *           having the same instances, and keeps only the values of those    *
+ *           instances.                                                       *
+ *                                                                            *
  ******************************************************************************/
 static void	vmware_service_copy_perf_data(zbx_vmware_service_t *service, zbx_vector_ptr_t *perfdata)
 {
-	int				i, j, index;
+	int				i, j, k, n, index, values_num = 0, instances_num = 0, instancesets_num = 0;
 	zbx_vmware_perf_data_t		*data;
 	zbx_vmware_perf_value_t		*value;
 	zbx_vmware_perf_entity_t	*entity;
 	zbx_vmware_perf_counter_t	*perfcounter;
-	zbx_str_uint64_pair_t		perfvalue;
+	zbx_vector_str_t		instances;
+	zbx_vector_ptr_t		values;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
-	for (i = 0; i < perfdata->values_num; i++)
+	zbx_vector_str_create(&instances);
+	zbx_vector_ptr_create(&values);
+
+	/* counters of the same entity can be split between several queries - */
+	/* group entity data to build a common instance list                  */
+	zbx_vector_ptr_sort(perfdata, vmware_perf_data_compare);
+
+	for (i = 0; i < perfdata->values_num; i = k)
 	{
+		for (k = i + 1; k < perfdata->values_num; k++)
+		{
+			if (0 != vmware_perf_data_compare(&perfdata->values[i], &perfdata->values[k]))
+				break;
+		}
+
 		data = (zbx_vmware_perf_data_t *)perfdata->values[i];
 
 		if (NULL == (entity = zbx_vmware_service_get_perf_entity(service, data->type, data->id)))
 			continue;
 
-		if (NULL != data->error)
+		zbx_vector_str_clear(&instances);
+		zbx_vector_ptr_clear(&values);
+
+		for (j = i; j < k; j++)
 		{
-			entity->error = vmware_shared_strdup(data->error);
-			continue;
+			data = (zbx_vmware_perf_data_t *)perfdata->values[j];
+
+			if (NULL != data->error)
+			{
+				if (NULL == entity->error)
+					entity->error = vmware_shared_strdup(data->error);
+				continue;
+			}
+
+			for (n = 0; n < data->values.values_num; n++)
+			{
+				value = (zbx_vmware_perf_value_t *)data->values.values[n];
+				zbx_vector_str_append(&instances, value->instance);
+				zbx_vector_ptr_append(&values, value);
+			}
 		}
 
-		for (j = 0; j < data->values.values_num; j++)
+		zbx_vector_str_sort(&instances, ZBX_DEFAULT_STR_COMPARE_FUNC);
+		zbx_vector_str_uniq(&instances, ZBX_DEFAULT_STR_COMPARE_FUNC);
+
+		zbx_vector_str_reserve(&entity->instances, instances.values_num);
+
+		for (n = 0; n < instances.values_num; n++)
+			zbx_vector_str_append(&entity->instances, vmware_shared_strdup(instances.values[n]));
+
+		instances_num += instances.values_num;
+
+		/* values of the same counter can also come from several queries */
+		zbx_vector_ptr_sort(&values, vmware_perf_value_compare);
+
+		for (j = 0; j < values.values_num; j = n)
 		{
-			value = (zbx_vmware_perf_value_t *)data->values.values[j];
+			value = (zbx_vmware_perf_value_t *)values.values[j];
+
+			for (n = j + 1; n < values.values_num; n++)
+			{
+				if (value->counterid != ((zbx_vmware_perf_value_t *)values.values[n])->counterid)
+					break;
+			}
 
 			if (FAIL == (index = zbx_vector_ptr_bsearch(&entity->counters, &value->counterid,
 					ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC)))
@@ -4634,14 +6891,42 @@ static void	vmware_service_copy_perf_data(zbx_vmware_service_t *service, zbx_vec
 
 			perfcounter = (zbx_vmware_perf_counter_t *)entity->counters.values[index];
 
-			perfvalue.name = vmware_shared_strdup(value->instance);
-			perfvalue.value = value->value;
+			/* counter instances are sorted the same way as entity instances, so they can */
+			/* be collected as references to the entity instance names                    */
+			zbx_vector_str_clear(&instances);
+			zbx_vector_uint64_reserve(&perfcounter->values, n - j);
+
+			for (; j < n; j++)
+			{
+				value = (zbx_vmware_perf_value_t *)values.values[j];
+
+				index = zbx_vector_str_bsearch(&entity->instances, value->instance,
+						ZBX_DEFAULT_STR_COMPARE_FUNC);
+
+				/* ignore repeated values of the same instance */
+				if (0 != instances.values_num &&
+						instances.values[instances.values_num - 1] == entity->instances.values[index])
+				{
+					continue;
+				}
+
+				zbx_vector_str_append(&instances, entity->instances.values[index]);
+				zbx_vector_uint64_append(&perfcounter->values, value->value);
+				values_num++;
+			}
 
-			zbx_vector_str_uint64_pair_append_ptr(&perfcounter->values, &perfvalue);
+			perfcounter->instances = vmware_perf_entity_get_instanceset(entity, &instances);
 		}
+
+		instancesets_num += entity->instancesets.values_num;
 	}
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	zbx_vector_ptr_destroy(&values);
+	zbx_vector_str_destroy(&instances);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() instances:%d instance sets:%d values:%d cache used:" ZBX_FS_UI64
+			"/" ZBX_FS_UI64, __func__, instances_num, instancesets_num, values_num,
+			vmware_mem->total_size - vmware_mem->free_size, vmware_mem->total_size);
 }
 
 /******************************************************************************
@@ -4661,18 +6946,28 @@ static void	vmware_service_copy_perf_data(zbx_vmware_service_t *service, zbx_vec
 static void	vmware_service_retrieve_perf_counters(zbx_vmware_service_t *service, CURL *easyhandle,
 		zbx_vector_ptr_t *entities, int counters_max, zbx_vector_ptr_t *perfdata)
 {
-	char				*tmp = NULL, *error = NULL;
-	size_t				tmp_alloc = 0, tmp_offset;
-	int				i, j, start_counter = 0;
+	char				*tmp = NULL, *failed;
+	size_t				tmp_alloc, tmp_offset;
+	int				i, j, k, start_counter = 0;
 	zbx_vmware_perf_entity_t	*entity;
-	xmlDoc				*doc = NULL;
+	zbx_vmware_perf_job_t		*job;
+	zbx_vector_ptr_t		jobs;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() counters_max:%d", __func__, counters_max);
 
-	while (0 != entities->values_num)
+	zbx_vector_ptr_create(&jobs);
+
+	/* split the entity counters into queries that are sent simultaneously */
+	for (i = entities->values_num - 1; 0 <= i;)
 	{
 		int	counters_num = 0;
 
+		job = (zbx_vmware_perf_job_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_job_t));
+		memset(job, 0, sizeof(zbx_vmware_perf_job_t));
+		zbx_vector_ptr_create(&job->perfdata);
+		job->to = i;
+
+		tmp_alloc = 0;
 		tmp_offset = 0;
 		zbx_strcpy_alloc(&tmp, &tmp_alloc, &tmp_offset, ZBX_POST_VSPHERE_HEADER);
 		zbx_snprintf_alloc(&tmp, &tmp_alloc, &tmp_offset, "<ns0:QueryPerf>"
@@ -4681,7 +6976,7 @@ static void	vmware_service_retrieve_perf_counters(zbx_vmware_service_t *service,
 
 		zbx_vmware_lock();
 
-		for (i = entities->values_num - 1; 0 <= i && counters_num < counters_max;)
+		for (; 0 <= i && counters_num < counters_max;)
 		{
 			char	*id_esc;
 
@@ -4746,37 +7041,59 @@ static void	vmware_service_retrieve_perf_counters(zbx_vmware_service_t *service,
 		}
 
 		zbx_vmware_unlock();
-		zbx_xml_free_doc(doc);
-		doc = NULL;
 
 		zbx_strcpy_alloc(&tmp, &tmp_alloc, &tmp_offset, "</ns0:QueryPerf>");
 		zbx_strcpy_alloc(&tmp, &tmp_alloc, &tmp_offset, ZBX_POST_VSPHERE_FOOTER);
 
 		zabbix_log(LOG_LEVEL_TRACE, "%s() SOAP request: %s", __func__, tmp);
 
-		if (SUCCEED != zbx_soap_post(__func__, easyhandle, tmp, &doc, &error))
-		{
-			for (j = i + 1; j < entities->values_num; j++)
-			{
-				entity = (zbx_vmware_perf_entity_t *)entities->values[j];
-				vmware_perf_data_add_error(perfdata, entity->type, entity->id, error);
-			}
+		/* the last entity can be continued in the next query */
+		job->from = (0 != start_counter ? i : i + 1);
+		job->request = tmp;
+		zbx_vector_ptr_append(&jobs, job);
 
-			zbx_free(error);
-			break;
+		tmp = NULL;
+	}
+
+	xmlSetStructuredErrorFunc(NULL, &libxml_handle_error);
+
+	/* parse performance data into local memory */
+	vmware_post_parallel(easyhandle, &jobs, vmware_perf_job_start, vmware_perf_job_finish);
+
+	xmlSetStructuredErrorFunc(NULL, NULL);
+	xmlResetLastError();
+
+	failed = (char *)zbx_calloc(NULL, (size_t)MAX(entities->values_num, 1), sizeof(char));
+
+	for (i = 0; i < jobs.values_num; i++)
+	{
+		job = (zbx_vmware_perf_job_t *)jobs.values[i];
+
+		if (NULL == job->error)
+		{
+			zbx_vector_ptr_append_array(perfdata, job->perfdata.values, job->perfdata.values_num);
+			zbx_vector_ptr_clear(&job->perfdata);
+			continue;
 		}
 
-		/* parse performance data into local memory */
-		vmware_service_parse_perf_data(perfdata, doc);
+		/* entity split between several queries gets only the first error */
+		for (k = job->from; k <= job->to; k++)
+		{
+			if (0 != failed[k])
+				continue;
 
-		while (entities->values_num > i + 1)
-			zbx_vector_ptr_remove_noorder(entities, entities->values_num - 1);
+			entity = (zbx_vmware_perf_entity_t *)entities->values[k];
+			vmware_perf_data_add_error(perfdata, entity->type, entity->id, job->error);
+			failed[k] = 1;
+		}
 	}
 
-	zbx_free(tmp);
-	zbx_xml_free_doc(doc);
+	zbx_free(failed);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	zbx_vector_ptr_clear_ext(&jobs, (zbx_clean_func_t)vmware_perf_job_free);
+	zbx_vector_ptr_destroy(&jobs);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() queries:%d", __func__, i);
 }
 
 /******************************************************************************
@@ -4943,6 +7260,52 @@ out:
 			zbx_result_string(ret), (zbx_fs_size_t)page.alloc);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: vmware_service_close_session                                     *
+ *                                                                            *
+ * Purpose: closes the session kept for incremental inventory updates         *
+ *                                                                            *
+ * Parameters: service      - [IN] the vmware service                         *
+ *             session      - [IN] the session cookies                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_service_close_session(const zbx_vmware_service_t *service, const char *session)
+{
+	CURL			*easyhandle;
+	struct curl_slist	*headers = NULL;
+	ZBX_HTTPPAGE		page;
+	char			*error = NULL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+
+	if (NULL == (easyhandle = curl_easy_init()))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "Cannot initialize cURL library");
+		goto out;
+	}
+
+	page.alloc = ZBX_INIT_UPD_XML_SIZE;
+	page.data = (char *)zbx_malloc(NULL, page.alloc);
+	headers = curl_slist_append(headers, ZBX_XML_HEADER1);
+	headers = curl_slist_append(headers, ZBX_XML_HEADER2);
+	headers = curl_slist_append(headers, ZBX_XML_HEADER3);
+
+	if (CURLE_OK != curl_easy_setopt(easyhandle, CURLOPT_HTTPHEADER, headers) ||
+			SUCCEED != vmware_service_resume_session(service, easyhandle, &page, session, &error) ||
+			SUCCEED != vmware_service_logout(service, easyhandle, &error))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "Cannot close vmware connection: %s.", ZBX_NULL2EMPTY_STR(error));
+	}
+
+	zbx_free(error);
+	curl_slist_free_all(headers);
+	curl_easy_cleanup(easyhandle);
+	zbx_free(page.data);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: vmware_service_remove                                            *
@@ -4951,15 +7314,32 @@ out:
  *                                                                            *
  * Parameters: service      - [IN] the vmware service                         *
  *                                                                            *
+ * Comments: The service is freed under the vmware lock and the kept session  *
+ *           is closed afterwards using a local copy of the connection        *
+ *           parameters.                                                      *
+ *                                                                            *
  ******************************************************************************/
 static void	vmware_service_remove(zbx_vmware_service_t *service)
 {
-	int	index;
+	int			index;
+	char			*session = NULL;
+	zbx_vmware_service_t	service_local;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() '%s'@'%s'", __func__, service->username, service->url);
 
+	memset(&service_local, 0, sizeof(service_local));
+
 	zbx_vmware_lock();
 
+	if (NULL != service->session)
+	{
+		session = zbx_strdup(NULL, service->session);
+		service_local.url = zbx_strdup(NULL, service->url);
+		service_local.username = zbx_strdup(NULL, service->username);
+		service_local.password = zbx_strdup(NULL, service->password);
+		service_local.type = service->type;
+	}
+
 	if (FAIL != (index = zbx_vector_ptr_search(&vmware->services, service, ZBX_DEFAULT_PTR_COMPARE_FUNC)))
 	{
 		zbx_vector_ptr_remove(&vmware->services, index);
@@ -4968,6 +7348,15 @@ static void	vmware_service_remove(zbx_vmware_service_t *service)
 
 	zbx_vmware_unlock();
 
+	if (NULL != session)
+	{
+		vmware_service_close_session(&service_local, session);
+		zbx_free(session);
+		zbx_free(service_local.url);
+		zbx_free(service_local.username);
+		zbx_free(service_local.password);
+	}
+
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
@@ -5133,6 +7522,10 @@ int	zbx_vmware_service_add_perf_counter(zbx_vmware_service_t *service, const cha
 		entity.error = NULL;
 		zbx_vector_ptr_create_ext(&entity.counters, __vm_mem_malloc_func, __vm_mem_realloc_func,
 				__vm_mem_free_func);
+		zbx_vector_str_create_ext(&entity.instances, __vm_mem_malloc_func, __vm_mem_realloc_func,
+				__vm_mem_free_func);
+		zbx_vector_ptr_create_ext(&entity.instancesets, __vm_mem_malloc_func, __vm_mem_realloc_func,
+				__vm_mem_free_func);
 
 		pentity = (zbx_vmware_perf_entity_t *)zbx_hashset_insert(&service->entities, &entity,
 				sizeof(zbx_vmware_perf_entity_t));
@@ -5302,6 +7695,10 @@ ZBX_THREAD_ENTRY(vmware_thread, args)
 			{
 				service = (zbx_vmware_service_t *)vmware->services.values[i];
 
+				/* the service is being removed by another collector */
+				if (0 != (service->state & ZBX_VMWARE_STATE_REMOVING))
+					continue;
+
 				/* check if the service isn't used and should be removed */
 				if (0 == (service->state & ZBX_VMWARE_STATE_BUSY) &&
 						now - service->lastaccess > ZBX_VMWARE_SERVICE_TTL)
@@ -5460,6 +7857,61 @@ int	zbx_vmware_get_statistics(zbx_vmware_stats_t *stats)
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_vmware_get_diag_stats                                        *
+ *                                                                            *
+ * Purpose: gets vmware cache diagnostic statistics                           *
+ *                                                                            *
+ * Parameters: stats - [OUT] the performance data statistics                  *
+ *             mem   - [OUT] the vmware cache memory statistics               *
+ *                                                                            *
+ * Return value: SUCCEEED - the statistics were retrieved successfully        *
+ *               FAIL     - no vmware collectors are running                  *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vmware_get_diag_stats(zbx_vmware_diag_stats_t *stats, zbx_mem_stats_t *mem)
+{
+	int	i, j;
+
+	if (NULL == vmware_mem)
+		return FAIL;
+
+	memset(stats, 0, sizeof(zbx_vmware_diag_stats_t));
+
+	zbx_vmware_lock();
+
+	for (i = 0; i < vmware->services.values_num; i++)
+	{
+		zbx_vmware_service_t		*service = (zbx_vmware_service_t *)vmware->services.values[i];
+		zbx_vmware_perf_entity_t	*entity;
+		zbx_hashset_iter_t		iter;
+
+		zbx_hashset_iter_reset(&service->entities, &iter);
+
+		while (NULL != (entity = (zbx_vmware_perf_entity_t *)zbx_hashset_iter_next(&iter)))
+		{
+			stats->instances_num += entity->instances.values_num;
+
+			for (j = 0; j < entity->counters.values_num; j++)
+			{
+				stats->values_num += ((zbx_vmware_perf_counter_t *)
+						entity->counters.values[j])->values.values_num;
+			}
+		}
+
+		stats->entities_num += service->entities.num_data;
+	}
+
+	stats->services_num = vmware->services.values_num;
+
+	zbx_mem_get_stats(vmware_mem, mem);
+
+	zbx_vmware_unlock();
+
+	return SUCCEED;
+}
+
 #if defined(HAVE_LIBXML2) && defined(HAVE_LIBCURL)
 
 /*
@@ -5678,4 +8130,8 @@ out:
 	return ret;
 }
 
+#ifdef HAVE_TESTS
+#	include "../../../tests/zabbix_server/vmware/vmware_test.c"
+#endif
+
 #endif
@@ -21,6 +21,7 @@
 
 #include "common.h"
 #include "threads.h"
+#include "memalloc.h"
 
 /* the vmware service state */
 #define ZBX_VMWARE_STATE_NEW		0x001
@@ -43,28 +44,21 @@
 
 #define ZBX_VMWARE_EVENT_KEY_UNINITIALIZED	__UINT64_C(0xffffffffffffffff)
 
-typedef struct
-{
-	char		*name;
-	zbx_uint64_t	value;
-}
-zbx_str_uint64_pair_t;
-
-ZBX_VECTOR_DECL(str_uint64_pair, zbx_str_uint64_pair_t)
-
 /* performance counter data */
 typedef struct
 {
 	/* the counter id */
-	zbx_uint64_t			counterid;
+	zbx_uint64_t		counterid;
+
+	/* the sorted instances of the counter values, one of the entity */
+	/* instance sets or NULL if the counter has no values            */
+	zbx_vector_str_t	*instances;
 
-	/* the counter values for various instances */
-	/*    pair->name  - instance                */
-	/*    pair->value - value                   */
-	zbx_vector_str_uint64_pair_t	values;
+	/* the counter values in the order of instances */
+	zbx_vector_uint64_t	values;
 
 	/* the counter state, see ZBX_VMAWRE_COUNTER_* defines */
-	unsigned char			state;
+	unsigned char		state;
 }
 zbx_vmware_perf_counter_t;
 
@@ -86,6 +80,13 @@ typedef struct
 	/* the performance counters to monitor */
 	zbx_vector_ptr_t	counters;
 
+	/* the sorted performance counter instances of all counters */
+	zbx_vector_str_t	instances;
+
+	/* the distinct sorted instance sets of counters referencing the above */
+	/* instances, counters with the same instances share the same set      */
+	zbx_vector_ptr_t	instancesets;
+
 	/* the performance counter query instance name */
 	char			*query_instance;
 
@@ -239,6 +240,12 @@ typedef struct
 
 	/* lastlogsize when vmware.eventlog[] item was polled last time and skip old flag*/
 	zbx_vmware_eventlog_state_t	eventlog;
+
+	/* the session cookies kept between service updates for incremental inventory refresh */
+	char				*session;
+
+	/* the inventory property collector version the service data corresponds to */
+	char				*update_version;
 }
 zbx_vmware_service_t;
 
@@ -261,6 +268,16 @@ typedef struct
 }
 zbx_vmware_stats_t;
 
+/* the vmware cache diagnostic statistics */
+typedef struct
+{
+	zbx_uint64_t	services_num;
+	zbx_uint64_t	entities_num;
+	zbx_uint64_t	instances_num;
+	zbx_uint64_t	values_num;
+}
+zbx_vmware_diag_stats_t;
+
 ZBX_THREAD_ENTRY(vmware_thread, args);
 
 int	zbx_vmware_init(char **error);
@@ -270,6 +287,7 @@ void	zbx_vmware_lock(void);
 void	zbx_vmware_unlock(void);
 
 int	zbx_vmware_get_statistics(zbx_vmware_stats_t *stats);
+int	zbx_vmware_get_diag_stats(zbx_vmware_diag_stats_t *stats, zbx_mem_stats_t *mem);
 
 #if defined(HAVE_LIBXML2) && defined(HAVE_LIBCURL)
 
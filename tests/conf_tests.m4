@@ -34,11 +34,17 @@ AC_DEFUN([CONF_TESTS],[
 		tests/libs/zbxcommshigh/Makefile
 		tests/libs/zbxalgo/Makefile
 		tests/libs/zbxprometheus/Makefile
+		tests/zabbix_agent/Makefile
+		tests/zabbix_agent/logfiles/Makefile
 		tests/zabbix_server/Makefile
 		tests/zabbix_server/preprocessor/Makefile
 		tests/libs/zbxcomms/Makefile
 		tests/zabbix_server/trapper/Makefile
+		tests/zabbix_server/poller/Makefile
+		tests/zabbix_server/ipmi/Makefile
+		tests/zabbix_server/vmware/Makefile
 		tests/libs/zbxregexp/Makefile
+		tests/libs/zbxself/Makefile
 		])
 		AC_DEFINE([HAVE_TESTS], [1], ["Define to 1 if tests directory is present"])
 	])
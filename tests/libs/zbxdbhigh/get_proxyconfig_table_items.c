@@ -0,0 +1,201 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockdb.h"
+#include "zbxmockutil.h"
+#include "zbxmockassert.h"
+#include "zbxmockjson.h"
+
+#include "common.h"
+#include "zbxalgo.h"
+#include "zbxjson.h"
+#include "db.h"
+
+#include "get_proxyconfig_table_items_test.h"
+
+char	*CONFIG_SERVER = NULL;
+
+/* items table with the fields required to order dependent items after their masters */
+static const ZBX_TABLE	items_table =
+	{"items",	"itemid",	0,
+		{
+		{"itemid",	NULL,	NULL,	NULL,	0,	ZBX_TYPE_ID,	ZBX_NOTNULL,	0},
+		{"type",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL | ZBX_PROXY,	0},
+		{"key_",	"",	NULL,	NULL,	255,	ZBX_TYPE_CHAR,	ZBX_NOTNULL | ZBX_PROXY,	0},
+		{"master_itemid",	NULL,	"items",	"itemid",	0,	ZBX_TYPE_ID,	ZBX_PROXY,
+				ZBX_FK_CASCADE_DELETE},
+		{0}
+		},
+		NULL
+	};
+
+static void	get_table(const struct zbx_json *j, struct zbx_json_parse *jp_table)
+{
+	struct zbx_json_parse	jp;
+
+	if (SUCCEED != zbx_json_open(j->buffer, &jp))
+		fail_msg("Cannot open proxy configuration data: %s", zbx_json_strerror());
+
+	if (SUCCEED != zbx_json_brackets_by_name(&jp, items_table.table, jp_table))
+		fail_msg("Cannot find table \"%s\" in proxy configuration data: %s", items_table.table, j->buffer);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: get_revisions                                                    *
+ *                                                                            *
+ * Purpose: build revisions of configuration data applied by proxy from the   *
+ *          bucket revisions reported by server, keeping only the buckets     *
+ *          listed in the test case                                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	get_revisions(const struct zbx_json *j, zbx_mock_handle_t hbuckets, struct zbx_json *j_revisions)
+{
+	struct zbx_json_parse	jp_table, jp_revisions, jp_buckets, jp_bucket;
+	const char		*p = NULL, *pv;
+	char			bucket[MAX_ID_LEN + 1], revision[MAX_ID_LEN + 1];
+	zbx_mock_handle_t	hbucket;
+	zbx_mock_error_t	err;
+	zbx_vector_uint64_t	buckets;
+	zbx_uint64_t		value;
+
+	zbx_vector_uint64_create(&buckets);
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = (zbx_mock_vector_element(hbuckets, &hbucket))))
+	{
+		if (ZBX_MOCK_SUCCESS != err || ZBX_MOCK_SUCCESS != (err = zbx_mock_uint64(hbucket, &value)))
+			fail_msg("Cannot read unchanged bucket: %s", zbx_mock_error_string(err));
+
+		zbx_vector_uint64_append(&buckets, value);
+	}
+
+	get_table(j, &jp_table);
+
+	if (SUCCEED != zbx_json_brackets_by_name(&jp_table, ZBX_PROTO_TAG_REVISIONS, &jp_revisions) ||
+			SUCCEED != zbx_json_brackets_by_name(&jp_revisions, ZBX_PROTO_TAG_BUCKETS, &jp_buckets))
+	{
+		fail_msg("Cannot find bucket revisions in proxy configuration data: %s", j->buffer);
+	}
+
+	zbx_json_addobject(j_revisions, items_table.table);
+	zbx_json_adduint64(j_revisions, ZBX_PROTO_TAG_BUCKET_SIZE, 256);
+	zbx_json_addarray(j_revisions, ZBX_PROTO_TAG_BUCKETS);
+
+	while (NULL != (p = zbx_json_next(&jp_buckets, p)))
+	{
+		if (SUCCEED != zbx_json_brackets_open(p, &jp_bucket) ||
+				NULL == (pv = zbx_json_next_value(&jp_bucket, NULL, bucket, sizeof(bucket), NULL)) ||
+				NULL == zbx_json_next_value(&jp_bucket, pv, revision, sizeof(revision), NULL) ||
+				SUCCEED != is_uint64(bucket, &value))
+		{
+			fail_msg("Invalid bucket revision format: %s", j->buffer);
+		}
+
+		if (FAIL == zbx_vector_uint64_search(&buckets, value, ZBX_DEFAULT_UINT64_COMPARE_FUNC))
+			continue;
+
+		zbx_json_addarray(j_revisions, NULL);
+		zbx_json_addstring(j_revisions, NULL, bucket, ZBX_JSON_TYPE_INT);
+		zbx_json_addstring(j_revisions, NULL, revision, ZBX_JSON_TYPE_INT);
+		zbx_json_close(j_revisions);
+	}
+
+	zbx_json_close(j_revisions);
+	zbx_json_close(j_revisions);
+
+	zbx_vector_uint64_destroy(&buckets);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_uint64_t		proxy_hostid, itemid;
+	struct zbx_json		j, j_revisions;
+	struct zbx_json_parse	jp_table, jp_data, jp_revisions;
+	zbx_hashset_t		itemids;
+	zbx_mock_handle_t	hitemids, hitemid;
+	zbx_mock_error_t	err;
+	char			*data = NULL;
+	size_t			data_alloc = 0, data_offset = 0;
+	int			itemids_num = 0;
+
+	ZBX_UNUSED(state);
+
+	zbx_mockdb_init();
+
+	proxy_hostid = zbx_mock_get_parameter_uint64("in.proxy_hostid");
+
+	zbx_hashset_create(&itemids, 100, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
+
+	if (SUCCEED != get_proxyconfig_table_items_test(proxy_hostid, &j, &items_table, &itemids, NULL))
+		fail_msg("Cannot get proxy configuration data");
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter_exists("in.unchanged_buckets"))
+	{
+		/* report the listed buckets as already applied by proxy and prepare the configuration again */
+		zbx_json_init(&j_revisions, ZBX_JSON_STAT_BUF_LEN);
+		get_revisions(&j, zbx_mock_get_parameter_handle("in.unchanged_buckets"), &j_revisions);
+
+		if (SUCCEED != zbx_json_open(j_revisions.buffer, &jp_revisions))
+			fail_msg("Cannot open revisions: %s", zbx_json_strerror());
+
+		zbx_json_free(&j);
+		zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
+		zbx_hashset_clear(&itemids);
+
+		if (SUCCEED != get_proxyconfig_table_items_test(proxy_hostid, &j, &items_table, &itemids,
+				&jp_revisions))
+		{
+			fail_msg("Cannot get proxy configuration data");
+		}
+
+		zbx_json_free(&j_revisions);
+	}
+
+	get_table(&j, &jp_table);
+
+	if (SUCCEED != zbx_json_brackets_by_name(&jp_table, ZBX_PROTO_TAG_DATA, &jp_data))
+		fail_msg("Cannot find rows in proxy configuration data: %s", j.buffer);
+
+	zbx_strncpy_alloc(&data, &data_alloc, &data_offset, jp_data.start, jp_data.end - jp_data.start + 1);
+	zbx_mock_assert_json_eq("configuration rows", zbx_mock_get_parameter_string("out.data"), data);
+
+	hitemids = zbx_mock_get_parameter_handle("out.itemids");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = (zbx_mock_vector_element(hitemids, &hitemid))))
+	{
+		if (ZBX_MOCK_SUCCESS != err || ZBX_MOCK_SUCCESS != (err = zbx_mock_uint64(hitemid, &itemid)))
+			fail_msg("Cannot read expected itemid: %s", zbx_mock_error_string(err));
+
+		if (NULL == zbx_hashset_search(&itemids, &itemid))
+			fail_msg("Item " ZBX_FS_UI64 " is not in the configuration item set", itemid);
+
+		itemids_num++;
+	}
+
+	zbx_mock_assert_int_eq("configuration item set size", itemids_num, itemids.num_data);
+
+	zbx_free(data);
+	zbx_json_free(&j);
+	zbx_hashset_destroy(&itemids);
+
+	zbx_mockdb_destroy();
+}
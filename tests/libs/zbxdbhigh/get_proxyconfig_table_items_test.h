@@ -0,0 +1,26 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef GET_PROXYCONFIG_TABLE_ITEMS_TEST_H
+#define GET_PROXYCONFIG_TABLE_ITEMS_TEST_H
+
+int	get_proxyconfig_table_items_test(zbx_uint64_t proxy_hostid, struct zbx_json *j, const ZBX_TABLE *table,
+		zbx_hashset_t *itemids, const struct zbx_json_parse *jp_revisions);
+
+#endif /* GET_PROXYCONFIG_TABLE_ITEMS_TEST_H */
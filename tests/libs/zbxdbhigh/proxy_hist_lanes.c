@@ -0,0 +1,138 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockutil.h"
+#include "zbxmockassert.h"
+
+#include "common.h"
+#include "proxy.h"
+
+char	*CONFIG_SERVER = NULL;
+
+static void	read_lanes(zbx_mock_handle_t handle, zbx_proxy_hist_lanes_t *lanes)
+{
+	zbx_mock_handle_t	hbacklogs, hbacklog, hid;
+	zbx_mock_error_t	err;
+	zbx_uint64_pair_t	range;
+	int			i;
+
+	zbx_vector_uint64_pair_clear(&lanes->backlogs);
+	lanes->fresh_lastid = zbx_mock_get_object_member_uint64(handle, "fresh");
+	hbacklogs = zbx_mock_get_object_member_handle(handle, "backlogs");
+
+	for (i = 1; ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hbacklogs, &hbacklog)); i++)
+	{
+		if (ZBX_MOCK_SUCCESS != err ||
+				ZBX_MOCK_SUCCESS != (err = zbx_mock_vector_element(hbacklog, &hid)) ||
+				ZBX_MOCK_SUCCESS != (err = zbx_mock_uint64(hid, &range.first)) ||
+				ZBX_MOCK_SUCCESS != (err = zbx_mock_vector_element(hbacklog, &hid)) ||
+				ZBX_MOCK_SUCCESS != (err = zbx_mock_uint64(hid, &range.second)))
+		{
+			fail_msg("Cannot read backlog range #%d: %s", i, zbx_mock_error_string(err));
+		}
+
+		zbx_vector_uint64_pair_append(&lanes->backlogs, range);
+	}
+}
+
+static int	str_to_more(const char *str)
+{
+	if (0 == strcmp(str, "MORE"))
+		return ZBX_PROXY_DATA_MORE;
+
+	if (0 == strcmp(str, "DONE"))
+		return ZBX_PROXY_DATA_DONE;
+
+	fail_msg("Unknown data availability flag \"%s\"", str);
+
+	return FAIL;
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_proxy_hist_lanes_t	lanes, expected;
+	zbx_mock_handle_t	hsteps, hstep, hexpected;
+	zbx_mock_error_t	err;
+	const char		*op;
+	int			i, j, ret;
+
+	ZBX_UNUSED(state);
+
+	proxy_hist_lanes_init(&lanes);
+	proxy_hist_lanes_init(&expected);
+
+	read_lanes(zbx_mock_get_parameter_handle("in.lanes"), &lanes);
+	hsteps = zbx_mock_get_parameter_handle("in.steps");
+
+	for (i = 1; ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hsteps, &hstep)); i++)
+	{
+		char	msg[MAX_STRING_LEN];
+
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read step #%d: %s", i, zbx_mock_error_string(err));
+
+		op = zbx_mock_get_object_member_string(hstep, "op");
+
+		if (0 == strcmp(op, "skip"))
+		{
+			ret = proxy_hist_lanes_skip(&lanes, zbx_mock_get_object_member_uint64(hstep, "maxid"));
+
+			zbx_snprintf(msg, sizeof(msg), "step #%d skip return value", i);
+			zbx_mock_assert_result_eq(msg, zbx_mock_str_to_return_code(
+					zbx_mock_get_object_member_string(hstep, "return")), ret);
+		}
+		else if (0 == strcmp(op, "fresh"))
+		{
+			proxy_hist_lanes_fresh_sent(&lanes, zbx_mock_get_object_member_uint64(hstep, "sent"));
+		}
+		else if (0 == strcmp(op, "backfill"))
+		{
+			proxy_hist_lanes_backfill_sent(&lanes, zbx_mock_get_object_member_uint64(hstep, "sent"),
+					str_to_more(zbx_mock_get_object_member_string(hstep, "more")));
+		}
+		else
+			fail_msg("Unknown step #%d operation \"%s\"", i, op);
+
+		hexpected = zbx_mock_get_object_member_handle(hstep, "lanes");
+		read_lanes(hexpected, &expected);
+
+		zbx_snprintf(msg, sizeof(msg), "step #%d history_lastid", i);
+		zbx_mock_assert_uint64_eq(msg, zbx_mock_get_object_member_uint64(hexpected, "lastid"),
+				proxy_hist_lanes_lastid(&lanes));
+		zbx_snprintf(msg, sizeof(msg), "step #%d history_fresh_lastid", i);
+		zbx_mock_assert_uint64_eq(msg, expected.fresh_lastid, lanes.fresh_lastid);
+		zbx_snprintf(msg, sizeof(msg), "step #%d number of backlog ranges", i);
+		zbx_mock_assert_int_eq(msg, expected.backlogs.values_num, lanes.backlogs.values_num);
+
+		for (j = 0; j < expected.backlogs.values_num; j++)
+		{
+			zbx_snprintf(msg, sizeof(msg), "step #%d backlog range #%d start", i, j + 1);
+			zbx_mock_assert_uint64_eq(msg, expected.backlogs.values[j].first,
+					lanes.backlogs.values[j].first);
+			zbx_snprintf(msg, sizeof(msg), "step #%d backlog range #%d end", i, j + 1);
+			zbx_mock_assert_uint64_eq(msg, expected.backlogs.values[j].second,
+					lanes.backlogs.values[j].second);
+		}
+	}
+
+	proxy_hist_lanes_destroy(&expected);
+	proxy_hist_lanes_destroy(&lanes);
+}
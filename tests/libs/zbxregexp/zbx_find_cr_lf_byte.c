@@ -0,0 +1,63 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "zbxregexp.h"
+
+void	zbx_mock_test_entry(void **state)
+{
+	const char	*data, *p;
+	char		*buf;
+	size_t		len, start = 0;
+
+	ZBX_UNUSED(state);
+
+	data = zbx_mock_get_parameter_string("in.buffer");
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter_exists("in.length"))
+		len = (size_t)zbx_mock_get_parameter_uint64("in.length");
+	else
+		len = strlen(data);
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter_exists("in.start"))
+		start = (size_t)zbx_mock_get_parameter_uint64("in.start");
+
+	/* the buffer is not terminated, nothing past its length must be searched */
+	buf = (char *)zbx_malloc(NULL, len);
+	memcpy(buf, data, len);
+
+	p = zbx_find_cr_lf_byte(buf + start, buf + len);
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter_exists("out.offset"))
+	{
+		if (NULL == p)
+			fail_msg("CR or LF byte was not found");
+
+		zbx_mock_assert_uint64_eq("CR or LF byte offset", zbx_mock_get_parameter_uint64("out.offset"),
+				(zbx_uint64_t)(p - buf));
+	}
+	else if (NULL != p)
+		fail_msg("Unexpected CR or LF byte found at offset " ZBX_FS_SIZE_T, (zbx_fs_size_t)(p - buf));
+
+	zbx_free(buf);
+}
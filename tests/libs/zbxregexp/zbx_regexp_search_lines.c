@@ -0,0 +1,81 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "zbxregexp.h"
+
+static int	str_to_match_result(const char *str)
+{
+	if (0 == strcmp(str, "ZBX_REGEXP_MATCH"))
+		return ZBX_REGEXP_MATCH;
+
+	if (0 == strcmp(str, "ZBX_REGEXP_NO_MATCH"))
+		return ZBX_REGEXP_NO_MATCH;
+
+	return zbx_mock_str_to_return_code(str);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	const char		*pattern, *data, *err_msg_static = NULL;
+	const zbx_regexp_t	*regexp, *regexp_cached;
+	char			*buf;
+	size_t			len, offset;
+	int			ret, expected_ret;
+
+	ZBX_UNUSED(state);
+
+	pattern = zbx_mock_get_parameter_string("in.pattern");
+	data = zbx_mock_get_parameter_string("in.buffer");
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter_exists("in.length"))
+		len = (size_t)zbx_mock_get_parameter_uint64("in.length");
+	else
+		len = strlen(data);
+
+	ret = zbx_regexp_prepare_lines(pattern, &regexp, &err_msg_static);
+	zbx_mock_assert_result_eq("zbx_regexp_prepare_lines() return value",
+			zbx_mock_str_to_return_code(zbx_mock_get_parameter_string("out.compile")), ret);
+
+	if (SUCCEED != ret)
+		return;
+
+	/* the regular expression is compiled once and reused while the pattern is the same */
+	if (SUCCEED != zbx_regexp_prepare_lines(pattern, &regexp_cached, &err_msg_static) || regexp != regexp_cached)
+		fail_msg("Regular expression \"%s\" was not reused", pattern);
+
+	/* the buffer is not terminated, nothing past its length must be searched */
+	buf = (char *)zbx_malloc(NULL, len);
+	memcpy(buf, data, len);
+
+	expected_ret = str_to_match_result(zbx_mock_get_parameter_string("out.result"));
+	ret = zbx_regexp_search_lines(buf, len, regexp, &offset);
+
+	if (ret != expected_ret)
+		fail_msg("Unexpected zbx_regexp_search_lines() return value %d while expected %d", ret, expected_ret);
+
+	if (ZBX_REGEXP_MATCH == ret)
+		zbx_mock_assert_uint64_eq("match offset", zbx_mock_get_parameter_uint64("out.offset"), offset);
+
+	zbx_free(buf);
+}
@@ -0,0 +1,51 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "../../../src/libs/zbxself/latency.h"
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_uint64_t	usec;
+	int		index;
+
+	ZBX_UNUSED(state);
+
+	usec = zbx_mock_get_parameter_uint64("in.usec");
+	index = zbx_latency_bucket(usec);
+
+	zbx_mock_assert_int_eq("bucket index", (int)zbx_mock_get_parameter_uint64("out.index"), index);
+	zbx_mock_assert_uint64_eq("bucket upper limit", zbx_mock_get_parameter_uint64("out.limit"),
+			zbx_latency_bucket_limit(index));
+
+	/* the latency must fit in its bucket unless it exceeds the last bucket */
+	if (ZBX_LATENCY_BUCKETS_NUM - 1 != index)
+	{
+		if (usec >= zbx_latency_bucket_limit(index))
+			fail_msg("latency " ZBX_FS_UI64 " is not below bucket #%d upper limit", usec, index);
+
+		if (0 != index && usec < zbx_latency_bucket_limit(index - 1))
+			fail_msg("latency " ZBX_FS_UI64 " is below bucket #%d lower limit", usec, index);
+	}
+}
@@ -0,0 +1,82 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "zbxself.h"
+#include "../../../src/libs/zbxself/latency.h"
+
+static unsigned char	str_to_latency_stat(const char *str)
+{
+	if (0 == strcmp(str, "percentile"))
+		return ZBX_LATENCY_STAT_PERCENTILE;
+
+	if (0 == strcmp(str, "avg"))
+		return ZBX_LATENCY_STAT_AVG;
+
+	if (0 == strcmp(str, "max"))
+		return ZBX_LATENCY_STAT_MAX;
+
+	if (0 == strcmp(str, "count"))
+		return ZBX_LATENCY_STAT_COUNT;
+
+	fail_msg("unknown latency statistics \"%s\"", str);
+
+	return ZBX_LATENCY_STAT_COUNT;
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_latency_histogram_t	latency, half;
+	zbx_mock_handle_t	hvalues, hvalue;
+	zbx_mock_error_t	err;
+	double			value, percentile = 0;
+	unsigned char		stat;
+	int			num = 0;
+
+	ZBX_UNUSED(state);
+
+	memset(&latency, 0, sizeof(latency));
+	memset(&half, 0, sizeof(half));
+
+	/* add every second value through a merged histogram to check that merging keeps the statistics */
+	hvalues = zbx_mock_get_parameter_handle("in.values");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hvalues, &hvalue)))
+	{
+		if (ZBX_MOCK_SUCCESS != err || ZBX_MOCK_SUCCESS != (err = zbx_mock_float(hvalue, &value)))
+			fail_msg("Cannot read value #%d: %s", num + 1, zbx_mock_error_string(err));
+
+		zbx_latency_add(0 == num++ % 2 ? &latency : &half, value);
+	}
+
+	zbx_latency_merge(&latency, &half);
+
+	stat = str_to_latency_stat(zbx_mock_get_parameter_string("in.stat"));
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter_exists("in.percentile"))
+		percentile = zbx_mock_get_parameter_float("in.percentile");
+
+	zbx_mock_assert_double_eq("latency statistics", zbx_mock_get_parameter_float("out.value"),
+			zbx_latency_stat(&latency, stat, percentile));
+}
@@ -0,0 +1,205 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+#include "zbxmockhelper.h"
+
+#include "common.h"
+#include "log.h"
+#include "sysinfo.h"
+
+static void	write_file(const char *path, const char *data, size_t len)
+{
+	FILE	*f;
+
+	if (NULL == (f = fopen(path, "w")))
+		fail_msg("Cannot create file \"%s\": %s", path, zbx_strerror(errno));
+
+	if (len != fwrite(data, 1, len, f))
+		fail_msg("Cannot write file \"%s\": %s", path, zbx_strerror(errno));
+
+	fclose(f);
+}
+
+/* writes /proc/[pid]/status and /proc/[pid]/cmdline files of a process into the directory */
+static void	create_process(const char *dir, zbx_mock_handle_t hprocess)
+{
+	zbx_mock_handle_t	hlines, hline;
+	const char		*line;
+	char			*path, *data = NULL, *p;
+	size_t			data_alloc = 0, data_offset = 0, len;
+
+	path = zbx_dsprintf(NULL, "%s/" ZBX_FS_UI64, dir, zbx_mock_get_object_member_uint64(hprocess, "pid"));
+
+	if (0 != mkdir(path, 0700))
+		fail_msg("Cannot create directory \"%s\": %s", path, zbx_strerror(errno));
+
+	/* status lines are given as "<label>: <value>", the value is separated by tab in the file */
+	hlines = zbx_mock_get_object_member_handle(hprocess, "status");
+
+	while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hlines, &hline))
+	{
+		if (ZBX_MOCK_SUCCESS != zbx_mock_string(hline, &line))
+			fail_msg("Invalid status line");
+
+		if (NULL == (p = strstr(line, ": ")))
+			fail_msg("Invalid status line \"%s\"", line);
+
+		zbx_snprintf_alloc(&data, &data_alloc, &data_offset, "%.*s:\t%s\n", (int)(p - line), line, p + 2);
+	}
+
+	path = zbx_dsprintf(path, "%s/" ZBX_FS_UI64 "/status", dir,
+			zbx_mock_get_object_member_uint64(hprocess, "pid"));
+	write_file(path, data, data_offset);
+
+	/* processes without command line file are skipped */
+	if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hprocess, "cmdline", &hlines))
+	{
+		data_offset = 0;
+
+		while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hlines, &hline))
+		{
+			if (ZBX_MOCK_SUCCESS != zbx_mock_string(hline, &line))
+				fail_msg("Invalid command line argument");
+
+			/* arguments are terminated by '\0' */
+			len = strlen(line) + 1;
+
+			if (data_alloc < data_offset + len)
+				data = (char *)zbx_realloc(data, data_alloc = (data_offset + len) * 2);
+
+			memcpy(data + data_offset, line, len);
+			data_offset += len;
+		}
+
+		path = zbx_dsprintf(path, "%s/" ZBX_FS_UI64 "/cmdline", dir,
+				zbx_mock_get_object_member_uint64(hprocess, "pid"));
+		write_file(path, data, data_offset);
+	}
+
+	zbx_free(data);
+	zbx_free(path);
+}
+
+static void	remove_dir(const char *dir)
+{
+	DIR		*d;
+	struct dirent	*entry;
+	char		*path;
+
+	if (NULL == (d = opendir(dir)))
+		return;
+
+	while (NULL != (entry = readdir(d)))
+	{
+		if ('.' == *entry->d_name)
+			continue;
+
+		path = zbx_dsprintf(NULL, "%s/%s", dir, entry->d_name);
+
+		if (0 != unlink(path))
+			remove_dir(path);
+
+		zbx_free(path);
+	}
+
+	closedir(d);
+	rmdir(dir);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	AGENT_REQUEST		request;
+	AGENT_RESULT		result;
+	zbx_mock_handle_t	hprocesses, hprocess, hkeys, hkey, hvalues, hvalue;
+	const char		*key, *value;
+	char			dir[] = "/tmp/zbx_proc_test.XXXXXX", *path, buf[MAX_STRING_LEN];
+	int			ret = SYSINFO_RET_FAIL;
+
+	ZBX_UNUSED(state);
+
+	if (NULL == mkdtemp(dir))
+		fail_msg("Cannot create temporary directory: %s", zbx_strerror(errno));
+
+	/* /proc files are read from the temporary directory */
+	zbx_mock_set_real_dir(dir);
+	zbx_mock_set_real_dir_alias("/proc");
+
+	hprocesses = zbx_mock_get_parameter_handle("in.processes");
+
+	while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hprocesses, &hprocess))
+		create_process(dir, hprocess);
+
+	/* entries not containing pids are skipped */
+	path = zbx_dsprintf(NULL, "%s/sys", dir);
+	if (0 != mkdir(path, 0700))
+		fail_msg("Cannot create directory \"%s\": %s", path, zbx_strerror(errno));
+	zbx_free(path);
+
+	hkeys = zbx_mock_get_parameter_handle("in.keys");
+	hvalues = zbx_mock_get_parameter_handle("out.values");
+
+	while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hkeys, &hkey))
+	{
+		if (ZBX_MOCK_SUCCESS != zbx_mock_string(hkey, &key))
+			fail_msg("Invalid item key");
+
+		if (ZBX_MOCK_SUCCESS != zbx_mock_vector_element(hvalues, &hvalue) ||
+				ZBX_MOCK_SUCCESS != zbx_mock_string(hvalue, &value))
+		{
+			fail_msg("Missing expected value of \"%s\"", key);
+		}
+
+		init_request(&request);
+		init_result(&result);
+
+		if (SUCCEED != parse_item_key(key, &request))
+			fail_msg("Invalid item key \"%s\"", key);
+
+		if (0 == strcmp(get_rkey(&request), "proc.num"))
+			ret = PROC_NUM(&request, &result);
+		else if (0 == strcmp(get_rkey(&request), "proc.mem"))
+			ret = PROC_MEM(&request, &result);
+		else
+			fail_msg("Unsupported item key \"%s\"", key);
+
+		if (SYSINFO_RET_OK != ret)
+		{
+			fail_msg("Unexpected result of \"%s\": %s", key,
+					ISSET_MSG(&result) ? result.msg : "no error message");
+		}
+
+		if (ISSET_UI64(&result))
+			zbx_snprintf(buf, sizeof(buf), ZBX_FS_UI64, result.ui64);
+		else if (ISSET_DBL(&result))
+			zbx_snprintf(buf, sizeof(buf), "%.2f", result.dbl);
+		else
+			fail_msg("Unexpected value type of \"%s\"", key);
+
+		zbx_mock_assert_str_eq(key, value, buf);
+
+		free_request(&request);
+		free_result(&result);
+	}
+
+	remove_dir(dir);
+}
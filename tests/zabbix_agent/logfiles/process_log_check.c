@@ -0,0 +1,228 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+#include "zbxmockhelper.h"
+
+#include "common.h"
+#include "log.h"
+#include "zbxregexp.h"
+#include "../../../src/zabbix_agent/metrics.h"
+#include "../../../src/zabbix_agent/logfiles/logfiles.h"
+
+static zbx_vector_str_t	values;
+
+int	__real_inotify_init(void);
+
+int	__wrap_inotify_init(void)
+{
+	/* fall back to checking the files in every check when change notifications are not available */
+	if (0 == zbx_mock_get_parameter_uint64("in.inotify"))
+	{
+		errno = ENOSYS;
+		return -1;
+	}
+
+	return __real_inotify_init();
+}
+
+static int	process_value_cb(const char *server, unsigned short port, const char *host, const char *key,
+		const char *value, unsigned char state, zbx_uint64_t *lastlogsize, int *mtime,
+		unsigned long *timestamp, const char *source, unsigned short *severity, unsigned long *logeventid,
+		unsigned char flags)
+{
+	ZBX_UNUSED(server);
+	ZBX_UNUSED(port);
+	ZBX_UNUSED(host);
+	ZBX_UNUSED(key);
+	ZBX_UNUSED(state);
+	ZBX_UNUSED(lastlogsize);
+	ZBX_UNUSED(mtime);
+	ZBX_UNUSED(timestamp);
+	ZBX_UNUSED(source);
+	ZBX_UNUSED(severity);
+	ZBX_UNUSED(logeventid);
+	ZBX_UNUSED(flags);
+
+	zbx_vector_str_append(&values, zbx_strdup(NULL, value));
+
+	return SUCCEED;
+}
+
+static void	append_file(const char *path, const char *data)
+{
+	int	fd;
+
+	if (-1 == (fd = open(path, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR)))
+		fail_msg("Cannot open \"%s\": %s", path, zbx_strerror(errno));
+
+	if ((ssize_t)strlen(data) != write(fd, data, strlen(data)))
+		fail_msg("Cannot write \"%s\": %s", path, zbx_strerror(errno));
+
+	close(fd);
+}
+
+static void	remove_dir(const char *dir)
+{
+	DIR		*d;
+	struct dirent	*entry;
+	char		*path;
+
+	if (NULL == (d = opendir(dir)))
+		return;
+
+	while (NULL != (entry = readdir(d)))
+	{
+		if ('.' == *entry->d_name)
+			continue;
+
+		path = zbx_dsprintf(NULL, "%s/%s", dir, entry->d_name);
+
+		if (0 != unlink(path))
+			remove_dir(path);
+
+		zbx_free(path);
+	}
+
+	closedir(d);
+	rmdir(dir);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	ZBX_ACTIVE_METRIC	metric;
+	zbx_vector_ptr_t	regexps;
+	zbx_mock_handle_t	hsteps, hstep, hvalues, hvalue;
+	zbx_mock_error_t	err;
+	zbx_uint64_t		lastlogsize_sent;
+	int			mtime_sent, step = 0, i;
+	char			dir[] = "/tmp/zbx_logwatch_test.XXXXXX", *path, *path2, *error = NULL,
+				msg[MAX_STRING_LEN];
+	const char		*op, *value;
+
+	ZBX_UNUSED(state);
+
+	if (NULL == mkdtemp(dir))
+		fail_msg("Cannot create temporary directory: %s", zbx_strerror(errno));
+
+	zbx_mock_set_real_dir(dir);
+
+	/* files are modified through hard links in a directory, which is not watched */
+	path = zbx_dsprintf(NULL, "%s/link", dir);
+
+	if (0 != mkdir(path, S_IRWXU))
+		fail_msg("Cannot create directory \"%s\": %s", path, zbx_strerror(errno));
+
+	zbx_free(path);
+
+	memset(&metric, 0, sizeof(metric));
+	metric.key_orig = zbx_dsprintf(NULL, zbx_mock_get_parameter_string("in.key"), dir);
+	metric.key = zbx_strdup(NULL, metric.key_orig);
+	metric.refresh = 1;
+	metric.flags = 0 == strncmp(metric.key, "logrt[", ZBX_CONST_STRLEN("logrt[")) ?
+			ZBX_METRIC_FLAG_LOG_LOGRT : ZBX_METRIC_FLAG_LOG_LOG;
+	metric.flags |= ZBX_METRIC_FLAG_PERSISTENT;
+
+	zbx_vector_ptr_create(&regexps);
+	zbx_vector_str_create(&values);
+
+	hsteps = zbx_mock_get_parameter_handle("in.steps");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hsteps, &hstep)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read step #%d: %s", step + 1, zbx_mock_error_string(err));
+
+		step++;
+		op = zbx_mock_get_object_member_string(hstep, "op");
+		zbx_snprintf(msg, sizeof(msg), "step #%d %s", step, op);
+
+		if (0 == strcmp(op, "write"))
+		{
+			path = zbx_dsprintf(NULL, "%s/%s", dir, zbx_mock_get_object_member_string(hstep, "file"));
+			append_file(path, zbx_mock_get_object_member_string(hstep, "data"));
+			zbx_free(path);
+		}
+		else if (0 == strcmp(op, "write_link"))
+		{
+			path = zbx_dsprintf(NULL, "%s/%s", dir, zbx_mock_get_object_member_string(hstep, "file"));
+			path2 = zbx_dsprintf(NULL, "%s/link/%s", dir, zbx_mock_get_object_member_string(hstep, "file"));
+
+			if (0 != link(path, path2))
+				fail_msg("Cannot link \"%s\": %s", path, zbx_strerror(errno));
+
+			append_file(path2, zbx_mock_get_object_member_string(hstep, "data"));
+			unlink(path2);
+			zbx_free(path2);
+			zbx_free(path);
+		}
+		else if (0 == strcmp(op, "rename"))
+		{
+			path = zbx_dsprintf(NULL, "%s/%s", dir, zbx_mock_get_object_member_string(hstep, "from"));
+			path2 = zbx_dsprintf(NULL, "%s/%s", dir, zbx_mock_get_object_member_string(hstep, "to"));
+
+			if (0 != rename(path, path2))
+				fail_msg("Cannot rename \"%s\": %s", path, zbx_strerror(errno));
+
+			zbx_free(path2);
+			zbx_free(path);
+		}
+		else if (0 == strcmp(op, "check"))
+		{
+			zbx_vector_str_clear_ext(&values, zbx_str_free);
+
+			if (SUCCEED != process_log_check(NULL, 0, &regexps, &metric, process_value_cb,
+					&lastlogsize_sent, &mtime_sent, &error))
+			{
+				fail_msg("%s failed: %s", msg, ZBX_NULL2STR(error));
+			}
+
+			hvalues = zbx_mock_get_object_member_handle(hstep, "values");
+
+			for (i = 0; ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hvalues, &hvalue)); i++)
+			{
+				if (ZBX_MOCK_SUCCESS != err || ZBX_MOCK_SUCCESS != zbx_mock_string(hvalue, &value))
+					fail_msg("Cannot read %s value #%d", msg, i + 1);
+
+				if (i >= values.values_num)
+					fail_msg("%s: expected value \"%s\" was not read", msg, value);
+
+				zbx_mock_assert_str_eq(msg, value, values.values[i]);
+			}
+
+			zbx_mock_assert_int_eq(msg, i, values.values_num);
+
+			zbx_mock_assert_int_eq(msg, (int)zbx_mock_get_object_member_uint64(hstep, "watched"),
+					0 != metric.notify_revision);
+		}
+		else
+			fail_msg("Unknown operation \"%s\"", op);
+	}
+
+	zbx_vector_str_clear_ext(&values, zbx_str_free);
+	zbx_vector_str_destroy(&values);
+	zbx_vector_ptr_destroy(&regexps);
+	destroy_logfile_list(&metric.logfiles, NULL, &metric.logfiles_num);
+	zbx_free(metric.key);
+	zbx_free(metric.key_orig);
+	remove_dir(dir);
+}
@@ -0,0 +1,275 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+#include "zbxmockhelper.h"
+
+#include "common.h"
+#include "log.h"
+#include "zbxalgo.h"
+#include "../../src/zabbix_agent/metrics.h"
+#include "../../src/zabbix_agent/persistbuf.h"
+
+#define PBUF_HOST	"127.0.0.1"
+#define PBUF_PORT	10051
+
+/* offset of the write offset in segment header - after the magic, version and read offset */
+#define PBUF_WRITE_OFFSET	16
+
+/* values are generated from their id, so that the values read back can be checked */
+static void	pbuf_make_value(ZBX_ACTIVE_BUFFER_ELEMENT *el, zbx_uint64_t id, size_t value_size, int log)
+{
+	memset(el, 0, sizeof(ZBX_ACTIVE_BUFFER_ELEMENT));
+
+	el->id = id;
+	el->host = zbx_strdup(NULL, "host");
+	el->key = zbx_dsprintf(NULL, "key[" ZBX_FS_UI64 "]", id);
+	el->value = (char *)zbx_malloc(NULL, value_size + 1);
+	memset(el->value, 'a' + (int)(id % 26), value_size);
+	el->value[value_size] = '\0';
+	el->ts.sec = (int)id;
+	el->ts.ns = (int)id;
+
+	if (0 != log)
+	{
+		el->flags = ZBX_METRIC_FLAG_LOG | ZBX_METRIC_FLAG_PERSISTENT;
+		el->lastlogsize = id * 100;
+		el->mtime = (int)id;
+	}
+}
+
+static void	pbuf_free_value(ZBX_ACTIVE_BUFFER_ELEMENT *el)
+{
+	zbx_free(el->host);
+	zbx_free(el->key);
+	zbx_free(el->value);
+	zbx_free(el->source);
+}
+
+static void	pbuf_check_value(const ZBX_ACTIVE_BUFFER_ELEMENT *el, zbx_uint64_t id, size_t value_size)
+{
+	ZBX_ACTIVE_BUFFER_ELEMENT	expected;
+
+	pbuf_make_value(&expected, id, value_size, 0 != (ZBX_METRIC_FLAG_LOG & el->flags));
+
+	zbx_mock_assert_uint64_eq("value id", expected.id, el->id);
+	zbx_mock_assert_str_eq("value host", expected.host, el->host);
+	zbx_mock_assert_str_eq("value key", expected.key, el->key);
+	zbx_mock_assert_str_eq("value", expected.value, el->value);
+	zbx_mock_assert_ptr_eq("value source", NULL, el->source);
+	zbx_mock_assert_int_eq("value timestamp", expected.ts.sec, el->ts.sec);
+	zbx_mock_assert_uint64_eq("value lastlogsize", expected.lastlogsize, el->lastlogsize);
+	zbx_mock_assert_int_eq("value mtime", expected.mtime, el->mtime);
+
+	pbuf_free_value(&expected);
+}
+
+typedef struct
+{
+	zbx_uint64_t	max_id;
+	int		count;
+}
+pbuf_scan_t;
+
+static int	pbuf_scan_cb(const ZBX_ACTIVE_BUFFER_ELEMENT *el, void *data)
+{
+	pbuf_scan_t	*scan = (pbuf_scan_t *)data;
+
+	if (el->id > scan->max_id)
+		return FAIL;
+
+	pbuf_check_value(el, el->id, strlen(el->value));
+	scan->count++;
+
+	return SUCCEED;
+}
+
+static zbx_uint64_t	get_step_uint64(zbx_mock_handle_t hstep, const char *name, zbx_uint64_t def)
+{
+	zbx_mock_handle_t	hvalue;
+
+	if (ZBX_MOCK_SUCCESS != zbx_mock_object_member(hstep, name, &hvalue))
+		return def;
+
+	return zbx_mock_get_object_member_uint64(hstep, name);
+}
+
+static int	get_step_result(zbx_mock_handle_t hstep)
+{
+	zbx_mock_handle_t	hvalue;
+
+	if (ZBX_MOCK_SUCCESS != zbx_mock_object_member(hstep, "result", &hvalue))
+		return SUCCEED;
+
+	return zbx_mock_str_to_return_code(zbx_mock_get_object_member_string(hstep, "result"));
+}
+
+static void	pbuf_remove_dir(const char *dir)
+{
+	DIR		*d;
+	struct dirent	*entry;
+	char		*path;
+
+	if (NULL == (d = opendir(dir)))
+		return;
+
+	while (NULL != (entry = readdir(d)))
+	{
+		if ('.' == *entry->d_name)
+			continue;
+
+		path = zbx_dsprintf(NULL, "%s/%s", dir, entry->d_name);
+		unlink(path);
+		zbx_free(path);
+	}
+
+	closedir(d);
+	rmdir(dir);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	ZBX_PERSISTENT_BUFFER		pbuf;
+	ZBX_ACTIVE_BUFFER_ELEMENT	el;
+	zbx_mock_handle_t		hsteps, hstep;
+	zbx_mock_error_t		err;
+	zbx_uint64_t			max_size, next_id = 1, value_size = 16;
+	char				dir[] = "/tmp/zbx_pbuf_test.XXXXXX", *error = NULL, msg[MAX_STRING_LEN];
+	const char			*op;
+	int				step = 0, i, ret;
+
+	ZBX_UNUSED(state);
+
+	if (NULL == mkdtemp(dir))
+		fail_msg("Cannot create temporary directory: %s", zbx_strerror(errno));
+
+	zbx_mock_set_real_dir(dir);
+
+	max_size = zbx_mock_get_parameter_uint64("in.max_size");
+
+	if (SUCCEED != persistent_buffer_open(&pbuf, dir, PBUF_HOST, PBUF_PORT, max_size, &error))
+		fail_msg("Cannot open persistent buffer: %s", error);
+
+	hsteps = zbx_mock_get_parameter_handle("in.steps");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hsteps, &hstep)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read step #%d: %s", step + 1, zbx_mock_error_string(err));
+
+		step++;
+		op = zbx_mock_get_object_member_string(hstep, "op");
+		zbx_snprintf(msg, sizeof(msg), "step #%d %s", step, op);
+
+		if (0 == strcmp(op, "write"))
+		{
+			zbx_uint64_t	count, written;
+			int		log;
+
+			count = get_step_uint64(hstep, "count", 1);
+			value_size = get_step_uint64(hstep, "value_size", 16);
+			log = (int)get_step_uint64(hstep, "log", 0);
+
+			for (written = 0, ret = SUCCEED; written < count && SUCCEED == ret; )
+			{
+				pbuf_make_value(&el, next_id, value_size, log);
+
+				if (SUCCEED == (ret = persistent_buffer_write(&pbuf, &el)))
+				{
+					written++;
+					next_id++;
+				}
+
+				pbuf_free_value(&el);
+			}
+
+			zbx_mock_assert_result_eq(msg, get_step_result(hstep), ret);
+			zbx_mock_assert_uint64_eq(msg, get_step_uint64(hstep, "written", count), written);
+		}
+		else if (0 == strcmp(op, "read"))
+		{
+			zbx_uint64_t	count, first;
+
+			count = get_step_uint64(hstep, "count", 1);
+			first = get_step_uint64(hstep, "first", 0);
+
+			for (i = 0, ret = SUCCEED; i < (int)count; i++)
+			{
+				if (SUCCEED != (ret = persistent_buffer_read(&pbuf, &el)))
+					break;
+
+				pbuf_check_value(&el, first + i, strlen(el.value));
+				pbuf_free_value(&el);
+			}
+
+			zbx_mock_assert_result_eq(msg, get_step_result(hstep), ret);
+		}
+		else if (0 == strcmp(op, "commit"))
+		{
+			persistent_buffer_commit(&pbuf);
+		}
+		else if (0 == strcmp(op, "rollback"))
+		{
+			persistent_buffer_rollback(&pbuf);
+		}
+		else if (0 == strcmp(op, "empty"))
+		{
+			zbx_mock_assert_result_eq(msg, get_step_result(hstep), persistent_buffer_empty(&pbuf));
+		}
+		else if (0 == strcmp(op, "reopen"))
+		{
+			persistent_buffer_close(&pbuf);
+
+			if (SUCCEED != persistent_buffer_open(&pbuf, dir, PBUF_HOST, PBUF_PORT, max_size, &error))
+				fail_msg("Cannot reopen persistent buffer: %s", error);
+
+			zbx_mock_assert_uint64_eq(msg, get_step_uint64(hstep, "last_id", next_id - 1), pbuf.last_id);
+			next_id = pbuf.last_id + 1;
+		}
+		else if (0 == strcmp(op, "scan"))
+		{
+			pbuf_scan_t	scan = {get_step_uint64(hstep, "max_id", ZBX_MAX_UINT64), 0};
+
+			persistent_buffer_scan(&pbuf, pbuf_scan_cb, &scan);
+			zbx_mock_assert_int_eq(msg, (int)zbx_mock_get_object_member_uint64(hstep, "count"), scan.count);
+		}
+		else if (0 == strcmp(op, "damage"))
+		{
+			zbx_uint64_t	write_offset;
+
+			/* move the end of written data past the last record, as if a write was partially synced */
+			memcpy(&write_offset, pbuf.wseg.data + PBUF_WRITE_OFFSET, sizeof(write_offset));
+			write_offset += zbx_mock_get_object_member_uint64(hstep, "bytes");
+			memcpy(pbuf.wseg.data + PBUF_WRITE_OFFSET, &write_offset, sizeof(write_offset));
+		}
+		else if (0 == strcmp(op, "segments"))
+		{
+			zbx_mock_assert_int_eq(msg, (int)zbx_mock_get_object_member_uint64(hstep, "count"),
+					pbuf.seqs.values_num);
+		}
+		else
+			fail_msg("Unknown operation \"%s\"", op);
+	}
+
+	persistent_buffer_close(&pbuf);
+	pbuf_remove_dir(dir);
+}
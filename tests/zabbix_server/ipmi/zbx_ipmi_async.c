@@ -0,0 +1,675 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "../../../src/zabbix_server/ipmi/checks_ipmi.h"
+
+#include <OpenIPMI/ipmiif.h>
+#include <OpenIPMI/ipmi_posix.h>
+#include <OpenIPMI/ipmi_lan.h>
+
+/* The OpenIPMI library is replaced by a simulated BMC. Every asynchronous OpenIPMI call queues an event and */
+/* every perform_one_op() call processes one event by invoking the callback passed to OpenIPMI.               */
+
+#define MOCK_SENSORS_MAX	4
+#define MOCK_HOSTS_MAX		4
+#define MOCK_EVENTS_MAX		64
+#define MOCK_LOOPS_MAX		1000
+#define MOCK_SENSOR_ID_LEN	32
+
+#define MOCK_RESPOND_YES	0	/* the BMC answers the reading */
+#define MOCK_RESPOND_NO		1	/* the BMC never answers the reading */
+#define MOCK_RESPOND_LATE	2	/* the BMC answers the reading after the request has timed out */
+
+struct ipmi_states_s
+{
+	zbx_uint64_t	bits;
+};
+
+struct ipmi_sensor_s
+{
+	char			id[MOCK_SENSOR_ID_LEN];
+	int			reading_type;
+	double			value;
+	struct ipmi_states_s	states;
+	int			respond;
+};
+
+struct ipmi_entity_s
+{
+	struct ipmi_domain_s	*domain;
+};
+
+struct ipmi_domain_s
+{
+	char				*addr;
+	char				*name;
+	int				connect_err;
+	struct ipmi_sensor_s		sensors[MOCK_SENSORS_MAX];
+	int				sensors_num;
+	struct ipmi_entity_s		entity;
+	ipmi_con_t			con;
+	ipmi_domain_con_cb		con_change_handler;
+	void				*con_change_cb_data;
+	ipmi_domain_ptr_cb		domain_fully_up;
+	void				*domain_fully_up_cb_data;
+	ipmi_domain_entity_cb		entity_handler;
+	void				*entity_cb_data;
+	ipmi_entity_sensor_cb		sensor_handler;
+	void				*sensor_cb_data;
+};
+
+#define MOCK_EVENT_CONNECT	0
+#define MOCK_EVENT_ENTITY	1
+#define MOCK_EVENT_SENSORS	2
+#define MOCK_EVENT_UP		3
+#define MOCK_EVENT_CLOSED	4
+#define MOCK_EVENT_READING	5
+#define MOCK_EVENT_STATES	6
+
+typedef struct
+{
+	int				type;
+	struct ipmi_domain_s		*domain;
+	struct ipmi_sensor_s		*sensor;
+	ipmi_domain_close_done_cb	close_done;
+	ipmi_sensor_reading_cb		reading_done;
+	ipmi_sensor_states_cb		states_done;
+	void				*cb_data;
+}
+mock_event_t;
+
+static struct ipmi_domain_s	domains[MOCK_HOSTS_MAX];
+static int			domains_num;
+
+static mock_event_t		events[MOCK_EVENTS_MAX], late_events[MOCK_EVENTS_MAX];
+static int			events_num, late_events_num;
+
+static zbx_mock_handle_t	hoperations;
+static int			operations_num;
+
+static os_handler_t		mock_os_hnd;
+
+static void	mock_operation(const char *operation)
+{
+	zbx_mock_handle_t	hoperation;
+	const char		*expected;
+	char			msg[MAX_STRING_LEN];
+
+	operations_num++;
+
+	if (ZBX_MOCK_SUCCESS != zbx_mock_vector_element(hoperations, &hoperation) ||
+			ZBX_MOCK_SUCCESS != zbx_mock_string(hoperation, &expected))
+	{
+		fail_msg("Unexpected IPMI operation #%d: %s", operations_num, operation);
+	}
+
+	zbx_snprintf(msg, sizeof(msg), "IPMI operation #%d", operations_num);
+	zbx_mock_assert_str_eq(msg, expected, operation);
+}
+
+static void	mock_queue_event(mock_event_t *event)
+{
+	mock_event_t	*queue = events;
+	int		*num = &events_num;
+
+	if (NULL != event->sensor && MOCK_RESPOND_LATE == event->sensor->respond)
+	{
+		queue = late_events;
+		num = &late_events_num;
+	}
+
+	if (MOCK_EVENTS_MAX == *num)
+		fail_msg("too many IPMI events");
+
+	queue[(*num)++] = *event;
+}
+
+static int	mock_perform_one_op(os_handler_t *os_hnd, struct timeval *timeout)
+{
+	mock_event_t	event;
+	int		i;
+
+	ZBX_UNUSED(os_hnd);
+	ZBX_UNUSED(timeout);
+
+	if (0 == events_num)
+		return 0;
+
+	event = events[0];
+	memmove(&events[0], &events[1], sizeof(mock_event_t) * (size_t)--events_num);
+
+	switch (event.type)
+	{
+		case MOCK_EVENT_CONNECT:
+			event.domain->con_change_handler(event.domain, event.domain->connect_err, 0, 0,
+					0 == event.domain->connect_err, event.domain->con_change_cb_data);
+
+			if (0 == event.domain->connect_err)
+			{
+				event.type = MOCK_EVENT_ENTITY;
+				mock_queue_event(&event);
+			}
+			break;
+		case MOCK_EVENT_ENTITY:
+			if (NULL == event.domain->entity_handler)
+				fail_msg("entity update handler is not registered");
+
+			event.domain->entity_handler(IPMI_ADDED, event.domain, &event.domain->entity,
+					event.domain->entity_cb_data);
+			event.type = MOCK_EVENT_SENSORS;
+			mock_queue_event(&event);
+			break;
+		case MOCK_EVENT_SENSORS:
+			if (NULL == event.domain->sensor_handler)
+				fail_msg("sensor update handler is not registered");
+
+			for (i = 0; i < event.domain->sensors_num; i++)
+			{
+				event.domain->sensor_handler(IPMI_ADDED, &event.domain->entity,
+						&event.domain->sensors[i], event.domain->sensor_cb_data);
+			}
+
+			event.type = MOCK_EVENT_UP;
+			mock_queue_event(&event);
+			break;
+		case MOCK_EVENT_UP:
+			event.domain->domain_fully_up(event.domain, event.domain->domain_fully_up_cb_data);
+			break;
+		case MOCK_EVENT_CLOSED:
+			event.close_done(event.cb_data);
+			break;
+		case MOCK_EVENT_READING:
+			event.reading_done(event.sensor, 0, IPMI_BOTH_VALUES_PRESENT, 0, event.sensor->value,
+					&event.sensor->states, event.cb_data);
+			break;
+		case MOCK_EVENT_STATES:
+			event.states_done(event.sensor, 0, &event.sensor->states, event.cb_data);
+			break;
+	}
+
+	return 0;
+}
+
+static void	mock_set_log_handler(os_handler_t *handler, os_vlog_t log_handler)
+{
+	ZBX_UNUSED(handler);
+	ZBX_UNUSED(log_handler);
+}
+
+static void	mock_free_os_handler(os_handler_t *handler)
+{
+	ZBX_UNUSED(handler);
+}
+
+static int	mock_start_con(ipmi_con_t *ipmi)
+{
+	ZBX_UNUSED(ipmi);
+
+	return 0;
+}
+
+os_handler_t	*__wrap_ipmi_posix_setup_os_handler(void)
+{
+	mock_os_hnd.perform_one_op = mock_perform_one_op;
+	mock_os_hnd.set_log_handler = mock_set_log_handler;
+	mock_os_hnd.free_os_handler = mock_free_os_handler;
+
+	return &mock_os_hnd;
+}
+
+int	__wrap_ipmi_init(os_handler_t *handler)
+{
+	ZBX_UNUSED(handler);
+
+	return 0;
+}
+
+int	__wrap_ipmi_ip_setup_con(char * const *ip_addrs, char * const *ports, unsigned int num_ip_addrs,
+		unsigned int authtype, unsigned int privilege, void *username, unsigned int username_len,
+		void *password, unsigned int password_len, os_handler_t *handlers, void *user_data,
+		ipmi_con_t **new_con)
+{
+	int	i;
+
+	ZBX_UNUSED(ports);
+	ZBX_UNUSED(num_ip_addrs);
+	ZBX_UNUSED(authtype);
+	ZBX_UNUSED(privilege);
+	ZBX_UNUSED(username);
+	ZBX_UNUSED(username_len);
+	ZBX_UNUSED(password);
+	ZBX_UNUSED(password_len);
+	ZBX_UNUSED(handlers);
+	ZBX_UNUSED(user_data);
+
+	for (i = 0; i < domains_num; i++)
+	{
+		if (0 == strcmp(domains[i].addr, ip_addrs[0]))
+		{
+			domains[i].con.start_con = mock_start_con;
+			*new_con = &domains[i].con;
+			return 0;
+		}
+	}
+
+	fail_msg("Unknown IPMI host \"%s\"", ip_addrs[0]);
+
+	return -1;
+}
+
+int	__wrap_ipmi_open_domain(const char *name, ipmi_con_t *con[], unsigned int num_con,
+		ipmi_domain_con_cb con_change_handler, void *con_change_cb_data, ipmi_domain_ptr_cb domain_fully_up,
+		void *domain_fully_up_cb_data, ipmi_open_option_t *options, unsigned int num_options,
+		ipmi_domain_id_t *new_domain)
+{
+	struct ipmi_domain_s	*domain = NULL;
+	mock_event_t		event = {0};
+	char			operation[MAX_STRING_LEN];
+	int			i;
+
+	ZBX_UNUSED(num_con);
+	ZBX_UNUSED(options);
+	ZBX_UNUSED(num_options);
+	ZBX_UNUSED(new_domain);
+
+	for (i = 0; i < domains_num; i++)
+	{
+		if (&domains[i].con == con[0])
+			domain = &domains[i];
+	}
+
+	if (NULL == domain)
+		fail_msg("Opening IPMI domain with unknown connection");
+
+	zbx_snprintf(operation, sizeof(operation), "open %s", domain->addr);
+	mock_operation(operation);
+
+	domain->name = zbx_strdup(domain->name, name);
+	domain->con_change_handler = con_change_handler;
+	domain->con_change_cb_data = con_change_cb_data;
+	domain->domain_fully_up = domain_fully_up;
+	domain->domain_fully_up_cb_data = domain_fully_up_cb_data;
+
+	event.type = MOCK_EVENT_CONNECT;
+	event.domain = domain;
+	mock_queue_event(&event);
+
+	return 0;
+}
+
+int	__wrap_ipmi_domain_close(ipmi_domain_t *domain, ipmi_domain_close_done_cb close_done, void *cb_data)
+{
+	mock_event_t	event = {0};
+	char		operation[MAX_STRING_LEN];
+
+	zbx_snprintf(operation, sizeof(operation), "close %s", domain->addr);
+	mock_operation(operation);
+
+	event.type = MOCK_EVENT_CLOSED;
+	event.domain = domain;
+	event.close_done = close_done;
+	event.cb_data = cb_data;
+	mock_queue_event(&event);
+
+	return 0;
+}
+
+int	__wrap_ipmi_domain_add_entity_update_handler(ipmi_domain_t *domain, ipmi_domain_entity_cb handler,
+		void *cb_data)
+{
+	domain->entity_handler = handler;
+	domain->entity_cb_data = cb_data;
+
+	return 0;
+}
+
+int	__wrap_ipmi_entity_add_sensor_update_handler(ipmi_entity_t *ent, ipmi_entity_sensor_cb handler, void *cb_data)
+{
+	ent->domain->sensor_handler = handler;
+	ent->domain->sensor_cb_data = cb_data;
+
+	return 0;
+}
+
+int	__wrap_ipmi_entity_add_control_update_handler(ipmi_entity_t *ent, ipmi_entity_control_cb handler,
+		void *cb_data)
+{
+	ZBX_UNUSED(ent);
+	ZBX_UNUSED(handler);
+	ZBX_UNUSED(cb_data);
+
+	return 0;
+}
+
+int	__wrap_ipmi_entity_get_entity_id(ipmi_entity_t *ent)
+{
+	ZBX_UNUSED(ent);
+
+	return 3;	/* processor */
+}
+
+ipmi_entity_t	*__wrap_ipmi_sensor_get_entity(ipmi_sensor_t *sensor)
+{
+	int	i, j;
+
+	for (i = 0; i < domains_num; i++)
+	{
+		for (j = 0; j < domains[i].sensors_num; j++)
+		{
+			if (&domains[i].sensors[j] == sensor)
+				return &domains[i].entity;
+		}
+	}
+
+	fail_msg("Unknown IPMI sensor");
+
+	return NULL;
+}
+
+int	__wrap_ipmi_sensor_get_is_readable(ipmi_sensor_t *sensor)
+{
+	ZBX_UNUSED(sensor);
+
+	return 1;
+}
+
+int	__wrap_ipmi_sensor_get_id_length(ipmi_sensor_t *sensor)
+{
+	return (int)strlen(sensor->id);
+}
+
+enum ipmi_str_type_e	__wrap_ipmi_sensor_get_id_type(ipmi_sensor_t *sensor)
+{
+	ZBX_UNUSED(sensor);
+
+	return IPMI_ASCII_STR;
+}
+
+int	__wrap_ipmi_sensor_get_id(ipmi_sensor_t *sensor, char *id, int length)
+{
+	zbx_strlcpy(id, sensor->id, (size_t)length);
+
+	return 0;
+}
+
+int	__wrap_ipmi_sensor_get_name(ipmi_sensor_t *sensor, char *name, int length)
+{
+	zbx_snprintf(name, (size_t)length, "%s.%s", __wrap_ipmi_sensor_get_entity(sensor)->domain->name, sensor->id);
+
+	return 0;
+}
+
+int	__wrap_ipmi_sensor_get_event_reading_type(ipmi_sensor_t *sensor)
+{
+	return sensor->reading_type;
+}
+
+int	__wrap_ipmi_sensor_get_sensor_type(ipmi_sensor_t *sensor)
+{
+	ZBX_UNUSED(sensor);
+
+	return 1;	/* temperature */
+}
+
+int	__wrap_ipmi_sensor_get_threshold_access(ipmi_sensor_t *sensor)
+{
+	ZBX_UNUSED(sensor);
+
+	return IPMI_THRESHOLD_ACCESS_SUPPORT_NONE;
+}
+
+int	__wrap_ipmi_sensor_discrete_event_readable(ipmi_sensor_t *sensor, int event, int *val)
+{
+	ZBX_UNUSED(sensor);
+	ZBX_UNUSED(event);
+
+	*val = 1;
+
+	return 0;
+}
+
+int	__wrap_ipmi_is_state_set(ipmi_states_t *states, int state_num)
+{
+	return 0 != (states->bits & (__UINT64_C(1) << state_num));
+}
+
+int	__wrap_ipmi_is_sensor_scanning_enabled(ipmi_states_t *states)
+{
+	ZBX_UNUSED(states);
+
+	return 1;
+}
+
+int	__wrap_ipmi_is_initial_update_in_progress(ipmi_states_t *states)
+{
+	ZBX_UNUSED(states);
+
+	return 0;
+}
+
+static void	mock_read_sensor(ipmi_sensor_t *sensor, mock_event_t *event)
+{
+	char	operation[MAX_STRING_LEN];
+
+	event->domain = __wrap_ipmi_sensor_get_entity(sensor)->domain;
+	event->sensor = sensor;
+
+	zbx_snprintf(operation, sizeof(operation), "read %s %s", event->domain->addr, sensor->id);
+	mock_operation(operation);
+
+	if (MOCK_RESPOND_NO != sensor->respond)
+		mock_queue_event(event);
+}
+
+int	__wrap_ipmi_sensor_get_reading(ipmi_sensor_t *sensor, ipmi_sensor_reading_cb done, void *cb_data)
+{
+	mock_event_t	event = {0};
+
+	event.type = MOCK_EVENT_READING;
+	event.reading_done = done;
+	event.cb_data = cb_data;
+	mock_read_sensor(sensor, &event);
+
+	return 0;
+}
+
+int	__wrap_ipmi_sensor_get_states(ipmi_sensor_t *sensor, ipmi_sensor_states_cb done, void *cb_data)
+{
+	mock_event_t	event = {0};
+
+	event.type = MOCK_EVENT_STATES;
+	event.states_done = done;
+	event.cb_data = cb_data;
+	mock_read_sensor(sensor, &event);
+
+	return 0;
+}
+
+static void	mock_read_hosts(void)
+{
+	zbx_mock_handle_t	hhosts, hhost, hsensors, hsensor, hvalue;
+	zbx_mock_error_t	err;
+	struct ipmi_domain_s	*domain;
+	struct ipmi_sensor_s	*sensor;
+	const char		*respond;
+
+	hhosts = zbx_mock_get_parameter_handle("in.hosts");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hhosts, &hhost)))
+	{
+		if (ZBX_MOCK_SUCCESS != err || MOCK_HOSTS_MAX == domains_num)
+			fail_msg("Cannot read IPMI host #%d", domains_num + 1);
+
+		domain = &domains[domains_num++];
+		domain->addr = zbx_strdup(NULL, zbx_mock_get_object_member_string(hhost, "addr"));
+		domain->entity.domain = domain;
+
+		if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hhost, "connect", &hvalue))
+		{
+			if (0 != strcmp(zbx_mock_get_object_member_string(hhost, "connect"), "refused"))
+				fail_msg("Unknown connection result of IPMI host #%d", domains_num);
+
+			domain->connect_err = ECONNREFUSED;
+		}
+
+		if (ZBX_MOCK_SUCCESS != zbx_mock_object_member(hhost, "sensors", &hsensors))
+			continue;
+
+		while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hsensors, &hsensor)))
+		{
+			if (ZBX_MOCK_SUCCESS != err || MOCK_SENSORS_MAX == domain->sensors_num)
+				fail_msg("Cannot read sensor #%d of IPMI host #%d", domain->sensors_num + 1, domains_num);
+
+			sensor = &domain->sensors[domain->sensors_num++];
+			zbx_strlcpy(sensor->id, zbx_mock_get_object_member_string(hsensor, "id"), sizeof(sensor->id));
+
+			if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hsensor, "states", &hvalue))
+			{
+				sensor->reading_type = IPMI_EVENT_READING_TYPE_DISCRETE_STATE;
+				sensor->states.bits = zbx_mock_get_object_member_uint64(hsensor, "states");
+			}
+			else
+			{
+				sensor->reading_type = IPMI_EVENT_READING_TYPE_THRESHOLD;
+				sensor->value = zbx_mock_get_object_member_float(hsensor, "value");
+			}
+
+			if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hsensor, "respond", &hvalue))
+			{
+				respond = zbx_mock_get_object_member_string(hsensor, "respond");
+
+				if (0 == strcmp(respond, "no"))
+					sensor->respond = MOCK_RESPOND_NO;
+				else if (0 == strcmp(respond, "late"))
+					sensor->respond = MOCK_RESPOND_LATE;
+				else if (0 != strcmp(respond, "yes"))
+					fail_msg("Unknown response \"%s\" of sensor \"%s\"", respond, sensor->id);
+			}
+		}
+	}
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_mock_handle_t	hrequests, hrequest, hresults, hresult, hvalue;
+	zbx_mock_error_t	err;
+	zbx_ipmi_async_t	*requests[MOCK_HOSTS_MAX * MOCK_SENSORS_MAX];
+	int			started[MOCK_HOSTS_MAX * MOCK_SENSORS_MAX], requests_num = 0, finished_num = 0,
+				timeout, i, loops;
+	const char		*value;
+	char			msg[MAX_STRING_LEN];
+	double			now;
+
+	ZBX_UNUSED(state);
+
+	mock_read_hosts();
+
+	timeout = (int)zbx_mock_get_parameter_uint64("in.timeout");
+	hrequests = zbx_mock_get_parameter_handle("in.requests");
+	hoperations = zbx_mock_get_parameter_handle("out.operations");
+
+	if (SUCCEED != zbx_init_ipmi_handler())
+		fail_msg("Cannot initialize IPMI handler");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hrequests, &hrequest)))
+	{
+		if (ZBX_MOCK_SUCCESS != err || (int)ARRSIZE(requests) == requests_num)
+			fail_msg("Cannot read request #%d", requests_num + 1);
+
+		requests[requests_num] = zbx_ipmi_async_create(ZBX_IPMI_ASYNC_VALUE, (zbx_uint64_t)requests_num + 1,
+				zbx_mock_get_object_member_string(hrequest, "addr"), 623, -1, 2, "", "",
+				zbx_mock_get_object_member_string(hrequest, "sensor"), 0);
+		started[requests_num++] = 0;
+	}
+
+	/* all requests are started before OpenIPMI processes any event, the same way as the IPMI poller */
+	/* starts every request received from the IPMI manager and postpones requests for busy hosts    */
+	for (loops = 0; finished_num < requests_num; loops++)
+	{
+		if (MOCK_LOOPS_MAX == loops)
+			fail_msg("IPMI requests are not finished");
+
+		for (i = 0; i < requests_num; i++)
+		{
+			if (0 == started[i] && SUCCEED == zbx_ipmi_async_start(requests[i], timeout))
+				started[i] = 1;
+		}
+
+		now = zbx_time();
+
+		if (0 != events_num)
+		{
+			zbx_perform_openipmi_op(0);
+		}
+		else
+		{
+			/* the BMC does not answer - let the requests time out, then deliver late answers */
+			now += timeout + 1;
+
+			memcpy(events, late_events, sizeof(mock_event_t) * (size_t)late_events_num);
+			events_num = late_events_num;
+			late_events_num = 0;
+		}
+
+		for (i = 0; i < requests_num; i++)
+		{
+			if (1 == started[i] && SUCCEED == zbx_ipmi_async_check(requests[i], now))
+			{
+				started[i] = 2;
+				finished_num++;
+			}
+		}
+	}
+
+	if (ZBX_MOCK_END_OF_VECTOR != zbx_mock_vector_element(hoperations, &hvalue))
+		fail_msg("Expected IPMI operation #%d was not performed", operations_num + 1);
+
+	hresults = zbx_mock_get_parameter_handle("out.results");
+
+	for (i = 0; i < requests_num; i++)
+	{
+		if (ZBX_MOCK_SUCCESS != (err = zbx_mock_vector_element(hresults, &hresult)))
+			fail_msg("Cannot read result #%d: %s", i + 1, zbx_mock_error_string(err));
+
+		zbx_snprintf(msg, sizeof(msg), "request #%d error code", i + 1);
+		zbx_mock_assert_result_eq(msg, zbx_mock_str_to_return_code(
+				zbx_mock_get_object_member_string(hresult, "errcode")),
+				zbx_ipmi_async_result(requests[i], &value));
+
+		zbx_snprintf(msg, sizeof(msg), "request #%d value", i + 1);
+		zbx_mock_assert_str_eq(msg, zbx_mock_get_object_member_string(hresult, "value"),
+				ZBX_NULL2EMPTY_STR(value));
+
+		zbx_ipmi_async_free(requests[i]);
+	}
+
+	zbx_free_ipmi_handler();
+
+	for (i = 0; i < domains_num; i++)
+	{
+		zbx_free(domains[i].addr);
+		zbx_free(domains[i].name);
+	}
+}
@@ -0,0 +1,243 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+#include "zbxmockjson.h"
+
+#include "common.h"
+#include "comms.h"
+#include "sysinfo.h"
+#include "../../../src/zabbix_server/poller/checks_agent.h"
+
+extern int	CONFIG_TIMEOUT;
+
+static int			requests_num, responses_num, connections_num;
+static zbx_mock_handle_t	hrequests, hresponses;
+
+int	__wrap_zbx_tcp_connect(zbx_socket_t *s, const char *source_ip, const char *ip, unsigned short port, int timeout,
+		unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2)
+{
+	ZBX_UNUSED(source_ip);
+	ZBX_UNUSED(ip);
+	ZBX_UNUSED(port);
+	ZBX_UNUSED(timeout);
+	ZBX_UNUSED(tls_connect);
+	ZBX_UNUSED(tls_arg1);
+	ZBX_UNUSED(tls_arg2);
+
+	memset(s, 0, sizeof(zbx_socket_t));
+	connections_num++;
+
+	return SUCCEED;
+}
+
+int	__wrap_zbx_tcp_send_ext(zbx_socket_t *s, const char *data, size_t len, unsigned char flags, int timeout)
+{
+	zbx_mock_handle_t	hrequest;
+	const char		*expected;
+	char			msg[MAX_STRING_LEN];
+
+	ZBX_UNUSED(s);
+	ZBX_UNUSED(len);
+	ZBX_UNUSED(flags);
+	ZBX_UNUSED(timeout);
+
+	requests_num++;
+
+	if (ZBX_MOCK_SUCCESS != zbx_mock_vector_element(hrequests, &hrequest) ||
+			ZBX_MOCK_SUCCESS != zbx_mock_string(hrequest, &expected))
+	{
+		fail_msg("Unexpected request #%d to agent: %s", requests_num, data);
+	}
+
+	zbx_snprintf(msg, sizeof(msg), "request #%d to agent", requests_num);
+
+	if ('{' == *expected)
+		zbx_mock_assert_json_eq(msg, expected, data);
+	else
+		zbx_mock_assert_str_eq(msg, expected, data);
+
+	return SUCCEED;
+}
+
+ssize_t	__wrap_zbx_tcp_recv_ext(zbx_socket_t *s, int timeout)
+{
+	zbx_mock_handle_t	hresponse, hdata;
+	const char		*fail;
+
+	ZBX_UNUSED(timeout);
+
+	responses_num++;
+
+	if (ZBX_MOCK_SUCCESS != zbx_mock_vector_element(hresponses, &hresponse))
+		fail_msg("Unexpected wait for response #%d from agent", responses_num);
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hresponse, "fail", &hdata))
+	{
+		if (ZBX_MOCK_SUCCESS != zbx_mock_string(hdata, &fail))
+			fail_msg("Cannot read failure of response #%d", responses_num);
+
+		if (0 == strcmp(fail, "timeout"))
+			zbx_alarm_flag_set();
+		else if (0 != strcmp(fail, "network"))
+			fail_msg("Unknown failure \"%s\" of response #%d", fail, responses_num);
+
+		return FAIL;
+	}
+
+	s->buffer = (char *)zbx_mock_get_object_member_string(hresponse, "data");
+	s->read_bytes = strlen(s->buffer);
+
+	return (ssize_t)s->read_bytes;
+}
+
+void	__wrap_zbx_tcp_close(zbx_socket_t *s)
+{
+	ZBX_UNUSED(s);
+}
+
+unsigned int	__wrap_zbx_alarm_on(unsigned int seconds)
+{
+	/* every request or response is given the same time as a single passive check */
+	zbx_mock_assert_uint64_eq("alarm timeout", (zbx_uint64_t)CONFIG_TIMEOUT, seconds);
+	zbx_alarm_flag_clear();
+
+	return 0;
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_mock_handle_t	hitems, hitem, hresults, hresult, hvalue;
+	zbx_mock_error_t	err;
+	DC_ITEM			*items = NULL;
+	AGENT_RESULT		*results;
+	int			*errcodes, i, num = 0, polls = 1;
+	char			msg[MAX_STRING_LEN];
+
+	ZBX_UNUSED(state);
+
+	hitems = zbx_mock_get_parameter_handle("in.items");
+	hresponses = zbx_mock_get_parameter_handle("in.responses");
+	hrequests = zbx_mock_get_parameter_handle("out.requests");
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter_exists("in.polls"))
+		polls = (int)zbx_mock_get_parameter_uint64("in.polls");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hitems, &hitem)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read item #%d: %s", num + 1, zbx_mock_error_string(err));
+
+		items = (DC_ITEM *)zbx_realloc(items, sizeof(DC_ITEM) * (num + 1));
+		memset(&items[num], 0, sizeof(DC_ITEM));
+
+		items[num].key = zbx_strdup(NULL, zbx_mock_get_object_member_string(hitem, "key"));
+		items[num].interface.interfaceid = 1;
+		zbx_strlcpy(items[num].interface.ip_orig, "127.0.0.1", sizeof(items[num].interface.ip_orig));
+		items[num].interface.addr = items[num].interface.ip_orig;
+		items[num].interface.port = 10050;
+		items[num].host.tls_connect = ZBX_TCP_SEC_UNENCRYPTED;
+		num++;
+	}
+
+	results = (AGENT_RESULT *)zbx_malloc(NULL, sizeof(AGENT_RESULT) * num);
+	errcodes = (int *)zbx_malloc(NULL, sizeof(int) * num);
+
+	for (i = 0; i < num; i++)
+		init_result(&results[i]);
+
+	while (0 < polls--)
+	{
+		hitems = zbx_mock_get_parameter_handle("in.items");
+
+		for (i = 0; i < num; i++)
+		{
+			free_result(&results[i]);
+			init_result(&results[i]);
+
+			if (ZBX_MOCK_SUCCESS != zbx_mock_vector_element(hitems, &hitem))
+				fail_msg("Cannot read item #%d", i + 1);
+
+			if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hitem, "errcode", &hvalue))
+			{
+				errcodes[i] = zbx_mock_str_to_return_code(zbx_mock_get_object_member_string(hitem,
+						"errcode"));
+			}
+			else
+				errcodes[i] = SUCCEED;
+		}
+
+		get_values_agent(items, results, errcodes, num);
+	}
+
+	if (ZBX_MOCK_END_OF_VECTOR != zbx_mock_vector_element(hrequests, &hvalue))
+		fail_msg("Expected request #%d to agent was not sent", requests_num + 1);
+
+	if (ZBX_MOCK_END_OF_VECTOR != zbx_mock_vector_element(hresponses, &hvalue))
+		fail_msg("Response #%d from agent was not received", responses_num + 1);
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter_exists("out.connections"))
+	{
+		zbx_mock_assert_int_eq("number of connections to agent",
+				(int)zbx_mock_get_parameter_uint64("out.connections"), connections_num);
+	}
+
+	hresults = zbx_mock_get_parameter_handle("out.results");
+
+	for (i = 0; i < num; i++)
+	{
+		if (ZBX_MOCK_SUCCESS != (err = zbx_mock_vector_element(hresults, &hresult)))
+			fail_msg("Cannot read result #%d: %s", i + 1, zbx_mock_error_string(err));
+
+		zbx_snprintf(msg, sizeof(msg), "item #%d error code", i + 1);
+		zbx_mock_assert_result_eq(msg, zbx_mock_str_to_return_code(
+				zbx_mock_get_object_member_string(hresult, "errcode")), errcodes[i]);
+
+		if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hresult, "value", &hvalue))
+		{
+			zbx_snprintf(msg, sizeof(msg), "item #%d value", i + 1);
+
+			if (!ISSET_TEXT(&results[i]))
+				fail_msg("%s is not set", msg);
+
+			zbx_mock_assert_str_eq(msg, zbx_mock_get_object_member_string(hresult, "value"),
+					results[i].text);
+		}
+
+		if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hresult, "error", &hvalue))
+		{
+			zbx_snprintf(msg, sizeof(msg), "item #%d error", i + 1);
+
+			if (!ISSET_MSG(&results[i]))
+				fail_msg("%s is not set", msg);
+
+			zbx_mock_assert_str_eq(msg, zbx_mock_get_object_member_string(hresult, "error"), results[i].msg);
+		}
+
+		free_result(&results[i]);
+		zbx_free(items[i].key);
+	}
+
+	zbx_free(errcodes);
+	zbx_free(results);
+	zbx_free(items);
+}
@@ -0,0 +1,184 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+#include "zbxmockjson.h"
+
+#include "common.h"
+#include "comms.h"
+#include "sysinfo.h"
+#include "../../../src/zabbix_server/poller/checks_java.h"
+
+static int	requests_num;
+
+int	__wrap_zbx_tcp_connect(zbx_socket_t *s, const char *source_ip, const char *ip, unsigned short port, int timeout,
+		unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2)
+{
+	ZBX_UNUSED(source_ip);
+	ZBX_UNUSED(ip);
+	ZBX_UNUSED(port);
+	ZBX_UNUSED(timeout);
+	ZBX_UNUSED(tls_connect);
+	ZBX_UNUSED(tls_arg1);
+	ZBX_UNUSED(tls_arg2);
+
+	memset(s, 0, sizeof(zbx_socket_t));
+
+	return SUCCEED;
+}
+
+int	__wrap_zbx_tcp_send_ext(zbx_socket_t *s, const char *data, size_t len, unsigned char flags, int timeout)
+{
+	ZBX_UNUSED(s);
+	ZBX_UNUSED(len);
+	ZBX_UNUSED(flags);
+	ZBX_UNUSED(timeout);
+
+	if (0 != requests_num++)
+		fail_msg("Unexpected request to Java gateway: %s", data);
+
+	if (ZBX_MOCK_SUCCESS != zbx_mock_parameter_exists("out.request"))
+		fail_msg("Unexpected request to Java gateway: %s", data);
+
+	zbx_mock_assert_json_eq("request to Java gateway", zbx_mock_get_parameter_string("out.request"), data);
+
+	return SUCCEED;
+}
+
+ssize_t	__wrap_zbx_tcp_recv_ext(zbx_socket_t *s, int timeout)
+{
+	ZBX_UNUSED(timeout);
+
+	s->buffer = (char *)zbx_mock_get_parameter_string("in.response");
+	s->read_bytes = strlen(s->buffer);
+
+	return (ssize_t)s->read_bytes;
+}
+
+void	__wrap_zbx_tcp_close(zbx_socket_t *s)
+{
+	ZBX_UNUSED(s);
+}
+
+static char	*get_item_field(zbx_mock_handle_t hitem, const char *name)
+{
+	zbx_mock_handle_t	hfield;
+	const char		*value;
+
+	if (ZBX_MOCK_SUCCESS != zbx_mock_object_member(hitem, name, &hfield))
+		return zbx_strdup(NULL, "");
+
+	if (ZBX_MOCK_SUCCESS != zbx_mock_string(hfield, &value))
+		fail_msg("Cannot read item field \"%s\"", name);
+
+	return zbx_strdup(NULL, value);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_mock_handle_t	hitems, hitem, hresults, hresult, hvalue;
+	zbx_mock_error_t	err;
+	DC_ITEM			*items = NULL;
+	AGENT_RESULT		*results;
+	int			*errcodes, i, num = 0;
+	char			msg[MAX_STRING_LEN];
+
+	ZBX_UNUSED(state);
+
+	CONFIG_JAVA_GATEWAY = zbx_strdup(NULL, "127.0.0.1");
+	CONFIG_JAVA_GATEWAY_MULTI_ENDPOINT = (int)zbx_mock_get_parameter_uint64("in.multi_endpoint");
+
+	hitems = zbx_mock_get_parameter_handle("in.items");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hitems, &hitem)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read item #%d: %s", num + 1, zbx_mock_error_string(err));
+
+		items = (DC_ITEM *)zbx_realloc(items, sizeof(DC_ITEM) * (num + 1));
+		memset(&items[num], 0, sizeof(DC_ITEM));
+
+		items[num].key = get_item_field(hitem, "key");
+		items[num].username = get_item_field(hitem, "username");
+		items[num].password = get_item_field(hitem, "password");
+		items[num].jmx_endpoint = get_item_field(hitem, "jmx_endpoint");
+		num++;
+	}
+
+	results = (AGENT_RESULT *)zbx_malloc(NULL, sizeof(AGENT_RESULT) * num);
+	errcodes = (int *)zbx_malloc(NULL, sizeof(int) * num);
+
+	for (i = 0; i < num; i++)
+	{
+		init_result(&results[i]);
+		errcodes[i] = SUCCEED;
+	}
+
+	get_values_java(ZBX_JAVA_GATEWAY_REQUEST_JMX, items, results, errcodes, num);
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter_exists("out.request"))
+		zbx_mock_assert_int_eq("number of requests to Java gateway", 1, requests_num);
+
+	hresults = zbx_mock_get_parameter_handle("out.results");
+
+	for (i = 0; i < num; i++)
+	{
+		if (ZBX_MOCK_SUCCESS != (err = zbx_mock_vector_element(hresults, &hresult)))
+			fail_msg("Cannot read result #%d: %s", i + 1, zbx_mock_error_string(err));
+
+		zbx_snprintf(msg, sizeof(msg), "item #%d error code", i + 1);
+		zbx_mock_assert_result_eq(msg, zbx_mock_str_to_return_code(
+				zbx_mock_get_object_member_string(hresult, "errcode")), errcodes[i]);
+
+		if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hresult, "value", &hvalue))
+		{
+			zbx_snprintf(msg, sizeof(msg), "item #%d value", i + 1);
+
+			if (!ISSET_TEXT(&results[i]))
+				fail_msg("%s is not set", msg);
+
+			zbx_mock_assert_str_eq(msg, zbx_mock_get_object_member_string(hresult, "value"),
+					results[i].text);
+		}
+
+		if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hresult, "error", &hvalue))
+		{
+			zbx_snprintf(msg, sizeof(msg), "item #%d error", i + 1);
+
+			if (!ISSET_MSG(&results[i]))
+				fail_msg("%s is not set", msg);
+
+			zbx_mock_assert_str_eq(msg, zbx_mock_get_object_member_string(hresult, "error"), results[i].msg);
+		}
+
+		free_result(&results[i]);
+		zbx_free(items[i].key);
+		zbx_free(items[i].username);
+		zbx_free(items[i].password);
+		zbx_free(items[i].jmx_endpoint);
+	}
+
+	zbx_free(errcodes);
+	zbx_free(results);
+	zbx_free(items);
+	zbx_free(CONFIG_JAVA_GATEWAY);
+}
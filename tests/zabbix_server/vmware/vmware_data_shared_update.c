@@ -0,0 +1,204 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "zbxalgo.h"
+#include "../../../src/zabbix_server/vmware/vmware.h"
+#include "vmware_test.h"
+
+extern zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE;
+
+static unsigned char	str_to_service_type(const char *str)
+{
+	if (0 == strcmp(str, "vsphere"))
+		return ZBX_VMWARE_TYPE_VSPHERE;
+
+	if (0 == strcmp(str, "vcenter"))
+		return ZBX_VMWARE_TYPE_VCENTER;
+
+	fail_msg("Unknown vmware service type \"%s\"", str);
+
+	return ZBX_VMWARE_TYPE_UNKNOWN;
+}
+
+static void	read_inventory(zbx_mock_handle_t hinventory, zbx_vmware_data_t *data)
+{
+	zbx_mock_handle_t	hhv, hvms, hvm;
+	zbx_mock_error_t	err;
+	const char		*hvid;
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hinventory, &hhv)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read hypervisor: %s", zbx_mock_error_string(err));
+
+		hvid = zbx_mock_get_object_member_string(hhv, "id");
+		vmware_test_data_add_hv(data, hvid, zbx_mock_get_object_member_string(hhv, "uuid"),
+				zbx_mock_get_object_member_string(hhv, "name"));
+
+		hvms = zbx_mock_get_object_member_handle(hhv, "vms");
+
+		while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hvms, &hvm)))
+		{
+			if (ZBX_MOCK_SUCCESS != err)
+				fail_msg("Cannot read virtual machine: %s", zbx_mock_error_string(err));
+
+			vmware_test_data_add_vm(data, hvid, zbx_mock_get_object_member_string(hvm, "id"),
+					zbx_mock_get_object_member_string(hvm, "uuid"),
+					zbx_mock_get_object_member_string(hvm, "name"));
+		}
+	}
+}
+
+static zbx_vmware_hv_t	*find_hv(zbx_vmware_data_t *data, const char *id)
+{
+	zbx_hashset_iter_t	iter;
+	zbx_vmware_hv_t		*hv;
+
+	zbx_hashset_iter_reset(&data->hvs, &iter);
+	while (NULL != (hv = (zbx_vmware_hv_t *)zbx_hashset_iter_next(&iter)))
+	{
+		if (0 == strcmp(hv->id, id))
+			return hv;
+	}
+
+	return NULL;
+}
+
+static zbx_vmware_vm_t	*find_vm(zbx_vmware_hv_t *hv, const char *id)
+{
+	int	i;
+
+	for (i = 0; i < hv->vms.values_num; i++)
+	{
+		zbx_vmware_vm_t	*vm = (zbx_vmware_vm_t *)hv->vms.values[i];
+
+		if (0 == strcmp(vm->id, id))
+			return vm;
+	}
+
+	return NULL;
+}
+
+static void	check_inventory(zbx_mock_handle_t hinventory, zbx_vmware_data_t *data)
+{
+	zbx_mock_handle_t	hhv, hvms, hvm;
+	zbx_mock_error_t	err;
+	zbx_vmware_hv_t		*hv;
+	zbx_vmware_vm_t		*vm;
+	zbx_vmware_vm_index_t	vmi_local, *vmi;
+	const char		*id;
+	int			hvs_num = 0, vms_num = 0, hv_vms_num;
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hinventory, &hhv)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read hypervisor: %s", zbx_mock_error_string(err));
+
+		id = zbx_mock_get_object_member_string(hhv, "id");
+
+		if (NULL == (hv = find_hv(data, id)))
+			fail_msg("Hypervisor \"%s\" was not found", id);
+
+		zbx_mock_assert_str_eq("hypervisor name", zbx_mock_get_object_member_string(hhv, "name"),
+				ZBX_NULL2EMPTY_STR(hv->props[ZBX_VMWARE_HVPROP_NAME]));
+
+		hvms = zbx_mock_get_object_member_handle(hhv, "vms");
+		hv_vms_num = 0;
+
+		while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hvms, &hvm)))
+		{
+			if (ZBX_MOCK_SUCCESS != err)
+				fail_msg("Cannot read virtual machine: %s", zbx_mock_error_string(err));
+
+			id = zbx_mock_get_object_member_string(hvm, "id");
+
+			if (NULL == (vm = find_vm(hv, id)))
+				fail_msg("Virtual machine \"%s\" was not found on hypervisor \"%s\"", id, hv->id);
+
+			zbx_mock_assert_str_eq("virtual machine uuid", zbx_mock_get_object_member_string(hvm, "uuid"),
+					ZBX_NULL2EMPTY_STR(vm->uuid));
+			zbx_mock_assert_str_eq("virtual machine name", zbx_mock_get_object_member_string(hvm, "name"),
+					ZBX_NULL2EMPTY_STR(vm->props[ZBX_VMWARE_VMPROP_NAME]));
+
+			/* the virtual machine must be found by uuid on the same hypervisor */
+			vmi_local.vm = vm;
+
+			if (NULL == (vmi = (zbx_vmware_vm_index_t *)zbx_hashset_search(&data->vms_index, &vmi_local)))
+				fail_msg("Virtual machine \"%s\" is not indexed", id);
+
+			zbx_mock_assert_ptr_eq("indexed virtual machine", vm, vmi->vm);
+			zbx_mock_assert_ptr_eq("indexed virtual machine hypervisor", hv, vmi->hv);
+
+			hv_vms_num++;
+		}
+
+		zbx_mock_assert_int_eq("hypervisor virtual machine count", hv_vms_num, hv->vms.values_num);
+
+		vms_num += hv_vms_num;
+		hvs_num++;
+	}
+
+	zbx_mock_assert_int_eq("hypervisor count", hvs_num, data->hvs.num_data);
+	zbx_mock_assert_int_eq("virtual machine index size", vms_num, data->vms_index.num_data);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_vmware_data_t	*local, *data;
+	char			*version, *error = NULL;
+	int			ret, truncated;
+
+	ZBX_UNUSED(state);
+
+	CONFIG_VMWARE_CACHE_SIZE = 8 * ZBX_MEBIBYTE;
+
+	if (SUCCEED != zbx_vmware_init(&error))
+		fail_msg("Cannot initialize vmware cache: %s", error);
+
+	local = vmware_test_data_create();
+	read_inventory(zbx_mock_get_parameter_handle("in.inventory"), local);
+	data = vmware_test_data_shared_dup(local);
+	vmware_test_data_free(local);
+
+	version = zbx_strdup(NULL, zbx_mock_get_parameter_string("in.version"));
+
+	ret = vmware_test_data_shared_update(data, str_to_service_type(zbx_mock_get_parameter_string("in.type")),
+			zbx_mock_get_parameter_string("in.response"), &version, &truncated);
+
+	zbx_mock_assert_result_eq("incremental update result",
+			zbx_mock_str_to_return_code(zbx_mock_get_parameter_string("out.return")), ret);
+	zbx_mock_assert_str_eq("update version", zbx_mock_get_parameter_string("out.version"), version);
+	zbx_mock_assert_int_eq("truncated flag", (int)zbx_mock_get_parameter_uint64("out.truncated"), truncated);
+
+	if (SUCCEED == ret)
+		check_inventory(zbx_mock_get_parameter_handle("out.inventory"), data);
+
+	vmware_test_data_shared_free(data);
+
+	/* all shared strings must be released after the inventory is freed */
+	zbx_mock_assert_int_eq("shared string count", 0, vmware_test_get_strpool_num());
+
+	zbx_free(version);
+}
@@ -0,0 +1,250 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "zbxalgo.h"
+#include "../../../src/zabbix_server/vmware/vmware.h"
+#include "vmware_test.h"
+
+extern zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE;
+
+static const char	*get_optional_member_string(zbx_mock_handle_t object, const char *name)
+{
+	zbx_mock_handle_t	hmember;
+	zbx_mock_error_t	err;
+	const char		*value;
+
+	if (ZBX_MOCK_SUCCESS != zbx_mock_object_member(object, name, &hmember))
+		return NULL;
+
+	if (ZBX_MOCK_SUCCESS != (err = zbx_mock_string(hmember, &value)))
+		fail_msg("Cannot read \"%s\": %s", name, zbx_mock_error_string(err));
+
+	return value;
+}
+
+static void	read_perf_data(zbx_mock_handle_t hperfdata, zbx_vector_ptr_t *perfdata)
+{
+	zbx_mock_handle_t	hdata, hvalues, hvalue;
+	zbx_mock_error_t	err;
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hperfdata, &hdata)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read performance data: %s", zbx_mock_error_string(err));
+
+		vmware_test_perf_data_add(perfdata, zbx_mock_get_object_member_string(hdata, "type"),
+				zbx_mock_get_object_member_string(hdata, "id"),
+				get_optional_member_string(hdata, "error"));
+
+		if (ZBX_MOCK_SUCCESS != zbx_mock_object_member(hdata, "values", &hvalues))
+			continue;
+
+		while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hvalues, &hvalue)))
+		{
+			if (ZBX_MOCK_SUCCESS != err)
+				fail_msg("Cannot read performance value: %s", zbx_mock_error_string(err));
+
+			vmware_test_perf_data_add_value(perfdata,
+					zbx_mock_get_object_member_uint64(hvalue, "counterid"),
+					zbx_mock_get_object_member_string(hvalue, "instance"),
+					zbx_mock_get_object_member_uint64(hvalue, "value"));
+		}
+	}
+}
+
+/* looks up counter value the same way as vmware simple checks do */
+static int	get_counter_value(zbx_vmware_perf_entity_t *entity, zbx_uint64_t counterid, const char *instance,
+		zbx_uint64_t *value)
+{
+	zbx_vmware_perf_counter_t	*perfcounter;
+	int				i;
+
+	if (FAIL == (i = zbx_vector_ptr_bsearch(&entity->counters, &counterid, ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC)))
+		fail_msg("Performance counter " ZBX_FS_UI64 " was not found", counterid);
+
+	perfcounter = (zbx_vmware_perf_counter_t *)entity->counters.values[i];
+
+	if (0 == perfcounter->values.values_num)
+		return FAIL;
+
+	if (FAIL == (i = zbx_vector_str_bsearch(perfcounter->instances, (char *)instance,
+			ZBX_DEFAULT_STR_COMPARE_FUNC)))
+	{
+		return FAIL;
+	}
+
+	*value = perfcounter->values.values[i];
+
+	return SUCCEED;
+}
+
+static void	check_entity(zbx_vmware_service_t *service, zbx_mock_handle_t hentity)
+{
+	zbx_mock_handle_t		hvalues, hvalue;
+	zbx_mock_error_t		err;
+	zbx_vmware_perf_entity_t	*entity;
+	const char			*type, *id, *instance;
+	zbx_uint64_t			counterid, value;
+	char				msg[MAX_STRING_LEN];
+
+	type = zbx_mock_get_object_member_string(hentity, "type");
+	id = zbx_mock_get_object_member_string(hentity, "id");
+
+	if (NULL == (entity = zbx_vmware_service_get_perf_entity(service, type, id)))
+		fail_msg("Performance entity %s:%s was not found", type, id);
+
+	zbx_snprintf(msg, sizeof(msg), "%s:%s error", type, id);
+	zbx_mock_assert_str_eq(msg, ZBX_NULL2EMPTY_STR(get_optional_member_string(hentity, "error")),
+			ZBX_NULL2EMPTY_STR(entity->error));
+
+	zbx_snprintf(msg, sizeof(msg), "%s:%s instance count", type, id);
+	zbx_mock_assert_int_eq(msg, (int)zbx_mock_get_object_member_uint64(hentity, "instances"),
+			entity->instances.values_num);
+
+	/* counters with the same instances must share the instance set */
+	zbx_snprintf(msg, sizeof(msg), "%s:%s instance set count", type, id);
+	zbx_mock_assert_int_eq(msg, (int)zbx_mock_get_object_member_uint64(hentity, "instancesets"),
+			entity->instancesets.values_num);
+
+	hvalues = zbx_mock_get_object_member_handle(hentity, "values");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hvalues, &hvalue)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read performance value: %s", zbx_mock_error_string(err));
+
+		counterid = zbx_mock_get_object_member_uint64(hvalue, "counterid");
+		instance = zbx_mock_get_object_member_string(hvalue, "instance");
+
+		if (SUCCEED != get_counter_value(entity, counterid, instance, &value))
+		{
+			fail_msg("Value of %s:%s counter " ZBX_FS_UI64 " instance \"%s\" was not found", type, id,
+					counterid, instance);
+		}
+
+		zbx_snprintf(msg, sizeof(msg), "%s:%s counter " ZBX_FS_UI64 " instance \"%s\"", type, id, counterid,
+				instance);
+		zbx_mock_assert_uint64_eq(msg, zbx_mock_get_object_member_uint64(hvalue, "value"), value);
+	}
+
+	/* counters keep values only for their own instances */
+	hvalues = zbx_mock_get_object_member_handle(hentity, "missing");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hvalues, &hvalue)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read missing performance value: %s", zbx_mock_error_string(err));
+
+		counterid = zbx_mock_get_object_member_uint64(hvalue, "counterid");
+		instance = zbx_mock_get_object_member_string(hvalue, "instance");
+
+		if (SUCCEED == get_counter_value(entity, counterid, instance, &value))
+		{
+			fail_msg("Unexpected value of %s:%s counter " ZBX_FS_UI64 " instance \"%s\"", type, id,
+					counterid, instance);
+		}
+	}
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_mock_handle_t	hcounters, hcounter, hupdates, hupdate, hentities, hentity;
+	zbx_mock_error_t	err;
+	zbx_vmware_service_t	*service;
+	zbx_vector_ptr_t	perfdata;
+	zbx_vmware_diag_stats_t	stats;
+	zbx_mem_stats_t		mem;
+	char			*error = NULL;
+
+	ZBX_UNUSED(state);
+
+	CONFIG_VMWARE_CACHE_SIZE = 8 * ZBX_MEBIBYTE;
+
+	if (SUCCEED != zbx_locks_create(&error))
+		fail_msg("Cannot create locks: %s", error);
+
+	if (SUCCEED != zbx_vmware_init(&error))
+		fail_msg("Cannot initialize vmware cache: %s", error);
+
+	zbx_vmware_lock();
+	zbx_vmware_get_service("https://vc1.example.com/sdk", "user1", "secret");
+	zbx_vmware_unlock();
+
+	service = (zbx_vmware_service_t *)vmware_test_get_services()->values[0];
+
+	hcounters = zbx_mock_get_parameter_handle("in.counters");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hcounters, &hcounter)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read performance counter: %s", zbx_mock_error_string(err));
+
+		zbx_vmware_service_add_perf_counter(service, zbx_mock_get_object_member_string(hcounter, "type"),
+				zbx_mock_get_object_member_string(hcounter, "id"),
+				zbx_mock_get_object_member_uint64(hcounter, "counterid"),
+				zbx_mock_get_object_member_string(hcounter, "instance"));
+	}
+
+	/* each update replaces the performance data of the previous one */
+	zbx_vector_ptr_create(&perfdata);
+	hupdates = zbx_mock_get_parameter_handle("in.updates");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hupdates, &hupdate)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read performance data update: %s", zbx_mock_error_string(err));
+
+		read_perf_data(hupdate, &perfdata);
+		vmware_test_service_update_perf(service, &perfdata);
+		vmware_test_perf_data_free(&perfdata);
+	}
+
+	zbx_vector_ptr_destroy(&perfdata);
+
+	hentities = zbx_mock_get_parameter_handle("out.entities");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hentities, &hentity)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read performance entity: %s", zbx_mock_error_string(err));
+
+		check_entity(service, hentity);
+	}
+
+	if (SUCCEED != zbx_vmware_get_diag_stats(&stats, &mem))
+		fail_msg("Cannot get vmware cache statistics");
+
+	zbx_mock_assert_uint64_eq("entity count", zbx_mock_get_parameter_uint64("out.stats.entities"),
+			stats.entities_num);
+	zbx_mock_assert_uint64_eq("instance count", zbx_mock_get_parameter_uint64("out.stats.instances"),
+			stats.instances_num);
+	zbx_mock_assert_uint64_eq("value count", zbx_mock_get_parameter_uint64("out.stats.values"),
+			stats.values_num);
+
+	vmware_test_service_remove(service);
+
+	/* all instance names must be released with the service */
+	zbx_mock_assert_int_eq("shared string count", 0, vmware_test_get_strpool_num());
+}
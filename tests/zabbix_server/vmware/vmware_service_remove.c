@@ -0,0 +1,198 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "zbxalgo.h"
+#include "../../../src/zabbix_server/vmware/vmware.h"
+#include "vmware_test.h"
+
+extern zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE;
+
+static const char	*get_optional_member_string(zbx_mock_handle_t object, const char *name)
+{
+	zbx_mock_handle_t	hmember;
+	zbx_mock_error_t	err;
+	const char		*value;
+
+	if (ZBX_MOCK_SUCCESS != zbx_mock_object_member(object, name, &hmember))
+		return NULL;
+
+	if (ZBX_MOCK_SUCCESS != (err = zbx_mock_string(hmember, &value)))
+		fail_msg("Cannot read \"%s\": %s", name, zbx_mock_error_string(err));
+
+	return value;
+}
+
+static zbx_vmware_service_t	*find_service(const char *username)
+{
+	const zbx_vector_ptr_t	*services;
+	int			i;
+
+	services = vmware_test_get_services();
+
+	for (i = 0; i < services->values_num; i++)
+	{
+		zbx_vmware_service_t	*service = (zbx_vmware_service_t *)services->values[i];
+
+		if (0 == strcmp(service->username, username))
+			return service;
+	}
+
+	return NULL;
+}
+
+/* adds vmware service with inventory of one hypervisor and its virtual machines */
+static void	add_service(zbx_mock_handle_t hservice)
+{
+	zbx_mock_handle_t	hvms, hvm, hcounters, hcounter;
+	zbx_mock_error_t	err;
+	zbx_vmware_service_t	*service;
+	zbx_vmware_data_t	*data;
+	const char		*username;
+
+	username = zbx_mock_get_object_member_string(hservice, "username");
+
+	zbx_vmware_lock();
+	zbx_vmware_get_service(zbx_mock_get_object_member_string(hservice, "url"), username,
+			zbx_mock_get_object_member_string(hservice, "password"));
+	zbx_vmware_unlock();
+
+	if (NULL == (service = find_service(username)))
+		fail_msg("Service of user \"%s\" was not created", username);
+
+	data = vmware_test_data_create();
+	vmware_test_data_add_hv(data, "host-1", "hv-uuid-1", "esx1");
+
+	hvms = zbx_mock_get_object_member_handle(hservice, "vms");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hvms, &hvm)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read virtual machine: %s", zbx_mock_error_string(err));
+
+		vmware_test_data_add_vm(data, "host-1", zbx_mock_get_object_member_string(hvm, "id"),
+				zbx_mock_get_object_member_string(hvm, "uuid"),
+				zbx_mock_get_object_member_string(hvm, "name"));
+	}
+
+	vmware_test_service_set_data(service, data, get_optional_member_string(hservice, "session"),
+			get_optional_member_string(hservice, "version"));
+	vmware_test_data_free(data);
+
+	hcounters = zbx_mock_get_object_member_handle(hservice, "counters");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hcounters, &hcounter)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read performance counter: %s", zbx_mock_error_string(err));
+
+		zbx_vmware_service_add_perf_counter(service, "VirtualMachine",
+				zbx_mock_get_object_member_string(hcounter, "id"),
+				zbx_mock_get_object_member_uint64(hcounter, "counterid"),
+				zbx_mock_get_object_member_string(hcounter, "instance"));
+	}
+}
+
+static void	remove_service(const char *username)
+{
+	zbx_vmware_service_t	*service;
+
+	if (NULL == (service = find_service(username)))
+		fail_msg("Service of user \"%s\" was not found", username);
+
+	vmware_test_service_remove(service);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_mock_handle_t	hservices, hservice, husers, huser;
+	zbx_mock_error_t	err;
+	zbx_vmware_service_t	*service;
+	const char		*username;
+	char			*error = NULL;
+	int			services_num = 0;
+
+	ZBX_UNUSED(state);
+
+	CONFIG_VMWARE_CACHE_SIZE = 8 * ZBX_MEBIBYTE;
+
+	if (SUCCEED != zbx_locks_create(&error))
+		fail_msg("Cannot create locks: %s", error);
+
+	if (SUCCEED != zbx_vmware_init(&error))
+		fail_msg("Cannot initialize vmware cache: %s", error);
+
+	hservices = zbx_mock_get_parameter_handle("in.services");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hservices, &hservice)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read service: %s", zbx_mock_error_string(err));
+
+		add_service(hservice);
+	}
+
+	husers = zbx_mock_get_parameter_handle("in.remove");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(husers, &huser)))
+	{
+		if (ZBX_MOCK_SUCCESS != err || ZBX_MOCK_SUCCESS != (err = zbx_mock_string(huser, &username)))
+			fail_msg("Cannot read removed service user: %s", zbx_mock_error_string(err));
+
+		remove_service(username);
+	}
+
+	/* the remaining services must keep their shared data intact */
+	hservices = zbx_mock_get_parameter_handle("out.services");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hservices, &hservice)))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read service: %s", zbx_mock_error_string(err));
+
+		username = zbx_mock_get_object_member_string(hservice, "username");
+
+		if (NULL == (service = find_service(username)))
+			fail_msg("Service of user \"%s\" was not found", username);
+
+		zbx_mock_assert_str_eq("service url", zbx_mock_get_object_member_string(hservice, "url"), service->url);
+		zbx_mock_assert_int_eq("service hypervisor count", 1, service->data->hvs.num_data);
+		zbx_mock_assert_int_eq("service virtual machine count",
+				(int)zbx_mock_get_object_member_uint64(hservice, "vms"),
+				service->data->vms_index.num_data);
+		zbx_mock_assert_int_eq("service performance entity count",
+				(int)zbx_mock_get_object_member_uint64(hservice, "entities"),
+				service->entities.num_data);
+
+		services_num++;
+	}
+
+	zbx_mock_assert_int_eq("service count", services_num, vmware_test_get_services()->values_num);
+
+	while (0 != vmware_test_get_services()->values_num)
+		vmware_test_service_remove((zbx_vmware_service_t *)vmware_test_get_services()->values[0]);
+
+	/* all shared strings must be released after the services are removed */
+	zbx_mock_assert_int_eq("shared string count", 0, vmware_test_get_strpool_num());
+}
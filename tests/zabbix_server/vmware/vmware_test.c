@@ -0,0 +1,208 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "vmware_test.h"
+
+zbx_vmware_data_t	*vmware_test_data_create(void)
+{
+	zbx_vmware_data_t	*data;
+
+	data = (zbx_vmware_data_t *)zbx_malloc(NULL, sizeof(zbx_vmware_data_t));
+	memset(data, 0, sizeof(zbx_vmware_data_t));
+
+	zbx_hashset_create(&data->hvs, 1, vmware_hv_hash, vmware_hv_compare);
+	zbx_vector_ptr_create(&data->clusters);
+	zbx_vector_ptr_create(&data->events);
+	zbx_vector_vmware_datastore_create(&data->datastores);
+
+	return data;
+}
+
+void	vmware_test_data_free(zbx_vmware_data_t *data)
+{
+	vmware_data_free(data);
+}
+
+void	vmware_test_data_add_hv(zbx_vmware_data_t *data, const char *id, const char *uuid, const char *name)
+{
+	zbx_vmware_hv_t	hv;
+
+	memset(&hv, 0, sizeof(hv));
+
+	hv.id = zbx_strdup(NULL, id);
+	hv.uuid = zbx_strdup(NULL, uuid);
+	hv.props = (char **)zbx_malloc(NULL, sizeof(char *) * ZBX_VMWARE_HVPROPS_NUM);
+	memset(hv.props, 0, sizeof(char *) * ZBX_VMWARE_HVPROPS_NUM);
+	hv.props[ZBX_VMWARE_HVPROP_NAME] = zbx_strdup(NULL, name);
+	zbx_vector_str_create(&hv.ds_names);
+	zbx_vector_ptr_create(&hv.vms);
+
+	zbx_hashset_insert(&data->hvs, &hv, sizeof(hv));
+}
+
+void	vmware_test_data_add_vm(zbx_vmware_data_t *data, const char *hvid, const char *id, const char *uuid,
+		const char *name)
+{
+	zbx_vmware_hv_t	*hv;
+	zbx_vmware_vm_t	*vm;
+
+	if (NULL == (hv = vmware_data_shared_find_hv(data, hvid)))
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		exit(EXIT_FAILURE);
+	}
+
+	vm = (zbx_vmware_vm_t *)zbx_malloc(NULL, sizeof(zbx_vmware_vm_t));
+	memset(vm, 0, sizeof(zbx_vmware_vm_t));
+
+	vm->id = zbx_strdup(NULL, id);
+	vm->uuid = zbx_strdup(NULL, uuid);
+	vm->props = (char **)zbx_malloc(NULL, sizeof(char *) * ZBX_VMWARE_VMPROPS_NUM);
+	memset(vm->props, 0, sizeof(char *) * ZBX_VMWARE_VMPROPS_NUM);
+	vm->props[ZBX_VMWARE_VMPROP_NAME] = zbx_strdup(NULL, name);
+	zbx_vector_ptr_create(&vm->devs);
+	zbx_vector_ptr_create(&vm->file_systems);
+
+	zbx_vector_ptr_append(&hv->vms, vm);
+}
+
+zbx_vmware_data_t	*vmware_test_data_shared_dup(zbx_vmware_data_t *data)
+{
+	return vmware_data_shared_dup(data);
+}
+
+void	vmware_test_data_shared_free(zbx_vmware_data_t *data)
+{
+	vmware_data_shared_free(data);
+}
+
+/* applies WaitForUpdatesEx response to shared inventory like incremental service update does, */
+/* returns FAIL if the changes require full update                                              */
+int	vmware_test_data_shared_update(zbx_vmware_data_t *data, unsigned char type, const char *response,
+		char **version, int *truncated)
+{
+	zbx_vmware_service_t	service;
+	zbx_vmware_data_t	*src;
+	zbx_vector_ptr_t	updates;
+	xmlDoc			*doc;
+	int			ret;
+
+	if (NULL == (doc = xmlReadMemory(response, (int)strlen(response), ZBX_VM_NONAME_XML, NULL,
+			ZBX_XML_PARSE_OPTS)))
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		exit(EXIT_FAILURE);
+	}
+
+	memset(&service, 0, sizeof(service));
+	service.type = type;
+
+	*truncated = 0;
+	zbx_vector_ptr_create(&updates);
+
+	/* the response is empty if there were no changes */
+	vmware_service_parse_updates(&service, doc, &updates, version, truncated);
+
+	if (SUCCEED == (ret = vmware_obj_updates_incremental(&updates)))
+	{
+		src = vmware_test_data_create();
+		vmware_data_shared_update(data, src, &updates);
+		vmware_data_free(src);
+	}
+
+	zbx_vector_ptr_clear_ext(&updates, (zbx_clean_func_t)vmware_obj_update_free);
+	zbx_vector_ptr_destroy(&updates);
+	zbx_xml_free_doc(doc);
+
+	return ret;
+}
+
+const zbx_vector_ptr_t	*vmware_test_get_services(void)
+{
+	return &vmware->services;
+}
+
+void	vmware_test_service_set_data(zbx_vmware_service_t *service, zbx_vmware_data_t *data, const char *session,
+		const char *version)
+{
+	service->data = vmware_data_shared_dup(data);
+	service->session = vmware_shared_strdup(session);
+	service->update_version = vmware_shared_strdup(version);
+	service->state = ZBX_VMWARE_STATE_READY;
+}
+
+void	vmware_test_service_remove(zbx_vmware_service_t *service)
+{
+	vmware_service_remove(service);
+}
+
+int	vmware_test_get_strpool_num(void)
+{
+	return vmware->strpool.num_data;
+}
+
+void	vmware_test_perf_data_add(zbx_vector_ptr_t *perfdata, const char *type, const char *id, const char *error)
+{
+	zbx_vmware_perf_data_t	*data;
+
+	if (NULL != error)
+	{
+		vmware_perf_data_add_error(perfdata, type, id, error);
+		return;
+	}
+
+	data = (zbx_vmware_perf_data_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_data_t));
+	data->type = zbx_strdup(NULL, type);
+	data->id = zbx_strdup(NULL, id);
+	data->error = NULL;
+	zbx_vector_ptr_create(&data->values);
+
+	zbx_vector_ptr_append(perfdata, data);
+}
+
+void	vmware_test_perf_data_add_value(zbx_vector_ptr_t *perfdata, zbx_uint64_t counterid, const char *instance,
+		zbx_uint64_t value)
+{
+	zbx_vmware_perf_data_t	*data;
+	zbx_vmware_perf_value_t	*perfvalue;
+
+	data = (zbx_vmware_perf_data_t *)perfdata->values[perfdata->values_num - 1];
+
+	perfvalue = (zbx_vmware_perf_value_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_value_t));
+	perfvalue->counterid = counterid;
+	perfvalue->instance = zbx_strdup(NULL, instance);
+	perfvalue->value = value;
+
+	zbx_vector_ptr_append(&data->values, perfvalue);
+}
+
+void	vmware_test_perf_data_free(zbx_vector_ptr_t *perfdata)
+{
+	zbx_vector_ptr_clear_ext(perfdata, (zbx_mem_free_func_t)vmware_free_perfdata);
+}
+
+void	vmware_test_service_update_perf(zbx_vmware_service_t *service, zbx_vector_ptr_t *perfdata)
+{
+	zbx_vmware_lock();
+
+	vmware_entities_shared_clean_stats(&service->entities);
+	vmware_service_copy_perf_data(service, perfdata);
+
+	zbx_vmware_unlock();
+}
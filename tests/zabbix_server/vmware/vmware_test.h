@@ -0,0 +1,46 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef VMWARE_TEST_H
+#define VMWARE_TEST_H
+
+zbx_vmware_data_t	*vmware_test_data_create(void);
+void	vmware_test_data_free(zbx_vmware_data_t *data);
+void	vmware_test_data_add_hv(zbx_vmware_data_t *data, const char *id, const char *uuid, const char *name);
+void	vmware_test_data_add_vm(zbx_vmware_data_t *data, const char *hvid, const char *id, const char *uuid,
+		const char *name);
+
+zbx_vmware_data_t	*vmware_test_data_shared_dup(zbx_vmware_data_t *data);
+void	vmware_test_data_shared_free(zbx_vmware_data_t *data);
+int	vmware_test_data_shared_update(zbx_vmware_data_t *data, unsigned char type, const char *response,
+		char **version, int *truncated);
+
+const zbx_vector_ptr_t	*vmware_test_get_services(void);
+void	vmware_test_service_set_data(zbx_vmware_service_t *service, zbx_vmware_data_t *data, const char *session,
+		const char *version);
+void	vmware_test_service_remove(zbx_vmware_service_t *service);
+int	vmware_test_get_strpool_num(void);
+
+void	vmware_test_perf_data_add(zbx_vector_ptr_t *perfdata, const char *type, const char *id, const char *error);
+void	vmware_test_perf_data_add_value(zbx_vector_ptr_t *perfdata, zbx_uint64_t counterid, const char *instance,
+		zbx_uint64_t value);
+void	vmware_test_perf_data_free(zbx_vector_ptr_t *perfdata);
+void	vmware_test_service_update_perf(zbx_vmware_service_t *service, zbx_vector_ptr_t *perfdata);
+
+#endif /* VMWARE_TEST_H */
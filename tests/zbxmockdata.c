@@ -678,6 +678,29 @@ zbx_mock_error_t	zbx_mock_string(zbx_mock_handle_t string, const char **value)
 	return ZBX_MOCK_SUCCESS;
 }
 
+int	zbx_mock_is_null(zbx_mock_handle_t object)
+{
+	const zbx_mock_pool_handle_t	*handle;
+	const char			*value;
+	size_t				length;
+
+	if (0 > object || object >= handle_pool.values_num)
+		return FAIL;
+
+	handle = handle_pool.values[object];
+
+	if (YAML_SCALAR_NODE != handle->node->type || YAML_PLAIN_SCALAR_STYLE != handle->node->data.scalar.style)
+		return FAIL;
+
+	value = (const char *)handle->node->data.scalar.value;
+	length = handle->node->data.scalar.length;
+
+	if ((1 == length && '~' == *value) || (4 == length && 0 == strncmp(value, "null", 4)))
+		return SUCCEED;
+
+	return FAIL;
+}
+
 zbx_mock_error_t	zbx_mock_binary(zbx_mock_handle_t binary, const char **value, size_t *length)
 {
 	const zbx_mock_pool_handle_t	*handle;
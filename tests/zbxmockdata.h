@@ -58,6 +58,7 @@ zbx_mock_error_t	zbx_mock_exit_code(int *status);
 zbx_mock_error_t	zbx_mock_object_member(zbx_mock_handle_t object, const char *name, zbx_mock_handle_t *member);
 zbx_mock_error_t	zbx_mock_vector_element(zbx_mock_handle_t vector, zbx_mock_handle_t *element);
 zbx_mock_error_t	zbx_mock_string(zbx_mock_handle_t string, const char **value);
+int	zbx_mock_is_null(zbx_mock_handle_t object);
 zbx_mock_error_t	zbx_mock_binary(zbx_mock_handle_t binary, const char **value, size_t *length);
 zbx_mock_error_t	zbx_mock_parameter(const char *path, zbx_mock_handle_t *parameter);
 zbx_mock_error_t	zbx_mock_parameter_exists(const char *path);
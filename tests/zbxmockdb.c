@@ -218,7 +218,10 @@ DB_ROW	__wrap_zbx_db_fetch(DB_RESULT result)
 		if (ZBX_MOCK_DB_RESULT_COLUMNS_MAX <= column)
 			fail_msg("Too many columns for data source \"%s\".", result->data_source);
 
-		if (ZBX_MOCK_SUCCESS != (error = zbx_mock_string(field, (const char **)&result->row[column])))
+		/* plain ~ or null scalar stands for the NULL field value */
+		if (SUCCEED == zbx_mock_is_null(field))
+			result->row[column] = NULL;
+		else if (ZBX_MOCK_SUCCESS != (error = zbx_mock_string(field, (const char **)&result->row[column])))
 			break;
 
 		column++;
@@ -28,11 +28,17 @@
 #include "zbxmocktest.h"
 #include "zbxmockdata.h"
 
+#include "zbxmockhelper.h"
+
 #include "common.h"
 
+DIR		*__real_opendir(const char *name);
+struct dirent	*__real_readdir(DIR *dirp);
+
 DIR	*__wrap_opendir(const char *name)
 {
-	ZBX_UNUSED(name);
+	if (SUCCEED == zbx_mock_is_real_path(name))
+		return __real_opendir(zbx_mock_real_path(name));
 
 	errno = ENOENT;
 	return NULL;
@@ -40,8 +46,6 @@ DIR	*__wrap_opendir(const char *name)
 
 struct dirent	*__wrap_readdir(DIR *dirp)
 {
-	ZBX_UNUSED(dirp);
-
-	errno = EBADF;
-	return NULL;
+	/* only directories opened by __real_opendir() can be read */
+	return __real_readdir(dirp);
 }
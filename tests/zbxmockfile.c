@@ -28,6 +28,7 @@
 #include "zbxmocktest.h"
 #include "zbxmockdata.h"
 #include "zbxmockutil.h"
+#include "zbxmockhelper.h"
 
 #include "common.h"
 
@@ -53,6 +54,7 @@ int	__wrap___xstat(int ver, const char *pathname, struct stat *buf);
 int	__wrap___fxstat(int __ver, int __fildes, struct stat *__stat_buf);
 
 int	__real_open(const char *path, int oflag, ...);
+ssize_t	__real_read(int fildes, void *buf, size_t nbyte);
 int	__real_stat(const char *path, struct stat *buf);
 int	__real___fxstat(int __ver, int __fildes, struct stat *__stat_buf);
 
@@ -95,6 +97,9 @@ FILE	*__wrap_fopen(const char *path, const char *mode)
 	if (SUCCEED == is_profiler_path(path))
 		return __real_fopen(path, mode);
 
+	if (SUCCEED == zbx_mock_is_real_path(path))
+		return __real_fopen(zbx_mock_real_path(path), mode);
+
 	if (0 != strcmp(mode, "r"))
 	{
 		fail_msg("fopen() modes other than \"r\" are not supported.");
@@ -184,13 +189,13 @@ int	__wrap_connect(int socket, __CONST_SOCKADDR_ARG addr, socklen_t address_len)
 
 int	__wrap_open(const char *path, int oflag, ...)
 {
-	if (SUCCEED == is_profiler_path(path))
+	if (SUCCEED == is_profiler_path(path) || SUCCEED == zbx_mock_is_real_path(path))
 	{
 		va_list	args;
 		int	fd;
 
 		va_start(args, oflag);
-		fd = __real_open(path, oflag, va_arg(args, int));
+		fd = __real_open(zbx_mock_real_path(path), oflag, va_arg(args, int));
 		va_end(args);
 		return fd;
 	}
@@ -217,7 +222,9 @@ ssize_t	__wrap_read(int fildes, void *buf, size_t nbyte)
 	zbx_mock_handle_t	fragment;
 	size_t			length;
 
-	ZBX_UNUSED(fildes);
+	/* tests working with real files read them and other descriptors directly */
+	if (INT_MAX != fildes && SUCCEED == zbx_mock_has_real_dir())
+		return __real_read(fildes, buf, nbyte);
 
 	if (0 == remaining_length)
 	{
@@ -251,8 +258,8 @@ int	__wrap_stat(const char *path, struct stat *buf)
 	zbx_mock_error_t	error;
 	zbx_mock_handle_t	handle;
 
-	if (SUCCEED == is_profiler_path(path))
-		return __real_stat(path, buf);
+	if (SUCCEED == is_profiler_path(path) || SUCCEED == zbx_mock_is_real_path(path))
+		return __real_stat(zbx_mock_real_path(path), buf);
 
 	if (ZBX_MOCK_SUCCESS == (error = zbx_mock_file(path, &handle)))
 	{
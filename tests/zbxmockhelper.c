@@ -52,3 +52,63 @@ char	*zbx_yaml_assemble_binary_sequence(const char *path, size_t expected)
 
 	return buffer;
 }
+
+/* files under this directory are not mocked, used by tests of code working with real files */
+static char	*real_dir = NULL;
+
+void	zbx_mock_set_real_dir(const char *dir)
+{
+	real_dir = zbx_strdup(real_dir, dir);
+}
+
+int	zbx_mock_has_real_dir(void)
+{
+	return NULL != real_dir ? SUCCEED : FAIL;
+}
+
+/* files under this directory are taken from the real directory, e.g. "/proc" from a temporary directory */
+static char	*real_dir_alias = NULL;
+
+void	zbx_mock_set_real_dir_alias(const char *alias)
+{
+	real_dir_alias = zbx_strdup(real_dir_alias, alias);
+}
+
+static int	is_path_in_dir(const char *path, const char *dir)
+{
+	size_t	len;
+
+	if (NULL == dir)
+		return FAIL;
+
+	len = strlen(dir);
+
+	if (0 != strncmp(path, dir, len) || ('\0' != path[len] && '/' != path[len]))
+		return FAIL;
+
+	return SUCCEED;
+}
+
+int	zbx_mock_is_real_path(const char *path)
+{
+	if (NULL == real_dir)
+		return FAIL;
+
+	if (SUCCEED == is_path_in_dir(path, real_dir) || SUCCEED == is_path_in_dir(path, real_dir_alias))
+		return SUCCEED;
+
+	return FAIL;
+}
+
+/* returns the path of a real file, the returned path is valid until the next call */
+const char	*zbx_mock_real_path(const char *path)
+{
+	static char	*real_path = NULL;
+
+	if (NULL == real_dir || SUCCEED != is_path_in_dir(path, real_dir_alias))
+		return path;
+
+	real_path = zbx_dsprintf(real_path, "%s%s", real_dir, path + strlen(real_dir_alias));
+
+	return real_path;
+}
@@ -22,4 +22,10 @@
 
 char		*zbx_yaml_assemble_binary_sequence(const char *in, size_t expected);
 
+void		zbx_mock_set_real_dir(const char *dir);
+int		zbx_mock_is_real_path(const char *path);
+int		zbx_mock_has_real_dir(void);
+void		zbx_mock_set_real_dir_alias(const char *alias);
+const char	*zbx_mock_real_path(const char *path);
+
 #endif
@@ -0,0 +1,28 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "zbxtypes.h"
+
+/* Agent code declares process identification thread local while server code declares it as plain globals. */
+/* Keeping these definitions in a separate object lets server tests link their own plain definitions instead. */
+
+ZBX_THREAD_LOCAL unsigned char	process_type		= 0;
+ZBX_THREAD_LOCAL int		process_num		= 0;
+ZBX_THREAD_LOCAL int		server_num		= 0;
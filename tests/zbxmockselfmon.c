@@ -0,0 +1,38 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2020 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+
+/* make sure that __wrap_*() prototypes match unwrapped counterparts */
+#define update_selfmon_latency		__wrap_update_selfmon_latency
+#define update_selfmon_value_latency	__wrap_update_selfmon_value_latency
+#include "zbxself.h"
+#undef update_selfmon_latency
+#undef update_selfmon_value_latency
+
+void	__wrap_update_selfmon_latency(double latency)
+{
+	ZBX_UNUSED(latency);
+}
+
+void	__wrap_update_selfmon_value_latency(unsigned char stage, double latency)
+{
+	ZBX_UNUSED(stage);
+	ZBX_UNUSED(latency);
+}
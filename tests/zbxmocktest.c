@@ -26,10 +26,6 @@
 
 unsigned char	program_type	= 0;
 
-ZBX_THREAD_LOCAL unsigned char	process_type		= 0;
-ZBX_THREAD_LOCAL int		process_num		= 0;
-ZBX_THREAD_LOCAL int		server_num		= 0;
-
 int	CONFIG_ALERTER_FORKS		= 3;
 int	CONFIG_DISCOVERER_FORKS		= 1;
 int	CONFIG_HOUSEKEEPER_FORKS	= 1;
@@ -54,6 +50,9 @@ int	CONFIG_IPMIMANAGER_FORKS	= 0;
 int	CONFIG_ALERTMANAGER_FORKS	= 1;
 int	CONFIG_PREPROCMAN_FORKS		= 1;
 int	CONFIG_PREPROCESSOR_FORKS	= 3;
+int	CONFIG_LLDMANAGER_FORKS		= 1;
+int	CONFIG_LLDWORKER_FORKS		= 2;
+int	CONFIG_ALERTDB_FORKS		= 1;
 
 int	CONFIG_LISTEN_PORT		= 0;
 char	*CONFIG_LISTEN_IP		= NULL;
@@ -105,6 +104,7 @@ char	*CONFIG_SNMPTRAP_FILE		= NULL;
 
 char	*CONFIG_JAVA_GATEWAY		= NULL;
 int	CONFIG_JAVA_GATEWAY_PORT	= 0;
+int	CONFIG_JAVA_GATEWAY_MULTI_ENDPOINT	= 0;
 
 char	*CONFIG_SSH_KEY_LOCATION	= NULL;
 
@@ -118,6 +118,8 @@ int	CONFIG_PROXYPOLLER_FORKS	= 1;	/* parameters for passive proxies */
 int	CONFIG_PROXYCONFIG_FREQUENCY	= 0;
 int	CONFIG_PROXYDATA_FREQUENCY	= 1;	/* 1s */
 
+int	CONFIG_LATENCY_SAMPLE_RATE	= 0;	/* 0 - disable */
+
 char	*CONFIG_LOAD_MODULE_PATH	= NULL;
 char	**CONFIG_LOAD_MODULE		= NULL;
 